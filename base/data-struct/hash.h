@@ -91,4 +91,46 @@ void *dm_hash_lookup_with_count(struct dm_hash_table *t, const char *key, int *c
 
 //----------------------------------------------------------------
 
+/*
+ * Open addressing variant for large, lookup heavy tables.
+ *
+ * Entries live in one flat array probed linearly and keys are copied
+ * into a memory pool owned by the table, so inserting needs no malloc
+ * per entry and lookups do not chase chains.  Keys of removed entries
+ * are only released by dm_flat_hash_wipe() or dm_flat_hash_destroy().
+ *
+ * Unlike dm_hash, a key holds a single entry and an entry must not be
+ * removed while iterating over the table.
+ */
+struct dm_flat_hash;
+struct dm_flat_hash_entry;
+
+struct dm_flat_hash *dm_flat_hash_create(unsigned size_hint)
+	__attribute__((__warn_unused_result__));
+void dm_flat_hash_destroy(struct dm_flat_hash *t);
+void dm_flat_hash_wipe(struct dm_flat_hash *t);
+
+void *dm_flat_hash_lookup(struct dm_flat_hash *t, const char *key);
+int dm_flat_hash_insert(struct dm_flat_hash *t, const char *key, void *data);
+void dm_flat_hash_remove(struct dm_flat_hash *t, const char *key);
+
+void *dm_flat_hash_lookup_binary(struct dm_flat_hash *t, const void *key, uint32_t len);
+int dm_flat_hash_insert_binary(struct dm_flat_hash *t, const void *key, uint32_t len,
+			       void *data);
+void dm_flat_hash_remove_binary(struct dm_flat_hash *t, const void *key, uint32_t len);
+
+unsigned dm_flat_hash_get_num_entries(struct dm_flat_hash *t);
+void dm_flat_hash_iter(struct dm_flat_hash *t, dm_hash_iterate_fn f);
+
+const char *dm_flat_hash_get_key(struct dm_flat_hash *t, struct dm_flat_hash_entry *e);
+void *dm_flat_hash_get_data(struct dm_flat_hash *t, struct dm_flat_hash_entry *e);
+struct dm_flat_hash_entry *dm_flat_hash_get_first(struct dm_flat_hash *t);
+struct dm_flat_hash_entry *dm_flat_hash_get_next(struct dm_flat_hash *t, struct dm_flat_hash_entry *e);
+
+#define dm_flat_hash_iterate(e, h) \
+	for (e = dm_flat_hash_get_first((h)); e; \
+	     e = dm_flat_hash_get_next((h), e))
+
+//----------------------------------------------------------------
+
 #endif
@@ -20,6 +20,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 //----------------------------------------------------------------
 
 enum node_type {
@@ -80,6 +86,43 @@ struct radix_tree {
 	void *dtr_context;
 };
 
+// Returns the index of key k in n16, or a value >= nr_entries if absent.
+// The 16 keys are compared at once where the cpu has byte vector compares;
+// stale bytes past nr_entries are masked off.
+#if defined(__SSE2__)
+static inline unsigned _n16_find(const struct node16 *n16, uint8_t k)
+{
+	__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char) k),
+				     _mm_loadu_si128((const __m128i *) n16->keys));
+	unsigned mask = (unsigned) _mm_movemask_epi8(cmp) & ((1u << n16->nr_entries) - 1);
+
+	return mask ? (unsigned) __builtin_ctz(mask) : 16;
+}
+#elif defined(__ARM_NEON)
+static inline unsigned _n16_find(const struct node16 *n16, uint8_t k)
+{
+	uint8x16_t cmp = vceqq_u8(vdupq_n_u8(k), vld1q_u8(n16->keys));
+	// Narrow each byte of the compare to 4 bits of a 64 bit mask.
+	uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+
+	if (n16->nr_entries < 16)
+		mask &= (1ull << (4 * n16->nr_entries)) - 1;
+
+	return mask ? (unsigned) __builtin_ctzll(mask) / 4 : 16;
+}
+#else
+static inline unsigned _n16_find(const struct node16 *n16, uint8_t k)
+{
+	unsigned i;
+
+	for (i = 0; i < n16->nr_entries; i++)
+		if (n16->keys[i] == k)
+			break;
+
+	return i;
+}
+#endif
+
 //----------------------------------------------------------------
 
 struct radix_tree *radix_tree_create(radix_value_dtr dtr, void *dtr_context)
@@ -531,11 +574,10 @@ static struct lookup_result _lookup_prefix(struct value *v, uint8_t *kb, uint8_t
 		break;
 
 	case NODE16:
-		// FIXME: use binary search or simd?
 		n16 = v->value.ptr;
-		for (i = 0; i < n16->nr_entries; i++)
-			if (n16->keys[i] == *kb)
-				return _lookup_prefix(n16->values + i, kb + 1, ke);
+		i = _n16_find(n16, *kb);
+		if (i < n16->nr_entries)
+			return _lookup_prefix(n16->values + i, kb + 1, ke);
 		break;
 
 	case NODE48:
@@ -562,6 +604,165 @@ bool radix_tree_insert(struct radix_tree *rt, uint8_t *kb, uint8_t *ke, union ra
 }
 
 // Note the degrade functions also free the original node.
+//----------------------------------------------------------------
+// Bulk load
+
+static int _key_cmp(struct radix_tree_entry *lhs, struct radix_tree_entry *rhs)
+{
+	size_t llen = lhs->ke - lhs->kb, rlen = rhs->ke - rhs->kb;
+	int r = memcmp(lhs->kb, rhs->kb, min(llen, rlen));
+
+	if (r)
+		return r;
+
+	return (llen > rlen) - (llen < rlen);
+}
+
+// Builds the subtree for es[0..nr), whose keys all share their first
+// depth bytes.  Sorted order means the first and last keys bound the
+// common prefix, and a key ending at depth can only be the first.
+static bool _build(struct value *v, struct radix_tree_entry *es, unsigned nr, unsigned depth)
+{
+	unsigned i, b, e, len, nr_children = 0;
+	struct value_chain *vc;
+	struct prefix_chain *pc;
+	struct node4 *n4;
+	struct node16 *n16;
+	struct node48 *n48 = NULL;
+	struct node256 *n256;
+	struct value *children;
+	uint8_t *keys = NULL;
+
+	if (es->kb + depth == es->ke) {
+		if (nr == 1) {
+			v->type = VALUE;
+			v->value = es->v;
+			return true;
+		}
+
+		if (!(vc = zalloc(sizeof(*vc))))
+			return false;
+
+		vc->value = es->v;
+		v->type = VALUE_CHAIN;
+		v->value.ptr = vc;
+		return _build(&vc->child, es + 1, nr - 1, depth);
+	}
+
+	len = min(es->ke - es->kb, es[nr - 1].ke - es[nr - 1].kb) - depth;
+	if (nr > 1)
+		for (i = 0; i < len; i++)
+			if (es->kb[depth + i] != es[nr - 1].kb[depth + i]) {
+				len = i;
+				break;
+			}
+
+	if (len) {
+		if (!(pc = zalloc(sizeof(*pc) + len)))
+			return false;
+
+		pc->len = len;
+		memcpy(pc->prefix, es->kb + depth, len);
+		v->type = PREFIX_CHAIN;
+		v->value.ptr = pc;
+		return _build(&pc->child, es, nr, depth + len);
+	}
+
+	for (i = 0; i < nr; i++)
+		if (!i || es[i].kb[depth] != es[i - 1].kb[depth])
+			nr_children++;
+
+	if (nr_children <= 4) {
+		if (!(n4 = zalloc(sizeof(*n4))))
+			return false;
+		n4->nr_entries = nr_children;
+		keys = n4->keys;
+		children = n4->values;
+		v->type = NODE4;
+		v->value.ptr = n4;
+
+	} else if (nr_children <= 16) {
+		if (!(n16 = zalloc(sizeof(*n16))))
+			return false;
+		n16->nr_entries = nr_children;
+		keys = n16->keys;
+		children = n16->values;
+		v->type = NODE16;
+		v->value.ptr = n16;
+
+	} else if (nr_children <= 48) {
+		if (!(n48 = zalloc(sizeof(*n48))))
+			return false;
+		n48->nr_entries = nr_children;
+		/* coverity[bad_memset] intentional use of '0' */
+		memset(n48->keys, 48, sizeof(n48->keys));
+		children = n48->values;
+		v->type = NODE48;
+		v->value.ptr = n48;
+
+	} else {
+		if (!(n256 = zalloc(sizeof(*n256))))
+			return false;
+		n256->nr_entries = nr_children;
+		children = n256->values;
+		v->type = NODE256;
+		v->value.ptr = n256;
+	}
+
+	for (b = 0, i = 0; b < nr; b = e, i++) {
+		uint8_t k = es[b].kb[depth];
+
+		for (e = b + 1; e < nr && es[e].kb[depth] == k; e++)
+			;
+
+		if (v->type == NODE256) {
+			if (!_build(children + k, es + b, e - b, depth + 1))
+				return false;
+			continue;
+		}
+
+		if (v->type == NODE48)
+			n48->keys[k] = i;
+		else
+			keys[i] = k;
+
+		if (!_build(children + i, es + b, e - b, depth + 1))
+			return false;
+	}
+
+	return true;
+}
+
+bool radix_tree_bulk_load(struct radix_tree *rt, struct radix_tree_entry *entries, unsigned nr)
+{
+	unsigned i;
+	radix_value_dtr dtr;
+
+	if (rt->root.type != UNSET)
+		return false;
+
+	for (i = 1; i < nr; i++)
+		if (_key_cmp(entries + i - 1, entries + i) >= 0)
+			return false;
+
+	if (!nr)
+		return true;
+
+	if (!_build(&rt->root, entries, nr, 0)) {
+		// The values still belong to the caller.
+		dtr = rt->dtr;
+		rt->dtr = NULL;
+		_free_node(rt, rt->root);
+		rt->dtr = dtr;
+		rt->root.type = UNSET;
+		return false;
+	}
+
+	rt->nr_entries = nr;
+
+	return true;
+}
+
 static void _degrade_to_n4(struct node16 *n16, struct value *result)
 {
         struct node4 *n4 = zalloc(sizeof(*n4));
@@ -723,22 +924,18 @@ static bool _remove(struct radix_tree *rt, struct value *root, uint8_t *kb, uint
 
 	case NODE16:
         	n16 = root->value.ptr;
-		for (i = 0; i < n16->nr_entries; i++) {
-			if (n16->keys[i] == *kb) {
-				r = _remove(rt, n16->values + i, kb + 1, ke);
-				if (r && n16->values[i].type == UNSET) {
-        				if (i < n16->nr_entries) {
-	        				_erase_elt(n16->keys, sizeof(*n16->keys), n16->nr_entries, i);
-	        				_erase_elt(n16->values, sizeof(*n16->values), n16->nr_entries, i);
-        				}
-
-        				n16->nr_entries--;
-					if (n16->nr_entries <= 4) {
-        					_degrade_to_n4(n16, root);
-					}
-				}
-				return r;
+		i = _n16_find(n16, *kb);
+		if (i < n16->nr_entries) {
+			r = _remove(rt, n16->values + i, kb + 1, ke);
+			if (r && n16->values[i].type == UNSET) {
+				_erase_elt(n16->keys, sizeof(*n16->keys), n16->nr_entries, i);
+				_erase_elt(n16->values, sizeof(*n16->values), n16->nr_entries, i);
+
+				n16->nr_entries--;
+				if (n16->nr_entries <= 4)
+					_degrade_to_n4(n16, root);
 			}
+			return r;
 		}
 		return false;
 
@@ -876,21 +1073,18 @@ static bool _remove_subtree(struct radix_tree *rt, struct value *root, uint8_t *
 
 	case NODE16:
         	n16 = root->value.ptr;
-		for (i = 0; i < n16->nr_entries; i++) {
-			if (n16->keys[i] == *kb) {
-				r = _remove_subtree(rt, n16->values + i, kb + 1, ke, count);
-				if (r && n16->values[i].type == UNSET) {
-        				if (i < n16->nr_entries) {
-	        				_erase_elt(n16->keys, sizeof(*n16->keys), n16->nr_entries, i);
-	        				_erase_elt(n16->values, sizeof(*n16->values), n16->nr_entries, i);
-        				}
-
-        				n16->nr_entries--;
-					if (n16->nr_entries <= 4)
-        					_degrade_to_n4(n16, root);
-				}
-				return r;
+		i = _n16_find(n16, *kb);
+		if (i < n16->nr_entries) {
+			r = _remove_subtree(rt, n16->values + i, kb + 1, ke, count);
+			if (r && n16->values[i].type == UNSET) {
+				_erase_elt(n16->keys, sizeof(*n16->keys), n16->nr_entries, i);
+				_erase_elt(n16->values, sizeof(*n16->values), n16->nr_entries, i);
+
+				n16->nr_entries--;
+				if (n16->nr_entries <= 4)
+					_degrade_to_n4(n16, root);
 			}
+			return r;
 		}
 		return true;
 
@@ -1042,6 +1236,83 @@ void radix_tree_iterate(struct radix_tree *rt, uint8_t *kb, uint8_t *ke,
 // 3) prefix chain len > 0
 // 4) all unused values are UNSET
 
+static void _stats(struct value *v, struct radix_tree_stats *stats)
+{
+	unsigned i;
+	struct value_chain *vc;
+	struct prefix_chain *pc;
+	struct node4 *n4;
+	struct node16 *n16;
+	struct node48 *n48;
+	struct node256 *n256;
+
+	switch (v->type) {
+	case UNSET:
+		break;
+
+	case VALUE:
+		stats->nr_entries++;
+		break;
+
+	case VALUE_CHAIN:
+		vc = v->value.ptr;
+		stats->nr_entries++;
+		stats->nr_value_chains++;
+		stats->bytes += sizeof(*vc);
+		_stats(&vc->child, stats);
+		break;
+
+	case PREFIX_CHAIN:
+		pc = v->value.ptr;
+		stats->nr_prefix_chains++;
+		stats->bytes += sizeof(*pc) + pc->len;
+		_stats(&pc->child, stats);
+		break;
+
+	case NODE4:
+		n4 = v->value.ptr;
+		stats->nr_node4++;
+		stats->bytes += sizeof(*n4);
+		for (i = 0; i < n4->nr_entries; i++)
+			_stats(n4->values + i, stats);
+		break;
+
+	case NODE16:
+		n16 = v->value.ptr;
+		stats->nr_node16++;
+		stats->bytes += sizeof(*n16);
+		for (i = 0; i < n16->nr_entries; i++)
+			_stats(n16->values + i, stats);
+		break;
+
+	case NODE48:
+		n48 = v->value.ptr;
+		stats->nr_node48++;
+		stats->bytes += sizeof(*n48);
+		for (i = 0; i < n48->nr_entries; i++)
+			_stats(n48->values + i, stats);
+		break;
+
+	case NODE256:
+		n256 = v->value.ptr;
+		stats->nr_node256++;
+		stats->bytes += sizeof(*n256);
+		for (i = 0; i < 256; i++)
+			_stats(n256->values + i, stats);
+		break;
+	}
+}
+
+void radix_tree_stats(struct radix_tree *rt, struct radix_tree_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->bytes = sizeof(*rt);
+	_stats(&rt->root, stats);
+	stats->nr_nodes = stats->nr_value_chains + stats->nr_prefix_chains +
+			  stats->nr_node4 + stats->nr_node16 +
+			  stats->nr_node48 + stats->nr_node256;
+}
+
 static bool _check_nodes(struct value *v, unsigned *count)
 {
 	uint64_t bits;
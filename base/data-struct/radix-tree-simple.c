@@ -18,6 +18,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 //----------------------------------------------------------------
 // This implementation is based around nested binary trees.  Very
@@ -243,6 +244,74 @@ void radix_tree_iterate(struct radix_tree *rt, uint8_t *kb, uint8_t *ke,
 	}
 }
 
+static int _key_cmp(struct radix_tree_entry *lhs, struct radix_tree_entry *rhs)
+{
+	size_t llen = lhs->ke - lhs->kb, rlen = rhs->ke - rhs->kb;
+	int r = memcmp(lhs->kb, rhs->kb, llen < rlen ? llen : rlen);
+
+	if (r)
+		return r;
+
+	return (llen > rlen) - (llen < rlen);
+}
+
+// Inserting the middle entry first keeps the nested binary trees
+// balanced, where sorted insertion would degrade them to lists.
+static bool _bulk_insert(struct node **root, struct radix_tree_entry *es, unsigned nr)
+{
+	unsigned mid = nr / 2;
+
+	if (!nr)
+		return true;
+
+	return _insert(root, es[mid].kb, es[mid].ke, es[mid].v) &&
+	       _bulk_insert(root, es, mid) &&
+	       _bulk_insert(root, es + mid + 1, nr - mid - 1);
+}
+
+bool radix_tree_bulk_load(struct radix_tree *rt, struct radix_tree_entry *entries, unsigned nr)
+{
+	unsigned i;
+
+	if (rt->root)
+		return false;
+
+	for (i = 1; i < nr; i++)
+		if (_key_cmp(entries + i - 1, entries + i) >= 0)
+			return false;
+
+	if (!_bulk_insert(&rt->root, entries, nr)) {
+		// The values still belong to the caller.
+		_destroy_tree(rt->root, NULL, NULL);
+		rt->root = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static void _stats(struct node *n, struct radix_tree_stats *stats)
+{
+	if (!n)
+		return;
+
+	stats->nr_nodes++;
+	stats->bytes += sizeof(*n);
+	if (n->has_value)
+		stats->nr_entries++;
+
+	_stats(n->left, stats);
+	_stats(n->center, stats);
+	_stats(n->right, stats);
+}
+
+void radix_tree_stats(struct radix_tree *rt, struct radix_tree_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->bytes = sizeof(*rt);
+	_stats(rt->root, stats);
+}
+
 bool radix_tree_is_well_formed(struct radix_tree *rt)
 {
 	return true;
@@ -42,6 +42,33 @@ unsigned radix_tree_remove_prefix(struct radix_tree *rt, uint8_t *prefix_b, uint
 bool radix_tree_lookup(struct radix_tree *rt,
 		       uint8_t *kb, uint8_t *ke, union radix_value *result);
 
+struct radix_tree_entry {
+	uint8_t *kb;
+	uint8_t *ke;
+	union radix_value v;
+};
+
+// Fills an empty tree from entries sorted by key (memcmp order, a key
+// sorts before any key it is a prefix of).  Each node is allocated at
+// its final size rather than grown through node4/16/48/256.  Returns
+// false, leaving the tree empty, if the tree isn't empty, the keys
+// aren't sorted and unique, or allocation fails.
+bool radix_tree_bulk_load(struct radix_tree *rt, struct radix_tree_entry *entries, unsigned nr);
+
+struct radix_tree_stats {
+	unsigned nr_entries;
+	unsigned nr_nodes;		// all allocated nodes, of any type
+	unsigned nr_value_chains;
+	unsigned nr_prefix_chains;
+	unsigned nr_node4;
+	unsigned nr_node16;
+	unsigned nr_node48;
+	unsigned nr_node256;
+	uint64_t bytes;			// memory held by the tree
+};
+
+void radix_tree_stats(struct radix_tree *rt, struct radix_tree_stats *stats);
+
 // The radix tree stores entries in lexicographical order.  Which means
 // we can iterate entries, in order.  Or iterate entries with a particular
 // prefix.
@@ -634,14 +634,133 @@ rr_create_retry:
 }
 
 #else
+/*
+ * Checkpoint bitmaps are mostly long runs of identical bytes, so they
+ * are sent run-length encoded behind a small header:
+ *
+ *   CKPT_RLE_MAGIC | bitmap size (LE32) | encoded sync size (LE32) |
+ *   encoded sync_bits | encoded clean_bits | recovering region
+ *
+ * Each encoded bitmap is a series of ops, each starting with a
+ * varint (len << 1 | repeat).  A repeat op is followed by the one
+ * byte to repeat 'len' times, a literal op by 'len' raw bytes.
+ * The plain layout (sync|clean|recovering region) is still accepted.
+ */
+#define CKPT_RLE_MAGIC "CMRL"
+#define CKPT_RLE_HDR_SIZE 12
+#define CKPT_RLE_MIN_RUN 4
+
+static size_t _rle_put_varint(char *out, size_t v)
+{
+	size_t n = 0;
+
+	do {
+		out[n] = (char)(v & 0x7f);
+		v >>= 7;
+		if (v)
+			out[n] |= (char)0x80;
+		n++;
+	} while (v);
+
+	return n;
+}
+
+static int _rle_get_varint(const char **in, const char *end, size_t *v)
+{
+	unsigned shift = 0;
+
+	*v = 0;
+	while (*in < end && shift < 8 * sizeof(*v)) {
+		*v |= (size_t)(**in & 0x7f) << shift;
+		if (!(*(*in)++ & 0x80))
+			return 1;
+		shift += 7;
+	}
+
+	return 0;
+}
+
+/*
+ * Encode 'size' bytes of 'bits' into 'out', which must hold at least
+ * size + size / 64 + 16 bytes (all literals plus op headers).
+ * Returns: the encoded length
+ */
+static size_t _rle_encode(char *out, const char *bits, size_t size)
+{
+	size_t i = 0, lit = 0, run, n = 0;
+
+	while (i < size) {
+		for (run = 1; (i + run < size) && (bits[i + run] == bits[i]); run++)
+			;
+
+		if (run < CKPT_RLE_MIN_RUN && (i + run < size)) {
+			i += run;
+			continue;
+		}
+
+		if (run < CKPT_RLE_MIN_RUN) {
+			i += run;
+			run = 0;
+		}
+
+		if (i > lit) {
+			n += _rle_put_varint(out + n, (i - lit) << 1);
+			memcpy(out + n, bits + lit, i - lit);
+			n += i - lit;
+		}
+
+		if (run) {
+			n += _rle_put_varint(out + n, (run << 1) | 1);
+			out[n++] = bits[i];
+			i += run;
+		}
+
+		lit = i;
+	}
+
+	return n;
+}
+
+/*
+ * Returns: number of encoded bytes consumed, 0 on malformed input
+ */
+static size_t _rle_decode(char *bits, size_t size, const char *in, size_t len)
+{
+	const char *p = in, *end = in + len;
+	size_t op, n = 0;
+
+	while (n < size) {
+		if (!_rle_get_varint(&p, end, &op) || ((op >> 1) > size - n))
+			return 0;
+
+		if (op & 1) {
+			if (p >= end)
+				return 0;
+			memset(bits + n, *p++, op >> 1);
+		} else {
+			if ((op >> 1) > (size_t)(end - p))
+				return 0;
+			memcpy(bits + n, p, op >> 1);
+			p += op >> 1;
+		}
+		n += op >> 1;
+	}
+
+	return (size_t)(p - in);
+}
+
 static int export_checkpoint(struct checkpoint_data *cp)
 {
 	int r, rq_size;
+	size_t sync_len, clean_len, max_len;
+	uint32_t v;
 	struct clog_request *rq;
 
+	max_len = cp->bitmap_size + cp->bitmap_size / 64 + 16;
+
 	rq_size = sizeof(*rq);
 	rq_size += RECOVERING_REGION_SECTION_SIZE;
-	rq_size += cp->bitmap_size * 2; /* clean|sync_bits */
+	rq_size += CKPT_RLE_HDR_SIZE + max_len * 2;
 
 	rq = zalloc(rq_size);
 	if (!rq) {
@@ -655,17 +774,34 @@ static int export_checkpoint(struct checkpoint_data *cp)
 	rq->originator = cp->requester;
 	strncpy(rq->u_rq.uuid, cp->uuid, CPG_MAX_NAME_LENGTH);
 	rq->u_rq.seq = my_cluster_id;
-	rq->u_rq.data_size = rq_size - sizeof(*rq);
 
 	/* Sync bits */
-	memcpy(rq->u_rq.data, cp->sync_bits, cp->bitmap_size);
+	sync_len = _rle_encode(rq->u_rq.data + CKPT_RLE_HDR_SIZE,
+			       cp->sync_bits, cp->bitmap_size);
 
 	/* Clean bits */
-	memcpy(rq->u_rq.data + cp->bitmap_size, cp->clean_bits, cp->bitmap_size);
+	clean_len = _rle_encode(rq->u_rq.data + CKPT_RLE_HDR_SIZE + sync_len,
+				cp->clean_bits, cp->bitmap_size);
+
+	if (CKPT_RLE_HDR_SIZE + sync_len + clean_len < (size_t)cp->bitmap_size * 2) {
+		memcpy(rq->u_rq.data, CKPT_RLE_MAGIC, 4);
+		v = xlate32(cp->bitmap_size);
+		memcpy(rq->u_rq.data + 4, &v, sizeof(v));
+		v = xlate32((uint32_t)sync_len);
+		memcpy(rq->u_rq.data + 8, &v, sizeof(v));
+		rq->u_rq.data_size = CKPT_RLE_HDR_SIZE + sync_len + clean_len;
+		LOG_DBG("[%s] Checkpoint bitmaps encoded in %u bytes",
+			SHORT_UUID(cp->uuid), rq->u_rq.data_size);
+	} else {
+		memcpy(rq->u_rq.data, cp->sync_bits, cp->bitmap_size);
+		memcpy(rq->u_rq.data + cp->bitmap_size, cp->clean_bits, cp->bitmap_size);
+		rq->u_rq.data_size = cp->bitmap_size * 2;
+	}
 
 	/* Recovering region */
-	memcpy(rq->u_rq.data + (cp->bitmap_size * 2), cp->recovering_region,
+	memcpy(rq->u_rq.data + rq->u_rq.data_size, cp->recovering_region,
 	       strlen(cp->recovering_region));
+	rq->u_rq.data_size += RECOVERING_REGION_SECTION_SIZE;
 
 	r = cluster_send(rq);
 	if (r)
@@ -838,29 +974,58 @@ no_read:
 static int import_checkpoint(struct clog_cpg *entry, int no_read,
 			     struct clog_request *rq)
 {
-	int bitmap_size;
+	int bitmap_size, payload_size;
+	size_t sync_len, enc_len;
+	const char *enc;
+	char *bitmap = NULL;
+	uint32_t v;
 
 	if (no_read) {
 		LOG_DBG("Checkpoint for this log already received");
 		return 0;
 	}
 
-	bitmap_size = (rq->u_rq.data_size - RECOVERING_REGION_SECTION_SIZE) / 2;
-	if (bitmap_size < 0) {
+	if ((payload_size = (int)rq->u_rq.data_size - RECOVERING_REGION_SECTION_SIZE) < 0) {
 		LOG_ERROR("Checkpoint has invalid payload size.");
 		return -EINVAL;
 	}
 
+	if ((payload_size >= CKPT_RLE_HDR_SIZE) &&
+	    !memcmp(rq->u_rq.data, CKPT_RLE_MAGIC, 4)) {
+		memcpy(&v, rq->u_rq.data + 4, sizeof(v));
+		bitmap_size = (int)xlate32(v);
+		memcpy(&v, rq->u_rq.data + 8, sizeof(v));
+		sync_len = xlate32(v);
+		enc = rq->u_rq.data + CKPT_RLE_HDR_SIZE;
+		enc_len = payload_size - CKPT_RLE_HDR_SIZE;
+
+		if ((bitmap_size > 0) && (sync_len <= enc_len) &&
+		    (bitmap = malloc((size_t)bitmap_size * 2)) &&
+		    ((_rle_decode(bitmap, bitmap_size, enc, sync_len) != sync_len) ||
+		     (_rle_decode(bitmap + bitmap_size, bitmap_size, enc + sync_len,
+				  enc_len - sync_len) != enc_len - sync_len))) {
+			/* Plain bitmaps that happen to start with the magic */
+			free(bitmap);
+			bitmap = NULL;
+		}
+	}
+
+	if (!bitmap)
+		bitmap_size = payload_size / 2;
+
 	if (pull_state(entry->name.value, entry->luid, "sync_bits",
-		       rq->u_rq.data, bitmap_size) ||
+		       bitmap ? : rq->u_rq.data, bitmap_size) ||
 	    pull_state(entry->name.value, entry->luid, "clean_bits",
-		       rq->u_rq.data + bitmap_size, bitmap_size) ||
+		       (bitmap ? : rq->u_rq.data) + bitmap_size, bitmap_size) ||
 	    pull_state(entry->name.value, entry->luid, "recovering_region",
-		       rq->u_rq.data + (bitmap_size * 2),
+		       rq->u_rq.data + payload_size,
 		       RECOVERING_REGION_SECTION_SIZE)) {
 		LOG_ERROR("Error loading bitmap state from checkpoint.");
+		free(bitmap);
 		return -EIO;
 	}
+
+	free(bitmap);
 	return 0;
 }
 #endif /* CMIRROR_HAS_CHECKPOINT */
@@ -125,24 +125,17 @@ static void log_clear_bit(struct log_c *lc, dm_bitset_t bs, int bit)
 	lc->touched = 1;
 }
 
+/* Returns the size of the set when every region from start is in sync */
 static uint64_t find_next_zero_bit(dm_bitset_t bs, unsigned start)
 {
-	for (; dm_bit(bs, start); start++)
-		if (start >= *bs)
-			return (uint64_t)-1;
+	int bit = dm_bit_get_next_zero(bs, (int) start - 1);
 
-	return start;
+	return (bit < 0) ? (uint64_t) *bs : (uint64_t) bit;
 }
 
 static uint64_t count_bits32(dm_bitset_t bs)
 {
-	unsigned i, size = bs[0]/(unsigned)DM_BITS_PER_INT + 1;
-	unsigned count = 0;
-
-	for (i = 1; i <= size; i++)
-		count += hweight32(bs[i]);
-
-	return (uint64_t)count;
+	return (uint64_t) dm_bit_count(bs);
 }
 
 /*
@@ -16,6 +16,7 @@
 #include "local.h"
 
 #include <errno.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <linux/connector.h>
 #include <linux/netlink.h>
@@ -31,6 +32,24 @@ static int cn_fd = -1;  /* Connector (netlink) socket fd */
 static char recv_buf[2048];
 static char send_buf[2048];
 
+/*
+ * Clear requests are acknowledged to the kernel immediately, so
+ * the regions they carry are collected per log and handed to the
+ * cluster as a single CLEAR_REGION request once the kernel has
+ * nothing more queued, a batch fills, or any other request for
+ * the same log arrives.  The latter keeps a FLUSH ordered after
+ * every clear that preceded it.
+ */
+#define CLEAR_BATCH_MAX ((DM_ULOG_REQUEST_SIZE - sizeof(struct clog_request)) / \
+			 sizeof(uint64_t))
+
+struct clear_batch {
+	struct dm_list list;
+	struct clog_request *rq;
+};
+
+static DM_LIST_INIT(clear_batches);
+
 
 /* FIXME: merge this function with kernel_send_helper */
 static int kernel_ack(uint32_t seq, int error)
@@ -204,6 +223,114 @@ static int kernel_send_helper(void *data, uint16_t out_size)
 	return 0;
 }
 
+static void send_clear_batch(struct clear_batch *cb)
+{
+	LOG_DBG("[%s]  Sending %u coalesced clear regions",
+		SHORT_UUID(cb->rq->u_rq.uuid),
+		(unsigned)(cb->rq->u_rq.data_size / sizeof(uint64_t)));
+
+	if (cluster_send(cb->rq))
+		LOG_ERROR("[%s]  Failed to send coalesced clear regions",
+			  SHORT_UUID(cb->rq->u_rq.uuid));
+
+	dm_list_del(&cb->list);
+	free(cb->rq);
+	free(cb);
+}
+
+static void flush_clear_batch(struct dm_ulog_request *u_rq)
+{
+	struct clear_batch *cb, *tmp;
+
+	dm_list_iterate_items_safe(cb, tmp, &clear_batches)
+		if ((cb->rq->u_rq.luid == u_rq->luid) &&
+		    !strncmp(cb->rq->u_rq.uuid, u_rq->uuid, DM_UUID_LEN))
+			send_clear_batch(cb);
+}
+
+static void flush_clear_batches(void)
+{
+	struct clear_batch *cb, *tmp;
+
+	dm_list_iterate_items_safe(cb, tmp, &clear_batches)
+		send_clear_batch(cb);
+}
+
+/* Unsent clears only leave regions dirty, which is always safe */
+static void drop_clear_batches(void)
+{
+	struct clear_batch *cb, *tmp;
+
+	dm_list_iterate_items_safe(cb, tmp, &clear_batches) {
+		dm_list_del(&cb->list);
+		free(cb->rq);
+		free(cb);
+	}
+}
+
+/*
+ * queue_clear_region
+ * @rq: CLEAR_REGION request from the kernel
+ *
+ * Append the regions of 'rq' to the pending batch for its log.
+ * Falls back to sending 'rq' directly if no batch can be allocated.
+ *
+ * Returns: 0 on success, -EXXX on failure
+ */
+static int queue_clear_region(struct clog_request *rq)
+{
+	struct clear_batch *cb;
+	struct dm_ulog_request *u_rq = &rq->u_rq;
+	uint32_t count = u_rq->data_size / sizeof(uint64_t);
+	uint64_t *region = (uint64_t *)u_rq->data;
+	uint32_t used;
+
+	if (u_rq->data_size % sizeof(uint64_t))
+		return cluster_send(rq);
+
+	while (count) {
+		cb = NULL;
+		dm_list_iterate_items(cb, &clear_batches)
+			if ((cb->rq->u_rq.luid == u_rq->luid) &&
+			    !strncmp(cb->rq->u_rq.uuid, u_rq->uuid, DM_UUID_LEN))
+				break;
+
+		if (&cb->list == &clear_batches) {
+			if (!(cb = malloc(sizeof(*cb))))
+				return cluster_send(rq);
+
+			if (!(cb->rq = malloc(DM_ULOG_REQUEST_SIZE))) {
+				free(cb);
+				return cluster_send(rq);
+			}
+
+			memcpy(cb->rq, rq, sizeof(*rq));
+			cb->rq->u_rq.data_size = 0;
+			dm_list_add(&clear_batches, &cb->list);
+		}
+
+		used = cb->rq->u_rq.data_size / sizeof(uint64_t);
+		memcpy((uint64_t *)cb->rq->u_rq.data + used, region,
+		       sizeof(uint64_t));
+		cb->rq->u_rq.data_size += sizeof(uint64_t);
+		region++;
+		count--;
+
+		if (++used == CLEAR_BATCH_MAX)
+			send_clear_batch(cb);
+	}
+
+	return 0;
+}
+
+/* Nothing more is waiting from the kernel */
+static int kernel_idle(void)
+{
+	struct pollfd pfd = { .fd = cn_fd, .events = POLLIN };
+
+	return poll(&pfd, 1, 0) <= 0;
+}
+
 /*
  * do_local_work
  *
@@ -231,6 +358,10 @@ static int do_local_work(void *data __attribute__((unused)))
 	LOG_DBG("[%s]  Request from kernel received: [%s/%u]",
 		SHORT_UUID(u_rq->uuid), RQ_TYPE(u_rq->request_type),
 		u_rq->seq);
+
+	if (u_rq->request_type != DM_ULOG_CLEAR_REGION)
+		flush_clear_batch(u_rq);
+
 	switch (u_rq->request_type) {
 	case DM_ULOG_CTR:
 	case DM_ULOG_DTR:
@@ -288,7 +419,7 @@ static int do_local_work(void *data __attribute__((unused)))
 	case DM_ULOG_CLEAR_REGION:
 		r = kernel_ack(u_rq->seq, 0);
 
-		r = cluster_send(rq);
+		r = queue_clear_region(rq);
 		if (r) {
 			/*
 			 * FIXME: store error for delivery on flush
@@ -305,6 +436,9 @@ static int do_local_work(void *data __attribute__((unused)))
 		return 0;
 	}
 
+	if (!dm_list_empty(&clear_batches) && kernel_idle())
+		flush_clear_batches();
+
 	if (r && !u_rq->error)
 		u_rq->error = r;
 
@@ -417,6 +551,7 @@ int init_local(void)
  */
 void cleanup_local(void)
 {
+	drop_clear_batches();
 	links_unregister(cn_fd);
 	if (cn_fd >= 0 && close(cn_fd))
 		LOG_ERROR("Failed to close socket: %s",
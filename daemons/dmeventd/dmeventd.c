@@ -21,15 +21,21 @@
 #include "dmeventd.h"
 
 #include "libdm/misc/dm-logging.h"
+#include "libdm/misc/dm-ioctl.h"
 #include "base/memory/zalloc.h"
 
 #include <dlfcn.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sys/file.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/sysmacros.h>
+#include <sys/un.h>
 #include <signal.h>
 #include <arpa/inet.h>		/* for htonl, ntohl */
 #include <fcntl.h>		/* for musl libc */
@@ -92,6 +98,15 @@ static const size_t THREAD_STACK_SIZE = 300 * 1024;
 /* Default idle exit timeout 1 hour (in seconds) */
 static const time_t DMEVENTD_IDLE_EXIT_TIMEOUT = 60 * 60;
 
+/*
+ * Timeout events on devices staying below DMEVENTD_USAGE_IDLE back off
+ * up to DMEVENTD_TIMEOUT_BACKOFF_MAX times the registered timeout,
+ * above DMEVENTD_USAGE_HOT they come twice as often.
+ */
+#define DMEVENTD_TIMEOUT_BACKOFF_MAX	16
+#define DMEVENTD_USAGE_IDLE		(DM_PERCENT_1 * 50)
+#define DMEVENTD_USAGE_HOT		(DM_PERCENT_1 * 80)
+
 static int _debug_level = 0;
 static int _use_syslog = 1;
 static int _systemd_activation = 0;
@@ -100,6 +115,31 @@ static int _restart = 0;
 static time_t _idle_since = 0;
 static char **_initial_registrations = 0;
 
+/*
+ * Poll mode (-p): instead of a thread blocked in DM_DEV_WAIT per device,
+ * one thread polls the dm control node armed with DM_DEV_ARM_POLL and
+ * compares event numbers of all devices from a single DM_DEVICE_LIST.
+ * Devices with new events are queued for a small pool of workers
+ * calling the plugins.  _work_queue is protected by _global_mutex.
+ */
+#define DMEVENTD_POLL_WORKERS 4
+static int _use_poll = 0;
+static int _poll_fd = -1;
+static int _poll_running = 0;
+static unsigned _poll_workers = 0;
+static unsigned _poll_round = 0;
+static DM_LIST_INIT(_work_queue);
+static pthread_cond_t _work_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Requests come from the fifos and from each DM_EVENT_SOCKET
+ * connection thread, the handlers still run one at a time.
+ */
+static pthread_mutex_t _request_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int _socket_fd = -1;
+/* Idle socket connection is closed after this many seconds */
+#define DMEVENTD_SOCKET_IDLE_TIMEOUT 60
+
 /* FIXME Make configurable at runtime */
 
 /* All libdm messages */
@@ -142,6 +182,8 @@ static const char *decode_cmd(uint32_t cmd)
 	case DM_EVENT_CMD_DIE:				return "DIE";
 	case DM_EVENT_CMD_GET_STATUS:			return "GET_STATUS";
 	case DM_EVENT_CMD_GET_PARAMETERS:		return "GET_PARAMETERS";
+	case DM_EVENT_CMD_REGISTER_FOR_EVENTS:		return "REGISTER_FOR_EVENTS";
+	case DM_EVENT_CMD_UNREGISTER_FOR_EVENTS:	return "UNREGISTER_FOR_EVENTS";
 	default:					return "unknown";
 	}
 }
@@ -193,6 +235,13 @@ struct dso_data {
 	 */
 	int (*unregister_device)(const char *device, const char *uuid,
 				 int major, int minor, void **user);
+
+	/*
+	 * Optional usage of the device as seen by the last process_event()
+	 * or DM_PERCENT_INVALID.  Lets timeout events back off on idle
+	 * devices and come more often on devices getting full.
+	 */
+	dm_percent_t (*get_usage)(void **user);
 };
 static DM_LIST_INIT(_dso_registry);
 
@@ -240,11 +289,17 @@ struct thread_status {
 	int events;		/* bitfield for event filter. */
 	int current_events;	/* bitfield for occured events. */
 	struct dm_task *wait_task;
+	struct dm_task *status_task;	/* reused by _get_device_status() */
 	int pending;		/* Set when event filter change is pending */
 	time_t next_time;
 	uint32_t timeout;
+	unsigned timeout_backoff;	/* Multiplier of timeout for idle device */
+	dm_percent_t last_usage;	/* Usage after the last processed event */
 	struct dm_list timeout_list;
 	void *dso_private; /* dso per-thread status variable */
+	uint32_t event_nr;	/* Last event number seen in poll mode */
+	unsigned poll_round;	/* _poll_round when monitoring started */
+	struct dm_list work_list;	/* Link in _work_queue */
 	/* TODO per-thread mutex */
 };
 
@@ -331,6 +386,9 @@ static int _lookup_symbol(void *dl, void **symbol, const char *name)
 
 static int _lookup_symbols(void *dl, struct dso_data *data)
 {
+	/* Optional */
+	data->get_usage = dlsym(dl, "get_usage");
+
 	return _lookup_symbol(dl, (void *) &data->process_event,
 			     "process_event") &&
 	    _lookup_symbol(dl, (void *) &data->register_device,
@@ -397,6 +455,8 @@ static void _free_thread_status(struct thread_status *thread)
 	_lib_put(thread->dso_data);
 	if (thread->wait_task)
 		dm_task_destroy(thread->wait_task);
+	if (thread->status_task)
+		dm_task_destroy(thread->status_task);
 	free(thread->device.uuid);
 	free(thread->device.name);
 	free(thread);
@@ -436,7 +496,10 @@ static struct thread_status *_alloc_thread_status(const struct message_data *dat
 	thread->events = data->events_field;
 	thread->pending = DM_EVENT_REGISTRATION_PENDING;
 	thread->timeout = data->timeout_secs;
+	thread->timeout_backoff = 1;
+	thread->last_usage = DM_PERCENT_INVALID;
 	dm_list_init(&thread->timeout_list);
+	dm_list_init(&thread->work_list);
 
 	return thread;
 
@@ -592,6 +655,22 @@ static int _unlock_mutex(void)
 	return pthread_mutex_unlock(&_global_mutex);
 }
 
+/*
+ * Hand a device over to the poll mode workers.
+ * A device being processed rechecks its events before it is released.
+ *
+ * Mutex must be held when calling this.
+ */
+static void _queue_work(struct thread_status *thread)
+{
+	if (thread->processing || (thread->status == DM_THREAD_DONE) ||
+	    !dm_list_empty(&thread->work_list))
+		return;
+
+	dm_list_add(&_work_queue, &thread->work_list);
+	pthread_cond_signal(&_work_cond);
+}
+
 /* Check, if a device exists. */
 static int _fill_device_data(struct thread_status *ts)
 {
@@ -617,6 +696,7 @@ static int _fill_device_data(struct thread_status *ts)
 
 	ts->device.major = dmi.major;
 	ts->device.minor = dmi.minor;
+	ts->event_nr = dmi.event_nr;
 	dm_task_set_event_nr(ts->wait_task, dmi.event_nr);
 
 	ret = 1;
@@ -626,26 +706,26 @@ fail:
 	return ret;
 }
 
+/* The returned task belongs to ts and is valid until the next call. */
 static struct dm_task *_get_device_status(struct thread_status *ts)
 {
-	struct dm_task *dmt = dm_task_create(DM_DEVICE_STATUS);
+	struct dm_task *dmt = ts->status_task;
 
-	if (!dmt)
+	if (dmt) {
+		if (!dm_task_reset(dmt, DM_DEVICE_STATUS))
+			return_NULL;
+	} else if (!(dmt = ts->status_task = dm_task_create(DM_DEVICE_STATUS)))
 		return_NULL;
 
-	if (!dm_task_set_uuid(dmt, ts->device.uuid)) {
-		dm_task_destroy(dmt);
+	if (!dm_task_set_uuid(dmt, ts->device.uuid))
 		return_NULL;
-	}
 
 	/* Non-blocking status read */
 	if (!dm_task_no_flush(dmt))
 		log_warn("WARNING: Can't set no_flush for dm status.");
 
-	if (!dm_task_run(dmt)) {
-		dm_task_destroy(dmt);
+	if (!dm_task_run(dmt))
 		return_NULL;
-	}
 
 	return dmt;
 }
@@ -778,7 +858,10 @@ static void *_timeout_thread(void *unused __attribute__((unused)))
 			if (thread->next_time <= curr_time) {
 				thread->next_time = curr_time + thread->timeout;
 				_lock_mutex();
-				if (thread->processing) {
+				if (_use_poll) {
+					thread->current_events |= DM_EVENT_TIMEOUT;
+					_queue_work(thread);
+				} else if (thread->processing) {
 					/* Cannot signal processing monitoring thread */
 					log_debug("Skipping SIGALRM to processing Thr %x for timeout.",
 						  (int) thread->thread);
@@ -939,6 +1022,38 @@ static int _do_unregister_device(struct thread_status *thread)
 						   &(thread->dso_private));
 }
 
+/* Schedule the next timeout event from the usage the DSO reports. */
+static void _adapt_timeout(struct thread_status *thread)
+{
+	dm_percent_t usage;
+	uint32_t secs;
+
+	if (!thread->dso_data->get_usage)
+		return;
+
+	usage = thread->dso_data->get_usage(&thread->dso_private);
+
+	if ((usage != DM_PERCENT_INVALID) && (usage < DMEVENTD_USAGE_IDLE) &&
+	    (usage <= thread->last_usage)) {
+		if (thread->timeout_backoff < DMEVENTD_TIMEOUT_BACKOFF_MAX)
+			thread->timeout_backoff <<= 1;
+	} else
+		thread->timeout_backoff = 1; /* Unknown or growing */
+
+	thread->last_usage = usage;
+
+	pthread_mutex_lock(&_timeout_mutex);
+	if (!dm_list_empty(&thread->timeout_list)) {
+		secs = thread->timeout * thread->timeout_backoff;
+		if (usage > DMEVENTD_USAGE_HOT)
+			secs = (secs + 1) / 2;
+		DEBUGLOG("Next timeout for %s in %u second(s).", thread->device.name, secs);
+		thread->next_time = time(NULL) + secs;
+		pthread_cond_signal(&_timeout_cond);
+	}
+	pthread_mutex_unlock(&_timeout_mutex);
+}
+
 /* Process an event in the DSO. */
 static void _do_process_event(struct thread_status *thread)
 {
@@ -952,8 +1067,7 @@ static void _do_process_event(struct thread_status *thread)
 		log_error("Lost event in Thr %x.", (int)thread->thread);
 	else {
 		thread->dso_data->process_event(task, thread->current_events, &(thread->dso_private));
-		if (task != thread->wait_task)
-			dm_task_destroy(task);
+		_adapt_timeout(thread);
 	}
 }
 
@@ -1077,9 +1191,267 @@ out:
 	return NULL;
 }
 
+/* Process an event in poll mode, status is always read afresh. */
+static void _do_process_polled_event(struct thread_status *thread, int events)
+{
+	struct dm_task *task;
+
+	if (!(task = _get_device_status(thread)))
+		log_error("Lost event for %s.", thread->device.name);
+	else {
+		thread->dso_data->process_event(task, events, &(thread->dso_private));
+		_adapt_timeout(thread);
+	}
+}
+
+/*
+ * Finish registration or run pending events of a device taken
+ * from _work_queue.  Mutex is held on entry and on return.
+ */
+static void _process_work(struct thread_status *thread)
+{
+	sigset_t pendmask, alarmset;
+	int events, sig;
+
+	if (thread->status == DM_THREAD_REGISTERING) {
+		_unlock_mutex();
+
+		if (!_fill_device_data(thread)) {
+			log_error("Failed to fill device data for %s.", thread->device.uuid);
+			_lock_mutex();
+			goto unregister;
+		}
+
+		if (!_do_register_device(thread)) {
+			log_error("Failed to register device %s.", thread->device.name);
+			_lock_mutex();
+			goto unregister;
+		}
+
+		_lock_mutex();
+		thread->status = DM_THREAD_RUNNING;
+		thread->poll_round = _poll_round;
+	}
+
+	while (thread->events & thread->current_events) {
+		events = thread->current_events;
+		thread->current_events = 0;
+		_unlock_mutex();
+
+		_do_process_polled_event(thread, events);
+
+		_lock_mutex();
+
+		/* Plugin asks to be unregistered via SIGALRM */
+		if (sigpending(&pendmask) < 0)
+			log_sys_error("sigpending", "");
+		else if (sigismember(&pendmask, SIGALRM)) {
+			sigemptyset(&alarmset);
+			sigaddset(&alarmset, SIGALRM);
+			(void) sigwait(&alarmset, &sig);
+			goto unregister;
+		}
+	}
+
+	if (thread->events) {
+		thread->current_events = 0;
+		thread->pending = 0;
+		thread->processing = 0;
+		return;
+	}
+
+unregister:
+	_monitor_unregister(thread);
+	_lock_mutex();
+}
+
+static void *_worker_thread(void *unused __attribute__((unused)))
+{
+	struct thread_status *thread;
+
+	_lock_mutex();
+
+	for (;;) {
+		while (dm_list_empty(&_work_queue))
+			pthread_cond_wait(&_work_cond, &_global_mutex);
+
+		thread = dm_list_struct_base(dm_list_first(&_work_queue),
+					     struct thread_status, work_list);
+		dm_list_del(&thread->work_list);
+		dm_list_init(&thread->work_list);
+		thread->processing = 1;
+
+		_process_work(thread);
+	}
+
+	return NULL;
+}
+
+static int _arm_poll(void)
+{
+	struct dm_ioctl dmi = {
+		.version = { DM_VERSION_MAJOR, 0, 0 },
+		.data_size = sizeof(dmi),
+	};
+
+	return !ioctl(_poll_fd, DM_DEV_ARM_POLL, &dmi);
+}
+
+/*
+ * Compare event numbers of all monitored devices with a single
+ * DM_DEVICE_LIST and queue those with new events.
+ */
+static void _check_events(void)
+{
+	struct dm_task *dmt;
+	struct dm_pool *mem = NULL;
+	struct dm_hash_table *devs = NULL;
+	struct dm_list list;
+	struct dm_active_device *dm_dev;
+	struct thread_status *thread, *tmp;
+	unsigned features, round;
+	uint64_t dev;
+
+	_lock_mutex();
+	round = ++_poll_round;
+	_unlock_mutex();
+
+	if (!(dmt = dm_task_create(DM_DEVICE_LIST))) {
+		stack;
+		return;
+	}
+
+	if (!dm_task_run(dmt))
+		goto_out;
+
+	if (!(mem = dm_pool_create("dmeventd_poll", 4096)) ||
+	    !(devs = dm_hash_create(64)))
+		goto_out;
+
+	if (!dm_task_get_device_list(dmt, mem, &list, &features))
+		goto_out;
+
+	if (!(features & DM_DEVICE_LIST_HAS_EVENT_NR)) {
+		log_error("Kernel does not report event numbers of devices.");
+		goto out;
+	}
+
+	dm_list_iterate_items(dm_dev, &list)
+		if (!dm_hash_insert_binary(devs, &dm_dev->dev, sizeof(dm_dev->dev), dm_dev))
+			goto_out;
+
+	_lock_mutex();
+
+	dm_list_iterate_items_safe(thread, tmp, &_thread_registry) {
+		/* Skip devices which started monitoring after the list was taken */
+		if ((thread->status != DM_THREAD_RUNNING) ||
+		    (thread->poll_round == round))
+			continue;
+
+		dev = makedev(thread->device.major, thread->device.minor);
+
+		if (!(dm_dev = dm_hash_lookup_binary(devs, &dev, sizeof(dev)))) {
+			log_error("%s disappeared, detaching.", thread->device.name);
+			thread->events = 0;
+			_thread_unused(thread);
+			_queue_work(thread);
+		} else if ((int32_t) (dm_dev->event_nr - thread->event_nr) > 0) {
+			thread->event_nr = dm_dev->event_nr;
+			thread->current_events |= DM_EVENT_DEVICE_ERROR;
+			_queue_work(thread);
+		}
+	}
+
+	_unlock_mutex();
+out:
+	if (devs)
+		dm_hash_destroy(devs);
+	if (mem)
+		dm_pool_destroy(mem);
+	dm_task_destroy(dmt);
+}
+
+/* Event loop of poll mode. */
+static void *_poll_thread(void *unused __attribute__((unused)))
+{
+	struct pollfd pfd = { .fd = _poll_fd, .events = POLLIN };
+
+	for (;;) {
+		/* Arm before listing so no event gets lost in between */
+		if (!_arm_poll()) {
+			log_sys_error("ioctl", "DM_DEV_ARM_POLL");
+			sleep(1);
+			continue;
+		}
+
+		_check_events();
+
+		if ((poll(&pfd, 1, -1) < 0) && (errno != EINTR))
+			log_sys_error("poll", "dm control");
+	}
+
+	return NULL;
+}
+
+/* Open dm control node for poll mode, fallback to thread per device. */
+static void _init_poll(void)
+{
+	char path[PATH_MAX];
+
+	if (dm_snprintf(path, sizeof(path), "%s/control", dm_dir()) < 0) {
+		log_error("Control node path is too long.");
+		goto bad;
+	}
+
+	if ((_poll_fd = open(path, O_RDWR)) < 0) {
+		log_sys_error("open", path);
+		goto bad;
+	}
+
+	if (!_arm_poll()) {
+		log_sys_debug("ioctl", "DM_DEV_ARM_POLL");
+		if (close(_poll_fd))
+			log_sys_debug("close", path);
+		_poll_fd = -1;
+		goto bad;
+	}
+
+	log_debug("Monitoring devices with DM_DEV_ARM_POLL on %s.", path);
+
+	return;
+bad:
+	log_warn("WARNING: Poll mode is unavailable, using thread per device.");
+	_use_poll = 0;
+}
+
+/* Start poll mode threads on first registration. */
+static int _start_poll(void)
+{
+	int ret;
+
+	for (; _poll_workers < DMEVENTD_POLL_WORKERS; _poll_workers++)
+		if ((ret = _pthread_create_smallstack(NULL, _worker_thread, NULL)))
+			/* Running with fewer workers is fine */
+			return _poll_workers ? 0 : ret;
+
+	if (!_poll_running) {
+		if ((ret = _pthread_create_smallstack(NULL, _poll_thread, NULL)))
+			return ret;
+		_poll_running = 1;
+	}
+
+	return 0;
+}
+
 /* Create a device monitoring thread. */
 static int _create_thread(struct thread_status *thread)
 {
+	if (_use_poll) {
+		/* Registration is finished by a poll mode worker */
+		thread->processing = 0;
+		return _start_poll();
+	}
+
 	return _pthread_create_smallstack(&thread->thread, _monitor_thread, thread);
 }
 
@@ -1094,8 +1466,13 @@ static int _update_events(struct thread_status *thread, int events)
 	thread->events = events;
 	thread->pending = DM_EVENT_REGISTRATION_PENDING;
 
-	/* Only non-processing threads can be notified */
-	if (!thread->processing) {
+	if (_use_poll) {
+		/* Workers pick up the new filter with the next event */
+		if (thread->events && !thread->processing &&
+		    (thread->status == DM_THREAD_RUNNING))
+			thread->pending = 0;
+	} else if (!thread->processing) {
+		/* Only non-processing threads can be notified */
 		DEBUGLOG("Sending SIGALRM to wakeup Thr %x.", (int)thread->thread);
 
 		/* Notify thread waiting in ioctl (to speed-up) */
@@ -1109,8 +1486,11 @@ static int _update_events(struct thread_status *thread, int events)
 	}
 
 	/* Threads with no events has to be moved to unused */
-	if (!thread->events)
+	if (!thread->events) {
 		_thread_unused(thread);
+		if (_use_poll)
+			_queue_work(thread);
+	}
 
 	return -ret;
 }
@@ -1204,6 +1584,8 @@ static int _register_for_event(struct message_data *message_data)
 		_lock_mutex();
 		/* Note: same uuid can't be added in parallel */
 		LINK_THREAD(thread);
+		if (_use_poll)
+			_queue_work(thread);
 	}
 
 	_unlock_mutex();
@@ -1472,8 +1854,7 @@ fail:
  * Read message from client making sure that data is available
  * and a complete message is read.  Must not block indefinitely.
  */
-static int _client_read(struct dm_event_fifos *fifos,
-			struct dm_event_daemon_message *msg)
+static int _client_read(int fd, struct dm_event_daemon_message *msg)
 {
 	struct timeval t;
 	unsigned bytes = 0;
@@ -1489,10 +1870,10 @@ static int _client_read(struct dm_event_fifos *fifos,
 	while (bytes < size && errno != EOF) {
 		/* Watch client read FIFO for input. */
 		FD_ZERO(&fds);
-		FD_SET(fifos->client, &fds);
+		FD_SET(fd, &fds);
 		t.tv_sec = 1;
 		t.tv_usec = 0;
-		ret = select(fifos->client + 1, &fds, NULL, NULL, &t);
+		ret = select(fd + 1, &fds, NULL, NULL, &t);
 
 		if (!ret && bytes)
 			continue; /* trying to finish read */
@@ -1500,7 +1881,8 @@ static int _client_read(struct dm_event_fifos *fifos,
 		if (ret <= 0)	/* nothing to read */
 			goto bad;
 
-		ret = read(fifos->client, buf + bytes, size - bytes);
+		if (!(ret = read(fd, buf + bytes, size - bytes)))
+			goto bad; /* Socket client went away */
 		bytes += ret > 0 ? ret : 0;
 		if (!msg->data && (bytes == 2 * sizeof(uint32_t))) {
 			msg->cmd = ntohl(header[0]);
@@ -1527,8 +1909,7 @@ bad:
 /*
  * Write a message to the client making sure that it is ready to write.
  */
-static int _client_write(struct dm_event_fifos *fifos,
-			struct dm_event_daemon_message *msg)
+static int _client_write(int fd, struct dm_event_daemon_message *msg)
 {
 	uint32_t temp[2];
 	unsigned bytes = 0;
@@ -1556,12 +1937,12 @@ static int _client_write(struct dm_event_fifos *fifos,
 		do {
 			/* Watch client write FIFO to be ready for output. */
 			FD_ZERO(&fds);
-			FD_SET(fifos->server, &fds);
-		} while (select(fifos->server + 1, NULL, &fds, NULL, NULL) != 1);
+			FD_SET(fd, &fds);
+		} while (select(fd + 1, NULL, &fds, NULL, NULL) != 1);
 
-		if ((ret = write(fifos->server, buf + bytes, size - bytes)) > 0)
+		if ((ret = write(fd, buf + bytes, size - bytes)) > 0)
 			bytes += ret;
-		else if (errno == EIO)
+		else if ((errno == EIO) || (errno == EPIPE))
 			break;
 	}
 
@@ -1571,6 +1952,56 @@ static int _client_write(struct dm_event_fifos *fifos,
 	return (bytes == size);
 }
 
+/*
+ * (Un)register each device of a ',' separated uuid list.
+ * Reply lists the error code of every device in the given order.
+ */
+static int _for_each_device(struct message_data *message_data,
+			    int (*fn)(struct message_data *))
+{
+	struct dm_event_daemon_message *msg = message_data->msg;
+	char *uuids = message_data->device_uuid, *uuid, *next;
+	char *reply, *pos;
+	size_t size;
+	int r, ret = 0;
+
+	if (!uuids)
+		return -EINVAL;
+
+	/* id + one ' ' and errno per device */
+	size = strlen(message_data->id) + 1;
+	for (next = uuids; next; next = strchr(next + 1, ','))
+		size += 12;
+
+	if (!(reply = malloc(size)))
+		return -ENOMEM;
+
+	pos = reply + sprintf(reply, "%s", message_data->id);
+
+	for (uuid = uuids; uuid; uuid = next) {
+		if ((next = strchr(uuid, ',')))
+			*next++ = '\0';
+
+		message_data->device_uuid = uuid;
+		if ((r = fn(message_data))) {
+			if (r > 0)
+				r = -r;
+			if (!ret)
+				ret = r;
+			DEBUGLOG("%s %s failed: %s.", decode_cmd(msg->cmd), uuid, strerror(-r));
+		}
+		pos += sprintf(pos, " %d", -r);
+	}
+
+	message_data->device_uuid = uuids;
+
+	free(msg->data);
+	msg->data = reply;
+	msg->size = pos - reply + 1;
+
+	return ret;
+}
+
 /*
  * Handle a client request.
  *
@@ -1608,6 +2039,12 @@ static int _handle_request(struct dm_event_daemon_message *msg,
 	 */
 	case DM_EVENT_CMD_GET_PARAMETERS:
 		return _get_parameters(message_data);
+	case DM_EVENT_CMD_REGISTER_FOR_EVENTS:
+		if (!message_data->events_field)
+			return -EINVAL;
+		return _for_each_device(message_data, _register_for_event);
+	case DM_EVENT_CMD_UNREGISTER_FOR_EVENTS:
+		return _for_each_device(message_data, _unregister_for_event);
 	default:
 		return -EINVAL;
 	}
@@ -1620,6 +2057,8 @@ static int _do_process_request(struct dm_event_daemon_message *msg)
 	char *answer;
 	struct message_data message_data = { .msg =  msg };
 
+	pthread_mutex_lock(&_request_mutex);
+
 	/* Parse the message. */
 	if (msg->cmd == DM_EVENT_CMD_HELLO || msg->cmd == DM_EVENT_CMD_DIE)  {
 		ret = 0;
@@ -1642,11 +2081,16 @@ static int _do_process_request(struct dm_event_daemon_message *msg)
 
 	_free_message(&message_data);
 
+	pthread_mutex_unlock(&_request_mutex);
+
 	return ret;
 }
 
-/* Only one caller at a time. */
-static void _process_request(struct dm_event_fifos *fifos)
+/*
+ * Only one caller at a time for each pair of descriptors.
+ * Returns 0 when no request was read.
+ */
+static int _process_request(int in, int out)
 {
 	struct dm_event_daemon_message msg = { 0 };
 	int cmd;
@@ -1654,8 +2098,8 @@ static void _process_request(struct dm_event_fifos *fifos)
 	 * Read the request from the client (client_read, client_write
 	 * give true on success and false on failure).
 	 */
-	if (!_client_read(fifos, &msg))
-		return;
+	if (!_client_read(in, &msg))
+		return 0;
 
 	cmd = msg.cmd;
 
@@ -1665,7 +2109,7 @@ static void _process_request(struct dm_event_fifos *fifos)
 	   data, otherwise just cmd and size = 0) */
 	_do_process_request(&msg);
 
-	if (!_client_write(fifos, &msg))
+	if (!_client_write(out, &msg))
 		stack;
 
 	DEBUGLOG("<<< CMD:%s (0x%x) completed (result %d).", decode_cmd(cmd), cmd, msg.cmd);
@@ -1677,6 +2121,113 @@ static void _process_request(struct dm_event_fifos *fifos)
 			log_sys_error("unlink", DMEVENTD_PIDFILE);
 		_exit(0);
 	}
+
+	return 1;
+}
+
+/* Serve requests of one DM_EVENT_SOCKET client until it disconnects. */
+static void *_socket_client_thread(void *arg)
+{
+	struct pollfd pfd = { .fd = (int) (long) arg, .events = POLLIN };
+
+	while ((poll(&pfd, 1, DMEVENTD_SOCKET_IDLE_TIMEOUT * 1000) > 0) &&
+	       _process_request(pfd.fd, pfd.fd))
+		;
+
+	if (close(pfd.fd))
+		log_sys_debug("close", DM_EVENT_SOCKET);
+
+	return NULL;
+}
+
+/* Accept socket clients, each one served by its own thread. */
+static void *_socket_thread(void *unused __attribute__((unused)))
+{
+	int fd;
+
+	for (;;) {
+		if ((fd = accept4(_socket_fd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+			if ((errno != EINTR) && (errno != ECONNABORTED)) {
+				log_sys_error("accept", DM_EVENT_SOCKET);
+				sleep(1);
+			}
+			continue;
+		}
+
+		if (_pthread_create_smallstack(NULL, _socket_client_thread, (void *) (long) fd)) {
+			log_error("Failed to create thread for socket client.");
+			if (close(fd))
+				log_sys_debug("close", DM_EVENT_SOCKET);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Listen on DM_EVENT_SOCKET next to the fifos.
+ * Failure is not fatal, clients fall back to the fifos.
+ */
+static void _open_socket(void)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	struct stat st;
+
+	if (!dm_strncpy(sa.sun_path, DM_EVENT_SOCKET, sizeof(sa.sun_path))) {
+		log_error("Socket path %s is too long.", DM_EVENT_SOCKET);
+		return;
+	}
+
+	/* Only replace a stale socket */
+	if (!lstat(DM_EVENT_SOCKET, &st)) {
+		if (!S_ISSOCK(st.st_mode)) {
+			log_error("%s is not a socket.", DM_EVENT_SOCKET);
+			return;
+		}
+		if (unlink(DM_EVENT_SOCKET)) {
+			log_sys_error("unlink", DM_EVENT_SOCKET);
+			return;
+		}
+	}
+
+	if ((_socket_fd = socket(PF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+		log_sys_error("socket", DM_EVENT_SOCKET);
+		return;
+	}
+
+	(void) dm_prepare_selinux_context(DM_EVENT_SOCKET, S_IFSOCK);
+	if (bind(_socket_fd, (struct sockaddr *) &sa, sizeof(sa))) {
+		log_sys_error("bind", DM_EVENT_SOCKET);
+		(void) dm_prepare_selinux_context(NULL, 0);
+		goto bad;
+	}
+	(void) dm_prepare_selinux_context(NULL, 0);
+
+	/* Same access rights as the fifos */
+	if (chmod(DM_EVENT_SOCKET, 0600)) {
+		log_sys_error("chmod", DM_EVENT_SOCKET);
+		goto bad_unlink;
+	}
+
+	if (listen(_socket_fd, 64)) {
+		log_sys_error("listen", DM_EVENT_SOCKET);
+		goto bad_unlink;
+	}
+
+	if (_pthread_create_smallstack(NULL, _socket_thread, NULL)) {
+		log_error("Failed to create socket thread.");
+		goto bad_unlink;
+	}
+
+	return;
+
+bad_unlink:
+	if (unlink(DM_EVENT_SOCKET))
+		log_sys_debug("unlink", DM_EVENT_SOCKET);
+bad:
+	if (close(_socket_fd))
+		log_sys_debug("close", DM_EVENT_SOCKET);
+	_socket_fd = -1;
 }
 
 static void _process_initial_registrations(void)
@@ -1708,6 +2259,12 @@ static void _cleanup_unused_threads(void)
 			if (thread->processing)
 				break; /* cleanup on the next round */
 
+			if (_use_poll) {
+				/* Worker unregisters it */
+				_queue_work(thread);
+				break;
+			}
+
 			/* Signal possibly sleeping thread */
 			ret = pthread_kill(thread->thread, SIGALRM);
 			if (!ret || (ret != ESRCH))
@@ -1721,7 +2278,7 @@ static void _cleanup_unused_threads(void)
 
 		DEBUGLOG("Destroying Thr %x.", (int)thread->thread);
 
-		if (pthread_join(thread->thread, NULL))
+		if (!_use_poll && pthread_join(thread->thread, NULL))
 			log_sys_error("pthread_join", "");
 
 		_free_thread_status(thread);
@@ -1896,6 +2453,9 @@ static void _remove_files_on_exit(void)
 		if (unlink(DM_EVENT_FIFO_SERVER))
 			log_sys_error("unlink", DM_EVENT_FIFO_SERVER);
 	}
+
+	if ((_socket_fd >= 0) && unlink(DM_EVENT_SOCKET))
+		log_sys_error("unlink", DM_EVENT_SOCKET);
 }
 
 static void _daemonize(void)
@@ -2145,11 +2705,12 @@ bad:
 static void _usage(char *prog, FILE *file)
 {
 	fprintf(file, "Usage:\n"
-		"%s [-d [-d [-d]]] [-f] [-h] [-l] [-R] [-V] [-?]\n\n"
+		"%s [-d [-d [-d]]] [-f] [-h] [-l] [-p] [-R] [-V] [-?]\n\n"
 		"   -d       Log debug messages to syslog (-d, -dd, -ddd)\n"
 		"   -f       Don't fork, run in the foreground\n"
 		"   -h       Show this help information\n"
 		"   -l       Log to stdout,stderr instead of syslog\n"
+		"   -p       Monitor devices from one poll loop\n"
 		"   -?       Show this help information on stderr\n"
 		"   -R       Restart dmeventd\n"
 		"   -V       Show version of dmeventd\n\n", prog);
@@ -2168,7 +2729,7 @@ int main(int argc, char *argv[])
 	opterr = 0;
 	optind = 0;
 
-	while ((opt = getopt(argc, argv, "?fhVdlR")) != EOF) {
+	while ((opt = getopt(argc, argv, "?fhVdlpR")) != EOF) {
 		switch (opt) {
 		case 'h':
 			_usage(argv[0], stdout);
@@ -2188,6 +2749,9 @@ int main(int argc, char *argv[])
 		case 'l':
 			_use_syslog = 0;
 			break;
+		case 'p':
+			_use_poll = 1;
+			break;
 		case 'V':
 			printf("dmeventd version: %s\n", DM_LIB_VERSION);
 			exit(EXIT_SUCCESS);
@@ -2246,9 +2810,14 @@ int main(int argc, char *argv[])
 	if (pthread_mutex_init(&_global_mutex, NULL))
 		exit(EXIT_FAILURE);
 
+	if (_use_poll)
+		_init_poll();
+
 	if (!_systemd_activation && !_open_fifos(&fifos))
 		exit(EXIT_FIFO_FAILURE);
 
+	_open_socket();
+
 	/* Signal parent, letting them know we are ready to go. */
 	if (!_foreground)
 		kill(getppid(), SIGTERM);
@@ -2290,7 +2859,7 @@ int main(int argc, char *argv[])
 			 */
 			log_info("dmeventd received break, scheduling exit.");
 		}
-		_process_request(&fifos);
+		_process_request(fifos.client, fifos.server);
 		_cleanup_unused_threads();
 	}
 
@@ -19,6 +19,8 @@
 
 #define	DM_EVENT_FIFO_CLIENT	DEFAULT_DM_RUN_DIR "/dmeventd-client"
 #define	DM_EVENT_FIFO_SERVER	DEFAULT_DM_RUN_DIR "/dmeventd-server"
+/* Concurrent clients, same message format as the fifos */
+#define	DM_EVENT_SOCKET		DEFAULT_DM_RUN_DIR "/dmeventd-socket"
 
 #define DM_EVENT_DEFAULT_TIMEOUT 10
 
@@ -35,6 +37,9 @@ enum dm_event_command {
 	DM_EVENT_CMD_DIE,
 	DM_EVENT_CMD_GET_STATUS,
 	DM_EVENT_CMD_GET_PARAMETERS,
+	/* Device uuid field is a ',' separated list of uuids */
+	DM_EVENT_CMD_REGISTER_FOR_EVENTS,
+	DM_EVENT_CMD_UNREGISTER_FOR_EVENTS,
 };
 
 /* Message passed between client and daemon. */
@@ -46,7 +51,8 @@ struct dm_event_daemon_message {
 
 /* FIXME Is this meant to be exported?  I can't see where the
    interface uses it. */
-/* Fifos for client/daemon communication. */
+/* Fifos for client/daemon communication.
+ * Connected to DM_EVENT_SOCKET both client and server are the socket. */
 struct dm_event_fifos {
 	int client;
 	int server;
@@ -21,8 +21,10 @@
 
 #include <fcntl.h>
 #include <sys/file.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <arpa/inet.h>		/* for htonl, ntohl */
 #include <pthread.h>
@@ -258,6 +260,12 @@ static int _daemon_read(struct dm_event_fifos *fifos,
 			goto bad;
 		}
 
+		if (!ret) {
+			/* Only a socket can see the end of file */
+			log_error("Event server closed connection.");
+			goto bad;
+		}
+
 		bytes += ret;
 		if (!msg->data && (bytes == 2 * sizeof(uint32_t))) {
 			msg->cmd = ntohl(header[0]);
@@ -531,17 +539,59 @@ bad:
 	return 0;
 }
 
+/*
+ * Connect to the socket of a running dmeventd, which serves
+ * clients concurrently instead of one at a time over the fifos.
+ */
+static int _init_socket(struct dm_event_fifos *fifos)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (!dm_strncpy(sa.sun_path, DM_EVENT_SOCKET, sizeof(sa.sun_path)))
+		return 0;
+
+	if ((fd = socket(PF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+		log_sys_debug("socket", DM_EVENT_SOCKET);
+		return 0;
+	}
+
+	if (connect(fd, (struct sockaddr *) &sa, sizeof(sa))) {
+		if (close(fd))
+			log_sys_debug("close", DM_EVENT_SOCKET);
+		return 0;
+	}
+
+	fifos->client = fifos->server = fd;
+
+	return 1;
+}
+
 /* Initialize client. */
 static int _init_client(char *dmeventd_path, struct dm_event_fifos *fifos)
 {
+	if (_init_socket(fifos))
+		return 1;
+
 	if (!_start_daemon(dmeventd_path, fifos))
 		return_0;
 
+	/* Freshly started dmeventd listens on its socket as well */
+	if (_init_socket(fifos))
+		return 1;
+
 	return init_fifos(fifos);
 }
 
 void fini_fifos(struct dm_event_fifos *fifos)
 {
+	if ((fifos->client >= 0) && (fifos->client == fifos->server)) {
+		if (close(fifos->client))
+			log_sys_debug("close", DM_EVENT_SOCKET);
+		fifos->client = fifos->server = -1;
+		return;
+	}
+
 	if (fifos->client >= 0 && close(fifos->client))
 		log_sys_debug("close", fifos->client_path);
 
@@ -641,6 +691,16 @@ out:
 	return ret;
 }
 
+static void _check_dso(const char *dso)
+{
+	if (!strstr(dso, "libdevmapper-event-lvm2thin.so") &&
+	    !strstr(dso, "libdevmapper-event-lvm2vdo.so") &&
+	    !strstr(dso, "libdevmapper-event-lvm2snapshot.so") &&
+	    !strstr(dso, "libdevmapper-event-lvm2mirror.so") &&
+	    !strstr(dso, "libdevmapper-event-lvm2raid.so"))
+		log_warn("WARNING: %s: dmeventd plugins are deprecated.", dso);
+}
+
 /* External library interface. */
 int dm_event_register_handler(const struct dm_event_handler *dmevh)
 {
@@ -654,13 +714,7 @@ int dm_event_register_handler(const struct dm_event_handler *dmevh)
 
 	uuid = dm_task_get_uuid(dmt);
 
-	if (!strstr(dmevh->dso, "libdevmapper-event-lvm2thin.so") &&
-	    !strstr(dmevh->dso, "libdevmapper-event-lvm2vdo.so") &&
-	    !strstr(dmevh->dso, "libdevmapper-event-lvm2snapshot.so") &&
-	    !strstr(dmevh->dso, "libdevmapper-event-lvm2mirror.so") &&
-	    !strstr(dmevh->dso, "libdevmapper-event-lvm2raid.so"))
-		log_warn("WARNING: %s: dmeventd plugins are deprecated.", dmevh->dso);
-
+	_check_dso(dmevh->dso);
 
 	if ((err = _do_event(DM_EVENT_CMD_REGISTER_FOR_EVENT, dmevh->dmeventd_path, &msg,
 			     dmevh->dso, uuid, dmevh->mask, dmevh->timeout)) < 0) {
@@ -704,6 +758,125 @@ int dm_event_unregister_handler(const struct dm_event_handler *dmevh)
 	return ret;
 }
 
+/*
+ * Send devices of all handlers in one batch request, uuids joined by ','.
+ * Reply carries the error code of each device.  Devices which cannot be
+ * batched, or all of them with an older dmeventd, go one at a time.
+ */
+static int _do_handlers(int cmd, struct dm_event_handler **dmevhs, unsigned count)
+{
+	int (*single)(const struct dm_event_handler *) =
+		(cmd == DM_EVENT_CMD_REGISTER_FOR_EVENTS) ?
+		dm_event_register_handler : dm_event_unregister_handler;
+	const char *what = (cmd == DM_EVENT_CMD_REGISTER_FOR_EVENTS) ?
+		"registration" : "deregistration";
+	struct dm_event_daemon_message msg = { 0 };
+	struct dm_task **dmts;
+	const char *uuid;
+	char *uuids = NULL, *pos, *end;
+	size_t len = 0;
+	unsigned i, n = 0;
+	long *errs;
+	int ret = 1, err;
+
+	if (!count)
+		return 1;
+
+	if (!(dmts = zalloc(count * (sizeof(*dmts) + sizeof(*errs))))) {
+		log_error("Failed to allocate device tasks.");
+		return 0;
+	}
+	errs = (long *) (dmts + count);
+
+	for (i = 0; i < count; i++) {
+		if (!(dmts[i] = _get_device_info(dmevhs[i]))) {
+			ret = 0;
+			continue;
+		}
+
+		uuid = dm_task_get_uuid(dmts[i]);
+		if (!*uuid || strchr(uuid, ',')) {
+			dm_task_destroy(dmts[i]);
+			dmts[i] = NULL;
+			if (!single(dmevhs[i]))
+				ret = 0;
+			continue;
+		}
+
+		len += strlen(uuid) + 1;
+		n++;
+	}
+
+	if (!n)
+		goto out;
+
+	if (!(uuids = pos = malloc(len))) {
+		log_error("Failed to allocate device list.");
+		ret = 0;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++)
+		if (dmts[i])
+			pos += sprintf(pos, "%s%s", (pos == uuids) ? "" : ",",
+				       dm_task_get_uuid(dmts[i]));
+
+	if (cmd == DM_EVENT_CMD_REGISTER_FOR_EVENTS)
+		_check_dso(dmevhs[0]->dso);
+
+	err = _do_event(cmd, dmevhs[0]->dmeventd_path, &msg, dmevhs[0]->dso,
+			uuids, dmevhs[0]->mask, dmevhs[0]->timeout);
+
+	/* Reply is the 'pid:seq' id followed by an errno for each device */
+	if ((pos = msg.data ? strchr(msg.data, ' ') : NULL))
+		for (i = 0; pos && (i < count); i++)
+			if (dmts[i]) {
+				errs[i] = strtol(pos, &end, 10);
+				pos = (end == pos) ? NULL : end;
+			}
+
+	if (!pos) {
+		if (err == -EINVAL) {
+			/* Older dmeventd without batches */
+			for (i = 0; i < count; i++)
+				if (dmts[i] && !single(dmevhs[i]))
+					ret = 0;
+		} else {
+			log_error("Event %s of %u devices failed: %s.", what, n,
+				  msg.data ? msg.data : strerror(-err));
+			ret = 0;
+		}
+		goto out;
+	}
+
+	for (i = 0; i < count; i++)
+		if (dmts[i] && errs[i]) {
+			log_error("%s: event %s failed: %s.",
+				  dm_task_get_name(dmts[i]), what, strerror(errs[i]));
+			ret = 0;
+		}
+out:
+	free(msg.data);
+	free(uuids);
+
+	for (i = 0; i < count; i++)
+		if (dmts[i])
+			dm_task_destroy(dmts[i]);
+	free(dmts);
+
+	return ret;
+}
+
+int dm_event_register_handlers(struct dm_event_handler **dmevhs, unsigned count)
+{
+	return _do_handlers(DM_EVENT_CMD_REGISTER_FOR_EVENTS, dmevhs, count);
+}
+
+int dm_event_unregister_handlers(struct dm_event_handler **dmevhs, unsigned count)
+{
+	return _do_handlers(DM_EVENT_CMD_UNREGISTER_FOR_EVENTS, dmevhs, count);
+}
+
 /* Fetch a string off src and duplicate it into *dest. */
 /* FIXME: move to separate module to share with the daemon. */
 static char *_fetch_string(char **src, const int delimiter)
@@ -106,6 +106,15 @@ int dm_event_get_registered_device(struct dm_event_handler *dmevh, int next);
 int dm_event_register_handler(const struct dm_event_handler *dmevh);
 int dm_event_unregister_handler(const struct dm_event_handler *dmevh);
 
+/*
+ * (Un)register devices of all handlers with a single request.
+ * Handlers must share dso, event mask, timeout and dmeventd path.
+ * With an older dmeventd each handler is sent on its own.
+ * Returns 1 only when all devices succeeded.
+ */
+int dm_event_register_handlers(struct dm_event_handler **dmevhs, unsigned count);
+int dm_event_unregister_handlers(struct dm_event_handler **dmevhs, unsigned count);
+
 /* Set debug level for logging, and whether to log on stdout/stderr or syslog */
 void dm_event_log_set(int debug_log_level, int use_syslog);
 
@@ -132,5 +141,7 @@ void process_event(struct dm_task *dmt, enum dm_event_mask evmask, void **user);
 int register_device(const char *device_name, const char *uuid, int major, int minor, void **user);
 int unregister_device(const char *device_name, const char *uuid, int major,
 		      int minor, void **user);
+/* Optional, returns a dm_percent_t */
+int32_t get_usage(void **user);
 
 #endif
@@ -49,11 +49,18 @@ static void _lvm2_print_log(int level, const char *file, int line,
 
 /*
  * Currently only one event can be processed at a time.
+ * liblvm2cmd keeps the list of devices and parsed metadata between
+ * commands run through the handle, so queued commands do not redo a
+ * cold scan; they still read labels and metadata headers again.
  */
 static pthread_mutex_t _event_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 void dmeventd_lvm2_lock(void)
 {
+	if (!pthread_mutex_trylock(&_event_mutex))
+		return;
+
+	log_debug("Waiting for lvm command of another event.");
 	pthread_mutex_lock(&_event_mutex);
 }
 
@@ -87,6 +94,8 @@ int dmeventd_lvm2_init(void)
 		lvm2_disable_dmeventd_monitoring(_lvm_handle);
 		/* FIXME Temporary: move to dmeventd core */
 		lvm2_run(_lvm_handle, "_memlock_inc");
+		/* List devices now rather than when the first event needs them */
+		lvm2_run(_lvm_handle, "_dev_cache_scan");
 		log_debug("lvm plugin initilized.");
 	}
 
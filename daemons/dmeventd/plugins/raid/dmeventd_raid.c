@@ -17,12 +17,17 @@
 #include "daemons/dmeventd/libdevmapper-event.h"
 #include "lib/config/defaults.h"
 
+#include <pthread.h>
+
 /* Hold enough elements for the mximum number of RAID images */
 #define	RAID_DEVS_ELEMS	((DEFAULT_RAID_MAX_IMAGES + 63) / 64)
 
 struct dso_state {
 	struct dm_pool *mem;
 	char cmd_lvconvert[512];
+	const char *vg_lv;		/* 'vg/lv' at the end of cmd_lvconvert */
+	struct dm_list batch_list;	/* Link in _batch_registry */
+	int batch_fails;		/* Result when repaired with another LV */
 	uint64_t raid_devs[RAID_DEVS_ELEMS];
 	int failed;
 	int warned;
@@ -30,6 +35,86 @@ struct dso_state {
 
 DM_EVENT_LOG_FN("raid")
 
+/*
+ * RAID LVs waiting for the lvm2 lock to be repaired.  A failed PV
+ * usually hits many LVs at once; whoever gets the lock first repairs
+ * all queued LVs of its VG with a single lvconvert.
+ */
+static pthread_mutex_t _batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DM_LIST_INIT(_batch_registry);
+
+/* Can st be repaired together with state within one lvconvert? */
+static int _same_batch(const struct dso_state *state, const struct dso_state *st)
+{
+	size_t len = strchr(state->vg_lv, '/') - state->cmd_lvconvert + 1; /* 'cmd vg/' */
+
+	return ((size_t) (st->vg_lv - st->cmd_lvconvert) == (size_t) (state->vg_lv - state->cmd_lvconvert)) &&
+		!strncmp(state->cmd_lvconvert, st->cmd_lvconvert, len);
+}
+
+static int _run_batched(struct dso_state *state)
+{
+	char cmd_str[4096];
+	struct dso_state *st, *tmp;
+	struct dm_list served;
+	size_t len;
+	int r;
+
+	if (!state->vg_lv)
+		return dmeventd_lvm2_run_with_lock(state->cmd_lvconvert);
+
+	dm_list_init(&served);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_add(&_batch_registry, &state->batch_list);
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_lock();
+	pthread_mutex_lock(&_batch_mutex);
+
+	if (dm_list_empty(&state->batch_list)) {
+		/* Repaired meanwhile together with another LV */
+		r = !state->batch_fails;
+		pthread_mutex_unlock(&_batch_mutex);
+		dmeventd_lvm2_unlock();
+		return r;
+	}
+
+	len = strlen(state->cmd_lvconvert);
+	memcpy(cmd_str, state->cmd_lvconvert, len + 1);
+
+	dm_list_move(&served, &state->batch_list);
+
+	dm_list_iterate_items_gen_safe(st, tmp, &_batch_registry, batch_list)
+		if (_same_batch(state, st) &&
+		    (len + strlen(st->vg_lv) + 1 < sizeof(cmd_str))) {
+			cmd_str[len++] = ' ';
+			strcpy(cmd_str + len, st->vg_lv);
+			len += strlen(st->vg_lv);
+			dm_list_move(&served, &st->batch_list);
+		}
+
+	pthread_mutex_unlock(&_batch_mutex);
+
+	if (dm_list_size(&served) > 1)
+		log_debug("Repairing %u RAID devices with one command.",
+			  dm_list_size(&served));
+
+	r = dmeventd_lvm2_run(cmd_str);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_iterate_items_gen_safe(st, tmp, &served, batch_list) {
+		dm_list_del(&st->batch_list);
+		dm_list_init(&st->batch_list);
+		st->batch_fails = !r;
+	}
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_unlock();
+
+	return r;
+}
+
 /* FIXME Reformat to 80 char lines. */
 
 static int _process_raid_event(struct dso_state *state, char *params, const char *device)
@@ -95,7 +180,7 @@ static int _process_raid_event(struct dso_state *state, char *params, const char
 		state->failed = 1;
 
 		/* if repair goes OK, report success even if lvscan has failed */
-		if (!dmeventd_lvm2_run_with_lock(state->cmd_lvconvert)) {
+		if (!_run_batched(state)) {
 			log_error("Repair of RAID device %s failed.", device);
 			r = 0;
 		}
@@ -151,6 +236,7 @@ int register_device(const char *device,
 		    void **user)
 {
 	struct dso_state *state;
+	char *str;
 
 	if (!dmeventd_lvm2_init_with_pool("raid_state", state))
 		goto_bad;
@@ -159,6 +245,11 @@ int register_device(const char *device,
 				   "lvconvert --repair --use-policies", device))
 		goto_bad;
 
+	/* Find last space before 'vg/lv' */
+	if ((str = strrchr(state->cmd_lvconvert, ' ')) && strchr(str, '/'))
+		state->vg_lv = str + 1;
+
+	dm_list_init(&state->batch_list);
 	*user = state;
 
 	log_info("Monitoring RAID device %s for events.", device);
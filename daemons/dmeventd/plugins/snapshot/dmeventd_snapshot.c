@@ -34,11 +34,24 @@ struct dso_state {
 	struct dm_pool *mem;
 	dm_percent_t percent_check;
 	uint64_t known_size;
+	dm_percent_t usage;	/* For get_usage() */
 	char cmd_lvextend[512];
+	const char *vg_lv;		/* 'vg/lv' at the end of cmd_lvextend */
+	struct dm_list batch_list;	/* Link in _batch_registry */
+	int batch_fails;		/* Result when extended with another snapshot */
+	char last_status[64];		/* Status seen by the previous check */
 };
 
 DM_EVENT_LOG_FN("snap")
 
+/*
+ * Snapshots waiting for the lvm2 lock to be extended.  Backup hosts
+ * often fill many snapshots at once; whoever gets the lock first
+ * extends all queued snapshots of its VG with a single lvextend.
+ */
+static pthread_mutex_t _batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DM_LIST_INIT(_batch_registry);
+
 static int _run(const char *cmd, ...)
 {
         va_list ap;
@@ -80,10 +93,76 @@ static int _run(const char *cmd, ...)
         return 1; /* all good */
 }
 
-static int _extend(const char *cmd)
+/* Can st be extended together with state within one lvextend? */
+static int _same_batch(const struct dso_state *state, const struct dso_state *st)
+{
+	size_t len = strchr(state->vg_lv, '/') - state->cmd_lvextend + 1; /* 'cmd vg/' */
+
+	return ((size_t) (st->vg_lv - st->cmd_lvextend) == (size_t) (state->vg_lv - state->cmd_lvextend)) &&
+		!strncmp(state->cmd_lvextend, st->cmd_lvextend, len);
+}
+
+static int _extend(struct dso_state *state)
 {
-	log_debug("Extending snapshot via %s.", cmd);
-	return dmeventd_lvm2_run_with_lock(cmd);
+	char cmd_str[4096];
+	struct dso_state *st, *tmp;
+	struct dm_list served;
+	size_t len;
+	int r;
+
+	if (!state->vg_lv) {
+		log_debug("Extending snapshot via %s.", state->cmd_lvextend);
+		return dmeventd_lvm2_run_with_lock(state->cmd_lvextend);
+	}
+
+	dm_list_init(&served);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_add(&_batch_registry, &state->batch_list);
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_lock();
+	pthread_mutex_lock(&_batch_mutex);
+
+	if (dm_list_empty(&state->batch_list)) {
+		/* Extended meanwhile together with another snapshot */
+		r = !state->batch_fails;
+		pthread_mutex_unlock(&_batch_mutex);
+		dmeventd_lvm2_unlock();
+		return r;
+	}
+
+	len = strlen(state->cmd_lvextend);
+	memcpy(cmd_str, state->cmd_lvextend, len + 1);
+
+	dm_list_move(&served, &state->batch_list);
+
+	dm_list_iterate_items_gen_safe(st, tmp, &_batch_registry, batch_list)
+		if (_same_batch(state, st) &&
+		    (len + strlen(st->vg_lv) + 1 < sizeof(cmd_str))) {
+			cmd_str[len++] = ' ';
+			strcpy(cmd_str + len, st->vg_lv);
+			len += strlen(st->vg_lv);
+			dm_list_move(&served, &st->batch_list);
+		}
+
+	pthread_mutex_unlock(&_batch_mutex);
+
+	log_debug("Extending %u snapshot(s) via %s.", dm_list_size(&served), cmd_str);
+
+	r = dmeventd_lvm2_run(cmd_str);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_iterate_items_gen_safe(st, tmp, &served, batch_list) {
+		dm_list_del(&st->batch_list);
+		dm_list_init(&st->batch_list);
+		st->batch_fails = !r;
+	}
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_unlock();
+
+	return r;
 }
 
 #ifdef SNAPSHOT_REMOVE
@@ -163,7 +242,7 @@ static void _umount(const char *device, int major, int minor)
 }
 
 void process_event(struct dm_task *dmt,
-		   enum dm_event_mask event __attribute__((unused)),
+		   enum dm_event_mask event,
 		   void **user)
 {
 	struct dso_state *state = *user;
@@ -178,15 +257,34 @@ void process_event(struct dm_task *dmt,
 	int ret;
 
 	/* No longer monitoring, waiting for remove */
-	if (!state->percent_check)
+	if (!state->percent_check) {
+		state->usage = DM_PERCENT_INVALID;
 		return;
+	}
 
 	dm_get_next_target(dmt, next, &start, &length, &target_type, &params);
 	if (!target_type || strcmp(target_type, "snapshot")) {
 		log_error("Target %s is not snapshot.", target_type);
+		state->usage = DM_PERCENT_INVALID;
 		return;
 	}
 
+	/*
+	 * COW usage grows without kernel events, so the status is read on
+	 * every timeout.  When it did not change since the previous check
+	 * neither did the outcome, keep the usage and skip the rest.
+	 */
+	if (!(event & DM_EVENT_DEVICE_ERROR) && params &&
+	    !strcmp(params, state->last_status))
+		return;
+
+	state->usage = DM_PERCENT_INVALID;
+
+	if (!params || (strlen(params) >= sizeof(state->last_status)))
+		state->last_status[0] = '\0';
+	else
+		strcpy(state->last_status, params);
+
 	if (!dm_get_status_snapshot(state->mem, params, &status)) {
 		log_error("Cannot parse snapshot %s state: %s.", device, params);
 		return;
@@ -226,7 +324,7 @@ void process_event(struct dm_task *dmt,
 		state->known_size = status->total_sectors;
 	}
 
-	percent = dm_make_percent(status->used_sectors, status->total_sectors);
+	state->usage = percent = dm_make_percent(status->used_sectors, status->total_sectors);
 	if (percent >= state->percent_check) {
 		/* Usage has raised more than CHECK_STEP since the last
 		   time. Run actions. */
@@ -237,13 +335,20 @@ void process_event(struct dm_task *dmt,
 				 device, dm_percent_to_round_float(percent, 2));
 
 		/* Try to extend the snapshot, in accord with user-set policies */
-		if (!_extend(state->cmd_lvextend))
+		if (!_extend(state))
 			log_error("Failed to extend snapshot %s.", device);
 	}
 out:
 	dm_pool_free(state->mem, status);
 }
 
+dm_percent_t get_usage(void **user)
+{
+	struct dso_state *state = *user;
+
+	return state->usage;
+}
+
 int register_device(const char *device,
 		    const char *uuid __attribute__((unused)),
 		    int major __attribute__((unused)),
@@ -251,6 +356,7 @@ int register_device(const char *device,
 		    void **user)
 {
 	struct dso_state *state;
+	char *str;
 
 	if (!dmeventd_lvm2_init_with_pool("snapshot_state", state))
 		goto_bad;
@@ -260,6 +366,11 @@ int register_device(const char *device,
 				   "lvextend --use-policies", device))
 		goto_bad;
 
+	/* Find last space before 'vg/lv' */
+	if ((str = strrchr(state->cmd_lvextend, ' ')) && strchr(str, '/'))
+		state->vg_lv = str + 1;
+
+	dm_list_init(&state->batch_list);
 	state->percent_check = CHECK_MINIMUM;
 	*user = state;
 
@@ -13,11 +13,16 @@
  */
 
 #include "lib/misc/lib.h"
+#include "lib/misc/lvm-string.h"
+#include "lib/uuid/uuid.h"
 #include "daemons/dmeventd/plugins/lvm2/dmeventd_lvm.h"
 #include "daemons/dmeventd/libdevmapper-event.h"
 
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 /* TODO - move this mountinfo code into library to be reusable */
 #ifdef __linux__
@@ -43,6 +48,11 @@
 
 #define THIN_DEBUG 0
 
+/* Usage history read by lvs, format kept in sync with lib/metadata/thin_history.c */
+#define HISTORY_DIR		DEFAULT_RUN_DIR "/thin_history"
+#define HISTORY_INTERVAL	60
+#define HISTORY_SIZE		8192
+
 struct dso_state {
 	struct dm_pool *mem;
 	int metadata_percent_check;
@@ -58,10 +68,24 @@ struct dso_state {
 	pid_t pid;
 	char *argv[3];
 	char *cmd_str;
+	const char *vg_lv;		/* 'vg/lv' at the end of lvm cmd_str */
+	struct dm_list batch_list;	/* Link in _batch_registry */
+	int batch_fails;		/* Result when extended by another pool */
+	int last_metadata_percent;	/* Usage seen by the previous check */
+	int last_data_percent;
+	dm_percent_t usage;		/* For get_usage() */
 };
 
 DM_EVENT_LOG_FN("thin")
 
+/*
+ * Pools waiting for the lvm2 lock to run their policy command.
+ * Whoever gets the lock first extends all queued pools of its VG
+ * with a single lvextend.
+ */
+static pthread_mutex_t _batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DM_LIST_INIT(_batch_registry);
+
 static int _run_command(struct dso_state *state)
 {
 	char val[16];
@@ -106,6 +130,79 @@ static int _run_command(struct dso_state *state)
 	return 1;
 }
 
+/* Can pool st be extended together with state within one lvextend? */
+static int _same_batch(const struct dso_state *state, const struct dso_state *st)
+{
+	size_t len = strchr(state->vg_lv, '/') - state->cmd_str + 1; /* 'cmd vg/' */
+
+	return !strncmp(state->cmd_str, "lvextend ", 9) &&
+		((size_t) (st->vg_lv - st->cmd_str) == (size_t) (state->vg_lv - state->cmd_str)) &&
+		!strncmp(state->cmd_str, st->cmd_str, len);
+}
+
+static int _run_batched(struct dso_state *state)
+{
+	char cmd_str[4096];
+	struct dso_state *st, *tmp;
+	struct dm_list served;
+	size_t len;
+	int r;
+
+	dm_list_init(&served);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_add(&_batch_registry, &state->batch_list);
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_lock();
+	pthread_mutex_lock(&_batch_mutex);
+
+	if (dm_list_empty(&state->batch_list)) {
+		/* Extended meanwhile together with another pool */
+		r = !state->batch_fails;
+		pthread_mutex_unlock(&_batch_mutex);
+		dmeventd_lvm2_unlock();
+		return r;
+	}
+
+	if ((len = strlen(state->cmd_str)) >= sizeof(cmd_str))
+		len = 0; /* Not batching */
+	else
+		memcpy(cmd_str, state->cmd_str, len + 1);
+
+	dm_list_move(&served, &state->batch_list);
+
+	if (len)
+		dm_list_iterate_items_gen_safe(st, tmp, &_batch_registry, batch_list)
+			if (_same_batch(state, st) &&
+			    (len + strlen(st->vg_lv) + 1 < sizeof(cmd_str))) {
+				cmd_str[len++] = ' ';
+				strcpy(cmd_str + len, st->vg_lv);
+				len += strlen(st->vg_lv);
+				dm_list_move(&served, &st->batch_list);
+			}
+
+	pthread_mutex_unlock(&_batch_mutex);
+
+	if (dm_list_size(&served) > 1)
+		log_debug("Extending %u thin pools with one command.",
+			  dm_list_size(&served));
+
+	r = dmeventd_lvm2_run(len ? cmd_str : state->cmd_str);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_iterate_items_gen_safe(st, tmp, &served, batch_list) {
+		dm_list_del(&st->batch_list);
+		dm_list_init(&st->batch_list);
+		st->batch_fails = !r;
+	}
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_unlock();
+
+	return r;
+}
+
 static int _use_policy(struct dm_task *dmt, struct dso_state *state)
 {
 #if THIN_DEBUG
@@ -114,7 +211,7 @@ static int _use_policy(struct dm_task *dmt, struct dso_state *state)
 	if (state->argv[0])
 		return _run_command(state);
 
-	if (!dmeventd_lvm2_run_with_lock(state->cmd_str)) {
+	if (!_run_batched(state)) {
 		log_error("Failed command for %s.", dm_task_get_name(dmt));
 		state->fails = 1;
 		return 0;
@@ -154,6 +251,64 @@ static int _wait_for_pid(struct dso_state *state)
 	return 1;
 }
 
+/*
+ * Usage expected at the next check when the pool keeps filling
+ * at the rate seen since the previous check.  Checks come
+ * periodically, so the next interval is assumed to be similar.
+ */
+static int _projected_percent(int percent, int last_percent)
+{
+	if (!last_percent || (percent <= last_percent))
+		return percent;
+
+	if ((percent - last_percent) >= (DM_PERCENT_100 - percent))
+		return DM_PERCENT_100;
+
+	return 2 * percent - last_percent;
+}
+
+/*
+ * Append a usage sample for lvs to forecast from.  Pool's dm uuid is
+ * "LVM-<lvid>-tpool", the history file is named by the lvid.
+ */
+static void _record_history(const char *uuid, int data_percent, int metadata_percent)
+{
+	char path[PATH_MAX], old_path[PATH_MAX], line[64];
+	time_t now = time(NULL);
+	struct stat st;
+	int fd, len;
+
+	if (!uuid || strncmp(uuid, UUID_PREFIX, sizeof(UUID_PREFIX) - 1) ||
+	    (strlen(uuid) < sizeof(UUID_PREFIX) - 1 + 2 * ID_LEN))
+		return;
+
+	uuid += sizeof(UUID_PREFIX) - 1;
+	if (dm_snprintf(path, sizeof(path), "%s/%.*s", HISTORY_DIR, 2 * ID_LEN, uuid) < 0)
+		return;
+
+	if (!stat(path, &st) && (now >= st.st_mtime) &&
+	    (now - st.st_mtime < HISTORY_INTERVAL))
+		return;
+
+	if ((mkdir(HISTORY_DIR, 0700) < 0) && (errno != EEXIST))
+		return;
+
+	if ((fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0600)) < 0)
+		return;
+
+	len = dm_snprintf(line, sizeof(line), "%llu %d %d\n",
+			  (unsigned long long) now, data_percent, metadata_percent);
+
+	if ((len > 0) && (write(fd, line, len) == len) &&
+	    !fstat(fd, &st) && (st.st_size > HISTORY_SIZE) &&
+	    (dm_snprintf(old_path, sizeof(old_path), "%s.old", path) > 0) &&
+	    rename(path, old_path))
+		log_sys_debug("rename", path);
+
+	if (close(fd))
+		log_sys_debug("close", path);
+}
+
 void process_event(struct dm_task *dmt,
 		   enum dm_event_mask event __attribute__((unused)),
 		   void **user)
@@ -166,6 +321,7 @@ void process_event(struct dm_task *dmt,
 	char *target_type = NULL;
 	char *params;
 	int needs_policy = 0;
+	int projected;
 	struct dm_task *new_dmt = NULL;
 
 #if THIN_DEBUG
@@ -173,6 +329,8 @@ void process_event(struct dm_task *dmt,
 		  dm_percent_to_round_float(state->data_percent_check, 2),
 		  dm_percent_to_round_float(state->metadata_percent_check, 2));
 #endif
+	state->usage = DM_PERCENT_INVALID;
+
 	if (!_wait_for_pid(state)) {
 		log_warn("WARNING: Skipping event, child %d is still running (%s).",
 			 state->pid, state->cmd_str);
@@ -233,12 +391,14 @@ void process_event(struct dm_task *dmt,
 	if (state->known_metadata_size != tps->total_metadata_blocks) {
 		state->metadata_percent_check = CHECK_MINIMUM;
 		state->known_metadata_size = tps->total_metadata_blocks;
+		state->last_metadata_percent = 0;
 		state->fails = 0;
 	}
 
 	if (state->known_data_size != tps->total_data_blocks) {
 		state->data_percent_check = CHECK_MINIMUM;
 		state->known_data_size = tps->total_data_blocks;
+		state->last_data_percent = 0;
 		state->fails = 0;
 	}
 
@@ -247,15 +407,21 @@ void process_event(struct dm_task *dmt,
 	 * Report 80% threshold warning when it's used above 80%.
 	 * Only 100% is exception as it cannot be surpased so policy
 	 * action is called for:  >50%, >55% ... >95%, 100%
+	 * Pools filling fast get it already when the boundary is
+	 * expected to be crossed before the next check.
 	 */
 	state->metadata_percent = dm_make_percent(tps->used_metadata_blocks, tps->total_metadata_blocks);
+	projected = _projected_percent(state->metadata_percent, state->last_metadata_percent);
+	state->last_metadata_percent = state->metadata_percent;
 	if ((state->metadata_percent > WARNING_THRESH) &&
 	    (state->metadata_percent > state->metadata_percent_check))
 		log_warn("WARNING: Thin pool %s metadata is now %.2f%% full.",
 			 device, dm_percent_to_round_float(state->metadata_percent, 2));
+	if ((projected >= DM_PERCENT_100) && (state->metadata_percent < DM_PERCENT_100))
+		log_warn("WARNING: Thin pool %s metadata may get full before the next check.", device);
 	if (state->metadata_percent > CHECK_MINIMUM) {
 		/* Run action when usage raised more than CHECK_STEP since the last time */
-		if (state->metadata_percent > state->metadata_percent_check)
+		if (projected > state->metadata_percent_check)
 			needs_policy = 1;
 		state->metadata_percent_check = (state->metadata_percent / CHECK_STEP + 1) * CHECK_STEP;
 		if (state->metadata_percent_check == DM_PERCENT_100)
@@ -264,13 +430,17 @@ void process_event(struct dm_task *dmt,
 		state->metadata_percent_check = CHECK_MINIMUM;
 
 	state->data_percent = dm_make_percent(tps->used_data_blocks, tps->total_data_blocks);
+	projected = _projected_percent(state->data_percent, state->last_data_percent);
+	state->last_data_percent = state->data_percent;
 	if ((state->data_percent > WARNING_THRESH) &&
 	    (state->data_percent > state->data_percent_check))
 		log_warn("WARNING: Thin pool %s data is now %.2f%% full.",
 			 device, dm_percent_to_round_float(state->data_percent, 2));
+	if ((projected >= DM_PERCENT_100) && (state->data_percent < DM_PERCENT_100))
+		log_warn("WARNING: Thin pool %s data may get full before the next check.", device);
 	if (state->data_percent > CHECK_MINIMUM) {
 		/* Run action when usage raised more than CHECK_STEP since the last time */
-		if (state->data_percent > state->data_percent_check)
+		if (projected > state->data_percent_check)
 			needs_policy = 1;
 		state->data_percent_check = (state->data_percent / CHECK_STEP + 1) * CHECK_STEP;
 		if (state->data_percent_check == DM_PERCENT_100)
@@ -278,6 +448,11 @@ void process_event(struct dm_task *dmt,
 	} else
 		state->data_percent_check = CHECK_MINIMUM;
 
+	state->usage = (state->data_percent > state->metadata_percent) ?
+		state->data_percent : state->metadata_percent;
+
+	_record_history(dm_task_get_uuid(dmt), state->data_percent, state->metadata_percent);
+
 	/* Reduce number of _use_policy() calls by power-of-2 factor till frequency of MAX_FAILS is reached.
 	 * Avoids too high number of error retries, yet shows some status messages in log regularly.
 	 * i.e. PV could have been pvmoved and VG/LV was locked for a while...
@@ -304,6 +479,13 @@ out:
 		dm_task_destroy(new_dmt);
 }
 
+dm_percent_t get_usage(void **user)
+{
+	struct dso_state *state = *user;
+
+	return state->usage;
+}
+
 /* Handle SIGCHLD for a thread */
 static void _sig_child(int signum __attribute__((unused)))
 {
@@ -361,6 +543,12 @@ int register_device(const char *device,
 			log_error("Failed to copy lvm command.");
 			goto bad;
 		}
+
+		/* Find last space before 'vg/lv' */
+		if (!(str = strrchr(state->cmd_str, ' ')) || !strchr(str, '/'))
+			goto inval;
+
+		state->vg_lv = str + 1;
 	} else if (cmd_str[0] == '/') {
 		if (!(state->cmd_str = dm_pool_strdup(state->mem, cmd_str))) {
 			log_error("Failed to copy thin command.");
@@ -383,6 +571,7 @@ int register_device(const char *device,
 		goto inval;
 
 	state->pid = -1;
+	dm_list_init(&state->batch_list);
 	*user = state;
 
 	log_info("Monitoring thin pool %s.", device);
@@ -26,6 +26,7 @@
 
 #include <sys/wait.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 /* First warning when VDO pool is 80% full. */
 #define WARNING_THRESH	(DM_PERCENT_1 * 80)
@@ -51,10 +52,23 @@ struct dso_state {
 	char *argv[3];
 	const char *cmd_str;
 	const char *name;
+	const char *vg_lv;		/* 'vg/lv' at the end of lvm cmd_str */
+	struct dm_list batch_list;	/* Link in _batch_registry */
+	int batch_fails;		/* Result when extended by another pool */
+	int last_percent;		/* Usage seen by the previous check */
+	dm_percent_t usage;	/* For get_usage() */
 };
 
 DM_EVENT_LOG_FN("vdo")
 
+/*
+ * Pools waiting for the lvm2 lock to run their policy command.
+ * Whoever gets the lock first extends all queued pools of its VG
+ * with a single lvextend.
+ */
+static pthread_mutex_t _batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DM_LIST_INIT(_batch_registry);
+
 static int _run_command(struct dso_state *state)
 {
 	char val[16];
@@ -96,6 +110,82 @@ static int _run_command(struct dso_state *state)
 	return 1;
 }
 
+/* Can pool st be extended together with state within one lvextend? */
+static int _same_batch(const struct dso_state *state, const struct dso_state *st)
+{
+	size_t len = strchr(state->vg_lv, '/') - state->cmd_str + 1; /* 'cmd vg/' */
+
+	return !strncmp(state->cmd_str, "lvextend ", 9) &&
+		((size_t) (st->vg_lv - st->cmd_str) == (size_t) (state->vg_lv - state->cmd_str)) &&
+		!strncmp(state->cmd_str, st->cmd_str, len);
+}
+
+static int _run_batched(struct dso_state *state)
+{
+	char cmd_str[4096];
+	struct dso_state *st, *tmp;
+	struct dm_list served;
+	size_t len;
+	int r;
+
+	if (!state->vg_lv)
+		return dmeventd_lvm2_run_with_lock(state->cmd_str);
+
+	dm_list_init(&served);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_add(&_batch_registry, &state->batch_list);
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_lock();
+	pthread_mutex_lock(&_batch_mutex);
+
+	if (dm_list_empty(&state->batch_list)) {
+		/* Extended meanwhile together with another pool */
+		r = !state->batch_fails;
+		pthread_mutex_unlock(&_batch_mutex);
+		dmeventd_lvm2_unlock();
+		return r;
+	}
+
+	if ((len = strlen(state->cmd_str)) >= sizeof(cmd_str))
+		len = 0; /* Not batching */
+	else
+		memcpy(cmd_str, state->cmd_str, len + 1);
+
+	dm_list_move(&served, &state->batch_list);
+
+	if (len)
+		dm_list_iterate_items_gen_safe(st, tmp, &_batch_registry, batch_list)
+			if (_same_batch(state, st) &&
+			    (len + strlen(st->vg_lv) + 1 < sizeof(cmd_str))) {
+				cmd_str[len++] = ' ';
+				strcpy(cmd_str + len, st->vg_lv);
+				len += strlen(st->vg_lv);
+				dm_list_move(&served, &st->batch_list);
+			}
+
+	pthread_mutex_unlock(&_batch_mutex);
+
+	if (dm_list_size(&served) > 1)
+		log_debug("Extending %u VDO pools with one command.",
+			  dm_list_size(&served));
+
+	r = dmeventd_lvm2_run(len ? cmd_str : state->cmd_str);
+
+	pthread_mutex_lock(&_batch_mutex);
+	dm_list_iterate_items_gen_safe(st, tmp, &served, batch_list) {
+		dm_list_del(&st->batch_list);
+		dm_list_init(&st->batch_list);
+		st->batch_fails = !r;
+	}
+	pthread_mutex_unlock(&_batch_mutex);
+
+	dmeventd_lvm2_unlock();
+
+	return r;
+}
+
 static int _use_policy(struct dm_task *dmt, struct dso_state *state)
 {
 #if VDO_DEBUG
@@ -104,7 +194,7 @@ static int _use_policy(struct dm_task *dmt, struct dso_state *state)
 	if (state->argv[0])
 		return _run_command(state);
 
-	if (!dmeventd_lvm2_run_with_lock(state->cmd_str)) {
+	if (!_run_batched(state)) {
 		log_error("Failed command for %s.", dm_task_get_name(dmt));
 		state->fails = 1;
 		return 0;
@@ -144,6 +234,23 @@ static int _wait_for_pid(struct dso_state *state)
 	return 1;
 }
 
+/*
+ * Usage expected at the next check when the pool keeps filling
+ * at the rate seen since the previous check.  Deduplication and
+ * compression savings may drop suddenly, so a pool can fill much
+ * faster than the fixed steps would notice.
+ */
+static int _projected_percent(int percent, int last_percent)
+{
+	if (!last_percent || (percent <= last_percent))
+		return percent;
+
+	if ((percent - last_percent) >= (DM_PERCENT_100 - percent))
+		return DM_PERCENT_100;
+
+	return 2 * percent - last_percent;
+}
+
 void process_event(struct dm_task *dmt,
 		   enum dm_event_mask event __attribute__((unused)),
 		   void **user)
@@ -155,6 +262,7 @@ void process_event(struct dm_task *dmt,
 	char *target_type = NULL;
 	char *params;
 	int needs_policy = 0;
+	int projected;
 	struct dm_task *new_dmt = NULL;
 	struct dm_vdo_status_parse_result vdop = { .status = NULL };
 
@@ -162,6 +270,8 @@ void process_event(struct dm_task *dmt,
 	log_debug("Watch for VDO %s:%.2f%%.", state->name,
 		  dm_percent_to_round_float(state->percent_check, 2));
 #endif
+	state->usage = DM_PERCENT_INVALID;
+
 	if (!_wait_for_pid(state)) {
 		log_warn("WARNING: Skipping event, child %d is still running (%s).",
 			 state->pid, state->cmd_str);
@@ -207,8 +317,8 @@ void process_event(struct dm_task *dmt,
 		goto out;
 	}
 
-	state->percent = dm_make_percent(vdop.status->used_blocks,
-					 vdop.status->total_blocks);
+	state->usage = state->percent = dm_make_percent(vdop.status->used_blocks,
+							vdop.status->total_blocks);
 
 #if VDO_DEBUG
 	log_debug("VDO %s status  %.2f%% " FMTu64 "/" FMTu64 ".",
@@ -220,6 +330,7 @@ void process_event(struct dm_task *dmt,
 	if (state->known_data_size != vdop.status->total_blocks) {
 		state->percent_check = CHECK_MINIMUM;
 		state->known_data_size = vdop.status->total_blocks;
+		state->last_percent = 0;
 		state->fails = 0;
 	}
 
@@ -228,15 +339,22 @@ void process_event(struct dm_task *dmt,
 	 * Report 80% threshold warning when it's used above 80%.
 	 * Only 100% is exception as it cannot be surpased so policy
 	 * action is called for:  >50%, >55% ... >95%, 100%
+	 * Pools filling fast get it already when the boundary is
+	 * expected to be crossed before the next check.
 	 */
+	projected = _projected_percent(state->percent, state->last_percent);
+	state->last_percent = state->percent;
 	if ((state->percent > WARNING_THRESH) &&
 	    (state->percent > state->percent_check))
 		log_warn("WARNING: VDO %s %s is now %.2f%% full.",
 			 state->name, device,
 			 dm_percent_to_round_float(state->percent, 2));
+	if ((projected >= DM_PERCENT_100) && (state->percent < DM_PERCENT_100))
+		log_warn("WARNING: VDO %s %s may get full before the next check.",
+			 state->name, device);
 	if (state->percent > CHECK_MINIMUM) {
 		/* Run action when usage raised more than CHECK_STEP since the last time */
-		if (state->percent > state->percent_check)
+		if (projected > state->percent_check)
 			needs_policy = 1;
 		state->percent_check = (state->percent / CHECK_STEP + 1) * CHECK_STEP;
 		if (state->percent_check == DM_PERCENT_100)
@@ -270,6 +388,13 @@ out:
 		dm_task_destroy(new_dmt);
 }
 
+dm_percent_t get_usage(void **user)
+{
+	struct dso_state *state = *user;
+
+	return state->usage;
+}
+
 /* Handle SIGCHLD for a thread */
 static void _sig_child(int signum __attribute__((unused)))
 {
@@ -333,6 +458,10 @@ int register_device(const char *device,
 			log_error("Failed to copy lvm VDO command.");
 				goto bad;
 		}
+
+		/* Find last space before 'vg/lv' */
+		if ((str = strrchr(state->cmd_str, ' ')) && strchr(str, '/'))
+			state->vg_lv = str + 1;
 	} else if (cmd_str[0] == '/') {
 		if (!(state->cmd_str = dm_pool_strdup(state->mem, cmd_str))) {
 			log_error("Failed to copy VDO command.");
@@ -358,6 +487,7 @@ int register_device(const char *device,
 
 	state->pid = -1;
 	state->name = name;
+	dm_list_init(&state->batch_list);
 	*user = state;
 
 	log_info("Monitoring VDO %s %s.", name, device);
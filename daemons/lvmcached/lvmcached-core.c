@@ -0,0 +1,588 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "tools/tool.h"
+
+#include "daemons/lvmcached/lvmcached-protocol.h"
+#include "lvm-version.h"
+#include "daemon-server.h"
+#include "daemon-log.h"
+#include "base/data-struct/hash.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/sysmacros.h>
+
+#ifdef UDEV_SYNC_SUPPORT
+#include <libudev.h>
+#endif
+
+/*
+ * lvmcached keeps VG metadata text that lvm commands read from disk, so
+ * that the next command finding the same metadata header can take the
+ * text from here rather than read it again.
+ *
+ * Entries are keyed by the checksum and size that the mda header on disk
+ * records for the text, and commands check the text they get against
+ * both, so the daemon cannot hand out stale metadata: once the metadata
+ * changes on disk, its header no longer matches the old entry.  Watching
+ * udev only frees entries of devices that changed or went away early;
+ * the rest are evicted least recently used first.
+ */
+#define LVMCACHED_SOCKET DEFAULT_RUN_DIR "/lvmcached.socket"
+
+#define LVMCD_LOG_PREFIX "LVMCACHED"
+
+#define DEFAULT_MAX_MB	64
+/* Devices remembered per entry, beyond that any device event drops it */
+#define MAX_ENTRY_DEVS	8
+
+struct cached_metadata {
+	struct dm_list list;		/* in lru, most recently used last */
+	uint32_t checksum;
+	uint32_t size;
+	unsigned nr_devs;		/* > MAX_ENTRY_DEVS: too many to track */
+	dev_t devs[MAX_ENTRY_DEVS];
+	char key[24];
+	char text[0];
+};
+
+struct lvmcached_state {
+	daemon_idle *idle;
+	log_state *log;
+	const char *log_config;
+	uint64_t max_bytes;
+
+	pthread_mutex_t lock;		/* protects all below */
+	struct dm_hash_table *entries;
+	struct dm_list lru;
+	uint64_t bytes;
+	uint64_t hits;
+	uint64_t misses;
+
+#ifdef UDEV_SYNC_SUPPORT
+	struct udev *udev;
+	struct udev_monitor *udev_mon;
+	pthread_t udev_thread;
+	volatile int udev_exit;
+#endif
+};
+
+static void _usage(const char *prog, FILE *file)
+{
+	fprintf(file, "Usage:\n"
+		"%s [-V] [-h] [-f] [-l {all|wire|debug}] [-s path] [-p path] [-m MiB] [-t secs]\n"
+		"%s --dump [-s path]\n"
+		"   -V|--version     Show version info\n"
+		"   -h|--help        Show this help information\n"
+		"   -f|--foreground  Don't fork, run in the foreground\n"
+		"   --dump           Dump lvmcached statistics and entries\n"
+		"   -l|--log         Logging message level (-l {all|wire|debug})\n"
+		"   -m|--memory      Metadata kept in MiB (default %d)\n"
+		"   -p|--pidfile     Set path to the pidfile\n"
+		"   -s|--socket      Set path to the communication socket\n"
+		"   -t|--timeout     Time to wait in seconds before shutdown on idle (missing or 0 = inifinite)\n\n",
+		prog, prog, DEFAULT_MAX_MB);
+}
+
+static void _key(char *key, size_t len, uint32_t checksum, uint32_t size)
+{
+	(void) dm_snprintf(key, len, "%08x-%u", checksum, size);
+}
+
+/* Called with ls->lock held. */
+static void _drop(struct lvmcached_state *ls, struct cached_metadata *cm)
+{
+	dm_hash_remove(ls->entries, cm->key);
+	dm_list_del(&cm->list);
+	ls->bytes -= cm->size;
+	free(cm);
+}
+
+static int _has_dev(const struct cached_metadata *cm, dev_t devno)
+{
+	unsigned i;
+
+	if (cm->nr_devs > MAX_ENTRY_DEVS)
+		return 1;
+
+	for (i = 0; i < cm->nr_devs; i++)
+		if (cm->devs[i] == devno)
+			return 1;
+
+	return 0;
+}
+
+static void _add_dev(struct cached_metadata *cm, dev_t devno)
+{
+	if (!devno || _has_dev(cm, devno))
+		return;
+
+	if (cm->nr_devs < MAX_ENTRY_DEVS)
+		cm->devs[cm->nr_devs] = devno;
+	cm->nr_devs++;
+}
+
+/* Drop entries read from devno, or all of them for 0. */
+static unsigned _invalidate(struct lvmcached_state *ls, dev_t devno)
+{
+	struct cached_metadata *cm, *tmp;
+	unsigned count = 0;
+
+	pthread_mutex_lock(&ls->lock);
+	dm_list_iterate_items_safe(cm, tmp, &ls->lru)
+		if (!devno || _has_dev(cm, devno)) {
+			_drop(ls, cm);
+			count++;
+		}
+	pthread_mutex_unlock(&ls->lock);
+
+	return count;
+}
+
+#ifdef UDEV_SYNC_SUPPORT
+/*
+ * Block device change events follow every close of a device opened for
+ * writing, so any metadata update, and remove events follow devices
+ * going away.  Neither is needed for correctness, see above.
+ */
+static void *_udev_thread(void *arg)
+{
+	struct lvmcached_state *ls = arg;
+	struct pollfd pfd = { .fd = udev_monitor_get_fd(ls->udev_mon), .events = POLLIN };
+	struct udev_device *dev;
+	const char *action;
+	dev_t devno;
+	unsigned count;
+
+	while (!ls->udev_exit) {
+		if (poll(&pfd, 1, 1000) <= 0)
+			continue;
+
+		if (!(dev = udev_monitor_receive_device(ls->udev_mon)))
+			continue;
+
+		if ((action = udev_device_get_action(dev)) && strcmp(action, "add") &&
+		    (devno = udev_device_get_devnum(dev)) &&
+		    (count = _invalidate(ls, devno)))
+			DEBUGLOG(ls, "%s: %s %d:%d dropped %u entries", LVMCD_LOG_PREFIX,
+				 action, (int) major(devno), (int) minor(devno), count);
+
+		udev_device_unref(dev);
+	}
+
+	return NULL;
+}
+
+static int _udev_init(struct lvmcached_state *ls)
+{
+	if (!(ls->udev = udev_new()) ||
+	    !(ls->udev_mon = udev_monitor_new_from_netlink(ls->udev, "udev")) ||
+	    udev_monitor_filter_add_match_subsystem_devtype(ls->udev_mon, "block", NULL) ||
+	    udev_monitor_enable_receiving(ls->udev_mon) ||
+	    pthread_create(&ls->udev_thread, NULL, _udev_thread, ls)) {
+		/* Entries are then only evicted by age */
+		WARN(ls, "%s: %s", LVMCD_LOG_PREFIX, "Failed to watch udev events");
+		if (ls->udev_mon)
+			udev_monitor_unref(ls->udev_mon);
+		ls->udev_mon = NULL;
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _udev_exit(struct lvmcached_state *ls)
+{
+	if (ls->udev_mon) {
+		ls->udev_exit = 1;
+		pthread_join(ls->udev_thread, NULL);
+		udev_monitor_unref(ls->udev_mon);
+	}
+
+	if (ls->udev)
+		udev_unref(ls->udev);
+}
+#endif
+
+static int _init(struct daemon_state *s)
+{
+	struct lvmcached_state *ls = s->private;
+	ls->log = s->log;
+
+	daemon_log_enable(ls->log, DAEMON_LOG_OUTLET_STDERR, DAEMON_LOG_WARN, 1);
+
+	if (!daemon_log_parse(ls->log, DAEMON_LOG_OUTLET_STDERR, ls->log_config, 1))
+		return 0;
+
+	if (!(ls->entries = dm_hash_create(1024))) {
+		FATAL(ls, "%s: %s", LVMCD_LOG_PREFIX, "Failed to allocate internal data structures");
+		return 0;
+	}
+
+	dm_list_init(&ls->lru);
+	pthread_mutex_init(&ls->lock, NULL);
+
+#ifdef UDEV_SYNC_SUPPORT
+	(void) _udev_init(ls);
+#endif
+
+	if (ls->idle)
+		ls->idle->is_idle = 1;
+
+	return 1;
+}
+
+static int _fini(struct daemon_state *s)
+{
+	struct lvmcached_state *ls = s->private;
+
+	DEBUGLOG(s, "fini");
+
+#ifdef UDEV_SYNC_SUPPORT
+	_udev_exit(ls);
+#endif
+
+	(void) _invalidate(ls, 0);
+	dm_hash_destroy(ls->entries);
+	pthread_mutex_destroy(&ls->lock);
+
+	return 1;
+}
+
+static response _reply(const char *res)
+{
+	return daemon_reply_simple(res, NULL);
+}
+
+/* daemon_request_int() is limited to int, checksums and devnos are not */
+static int64_t _request_int64(request r, const char *path, int64_t def)
+{
+	if (!r.cft)
+		return def;
+	return dm_config_find_int64(r.cft->root, path, def);
+}
+
+static int _request_key(request r, uint32_t *checksum, uint32_t *size)
+{
+	int64_t c = _request_int64(r, LVMCD_PARM_CHECKSUM, -1);
+	int64_t sz = _request_int64(r, LVMCD_PARM_SIZE, -1);
+
+	if ((c < 0) || (c > UINT32_MAX) || (sz <= 0) || (sz > UINT32_MAX))
+		return 0;
+
+	*checksum = (uint32_t) c;
+	*size = (uint32_t) sz;
+
+	return 1;
+}
+
+static response _metadata_get(struct lvmcached_state *ls, request r)
+{
+	struct cached_metadata *cm;
+	response res = { 0 };
+	uint32_t checksum, size;
+	char key[24];
+
+	if (!_request_key(r, &checksum, &size))
+		return _reply(LVMCD_RESP_EINVAL);
+
+	_key(key, sizeof(key), checksum, size);
+
+	pthread_mutex_lock(&ls->lock);
+
+	if (!(cm = dm_hash_lookup(ls->entries, key))) {
+		ls->misses++;
+		pthread_mutex_unlock(&ls->lock);
+		return _reply(LVMCD_RESP_NOT_FOUND);
+	}
+
+	ls->hits++;
+	dm_list_move(&ls->lru, &cm->list);
+
+	/* Written while locked, the entry may be dropped right after */
+	buffer_init(&res.buffer);
+	if (!buffer_append_key_str(&res.buffer, "response", LVMCD_RESP_OK) ||
+	    !buffer_append_key_str(&res.buffer, LVMCD_PARM_METADATA, cm->text))
+		res.error = ENOMEM;
+
+	pthread_mutex_unlock(&ls->lock);
+
+	return res;
+}
+
+static response _metadata_put(struct lvmcached_state *ls, request r)
+{
+	struct cached_metadata *cm, *old;
+	const char *text = daemon_request_str(r, LVMCD_PARM_METADATA, NULL);
+	dev_t devno = (dev_t) _request_int64(r, LVMCD_PARM_DEVICE, 0);
+	uint32_t checksum, size;
+	char key[24];
+
+	/* The size is that of the mda text, terminating NUL included */
+	if (!_request_key(r, &checksum, &size) || !text || !size ||
+	    (strlen(text) != size - 1))
+		return _reply(LVMCD_RESP_EINVAL);
+
+	if (size > ls->max_bytes / 4)
+		return _reply(LVMCD_RESP_OK);	/* not worth the room */
+
+	_key(key, sizeof(key), checksum, size);
+
+	pthread_mutex_lock(&ls->lock);
+
+	if ((cm = dm_hash_lookup(ls->entries, key))) {
+		/* Another copy of the same metadata */
+		_add_dev(cm, devno);
+		dm_list_move(&ls->lru, &cm->list);
+		pthread_mutex_unlock(&ls->lock);
+		return _reply(LVMCD_RESP_OK);
+	}
+
+	while ((ls->bytes + size > ls->max_bytes) && !dm_list_empty(&ls->lru)) {
+		old = dm_list_item(dm_list_first(&ls->lru), struct cached_metadata);
+		_drop(ls, old);
+	}
+
+	if (!(cm = zalloc(sizeof(*cm) + size + 1)))
+		goto bad;
+
+	cm->checksum = checksum;
+	cm->size = size;
+	memcpy(cm->key, key, sizeof(key));
+	memcpy(cm->text, text, size);
+	_add_dev(cm, devno);
+
+	if (!dm_hash_insert(ls->entries, cm->key, cm)) {
+		free(cm);
+		goto bad;
+	}
+
+	dm_list_add(&ls->lru, &cm->list);
+	ls->bytes += size;
+
+	pthread_mutex_unlock(&ls->lock);
+
+	DEBUGLOG(ls, "%s: cached %s from %d:%d", LVMCD_LOG_PREFIX, key,
+		 (int) major(devno), (int) minor(devno));
+
+	return _reply(LVMCD_RESP_OK);
+bad:
+	pthread_mutex_unlock(&ls->lock);
+	ERROR(ls, "%s: %s", LVMCD_LOG_PREFIX, "Failed to allocate metadata entry");
+	return _reply(LVMCD_RESP_OK);
+}
+
+static response _invalidate_request(struct lvmcached_state *ls, request r)
+{
+	dev_t devno = (dev_t) _request_int64(r, LVMCD_PARM_DEVICE, 0);
+	unsigned count = _invalidate(ls, devno);
+
+	DEBUGLOG(ls, "%s: invalidate %d:%d dropped %u entries", LVMCD_LOG_PREFIX,
+		 (int) major(devno), (int) minor(devno), count);
+
+	return _reply(LVMCD_RESP_OK);
+}
+
+static response _dump(struct lvmcached_state *ls)
+{
+	struct cached_metadata *cm;
+	response res = { 0 };
+	struct buffer *b = &res.buffer;
+	char line[128];
+	unsigned i;
+	int r;
+
+	buffer_init(b);
+
+	pthread_mutex_lock(&ls->lock);
+
+	r = buffer_append_key_str(b, "response", LVMCD_RESP_OK) &&
+	    buffer_append_key_int(b, "entries", dm_hash_get_num_entries(ls->entries)) &&
+	    buffer_append_key_int(b, "bytes", ls->bytes) &&
+	    buffer_append_key_int(b, "max_bytes", ls->max_bytes) &&
+	    buffer_append_key_int(b, "hits", ls->hits) &&
+	    buffer_append_key_int(b, "misses", ls->misses) &&
+	    buffer_append(b, "\n# Least recently used first\n");
+
+	dm_list_iterate_items(cm, &ls->lru) {
+		if (!r)
+			break;
+		r = buffer_append(b, "# ") && buffer_append(b, cm->key) &&
+		    buffer_append(b, cm->nr_devs > MAX_ENTRY_DEVS ? " devices many" : " devices");
+		for (i = 0; r && (i < cm->nr_devs) && (i < MAX_ENTRY_DEVS); i++)
+			r = (dm_snprintf(line, sizeof(line), " %d:%d", (int) major(cm->devs[i]),
+					 (int) minor(cm->devs[i])) > 0) && buffer_append(b, line);
+		r = r && buffer_append(b, "\n");
+	}
+
+	pthread_mutex_unlock(&ls->lock);
+
+	if (!r)
+		res.error = ENOMEM;
+
+	return res;
+}
+
+static response _handler(struct daemon_state s, client_handle h, request r)
+{
+	struct lvmcached_state *ls = s.private;
+	const char *rq = daemon_request_str(r, "request", "NONE");
+
+	if (!strcmp(rq, LVMCD_REQ_GET))
+		return _metadata_get(ls, r);
+	else if (!strcmp(rq, LVMCD_REQ_PUT))
+		return _metadata_put(ls, r);
+	else if (!strcmp(rq, LVMCD_REQ_INVALIDATE))
+		return _invalidate_request(ls, r);
+	else if (!strcmp(rq, LVMCD_REQ_DUMP))
+		return _dump(ls);
+	else
+		return _reply(LVMCD_RESP_EINVAL);
+}
+
+static int _process_uint_arg(const char *str, unsigned *value)
+{
+	char *endptr;
+	unsigned long l;
+
+	errno = 0;
+	l = strtoul(str, &endptr, 10);
+	if (errno || *endptr || l >= UINT_MAX)
+		return 0;
+
+	*value = (unsigned) l;
+
+	return 1;
+}
+
+static int _dump_client(const char *socket)
+{
+	daemon_info lvmcached_info = {
+		.path = "lvmcached",
+		.socket = socket,
+		.protocol = LVMCACHED_PROTOCOL,
+		.protocol_version = LVMCACHED_PROTOCOL_VERSION
+	};
+	daemon_handle h = daemon_open(lvmcached_info);
+	daemon_reply repl;
+	int r = EXIT_FAILURE;
+
+	if (h.error || h.socket_fd < 0) {
+		fprintf(stderr, "Failed to establish connection with lvmcached.\n");
+		return EXIT_FAILURE;
+	}
+
+	repl = daemon_send_simple(h, LVMCD_REQ_DUMP, NULL);
+	if (repl.error)
+		fprintf(stderr, "Failed to send a request or receive response.\n");
+	else {
+		fputs(repl.buffer.mem, stdout);
+		r = EXIT_SUCCESS;
+	}
+
+	daemon_reply_destroy(repl);
+	daemon_close(h);
+
+	return r;
+}
+
+static int _dump_action = 0;
+static struct option _long_options[] = {
+	{"dump",	no_argument,		&_dump_action,	1 },
+	{"foreground",	no_argument,		0,		'f' },
+	{"help",	no_argument,		0,		'h' },
+	{"log",		required_argument,	0,		'l' },
+	{"memory",	required_argument,	0,		'm' },
+	{"pidfile",	required_argument,	0,		'p' },
+	{"socket",	required_argument,	0,		's' },
+	{"timeout",	required_argument,	0,		't' },
+	{"version",	no_argument,		0,		'V' },
+	{0,		0,			0,		0 }
+};
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int option_index = 0;
+	unsigned max_mb = DEFAULT_MAX_MB;
+	struct timespec timeout;
+	daemon_idle di = { .ptimeout = &timeout };
+	struct lvmcached_state ls = { .log_config = "" };
+	daemon_state s = {
+		.daemon_fini = _fini,
+		.daemon_init = _init,
+		.handler = _handler,
+		.name = "lvmcached",
+		.pidfile = getenv("LVM_LVMCACHED_PIDFILE") ?: LVMCACHED_PIDFILE,
+		.private = &ls,
+		.protocol = LVMCACHED_PROTOCOL,
+		.protocol_version = LVMCACHED_PROTOCOL_VERSION,
+		.socket_path = getenv("LVM_LVMCACHED_SOCKET") ?: LVMCACHED_SOCKET,
+	};
+
+	while ((opt = getopt_long(argc, argv, "fhVl:m:p:s:t:", _long_options, &option_index)) != -1) {
+		switch (opt) {
+		case 0:
+			break;
+		case '?':
+			_usage(argv[0], stderr);
+			exit(EXIT_FAILURE);
+		case 'V': /* --version */
+			printf("lvmcached version: " LVM_VERSION "\n");
+			exit(EXIT_SUCCESS);
+		case 'f': /* --foreground */
+			s.foreground = 1;
+			break;
+		case 'h': /* --help */
+			_usage(argv[0], stdout);
+			exit(EXIT_SUCCESS);
+		case 'l': /* --log */
+			ls.log_config = optarg;
+			break;
+		case 'm': /* --memory in MiB */
+			if (!_process_uint_arg(optarg, &max_mb) || !max_mb) {
+				fprintf(stderr, "Invalid value of memory parameter.\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'p': /* --pidfile */
+			s.pidfile = optarg;
+			break;
+		case 's': /* --socket */
+			s.socket_path = optarg;
+			break;
+		case 't': /* --timeout in seconds */
+			if (!_process_uint_arg(optarg, &di.max_timeouts)) {
+				fprintf(stderr, "Invalid value of timeout parameter.\n");
+				exit(EXIT_FAILURE);
+			}
+			/* 0 equals to wait indefinitely */
+			if (di.max_timeouts)
+				s.idle = ls.idle = &di;
+			break;
+		}
+	}
+
+	if (_dump_action)
+		return _dump_client(s.socket_path);
+
+	ls.max_bytes = (uint64_t) max_mb << 20;
+
+	daemon_start(s);
+
+	return EXIT_SUCCESS;
+}
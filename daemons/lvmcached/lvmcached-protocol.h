@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_LVMCACHED_PROTOCOL_H
+#define _LVM_LVMCACHED_PROTOCOL_H
+
+#define LVMCACHED_PROTOCOL "lvmcached"
+#define LVMCACHED_PROTOCOL_VERSION 1
+
+#define LVMCD_REQ_DUMP		"dump"
+#define LVMCD_REQ_GET		"metadata_get"
+#define LVMCD_REQ_INVALIDATE	"invalidate"
+#define LVMCD_REQ_PUT		"metadata_put"
+
+#define LVMCD_PARM_CHECKSUM	"checksum" /* of the metadata text, as in the mda header */
+#define LVMCD_PARM_DEVICE	"device" /* devno the text was read from */
+#define LVMCD_PARM_METADATA	"metadata"
+#define LVMCD_PARM_SIZE		"size" /* of the metadata text */
+
+#define LVMCD_RESP_EINVAL	"invalid"
+#define LVMCD_RESP_NOT_FOUND	"not_found"
+#define LVMCD_RESP_OK		"OK"
+
+#endif /* _LVM_LVMCACHED_PROTOCOL_H */
@@ -521,7 +521,7 @@ def supports_vdo():
 	return False
 
 
-def lvm_full_report_json():
+def lvm_full_report_json(vg_uuids=None):
 	pv_columns = ['pv_name', 'pv_uuid', 'pv_fmt', 'pv_size', 'pv_free',
 					'pv_used', 'dev_size', 'pv_mda_size', 'pv_mda_free',
 					'pv_ba_start', 'pv_ba_size', 'pe_start', 'pv_pe_count',
@@ -564,7 +564,13 @@ def lvm_full_report_json():
 				'vdo_logical_threads', 'vdo_physical_threads',
 				'vdo_max_discard', 'vdo_write_policy', 'vdo_header_size'])
 
-	cmd = _dc('fullreport', [
+	# Only report the given VGs
+	select = []
+	if vg_uuids:
+		select = ['--select',
+					'||'.join(['vg_uuid=%s' % u for u in vg_uuids])]
+
+	cmd = _dc('fullreport', select + [
 		'-a',		# Need hidden too
 		'--configreport', 'pv', '-o', ','.join(pv_columns),
 		'--configreport', 'vg', '-o', ','.join(vg_columns),
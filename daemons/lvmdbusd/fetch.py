@@ -18,22 +18,25 @@ import time
 import traceback
 
 
-def _main_thread_load(refresh=True, emit_signal=True):
+def _main_thread_load(refresh=True, emit_signal=True, vg_uuids=None):
 	num_total_changes = 0
 
 	num_total_changes += load_pvs(
 		refresh=refresh,
 		emit_signal=emit_signal,
-		cache_refresh=False)[1]
+		cache_refresh=False,
+		vg_uuids=vg_uuids)[1]
 	num_total_changes += load_vgs(
 		refresh=refresh,
 		emit_signal=emit_signal,
-		cache_refresh=False)[1]
+		cache_refresh=False,
+		vg_uuids=vg_uuids)[1]
 
 	lv_changes = load_lvs(
 		refresh=refresh,
 		emit_signal=emit_signal,
-		cache_refresh=False)[1]
+		cache_refresh=False,
+		vg_uuids=vg_uuids)[1]
 
 	num_total_changes += lv_changes
 
@@ -47,21 +50,27 @@ def _main_thread_load(refresh=True, emit_signal=True):
 		num_total_changes += load_vgs(
 			refresh=refresh,
 			emit_signal=emit_signal,
-			cache_refresh=False)[1]
+			cache_refresh=False,
+			vg_uuids=vg_uuids)[1]
 
 	return num_total_changes
 
 
 def load(refresh=True, emit_signal=True, cache_refresh=True, log=True,
-			need_main_thread=True):
-	# Go through and load all the PVs, VGs and LVs
+			need_main_thread=True, vg_uuids=None):
+	# Go through and load all the PVs, VGs and LVs, or only those belonging
+	# to the VGs in vg_uuids when we know nothing else has changed
+	if not refresh:
+		vg_uuids = None
+
 	if cache_refresh:
-		cfg.db.refresh(log)
+		cfg.db.refresh(log, vg_uuids)
 
 	if need_main_thread:
-		rc = MThreadRunner(_main_thread_load, refresh, emit_signal).done()
+		rc = MThreadRunner(_main_thread_load, refresh, emit_signal,
+							vg_uuids).done()
 	else:
-		rc = _main_thread_load(refresh, emit_signal)
+		rc = _main_thread_load(refresh, emit_signal, vg_uuids)
 
 	return rc
 
@@ -74,13 +83,14 @@ class StateUpdate(object):
 	class UpdateRequest(object):
 
 		def __init__(self, refresh, emit_signal, cache_refresh, log,
-						need_main_thread):
+						need_main_thread, vg_uuids):
 			self.is_done = False
 			self.refresh = refresh
 			self.emit_signal = emit_signal
 			self.cache_refresh = cache_refresh
 			self.log = log
 			self.need_main_thread = need_main_thread
+			self.vg_uuids = vg_uuids
 			self.result = None
 			self.cond = threading.Condition(threading.Lock())
 
@@ -109,6 +119,7 @@ class StateUpdate(object):
 				cache_refresh = True
 				log = True
 				need_main_thread = True
+				vg_uuids = set()
 
 				with obj.lock:
 					wait = not obj.deferred
@@ -142,9 +153,14 @@ class StateUpdate(object):
 						log = False
 					if not i.need_main_thread:
 						need_main_thread = False
+					# One request for everything covers all the others
+					if not i.vg_uuids:
+						vg_uuids = None
+					elif vg_uuids is not None:
+						vg_uuids.update(i.vg_uuids)
 
 				num_changes = load(refresh, emit_signal, cache_refresh, log,
-									need_main_thread)
+									need_main_thread, vg_uuids or None)
 				# Update is done, let everyone know!
 				for i in queued_requests:
 					i.set_result(num_changes)
@@ -188,10 +204,10 @@ class StateUpdate(object):
 										name="StateUpdate.update_thread")
 
 	def load(self, refresh=True, emit_signal=True, cache_refresh=True,
-					log=True, need_main_thread=True):
+					log=True, need_main_thread=True, vg_uuids=None):
 		# Place this request on the queue and wait for it to be completed
 		req = StateUpdate.UpdateRequest(refresh, emit_signal, cache_refresh,
-										log, need_main_thread)
+										log, need_main_thread, vg_uuids)
 		self.queue.put(req)
 		return req.done()
 
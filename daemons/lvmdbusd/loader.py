@@ -23,7 +23,7 @@ def _compare_construction(o_state, new_state):
 
 
 def common(retrieve, o_type, search_keys,
-			object_path, refresh, emit_signal, cache_refresh):
+			object_path, refresh, emit_signal, cache_refresh, vg_uuids=None):
 	num_changes = 0
 	existing_paths = []
 	rc = []
@@ -31,16 +31,26 @@ def common(retrieve, o_type, search_keys,
 	if search_keys:
 		assert isinstance(search_keys, list)
 
+	# Limiting the objects to some VGs only makes sense for a refresh
+	if not refresh:
+		vg_uuids = None
+
 	if cache_refresh:
-		cfg.db.refresh()
+		cfg.db.refresh(vg_uuids=vg_uuids)
 
-	objects = retrieve(search_keys, cache_refresh=False)
+	objects = retrieve(search_keys, cache_refresh=False, vg_uuids=vg_uuids)
 
 	# If we are doing a refresh we need to know what we have in memory, what's
 	# in lvm and add those that are new and remove those that are gone!
 	if refresh:
 		existing_paths = cfg.om.object_paths_by_type(o_type)
 
+		# Objects outside of the refreshed VGs are left untouched
+		if vg_uuids:
+			for k in list(existing_paths.keys()):
+				if not cfg.om.get_object_by_path(k).state.in_vgs(vg_uuids):
+					del existing_paths[k]
+
 	for o in objects:
 		# Assume we need to add this one to dbus, unless we are refreshing
 		# and it's already present
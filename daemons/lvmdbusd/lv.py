@@ -61,7 +61,7 @@ def get_key(i):
 
 
 # noinspection PyUnusedLocal
-def lvs_state_retrieve(selection, cache_refresh=True):
+def lvs_state_retrieve(selection, cache_refresh=True, vg_uuids=None):
 	rc = []
 
 	if cache_refresh:
@@ -73,6 +73,9 @@ def lvs_state_retrieve(selection, cache_refresh=True):
 	# don't have information available yet.
 	lvs = sorted(cfg.db.fetch_lvs(selection), key=get_key)
 
+	if vg_uuids:
+		lvs = [l for l in lvs if l['vg_uuid'] in vg_uuids]
+
 	for l in lvs:
 		if cfg.vdo_support:
 			rc.append(LvStateVdo(
@@ -138,12 +141,12 @@ def lvs_state_retrieve(selection, cache_refresh=True):
 
 
 def load_lvs(lv_name=None, object_path=None, refresh=False, emit_signal=False,
-				cache_refresh=True):
+				cache_refresh=True, vg_uuids=None):
 	# noinspection PyUnresolvedReferences
 	return common(
 		lvs_state_retrieve,
 		(LvCommon, Lv, LvThinPool, LvSnapShot),
-		lv_name, object_path, refresh, emit_signal, cache_refresh)
+		lv_name, object_path, refresh, emit_signal, cache_refresh, vg_uuids)
 
 
 # noinspection PyPep8Naming,PyUnresolvedReferences,PyUnusedLocal
@@ -175,6 +178,9 @@ class LvState(State):
 	def identifiers(self):
 		return (self.Uuid, self.lvm_id)
 
+	def in_vgs(self, vg_uuids):
+		return self.vg_uuid in vg_uuids
+
 	def _get_hidden_lv(self):
 		rc = dbus.Array([], "o")
 
@@ -347,8 +353,8 @@ class LvCommon(AutomatedProperties):
 		self._move_pv = self._get_move_pv()
 
 	@staticmethod
-	def handle_execute(rc, out, err):
-		_handle_execute(rc, out, err, LV_INTERFACE)
+	def handle_execute(rc, out, err, vg_uuid=None):
+		_handle_execute(rc, out, err, LV_INTERFACE, vg_uuid)
 
 	@staticmethod
 	def validate_dbus_object(lv_uuid, lv_name):
@@ -522,9 +528,10 @@ class Lv(LvCommon):
 	@staticmethod
 	def _remove(lv_uuid, lv_name, remove_options):
 		# Make sure we have a dbus object representing it
-		LvCommon.validate_dbus_object(lv_uuid, lv_name)
+		dbo = LvCommon.validate_dbus_object(lv_uuid, lv_name)
 		# Remove the LV, if successful then remove from the model
-		LvCommon.handle_execute(*cmdhandler.lv_remove(lv_name, remove_options))
+		LvCommon.handle_execute(*cmdhandler.lv_remove(lv_name, remove_options),
+			vg_uuid=dbo.state.vg_uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -542,10 +549,11 @@ class Lv(LvCommon):
 	@staticmethod
 	def _rename(lv_uuid, lv_name, new_name, rename_options):
 		# Make sure we have a dbus object representing it
-		LvCommon.validate_dbus_object(lv_uuid, lv_name)
+		dbo = LvCommon.validate_dbus_object(lv_uuid, lv_name)
 		# Rename the logical volume
 		LvCommon.handle_execute(*cmdhandler.lv_rename(lv_name, new_name,
-												rename_options))
+												rename_options),
+			vg_uuid=dbo.state.vg_uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -595,7 +603,8 @@ class Lv(LvCommon):
 				optional_size = space + 512 - remainder
 
 		LvCommon.handle_execute(*cmdhandler.vg_lv_snapshot(
-			lv_name, snapshot_options,name, optional_size))
+			lv_name, snapshot_options,name, optional_size),
+			vg_uuid=dbo.state.vg_uuid)
 		full_name = "%s/%s" % (dbo.vg_name_lookup(), name)
 		return cfg.om.get_object_path_by_lvm_id(full_name)
 
@@ -635,7 +644,8 @@ class Lv(LvCommon):
 
 		size_change = new_size_bytes - dbo.SizeBytes
 		LvCommon.handle_execute(*cmdhandler.lv_resize(
-			dbo.lvm_id, size_change,pv_dests, resize_options))
+			dbo.lvm_id, size_change,pv_dests, resize_options),
+			vg_uuid=dbo.state.vg_uuid)
 		return "/"
 
 	@dbus.service.method(
@@ -669,9 +679,10 @@ class Lv(LvCommon):
 	def _lv_activate_deactivate(uuid, lv_name, activate, control_flags,
 								options):
 		# Make sure we have a dbus object representing it
-		LvCommon.validate_dbus_object(uuid, lv_name)
+		dbo = LvCommon.validate_dbus_object(uuid, lv_name)
 		LvCommon.handle_execute(*cmdhandler.activate_deactivate(
-			'lvchange', lv_name, activate, control_flags, options))
+			'lvchange', lv_name, activate, control_flags, options),
+			vg_uuid=dbo.state.vg_uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -704,9 +715,10 @@ class Lv(LvCommon):
 	@staticmethod
 	def _add_rm_tags(uuid, lv_name, tags_add, tags_del, tag_options):
 		# Make sure we have a dbus object representing it
-		LvCommon.validate_dbus_object(uuid, lv_name)
+		dbo = LvCommon.validate_dbus_object(uuid, lv_name)
 		LvCommon.handle_execute(*cmdhandler.lv_tag(
-			lv_name, tags_add, tags_del, tag_options))
+			lv_name, tags_add, tags_del, tag_options),
+			vg_uuid=dbo.state.vg_uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -826,10 +838,11 @@ class LvVdoPool(Lv):
 	@staticmethod
 	def _enable_disable_compression(pool_uuid, pool_name, enable, comp_options):
 		# Make sure we have a dbus object representing it
-		LvCommon.validate_dbus_object(pool_uuid, pool_name)
+		dbo = LvCommon.validate_dbus_object(pool_uuid, pool_name)
 		# Rename the logical volume
 		LvCommon.handle_execute(*cmdhandler.lv_vdo_compression(
-			pool_name, enable, comp_options))
+			pool_name, enable, comp_options),
+			vg_uuid=dbo.state.vg_uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -859,10 +872,11 @@ class LvVdoPool(Lv):
 	@staticmethod
 	def _enable_disable_deduplication(pool_uuid, pool_name, enable, dedup_options):
 		# Make sure we have a dbus object representing it
-		LvCommon.validate_dbus_object(pool_uuid, pool_name)
+		dbo = LvCommon.validate_dbus_object(pool_uuid, pool_name)
 		# Rename the logical volume
 		LvCommon.handle_execute(*cmdhandler.lv_vdo_deduplication(
-			pool_name, enable, dedup_options))
+			pool_name, enable, dedup_options),
+			vg_uuid=dbo.state.vg_uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -913,7 +927,8 @@ class LvThinPool(Lv):
 		# Make sure we have a dbus object representing it
 		dbo = LvCommon.validate_dbus_object(lv_uuid, lv_name)
 		LvCommon.handle_execute(*cmdhandler.lv_lv_create(
-			lv_name, create_options, name, size_bytes))
+			lv_name, create_options, name, size_bytes),
+			vg_uuid=dbo.state.vg_uuid)
 		full_name = "%s/%s" % (dbo.vg_name_lookup(), name)
 		return cfg.om.get_object_path_by_lvm_id(full_name)
 
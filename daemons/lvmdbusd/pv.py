@@ -22,13 +22,15 @@ from .utils import round_size
 
 
 # noinspection PyUnusedLocal
-def pvs_state_retrieve(selection, cache_refresh=True):
+def pvs_state_retrieve(selection, cache_refresh=True, vg_uuids=None):
 	rc = []
 
 	if cache_refresh:
 		cfg.db.refresh()
 
 	for p in cfg.db.fetch_pvs(selection):
+		if vg_uuids and p['vg_uuid'] not in vg_uuids:
+			continue
 		rc.append(
 			PvState(
 				p["pv_name"], p["pv_uuid"], p["pv_name"],
@@ -42,10 +44,10 @@ def pvs_state_retrieve(selection, cache_refresh=True):
 
 
 def load_pvs(device=None, object_path=None, refresh=False, emit_signal=False,
-		cache_refresh=True):
+		cache_refresh=True, vg_uuids=None):
 	return common(
 		pvs_state_retrieve, (Pv,), device, object_path, refresh,
-		emit_signal, cache_refresh)
+		emit_signal, cache_refresh, vg_uuids)
 
 
 # noinspection PyUnresolvedReferences
@@ -90,6 +92,9 @@ class PvState(State):
 	def identifiers(self):
 		return (self.Uuid, self.lvm_path)
 
+	def in_vgs(self, vg_uuids):
+		return self.vg_uuid in vg_uuids
+
 	def create_dbus_object(self, path):
 		if not path:
 			path = cfg.om.get_object_path_by_uuid_lvm_id(self.Uuid, self.Name,
@@ -23,5 +23,9 @@ class State(object, metaclass=ABCMeta):
 	def create_dbus_object(self, path):
 		pass
 
+	@abstractmethod
+	def in_vgs(self, vg_uuids):
+		pass
+
 	def __str__(self):
 		return '*****\n' + str(self.__dict__) + '\n******\n'
@@ -18,11 +18,19 @@ observer_lock = threading.RLock()
 
 _udev_lock = threading.RLock()
 _udev_count = 0
+# VGs touched by the pending events, None when everything must be refreshed
+_udev_vgs = set()
 
 
-def udev_add():
+def udev_add(vg_uuid=None):
 	global _udev_count
+	global _udev_vgs
 	with _udev_lock:
+		if vg_uuid is None or _udev_vgs is None:
+			_udev_vgs = None
+		else:
+			_udev_vgs.add(vg_uuid)
+
 		if _udev_count == 0:
 			_udev_count += 1
 
@@ -35,15 +43,20 @@ def udev_add():
 
 def udev_complete():
 	global _udev_count
+	global _udev_vgs
 	with _udev_lock:
 		if _udev_count > 0:
 			_udev_count -= 1
 
+		vg_uuids = _udev_vgs
+		_udev_vgs = set()
+		return vg_uuids
+
 
 def _udev_event():
 	utils.log_debug("Processing udev event")
-	udev_complete()
-	cfg.load()
+	vg_uuids = udev_complete()
+	cfg.load(vg_uuids=vg_uuids or None)
 
 
 # noinspection PyUnusedLocal
@@ -64,11 +77,14 @@ def filter_event(action, device):
 				if found:
 					refresh = True
 
-	if 'DM_LV_NAME' in device:
-		refresh = True
-
 	if refresh:
 		udev_add()
+	elif 'DM_LV_NAME' in device:
+		# Only the VG the LV belongs to needs a refresh, if we know it
+		vg_uuid = None
+		if 'DM_VG_NAME' in device:
+			vg_uuid = cfg.db.vg_name_to_uuid.get(device['DM_VG_NAME'])
+		udev_add(vg_uuid)
 
 
 def add():
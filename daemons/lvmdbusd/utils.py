@@ -26,9 +26,10 @@ import signal
 STDOUT_TTY = os.isatty(sys.stdout.fileno())
 
 
-def _handle_execute(rc, out, err, interface):
+def _handle_execute(rc, out, err, interface, vg_uuid=None):
 	if rc == 0:
-		cfg.load()
+		# A command limited to one VG only needs that VG refreshed
+		cfg.load(vg_uuids=[vg_uuid] if vg_uuid else None)
 	else:
 		# Need to work on error handling, need consistent
 		raise dbus.exceptions.DBusException(
@@ -25,13 +25,15 @@ from .job import JobState
 
 
 # noinspection PyUnusedLocal
-def vgs_state_retrieve(selection, cache_refresh=True):
+def vgs_state_retrieve(selection, cache_refresh=True, vg_uuids=None):
 	rc = []
 
 	if cache_refresh:
 		cfg.db.refresh()
 
 	for v in cfg.db.fetch_vgs(selection):
+		if vg_uuids and v['vg_uuid'] not in vg_uuids:
+			continue
 		rc.append(
 			VgState(
 				v['vg_uuid'], v['vg_name'], v['vg_fmt'], n(v['vg_size']),
@@ -46,9 +48,9 @@ def vgs_state_retrieve(selection, cache_refresh=True):
 
 
 def load_vgs(vg_specific=None, object_path=None, refresh=False,
-		emit_signal=False, cache_refresh=True):
+		emit_signal=False, cache_refresh=True, vg_uuids=None):
 	return common(vgs_state_retrieve, (Vg, VgVdo, ), vg_specific, object_path, refresh,
-					emit_signal, cache_refresh)
+					emit_signal, cache_refresh, vg_uuids)
 
 
 # noinspection PyPep8Naming,PyUnresolvedReferences,PyUnusedLocal
@@ -65,6 +67,9 @@ class VgState(State):
 	def identifiers(self):
 		return (self.Uuid, self.internal_name)
 
+	def in_vgs(self, vg_uuids):
+		return self.Uuid in vg_uuids
+
 	def _lv_paths_build(self):
 		rc = []
 		for lv in cfg.db.lvs_in_vg(self.Uuid):
@@ -158,8 +163,8 @@ class Vg(AutomatedProperties):
 		return cfg.om.get_object_path_by_lvm_id("%s/%s" % (vg_name, lv_name))
 
 	@staticmethod
-	def handle_execute(rc, out, err):
-		return _handle_execute(rc, out, err, VG_INTERFACE)
+	def handle_execute(rc, out, err, vg_uuid=None):
+		return _handle_execute(rc, out, err, VG_INTERFACE, vg_uuid)
 
 	@staticmethod
 	def validate_dbus_object(vg_uuid, vg_name):
@@ -176,7 +181,8 @@ class Vg(AutomatedProperties):
 		# Make sure we have a dbus object representing it
 		Vg.validate_dbus_object(uuid, vg_name)
 		Vg.handle_execute(*cmdhandler.vg_rename(
-			uuid, new_name, rename_options))
+			uuid, new_name, rename_options),
+			vg_uuid=uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -334,7 +340,8 @@ class Vg(AutomatedProperties):
 				pv_dests.append((pv_dbus_obj.lvm_id, pr[1], pr[2]))
 
 		Vg.handle_execute(*cmdhandler.vg_lv_create(
-			vg_name, create_options, name, size_bytes, pv_dests))
+			vg_name, create_options, name, size_bytes, pv_dests),
+			vg_uuid=uuid)
 		return Vg.fetch_new_lv(vg_name, name)
 
 	@dbus.service.method(
@@ -373,7 +380,8 @@ class Vg(AutomatedProperties):
 		# Make sure we have a dbus object representing it
 		Vg.validate_dbus_object(uuid, vg_name)
 		Vg.handle_execute(*cmdhandler.vg_lv_create_linear(
-			vg_name, create_options, name, size_bytes, thin_pool))
+			vg_name, create_options, name, size_bytes, thin_pool),
+			vg_uuid=uuid)
 		return Vg.fetch_new_lv(vg_name, name)
 
 	@dbus.service.method(
@@ -397,7 +405,8 @@ class Vg(AutomatedProperties):
 		Vg.validate_dbus_object(uuid, vg_name)
 		Vg.handle_execute(*cmdhandler.vg_lv_create_striped(
 			vg_name, create_options, name, size_bytes,
-			num_stripes, stripe_size_kb, thin_pool))
+			num_stripes, stripe_size_kb, thin_pool),
+			vg_uuid=uuid)
 		return Vg.fetch_new_lv(vg_name, name)
 
 	@dbus.service.method(
@@ -423,7 +432,8 @@ class Vg(AutomatedProperties):
 		# Make sure we have a dbus object representing it
 		Vg.validate_dbus_object(uuid, vg_name)
 		Vg.handle_execute(*cmdhandler.vg_lv_create_mirror(
-			vg_name, create_options, name, size_bytes, num_copies))
+			vg_name, create_options, name, size_bytes, num_copies),
+			vg_uuid=uuid)
 		return Vg.fetch_new_lv(vg_name, name)
 
 	@dbus.service.method(
@@ -448,7 +458,8 @@ class Vg(AutomatedProperties):
 		Vg.validate_dbus_object(uuid, vg_name)
 		Vg.handle_execute(*cmdhandler.vg_lv_create_raid(
 			vg_name, create_options, name, raid_type, size_bytes,
-			num_stripes, stripe_size_kb))
+			num_stripes, stripe_size_kb),
+			vg_uuid=uuid)
 		return Vg.fetch_new_lv(vg_name, name)
 
 	@dbus.service.method(
@@ -486,7 +497,7 @@ class Vg(AutomatedProperties):
 			if rc == 0:
 				mt_remove_dbus_objects((md, data))
 
-			Vg.handle_execute(rc, out, err)
+			Vg.handle_execute(rc, out, err, vg_uuid=uuid)
 
 		else:
 			msg = ""
@@ -547,7 +558,8 @@ class Vg(AutomatedProperties):
 					VG_INTERFACE, 'PV object path = %s not found' % p)
 
 		Vg.handle_execute(*cmdhandler.pv_tag(
-			pv_devices, tags_add, tags_del, tag_options))
+			pv_devices, tags_add, tags_del, tag_options),
+			vg_uuid=uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -589,7 +601,8 @@ class Vg(AutomatedProperties):
 		Vg.validate_dbus_object(uuid, vg_name)
 
 		Vg.handle_execute(*cmdhandler.vg_tag(
-			vg_name, tags_add, tags_del, tag_options))
+			vg_name, tags_add, tags_del, tag_options),
+			vg_uuid=uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -689,7 +702,8 @@ class Vg(AutomatedProperties):
 		# Make sure we have a dbus object representing it
 		Vg.validate_dbus_object(uuid, vg_name)
 		Vg.handle_execute(*cmdhandler.activate_deactivate(
-			'vgchange', vg_name, activate, control_flags, options))
+			'vgchange', vg_name, activate, control_flags, options),
+			vg_uuid=uuid)
 		return '/'
 
 	@dbus.service.method(
@@ -794,7 +808,8 @@ class VgVdo(Vg):
 		Vg.validate_dbus_object(uuid, vg_name)
 		Vg.handle_execute(*cmdhandler.vg_create_vdo_pool_lv_and_lv(
 			vg_name, pool_name, lv_name, data_size, virtual_size,
-			create_options))
+			create_options),
+			vg_uuid=uuid)
 		return Vg.fetch_new_lv(vg_name, pool_name)
 
 	@dbus.service.method(
@@ -827,7 +842,8 @@ class VgVdo(Vg):
 
 		Vg.handle_execute(*cmdhandler.vg_create_vdo_pool(
 			pool.lv_full_name(), name, virtual_size,
-			create_options))
+			create_options),
+			vg_uuid=uuid)
 		return Vg.fetch_new_lv(vg_name, pool.Name)
 
 	@dbus.service.method(
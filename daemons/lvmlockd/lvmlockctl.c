@@ -47,7 +47,7 @@ do { \
 	printf(fmt "\n", ##args); \
 } while (0)
 
-#define MAX_LINE 512
+#define MAX_LINE 1024
 
 /* copied from lvmlockd-internal.h */
 #define MAX_NAME 64
@@ -242,6 +242,56 @@ static void format_info_r_action(char *line, char *r_name, char *r_type)
 	}
 }
 
+/*
+ * The lat buckets count latencies below 2^i usec (see struct lat_hist),
+ * so the percentiles printed are upper bounds.
+ */
+static double lat_percentile_ms(unsigned long long *buckets, int nr,
+				unsigned long long count, int pct)
+{
+	unsigned long long sum = 0;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		sum += buckets[i];
+		if (sum * 100 >= count * pct)
+			break;
+	}
+
+	return (double) (1ULL << i) / 1000;
+}
+
+static void format_info_lat(char *line)
+{
+	char ls_name[MAX_NAME+1] = { 0 };
+	char lm_type[MAX_NAME+1] = { 0 };
+	char rt[4] = { 0 };
+	char kind[MAX_NAME+1] = { 0 };
+	char buckets_str[MAX_LINE] = { 0 };
+	unsigned long long buckets[64] = { 0 };
+	unsigned long long count = 0, sum_us = 0, max_us = 0;
+	char *p, *end;
+	int nr = 0;
+
+	(void) sscanf(line, "info=lat ls_name=%s lm_type=%s rt=%s kind=%s count=%llu sum_us=%llu max_us=%llu buckets=%s",
+	       ls_name, lm_type, rt, kind, &count, &sum_us, &max_us, buckets_str);
+
+	if (!count)
+		return;
+
+	for (p = buckets_str; *p && (nr < 64); p = (*end == ',') ? end + 1 : end) {
+		buckets[nr++] = strtoull(p, &end, 10);
+		if (end == p)
+			break;
+	}
+
+	printf("LAT %s %s %s count %llu avg %.3f ms p50 %.3f ms p99 %.3f ms max %.3f ms\n",
+	       ls_name, rt, kind, count, (double) sum_us / count / 1000,
+	       lat_percentile_ms(buckets, nr, count, 50),
+	       lat_percentile_ms(buckets, nr, count, 99),
+	       (double) max_us / 1000);
+}
+
 static void format_info_line(char *line, char *r_name, char *r_type)
 {
 	if (!strncmp(line, "info=structs ", strlen("info=structs "))) {
@@ -273,6 +323,9 @@ static void format_info_line(char *line, char *r_name, char *r_type)
 	} else if (!strncmp(line, "info=r_action ", strlen("info=r_action "))) {
 		/* will use info from previous r */
 		format_info_r_action(line, r_name, r_type);
+
+	} else if (!strncmp(line, "info=lat ", strlen("info=lat "))) {
+		format_info_lat(line);
 	} else {
 		printf("UN %s\n", line);
 	}
@@ -593,6 +646,7 @@ static void print_usage(void)
 	printf("      Tell lvmlockd to quit.\n");
 	printf("--info | -i\n");
 	printf("      Print lock state information from lvmlockd.\n");
+	printf("      With --dump, print it raw, including lock latency histograms.\n");
 	printf("--dump | -d\n");
 	printf("      Print log buffer from lvmlockd.\n");
 	printf("--wait | -w 0|1\n");
@@ -20,7 +20,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <stddef.h>
-#include <poll.h>
+#include <sys/epoll.h>
 #include <signal.h>
 #include <getopt.h>
 #include <syslog.h>
@@ -43,25 +43,25 @@ static int str_to_mode(const char *str);
 /*
  * Basic operation of lvmlockd
  *
- * lvmlockd main process runs main_loop() which uses poll().
- * poll listens for new connections from lvm commands and for
+ * lvmlockd main process runs main_loop() which uses epoll.
+ * epoll listens for new connections from lvm commands and for
  * messages from existing connected lvm commands.
  *
  * lvm command starts and connects to lvmlockd.
  *
  * lvmlockd receives a connection request from command and adds a
  * 'struct client' to keep track of the connection to the command.
- * The client's fd is added to the set of fd's in poll().
+ * The client's fd is added to the set of fd's in epoll.
  *
  * lvm command sends a lock request to lvmlockd.  The lock request
  * can be for the global lock, a vg lock, or an lv lock.
  *
- * lvmlockd main_loop/poll sees a message from an existing client.
- * It sets client.recv = 1, then wakes up client_thread_main.
+ * lvmlockd main_loop/epoll sees a message from an existing client.
+ * It sets client.recv = 1, queues the client on client_work_list,
+ * then wakes up client_thread_main.
  *
- * client_thread_main iterates through client structs (cl), looking
- * for any that need processing, finds the one with cl->recv set,
- * and calls client_recv_action(cl).
+ * client_thread_main takes clients (cl) off client_work_list,
+ * and calls client_recv_action(cl) for the ones with cl->recv set.
  *
  * client_recv_action(cl) reads the message/request from the client,
  * allocates a new 'struct action' (act) to represent the request,
@@ -144,6 +144,14 @@ static const char *lvmlockd_protocol = "lvmlockd";
 static const int lvmlockd_protocol_version = 1;
 static int daemon_quit;
 static int adopt_opt;
+static int vg_hold_ms;			/* keep unlocked vg locks in the lm this long */
+
+/*
+ * Other hosts wanting a held vg lock see a conflict and retry every
+ * LOCK_RETRY_MS up to DEFAULT_MAX_RETRIES times, so a held lock must be
+ * released well within that.
+ */
+#define MAX_VG_HOLD_MS 1000
 static uint32_t adopt_update_count;
 static const char *adopt_file;
 
@@ -164,21 +172,30 @@ static socklen_t dump_addrlen;
  * Main program polls client connections, adds new clients,
  * adds work for client thread.
  *
+ * Client fds are in epoll with EPOLLONESHOT: once main_loop
+ * sees a request the fd is disabled until client_resume()
+ * rearms it, so nothing needs to wake up epoll_wait.
+ * The epoll data of each fd is the index (pi) of its slot.
+ *
  * pollfd_mutex is used for adding vs removing entries,
  * and for resume vs realloc.
  */
 #define POLL_FD_UNUSED -1		/* slot if free */
-#define POLL_FD_IGNORE -2		/* slot is used but ignore in poll */
+#define POLL_FD_IGNORE -2		/* slot is used but disabled in epoll */
 #define ADD_POLL_SIZE 16		/* increment slots by this amount */
+#define MAX_POLL_EVENTS 64		/* events taken by one epoll_wait */
+
+struct poll_slot {
+	int fd;
+	struct client *cl;		/* NULL for the listen fd */
+};
 
 static pthread_mutex_t pollfd_mutex;
-static struct pollfd *pollfd;
+static struct poll_slot *pollfd;
 static int pollfd_size;
-static int pollfd_maxi;
+static int epoll_fd = -1;
 static int listen_pi;
 static int listen_fd;
-static int restart_pi;
-static int restart_fds[2];
 
 /*
  * Each lockspace has its own thread to do locking.
@@ -196,9 +213,12 @@ static pthread_mutex_t client_mutex;
 static pthread_cond_t client_cond;
 static struct list_head client_list;    /* connected clients */
 static struct list_head client_results; /* actions to send back to clients */
+static struct list_head client_work_list; /* clients with recv or dead set */
 static uint32_t client_ids;             /* 0 and INTERNAL_CLIENT_ID are skipped */
 static int client_stop;                 /* stop the thread */
-static int client_work;                 /* a client on client_list has work to do */
+
+#define CLIENT_ID_HASH 256              /* find_client_id() buckets */
+static struct list_head client_id_hash[CLIENT_ID_HASH];
 
 #define INTERNAL_CLIENT_ID 0xFFFFFFFF   /* special client_id for internal actions */
 static struct list_head adopt_results;  /* special start actions from adopt_locks() */
@@ -253,6 +273,7 @@ static int alloc_new_structs; /* used for initializing in setup_structs */
 #define NO_FORCE 0
 
 static int add_lock_action(struct action *act);
+static int res_release_held(struct lockspace *ls, struct resource *r, uint32_t lmu_flags);
 static int str_to_lm(const char *str);
 static int setup_dump_socket(void);
 static void send_dump_buf(int fd, int dump_len);
@@ -316,6 +337,55 @@ static uint64_t monotime(void)
 	return ts.tv_sec;
 }
 
+static uint64_t monotime_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+		log_error("clock_gettime failed to get timestamp %s.",
+			  strerror(errno));
+		return 0;
+	}
+
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t monotime_us(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* ls->lat is updated by the lockspace thread and lock workers */
+static pthread_mutex_t lat_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void lat_record(struct lockspace *ls, int rt, int kind, uint64_t start_us)
+{
+	struct lat_hist *h;
+	uint64_t now = monotime_us();
+	uint64_t us = (now > start_us) ? now - start_us : 0;
+	int b = 0;
+
+	if (!start_us || (rt < LD_RT_GL) || (rt > LD_RT_LV))
+		return;
+
+	while ((b < LAT_BUCKETS - 1) && (us >> b))
+		b++;
+
+	pthread_mutex_lock(&lat_mutex);
+	h = &ls->lat[rt][kind];
+	h->count++;
+	h->sum_us += us;
+	if (us > h->max_us)
+		h->max_us = us;
+	h->buckets[b]++;
+	pthread_mutex_unlock(&lat_mutex);
+}
+
 static void log_save_line(int len, char *line,
 			  char *log_buf, unsigned int *point, unsigned int *wrap)
 {
@@ -434,9 +504,10 @@ static struct action *alloc_action(void)
 		unused_action_count--;
 	}
 	pthread_mutex_unlock(&unused_struct_mutex);
-	if (act)
+	if (act) {
 		memset(act, 0, sizeof(struct action));
-	else
+		act->start_us = monotime_us();
+	} else
 		log_error("out of memory for action");
 	return act;
 }
@@ -612,30 +683,37 @@ fail:
 	return -ENOMEM;
 }
 
-static int add_pollfd(int fd)
+/* (Re)enable fd in epoll, client fds are disabled after each event */
+static int arm_pollfd(int pi, int fd, int op)
 {
-	int i, new_size;
-	struct pollfd *tmp_pollfd;
+	struct epoll_event ev = { 0 };
 
-	pthread_mutex_lock(&pollfd_mutex);
-	for (i = 0; i < pollfd_size; i++) {
-		if (pollfd[i].fd != POLL_FD_UNUSED)
-			continue;
+	ev.events = EPOLLIN;
+	if (pollfd[pi].cl)
+		ev.events |= EPOLLONESHOT;
+	ev.data.u32 = pi;
 
-		pollfd[i].fd = fd;
-		pollfd[i].events = POLLIN;
-		pollfd[i].revents = 0;
+	if (epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+		log_error("epoll_ctl %d pi %d fd %d error %d", op, pi, fd, errno);
+		return -errno;
+	}
+	return 0;
+}
 
-		if (i > pollfd_maxi)
-			pollfd_maxi = i;
+static int add_pollfd(int fd, struct client *cl)
+{
+	int i, rv, new_size;
+	struct poll_slot *tmp_pollfd;
 
-		pthread_mutex_unlock(&pollfd_mutex);
-		return i;
+	pthread_mutex_lock(&pollfd_mutex);
+	for (i = 0; i < pollfd_size; i++) {
+		if (pollfd[i].fd == POLL_FD_UNUSED)
+			goto found;
 	}
 
 	new_size = pollfd_size + ADD_POLL_SIZE;
 
-	tmp_pollfd = realloc(pollfd, new_size * sizeof(struct pollfd));
+	tmp_pollfd = realloc(pollfd, new_size * sizeof(struct poll_slot));
 	if (!tmp_pollfd) {
 		log_error("can't alloc new size %d for pollfd", new_size);
 		pthread_mutex_unlock(&pollfd_mutex);
@@ -645,22 +723,26 @@ static int add_pollfd(int fd)
 
 	for (i = pollfd_size; i < new_size; i++) {
 		pollfd[i].fd = POLL_FD_UNUSED;
-		pollfd[i].events = 0;
-		pollfd[i].revents = 0;
+		pollfd[i].cl = NULL;
 	}
 
 	i = pollfd_size;
+	pollfd_size = new_size;
+found:
 	pollfd[i].fd = fd;
-	pollfd[i].events = POLLIN;
-	pollfd[i].revents = 0;
-	pollfd_maxi = i;
+	pollfd[i].cl = cl;
 
-	pollfd_size = new_size;
+	if ((rv = arm_pollfd(i, fd, EPOLL_CTL_ADD)) < 0) {
+		pollfd[i].fd = POLL_FD_UNUSED;
+		pollfd[i].cl = NULL;
+		i = rv;
+	}
 
 	pthread_mutex_unlock(&pollfd_mutex);
 	return i;
 }
 
+/* The fd is already closed, which also removed it from epoll */
 static void rem_pollfd(int pi)
 {
 	if (pi < 0) {
@@ -669,8 +751,7 @@ static void rem_pollfd(int pi)
 	}
 	pthread_mutex_lock(&pollfd_mutex);
 	pollfd[pi].fd = POLL_FD_UNUSED;
-	pollfd[pi].events = 0;
-	pollfd[pi].revents = 0;
+	pollfd[pi].cl = NULL;
 	pthread_mutex_unlock(&pollfd_mutex);
 }
 
@@ -1158,6 +1239,7 @@ static int res_lock(struct lockspace *ls, struct resource *r, struct action *act
 	struct lock *lk;
 	struct val_blk vb;
 	uint32_t new_version = 0;
+	uint64_t lm_start_us;
 	int inval_meta;
 	int rv = 0;
 
@@ -1170,13 +1252,31 @@ static int res_lock(struct lockspace *ls, struct resource *r, struct action *act
 	else
 		log_debug("S %s R %s res_lock cl %u mode %s", ls->name, r->name, act->client_id, mode_str(act->mode));
 
+	if (r->held) {
+		/*
+		 * Nobody on this host has used the lock since its last unlock,
+		 * and nobody else could take it, so the lvb is unchanged.
+		 */
+		if (r->mode == act->mode) {
+			log_debug("S %s R %s res_lock reuse held %s", ls->name, r->name, mode_str(r->mode));
+			r->held = 0;
+			ls->held_count--;
+			goto add_lk;
+		}
+
+		if ((rv = res_release_held(ls, r, 0)) < 0)
+			return rv;
+	}
+
 	if (r->mode == LD_LK_SH && act->mode == LD_LK_SH)
 		goto add_lk;
 
 	if (r->type == LD_RT_LV && act->lv_args[0])
 		memcpy(r->lv_args, act->lv_args, MAX_ARGS);
 
+	lm_start_us = monotime_us();
 	rv = lm_lock(ls, r, act->mode, act, &vb, retry, act->flags & LD_AF_ADOPT);
+	lat_record(ls, r->type, LAT_LM, lm_start_us);
 
 	if (r->use_vb)
 		log_debug("S %s R %s res_lock rv %d read vb %x %x %u",
@@ -1403,6 +1503,10 @@ add_lk:
 	if (r->mode == LD_LK_SH)
 		r->sh_count++;
 
+	/* Tell the client the VG seqno from the lvb, if it is known. */
+	if ((r->type == LD_RT_VG) && !r->version_zero_valid)
+		act->version = r->version;
+
 	if (!(lk = alloc_lock()))
 		return -ENOMEM;
 
@@ -1623,7 +1727,25 @@ do_unlock:
 		r_version = 0;
 	}
 
-	rv = lm_unlock(ls, r, act, r_version, 0);
+	/*
+	 * Keep a vg lock in the lm for a while after the last unlock, so
+	 * the next command on this host can take it without going to the
+	 * lm.  The new r_version is written when the lm lock is released.
+	 */
+	if (vg_hold_ms && (r->type == LD_RT_VG) &&
+	    (r->locks.next == &lk->list) && (lk->list.next == &r->locks)) {
+		if (r_version > r->held_version)
+			r->held_version = r_version;
+		r->held_until = monotime_ms() + vg_hold_ms;
+		r->held = 1;
+		ls->held_count++;
+		log_debug("S %s R %s res_unlock hold %s %d ms", ls->name, r->name,
+			  mode_str(r->mode), vg_hold_ms);
+		goto rem_lk;
+	}
+
+	/* act_close is shared by the lock workers, leave its lm_rv alone */
+	rv = lm_unlock(ls, r, (act->op == LD_OP_CLOSE) ? NULL : act, r_version, 0);
 	if (rv < 0) {
 		/* should never happen, retry? */
 		log_error("S %s R %s res_unlock lm error %d", ls->name, r->name, rv);
@@ -1636,12 +1758,65 @@ rem_lk:
 	list_del(&lk->list);
 	free_lock(lk);
 
-	if (list_empty(&r->locks))
+	if (list_empty(&r->locks) && !r->held)
 		r->mode = LD_LK_UN;
 
 	return 0;
 }
 
+/*
+ * Give a held vg lock back to the lm, writing any r_version that its
+ * unlock deferred.
+ */
+static int res_release_held(struct lockspace *ls, struct resource *r, uint32_t lmu_flags)
+{
+	uint32_t r_version = r->held_version;
+	int rv;
+
+	r->held = 0;
+	r->held_version = 0;
+	ls->held_count--;
+
+	log_debug("S %s R %s release held %s r_version %u", ls->name, r->name,
+		  mode_str(r->mode), r_version);
+
+	rv = lm_unlock(ls, r, NULL, r_version, lmu_flags);
+	if (rv < 0)
+		log_error("S %s R %s release held lm error %d", ls->name, r->name, rv);
+
+	r->mode = LD_LK_UN;
+
+	return rv;
+}
+
+/*
+ * Release the held locks whose time is up, returning the ms until the
+ * next one is due, or -1 if none remain.
+ */
+static int release_held_locks(struct lockspace *ls)
+{
+	struct resource *r;
+	uint64_t now;
+	int next = -1;
+
+	if (!ls->held_count)
+		return -1;
+
+	now = monotime_ms();
+
+	list_for_each_entry(r, &ls->resources, list) {
+		if (!r->held)
+			continue;
+
+		if (r->held_until <= now)
+			res_release_held(ls, r, 0);
+		else if ((next < 0) || (r->held_until - now < (uint64_t) next))
+			next = (int) (r->held_until - now);
+	}
+
+	return next;
+}
+
 static int res_update(struct lockspace *ls, struct resource *r,
 		      struct action *act)
 {
@@ -2055,11 +2230,11 @@ static void res_process(struct lockspace *ls, struct resource *r,
 	 * lv lock conflicts won't be transient so don't retry them.
 	 */
 
-	if (r->mode == LD_LK_EX)
+	if (r->mode == LD_LK_EX && !r->held)
 		return;
 
 	/*
-	 * r mode is SH or UN, pass lock-sh actions to lm
+	 * r mode is SH or UN (or held), pass lock-sh actions to lm
 	 */
 
 	list_for_each_entry_safe(act, safe, &r->actions, list) {
@@ -2081,6 +2256,7 @@ static void res_process(struct lockspace *ls, struct resource *r,
 			} else {
 				act->result = rv;
 				list_del(&act->list);
+				lat_record(ls, r->type, LAT_WAIT, act->start_us);
 				add_client_result(act);
 			}
 			if (rv == -EUNATCH)
@@ -2092,11 +2268,11 @@ static void res_process(struct lockspace *ls, struct resource *r,
 	 * r mode is SH, any ex lock action is blocked, just quit
 	 */
 
-	if (r->mode == LD_LK_SH)
+	if (r->mode == LD_LK_SH && !r->held)
 		return;
 
 	/*
-	 * r mode is UN, pass lock-ex action to lm
+	 * r mode is UN (or held), pass lock-ex action to lm
 	 */
 
 	list_for_each_entry_safe(act, safe, &r->actions, list) {
@@ -2114,6 +2290,7 @@ static void res_process(struct lockspace *ls, struct resource *r,
 			} else {
 				act->result = rv;
 				list_del(&act->list);
+				lat_record(ls, r->type, LAT_WAIT, act->start_us);
 				add_client_result(act);
 			}
 			if (rv == -EUNATCH)
@@ -2205,7 +2382,14 @@ static int clear_locks(struct lockspace *ls, int free_vg, int drop_vg)
 		if (r->mode == LD_LK_UN)
 			goto r_free;
 
-		if ((r->type == LD_RT_GL) && (r->mode == LD_LK_EX)) {
+		if (r->held) {
+			r->held = 0;
+			ls->held_count--;
+			r_version = (lk_version > r->held_version) ? lk_version : r->held_version;
+			log_debug("S %s R %s clear_locks held r_version %u",
+				  ls->name, r->name, r_version);
+
+		} else if ((r->type == LD_RT_GL) && (r->mode == LD_LK_EX)) {
 			r->version++;
 			r_version = r->version;
 			log_debug("S %s R %s clear_locks r_version inc %u",
@@ -2364,6 +2548,86 @@ static int process_op_during_kill(struct action *act)
 
 #define LOCK_RETRY_MS 1000 /* milliseconds to delay between retry */
 
+struct lock_worker {
+	pthread_t thread;
+	struct lockspace *ls;
+	struct list_head *act_close;
+	struct list_head resources;
+	int started;
+	int retry;
+};
+
+static void *lock_worker_main(void *arg_in)
+{
+	struct lock_worker *w = arg_in;
+	struct resource *r, *r2;
+
+	list_for_each_entry_safe(r, r2, &w->resources, list)
+		res_process(w->ls, r, w->act_close, &w->retry);
+
+	return NULL;
+}
+
+/*
+ * Like calling res_process for each resource, but the lv resources with
+ * work to do are handed to ls->lock_worker_count threads, so lm requests
+ * for different lvs wait on the lm at the same time.  An lv resource is
+ * only touched by its worker until all are joined, and gl/vg resources
+ * stay on the lockspace thread, which owns the rest of the ls state.
+ */
+static void res_process_workers(struct lockspace *ls, struct list_head *act_close, int *retry_out)
+{
+	struct lock_worker workers[MAX_LOCK_WORKERS];
+	struct lock_worker *w;
+	struct resource *r, *r2;
+	int count = ls->lock_worker_count;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		workers[i].ls = ls;
+		workers[i].act_close = act_close;
+		workers[i].started = 0;
+		workers[i].retry = 0;
+		INIT_LIST_HEAD(&workers[i].resources);
+	}
+
+	list_for_each_entry_safe(r, r2, &ls->resources, list) {
+		if ((r->type != LD_RT_LV) || (list_empty(&r->actions) && list_empty(act_close)))
+			continue;
+		list_del(&r->list);
+		list_add_tail(&r->list, &workers[resource_worker(r, count)].resources);
+	}
+
+	for (i = 0; i < count; i++) {
+		w = &workers[i];
+		if (list_empty(&w->resources))
+			continue;
+		if (pthread_create(&w->thread, NULL, lock_worker_main, w))
+			log_error("S %s lock worker %d create failed, running inline", ls->name, i);
+		else
+			w->started = 1;
+	}
+
+	list_for_each_entry_safe(r, r2, &ls->resources, list)
+		res_process(ls, r, act_close, retry_out);
+
+	for (i = 0; i < count; i++) {
+		w = &workers[i];
+		if (w->started)
+			pthread_join(w->thread, NULL);
+		else
+			lock_worker_main(w);
+
+		if (w->retry)
+			*retry_out = 1;
+
+		list_for_each_entry_safe(r, r2, &w->resources, list) {
+			list_del(&r->list);
+			list_add_tail(&r->list, &ls->resources);
+		}
+	}
+}
+
 static void *lockspace_thread_main(void *arg_in)
 {
 	struct lockspace *ls = arg_in;
@@ -2373,6 +2637,8 @@ static void *lockspace_thread_main(void *arg_in)
 	struct list_head tmp_act;
 	struct list_head act_close;
 	char tmp_name[MAX_NAME+5];
+	struct timespec hold_ts;
+	int hold_ms;
 	int free_vg = 0;
 	int drop_vg = 0;
 	int error = 0;
@@ -2449,13 +2715,33 @@ static void *lockspace_thread_main(void *arg_in)
 		goto out_act;
 
 	while (1) {
+		hold_ms = release_held_locks(ls);
+
 		pthread_mutex_lock(&ls->mutex);
 		while (!ls->thread_work) {
 			if (ls->thread_stop) {
 				pthread_mutex_unlock(&ls->mutex);
 				goto out_rem;
 			}
-			pthread_cond_wait(&ls->cond, &ls->mutex);
+			if (hold_ms < 0) {
+				pthread_cond_wait(&ls->cond, &ls->mutex);
+				continue;
+			}
+			/* wake up to release the next held lock */
+			clock_gettime(CLOCK_REALTIME, &hold_ts);
+			hold_ts.tv_sec += hold_ms / 1000;
+			hold_ts.tv_nsec += (hold_ms % 1000) * 1000000;
+			if (hold_ts.tv_nsec >= 1000000000) {
+				hold_ts.tv_sec++;
+				hold_ts.tv_nsec -= 1000000000;
+			}
+			if (pthread_cond_timedwait(&ls->cond, &ls->mutex, &hold_ts) == ETIMEDOUT)
+				break;
+		}
+
+		if (!ls->thread_work) {
+			pthread_mutex_unlock(&ls->mutex);
+			continue;
 		}
 
 		/*
@@ -2577,7 +2863,7 @@ static void *lockspace_thread_main(void *arg_in)
 					act->result = -ENOENT;
 				else {
 					act->result = 0;
-					act->mode = r->mode;
+					act->mode = r->held ? LD_LK_UN : r->mode;
 				}
 				list_del(&act->list);
 				add_client_result(act);
@@ -2628,6 +2914,9 @@ static void *lockspace_thread_main(void *arg_in)
 
 			list_add_tail(&act->list, &r->actions);
 
+			if (act->op == LD_OP_LOCK)
+				lat_record(ls, r->type, LAT_QUEUE, act->start_us);
+
 			log_debug("S %s R %s action %s %s", ls->name, r->name,
 				  op_str(act->op), mode_str(act->mode));
 		}
@@ -2640,8 +2929,11 @@ static void *lockspace_thread_main(void *arg_in)
 
 		retry = 0;
 
-		list_for_each_entry_safe(r, r2, &ls->resources, list)
-			res_process(ls, r, &act_close, &retry);
+		if (ls->lock_worker_count)
+			res_process_workers(ls, &act_close, &retry);
+		else
+			list_for_each_entry_safe(r, r2, &ls->resources, list)
+				res_process(ls, r, &act_close, &retry);
 
 		list_for_each_entry_safe(act, safe, &act_close, list) {
 			list_del(&act->list);
@@ -3558,8 +3850,13 @@ static void *worker_thread_main(void *arg_in)
 			add_client_result(act);
 
 		} else if (act->op == LD_OP_START_WAIT) {
+			/*
+			 * With the progress opt, reply at once with the number
+			 * of lockspaces still starting; the client repeats the
+			 * request until it is zero and reports progress.
+			 */
 			act->result = count_lockspace_starting(0);
-			if (!act->result)
+			if (!act->result || (act->flags & LD_AF_PROGRESS))
 				add_client_result(act);
 			else
 				list_add(&act->list, &delayed_list);
@@ -3687,16 +3984,12 @@ static void close_worker_thread(void)
 		log_error("pthread_join worker_thread error %d", perrno);
 }
 
-/* client_mutex is locked */
-static struct client *find_client_work(void)
+/* client_mutex is locked, client thread will handle cl->recv or cl->dead */
+static void queue_client_work(struct client *cl)
 {
-	struct client *cl;
-
-	list_for_each_entry(cl, &client_list, list) {
-		if (cl->recv || cl->dead)
-			return cl;
-	}
-	return NULL;
+	if (list_empty(&cl->work_list))
+		list_add_tail(&cl->work_list, &client_work_list);
+	pthread_cond_signal(&client_cond);
 }
 
 /* client_mutex is locked */
@@ -3704,38 +3997,13 @@ static struct client *find_client_id(uint32_t id)
 {
 	struct client *cl;
 
-	list_for_each_entry(cl, &client_list, list) {
+	list_for_each_entry(cl, &client_id_hash[id % CLIENT_ID_HASH], hash_list) {
 		if (cl->id == id)
 			return cl;
 	}
 	return NULL;
 }
 
-/* client_mutex is locked */
-static struct client *find_client_pi(int pi)
-{
-	struct client *cl;
-
-	list_for_each_entry(cl, &client_list, list) {
-		if (cl->pi == pi)
-			return cl;
-	}
-	return NULL;
-}
-
-/*
- * wake up poll() because we have added an fd
- * back into pollfd and poll() needs to be restarted
- * to recognize it.
- */
-static void restart_poll(void)
-{
-	int rv;
-	rv = write(restart_fds[1], "w", 1);
-	if (!rv || rv < 0)
-		log_debug("restart_poll write %d", errno);
-}
-
 /* poll will take requests from client again, cl->mutex must be held */
 static void client_resume(struct client *cl)
 {
@@ -3755,10 +4023,8 @@ static void client_resume(struct client *cl)
 			  cl->id, cl->pi, cl->fd);
 	}
 	pollfd[cl->pi].fd = cl->fd;
-	pollfd[cl->pi].events = POLLIN;
+	arm_pollfd(cl->pi, cl->fd, EPOLL_CTL_MOD);
 	pthread_mutex_unlock(&pollfd_mutex);
-
-	restart_poll();
 }
 
 /* called from client_thread, cl->mutex is held */
@@ -3919,11 +4185,12 @@ static int client_send_result(struct client *cl, struct action *act)
 					  "lock_type = %s", lm_str(act->lm_type),
 					  "op_result = " FMTd64, (int64_t) act->result,
 					  "lm_result = " FMTd64, (int64_t) act->lm_rv,
+					  "vg_version = " FMTd64, (int64_t) ((act->op == LD_OP_LOCK && act->rt == LD_RT_VG && !act->result) ? act->version : 0),
 					  "result_flags = %s", result_flags[0] ? result_flags : "none",
 					  NULL);
 	}
 
-	if (!buffer_write(cl->fd, &res.buffer)) {
+	if (!buffer_write_framed(cl->fd, &res.buffer, cl->framed)) {
 		rv = -errno;
 		if (rv >= 0)
 			rv = -1;
@@ -3944,6 +4211,74 @@ static int client_send_result(struct client *cl, struct action *act)
 	return rv;
 }
 
+/*
+ * The reply to lock_lv_batch has the usual fields for the request as a
+ * whole, and the op_result of each LV in an lv_results section, keyed by
+ * the position of the LV in the request.
+ */
+static int client_send_batch_result(struct client *cl, struct lock_batch *batch)
+{
+	/* Only used by client_thread, kept between batches */
+	static struct buffer reply;
+	struct action *act;
+	char name[16];
+	int lm_type = LD_LM_NONE;
+	int rv = 0;
+
+	if (cl->dead) {
+		log_debug("send cl %u skip dead", cl->id);
+		return -1;
+	}
+
+	list_for_each_entry(act, &batch->done, list) {
+		if (act->result == -EUNATCH)
+			act->result = -ENOLS;
+		if (!act->result)
+			lm_type = act->lm_type;
+	}
+
+	log_debug("send %s[%d] cl %u lock_lv_batch count %d",
+		  cl->name[0] ? cl->name : "client", cl->pid, cl->id, batch->count);
+
+	/* Written straight into the reply, it grows with the batch size */
+	buffer_reset(&reply);
+
+	if (!buffer_append_key_str(&reply, "response", "OK") ||
+	    !buffer_append_key_int(&reply, "op", LD_OP_LOCK) ||
+	    !buffer_append_key_str(&reply, "lock_type", lm_str(lm_type)) ||
+	    !buffer_append_key_int(&reply, "op_result", 0) ||
+	    !buffer_append_key_int(&reply, "lm_result", 0) ||
+	    !buffer_append_key_str(&reply, "result_flags", "none") ||
+	    !buffer_append_section(&reply, "lv_results"))
+		goto bad;
+
+	list_for_each_entry(act, &batch->done, list) {
+		(void) dm_snprintf(name, sizeof(name), "lv%d", act->batch_idx);
+		if (!buffer_append_key_int(&reply, name, act->result))
+			goto bad;
+	}
+
+	if (!buffer_append_section_end(&reply))
+		goto bad;
+
+	if (!buffer_write_framed(cl->fd, &reply, cl->framed)) {
+		rv = -errno;
+		if (rv >= 0)
+			rv = -1;
+		log_debug("send cl %u fd %d error %d", cl->id, cl->fd, rv);
+	}
+
+	client_resume(cl);
+
+	return rv;
+bad:
+	log_error("No memory for lock_lv_batch reply");
+	/* Drop the client, its LV locks are released as for a failed reply */
+	cl->dead = 1;
+	client_resume(cl);
+	return -ENOMEM;
+}
+
 /* called from client_thread */
 static void client_purge(struct client *cl)
 {
@@ -4093,6 +4428,99 @@ static int add_lock_action(struct action *act)
 	return 0;
 }
 
+static void free_lock_batch(struct lock_batch *batch)
+{
+	struct action *act, *safe;
+
+	list_for_each_entry_safe(act, safe, &batch->done, list) {
+		list_del(&act->list);
+		free_action(act);
+	}
+
+	free(batch);
+}
+
+/*
+ * lock_lv_batch carries the common fields of lock_lv and an "lvs" section
+ * with one subsection per LV (lv_name, lv_uuid, lv_lock_args).  Each LV
+ * becomes its own action copied from the template, so the lockspace
+ * thread handles them like individual lock_lv requests, but they are all
+ * queued at once and answered with a single reply.
+ */
+static struct lock_batch *alloc_lock_batch(struct action *tmpl, const struct dm_config_node *lvs)
+{
+	const struct dm_config_node *cn;
+	struct lock_batch *batch;
+	struct action *act;
+	const char *str;
+
+	if (!lvs || !lvs->child)
+		return NULL;
+
+	if (!(batch = zalloc(sizeof(*batch)))) {
+		log_error("No memory for lock batch");
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&batch->done);
+
+	for (cn = lvs->child; cn; cn = cn->sib) {
+		if (!(act = alloc_action())) {
+			free_lock_batch(batch);
+			return NULL;
+		}
+
+		memcpy(act, tmpl, sizeof(struct action));
+		act->path = NULL;
+		act->batch = batch;
+		act->batch_idx = batch->count++;
+		memset(act->lv_name, 0, sizeof(act->lv_name));
+		memset(act->lv_uuid, 0, sizeof(act->lv_uuid));
+		memset(act->lv_args, 0, sizeof(act->lv_args));
+
+		str = dm_config_find_str(cn->child, "lv_name", NULL);
+		if (str && strcmp(str, "none"))
+			strncpy(act->lv_name, str, MAX_NAME);
+
+		str = dm_config_find_str(cn->child, "lv_uuid", NULL);
+		if (str && strcmp(str, "none"))
+			strncpy(act->lv_uuid, str, MAX_NAME);
+
+		str = dm_config_find_str(cn->child, "lv_lock_args", NULL);
+		if (str && strcmp(str, "none"))
+			strncpy(act->lv_args, str, MAX_ARGS);
+
+		/* Held on the done list until add_lock_batch hands them out */
+		list_add_tail(&act->list, &batch->done);
+	}
+
+	batch->pending = batch->count;
+
+	return batch;
+}
+
+/*
+ * Called from the client thread, which is also the only one to collect
+ * results, so no member can complete before all of them are queued.
+ */
+static void add_lock_batch(struct lock_batch *batch)
+{
+	struct action *act, *safe;
+	int rv;
+
+	list_for_each_entry_safe(act, safe, &batch->done, list) {
+		list_del(&act->list);
+
+		log_debug("recv batch %d/%d lv \"%s\" mode %s",
+			  act->batch_idx + 1, batch->count, act->lv_name, mode_str(act->mode));
+
+		if ((rv = add_lock_action(act)) < 0) {
+			act->result = rv;
+			add_client_result(act);
+		}
+	}
+}
+
 static int str_to_op_rt(const char *req_name, int *op, int *rt)
 {
 	if (!req_name)
@@ -4178,6 +4606,11 @@ static int str_to_op_rt(const char *req_name, int *op, int *rt)
 		*rt = LD_RT_LV;
 		return 0;
 	}
+	if (!strcmp(req_name, "lock_lv_batch")) {
+		*op = LD_OP_LOCK;
+		*rt = LD_RT_LV;
+		return 0;
+	}
 	if (!strcmp(req_name, "vg_update")) {
 		*op = LD_OP_UPDATE;
 		*rt = LD_RT_VG;
@@ -4291,6 +4724,8 @@ static uint32_t str_to_opts(const char *str)
 		flags |= LD_AF_ENABLE;
 	if (strstr(str, "disable"))
 		flags |= LD_AF_DISABLE;
+	if (strstr(str, "progress"))
+		flags |= LD_AF_PROGRESS;
 out:
 	return flags;
 }
@@ -4462,13 +4897,15 @@ static int print_resource(struct resource *r, const char *prefix, int pos, int l
 			"type=%s "
 			"mode=%s "
 			"sh_count=%d "
-			"version=%u\n",
+			"version=%u "
+			"held=%d\n",
 			prefix,
 			r->name,
 			rt_str(r->type),
 			mode_str(r->mode),
 			r->sh_count,
-			r->version);
+			r->version,
+			r->held ? 1 : 0);
 }
 
 static int print_lock(struct lock *lk, const char *prefix, int pos, int len)
@@ -4486,6 +4923,58 @@ static int print_lock(struct lock *lk, const char *prefix, int pos, int len)
 			lk->client_id);
 }
 
+static const char *lat_kind_str(int kind)
+{
+	switch (kind) {
+	case LAT_QUEUE:
+		return "queue";
+	case LAT_LM:
+		return "lm";
+	case LAT_WAIT:
+		return "wait";
+	}
+	return ".";
+}
+
+/* Latency histogram of one resource type of a lockspace, see struct lat_hist */
+static int print_lat(struct lockspace *ls, int rt, int kind, const char *prefix, int pos, int len)
+{
+	struct lat_hist *h = &ls->lat[rt][kind];
+	int last = LAT_BUCKETS - 1;
+	int ret, i;
+
+	while (last && !h->buckets[last])
+		last--;
+
+	ret = snprintf(dump_buf + pos, len - pos,
+		       "info=%s "
+		       "ls_name=%s "
+		       "lm_type=%s "
+		       "rt=%s "
+		       "kind=%s "
+		       "count=%llu "
+		       "sum_us=%llu "
+		       "max_us=%llu "
+		       "buckets=",
+		       prefix,
+		       ls->name,
+		       lm_str(ls->lm_type),
+		       rt_str(rt),
+		       lat_kind_str(kind),
+		       (unsigned long long)h->count,
+		       (unsigned long long)h->sum_us,
+		       (unsigned long long)h->max_us);
+
+	for (i = 0; (i <= last) && (ret < len - pos); i++)
+		ret += snprintf(dump_buf + pos + ret, len - pos - ret,
+				"%s%u", i ? "," : "", h->buckets[i]);
+
+	if (ret < len - pos)
+		ret += snprintf(dump_buf + pos + ret, len - pos - ret, "\n");
+
+	return ret;
+}
+
 static int dump_info(int *dump_len)
 {
 	struct client *cl;
@@ -4494,6 +4983,7 @@ static int dump_info(int *dump_len)
 	struct lock *lk;
 	struct action *act;
 	int len, pos, ret;
+	int rt, kind;
 	int rv = 0;
 
 	memset(dump_buf, 0, sizeof(dump_buf));
@@ -4580,6 +5070,22 @@ static int dump_info(int *dump_len)
 				pos += ret;
 			}
 		}
+
+		pthread_mutex_lock(&lat_mutex);
+		for (rt = LD_RT_GL; rt <= LD_RT_LV; rt++) {
+			for (kind = 0; kind < LAT_KINDS; kind++) {
+				if (!ls->lat[rt][kind].count)
+					continue;
+				ret = print_lat(ls, rt, kind, "lat", pos, len);
+				if (ret >= len - pos) {
+					pthread_mutex_unlock(&lat_mutex);
+					rv = -ENOSPC;
+					goto out;
+				}
+				pos += ret;
+			}
+		}
+		pthread_mutex_unlock(&lat_mutex);
 	}
 out:
 	pthread_mutex_unlock(&lockspaces_mutex);
@@ -4606,11 +5112,13 @@ static void client_recv_action(struct client *cl)
 	int result = 0;
 	int cl_pid;
 	int op, rt, lm, mode;
+	int is_batch;
+	struct lock_batch *batch = NULL;
 	int rv;
 
 	buffer_init(&req.buffer);
 
-	rv = buffer_read(cl->fd, &req.buffer);
+	rv = buffer_read_framed(cl->fd, &req.buffer, cl->framed);
 	if (!rv) {
 		if (errno == ECONNRESET) {
 			log_debug("client recv %u ECONNRESET", cl->id);
@@ -4641,6 +5149,8 @@ static void client_recv_action(struct client *cl)
 		return;
 	}
 
+	is_batch = !strcmp(str, "lock_lv_batch");
+
 	if (op == LD_OP_HELLO || op == LD_OP_QUIT) {
 
 		/*
@@ -4662,12 +5172,27 @@ static void client_recv_action(struct client *cl)
 
 		buffer_init(&res.buffer);
 
-		res = daemon_reply_simple("OK",
-					  "result = " FMTd64, (int64_t) result,
-					  "protocol = %s", lvmlockd_protocol,
-					  "version = " FMTd64, (int64_t) lvmlockd_protocol_version,
-					  NULL);
-		buffer_write(cl->fd, &res.buffer);
+		if ((op == LD_OP_HELLO) &&
+		    !strcmp(daemon_request_str(req, DAEMON_FRAMING_PARAM, ""), DAEMON_FRAMING_LENGTH)) {
+			res = daemon_reply_simple("OK",
+						  "result = " FMTd64, (int64_t) result,
+						  "protocol = %s", lvmlockd_protocol,
+						  "version = " FMTd64, (int64_t) lvmlockd_protocol_version,
+						  "lock_lv_batch = " FMTd64, (int64_t) 1,
+						  DAEMON_FRAMING_PARAM " = %s", DAEMON_FRAMING_LENGTH,
+						  NULL);
+			buffer_write_framed(cl->fd, &res.buffer, cl->framed);
+			/* hello is answered as it came, framing starts with the next request */
+			cl->framed = 1;
+		} else {
+			res = daemon_reply_simple("OK",
+						  "result = " FMTd64, (int64_t) result,
+						  "protocol = %s", lvmlockd_protocol,
+						  "version = " FMTd64, (int64_t) lvmlockd_protocol_version,
+						  "lock_lv_batch = " FMTd64, (int64_t) 1,
+						  NULL);
+			buffer_write_framed(cl->fd, &res.buffer, cl->framed);
+		}
 		buffer_destroy(&res.buffer);
 		dm_config_destroy(req.cft);
 		buffer_destroy(&req.buffer);
@@ -4758,6 +5283,9 @@ static void client_recv_action(struct client *cl)
 
 	act->max_retries = daemon_request_int(req, "max_retries", DEFAULT_MAX_RETRIES);
 
+	if (is_batch)
+		batch = alloc_lock_batch(act, dm_config_find_node(req.cft->root, "lvs"));
+
 	dm_config_destroy(req.cft);
 	buffer_destroy(&req.buffer);
 
@@ -4780,6 +5308,17 @@ static void client_recv_action(struct client *cl)
 	if (act->op == LD_OP_LOCK && act->mode != LD_LK_UN)
 		cl->lock_ops = 1;
 
+	if (is_batch) {
+		if (!batch) {
+			rv = -EINVAL;
+			goto out;
+		}
+		/* The members carry the request from here, each is replied to in the batch */
+		add_lock_batch(batch);
+		free_action(act);
+		return;
+	}
+
 	switch (act->op) {
 	case LD_OP_START:
 		rv = add_lockspace(act);
@@ -4820,23 +5359,57 @@ static void client_recv_action(struct client *cl)
 	};
 
 out:
+	if (batch)
+		free_lock_batch(batch);
+
 	if (rv < 0) {
 		act->result = rv;
 		add_client_result(act);
 	}
 }
 
+/* called from client_thread once the result of act has gone to the client */
+static void client_result_sent(struct action *act, int rv, uint32_t *lock_acquire_count)
+{
+	struct action *act_un;
+
+	if (act->flags & LD_AF_LV_LOCK)
+		(*lock_acquire_count)++;
+
+	/*
+	 * The client failed after we acquired an LV lock for
+	 * it, but before getting this reply saying it's done.
+	 * So the lv will not be active and we should release
+	 * the lv lock it requested.
+	 */
+	if ((rv < 0) && (act->flags & LD_AF_LV_LOCK)) {
+		log_debug("auto unlock lv for failed client %u", act->client_id);
+		if ((act_un = alloc_action())) {
+			memcpy(act_un, act, sizeof(struct action));
+			act_un->batch = NULL;
+			act_un->path = NULL;
+			act_un->mode = LD_LK_UN;
+			act_un->flags |= LD_AF_LV_UNLOCK;
+			act_un->flags &= ~LD_AF_LV_LOCK;
+			add_lock_action(act_un);
+		}
+	}
+
+	free_action(act);
+}
+
 static void *client_thread_main(void *arg_in)
 {
 	struct client *cl;
 	struct action *act;
 	struct action *act_un;
+	struct lock_batch *batch;
 	uint32_t lock_acquire_count = 0, lock_acquire_written = 0;
-	int rv;
+	int rv, dead;
 
 	while (1) {
 		pthread_mutex_lock(&client_mutex);
-		while (!client_work && list_empty(&client_results)) {
+		while (list_empty(&client_work_list) && list_empty(&client_results)) {
 			if (client_stop) {
 				pthread_mutex_unlock(&client_mutex);
 				goto out;
@@ -4851,39 +5424,46 @@ static void *client_thread_main(void *arg_in)
 		if (!list_empty(&client_results)) {
 			act = list_first_entry(&client_results, struct action, list);
 			list_del(&act->list);
+
+			/* A batch is answered once, when its last member is done */
+			if ((batch = act->batch)) {
+				list_add_tail(&act->list, &batch->done);
+				if (--batch->pending) {
+					pthread_mutex_unlock(&client_mutex);
+					continue;
+				}
+			}
+
 			cl = find_client_id(act->client_id);
 			pthread_mutex_unlock(&client_mutex);
 
 			if (cl) {
 				pthread_mutex_lock(&cl->mutex);
-				rv = client_send_result(cl, act);
+				rv = batch ? client_send_batch_result(cl, batch) : client_send_result(cl, act);
+				dead = cl->dead;
 				pthread_mutex_unlock(&cl->mutex);
+
+				/* a failed reply may drop the client */
+				if (dead) {
+					pthread_mutex_lock(&client_mutex);
+					queue_client_work(cl);
+					pthread_mutex_unlock(&client_mutex);
+				}
 			} else {
 				log_debug("no client %u for result", act->client_id);
 				rv = -1;
 			}
 
-			if (act->flags & LD_AF_LV_LOCK)
-				lock_acquire_count++;
-
-			/*
-			 * The client failed after we acquired an LV lock for
-			 * it, but before getting this reply saying it's done.
-			 * So the lv will not be active and we should release
-			 * the lv lock it requested.
-			 */
-			if ((rv < 0) && (act->flags & LD_AF_LV_LOCK)) {
-				log_debug("auto unlock lv for failed client %u", act->client_id);
-				if ((act_un = alloc_action())) {
-					memcpy(act_un, act, sizeof(struct action));
-					act_un->mode = LD_LK_UN;
-					act_un->flags |= LD_AF_LV_UNLOCK;
-					act_un->flags &= ~LD_AF_LV_LOCK;
-					add_lock_action(act_un);
-				}
+			if (!batch) {
+				client_result_sent(act, rv, &lock_acquire_count);
+				continue;
 			}
 
-			free_action(act);
+			list_for_each_entry_safe(act, act_un, &batch->done, list) {
+				list_del(&act->list);
+				client_result_sent(act, rv, &lock_acquire_count);
+			}
+			free(batch);
 			continue;
 		}
 
@@ -4896,15 +5476,11 @@ static void *client_thread_main(void *arg_in)
 		 * Queue incoming actions for lockspace threads
 		 */
 
-		if (client_work) {
-			cl = find_client_work();
-			if (!cl)
-				client_work = 0;
+		if (!list_empty(&client_work_list)) {
+			cl = list_first_entry(&client_work_list, struct client, work_list);
+			list_del_init(&cl->work_list);
 			pthread_mutex_unlock(&client_mutex);
 
-			if (!cl)
-				continue;
-
 			pthread_mutex_lock(&cl->mutex);
 
 			if (cl->recv) {
@@ -4953,6 +5529,7 @@ static void *client_thread_main(void *arg_in)
 
 				pthread_mutex_lock(&client_mutex);
 				list_del(&cl->list);
+				list_del(&cl->hash_list);
 				pthread_mutex_unlock(&client_mutex);
 
 				client_purge(cl);
@@ -4972,10 +5549,13 @@ out:
 
 static int setup_client_thread(void)
 {
-	int rv;
+	int i, rv;
 
 	INIT_LIST_HEAD(&client_list);
 	INIT_LIST_HEAD(&client_results);
+	INIT_LIST_HEAD(&client_work_list);
+	for (i = 0; i < CLIENT_ID_HASH; i++)
+		INIT_LIST_HEAD(&client_id_hash[i]);
 
 	pthread_mutex_init(&client_mutex, NULL);
 	pthread_cond_init(&client_cond, NULL);
@@ -5776,19 +6356,16 @@ static void process_listener(int poll_fd)
 		return;
 	}
 
-	pi = add_pollfd(fd);
-	if (pi < 0) {
-		log_error("process_listener add_pollfd error %d", pi);
-		free_client(cl);
-		return;
-	}
-
-	cl->pi = pi;
 	cl->fd = fd;
 	cl->pid = get_peer_pid(fd);
+	INIT_LIST_HEAD(&cl->work_list);
 
 	pthread_mutex_init(&cl->mutex, NULL);
 
+	/*
+	 * The client is on the lists before its fd is in epoll, and
+	 * main_loop is the only thread that looks up clients by pi.
+	 */
 	pthread_mutex_lock(&client_mutex);
 	client_ids++;
 
@@ -5799,43 +6376,24 @@ static void process_listener(int poll_fd)
 
 	cl->id = client_ids;
 	list_add_tail(&cl->list, &client_list);
+	list_add_tail(&cl->hash_list, &client_id_hash[cl->id % CLIENT_ID_HASH]);
 	pthread_mutex_unlock(&client_mutex);
 
-	log_debug("new cl %u pi %d fd %d", cl->id, cl->pi, cl->fd);
-}
-
-/*
- * main loop polls on pipe[0] so that a thread can
- * restart the poll by writing to pipe[1].
- */
-static int setup_restart(void)
-{
-	if (pipe(restart_fds)) {
-		log_error("setup_restart pipe error %d", errno);
-		return -1;
+	pi = add_pollfd(fd, cl);
+	if (pi < 0) {
+		log_error("process_listener add_pollfd error %d", pi);
+		pthread_mutex_lock(&client_mutex);
+		list_del(&cl->list);
+		list_del(&cl->hash_list);
+		pthread_mutex_unlock(&client_mutex);
+		if (close(fd))
+			log_error("failed to close lockd poll fd");
+		free_client(cl);
+		return;
 	}
+	cl->pi = pi;
 
-	restart_pi = add_pollfd(restart_fds[0]);
-	if (restart_pi < 0)
-		return restart_pi;
-
-	return 0;
-}
-
-/*
- * thread wrote 'w' to restart_fds[1] to restart poll()
- * after adding an fd back into pollfd.
- */
-static void process_restart(int fd)
-{
-	char wake[1];
-	int rv;
-
-	/* assert fd == restart_fds[0] */
-
-	rv = read(restart_fds[0], wake, 1);
-	if (!rv || rv < 0)
-		log_debug("process_restart error %d", errno);
+	log_debug("new cl %u pi %d fd %d", cl->id, cl->pi, cl->fd);
 }
 
 static void sigterm_handler(int sig __attribute__((unused)))
@@ -5845,8 +6403,9 @@ static void sigterm_handler(int sig __attribute__((unused)))
 
 static int main_loop(daemon_state *ds_arg)
 {
+	struct epoll_event events[MAX_POLL_EVENTS];
 	struct client *cl;
-	int i, rv, is_recv, is_dead;
+	int i, n, pi, rv, is_recv, is_dead;
 
 	signal(SIGTERM, &sigterm_handler);
 
@@ -5866,12 +6425,17 @@ static int main_loop(daemon_state *ds_arg)
 	openlog("lvmlockd", LOG_CONS | LOG_PID, LOG_DAEMON);
 	log_warn("lvmlockd started");
 
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		log_error("epoll_create error %d", errno);
+		return -errno;
+	}
+
 	listen_fd = ds_arg->socket_fd;
-	listen_pi = add_pollfd(listen_fd);
+	listen_pi = add_pollfd(listen_fd, NULL);
 
 	setup_client_thread();
 	setup_worker_thread();
-	setup_restart();
 
 #ifdef USE_SD_NOTIFY
 	sd_notify(0, "READY=1");
@@ -5885,7 +6449,7 @@ static int main_loop(daemon_state *ds_arg)
 		adopt_locks();
 
 	while (1) {
-		rv = poll(pollfd, pollfd_maxi + 1, -1);
+		rv = epoll_wait(epoll_fd, events, MAX_POLL_EVENTS, -1);
 		if ((rv == -1 && errno == EINTR) || daemon_quit) {
 			if (daemon_quit) {
 				int count;
@@ -5900,42 +6464,41 @@ static int main_loop(daemon_state *ds_arg)
 			continue;
 		}
 		if (rv < 0) {
-			log_error("poll errno %d", errno);
+			log_error("epoll_wait errno %d", errno);
 			break;
 		}
 
-		for (i = 0; i <= pollfd_maxi; i++) {
-			if (pollfd[i].fd < 0)
+		n = rv;
+
+		for (i = 0; i < n; i++) {
+			pi = events[i].data.u32;
+
+			if (pollfd[pi].fd < 0)
 				continue;
 
 			is_recv = 0;
 			is_dead = 0;
 
-			if (pollfd[i].revents & POLLIN)
+			if (events[i].events & EPOLLIN)
 				is_recv = 1;
-			if (pollfd[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+			if (events[i].events & (EPOLLERR | EPOLLHUP))
 				is_dead = 1;
 
 			if (!is_recv && !is_dead)
 				continue;
 
-			if (i == listen_pi) {
-				process_listener(pollfd[i].fd);
-				continue;
-			}
-
-			if (i == restart_pi) {
-				process_restart(pollfd[i].fd);
+			if (pi == listen_pi) {
+				process_listener(pollfd[pi].fd);
 				continue;
 			}
 
 			/*
-			log_debug("poll pi %d fd %d revents %x",
-				  i, pollfd[i].fd, pollfd[i].revents);
+			log_debug("poll pi %d fd %d events %x",
+				  pi, pollfd[pi].fd, events[i].events);
 			*/
 
 			pthread_mutex_lock(&client_mutex);
-			cl = find_client_pi(i);
+			cl = pollfd[pi].cl;
 			if (cl) {
 				pthread_mutex_lock(&cl->mutex);
 
@@ -5955,48 +6518,40 @@ static int main_loop(daemon_state *ds_arg)
 					cl->pi = -1;
 					cl->fd = -1;
 					cl->poll_ignore = 0;
-					if (close(pollfd[i].fd))
-						log_error("close fd %d failed", pollfd[i].fd);
-					pollfd[i].fd = POLL_FD_UNUSED;
-					pollfd[i].events = 0;
-					pollfd[i].revents = 0;
+					if (close(pollfd[pi].fd))
+						log_error("close fd %d failed", pollfd[pi].fd);
+					rem_pollfd(pi);
 
 				} else if (is_recv) {
+					/* EPOLLONESHOT disabled the fd until client_resume */
 					cl->recv = 1;
 					cl->poll_ignore = 1;
-					pollfd[i].fd = POLL_FD_IGNORE;
-					pollfd[i].events = 0;
-					pollfd[i].revents = 0;
+					pollfd[pi].fd = POLL_FD_IGNORE;
 				}
 
 				pthread_mutex_unlock(&cl->mutex);
 
-				client_work = 1;
-				pthread_cond_signal(&client_cond);
-
-				/* client_thread will pick up and work on any
+				/* client_thread will pick up and work on the
 				   client with cl->recv or cl->dead set */
+				queue_client_work(cl);
 
 			} else {
 				/* don't think this can happen */
 				log_error("no client for index %d fd %d",
-					  i, pollfd[i].fd);
-				if (close(pollfd[i].fd))
-					log_error("close fd %d failed", pollfd[i].fd);
-				pollfd[i].fd = POLL_FD_UNUSED;
-				pollfd[i].events = 0;
-				pollfd[i].revents = 0;
+					  pi, pollfd[pi].fd);
+				if (close(pollfd[pi].fd))
+					log_error("close fd %d failed", pollfd[pi].fd);
+				rem_pollfd(pi);
 			}
 			pthread_mutex_unlock(&client_mutex);
-
-			/* After set_dead, should we scan pollfd for
-			   last unused slot and reduce pollfd_maxi? */
 		}
 	}
 
 	for_each_lockspace_retry(DO_STOP, DO_FREE, DO_FORCE);
 	close_worker_thread();
 	close_client_thread();
+	if (close(epoll_fd))
+		log_error("close epoll fd failed");
 	closelog();
 	return 1; /* libdaemon uses 1 for success */
 }
@@ -6033,6 +6588,10 @@ static void usage(char *prog, FILE *file)
 	fprintf(file, "        Set the sanlock lockspace I/O timeout.\n");
 	fprintf(file, "  --adopt | -A 0|1\n");
 	fprintf(file, "        Adopt locks from a previous instance of lvmlockd.\n");
+	fprintf(file, "  --lock-workers | -w <num>\n");
+	fprintf(file, "        Threads per sanlock VG for LV locks, up to %d. [0]\n", MAX_LOCK_WORKERS);
+	fprintf(file, "  --vg-hold-time | -H <milliseconds>\n");
+	fprintf(file, "        Keep VG locks in the lock manager after unlock, up to %d. [0]\n", MAX_VG_HOLD_MS);
 }
 
 int main(int argc, char *argv[])
@@ -6063,6 +6622,8 @@ int main(int argc, char *argv[])
 		{"adopt",           required_argument, 0, 'A' },
 		{"syslog-priority", required_argument, 0, 'S' },
 		{"sanlock-timeout", required_argument, 0, 'o' },
+		{"vg-hold-time",    required_argument, 0, 'H' },
+		{"lock-workers",    required_argument, 0, 'w' },
 		{0, 0, 0, 0 }
 	};
 
@@ -6071,7 +6632,7 @@ int main(int argc, char *argv[])
 		int lm;
 		int option_index = 0;
 
-		c = getopt_long(argc, argv, "hVTfDp:s:l:g:S:I:A:o:",
+		c = getopt_long(argc, argv, "hVTfDp:s:l:g:S:I:A:o:H:w:",
 				long_options, &option_index);
 		if (c == -1)
 			break;
@@ -6127,6 +6688,20 @@ int main(int argc, char *argv[])
 		case 'A':
 			adopt_opt = atoi(optarg);
 			break;
+		case 'w':
+			lock_workers = atoi(optarg);
+			if (lock_workers < 0 || lock_workers > MAX_LOCK_WORKERS) {
+				fprintf(stderr, "invalid lock-workers option\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'H':
+			vg_hold_ms = atoi(optarg);
+			if (vg_hold_ms < 0 || vg_hold_ms > MAX_VG_HOLD_MS) {
+				fprintf(stderr, "invalid vg-hold-time option\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'S':
 			syslog_priority = _syslog_name_to_num(optarg);
 			break;
@@ -81,6 +81,8 @@ struct list_head {
 
 struct client {
 	struct list_head list;
+	struct list_head work_list;	/* on client_work_list */
+	struct list_head hash_list;	/* on client_id_hash */
 	pthread_mutex_t mutex;
 	int pid;
 	int fd;
@@ -90,6 +92,7 @@ struct client {
 	unsigned int dead : 1;
 	unsigned int poll_ignore : 1;
 	unsigned int lock_ops : 1;
+	unsigned int framed : 1;	/* length framing agreed in hello */
 	char name[MAX_NAME+1];
 };
 
@@ -110,6 +113,7 @@ struct client {
 #define LD_AF_LV_LOCK              0x00040000
 #define LD_AF_LV_UNLOCK            0x00080000
 #define LD_AF_SH_EXISTS            0x00100000
+#define LD_AF_PROGRESS             0x00200000
 
 /*
  * Number of times to repeat a lock request after
@@ -118,8 +122,21 @@ struct client {
  */
 #define DEFAULT_MAX_RETRIES 4
 
+/*
+ * LV lock requests that arrived in one lock_lv_batch message.
+ * The client thread collects the results on the done list and
+ * sends one reply when the last of them comes back.
+ */
+struct lock_batch {
+	struct list_head done;
+	int count;
+	int pending;
+};
+
 struct action {
 	struct list_head list;
+	struct lock_batch *batch;	/* set for lock_lv_batch members */
+	int batch_idx;
 	uint32_t client_id;
 	uint32_t flags;			/* LD_AF_ */
 	uint32_t version;
@@ -130,6 +147,7 @@ struct action {
 	int8_t lm_type;			/* lock manager: LM_DLM, LM_SANLOCK */
 	int retries;
 	int max_retries;
+	uint64_t start_us;		/* when the request was received */
 	int result;
 	int lm_rv;			/* return value from lm_ function */
 	char *path;
@@ -155,6 +173,9 @@ struct resource {
 	unsigned int adopt : 1;		/* temp flag in remove_inactive_lvs */
 	unsigned int version_zero_valid : 1;
 	unsigned int use_vb : 1;
+	unsigned int held : 1;		/* lm lock kept after the last unlock */
+	uint32_t held_version;		/* r_version for the lm unlock of a held lock */
+	uint64_t held_until;		/* monotonic ms when a held lock is released */
 	struct list_head locks;
 	struct list_head actions;
 	char lv_args[MAX_ARGS+1];
@@ -171,6 +192,25 @@ struct lock {
 	uint32_t client_id; /* may be 0 for persistent or internal locks */
 };
 
+/*
+ * Lock latency histograms, kept per lockspace and resource type and
+ * printed by dump_info.  Bucket i counts latencies of at least
+ * 2^(i-1) and below 2^i usec, the last bucket all longer ones.
+ */
+#define LAT_BUCKETS	28
+
+#define LAT_QUEUE	0	/* request received until the lockspace thread takes it */
+#define LAT_LM		1	/* lock manager lock call */
+#define LAT_WAIT	2	/* request received until its lock result */
+#define LAT_KINDS	3
+
+struct lat_hist {
+	uint64_t count;
+	uint64_t sum_us;
+	uint64_t max_us;
+	uint32_t buckets[LAT_BUCKETS];
+};
+
 struct lockspace {
 	struct list_head list;		/* lockspaces */
 	char name[MAX_NAME+1];
@@ -199,9 +239,13 @@ struct lockspace {
 	unsigned int free_vg: 1;
 	unsigned int kill_vg: 1;
 	unsigned int drop_vg: 1;
+	unsigned int held_count;	/* resources with a held lm lock */
+	int lock_worker_count;		/* lv locks handled by this many threads */
 
 	struct list_head actions;	/* new client actions */
 	struct list_head resources;	/* resource/lock state for gl/vg/lv */
+
+	struct lat_hist lat[LD_RT_LV + 1][LAT_KINDS];	/* by LD_RT_, see lat_mutex */
 };
 
 /* val_blk version */
@@ -256,6 +300,12 @@ static inline void list_del(struct list_head *entry)
 	__list_del(entry->prev, entry->next);
 }
 
+static inline void list_del_init(struct list_head *entry)
+{
+	__list_del(entry->prev, entry->next);
+	INIT_LIST_HEAD(entry);
+}
+
 static inline int list_empty(const struct list_head *head)
 {
 	return head->next == head;
@@ -335,6 +385,24 @@ EXTERN int daemon_debug;
 EXTERN int daemon_host_id;
 EXTERN const char *daemon_host_id_file;
 EXTERN int sanlock_io_timeout;
+EXTERN int lock_workers; /* threads per sanlock lockspace for lv locks */
+
+#define MAX_LOCK_WORKERS 16
+
+/*
+ * An lv resource is always handled by the same lock worker, so the
+ * lm connection of that worker is the only one used for its lock.
+ */
+static inline int resource_worker(const struct resource *r, int count)
+{
+	const unsigned char *p = (const unsigned char *) r->name;
+	uint32_t h = 5381;
+
+	while (*p)
+		h = h * 33 + *p++;
+
+	return h % count;
+}
 
 /*
  * This flag is set to 1 if we see multiple vgs with the global
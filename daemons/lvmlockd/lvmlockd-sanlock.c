@@ -161,8 +161,32 @@ struct lm_sanlock {
 	int sector_size;
 	int align_size;
 	int sock; /* sanlock daemon connection */
+	int lock_socks[MAX_LOCK_WORKERS]; /* connections of the lv lock workers */
+	int lock_sock_count;
+	uint8_t *lease_used; /* bitmap of lv lease slots seen in use */
+	uint32_t lease_slots; /* number of slots lease_used covers */
 };
 
+/* lv locks are acquired and released on the connection of their worker */
+static int _lock_sock(struct lm_sanlock *lms, struct resource *r)
+{
+	if ((r->type == LD_RT_LV) && lms->lock_sock_count)
+		return lms->lock_socks[resource_worker(r, lms->lock_sock_count)];
+
+	return lms->sock;
+}
+
+static void _close_lock_socks(struct lm_sanlock *lms)
+{
+	int i;
+
+	for (i = 0; i < lms->lock_sock_count; i++)
+		if (close(lms->lock_socks[i]))
+			log_error("failed to close sanlock daemon socket connection");
+
+	lms->lock_sock_count = 0;
+}
+
 struct rd_sanlock {
 	union {
 		struct sanlk_resource rs;
@@ -997,9 +1021,54 @@ int lm_rename_vg_sanlock(char *ls_name, char *vg_name, uint32_t flags, char *vg_
 	return 0;
 }
 
+/*
+ * The lockspace thread remembers which lv lease slots it has seen in use,
+ * so the search for a free lease does not reread every lease in front of
+ * a free one.  The bitmap is only a hint: other hosts create and remove
+ * lvs too, so a slot that looks free is still read before it is used,
+ * and a search that finds no free slot rereads the whole area before
+ * reporting that the lock lv is full.
+ */
+
+static uint32_t _lease_slot(struct lm_sanlock *lms, uint64_t offset)
+{
+	return (uint32_t)(offset / lms->align_size - LV_LOCK_BEGIN);
+}
+
+static int _lease_is_used(struct lm_sanlock *lms, uint32_t slot)
+{
+	if (slot >= lms->lease_slots)
+		return 0;
+	return (lms->lease_used[slot / 8] >> (slot % 8)) & 1;
+}
+
+static void _lease_set_used(struct lm_sanlock *lms, uint32_t slot, int used)
+{
+	uint8_t *map;
+	uint32_t slots;
+
+	if (slot >= lms->lease_slots) {
+		if (!used)
+			return;
+		/* grow in 4096 slot steps, a failure only loses the hint */
+		slots = (slot / 4096 + 1) * 4096;
+		if (!(map = realloc(lms->lease_used, slots / 8)))
+			return;
+		memset(map + lms->lease_slots / 8, 0, (slots - lms->lease_slots) / 8);
+		lms->lease_used = map;
+		lms->lease_slots = slots;
+	}
+
+	if (used)
+		lms->lease_used[slot / 8] |= (1 << (slot % 8));
+	else
+		lms->lease_used[slot / 8] &= ~(1 << (slot % 8));
+}
+
 /* lvremove */
 int lm_free_lv_sanlock(struct lockspace *ls, struct resource *r)
 {
+	struct lm_sanlock *lms = (struct lm_sanlock *)ls->lm_data;
 	struct rd_sanlock *rds = (struct rd_sanlock *)r->lm_data;
 	struct sanlk_resource *rs = &rds->rs;
 	int rv;
@@ -1015,6 +1084,14 @@ int lm_free_lv_sanlock(struct lockspace *ls, struct resource *r)
 	if (rv < 0) {
 		log_error("S %s R %s free_lv_san write error %d",
 			  ls->name, r->name, rv);
+		return rv;
+	}
+
+	/* the next lvcreate can reuse this lease without searching */
+	if (lms) {
+		_lease_set_used(lms, _lease_slot(lms, rs->disks[0].offset), 0);
+		if (!ls->free_lock_offset || rs->disks[0].offset < ls->free_lock_offset)
+			ls->free_lock_offset = rs->disks[0].offset;
 	}
 
 	return rv;
@@ -1209,6 +1286,7 @@ int lm_find_free_lock_sanlock(struct lockspace *ls, uint64_t *free_offset, int *
 	struct sanlk_resourced rd;
 	uint64_t offset;
 	uint64_t start_offset;
+	uint32_t skipped = 0;
 	int rv;
 	int round = 0;
 
@@ -1239,6 +1317,17 @@ int lm_find_free_lock_sanlock(struct lockspace *ls, uint64_t *free_offset, int *
 
 	while (1) {
 		if (offset >= start_offset && round) {
+			if (skipped) {
+				/* leases skipped as used may have been freed by other hosts */
+				log_debug("S %s find_free_lock_san reread %u leases seen in use",
+					  ls->name, skipped);
+				memset(lms->lease_used, 0, lms->lease_slots / 8);
+				skipped = 0;
+				round = 0;
+				offset = start_offset;
+				continue;
+			}
+
 			/* This indicates the all space are allocated. */
 			log_debug("S %s init_lv_san read back to start offset %llu",
 				ls->name, (unsigned long long)offset);
@@ -1246,6 +1335,12 @@ int lm_find_free_lock_sanlock(struct lockspace *ls, uint64_t *free_offset, int *
 			return rv;
 		}
 
+		if (_lease_is_used(lms, _lease_slot(lms, offset))) {
+			skipped++;
+			offset += lms->align_size;
+			continue;
+		}
+
 		rd.rs.disks[0].offset = offset;
 
 		memset(rd.rs.name, 0, SANLK_NAME_LEN);
@@ -1290,6 +1385,7 @@ int lm_find_free_lock_sanlock(struct lockspace *ls, uint64_t *free_offset, int *
 			return 0;
 		}
 
+		_lease_set_used(lms, _lease_slot(lms, offset), 1);
 		offset += lms->align_size;
 	}
 
@@ -1331,6 +1427,7 @@ int lm_prepare_lockspace_sanlock(struct lockspace *ls)
 	int sector_size = 0;
 	int align_size = 0;
 	int gl_found;
+	int sock;
 	int ret, rv;
 
 	memset(disk_path, 0, sizeof(disk_path));
@@ -1445,6 +1542,31 @@ int lm_prepare_lockspace_sanlock(struct lockspace *ls)
 		goto fail;
 	}
 
+	/*
+	 * Each lock worker gets its own registered connection, set up like
+	 * the main one, so workers can wait on sanlock at the same time.
+	 * With fewer connections, lv locks are spread over those we have.
+	 */
+	while (lms->lock_sock_count < lock_workers) {
+		sock = sanlock_register();
+		if (sock < 0) {
+			log_error("S %s prepare_lockspace_san lock worker register error %d", lsname, sock);
+			break;
+		}
+
+		if ((sanlock_killpath(sock, 0, killpath, killargs) < 0) ||
+		    (sanlock_restrict(sock, SANLK_RESTRICT_SIGKILL) < 0)) {
+			log_error("S %s prepare_lockspace_san lock worker setup error", lsname);
+			close(sock);
+			break;
+		}
+
+		lms->lock_socks[lms->lock_sock_count++] = sock;
+	}
+
+	ls->lock_worker_count = lms->lock_sock_count;
+	log_debug("S %s prepare_lockspace_san lock workers %d", lsname, ls->lock_worker_count);
+
 	rv = get_sizes_lockspace(disk_path, &sector_size, &align_size);
 	if (rv < 0) {
 		log_error("S %s prepare_lockspace_san cannot get sector/align sizes %d", lsname, rv);
@@ -1503,8 +1625,11 @@ out:
 fail:
 	if (lms && lms->sock)
 		close(lms->sock);
-	if (lms)
+	if (lms) {
+		_close_lock_socks(lms);
 		free(lms);
+	}
+	ls->lock_worker_count = 0;
 	return ret;
 }
 
@@ -1552,8 +1677,10 @@ out:
 fail:
 	if (close(lms->sock))
 		log_error("failed to close sanlock daemon socket connection");
+	_close_lock_socks(lms);
 	free(lms);
 	ls->lm_data = NULL;
+	ls->lock_worker_count = 0;
 	return rv;
 }
 
@@ -1589,9 +1716,12 @@ int lm_rem_lockspace_sanlock(struct lockspace *ls, int free_vg)
 
 	if (close(lms->sock))
 		log_error("failed to close sanlock daemon socket connection");
+	_close_lock_socks(lms);
+	free(lms->lease_used);
 out:
 	free(lms);
 	ls->lm_data = NULL;
+	ls->lock_worker_count = 0;
 
 	/* FIXME: should we only clear gl_lsname when doing free_vg? */
 
@@ -1750,7 +1880,7 @@ int lm_lock_sanlock(struct lockspace *ls, struct resource *r, int ld_mode,
 	memset(&opt, 0, sizeof(opt));
 	sprintf(opt.owner_name, "%s", "lvmlockd");
 
-	rv = sanlock_acquire(lms->sock, -1, flags, 1, &rs, &opt);
+	rv = sanlock_acquire(_lock_sock(lms, r), -1, flags, 1, &rs, &opt);
 
 	/*
 	 * errors: translate the sanlock error number to an lvmlockd error.
@@ -1990,7 +2120,7 @@ int lm_convert_sanlock(struct lockspace *ls, struct resource *r,
 	 */
 	flags |= SANLK_ACQUIRE_OWNER_NOWAIT;
 
-	rv = sanlock_convert(lms->sock, -1, flags, rs);
+	rv = sanlock_convert(_lock_sock(lms, r), -1, flags, rs);
 	if (!rv)
 		return 0;
 
@@ -2115,7 +2245,7 @@ int lm_unlock_sanlock(struct lockspace *ls, struct resource *r,
 		return release_rename(ls, r);
 	}
 
-	rv = sanlock_release(lms->sock, -1, 0, 1, &rs);
+	rv = sanlock_release(_lock_sock(lms, r), -1, 0, 1, &rs);
 	if (rv < 0)
 		log_error("S %s R %s unlock_san release error %d", ls->name, r->name, rv);
 
@@ -22,6 +22,11 @@
 #include <poll.h>
 #include <wait.h>
 
+#ifdef LVMPOLLD_IN_PROCESS
+#include "device_mapper/misc/dm-ioctl.h"
+#include "tools/lvm2cmd.h"
+#endif
+
 #define LVMPOLLD_SOCKET DEFAULT_RUN_DIR "/lvmpolld.socket"
 
 #define PD_LOG_PREFIX "LVMPOLLD"
@@ -38,11 +43,16 @@
 #define REASON_INVALID_INTERVAL "request requires interval set"
 #define REASON_ENOMEM "not enough memory"
 
+/* longest time a progress_info request waits for an update */
+#define MAX_UPDATE_WAIT 30
+
 struct lvmpolld_state {
 	daemon_idle *idle;
 	log_state *log;
 	const char *log_config;
 	const char *lvm_binary;
+	unsigned in_process;
+	void *lvm_handle;
 
 	struct lvmpolld_store *id_to_pdlv_abort;
 	struct lvmpolld_store *id_to_pdlv_poll;
@@ -50,6 +60,15 @@ struct lvmpolld_state {
 
 static pthread_key_t key;
 
+#ifdef LVMPOLLD_IN_PROCESS
+/*
+ * All in-process polling goes through one lvm2 command library handle.
+ * The library is not thread safe, so only one thread may use it at a time.
+ */
+static pthread_mutex_t _engine_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct lvmpolld_lv *_engine_pdlv; /* LV lvpoll runs for, under _engine_mutex */
+#endif
+
 static const char *_strerror_r(int errnum, struct lvmpolld_thread_data *data)
 {
 #ifdef _GNU_SOURCE
@@ -65,7 +84,7 @@ static const char *_strerror_r(int errnum, struct lvmpolld_thread_data *data)
 static void _usage(const char *prog, FILE *file)
 {
 	fprintf(file, "Usage:\n"
-		"%s [-V] [-h] [-f] [-l {all|wire|debug}] [-s path] [-B path] [-p path] [-t secs]\n"
+		"%s [-V] [-h] [-f] [-i] [-l {all|wire|debug}] [-s path] [-B path] [-p path] [-t secs]\n"
 		"%s --dump [-s path]\n"
 		"   -V|--version     Show version info\n"
 		"   -h|--help        Show this help information\n"
@@ -75,9 +94,47 @@ static void _usage(const char *prog, FILE *file)
 		"   -p|--pidfile     Set path to the pidfile\n"
 		"   -s|--socket      Set path to the communication socket\n"
 		"   -B|--binary      Path to lvm2 binary\n"
+		"   -i|--in-process  Poll in lvmpolld itself instead of forking lvpoll\n"
 		"   -t|--timeout     Time to wait in seconds before shutdown on idle (missing or 0 = inifinite)\n\n", prog, prog);
 }
 
+#ifdef LVMPOLLD_IN_PROCESS
+static void _engine_log(int level, const char *file, int line,
+			int dm_errno_or_class, const char *msg)
+{
+	struct lvmpolld_lv *pdlv = _engine_pdlv;
+
+	if (!pdlv)
+		return;
+
+	level &= 7;
+
+	if (level <= LVM2_LOG_ERROR)
+		WARN(pdlv->ls, "%s: %s: %s", LVM2_LOG_PREFIX, pdlv->lvname, msg);
+	else if (level == LVM2_LOG_PRINT) {
+		INFO(pdlv->ls, "%s: %s: %s", LVM2_LOG_PREFIX, pdlv->lvname, msg);
+		pdlv_set_progress(pdlv, msg);
+	} else
+		DEBUGLOG(pdlv->ls, "%s: %s: %s", LVM2_LOG_PREFIX, pdlv->lvname, msg);
+}
+
+static int _engine_init(struct lvmpolld_state *ls)
+{
+	lvm2_log_fn(_engine_log);
+
+	if (!(ls->lvm_handle = lvm2_init_threaded())) {
+		FATAL(ls, "%s: %s", PD_LOG_PREFIX, "Failed to initialize lvm2 command library");
+		return 0;
+	}
+
+	lvm2_poll_single_check(ls->lvm_handle);
+
+	INFO(ls, "%s: %s", PD_LOG_PREFIX, "polling in-process");
+
+	return 1;
+}
+#endif
+
 static int _init(struct daemon_state *s)
 {
 	struct lvmpolld_state *ls = s->private;
@@ -112,6 +169,11 @@ static int _init(struct daemon_state *s)
 		return 0;
 	}
 
+#ifdef LVMPOLLD_IN_PROCESS
+	if (ls->in_process && !_engine_init(ls))
+		return 0;
+#endif
+
 	if (ls->idle)
 		ls->idle->is_idle = 1;
 
@@ -183,6 +245,11 @@ static int _fini(struct daemon_state *s)
 	pdst_destroy(ls->id_to_pdlv_poll);
 	pdst_destroy(ls->id_to_pdlv_abort);
 
+#ifdef LVMPOLLD_IN_PROCESS
+	if (ls->lvm_handle)
+		lvm2_exit(ls->lvm_handle);
+#endif
+
 	pthread_key_delete(key);
 
 	return 1;
@@ -274,6 +341,7 @@ static int poll_for_output(struct lvmpolld_lv *pdlv, struct lvmpolld_thread_data
 			assert(read_single_line(data, 0)); /* may block indef. anyway */
 			INFO(pdlv->ls, "%s: PID %d: %s: '%s'", LVM2_LOG_PREFIX,
 			     pdlv->cmd_pid, "STDOUT", data->line);
+			pdlv_set_progress(pdlv, data->line);
 		} else if (fds[0].revents) {
 			if (fds[0].revents & POLLHUP)
 				DEBUGLOG(pdlv->ls, "%s: %s", PD_LOG_PREFIX, "caught POLLHUP");
@@ -485,16 +553,213 @@ err:
 	return NULL;
 }
 
+#ifdef LVMPOLLD_IN_PROCESS
+/* Run lvpoll anyway after this many checks the kernel found nothing in. */
+#define MAX_SKIPPED_CHECKS 10
+
+/*
+ * Read the kernel status of the polled LV.  Returns 1 when lvpoll has to
+ * look at the LV: the copy or merge got finished, the table got reloaded,
+ * the device is gone or its status is not understood.  Returns 0 while
+ * the kernel is still busy copying or merging.
+ */
+static int _lv_needs_lvpoll(struct lvmpolld_lv *pdlv, uint32_t *event_nr)
+{
+	char uuid[DM_UUID_LEN];
+	struct dm_task *dmt;
+	struct dm_info info;
+	struct dm_pool *mem = NULL;
+	struct dm_status_mirror *ms;
+	struct dm_status_raid *rs;
+	struct dm_status_snapshot *ss;
+	uint64_t start, length;
+	char *target_type = NULL, *params;
+	void *next = NULL;
+	int busy = 0, r = 1;
+
+	if (dm_snprintf(uuid, sizeof(uuid), "LVM-%s", pdlv->lvid) < 0)
+		return 1;
+
+	if (!(dmt = dm_task_create(DM_DEVICE_STATUS)))
+		return 1;
+
+	if (!dm_task_set_uuid(dmt, uuid) ||
+	    !dm_task_no_open_count(dmt) ||
+	    !dm_task_run(dmt) ||
+	    !dm_task_get_info(dmt, &info) ||
+	    !info.exists)
+		goto out;
+
+	if (info.event_nr != *event_nr) {
+		*event_nr = info.event_nr;
+		goto out;
+	}
+
+	if (!(mem = dm_pool_create("lvmpolld", 1024)))
+		goto out;
+
+	do {
+		next = dm_get_next_target(dmt, next, &start, &length, &target_type, &params);
+
+		if (!target_type)
+			continue;
+
+		if (!strcmp(target_type, "mirror")) {
+			if (!dm_get_status_mirror(mem, params, &ms))
+				goto out;
+			if (ms->insync_regions < ms->total_regions)
+				busy = 1;
+		} else if (!strcmp(target_type, "raid")) {
+			if (!dm_get_status_raid(mem, params, &rs))
+				goto out;
+			if (rs->insync_regions < rs->total_regions)
+				busy = 1;
+		} else if (!strcmp(target_type, "snapshot-merge")) {
+			if (!dm_get_status_snapshot(mem, params, &ss))
+				goto out;
+			if (!ss->invalid && !ss->merge_failed &&
+			    (ss->used_sectors != ss->metadata_sectors))
+				busy = 1;
+		}
+	} while (next);
+
+	r = !busy;
+out:
+	if (mem)
+		dm_pool_destroy(mem);
+	dm_task_destroy(dmt);
+
+	return r;
+}
+
+/* lvpoll arguments for lvm2_run(), i.e. cmdargv without the binary */
+static int _engine_cmdline(const struct lvmpolld_lv *pdlv, char *buf, size_t size)
+{
+	const char *const *arg;
+	size_t len = 0;
+	int r;
+
+	*buf = '\0';
+
+	for (arg = pdlv->cmdargv + 1; *arg; arg++) {
+		if ((r = dm_snprintf(buf + len, size - len, "%s%s", len ? " " : "", *arg)) < 0)
+			return 0;
+		len += r;
+	}
+
+	return 1;
+}
+
+static void _engine_cleanup(void *args)
+{
+	struct lvmpolld_lv *pdlv = (struct lvmpolld_lv *) args;
+
+	pdst_lock(pdlv->pdst);
+	pdlv_set_polling_finished(pdlv, 1);
+	pdst_locked_dec(pdlv->pdst);
+	pdst_unlock(pdlv->pdst);
+}
+
+/*
+ * Runs lvpoll until it stops reporting progress, and returns its result.
+ * Kept out of poll_in_process() so no local that changes lives across
+ * the setjmp in pthread_cleanup_push().
+ */
+static int _engine_poll(struct lvmpolld_lv *pdlv, const char *cmdline)
+{
+	struct lvmpolld_state *ls = pdlv->ls;
+	struct timespec interval = { .tv_sec = strtoul(pdlv->sinterval, NULL, 10) ?: 1 };
+	uint32_t event_nr = 0;
+	unsigned skipped = MAX_SKIPPED_CHECKS;
+	int r = LVM2_PROCESSING_FAILED, state;
+
+	while (1) {
+		/* Never leave the shared handle half way through a command */
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+		pthread_mutex_lock(&_engine_mutex);
+
+		if ((skipped >= MAX_SKIPPED_CHECKS) || _lv_needs_lvpoll(pdlv, &event_nr)) {
+			_engine_pdlv = pdlv;
+			r = lvm2_run(ls->lvm_handle, cmdline);
+			_engine_pdlv = NULL;
+			skipped = 0;
+		} else {
+			DEBUGLOG(ls, "%s: %s %s", PD_LOG_PREFIX, pdlv->lvname, "still busy in kernel");
+			skipped++;
+		}
+
+		pthread_mutex_unlock(&_engine_mutex);
+		pthread_setcancelstate(state, &state);
+
+		if (r != LVM2_POLL_IN_PROGRESS)
+			return r;
+
+		nanosleep(&interval, NULL);
+	}
+}
+
+/*
+ * In-process counterpart of fork_and_poll().  Every LV is checked with the
+ * shared lvm2 handle, so toolcontext, device cache and parsed VG metadata
+ * are kept between checks and between LVs instead of being rebuilt by a new
+ * lvm process each interval.  In between, the kernel status is read directly
+ * and lvpoll only runs once there is something to do with the metadata.
+ */
+static void *poll_in_process(void *args)
+{
+	struct lvmpolld_lv *pdlv = (struct lvmpolld_lv *) args;
+	struct lvmpolld_state *ls = pdlv->ls;
+	struct lvmpolld_cmd_stat cmd_state = { .retcode = -1, .signal = 0 };
+	char cmdline[512];
+
+	if (!_engine_cmdline(pdlv, cmdline, sizeof(cmdline))) {
+		ERROR(ls, "%s: %s", PD_LOG_PREFIX, "lvpoll command line is too long");
+		pdst_lock(pdlv->pdst);
+		pdlv_set_error(pdlv, 1);
+		pdst_unlock(pdlv->pdst);
+		_engine_cleanup(pdlv);
+		update_idle_state(ls);
+		return NULL;
+	}
+
+	INFO(ls, "%s: LVM2 cmd \"%s\" (in-process)", PD_LOG_PREFIX, cmdline);
+
+	pthread_cleanup_push(_engine_cleanup, pdlv);
+	cmd_state.retcode = _engine_poll(pdlv, cmdline);
+	pthread_cleanup_pop(0);
+
+	if (cmd_state.retcode == LVM2_COMMAND_SUCCEEDED) {
+		cmd_state.retcode = 0;
+		INFO(ls, "%s: %s %s %s", PD_LOG_PREFIX, "lvm2 cmd for", pdlv->lvname,
+		     "finished successfully");
+	} else
+		ERROR(ls, "%s: %s %s %s (retcode: %d)", PD_LOG_PREFIX, "lvm2 cmd for",
+		      pdlv->lvname, "failed", cmd_state.retcode);
+
+	pdlv_set_cmd_state(pdlv, &cmd_state);
+
+	_engine_cleanup(pdlv);
+
+	update_idle_state(ls);
+
+	return NULL;
+}
+#endif
+
 static response progress_info(client_handle h, struct lvmpolld_state *ls, request req)
 {
 	char *id;
 	struct lvmpolld_lv *pdlv;
 	struct lvmpolld_store *pdst;
 	struct lvmpolld_lv_state st;
+	struct timespec deadline;
 	response r;
+	int wr;
 	const char *lvid = daemon_request_str(req, LVMPD_PARM_LVID, NULL);
 	const char *sysdir = daemon_request_str(req, LVMPD_PARM_SYSDIR, NULL);
 	unsigned abort_polling = daemon_request_int(req, LVMPD_PARM_ABORT, 0);
+	unsigned update_nr = daemon_request_int(req, LVMPD_PARM_UPDATE, 0);
+	unsigned wait = daemon_request_int(req, LVMPD_PARM_WAIT, 0);
 
 	if (!lvid)
 		return reply(LVMPD_RESP_FAILED, REASON_MISSING_LVID);
@@ -512,6 +777,24 @@ static response progress_info(client_handle h, struct lvmpolld_state *ls, reques
 	pdst_lock(pdst);
 
 	pdlv = pdst_locked_lookup(pdst, id);
+
+	/*
+	 * A client that has seen update_nr already waits here until lvpoll
+	 * reports new progress or finishes instead of asking again later.
+	 * The pdlv may get collected by another client meanwhile.
+	 */
+	if (pdlv && update_nr && wait) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += (wait < MAX_UPDATE_WAIT) ? wait : MAX_UPDATE_WAIT;
+
+		while (pdlv && (pdlv_get_status(pdlv).update_nr == update_nr)) {
+			wr = pthread_cond_timedwait(&pdst->update, &pdst->lock, &deadline);
+			pdlv = pdst_locked_lookup(pdst, id);
+			if (wr)
+				break;
+		}
+	}
+
 	if (pdlv) {
 		/*
 		 * with store lock held, I'm the only reader accessing the pdlv
@@ -541,8 +824,15 @@ static response progress_info(client_handle h, struct lvmpolld_state *ls, reques
 						"reason = %s", st.cmd_state.signal ? LVMPD_REAS_SIGNAL : LVMPD_REAS_RETCODE,
 						LVMPD_PARM_VALUE " = " FMTd64, (int64_t)(st.cmd_state.signal ?: st.cmd_state.retcode),
 						NULL);
+		else if (*st.progress)
+			r = daemon_reply_simple(LVMPD_RESP_IN_PROGRESS,
+						LVMPD_PARM_UPDATE " = " FMTd64, (int64_t) st.update_nr,
+						LVMPD_PARM_PROGRESS " = %s", st.progress,
+						NULL);
 		else
-			r = daemon_reply_simple(LVMPD_RESP_IN_PROGRESS, NULL);
+			r = daemon_reply_simple(LVMPD_RESP_IN_PROGRESS,
+						LVMPD_PARM_UPDATE " = " FMTd64, (int64_t) st.update_nr,
+						NULL);
 	}
 	else
 		r = daemon_reply_simple(LVMPD_RESP_NOT_FOUND, NULL);
@@ -594,6 +884,13 @@ static int spawn_detached_thread(struct lvmpolld_lv *pdlv)
 {
 	int r;
 	pthread_attr_t attr;
+	void *(*poll_fn)(void *) = fork_and_poll;
+
+#ifdef LVMPOLLD_IN_PROCESS
+	/* Clients with their own LVM_SYSTEM_DIR still get their own lvpoll */
+	if (pdlv->ls->lvm_handle && !*pdlv->lvm_system_dir_env)
+		poll_fn = poll_in_process;
+#endif
 
 	if (pthread_attr_init(&attr) != 0)
 		return 0;
@@ -601,7 +898,7 @@ static int spawn_detached_thread(struct lvmpolld_lv *pdlv)
 	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0)
 		return 0;
 
-	r = pthread_create(&pdlv->tid, &attr, fork_and_poll, (void *)pdlv);
+	r = pthread_create(&pdlv->tid, &attr, poll_fn, (void *)pdlv);
 
 	if (pthread_attr_destroy(&attr) != 0)
 		return 0;
@@ -901,6 +1198,7 @@ static struct option long_options[] = {
 	{"binary",	required_argument,	0,		'B' },
 	{"foreground",	no_argument,		0,		'f' },
 	{"help",	no_argument,		0,		'h' },
+	{"in-process",	no_argument,		0,		'i' },
 	{"log",		required_argument,	0,		'l' },
 	{"pidfile",	required_argument,	0,		'p' },
 	{"socket",	required_argument,	0,		's' },
@@ -930,7 +1228,7 @@ int main(int argc, char *argv[])
 		.socket_path = getenv("LVM_LVMPOLLD_SOCKET") ?: LVMPOLLD_SOCKET,
 	};
 
-	while ((opt = getopt_long(argc, argv, "fhVl:p:s:B:t:", long_options, &option_index)) != -1) {
+	while ((opt = getopt_long(argc, argv, "fhiVl:p:s:B:t:", long_options, &option_index)) != -1) {
 		switch (opt) {
 		case 0 :
 			if (action < ACTION_MAX) {
@@ -959,6 +1257,14 @@ int main(int argc, char *argv[])
 		case 'h': /* --help */
 			_usage(argv[0], stdout);
 			exit(EXIT_SUCCESS);
+		case 'i': /* --in-process */
+#ifndef LVMPOLLD_IN_PROCESS
+			fprintf(stderr, "In-process polling requires lvmpolld built with lvm2 command library.\n");
+			exit(EXIT_FAILURE);
+#endif
+			ls.in_process = 1;
+			server = 1;
+			break;
 		case 'l': /* --log */
 			ls.log_config = optarg;
 			server = 1;
@@ -110,7 +110,8 @@ struct lvmpolld_lv *pdlv_create(struct lvmpolld_state *ls, const char *id,
 		.pdtimeout = pdtimeout < MIN_POLLING_TIMEOUT ? MIN_POLLING_TIMEOUT : pdtimeout,
 		.cmd_state = { .retcode = -1, .signal = 0 },
 		.pdst = pdst,
-		.init_rq_count = 1
+		.init_rq_count = 1,
+		.update_nr = 1
 	}, *pdlv = (struct lvmpolld_lv *) malloc(sizeof(struct lvmpolld_lv));
 
 	if (!pdlv || !tmp.lvid || !tmp.lvname || !tmp.lvm_system_dir_env || !tmp.sinterval)
@@ -166,6 +167,8 @@ struct lvmpolld_lv_state pdlv_get_status(struct lvmpolld_lv *pdlv)
 	r.error = pdlv_locked_error(pdlv);
 	r.polling_finished = pdlv_locked_polling_finished(pdlv);
 	r.cmd_state = pdlv_locked_cmd_state(pdlv);
+	r.update_nr = pdlv->update_nr;
+	memcpy(r.progress, pdlv->progress, sizeof(r.progress));
 	pdlv_unlock(pdlv);
 
 	return r;
@@ -185,11 +188,41 @@ void pdlv_set_error(struct lvmpolld_lv *pdlv, unsigned error)
 	pdlv_unlock(pdlv);
 }
 
+/* only call with appropriate struct lvmpolld_store lock held */
 void pdlv_set_polling_finished(struct lvmpolld_lv *pdlv, unsigned finished)
 {
 	pdlv_lock(pdlv);
 	pdlv->polling_finished = finished;
+	pdlv->update_nr++;
 	pdlv_unlock(pdlv);
+
+	pthread_cond_broadcast(&pdlv->pdst->update);
+}
+
+/*
+ * Remember the percentage from an lvpoll progress line
+ * ("vg/lv: Moved: 42.00%") and wake up clients waiting for it.
+ */
+void pdlv_set_progress(struct lvmpolld_lv *pdlv, const char *line)
+{
+	const char *p;
+	size_t len = strlen(line);
+
+	if (!len || (line[len - 1] != '%') || !(p = strrchr(line, ' ')))
+		return;
+
+	len = line + len - 1 - ++p;
+	if (!len || len >= sizeof(pdlv->progress))
+		return;
+
+	pdst_lock(pdlv->pdst);
+	pdlv_lock(pdlv);
+	memcpy(pdlv->progress, p, len);
+	pdlv->progress[len] = '\0';
+	pdlv->update_nr++;
+	pdlv_unlock(pdlv);
+	pthread_cond_broadcast(&pdlv->pdst->update);
+	pdst_unlock(pdlv->pdst);
 }
 
 struct lvmpolld_store *pdst_init(const char *name)
@@ -203,12 +236,16 @@ struct lvmpolld_store *pdst_init(const char *name)
 		goto err_hash;
 	if (pthread_mutex_init(&pdst->lock, NULL))
 		goto err_mutex;
+	if (pthread_cond_init(&pdst->update, NULL))
+		goto err_cond;
 
 	pdst->name = name;
 	pdst->active_polling_count = 0;
 
 	return pdst;
 
+err_cond:
+	pthread_mutex_destroy(&pdst->lock);
 err_mutex:
 	dm_hash_destroy(pdst->store);
 err_hash:
@@ -222,6 +259,7 @@ void pdst_destroy(struct lvmpolld_store *pdst)
 		return;
 
 	dm_hash_destroy(pdst->store);
+	pthread_cond_destroy(&pdst->update);
 	pthread_mutex_destroy(&pdst->lock);
 	free(pdst);
 }
@@ -264,6 +302,11 @@ static void _pdlv_locked_dump(struct buffer *buff, const struct lvmpolld_lv *pdl
 	if (dm_snprintf(tmp, sizeof(tmp), "\t\t%s\"%s\"\n", LVM_SYSTEM_DIR,
 			(*pdlv->lvm_system_dir_env ? (pdlv->lvm_system_dir_env + (sizeof(LVM_SYSTEM_DIR) - 1)) : "<undefined>")) > 0)
 		buffer_append(buff, tmp);
+	if (dm_snprintf(tmp, sizeof(tmp), "\t\tupdate_nr=%u\n", pdlv->update_nr) > 0)
+		buffer_append(buff, tmp);
+	if (*pdlv->progress &&
+	    dm_snprintf(tmp, sizeof(tmp), "\t\tprogress=\"%s\"\n", pdlv->progress) > 0)
+		buffer_append(buff, tmp);
 	if (dm_snprintf(tmp, sizeof(tmp), "\t\tlvm_command_pid=%d\n", pdlv->cmd_pid) > 0)
 		buffer_append(buff, tmp);
 	if (dm_snprintf(tmp, sizeof(tmp), "\t\tpolling_finished=%d\n", pdlv->polling_finished) > 0)
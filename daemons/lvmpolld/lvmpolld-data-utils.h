@@ -35,6 +35,7 @@ struct lvmpolld_cmd_stat {
 
 struct lvmpolld_store {
 	pthread_mutex_t lock;
+	pthread_cond_t update; /* broadcast on any lvmpolld_lv update_nr change */
 	void *store;
 	const char *name;
 	unsigned active_polling_count;
@@ -66,6 +67,8 @@ struct lvmpolld_lv {
 	/* block of shared variables protected by lock */
 	struct lvmpolld_cmd_stat cmd_state;
 	unsigned init_rq_count; /* for debuging purposes only */
+	unsigned update_nr; /* changed under store lock on progress or finish */
+	char progress[16]; /* last percentage reported by lvpoll */
 	unsigned polling_finished:1; /* no more updates */
 	unsigned error:1; /* unrecoverable error occured in lvmpolld */
 };
@@ -79,6 +82,8 @@ struct lvmpolld_lv_state {
 	unsigned error:1;
 	unsigned polling_finished:1;
 	struct lvmpolld_cmd_stat cmd_state;
+	unsigned update_nr;
+	char progress[16];
 };
 
 struct lvmpolld_thread_data {
@@ -139,6 +144,7 @@ struct lvmpolld_lv_state pdlv_get_status(struct lvmpolld_lv *pdlv);
 void pdlv_set_cmd_state(struct lvmpolld_lv *pdlv, const struct lvmpolld_cmd_stat *cmd_state);
 void pdlv_set_error(struct lvmpolld_lv *pdlv, unsigned error);
 void pdlv_set_polling_finished(struct lvmpolld_lv *pdlv, unsigned finished);
+void pdlv_set_progress(struct lvmpolld_lv *pdlv, const char *line);
 
 /*
  * struct lvmpolld_lv lock required section
@@ -32,9 +32,12 @@
 #define LVMPD_PARM_INTERVAL		"interval"
 #define LVMPD_PARM_LVID			"lvid"
 #define LVMPD_PARM_LVNAME		"lvname"
+#define LVMPD_PARM_PROGRESS		"progress" /* percent done as reported by lvpoll */
 #define LVMPD_PARM_SYSDIR		"sysdir"
+#define LVMPD_PARM_UPDATE		"update" /* progress_info: update seen last */
 #define LVMPD_PARM_VALUE		"value" /* either retcode or signal value */
 #define LVMPD_PARM_VGNAME		"vgname"
+#define LVMPD_PARM_WAIT			"wait" /* progress_info: secs to wait for next update */
 
 #define LVMPD_RESP_FAILED	"failed"
 #define LVMPD_RESP_FINISHED	"finished"
@@ -90,6 +90,13 @@ int dm_log_is_non_default(void);
  */
 int dm_get_suspended_counter(void);
 
+/*
+ * Total time devices suspended via the library spent suspended before
+ * being resumed or removed, in microseconds, and how many such
+ * suspensions ended.
+ */
+void dm_get_suspended_time(uint64_t *usec, unsigned *count);
+
 enum {
 	DM_DEVICE_CREATE,
 	DM_DEVICE_RELOAD,
@@ -138,6 +145,13 @@ struct dm_timestamp;
 struct dm_task *dm_task_create(int type);
 void dm_task_destroy(struct dm_task *dmt);
 
+/*
+ * Clears dmt for reuse as a new task of the given type, as if it had
+ * just been created.  Saves the allocations when the same ioctl is run
+ * repeatedly, e.g. to poll status.
+ */
+int dm_task_reset(struct dm_task *dmt, int type);
+
 int dm_task_set_name(struct dm_task *dmt, const char *name);
 int dm_task_set_uuid(struct dm_task *dmt, const char *uuid);
 
@@ -211,6 +225,28 @@ const char *dm_task_get_message_response(struct dm_task *dmt);
 const char *dm_task_get_name(const struct dm_task *dmt);
 struct dm_names *dm_task_get_names(struct dm_task *dmt);
 
+/*
+ * Device of a DM_DEVICE_LIST task as returned by dm_task_get_device_list().
+ */
+struct dm_active_device {
+	struct dm_list list;
+	uint64_t dev;
+	const char *name;
+	uint32_t event_nr;	/* valid with DM_DEVICE_LIST_HAS_EVENT_NR */
+	const char *uuid;	/* valid with DM_DEVICE_LIST_HAS_UUID, NULL if none */
+};
+
+#define DM_DEVICE_LIST_HAS_EVENT_NR	0x00000001
+#define DM_DEVICE_LIST_HAS_UUID		0x00000002
+
+/*
+ * Copy devices of a DM_DEVICE_LIST task into the devs list allocated
+ * from mem.  devs_features tells which optional fields the kernel
+ * provided, so a single ioctl can replace per-device queries.
+ */
+int dm_task_get_device_list(struct dm_task *dmt, struct dm_pool *mem,
+			    struct dm_list *devs, unsigned *devs_features);
+
 int dm_task_set_ro(struct dm_task *dmt);
 int dm_task_set_newname(struct dm_task *dmt, const char *newname);
 int dm_task_set_newuuid(struct dm_task *dmt, const char *newuuid);
@@ -680,6 +716,14 @@ void *dm_tree_node_get_context(const struct dm_tree_node *node);
  */
 int dm_tree_node_size_changed(const struct dm_tree_node *dnode);
 
+/*
+ * Returns 1 when dm_tree_preload_children() found a device it did not
+ * leave as it was: a table was loaded because it differs from the live
+ * one, or a device is suspended, waits for a rename or has thin-pool
+ * messages.  Returns 0 when suspending and resuming would change nothing.
+ */
+int dm_tree_node_tables_changed(const struct dm_tree_node *dnode);
+
 /*
  * Returns the number of children of the given node (excluding the root node).
  * Set inverted for the number of parents.
@@ -739,6 +783,12 @@ void dm_tree_use_no_flush_suspend(struct dm_tree_node *dnode);
  */
 void dm_tree_retry_remove(struct dm_tree_node *dnode);
 
+/*
+ * Use deferred removal for a top-level device that is still open, so the
+ * kernel removes it on last close.  Its children are then left in place.
+ */
+void dm_tree_deferred_remove(struct dm_tree_node *dnode);
+
 /*
  * Is the uuid prefix present in the tree?
  * Only returns 0 if every node was checked successfully.
@@ -1300,6 +1350,47 @@ char *dm_pool_strndup(struct dm_pool *p, const char *str, size_t n)
 void *dm_pool_zalloc(struct dm_pool *p, size_t s)
 	__attribute__((__warn_unused_result__));
 
+/*
+ * Memory accounting.  bytes and chunks cover everything the pool has
+ * malloced, including a spare chunk kept for reuse; used_bytes is the
+ * part handed out to callers and peak_bytes the most the pool held.
+ */
+struct dm_pool_stats {
+	const char *name;
+	uint64_t bytes;
+	uint64_t used_bytes;
+	uint64_t peak_bytes;
+	unsigned chunks;
+};
+
+void dm_pool_get_stats(struct dm_pool *p, struct dm_pool_stats *stats);
+
+/* Logs every existing pool, highest peak first, as mem class debug messages. */
+void dm_pools_dump_stats(void);
+
+/*
+ * Slabs hand out objects of one fixed size, carved from a pool in
+ * chunks of objs_per_chunk (0 picks a default).  Unlike pool memory,
+ * any object can be given back with dm_slab_free and is reused by the
+ * next dm_slab_alloc, so code that keeps creating and dropping objects
+ * of one type for the life of a long running pool stops growing it.
+ *
+ * The slab and its chunks belong to the pool: they go away with
+ * dm_pool_destroy, or with a dm_pool_free of anything allocated before
+ * dm_slab_create.  As with the pool itself, a slab must not be used
+ * from more than one thread at a time.
+ */
+struct dm_slab;
+
+struct dm_slab *dm_slab_create(struct dm_pool *mem, size_t obj_size,
+			       unsigned objs_per_chunk)
+	__attribute__((__warn_unused_result__));
+void *dm_slab_alloc(struct dm_slab *s)
+	__attribute__((__warn_unused_result__));
+void *dm_slab_zalloc(struct dm_slab *s)
+	__attribute__((__warn_unused_result__));
+void dm_slab_free(struct dm_slab *s, void *ptr);
+
 /******************
  * bitset functions
  ******************/
@@ -1317,6 +1408,9 @@ int dm_bit_get_first(dm_bitset_t bs);
 int dm_bit_get_next(dm_bitset_t bs, int last_bit);
 int dm_bit_get_last(dm_bitset_t bs);
 int dm_bit_get_prev(dm_bitset_t bs, int last_bit);
+int dm_bit_get_next_zero(dm_bitset_t bs, int last_bit);
+/* Returns number of set bits below the size of the set */
+unsigned dm_bit_count(dm_bitset_t bs);
 
 #define DM_BITS_PER_INT ((unsigned)sizeof(int) * CHAR_BIT)
 
@@ -1939,10 +2033,26 @@ void dm_report_field_set_value(struct dm_report_field *field, const void *value,
  */
 struct dm_report_group;
 
+/*
+ * DM_REPORT_GROUP_BINARY writes each dm_report_output() to stdout as
+ * one block, with values by column so no text needs parsing:
+ *
+ *   "DMRB", u32 version (1), report name,
+ *   u32 field count, u32 row count,
+ *   for each field: u32 DM_REPORT_FIELD_TYPE_*, field id,
+ *   u32 string count, the strings,
+ *   for each field, a column of row count values:
+ *     u64 for NUMBER, SIZE (512-byte sectors), PERCENT (dm_percent_t)
+ *     and TIME fields, else u32 index of the displayed string.
+ *
+ * Integers are little-endian, strings are a u32 length and the bytes
+ * without a terminating NUL.
+ */
 typedef enum {
 	DM_REPORT_GROUP_SINGLE,
 	DM_REPORT_GROUP_BASIC,
-	DM_REPORT_GROUP_JSON
+	DM_REPORT_GROUP_JSON,
+	DM_REPORT_GROUP_BINARY
 } dm_report_group_type_t;
 
 struct dm_report_group *dm_report_group_create(dm_report_group_type_t type, void *data);
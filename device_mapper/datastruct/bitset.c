@@ -109,6 +109,34 @@ int dm_bit_get_next(dm_bitset_t bs, int last_bit)
 	return -1;
 }
 
+/*
+ * Unlike dm_bit_get_next, never returns a bit past the size of the
+ * set: bits in the unused tail of the last word are usually clear.
+ */
+int dm_bit_get_next_zero(dm_bitset_t bs, int last_bit)
+{
+	int bit, word;
+	uint32_t test;
+
+	last_bit++;		/* otherwise we'll return the same bit again */
+
+	while (last_bit < (int) bs[0]) {
+		word = last_bit >> INT_SHIFT;
+		test = ~bs[word + 1];
+		bit = last_bit & (DM_BITS_PER_INT - 1);
+
+		if ((bit = _test_word(test, bit)) >= 0) {
+			bit += word * DM_BITS_PER_INT;
+			return (bit < (int) bs[0]) ? bit : -1;
+		}
+
+		last_bit = last_bit - (last_bit & (DM_BITS_PER_INT - 1)) +
+		    DM_BITS_PER_INT;
+	}
+
+	return -1;
+}
+
 int dm_bit_get_prev(dm_bitset_t bs, int last_bit)
 {
 	int bit, word;
@@ -143,6 +171,22 @@ int dm_bit_get_last(dm_bitset_t bs)
 	return dm_bit_get_prev(bs, bs[0] + 1);
 }
 
+unsigned dm_bit_count(dm_bitset_t bs)
+{
+	unsigned i, words = bs[0] / DM_BITS_PER_INT;
+	unsigned tail = bs[0] & (DM_BITS_PER_INT - 1);
+	unsigned count = 0;
+
+	for (i = 1; i <= words; i++)
+		count += hweight32(bs[i]);
+
+	/* Only count bits inside the set */
+	if (tail)
+		count += hweight32(bs[words + 1] & ((1U << tail) - 1));
+
+	return count;
+}
+
 /*
  * Based on the Linux kernel __bitmap_parselist from lib/bitmap.c
  */
@@ -21,6 +21,7 @@
 
 #include <stddef.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <dirent.h>
 #include <sys/ioctl.h>
 #include <sys/utsname.h>
@@ -85,7 +86,6 @@ static int _control_fd = -1;
 static int _hold_control_fd_open = 0;
 static int _version_checked = 0;
 static int _version_ok = 1;
-static unsigned _ioctl_buffer_double_factor = 0;
 
 const int _dm_compat = 0;
 
@@ -125,6 +125,13 @@ static struct cmd_data _cmd_data_v4[] = {
 };
 /* *INDENT-ON* */
 
+/*
+ * Buffer size each ioctl type last needed in this process.
+ * Used as the size of the first attempt so that large device lists
+ * and tables do not go through the same retries on every call.
+ */
+static size_t _ioctl_buffer_size[DM_ARRAY_SIZE(_cmd_data_v4)];
+
 #define ALIGNMENT 8
 
 /* FIXME Rejig library to record & use errno instead */
@@ -478,12 +485,100 @@ static void _dm_zfree_string(char *string)
 	}
 }
 
+/*
+ * ioctl buffers are cleared when released and each thread keeps its
+ * largest one for the next ioctl, so polling status does not allocate
+ * and clear a fresh buffer every time.  The allocated size, and how much
+ * of it was filled in before the ioctl, are kept in front of the buffer.
+ */
+struct dmi_buffer {
+	size_t size;
+	size_t used;
+	uint64_t dmi[0];	/* struct dm_ioctl */
+};
+
+static pthread_once_t _dmi_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _dmi_cache_key;
+static int _dmi_cache_ok;
+
+static void _dmi_cache_free(void *buf)
+{
+	free(buf);
+}
+
+static void _dmi_cache_init(void)
+{
+	_dmi_cache_ok = !pthread_key_create(&_dmi_cache_key, _dmi_cache_free);
+}
+
+static struct dmi_buffer *_dmi_buffer(struct dm_ioctl *dmi)
+{
+	return (struct dmi_buffer *) ((char *) dmi - offsetof(struct dmi_buffer, dmi));
+}
+
+/* Returns a zeroed buffer of at least len bytes, used bytes will be written. */
+static struct dm_ioctl *_dmi_alloc(size_t len, size_t used)
+{
+	struct dmi_buffer *buf = NULL;
+
+	pthread_once(&_dmi_cache_once, _dmi_cache_init);
+
+	if (_dmi_cache_ok && (buf = pthread_getspecific(_dmi_cache_key))) {
+		(void) pthread_setspecific(_dmi_cache_key, NULL);
+		if (buf->size < len) {
+			free(buf);
+			buf = NULL;
+		}
+	}
+
+	if (!buf) {
+		if (!(buf = zalloc(sizeof(*buf) + len)))
+			return NULL;
+		buf->size = len;
+	}
+
+	buf->used = used;
+
+	return (struct dm_ioctl *) buf->dmi;
+}
+
 static void _dm_zfree_dmi(struct dm_ioctl *dmi)
 {
-	if (dmi) {
-		memset(dmi, 0, dmi->data_size);
-		asm volatile ("" ::: "memory"); /* Compiler barrier. */
-		free(dmi);
+	struct dmi_buffer *buf, *cached;
+	size_t len;
+
+	if (!dmi)
+		return;
+
+	/* The kernel returns data_size bytes, possibly less than we wrote */
+	buf = _dmi_buffer(dmi);
+	len = (dmi->data_size < buf->size) ? dmi->data_size : buf->size;
+	if (len < buf->used)
+		len = buf->used;
+	memset(dmi, 0, len);
+	asm volatile ("" ::: "memory"); /* Compiler barrier. */
+
+	if (_dmi_cache_ok) {
+		cached = pthread_getspecific(_dmi_cache_key);
+		if (!cached || (cached->size < buf->size)) {
+			if (!pthread_setspecific(_dmi_cache_key, buf)) {
+				free(cached);
+				return;
+			}
+		}
+	}
+
+	free(buf);
+}
+
+/* Frees the calling thread's cached buffer */
+static void _dmi_cache_release(void)
+{
+	struct dmi_buffer *cached;
+
+	if (_dmi_cache_ok && (cached = pthread_getspecific(_dmi_cache_key))) {
+		(void) pthread_setspecific(_dmi_cache_key, NULL);
+		free(cached);
 	}
 }
 
@@ -501,7 +596,7 @@ static void _dm_task_free_targets(struct dm_task *dmt)
 	dmt->head = dmt->tail = NULL;
 }
 
-void dm_task_destroy(struct dm_task *dmt)
+static void _dm_task_free_contents(struct dm_task *dmt)
 {
 	_dm_task_free_targets(dmt);
 	_dm_zfree_dmi(dmt->dmi.v4);
@@ -512,9 +607,23 @@ void dm_task_destroy(struct dm_task *dmt)
 	free(dmt->geometry);
 	free(dmt->uuid);
 	free(dmt->mangled_uuid);
+}
+
+void dm_task_destroy(struct dm_task *dmt)
+{
+	_dm_task_free_contents(dmt);
 	free(dmt);
 }
 
+int dm_task_reset(struct dm_task *dmt, int type)
+{
+	_dm_task_free_contents(dmt);
+	memset(dmt, 0, sizeof(*dmt));
+	init_dm_task(dmt, type);
+
+	return 1;
+}
+
 /*
  * Protocol Version 4 functions.
  */
@@ -755,6 +864,64 @@ struct dm_names *dm_task_get_names(struct dm_task *dmt)
 				    dmt->dmi.v4->data_start);
 }
 
+int dm_task_get_device_list(struct dm_task *dmt, struct dm_pool *mem,
+			    struct dm_list *devs, unsigned *devs_features)
+{
+	struct dm_names *names;
+	struct dm_active_device *dm_dev;
+	const uint32_t *event_nr;
+	unsigned next = 0;
+
+	dm_list_init(devs);
+	*devs_features = 0;
+
+	if (dmt->type != DM_DEVICE_LIST) {
+		log_error(INTERNAL_ERROR "Device list requested from %s task.",
+			  _cmd_data_v4[dmt->type].name);
+		return 0;
+	}
+
+	names = dm_task_get_names(dmt);
+
+	if (!names->dev)
+		return 1; /* No devices */
+
+	if ((_dm_version > 4) || ((_dm_version == 4) && (_dm_version_minor >= 37)))
+		*devs_features |= DM_DEVICE_LIST_HAS_EVENT_NR;
+
+	do {
+		names = (struct dm_names *)((char *) names + next);
+
+		if (!(dm_dev = dm_pool_zalloc(mem, sizeof(*dm_dev))) ||
+		    !(dm_dev->name = dm_pool_strdup(mem, names->name))) {
+			log_error("Failed to allocate device list entry.");
+			return 0;
+		}
+		dm_dev->dev = names->dev;
+
+		if (*devs_features & DM_DEVICE_LIST_HAS_EVENT_NR) {
+			event_nr = (const uint32_t *) _align(names->name + strlen(names->name) + 1,
+							     ALIGNMENT);
+			dm_dev->event_nr = event_nr[0];
+
+			if (event_nr[1] & (DM_NAME_LIST_FLAG_HAS_UUID |
+					   DM_NAME_LIST_FLAG_DOESNT_HAVE_UUID))
+				*devs_features |= DM_DEVICE_LIST_HAS_UUID;
+
+			if ((event_nr[1] & DM_NAME_LIST_FLAG_HAS_UUID) &&
+			    !(dm_dev->uuid = dm_pool_strdup(mem, (const char *) (event_nr + 2)))) {
+				log_error("Failed to allocate device list uuid.");
+				return 0;
+			}
+		}
+
+		dm_list_add(devs, &dm_dev->list);
+		next = names->next;
+	} while (next);
+
+	return 1;
+}
+
 struct dm_versions *dm_task_get_versions(struct dm_task *dmt)
 {
 	return (struct dm_versions *) (((char *) dmt->dmi.v4) +
@@ -1110,7 +1277,7 @@ static int _add_params(int type)
 	}
 }
 
-static struct dm_ioctl *_flatten(struct dm_task *dmt, unsigned repeat_count)
+static struct dm_ioctl *_flatten(struct dm_task *dmt, size_t buffer_size)
 {
 	const size_t min_size = 16 * 1024;
 	const int (*version)[3];
@@ -1119,6 +1286,7 @@ static struct dm_ioctl *_flatten(struct dm_task *dmt, unsigned repeat_count)
 	struct target *t;
 	struct dm_target_msg *tmsg;
 	size_t len = sizeof(struct dm_ioctl);
+	size_t used;
 	char *b, *e;
 	int count = 0;
 
@@ -1176,6 +1344,8 @@ static struct dm_ioctl *_flatten(struct dm_task *dmt, unsigned repeat_count)
 	if (dmt->geometry)
 		len += strlen(dmt->geometry) + 1;
 
+	used = len;
+
 	/*
 	 * Give len a minimum size so that we have space to store
 	 * dependencies or status information.
@@ -1183,11 +1353,11 @@ static struct dm_ioctl *_flatten(struct dm_task *dmt, unsigned repeat_count)
 	if (len < min_size)
 		len = min_size;
 
-	/* Increase buffer size if repeating because buffer was too small */
-	while (repeat_count--)
-		len *= 2;
+	/* Start with the size that was large enough last time */
+	if (len < buffer_size)
+		len = buffer_size;
 
-	if (!(dmi = zalloc(len)))
+	if (!(dmi = _dmi_alloc(len, used)))
 		return NULL;
 
 	version = &_cmd_data_v4[dmt->type].version;
@@ -1803,7 +1973,7 @@ static int _dm_ioctl_unmangle_uuids(int type, struct dm_ioctl *dmi)
 #endif
 
 static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
-				     unsigned buffer_repeat_count,
+				     size_t buffer_size,
 				     unsigned retry_repeat_count,
 				     int *retryable)
 {
@@ -1813,7 +1983,7 @@ static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
 
 	dmt->ioctl_errno = 0;
 
-	dmi = _flatten(dmt, buffer_repeat_count);
+	dmi = _flatten(dmt, buffer_size);
 	if (!dmi) {
 		log_error("Couldn't create ioctl argument.");
 		return NULL;
@@ -1822,6 +1992,10 @@ static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
 	if (dmt->type == DM_DEVICE_TABLE)
 		dmi->flags |= DM_STATUS_TABLE_FLAG;
 
+	/* Ask for uuids in the device list, older kernels ignore it */
+	if (dmt->type == DM_DEVICE_LIST)
+		dmi->flags |= DM_UUID_FLAG;
+
 	dmi->flags |= DM_EXISTS_FLAG;	/* FIXME */
 
 	if (dmt->no_open_count)
@@ -1991,6 +2165,7 @@ int dm_task_run(struct dm_task *dmt)
 	int rely_on_udev;
 	int suspended_counter;
 	unsigned ioctl_retry = 1;
+	unsigned buffer_retry = 0;
 	int retryable = 0;
 	const char *dev_name = DEV_NAME(dmt);
 	const char *dev_uuid = DEV_UUID(dmt);
@@ -2040,7 +2215,7 @@ int dm_task_run(struct dm_task *dmt)
 
 	/* FIXME Detect and warn if cookie set but should not be. */
 repeat_ioctl:
-	if (!(dmi = _do_dm_ioctl(dmt, command, _ioctl_buffer_double_factor,
+	if (!(dmi = _do_dm_ioctl(dmt, command, _ioctl_buffer_size[dmt->type],
 				 ioctl_retry, &retryable))) {
 		/*
 		 * Async udev rules that scan devices commonly cause transient
@@ -2067,7 +2242,12 @@ repeat_ioctl:
 		case DM_DEVICE_TABLE:
 		case DM_DEVICE_WAITEVENT:
 		case DM_DEVICE_TARGET_MSG:
-			_ioctl_buffer_double_factor++;
+			/* Kernel does not report the size needed */
+			_ioctl_buffer_size[dmt->type] = 2 * (size_t) dmi->data_size;
+			log_debug_activation("dm %s buffer of %u bytes too small, "
+					     "retrying with %" PRIsize_t " bytes (retry %u).",
+					     _cmd_data_v4[dmt->type].name, dmi->data_size,
+					     _ioctl_buffer_size[dmt->type], ++buffer_retry);
 			_dm_zfree_dmi(dmi);
 			goto repeat_ioctl;
 		default:
@@ -2157,6 +2337,7 @@ void dm_lib_release(void)
 {
 	if (!_hold_control_fd_open)
 		_close_control_fd();
+	_dmi_cache_release();
 	dm_timestamp_destroy(_dm_ioctl_timestamp);
 	_dm_ioctl_timestamp = NULL;
 	update_devs();
@@ -2177,6 +2358,7 @@ void dm_lib_exit(void)
 
 	dm_lib_release();
 	selinux_release();
+	release_suspended();
 	if (_dm_bitset)
 		dm_bitset_destroy(_dm_bitset);
 	_dm_bitset = NULL;
@@ -46,10 +46,12 @@ int get_dev_node_read_ahead(const char *dev_name, uint32_t major, uint32_t minor
 int set_dev_node_read_ahead(const char *dev_name, uint32_t major, uint32_t minor,
 			    uint32_t read_ahead, uint32_t read_ahead_flags);
 void update_devs(void);
+void init_dm_task(struct dm_task *dmt, int type);
 void selinux_release(void);
 
-void inc_suspended(void);
-void dec_suspended(void);
+void inc_suspended(uint32_t major, uint32_t minor);
+void dec_suspended(uint32_t major, uint32_t minor);
+void release_suspended(void);
 
 int parse_thin_pool_status(const char *params, struct dm_status_thin_pool *s);
 
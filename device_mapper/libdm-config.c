@@ -53,6 +53,16 @@ struct parser {
 	int no_dup_node_check;	/* whether to disable dup node checking */
 	const char *key;        /* last obtained key */
 	unsigned ignored_creation_time;
+
+	struct dm_hash_table *keys;	/* interned keys */
+	struct dm_hash_table *nodes;	/* (parent, interned key) -> node */
+	unsigned path_keys;		/* a key was a path, nodes is incomplete */
+};
+
+/* Sibling index key, valid because parsed keys are interned */
+struct node_index_key {
+	const struct dm_config_node *parent;
+	const char *key;
 };
 
 struct config_output {
@@ -188,11 +198,31 @@ static int _do_dm_config_parse(struct dm_config_tree *cft, const char *start, co
 	p->line = 1;
 	p->no_dup_node_check = no_dup_node_check;
 
-	_get_token(p, TOK_SECTION_E);
-	if (!(cft->root = _file(p)))
+	/*
+	 * Metadata repeats a small set of keys many thousands of times,
+	 * so each distinct key is stored once.  Duplicate checking looks
+	 * siblings up in an index rather than scanning every child, which
+	 * is quadratic for sections with thousands of entries.
+	 */
+	if (!(p->keys = dm_hash_create(256)))
 		return_0;
 
-	cft->root = _config_reverse(cft->root);
+	if (!no_dup_node_check &&
+	    !(p->nodes = dm_hash_create(((end - start) >> 6) + 64))) {
+		dm_hash_destroy(p->keys);
+		return_0;
+	}
+
+	_get_token(p, TOK_SECTION_E);
+	if ((cft->root = _file(p)))
+		cft->root = _config_reverse(cft->root);
+
+	dm_hash_destroy(p->keys);
+	if (p->nodes)
+		dm_hash_destroy(p->nodes);
+
+	if (!cft->root)
+		return_0;
 
 	return 1;
 }
@@ -573,39 +603,121 @@ static struct dm_config_node *_find_or_make_node(struct dm_pool *mem,
 	return NULL;
 }
 
+static const char *_intern_key(struct parser *p, const char *b, const char *e)
+{
+	char *key;
+
+	if ((key = dm_hash_lookup_binary(p->keys, b, e - b)))
+		return key;
+
+	if (!(key = _dup_token(p->mem, b, e)))
+		return_NULL;
+
+	if (!dm_hash_insert_binary(p->keys, key, e - b, key)) {
+		log_error("Failed to intern config key.");
+		return NULL;
+	}
+
+	return key;
+}
+
+static struct dm_config_node *_parser_make_node(struct parser *p,
+						struct dm_config_node *parent,
+						const char *key)
+{
+	struct node_index_key ik = { .parent = parent, .key = key };
+	struct dm_config_node *cn;
+
+	if (p->nodes && (cn = dm_hash_lookup_binary(p->nodes, &ik, sizeof(ik))))
+		return cn;
+
+	if (!(cn = _create_node(p->mem)))
+		return_NULL;
+
+	cn->key = key;
+	cn->parent = parent;
+	cn->sib = parent->child;
+	parent->child = cn;
+
+	if (p->nodes && !dm_hash_insert_binary(p->nodes, &ik, sizeof(ik), cn)) {
+		log_error("Failed to index config node %s.", key);
+		return NULL;
+	}
+
+	return cn;
+}
+
+/*
+ * Look up or create the node for a key in the section being parsed.
+ * Keys containing a path separator go through _find_or_make_node(),
+ * which creates nodes outside the index, so from then on the index
+ * cannot be trusted and the linear search is used for the rest of
+ * the parse.
+ */
+static struct dm_config_node *_parser_find_or_make_node(struct parser *p,
+							struct dm_config_node *parent,
+							const char *b, const char *e)
+{
+	struct dm_config_node *cn;
+	const char *key;
+
+	if (memchr(b, _sep, e - b)) {
+		p->path_keys = 1;
+		if (!(key = _dup_token(p->mem, b, e)))
+			return_NULL;
+
+		return _find_or_make_node(p->mem, parent, key, p->no_dup_node_check);
+	}
+
+	if (!(key = _intern_key(p, b, e)))
+		return_NULL;
+
+	if (p->path_keys && !p->no_dup_node_check &&
+	    (cn = _find_or_make_node(NULL, parent, key, 0)))
+		return cn;
+
+	return _parser_make_node(p, parent, key);
+}
+
 static struct dm_config_node *_section(struct parser *p, struct dm_config_node *parent)
 {
 	/* IDENTIFIER SECTION_B_CHAR VALUE* SECTION_E_CHAR */
 
 	struct dm_config_node *root;
 	struct dm_config_value *value;
+	const char *kb, *ke;
 	char *str;
 
 	if (p->t == TOK_STRING_ESCAPED) {
 		if (!(str = _dup_string_tok(p)))
 			return_NULL;
 		dm_unescape_double_quotes(str);
+		kb = str;
+		ke = str + strlen(str);
 
 		match(TOK_STRING_ESCAPED);
 	} else if (p->t == TOK_STRING) {
 		if (!(str = _dup_string_tok(p)))
 			return_NULL;
+		kb = str;
+		ke = str + strlen(str);
 
 		match(TOK_STRING);
 	} else {
-		if (!(str = _dup_tok(p)))
-			return_NULL;
+		/* Plain identifiers are interned straight from the token. */
+		kb = p->tb;
+		ke = p->te;
 
 		match(TOK_IDENTIFIER);
 	}
 
-	if (!strlen(str)) {
+	if (kb == ke) {
 		log_error("Parse error at byte %" PRIptrdiff_t " (line %d): empty section identifier",
 			  p->tb - p->fb + 1, p->line);
 		return NULL;
 	}
 
-	if (!(root = _find_or_make_node(p->mem, parent, str, p->no_dup_node_check)))
+	if (!(root = _parser_find_or_make_node(p, parent, kb, ke)))
 		return_NULL;
 
 	if (p->t == TOK_SECTION_B) {
@@ -622,7 +734,7 @@ static struct dm_config_node *_section(struct parser *p, struct dm_config_node *
 			return_NULL;
 		if (root->v)
 			log_warn("WARNING: Ignoring duplicate"
-				 " config value: %s", str);
+				 " config value: %s", root->key);
 		root->v = value;
 	}
 
@@ -299,6 +299,7 @@ struct load_properties {
 struct dm_tree_link {
 	struct dm_list list;
 	struct dm_tree_node *node;
+	struct dm_tree_link *peer;	/* The other link of the pair */
 };
 
 struct dm_tree_node {
@@ -350,6 +351,8 @@ struct dm_tree {
 	int skip_lockfs;		/* 1 skips lockfs (for non-snapshots) */
 	int no_flush;			/* 1 sets noflush (mirrors/multipath) */
 	int retry_remove;		/* 1 retries remove if not successful */
+	int deferred_remove;		/* 1 defers remove of open top-level devices */
+	int tables_changed;		/* 1 once preload left work for suspend/resume */
 	uint32_t cookie;
 	char buf[DM_NAME_LEN + 32];	/* print buffer for device_name (major:minor) */
 	const char **optional_uuid_suffixes;	/* uuid suffixes ignored when matching */
@@ -431,70 +434,97 @@ void dm_tree_retry_remove(struct dm_tree_node *dnode)
 	dnode->dtree->retry_remove = 1;
 }
 
+void dm_tree_deferred_remove(struct dm_tree_node *dnode)
+{
+	dnode->dtree->deferred_remove = 1;
+}
+
 /*
  * Node functions.
  */
-static int _nodes_are_linked(const struct dm_tree_node *parent,
-			     const struct dm_tree_node *child)
+/*
+ * A link appears in both parent->uses and child->used_by, so both lists
+ * are walked together and the search ends with the shorter one.  The
+ * root node's lists hold every top or bottom level node, and scanning
+ * them in full for each check made building large trees quadratic.
+ *
+ * Returns the link in parent->uses.
+ */
+static struct dm_tree_link *_find_link(const struct dm_tree_node *parent,
+				       const struct dm_tree_node *child)
 {
+	const struct dm_list *u = dm_list_first(&parent->uses);
+	const struct dm_list *b = dm_list_first(&child->used_by);
 	struct dm_tree_link *dlink;
 
-	dm_list_iterate_items(dlink, &parent->uses)
-		if (dlink->node == child)
-			return 1;
+	while (u && b) {
+		if ((dlink = dm_list_item(u, struct dm_tree_link))->node == child)
+			return dlink;
 
-	return 0;
+		if ((dlink = dm_list_item(b, struct dm_tree_link))->node == parent)
+			return dlink->peer;
+
+		u = dm_list_next(&parent->uses, u);
+		b = dm_list_next(&child->used_by, b);
+	}
+
+	return NULL;
+}
+
+static int _nodes_are_linked(const struct dm_tree_node *parent,
+			     const struct dm_tree_node *child)
+{
+	return _find_link(parent, child) ? 1 : 0;
 }
 
-static int _link(struct dm_list *list, struct dm_tree_node *node)
+static struct dm_tree_link *_link(struct dm_list *list, struct dm_tree_node *node)
 {
 	struct dm_tree_link *dlink;
 
 	if (!(dlink = dm_pool_alloc(node->dtree->mem, sizeof(*dlink)))) {
 		log_error("dtree link allocation failed");
-		return 0;
+		return NULL;
 	}
 
 	dlink->node = node;
+	dlink->peer = NULL;
 	dm_list_add(list, &dlink->list);
 
-	return 1;
+	return dlink;
 }
 
 static int _link_nodes(struct dm_tree_node *parent,
 		       struct dm_tree_node *child)
 {
+	struct dm_tree_link *uses, *used_by;
+
 	if (_nodes_are_linked(parent, child))
 		return 1;
 
-	if (!_link(&parent->uses, child))
+	if (!(uses = _link(&parent->uses, child)))
 		return 0;
 
-	if (!_link(&child->used_by, parent))
+	if (!(used_by = _link(&child->used_by, parent))) {
+		dm_list_del(&uses->list);
 		return 0;
+	}
 
-	return 1;
-}
-
-static void _unlink(struct dm_list *list, struct dm_tree_node *node)
-{
-	struct dm_tree_link *dlink;
+	uses->peer = used_by;
+	used_by->peer = uses;
 
-	dm_list_iterate_items(dlink, list)
-		if (dlink->node == node) {
-			dm_list_del(&dlink->list);
-			break;
-		}
+	return 1;
 }
 
 static void _unlink_nodes(struct dm_tree_node *parent,
 			  struct dm_tree_node *child)
 {
-	if (!_nodes_are_linked(parent, child))
+	struct dm_tree_link *dlink;
+
+	if (!(dlink = _find_link(parent, child)))
 		return;
 
-	_unlink(&parent->uses, child);
-	_unlink(&child->used_by, parent);
+	dm_list_del(&dlink->peer->list);
+	dm_list_del(&dlink->list);
 }
 
 static int _add_to_toplevel(struct dm_tree_node *node)
@@ -707,6 +737,11 @@ int dm_tree_node_size_changed(const struct dm_tree_node *dnode)
 	return dnode->props.size_changed;
 }
 
+int dm_tree_node_tables_changed(const struct dm_tree_node *dnode)
+{
+	return dnode->dtree->tables_changed;
+}
+
 int dm_tree_node_num_children(const struct dm_tree_node *node, uint32_t inverted)
 {
 	if (inverted) {
@@ -1024,7 +1059,8 @@ static int _node_has_closed_parents(struct dm_tree_node *node,
 }
 
 static int _deactivate_node(const char *name, uint32_t major, uint32_t minor,
-			    uint32_t *cookie, uint16_t udev_flags, int retry)
+			    uint32_t *cookie, uint16_t udev_flags, int retry,
+			    int deferred)
 {
 	struct dm_task *dmt;
 	int r = 0;
@@ -1048,7 +1084,11 @@ static int _deactivate_node(const char *name, uint32_t major, uint32_t minor,
 		if (!dm_task_set_cookie(dmt, cookie, udev_flags))
 			goto out;
 
-	if (retry)
+	if (deferred) {
+		log_verbose("Deferring removal of open %s (%" PRIu32 ":%" PRIu32 ")",
+			    name, major, minor);
+		dm_task_deferred_remove(dmt);
+	} else if (retry)
 		dm_task_retry_remove(dmt);
 
 	r = dm_task_run(dmt);
@@ -1140,11 +1180,11 @@ static int _node_clear_table(struct dm_tree_node *dnode, uint16_t udev_flags)
 			continue;
 
 		/* Remove device. */
-		if (!_deactivate_node(name, deps_info.major, deps_info.minor, &dnode->dtree->cookie, udev_flags, 0)) {
+		if (!_deactivate_node(name, deps_info.major, deps_info.minor, &dnode->dtree->cookie, udev_flags, 0, 0)) {
 			log_error("Failed to deactivate no-longer-used device %s (%"
 				  PRIu32 ":%" PRIu32 ")", name, deps_info.major, deps_info.minor);
 		} else if (deps_info.suspended)
-			dec_suspended();
+			dec_suspended(deps_info.major, deps_info.minor);
 	}
 
 out:
@@ -1369,7 +1409,7 @@ static int _resume_node(const char *name, uint32_t major, uint32_t minor,
 		goto_out;
 
 	if (already_suspended)
-		dec_suspended();
+		dec_suspended(major, minor);
 
 	if (!(r = dm_task_get_info(dmt, newinfo)))
 		stack;
@@ -1411,7 +1451,7 @@ static int _suspend_node(const char *name, uint32_t major, uint32_t minor,
 		log_warn("WARNING: Failed to set no_flush flag.");
 
 	if ((r = dm_task_run(dmt))) {
-		inc_suspended();
+		inc_suspended(major, minor);
 		r = dm_task_get_info(dmt, newinfo);
 	}
 out:
@@ -1791,8 +1831,11 @@ static int _dm_tree_deactivate_children(struct dm_tree_node *dnode,
 	const struct dm_info *dinfo;
 	const char *name;
 	const char *uuid;
+	int deferred;
 
 	while ((child = dm_tree_next_child(&handle, dnode, 0))) {
+		deferred = 0;
+
 		if (!(dinfo = dm_tree_node_get_info(child))) {
 			stack;
 			continue;
@@ -1829,8 +1872,12 @@ static int _dm_tree_deactivate_children(struct dm_tree_node *dnode,
 			if (level && !strstr(name, "_mimage"))
 				continue;
 
+			/* The kernel removes it when it is closed */
+			if (!level && child->dtree->deferred_remove)
+				deferred = 1;
+
 			/* When retry is not allowed, error */
-			if (!child->dtree->retry_remove) {
+			else if (!child->dtree->retry_remove) {
 				log_error("Unable to deactivate open %s (" FMTu32 ":"
 					  FMTu32 ").", name, info.major, info.minor);
 				r = 0;
@@ -1843,7 +1890,7 @@ static int _dm_tree_deactivate_children(struct dm_tree_node *dnode,
 				r = 0;
 				continue;
 			}
-			/* Go on with retry */
+			/* Go on with retry or deferred removal */
 		}
 
 		/* Also checking open_count in parent nodes of presuspend_node */
@@ -1866,15 +1913,19 @@ static int _dm_tree_deactivate_children(struct dm_tree_node *dnode,
 
 		if (!_deactivate_node(name, info.major, info.minor,
 				      &child->dtree->cookie, child->udev_flags,
-				      child->dtree->retry_remove)) {
+				      child->dtree->retry_remove, deferred)) {
 			log_error("Unable to deactivate %s (" FMTu32 ":"
 				  FMTu32 ").", name, info.major, info.minor);
 			r = 0;
 			continue;
 		}
 
+		/* Still open, so it keeps its children in use */
+		if (deferred)
+			continue;
+
 		if (info.suspended && info.live_table)
-			dec_suspended();
+			dec_suspended(info.major, info.minor);
 
 		if (child->callback &&
 		    !child->callback(child, DM_NODE_CALLBACK_DEACTIVATED,
@@ -3062,23 +3113,26 @@ static int _emit_segment_line(struct dm_task *dmt, uint32_t major,
 
 #undef EMIT_PARAMS
 
+/*
+ * All the segments of a node are emitted into the same params buffer.
+ * The buffer only grows, so once one segment has needed more space the
+ * following ones are written into it once instead of overflowing again.
+ */
 static int _emit_segment(struct dm_task *dmt, uint32_t major, uint32_t minor,
-			 struct load_segment *seg, uint64_t *seg_start)
+			 struct load_segment *seg, uint64_t *seg_start,
+			 char **params, size_t *paramsize)
 {
-	char *params;
-	size_t paramsize = 4096; /* FIXME: too small for long RAID lines when > 64 devices supported */
 	int ret;
 
-	do {
-		if (!(params = malloc(paramsize))) {
+	while (1) {
+		if (!*params && !(*params = malloc(*paramsize))) {
 			log_error("Insufficient space for target parameters.");
 			return 0;
 		}
 
-		params[0] = '\0';
+		(*params)[0] = '\0';
 		ret = _emit_segment_line(dmt, major, minor, seg, seg_start,
-					 params, paramsize);
-		free(params);
+					 *params, *paramsize);
 
 		if (!ret)
 			stack;
@@ -3087,10 +3141,14 @@ static int _emit_segment(struct dm_task *dmt, uint32_t major, uint32_t minor,
 			return ret;
 
 		log_debug_activation("Insufficient space in params[%" PRIsize_t
-				     "] for target parameters.", paramsize);
+				     "] for target parameters.", *paramsize);
 
-		paramsize *= 2;
-	} while (paramsize < MAX_TARGET_PARAMSIZE);
+		free(*params);
+		*params = NULL;
+
+		if ((*paramsize *= 2) >= MAX_TARGET_PARAMSIZE)
+			break;
+	}
 
 	log_error("Target parameter size too big. Aborting.");
 	return 0;
@@ -3102,6 +3160,8 @@ static int _load_node(struct dm_tree_node *dnode)
 	struct dm_task *dmt;
 	struct load_segment *seg;
 	uint64_t seg_start = 0, existing_table_size;
+	char *params = NULL;
+	size_t paramsize = 4096; /* FIXME: too small for long RAID lines when > 64 devices supported */
 
 	log_verbose("Loading table for %s.", _node_name(dnode));
 
@@ -3126,7 +3186,7 @@ static int _load_node(struct dm_tree_node *dnode)
 
 	dm_list_iterate_items(seg, &dnode->props.segs)
 		if (!_emit_segment(dmt, dnode->info.major, dnode->info.minor,
-				   seg, &seg_start))
+				   seg, &seg_start, &params, &paramsize))
 			goto_out;
 
 	if (!dm_task_suppress_identical_reload(dmt))
@@ -3175,6 +3235,7 @@ static int _load_node(struct dm_tree_node *dnode)
 	dnode->props.segment_count = 0;
 
 out:
+	free(params);
 	dm_task_destroy(dmt);
 
 	return r;
@@ -3195,7 +3256,7 @@ static int _dm_tree_revert_activated(struct dm_tree_node *parent)
 			child->callback = NULL;
 		}
 		if (!_deactivate_node(child->name, child->info.major, child->info.minor,
-				      &child->dtree->cookie, child->udev_flags, 0)) {
+				      &child->dtree->cookie, child->udev_flags, 0, 0)) {
 			log_error("Unable to deactivate %s.", _node_name(child));
 			return 0;
 		}
@@ -3266,6 +3327,11 @@ int dm_tree_preload_children(struct dm_tree_node *dnode,
 			continue;
 		}
 
+		/* Identical reloads were suppressed, anything else needs the resume */
+		if (child->info.inactive_table || child->info.suspended ||
+		    child->props.new_name || (child->props.send_messages > 1))
+			child->dtree->tables_changed = 1;
+
 		/* No resume for a device without parents or with unchanged or smaller size */
 		if (!dm_tree_node_num_children(child, 1))
 			continue;
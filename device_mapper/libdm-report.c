@@ -65,6 +65,8 @@ struct dm_report {
 	/* Array of field definitions */
 	const struct dm_report_field_type *fields;
 	const char **canonical_field_ids;
+	/* Lower case canonical field id to field number + 1 */
+	struct dm_hash_table *field_index;
 	const struct dm_report_object_type *types;
 
 	/* To store caller private data */
@@ -78,6 +80,16 @@ struct dm_report {
 	struct dm_hash_table *value_cache;
 
 	struct report_group_item *group_item;
+
+	/*
+	 * JSON rows are built in json_row. The previous row is kept in
+	 * json_held_row until we know whether a separator follows it.
+	 */
+	struct json_buf {
+		char *mem;
+		size_t len;
+		size_t size;
+	} json_row, json_held_row;
 };
 
 struct dm_report_group {
@@ -110,6 +122,7 @@ struct report_group_item {
 #define FLD_DESCENDING	0x00008000
 #define FLD_COMPACTED	0x00010000
 #define FLD_COMPACT_ONE 0x00020000
+#define FLD_SELECTION	0x00040000
 
 struct field_properties {
 	struct dm_list list;
@@ -120,6 +133,7 @@ struct field_properties {
 	const struct dm_report_object_type *type;
 	uint32_t flags;
 	int implicit;
+	struct dm_report_field *sel_field; /* This field in the row under selection */
 };
 
 /*
@@ -970,6 +984,49 @@ static int _add_all_fields(struct dm_report *rh, uint32_t type)
 	return 1;
 }
 
+static void _lowercase(char *dst, const char *src, size_t len)
+{
+	while (len--)
+		*dst++ = tolower(*src++);
+	*dst = '\0';
+}
+
+/*
+ * Look up a canonical field name in the field index, as it is, and
+ * with the report prefix, returning the lower field number if both
+ * match, like a scan of the field table in _is_same_field() order.
+ */
+static int _find_field(struct dm_report *rh, const char *field_canon, uint32_t *f_ret)
+{
+	char key[2 * DM_REPORT_FIELD_TYPE_ID_LEN];
+	size_t prefix_len = strlen(rh->field_prefix);
+	size_t len = strlen(field_canon);
+	uintptr_t f, fp = 0;
+
+	if (len >= DM_REPORT_FIELD_TYPE_ID_LEN)
+		return 0;
+
+	_lowercase(key, field_canon, len);
+	f = (uintptr_t) dm_hash_lookup(rh->field_index, key);
+
+	/* The prefix in canonical form, without its trailing underscore. */
+	if (prefix_len-- > 1 && prefix_len < DM_REPORT_FIELD_TYPE_ID_LEN) {
+		_lowercase(key, rh->field_prefix, prefix_len);
+		_lowercase(key + prefix_len, field_canon, len);
+		fp = (uintptr_t) dm_hash_lookup(rh->field_index, key);
+	}
+
+	if (!f || (fp && fp < f))
+		f = fp;
+
+	if (!f)
+		return 0;
+
+	*f_ret = (uint32_t) (f - 1);
+
+	return 1;
+}
+
 static int _get_field(struct dm_report *rh, const char *field, size_t flen,
 		      uint32_t *f_ret, int *implicit)
 {
@@ -990,12 +1047,9 @@ static int _get_field(struct dm_report *rh, const char *field, size_t flen,
 		}
 	}
 
-	for (f = 0; rh->fields[f].report_fn; f++) {
-		if (_is_same_field(rh->canonical_field_ids[f], field_canon, rh->field_prefix)) {
-			*f_ret = f;
-			*implicit = 0;
-			return 1;
-		}
+	if (_find_field(rh, field_canon, f_ret)) {
+		*implicit = 0;
+		return 1;
 	}
 
 	return 0;
@@ -1102,9 +1156,8 @@ static int _key_match(struct dm_report *rh, const char *key, size_t len,
 		if (_is_same_field(_implicit_report_fields[f].id, key_canon, rh->field_prefix))
 			return _add_sort_key(rh, f, 1, flags, report_type_only);
 
-	for (f = 0; rh->fields[f].report_fn; f++)
-		if (_is_same_field(rh->canonical_field_ids[f], key_canon, rh->field_prefix))
-			return _add_sort_key(rh, f, 0, flags, report_type_only);
+	if (_find_field(rh, key_canon, &f))
+		return _add_sort_key(rh, f, 0, flags, report_type_only);
 
 	return 0;
 }
@@ -1215,6 +1268,7 @@ static int _canonicalize_field_ids(struct dm_report *rh)
 {
 	size_t registered_field_count = 0, i;
 	char canonical_field[DM_REPORT_FIELD_TYPE_ID_LEN];
+	char key[DM_REPORT_FIELD_TYPE_ID_LEN];
 	char *canonical_field_dup;
 	int differs;
 
@@ -1226,11 +1280,28 @@ static int _canonicalize_field_ids(struct dm_report *rh)
 		return 0;
 	}
 
+	/*
+	 * Field lists and selections name fields by id, hash the ids once
+	 * instead of comparing each name with the whole field table.
+	 */
+	if (!(rh->field_index = dm_hash_create(registered_field_count * 2 + 1))) {
+		log_error("_canonicalize_field_ids: dm_hash_create failed");
+		return 0;
+	}
+
 	for (i = 0; i < registered_field_count; i++) {
 		if (!_get_canonical_field_name(rh->fields[i].id, strlen(rh->fields[i].id),
 					       canonical_field, sizeof(canonical_field), &differs))
 			return_0;
 
+		/* The first of any duplicate ids is found, as with a scan. */
+		_lowercase(key, canonical_field, strlen(canonical_field));
+		if (!dm_hash_lookup(rh->field_index, key) &&
+		    !dm_hash_insert(rh->field_index, key, (void *) (uintptr_t) (i + 1))) {
+			log_error("_canonicalize_field_ids: dm_hash_insert failed");
+			return 0;
+		}
+
 		if (differs) {
 			if (!(canonical_field_dup = dm_pool_strdup(rh->mem, canonical_field))) {
 				log_error("_canonicalize_field_dup: dm_pool_alloc failed.");
@@ -1349,6 +1420,10 @@ void dm_report_free(struct dm_report *rh)
 		dm_pool_destroy(rh->selection->mem);
 	if (rh->value_cache)
 		dm_hash_destroy(rh->value_cache);
+	if (rh->field_index)
+		dm_hash_destroy(rh->field_index);
+	free(rh->json_row.mem);
+	free(rh->json_held_row.mem);
 	dm_pool_destroy(rh->mem);
 	free(rh);
 }
@@ -1881,13 +1956,8 @@ static int _check_selection(struct dm_report *rh, struct selection_node *sn,
 
 	switch (sn->type & SEL_MASK) {
 		case SEL_ITEM:
-			r = 1;
-			dm_list_iterate_items(f, fields) {
-				if (sn->selection.item->fp != f->props)
-					continue;
-				if (!_compare_selection_field(rh, f, sn->selection.item))
-					r = 0;
-			}
+			f = sn->selection.item->fp->sel_field;
+			r = _compare_selection_field(rh, f, sn->selection.item);
 			break;
 		case SEL_OR:
 			r = 0;
@@ -1911,19 +1981,53 @@ static int _check_selection(struct dm_report *rh, struct selection_node *sn,
 
 static int _check_report_selection(struct dm_report *rh, struct dm_list *fields)
 {
+	struct dm_report_field *f;
+
 	if (!rh->selection || !rh->selection->selection_root)
 		return 1;
 
+	/* Let each selection item find its field without searching the row. */
+	dm_list_iterate_items(f, fields)
+		f->props->sel_field = f;
+
 	return _check_selection(rh, rh->selection->selection_root, fields);
 }
 
+static int _report_field(struct dm_report *rh, struct row *row, void *object,
+			 struct dm_report_field *field)
+{
+	struct field_properties *fp = field->props;
+	const struct dm_report_field_type *fields = fp->implicit ? _implicit_report_fields
+								 : rh->fields;
+	void *data;
+
+	data = fp->implicit ? _report_get_implicit_field_data(rh, fp, row)
+			    : _report_get_field_data(rh, fp, object);
+	if (!data) {
+		log_error("_do_report_object: "
+			  "no data assigned to field %s",
+			  fields[fp->field_num].id);
+		return 0;
+	}
+
+	if (!fields[fp->field_num].report_fn(rh, rh->mem,
+						 field, data,
+						 rh->private)) {
+		log_error("_do_report_object: "
+			  "report function failed for field %s",
+			  fields[fp->field_num].id);
+		return 0;
+	}
+
+	return 1;
+}
+
 static int _do_report_object(struct dm_report *rh, void *object, int do_output, int *selected)
 {
-	const struct dm_report_field_type *fields;
 	struct field_properties *fp;
 	struct row *row = NULL;
 	struct dm_report_field *field;
-	void *data = NULL;
+	int early_selection;
 	int r = 0;
 
 	if (!rh) {
@@ -1962,7 +2066,7 @@ static int _do_report_object(struct dm_report *rh, void *object, int do_output,
 	dm_list_init(&row->fields);
 	row->selected = 1;
 
-	/* For each field to be displayed, call its report_fn */
+	/* Allocate a field for each one to be displayed */
 	dm_list_iterate_items(fp, &rh->field_props) {
 		if (!(field = dm_pool_zalloc(rh->mem, sizeof(*field)))) {
 			log_error("_do_report_object: "
@@ -1970,39 +2074,45 @@ static int _do_report_object(struct dm_report *rh, void *object, int do_output,
 			goto out;
 		}
 
-		if (fp->implicit) {
-			fields = _implicit_report_fields;
-			if (!strcmp(fields[fp->field_num].id, SPECIAL_FIELD_SELECTED_ID))
-				row->field_sel_status = field;
-		} else
-			fields = rh->fields;
+		if (fp->implicit &&
+		    !strcmp(_implicit_report_fields[fp->field_num].id, SPECIAL_FIELD_SELECTED_ID))
+			row->field_sel_status = field;
 
 		field->props = fp;
+		dm_list_add(&row->fields, &field->list);
+	}
 
-		data = fp->implicit ? _report_get_implicit_field_data(rh, fp, row)
-				    : _report_get_field_data(rh, fp, object);
-		if (!data) {
-			log_error("_do_report_object: "
-				  "no data assigned to field %s",
-				  fields[fp->field_num].id);
-			goto out;
-		}
+	/*
+	 * Unless a row that is not selected is still kept for output,
+	 * call report_fn only for fields the selection refers to first.
+	 * The rest is reported only for selected rows that are output.
+	 */
+	early_selection = !row->field_sel_status &&
+			  !(rh->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES);
 
-		if (!fields[fp->field_num].report_fn(rh, rh->mem,
-							 field, data,
-							 rh->private)) {
-			log_error("_do_report_object: "
-				  "report function failed for field %s",
-				  fields[fp->field_num].id);
+	if (early_selection) {
+		dm_list_iterate_items(field, &row->fields)
+			if ((field->props->flags & FLD_SELECTION) &&
+			    !_report_field(rh, row, object, field))
+				goto out;
+
+		r = 1;
+		if (!(row->selected = _check_report_selection(rh, &row->fields)) ||
+		    !do_output)
 			goto out;
-		}
+		r = 0;
+	}
 
-		dm_list_add(&row->fields, &field->list);
+	dm_list_iterate_items(field, &row->fields) {
+		if (early_selection && (field->props->flags & FLD_SELECTION))
+			continue;
+		if (!_report_field(rh, row, object, field))
+			goto out;
 	}
 
 	r = 1;
 
-	if (!_check_report_selection(rh, &row->fields)) {
+	if (!early_selection && !_check_report_selection(rh, &row->fields)) {
 		row->selected = 0;
 
 		/*
@@ -3506,6 +3616,7 @@ static struct field_selection *_create_field_selection(struct dm_report *rh,
 
 	fs->fp = found;
 	fs->flags = flags;
+	found->flags |= FLD_SELECTION;
 
 	if (!_get_reserved_value(rh, field_num, rvw)) {
 		log_error("dm_report: could not get reserved value "
@@ -4275,74 +4386,124 @@ int dm_report_column_headings(struct dm_report *rh)
 
 /*
  * Sort rows of data
+ *
+ * All sort fields of a row are encoded once into a single byte key
+ * that compares with memcmp() in the requested order:
+ *   - numbers, sizes, percents and times as 8 big-endian bytes,
+ *   - strings and string lists with their terminating NUL,
+ * with every byte inverted for descending keys.  Each encoded field is
+ * prefix-free, so the first differing byte decides like _row_compare
+ * used to do field by field.
  */
-static int _row_compare(const void *a, const void *b)
+struct sort_item {
+	uint64_t prefix;		/* First 8 key bytes as a big-endian number */
+	const unsigned char *key;
+	size_t len;
+	struct row *row;
+};
+
+static int _is_numeric_sort_field(const struct dm_report_field *field)
+{
+	return (field->props->flags & (DM_REPORT_FIELD_TYPE_NUMBER |
+				       DM_REPORT_FIELD_TYPE_SIZE |
+				       DM_REPORT_FIELD_TYPE_PERCENT |
+				       DM_REPORT_FIELD_TYPE_TIME)) ? 1 : 0;
+}
+
+static const char *_sort_string(const struct dm_report_field *field)
 {
-	const struct row *rowa = *(const struct row * const *) a;
-	const struct row *rowb = *(const struct row * const *) b;
-	const struct dm_report_field *sfa, *sfb;
+	if (field->props->flags & DM_REPORT_FIELD_TYPE_STRING_LIST)
+		return ((const struct str_list_sort_value *) field->sort_value)->value;
+
+	return (const char *) field->sort_value;
+}
+
+static int _encode_sort_key(struct dm_report *rh, struct sort_item *item)
+{
+	const struct dm_report_field *sf;
+	unsigned char *key, *p;
+	unsigned char mask;
+	size_t len = 0, i, n;
+	uint64_t num;
 	uint32_t cnt;
 
-	for (cnt = 0; cnt < rowa->rh->keys_count; cnt++) {
-		sfa = (*rowa->sort_fields)[cnt];
-		sfb = (*rowb->sort_fields)[cnt];
-		if ((sfa->props->flags & DM_REPORT_FIELD_TYPE_NUMBER) ||
-		    (sfa->props->flags & DM_REPORT_FIELD_TYPE_SIZE) ||
-		    (sfa->props->flags & DM_REPORT_FIELD_TYPE_TIME)) {
-			const uint64_t numa =
-			    *(const uint64_t *) sfa->sort_value;
-			const uint64_t numb =
-			    *(const uint64_t *) sfb->sort_value;
-
-			if (numa == numb)
-				continue;
+	for (cnt = 0; cnt < rh->keys_count; cnt++) {
+		sf = (*item->row->sort_fields)[cnt];
+		len += _is_numeric_sort_field(sf) ? sizeof(num) :
+			strlen(_sort_string(sf)) + 1;
+	}
 
-			if (sfa->props->flags & FLD_ASCENDING) {
-				return (numa > numb) ? 1 : -1;
-			} else {	/* FLD_DESCENDING */
-				return (numa < numb) ? 1 : -1;
-			}
-		} else {
-			/* DM_REPORT_FIELD_TYPE_STRING
-			 * DM_REPORT_FIELD_TYPE_STRING_LIST */
-			const char *stra = (const char *) sfa->sort_value;
-			const char *strb = (const char *) sfb->sort_value;
-			int cmp = strcmp(stra, strb);
+	if (!(key = dm_pool_alloc(rh->mem, len))) {
+		log_error("dm_report: sort key allocation failed");
+		return 0;
+	}
 
-			if (!cmp)
-				continue;
+	for (p = key, cnt = 0; cnt < rh->keys_count; cnt++) {
+		sf = (*item->row->sort_fields)[cnt];
+		mask = (sf->props->flags & FLD_DESCENDING) ? 0xff : 0;
 
-			if (sfa->props->flags & FLD_ASCENDING) {
-				return (cmp > 0) ? 1 : -1;
-			} else {	/* FLD_DESCENDING */
-				return (cmp < 0) ? 1 : -1;
-			}
+		if (_is_numeric_sort_field(sf)) {
+			num = *(const uint64_t *) sf->sort_value;
+			for (i = 0; i < sizeof(num); i++)
+				*p++ = (unsigned char) (num >> (56 - 8 * i)) ^ mask;
+		} else {
+			n = strlen(_sort_string(sf)) + 1;
+			memcpy(p, _sort_string(sf), n);
+			for (i = 0; i < n; i++)
+				*p++ ^= mask;
 		}
 	}
 
-	return 0;		/* Identical */
+	item->key = key;
+	item->len = len;
+	for (item->prefix = 0, i = 0; i < sizeof(item->prefix); i++)
+		item->prefix = (item->prefix << 8) | (i < len ? key[i] : 0);
+
+	return 1;
+}
+
+static int _row_compare(const void *a, const void *b)
+{
+	const struct sort_item *ia = a;
+	const struct sort_item *ib = b;
+	size_t len;
+	int cmp;
+
+	if (ia->prefix != ib->prefix)
+		return (ia->prefix > ib->prefix) ? 1 : -1;
+
+	len = (ia->len < ib->len) ? ia->len : ib->len;
+	if (len > sizeof(ia->prefix) &&
+	    (cmp = memcmp(ia->key + sizeof(ia->prefix), ib->key + sizeof(ib->prefix),
+			  len - sizeof(ia->prefix))))
+		return cmp;
+
+	return (ia->len > ib->len) - (ia->len < ib->len);
 }
 
 static int _sort_rows(struct dm_report *rh)
 {
-	struct row *(*rows)[];
+	struct sort_item *items;
 	uint32_t count = 0;
 	struct row *row;
 
-	if (!(rows = dm_pool_alloc(rh->mem, sizeof(**rows) *
-				dm_list_size(&rh->rows)))) {
+	if (!(items = dm_pool_alloc(rh->mem, sizeof(*items) *
+				    dm_list_size(&rh->rows)))) {
 		log_error("dm_report: sort array allocation failed");
 		return 0;
 	}
 
-	dm_list_iterate_items(row, &rh->rows)
-		(*rows)[count++] = row;
+	dm_list_iterate_items(row, &rh->rows) {
+		items[count].row = row;
+		if (!_encode_sort_key(rh, &items[count++]))
+			return_0;
+	}
 
-	qsort(rows, count, sizeof(**rows), _row_compare);
+	qsort(items, count, sizeof(*items), _row_compare);
 
 	dm_list_init(&rh->rows);
 	while (count--)
-		dm_list_add_h(&rh->rows, &(*rows)[count]->list);
+		dm_list_add_h(&rh->rows, &items[count].row->list);
 
 	return 1;
 }
@@ -4375,6 +4536,12 @@ static int _is_json_report(struct dm_report *rh)
 	       (rh->group_item->group->type == DM_REPORT_GROUP_JSON);
 }
 
+static int _is_binary_report(struct dm_report *rh)
+{
+	return rh->group_item &&
+	       (rh->group_item->group->type == DM_REPORT_GROUP_BINARY);
+}
+
 /*
  * Produce report output
  */
@@ -4386,20 +4553,10 @@ static int _output_field(struct dm_report *rh, struct dm_report_field *field)
 	int32_t width;
 	uint32_t align;
 	const char *repstr;
-	const char *p1_repstr, *p2_repstr;
 	char *buf = NULL;
 	size_t buf_size = 0;
 
-	if (_is_json_report(rh)) {
-		if (!dm_pool_grow_object(rh->mem, JSON_QUOTE, 1) ||
-		    !dm_pool_grow_object(rh->mem, fields[field->props->field_num].id, 0) ||
-		    !dm_pool_grow_object(rh->mem, JSON_QUOTE, 1) ||
-		    !dm_pool_grow_object(rh->mem, JSON_PAIR, 1) ||
-		    !dm_pool_grow_object(rh->mem, JSON_QUOTE, 1)) {
-			log_error("dm_report: Unable to extend output line");
-			return 0;
-		}
-	} else if (rh->flags & DM_REPORT_OUTPUT_FIELD_NAME_PREFIX) {
+	if (rh->flags & DM_REPORT_OUTPUT_FIELD_NAME_PREFIX) {
 		if (!(field_id = strdup(fields[field->props->field_num].id))) {
 			log_error("dm_report: Failed to copy field name");
 			return 0;
@@ -4434,33 +4591,9 @@ static int _output_field(struct dm_report *rh, struct dm_report_field *field)
 	repstr = field->report_string;
 	width = field->props->width;
 	if (!(rh->flags & DM_REPORT_OUTPUT_ALIGNED)) {
-		if (_is_json_report(rh)) {
-			/* Escape any JSON_QUOTE that may appear in reported string. */
-			p1_repstr = repstr;
-			while ((p2_repstr = strstr(p1_repstr, JSON_QUOTE))) {
-				if (p2_repstr > p1_repstr) {
-					if (!dm_pool_grow_object(rh->mem, p1_repstr, p2_repstr - p1_repstr)) {
-						log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-						return 0;
-					}
-				}
-				if (!dm_pool_grow_object(rh->mem, JSON_ESCAPE_CHAR, 1) ||
-				    !dm_pool_grow_object(rh->mem, JSON_QUOTE, 1)) {
-					log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-					return 0;
-				}
-				p1_repstr = p2_repstr + 1;
-			}
-
-			if (!dm_pool_grow_object(rh->mem, p1_repstr, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				return 0;
-			}
-		} else {
-			if (!dm_pool_grow_object(rh->mem, repstr, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				return 0;
-			}
+		if (!dm_pool_grow_object(rh->mem, repstr, 0)) {
+			log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
+			return 0;
 		}
 	} else {
 		if (!(align = field->props->flags & DM_REPORT_FIELD_ALIGN_MASK))
@@ -4505,11 +4638,6 @@ static int _output_field(struct dm_report *rh, struct dm_report_field *field)
 				goto bad;
 			}
 		}
-	} else if (_is_json_report(rh)) {
-		if (!dm_pool_grow_object(rh->mem, JSON_QUOTE, 1)) {
-			log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-			goto bad;
-		}
 	}
 
 	free(buf);
@@ -4600,12 +4728,115 @@ static int _output_as_rows(struct dm_report *rh)
 	return 0;
 }
 
+static int _json_append(struct json_buf *jb, const char *str, size_t len)
+{
+	size_t size = jb->size ? : 512;
+	char *mem;
+
+	while (jb->len + len + 1 > size)
+		size *= 2;
+
+	if (size > jb->size) {
+		if (!(mem = realloc(jb->mem, size))) {
+			log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
+			return 0;
+		}
+		jb->mem = mem;
+		jb->size = size;
+	}
+
+	memcpy(jb->mem + jb->len, str, len);
+	jb->len += len;
+	jb->mem[jb->len] = '\0';
+
+	return 1;
+}
+
+#define _json_append_const(jb, str) _json_append((jb), (str), sizeof(str) - 1)
+
+/*
+ * Builds the whole JSON row in rh->json_row with plain memory copies.
+ * Report strings are only scanned for JSON_QUOTE that needs escaping.
+ */
+static int _json_build_row(struct dm_report *rh, struct row *row)
+{
+	struct json_buf *jb = &rh->json_row;
+	const struct dm_report_field_type *fields;
+	struct dm_report_field *field;
+	const char *p, *q;
+	int do_field_delim = 0;
+
+	jb->len = 0;
+	if (!_json_append_const(jb, JSON_OBJECT_START))
+		return_0;
+
+	dm_list_iterate_items(field, &row->fields) {
+		if (field->props->flags & FLD_HIDDEN)
+			continue;
+
+		if (do_field_delim &&
+		    !_json_append_const(jb, JSON_SEPARATOR JSON_SPACE))
+			return_0;
+		do_field_delim = 1;
+
+		fields = field->props->implicit ? _implicit_report_fields : rh->fields;
+		p = fields[field->props->field_num].id;
+		if (!_json_append_const(jb, JSON_QUOTE) ||
+		    !_json_append(jb, p, strlen(p)) ||
+		    !_json_append_const(jb, JSON_QUOTE JSON_PAIR JSON_QUOTE))
+			return_0;
+
+		/* Escape any JSON_QUOTE that may appear in reported string. */
+		for (p = field->report_string; (q = strchr(p, JSON_QUOTE[0])); p = q + 1)
+			if (!_json_append(jb, p, q - p) ||
+			    !_json_append_const(jb, JSON_ESCAPE_CHAR JSON_QUOTE))
+				return_0;
+
+		if (!_json_append(jb, p, strlen(p)) ||
+		    !_json_append_const(jb, JSON_QUOTE))
+			return_0;
+	}
+
+	return _json_append_const(jb, JSON_OBJECT_END);
+}
+
+static void _json_print_held_row(struct dm_report *rh, const char *separator)
+{
+	struct json_buf *jb = &rh->json_held_row;
+
+	log_print("%*s%s", rh->group_item->group->indent + (int) jb->len, jb->mem, separator);
+	jb->len = 0;
+}
+
+static int _json_output_row(struct dm_report *rh, struct row *row)
+{
+	struct json_buf tmp;
+
+	if (!_json_build_row(rh, row))
+		return_0;
+
+	/* Another row follows so the held one needs the separator. */
+	if (rh->json_held_row.len)
+		_json_print_held_row(rh, JSON_SEPARATOR);
+
+	tmp = rh->json_held_row;
+	rh->json_held_row = rh->json_row;
+	rh->json_row = tmp;
+
+	return 1;
+}
+
+static void _json_flush_held_row(struct dm_report *rh)
+{
+	if (rh->json_held_row.len)
+		_json_print_held_row(rh, "");
+}
+
 static int _output_as_columns(struct dm_report *rh)
 {
 	struct dm_list *fh, *rowh, *ftmp, *rtmp;
 	struct row *row = NULL;
 	struct dm_report_field *field;
-	struct dm_list *last_row;
 	int do_field_delim;
 	char *line;
 
@@ -4614,25 +4845,25 @@ static int _output_as_columns(struct dm_report *rh)
 		_report_headings(rh);
 
 	/* Print and clear buffer */
-	last_row = dm_list_last(&rh->rows);
 	dm_list_iterate_safe(rowh, rtmp, &rh->rows) {
 		row = dm_list_item(rowh, struct row);
 
 		if (!_should_display_row(row))
 			continue;
 
+		if (_is_json_report(rh)) {
+			if (!_json_output_row(rh, row))
+				return_0;
+			if (!(rh->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES))
+				dm_list_del(&row->list);
+			continue;
+		}
+
 		if (!dm_pool_begin_object(rh->mem, 512)) {
 			log_error("dm_report: Unable to allocate output line");
 			return 0;
 		}
 
-		if (_is_json_report(rh)) {
-			if (!dm_pool_grow_object(rh->mem, JSON_OBJECT_START, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				goto bad;
-			}
-		}
-
 		do_field_delim = 0;
 
 		dm_list_iterate_safe(fh, ftmp, &row->fields) {
@@ -4641,17 +4872,9 @@ static int _output_as_columns(struct dm_report *rh)
 				continue;
 
 			if (do_field_delim) {
-				if (_is_json_report(rh)) {
-					if (!dm_pool_grow_object(rh->mem, JSON_SEPARATOR, 0) ||
-					    !dm_pool_grow_object(rh->mem, JSON_SPACE, 0)) {
-						log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-						goto bad;
-					}
-				} else {
-					if (!dm_pool_grow_object(rh->mem, rh->separator, 0)) {
-						log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-						goto bad;
-					}
+				if (!dm_pool_grow_object(rh->mem, rh->separator, 0)) {
+					log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
+					goto bad;
 				}
 			} else
 				do_field_delim = 1;
@@ -4663,18 +4886,6 @@ static int _output_as_columns(struct dm_report *rh)
 				dm_list_del(&field->list);
 		}
 
-		if (_is_json_report(rh)) {
-			if (!dm_pool_grow_object(rh->mem, JSON_OBJECT_END, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				goto bad;
-			}
-			if (rowh != last_row &&
-			    !dm_pool_grow_object(rh->mem, JSON_SEPARATOR, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				goto bad;
-			}
-		}
-
 		if (!dm_pool_grow_object(rh->mem, "\0", 1)) {
 			log_error("dm_report: Unable to terminate output line");
 			goto bad;
@@ -4686,6 +4897,10 @@ static int _output_as_columns(struct dm_report *rh)
 			dm_list_del(&row->list);
 	}
 
+	/* Unbuffered rows keep streaming until the report group is popped. */
+	if (_is_json_report(rh) && (rh->flags & DM_REPORT_OUTPUT_BUFFERED))
+		_json_flush_held_row(rh);
+
 	if (!(rh->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES))
 		_destroy_rows(rh);
 
@@ -4696,6 +4911,174 @@ static int _output_as_columns(struct dm_report *rh)
 	return 0;
 }
 
+/*
+ * Binary output, see DM_REPORT_GROUP_BINARY.
+ */
+#define BINARY_MAGIC	"DMRB"
+#define BINARY_VERSION	1
+
+struct binary_buf {
+	struct dm_pool *mem;
+	size_t len;
+};
+
+static int _binary_append(struct binary_buf *bb, const void *data, size_t len)
+{
+	if (len && !dm_pool_grow_object(bb->mem, data, len)) {
+		log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
+		return 0;
+	}
+
+	bb->len += len;
+
+	return 1;
+}
+
+/* Little-endian integer of 4 or 8 bytes */
+static int _binary_append_int(struct binary_buf *bb, uint64_t value, size_t size)
+{
+	unsigned char buf[8];
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = (unsigned char) (value >> (8 * i));
+
+	return _binary_append(bb, buf, size);
+}
+
+static int _binary_append_str(struct binary_buf *bb, const char *str)
+{
+	size_t len = strlen(str);
+
+	return _binary_append_int(bb, len, 4) && _binary_append(bb, str, len);
+}
+
+static int _is_binary_string_field(const struct field_properties *fp)
+{
+	return !(fp->flags & (DM_REPORT_FIELD_TYPE_NUMBER |
+			      DM_REPORT_FIELD_TYPE_SIZE |
+			      DM_REPORT_FIELD_TYPE_PERCENT |
+			      DM_REPORT_FIELD_TYPE_TIME));
+}
+
+static int _output_binary(struct dm_report *rh)
+{
+	const char *name = rh->group_item->data ? (const char *) rh->group_item->data : "";
+	const struct dm_report_field_type *fields;
+	struct binary_buf bb = { .mem = rh->mem };
+	struct dm_hash_table *dict = NULL;
+	struct field_properties *fp;
+	struct dm_report_field *field, **cells = NULL;
+	const char **strings = NULL;
+	struct row *row;
+	uint32_t nr_fields = 0, nr_rows = 0, nr_strings = 0, f, i;
+	uintptr_t idx;
+	void *output;
+	int r = 0;
+
+	dm_list_iterate_items(fp, &rh->field_props)
+		if (!(fp->flags & FLD_HIDDEN))
+			nr_fields++;
+
+	dm_list_iterate_items(row, &rh->rows)
+		if (_should_display_row(row))
+			nr_rows++;
+
+	/* Row-major cells of the rows and fields output, written by column */
+	if ((nr_fields && nr_rows) &&
+	    (!(cells = malloc(sizeof(*cells) * nr_fields * nr_rows)) ||
+	     !(strings = malloc(sizeof(*strings) * nr_fields * nr_rows)))) {
+		log_error("dm_report: binary output allocation failed");
+		goto out;
+	}
+
+	if (!(dict = dm_hash_create(64))) {
+		log_error("dm_report: binary output dictionary allocation failed");
+		goto out;
+	}
+
+	i = 0;
+	dm_list_iterate_items(row, &rh->rows) {
+		if (!_should_display_row(row))
+			continue;
+		dm_list_iterate_items(field, &row->fields) {
+			if (field->props->flags & FLD_HIDDEN)
+				continue;
+			cells[i++] = field;
+			if (!_is_binary_string_field(field->props) ||
+			    dm_hash_lookup(dict, field->report_string))
+				continue;
+			strings[nr_strings++] = field->report_string;
+			if (!dm_hash_insert(dict, field->report_string, (void *) (uintptr_t) nr_strings)) {
+				log_error("dm_report: binary output dictionary insertion failed");
+				goto out;
+			}
+		}
+	}
+
+	if (!dm_pool_begin_object(rh->mem, 512)) {
+		log_error("dm_report: Unable to allocate binary output");
+		goto out;
+	}
+
+	if (!_binary_append(&bb, BINARY_MAGIC, sizeof(BINARY_MAGIC) - 1) ||
+	    !_binary_append_int(&bb, BINARY_VERSION, 4) ||
+	    !_binary_append_str(&bb, name) ||
+	    !_binary_append_int(&bb, nr_fields, 4) ||
+	    !_binary_append_int(&bb, nr_rows, 4))
+		goto_bad;
+
+	dm_list_iterate_items(fp, &rh->field_props) {
+		if (fp->flags & FLD_HIDDEN)
+			continue;
+		fields = fp->implicit ? _implicit_report_fields : rh->fields;
+		if (!_binary_append_int(&bb, fp->flags & DM_REPORT_FIELD_TYPE_MASK, 4) ||
+		    !_binary_append_str(&bb, fields[fp->field_num].id))
+			goto_bad;
+	}
+
+	if (!_binary_append_int(&bb, nr_strings, 4))
+		goto_bad;
+
+	for (i = 0; i < nr_strings; i++)
+		if (!_binary_append_str(&bb, strings[i]))
+			goto_bad;
+
+	for (f = 0; f < nr_fields; f++)
+		for (i = 0; i < nr_rows; i++) {
+			field = cells[i * nr_fields + f];
+			if (_is_binary_string_field(field->props)) {
+				idx = (uintptr_t) dm_hash_lookup(dict, field->report_string);
+				if (!_binary_append_int(&bb, idx - 1, 4))
+					goto_bad;
+			} else if (!_binary_append_int(&bb, field->sort_value ?
+						      *(const uint64_t *) field->sort_value : 0, 8))
+				goto_bad;
+		}
+
+	output = dm_pool_end_object(rh->mem);
+
+	if (fwrite(output, bb.len, 1, stdout) != 1)
+		log_error("dm_report: Failed to write binary output");
+	else
+		r = 1;
+
+	dm_pool_free(rh->mem, output);
+
+	if (!(rh->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES))
+		_destroy_rows(rh);
+out:
+	if (dict)
+		dm_hash_destroy(dict);
+	free(cells);
+	free(strings);
+
+	return r;
+bad:
+	dm_pool_abandon_object(rh->mem);
+	goto out;
+}
+
 int dm_report_is_empty(struct dm_report *rh)
 {
 	return dm_list_empty(&rh->rows) ? 1 : 0;
@@ -4775,6 +5158,10 @@ static int _prepare_json_report_output(struct dm_report *rh)
 		return 0;
 	}
 
+	/* Unbuffered report keeps its array open while rows stream in. */
+	if (rh->group_item->needs_closing && !(rh->flags & DM_REPORT_OUTPUT_BUFFERED))
+		return 1;
+
 	if (rh->group_item->needs_closing) {
 		log_error("dm_report: dm_report_output: unfinished JSON output detected");
 		return 0;
@@ -4815,7 +5202,9 @@ int dm_report_output(struct dm_report *rh)
 	    !_prepare_json_report_output(rh))
 		return_0;
 
-	if (dm_list_empty(&rh->rows)) {
+	/* Binary output carries its schema even without rows, once. */
+	if (dm_list_empty(&rh->rows) &&
+	    (!_is_binary_report(rh) || rh->group_item->output_done)) {
 		r = 1;
 		goto out;
 	}
@@ -4826,7 +5215,15 @@ int dm_report_output(struct dm_report *rh)
 	if ((rh->flags & RH_SORT_REQUIRED))
 		_sort_rows(rh);
 
-	if (_is_basic_report(rh) && !_print_basic_report_header(rh))
+	if (_is_binary_report(rh)) {
+		r = _output_binary(rh);
+		goto out;
+	}
+
+	/* Unbuffered report prints its header only with the first row. */
+	if (_is_basic_report(rh) &&
+	    ((rh->flags & DM_REPORT_OUTPUT_BUFFERED) || !rh->group_item->output_done) &&
+	    !_print_basic_report_header(rh))
 		goto_out;
 
 	if ((rh->flags & DM_REPORT_OUTPUT_COLUMNS_AS_ROWS))
@@ -4920,7 +5317,13 @@ static int _report_group_push_json(struct report_group_item *item, const char *n
 		item->report->flags &= ~(DM_REPORT_OUTPUT_ALIGNED |
 					 DM_REPORT_OUTPUT_HEADINGS |
 					 DM_REPORT_OUTPUT_COLUMNS_AS_ROWS);
-		item->report->flags |= DM_REPORT_OUTPUT_BUFFERED;
+		/*
+		 * Reports output multiple times (like the log report) must stay
+		 * buffered so they never interleave with reports pushed later.
+		 * Others may stream their rows if they were created unbuffered.
+		 */
+		if (item->report->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES)
+			item->report->flags |= DM_REPORT_OUTPUT_BUFFERED;
 	} else {
 		_json_output_start(item->group);
 		if (name) {
@@ -4986,6 +5389,8 @@ int dm_report_group_push(struct dm_report_group *group, struct dm_report *report
 			if (!_report_group_push_json(item, data))
 				goto_bad;
 			break;
+		case DM_REPORT_GROUP_BINARY:
+			break;
 		default:
 			goto_bad;
 	}
@@ -5009,6 +5414,9 @@ static int _report_group_pop_basic(struct report_group_item *item)
 
 static int _report_group_pop_json(struct report_group_item *item)
 {
+	if (item->report)
+		_json_flush_held_row(item->report);
+
 	if (item->output_done && item->needs_closing) {
 		if (item->data) {
 			item->group->indent -= JSON_INDENT_UNIT;
@@ -5049,6 +5457,8 @@ int dm_report_group_pop(struct dm_report_group *group)
 			if (!_report_group_pop_json(item))
 				return_0;
 			break;
+		case DM_REPORT_GROUP_BINARY:
+			break;
 		default:
 			return 0;
         }
@@ -196,6 +196,15 @@ struct dm_name_list {
 	char name[];
 };
 
+/*
+ * Since 4.37 the name is followed, at an 8-byte aligned offset, by
+ * uint32_t event_nr and uint32_t flags.  When DM_UUID_FLAG is set in the
+ * request, kernels supporting it set one of the flags below and with
+ * DM_NAME_LIST_FLAG_HAS_UUID the uuid string follows the flags.
+ */
+#define DM_NAME_LIST_FLAG_HAS_UUID		1
+#define DM_NAME_LIST_FLAG_DOESNT_HAVE_UUID	2
+
 /*
  * Used to retrieve the target versions
  */
@@ -100,6 +100,15 @@ static void _pool_stats(struct dm_pool *p, const char *action)
 #endif
 }
 
+void dm_pool_get_stats(struct dm_pool *p, struct dm_pool_stats *stats)
+{
+	stats->name = p->name;
+	stats->bytes = p->stats.bytes;
+	stats->peak_bytes = p->stats.maxbytes;
+	stats->used_bytes = p->stats.bytes;
+	stats->chunks = p->stats.blocks_allocated;
+}
+
 void dm_pool_destroy(struct dm_pool *p)
 {
 	_pool_stats(p, "Destroying");
@@ -37,11 +37,14 @@ struct dm_pool {
 	unsigned object_alignment;
 	int locked;
 	long crc;
+	size_t bytes;				/* malloced for chunks */
+	size_t peak_bytes;
+	unsigned nr_chunks;
 };
 
 static void _align_chunk(struct chunk *c, unsigned alignment);
 static struct chunk *_new_chunk(struct dm_pool *p, size_t s);
-static void _free_chunk(struct chunk *c);
+static void _free_chunk(struct dm_pool *p, struct chunk *c);
 
 /* by default things come out aligned for doubles */
 #define DEFAULT_ALIGNMENT __alignof__ (double)
@@ -72,11 +75,15 @@ struct dm_pool *dm_pool_create(const char *name, size_t chunk_hint)
 void dm_pool_destroy(struct dm_pool *p)
 {
 	struct chunk *c, *pr;
-	_free_chunk(p->spare_chunk);
+
+	log_debug_mem("Destroying mempool %s: peak %" PRIsize_t " bytes.",
+		      p->name, p->peak_bytes);
+
+	_free_chunk(p, p->spare_chunk);
 	c = p->chunk;
 	while (c) {
 		pr = c->prev;
-		_free_chunk(c);
+		_free_chunk(p, c);
 		c = pr;
 	}
 
@@ -149,7 +156,7 @@ void dm_pool_free(struct dm_pool *p, void *ptr)
 		}
 
 		if (p->spare_chunk)
-			_free_chunk(p->spare_chunk);
+			_free_chunk(p, p->spare_chunk);
 
 		c->begin = (char *) (c + 1);
 #ifdef VALGRIND_POOL
@@ -294,6 +301,11 @@ static struct chunk *_new_chunk(struct dm_pool *p, size_t s)
 		c->begin = (char *) (c + 1);
 		c->end = (char *) c + s;
 
+		p->bytes += s;
+		p->nr_chunks++;
+		if (p->bytes > p->peak_bytes)
+			p->peak_bytes = p->bytes;
+
 #ifdef VALGRIND_POOL
 		VALGRIND_MAKE_MEM_NOACCESS(c->begin, c->end - c->begin);
 #endif
@@ -304,8 +316,13 @@ static struct chunk *_new_chunk(struct dm_pool *p, size_t s)
 	return c;
 }
 
-static void _free_chunk(struct chunk *c)
+static void _free_chunk(struct dm_pool *p, struct chunk *c)
 {
+	if (c) {
+		p->bytes -= c->end - (char *) c;
+		p->nr_chunks--;
+	}
+
 #ifdef VALGRIND_POOL
 #  ifdef DEBUG_MEM
 	if (c)
@@ -320,6 +337,19 @@ static void _free_chunk(struct chunk *c)
 #endif
 }
 
+void dm_pool_get_stats(struct dm_pool *p, struct dm_pool_stats *stats)
+{
+	const struct chunk *c;
+
+	stats->name = p->name;
+	stats->bytes = p->bytes;
+	stats->peak_bytes = p->peak_bytes;
+	stats->chunks = p->nr_chunks;
+	stats->used_bytes = 0;
+
+	for (c = p->chunk; c; c = c->prev)
+		stats->used_bytes += ((c->begin < c->end) ? c->begin : c->end) - (const char *) (c + 1);
+}
 
 /**
  * Calc crc/hash from pool's memory chunks with internal pointers
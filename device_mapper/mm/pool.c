@@ -81,6 +81,87 @@ void *dm_pool_zalloc(struct dm_pool *p, size_t s)
 	return ptr;
 }
 
+struct dm_slab_object {
+	struct dm_slab_object *next;
+};
+
+struct dm_slab {
+	struct dm_pool *mem;
+	size_t obj_size;
+	unsigned objs_per_chunk;
+	char *next;			/* Unused part of the current chunk */
+	char *end;
+	struct dm_slab_object *free;
+};
+
+struct dm_slab *dm_slab_create(struct dm_pool *mem, size_t obj_size,
+			       unsigned objs_per_chunk)
+{
+	struct dm_slab *s;
+
+	if (!obj_size) {
+		log_error(INTERNAL_ERROR "Slab object size must not be zero.");
+		return NULL;
+	}
+
+	if (!(s = dm_pool_zalloc(mem, sizeof(*s))))
+		return_NULL;
+
+	/* Freed objects hold the free list link */
+	if (obj_size < sizeof(struct dm_slab_object))
+		obj_size = sizeof(struct dm_slab_object);
+
+	s->mem = mem;
+	s->obj_size = (obj_size + DEFAULT_ALIGNMENT - 1) & ~((size_t) DEFAULT_ALIGNMENT - 1);
+	s->objs_per_chunk = objs_per_chunk ? : 64;
+
+	return s;
+}
+
+void *dm_slab_alloc(struct dm_slab *s)
+{
+	struct dm_slab_object *o;
+	char *chunk;
+
+	if ((o = s->free)) {
+		s->free = o->next;
+		return o;
+	}
+
+	if (s->next == s->end) {
+		if (!(chunk = dm_pool_alloc(s->mem, s->obj_size * s->objs_per_chunk)))
+			return_NULL;
+		s->next = chunk;
+		s->end = chunk + s->obj_size * s->objs_per_chunk;
+	}
+
+	o = (struct dm_slab_object *) s->next;
+	s->next += s->obj_size;
+
+	return o;
+}
+
+void *dm_slab_zalloc(struct dm_slab *s)
+{
+	void *ptr = dm_slab_alloc(s);
+
+	if (ptr)
+		memset(ptr, 0, s->obj_size);
+
+	return ptr;
+}
+
+void dm_slab_free(struct dm_slab *s, void *ptr)
+{
+	struct dm_slab_object *o = ptr;
+
+	if (!o)
+		return;
+
+	o->next = s->free;
+	s->free = o;
+}
+
 void dm_pools_check_leaks(void)
 {
 	struct dm_pool *p;
@@ -105,6 +186,50 @@ void dm_pools_check_leaks(void)
 	log_error(INTERNAL_ERROR "Unreleased memory pool(s) found.");
 }
 
+static int _stats_cmp(const void *lhs, const void *rhs)
+{
+	const struct dm_pool_stats *l = lhs, *r = rhs;
+
+	if (l->peak_bytes != r->peak_bytes)
+		return (l->peak_bytes < r->peak_bytes) ? 1 : -1;
+
+	return 0;
+}
+
+void dm_pools_dump_stats(void)
+{
+	struct dm_pool *p;
+	struct dm_pool_stats *stats;
+	uint64_t total = 0;
+	unsigned i, nr = 0;
+
+	pthread_mutex_lock(&_dm_pools_mutex);
+	nr = dm_list_size(&_dm_pools);
+	if (!nr || !(stats = malloc(nr * sizeof(*stats)))) {
+		pthread_mutex_unlock(&_dm_pools_mutex);
+		return;
+	}
+
+	i = 0;
+	dm_list_iterate_items(p, &_dm_pools)
+		dm_pool_get_stats(p, stats + i++);
+	pthread_mutex_unlock(&_dm_pools_mutex);
+
+	qsort(stats, nr, sizeof(*stats), _stats_cmp);
+
+	for (i = 0; i < nr; i++) {
+		log_debug_mem("Mempool %-24s %10" PRIu64 " bytes in %4u chunks, "
+			      "%10" PRIu64 " used, %10" PRIu64 " peak.",
+			      stats[i].name, stats[i].bytes, stats[i].chunks,
+			      stats[i].used_bytes, stats[i].peak_bytes);
+		total += stats[i].bytes;
+	}
+
+	log_debug_mem("%u mempools hold %" PRIu64 " bytes.", nr, total);
+
+	free(stats);
+}
+
 /**
  * Status of locked pool.
  *
@@ -41,6 +41,10 @@ struct dm_regex {		/* Instance variables for the lexer */
         struct ttree *tt;
         dm_bitset_t bs;
         struct dfa_state *h, *t;
+
+	/* one required literal per pattern, or none if any pattern lacks it */
+	unsigned num_literals;
+	const char **literals;
 };
 
 static int _count_nodes(struct rx_node *rx)
@@ -332,6 +336,133 @@ static int _force_states(struct dm_regex *m)
         return 1;
 }
 
+/*
+ * Every string a pattern matches contains the pattern's required
+ * literal, so dm_regex_match() can reject most strings with strstr()
+ * before walking the dfa.  For each node we track the string it always
+ * matches (exact), the literals every match starts and ends with, and
+ * the longest literal every match contains.
+ */
+struct literal_info {
+	const char *exact;	/* NULL unless the node matches one string */
+	const char *prefix;
+	const char *suffix;
+	const char *required;
+};
+
+static const char *_literal_cat(struct dm_pool *mem, const char *a, const char *b)
+{
+	char *r;
+
+	if (!*a)
+		return b;
+	if (!*b)
+		return a;
+
+	if (!(r = dm_pool_alloc(mem, strlen(a) + strlen(b) + 1)))
+		return_NULL;
+
+	strcpy(r, a);
+	strcat(r, b);
+
+	return r;
+}
+
+static const char *_literal_longest(const char *a, const char *b)
+{
+	return (strlen(b) > strlen(a)) ? b : a;
+}
+
+static int _calc_literals(struct dm_pool *mem, struct rx_node *rx, struct literal_info *li)
+{
+	struct literal_info l, r;
+	const char *cat;
+	char *str;
+	int c;
+
+	li->exact = NULL;
+	li->prefix = li->suffix = li->required = "";
+
+	switch (rx->type) {
+	case CHARSET:
+		if (((c = dm_bit_get_first(rx->charset)) < 0) ||
+		    (dm_bit_get_next(rx->charset, c) >= 0))
+			break;
+
+		/* Anchors match no character of the string itself */
+		if ((c == HAT_CHAR) || (c == DOLLAR_CHAR))
+			str = (char *) "";
+		else {
+			if (!(str = dm_pool_alloc(mem, 2)))
+				return_0;
+			str[0] = (char) c;
+			str[1] = '\0';
+		}
+
+		li->exact = li->prefix = li->suffix = li->required = str;
+		break;
+
+	case CAT:
+		if (!_calc_literals(mem, rx->left, &l) ||
+		    !_calc_literals(mem, rx->right, &r))
+			return_0;
+
+		if (l.exact && r.exact &&
+		    !(li->exact = _literal_cat(mem, l.exact, r.exact)))
+			return_0;
+
+		if (!(li->prefix = l.exact ? _literal_cat(mem, l.exact, r.prefix) : l.prefix) ||
+		    !(li->suffix = r.exact ? _literal_cat(mem, l.suffix, r.exact) : r.suffix) ||
+		    !(cat = _literal_cat(mem, l.suffix, r.prefix)))
+			return_0;
+
+		li->required = _literal_longest(_literal_longest(l.required, r.required), cat);
+		break;
+
+	case PLUS:
+		if (!_calc_literals(mem, rx->left, &l))
+			return_0;
+
+		li->prefix = l.prefix;
+		li->suffix = l.suffix;
+		li->required = l.required;
+		break;
+
+	default:
+		/* OR, STAR and QUEST require nothing */
+		break;
+	}
+
+	return 1;
+}
+
+static int _create_literals(struct dm_regex *m, const char * const *patterns,
+			    unsigned num_patterns)
+{
+	struct literal_info li;
+	struct rx_node *rx;
+	unsigned i;
+
+	if (!(m->literals = dm_pool_alloc(m->mem, sizeof(*m->literals) * num_patterns)))
+		return_0;
+
+	for (i = 0; i < num_patterns; i++) {
+		if (!(rx = rx_parse_str(m->scratch, patterns[i])) ||
+		    !_calc_literals(m->scratch, rx, &li))
+			return_0;
+
+		if (!*li.required)
+			return 1; /* nothing to prefilter on */
+
+		if (!(m->literals[i] = dm_pool_strdup(m->mem, li.required)))
+			return_0;
+	}
+
+	m->num_literals = num_patterns;
+
+	return 1;
+}
+
 struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patterns,
 				 unsigned num_patterns)
 {
@@ -387,6 +518,9 @@ struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patter
 	if (!_calc_states(m, rx))
 		goto_bad;
 
+	if (!_create_literals(m, patterns, num_patterns))
+		goto_bad;
+
 	return m;
 
       bad:
@@ -418,11 +552,25 @@ static struct dfa_state *_step_matcher(struct dm_regex *m, int c, struct dfa_sta
 	return ns;
 }
 
+static int _has_literal(struct dm_regex *regex, const char *s)
+{
+	unsigned i;
+
+	for (i = 0; i < regex->num_literals; i++)
+		if (strstr(s, regex->literals[i]))
+			return 1;
+
+	return 0;
+}
+
 int dm_regex_match(struct dm_regex *regex, const char *s)
 {
 	struct dfa_state *cs = regex->start;
 	int r = 0;
 
+	if (regex->num_literals && !_has_literal(regex, s))
+		return -1;
+
         dm_bit_clear_all(regex->bs);
 	if (!(cs = _step_matcher(regex, HAT_CHAR, cs, &r)))
 		goto out;
@@ -103,6 +103,8 @@ static int _lv_passes_volumes_filter(struct cmd_context *cmd, const struct logic
 	const char *str;
 	static char config_path[PATH_MAX];
 	size_t len = strlen(lv->vg->name);
+	struct str_set *lv_tags = NULL, *host_tags = NULL;
+	int r = 0;
 
 	config_def_get_path(config_path, sizeof(config_path), cfg_id);
 	log_verbose("%s configuration setting defined: "
@@ -111,7 +113,7 @@ static int _lv_passes_volumes_filter(struct cmd_context *cmd, const struct logic
 
 	for (cv = cn->v; cv; cv = cv->next) {
 		if (cv->type == DM_CFG_EMPTY_ARRAY)
-			goto out;
+			break;
 		if (cv->type != DM_CFG_STRING) {
 			log_print_unless_silent("Ignoring invalid string in config file %s.",
 						config_path);
@@ -132,19 +134,25 @@ static int _lv_passes_volumes_filter(struct cmd_context *cmd, const struct logic
 							config_path);
 				continue;
 			}
+			/* LV and VG tags are matched together against each entry */
+			if (!lv_tags && !(lv_tags = str_set_create(cmd->mem, &lv->tags, &lv->vg->tags)))
+				goto_out;
 			/* If any host tag matches any LV or VG tag, activate */
 			if (!strcmp(str, "*")) {
-				if (str_list_match_list(&cmd->tags, &lv->tags, NULL)
-				    || str_list_match_list(&cmd->tags,
-							   &lv->vg->tags, NULL))
-					    return 1;
+				if (!host_tags && !(host_tags = str_set_create(cmd->mem, &cmd->tags, NULL)))
+					goto_out;
+				if (str_set_match_set(host_tags, lv_tags)) {
+					r = 1;
+					goto out;
+				}
 
 				continue;
 			}
 			/* If supplied tag matches LV or VG tag, activate */
-			if (str_list_match_item(&lv->tags, str) ||
-			    str_list_match_item(&lv->vg->tags, str))
-				return 1;
+			if (str_set_match_item(lv_tags, str)) {
+				r = 1;
+				goto out;
+			}
 
 			continue;
 		}
@@ -153,15 +161,19 @@ static int _lv_passes_volumes_filter(struct cmd_context *cmd, const struct logic
 		if ((strncmp(str, lv->vg->name, len) == 0) &&
 		    (!str[len] ||
 		     ((str[len] == '/') &&
-		      !strcmp(str + len + 1, lv->name))))
-			return 1;
+		      !strcmp(str + len + 1, lv->name)))) {
+			r = 1;
+			goto out;
+		}
 	}
 
-out:
 	log_verbose("No item supplied in %s configuration setting matches %s.",
 		    config_path, display_lvname(lv));
+out:
+	if (lv_tags)
+		dm_pool_free(cmd->mem, lv_tags);
 
-	return 0;
+	return r;
 }
 
 int lv_passes_auto_activation_filter(struct cmd_context *cmd, struct logical_volume *lv)
@@ -278,6 +290,11 @@ int lv_writecache_message(const struct logical_volume *lv, const char *msg)
 {
 	return 0;
 }
+int lv_sample_io(const struct logical_volume *lv, unsigned seconds,
+		 struct lv_io_sample *sample)
+{
+	return 0;
+}
 int lv_thin_pool_status(const struct logical_volume *lv, int flush,
 			struct lv_status_thin_pool **thin_pool_status)
 {
@@ -314,6 +331,10 @@ int lv_suspend_if_active(struct cmd_context *cmd, const char *lvid_s, unsigned o
 {
 	return 1;
 }
+int lv_refresh_changes_tables(struct cmd_context *cmd, const struct logical_volume *lv)
+{
+	return 1;
+}
 int lv_resume(struct cmd_context *cmd, const char *lvid_s, unsigned origin_only, const struct logical_volume *lv)
 {
 	return 1;
@@ -342,6 +363,10 @@ int lv_activate_with_filter(struct cmd_context *cmd, const char *lvid_s, int exc
 {
 	return 1;
 }
+int activate_lvs_batch(struct cmd_context *cmd, struct dm_list *lvs)
+{
+	return 1;
+}
 int lv_mknodes(struct cmd_context *cmd, const struct logical_volume *lv)
 {
 	return 1;
@@ -361,6 +386,20 @@ void activation_release(void)
 void activation_exit(void)
 {
 }
+void activation_event_arm(void)
+{
+}
+void activation_event_wait(unsigned timeout_ms)
+{
+	usleep(timeout_ms * 1000);
+}
+int activation_cache_devs(struct cmd_context *cmd)
+{
+	return 1;
+}
+void activation_uncache_devs(void)
+{
+}
 
 int raid4_is_supported(struct cmd_context *cmd, const struct segment_type *segtype)
 {
@@ -403,8 +442,17 @@ int lv_has_target_type(struct dm_pool *mem, const struct logical_volume *lv,
 }
 #else				/* DEVMAPPER_SUPPORT */
 
+#include "device_mapper/misc/dm-ioctl.h"
+
+#include <poll.h>
+#include <sys/ioctl.h>
+
 static int _activation = 1;
 
+/* dm control fd for activation_event_wait(), -2 when unsupported */
+static int _event_fd = -1;
+static int _event_armed = 0;
+
 void set_activation(int act, int silent)
 {
 	if (act == _activation)
@@ -822,8 +870,13 @@ int lv_info_with_seg_status(struct cmd_context *cmd,
 #define OPEN_COUNT_CHECK_RETRIES 25
 #define OPEN_COUNT_CHECK_USLEEP_DELAY 200000
 
-/* Only report error if error_if_used is set */
-int lv_check_not_in_use(const struct logical_volume *lv, int error_if_used)
+/*
+ * Only report error if error_if_used is set.
+ * With open_ok, an LV that is only open is accepted without waiting,
+ * for deactivation with deferred removal.
+ */
+static int _lv_check_not_in_use(const struct logical_volume *lv, int error_if_used,
+				int open_ok)
 {
 	struct lvinfo info;
 	unsigned int open_count_check_retries;
@@ -854,6 +907,12 @@ int lv_check_not_in_use(const struct logical_volume *lv, int error_if_used)
 		}
 	}
 
+	if (open_ok) {
+		log_verbose("Logical volume %s is open, removal will be deferred.",
+			    display_lvname(lv));
+		return 1;
+	}
+
 	open_count_check_retries = retry_deactivation() ? OPEN_COUNT_CHECK_RETRIES : 1;
 	while (info.open_count > 0 && open_count_check_retries--) {
 		if (!open_count_check_retries) {
@@ -876,6 +935,11 @@ int lv_check_not_in_use(const struct logical_volume *lv, int error_if_used)
 	return 1;
 }
 
+int lv_check_not_in_use(const struct logical_volume *lv, int error_if_used)
+{
+	return _lv_check_not_in_use(lv, error_if_used, 0);
+}
+
 /*
  * Returns 1 if percent set, else 0 on failure.
  */
@@ -1196,6 +1260,31 @@ int lv_writecache_message(const struct logical_volume *lv, const char *msg)
 	return r;
 }
 
+/*
+ * Watch I/O to an active LV for 'seconds' with a temporary
+ * dm-stats region.
+ */
+int lv_sample_io(const struct logical_volume *lv, unsigned seconds,
+		 struct lv_io_sample *sample)
+{
+	int r;
+	struct dev_manager *dm;
+
+	if (!lv_info(lv->vg->cmd, lv, 0, NULL, 0, 0)) {
+		log_error("Unable to sample I/O of an inactive logical volume.");
+		return 0;
+	}
+
+	if (!(dm = dev_manager_create(lv->vg->cmd, lv->vg->name, 1)))
+		return_0;
+
+	r = dev_manager_sample_io(dm, lv, seconds, sample);
+
+	dev_manager_destroy(dm);
+
+	return r;
+}
+
 /*
  * Return dm_status_cache for cache volume, accept also cache pool
  *
@@ -2245,6 +2334,41 @@ int lv_suspend_if_active(struct cmd_context *cmd, const char *lvid_s, unsigned o
 	return _lv_suspend(cmd, lvid_s, &laopts, 0, lv, lv_pre);
 }
 
+/* RAID and mirror targets revive transiently failed devices on resume */
+static int _lv_resume_is_noop(struct logical_volume *lv, void *data)
+{
+	return !lv_is_raid(lv) && !lv_is_mirror(lv);
+}
+
+/*
+ * Returns 0 when refreshing the active LV would not change anything:
+ * every table it would load is identical to the live one, so the
+ * suspend and resume can be skipped.  Tables that differ are left
+ * preloaded for the suspend.  When unsure, returns 1.
+ */
+int lv_refresh_changes_tables(struct cmd_context *cmd, const struct logical_volume *lv)
+{
+	struct lv_activate_opts laopts = { 0 };
+	struct lvinfo info;
+	int flush_required = 0;
+
+	if (!activation() || test_mode())
+		return 1;
+
+	if (lv_is_merging_origin(lv) || lv_is_partial(lv) ||
+	    !_lv_resume_is_noop((struct logical_volume *) lv, NULL) ||
+	    !for_each_sub_lv((struct logical_volume *) lv, &_lv_resume_is_noop, NULL))
+		return 1;
+
+	if (!lv_info(cmd, lv, 0, &info, 0, 0) || !info.exists || info.suspended)
+		return 1;
+
+	if (!_lv_preload(lv, &laopts, &flush_required))
+		return 1;
+
+	return laopts.tables_changed;
+}
+
 static int _check_suspended_lv(struct logical_volume *lv, void *data)
 {
 	struct lvinfo info;
@@ -2436,7 +2560,7 @@ int lv_deactivate(struct cmd_context *cmd, const char *lvid_s, const struct logi
 
 	if (lv_is_visible(lv) || lv_is_virtual_origin(lv) ||
 	    lv_is_merging_thin_snapshot(lv)) {
-		if (!lv_check_not_in_use(lv, 1))
+		if (!_lv_check_not_in_use(lv, 1, deferred_remove()))
 			goto_out;
 
 		if (lv_is_origin(lv) && _lv_has_open_snapshots(lv))
@@ -2610,6 +2734,133 @@ int lv_activate(struct cmd_context *cmd, const char *lvid_s, int exclusive,
 	return 1;
 }
 
+/*
+ * Only plain top-level LVs whose whole activation is their own device
+ * tree can share one batched tree.  Anything else keeps using activate_lv().
+ */
+static int _lv_batch_activatable(struct cmd_context *cmd, const struct logical_volume *lv)
+{
+	const struct lv_segment *seg;
+	uint32_t s;
+
+	if (!lv_is_visible(lv) || lv_is_partial(lv) ||
+	    lv_is_locked(lv) || lv_is_pvmove(lv) ||
+	    lv_is_origin(lv) || lv_is_merging_origin(lv) ||
+	    lv_is_external_origin(lv) || lv_is_pending_delete(lv) ||
+	    (lv->status & (LV_NOSCAN | LV_TEMPORARY)) ||
+	    !dm_list_empty(&lv->segs_using_this_lv))
+		return 0;
+
+	if (lv_is_thin_volume(lv)) {
+		seg = first_seg(lv);
+		if (seg->external_lv || seg->merge_lv)
+			return 0;
+	} else
+		dm_list_iterate_items(seg, &lv->segments) {
+			if (!seg_is_striped(seg))
+				return 0;
+			for (s = 0; s < seg->area_count; s++)
+				if (seg_type(seg, s) != AREA_PV)
+					return 0;
+		}
+
+	if (!_passes_activation_filter(cmd, lv) ||
+	    _passes_readonly_filter(cmd, lv))
+		return 0;
+
+	if (lv_component_is_active(lv))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Activate inactive LVs from the list that need nothing special with
+ * a single dev_manager transaction, so shared devices are loaded once and
+ * all udev events are waited for together.  The caller still runs
+ * activate_lv() for every LV, which finds batched LVs already active and
+ * handles the rest, so a failure here only loses the speedup.
+ */
+int activate_lvs_batch(struct cmd_context *cmd, struct dm_list *lvs)
+{
+	struct lv_activate_opts laopts = { 0 };
+	const struct volume_group *vg = NULL;
+	struct dm_list batch;
+	struct lv_list *lvl, *blvl;
+	struct dev_manager *dm;
+	struct lvinfo info;
+	int r;
+
+	if (!activation() || test_mode())
+		return 1;
+
+	dm_list_init(&batch);
+
+	/* Most LVs are expected to be inactive */
+	if (!activation_cache_devs(cmd))
+		stack;
+
+	dm_list_iterate_items(lvl, lvs) {
+		if (vg && (lvl->lv->vg != vg)) {
+			log_error(INTERNAL_ERROR "Batched activation across VGs %s and %s.",
+				  vg->name, lvl->lv->vg->name);
+			goto bad;
+		}
+		vg = lvl->lv->vg;
+
+		if (!_lv_batch_activatable(cmd, lvl->lv))
+			continue;
+
+		if (!lv_info_with_name_check(cmd, lvl->lv, 0, &info))
+			goto_bad;
+
+		if (info.exists)
+			continue;
+
+		lv_calculate_readahead(lvl->lv, NULL);
+
+		if (!(blvl = dm_pool_alloc(cmd->mem, sizeof(*blvl)))) {
+			log_error("Failed to allocate batched LV list.");
+			goto bad;
+		}
+		blvl->lv = lvl->lv;
+		dm_list_add(&batch, &blvl->list);
+	}
+
+	activation_uncache_devs();
+
+	/* Nothing to gain */
+	if (dm_list_size(&batch) < 2)
+		return 1;
+
+	log_debug_activation("Activating %u LVs in VG %s in one tree.",
+			     dm_list_size(&batch), vg->name);
+
+	if (!(dm = dev_manager_create(cmd, vg->name, 1)))
+		return_0;
+
+	critical_section_inc(cmd, "activating");
+	if (!(r = dev_manager_activate_lvs(dm, &batch, &laopts)))
+		stack;
+	critical_section_dec(cmd, "activated");
+
+	dev_manager_destroy(dm);
+
+	if (!r)
+		return 0;
+
+	dm_list_iterate_items(lvl, &batch)
+		if (!monitor_dev_for_events(cmd, lvl->lv, &laopts, 1))
+			stack;
+
+	return 1;
+
+bad:
+	activation_uncache_devs();
+
+	return 0;
+}
+
 /* Activate LV only if it passes filter */
 int lv_activate_with_filter(struct cmd_context *cmd, const char *lvid_s, int exclusive,
 			    int noscan, int temporary, const struct logical_volume *lv)
@@ -2742,6 +2993,86 @@ void activation_exit(void)
 {
 	activation_release();
 	dev_manager_exit();
+
+	if ((_event_fd >= 0) && close(_event_fd))
+		log_sys_debug("close", "dm control");
+	_event_fd = -1;
+}
+
+/*
+ * Arm device-mapper event notification on a private control node fd.
+ * A following activation_event_wait() then returns as soon as any dm
+ * device raises an event (as dmeventd's poll mode does), so a status
+ * read between the two cannot miss one.  Without kernel support the
+ * wait degrades to a plain timed sleep.
+ */
+void activation_event_arm(void)
+{
+	struct dm_ioctl dmi = {
+		.version = { DM_VERSION_MAJOR, 0, 0 },
+		.data_size = sizeof(dmi),
+	};
+	char path[PATH_MAX];
+
+	_event_armed = 0;
+
+	if (_event_fd == -2)
+		return;	/* unsupported */
+
+	if (_event_fd < 0) {
+		if (dm_snprintf(path, sizeof(path), "%s/control", dm_dir()) < 0 ||
+		    (_event_fd = open(path, O_RDWR | O_CLOEXEC)) < 0) {
+			log_debug_activation("Cannot open dm control node for events.");
+			_event_fd = -2;
+			return;
+		}
+	}
+
+	if (ioctl(_event_fd, DM_DEV_ARM_POLL, &dmi)) {
+		log_debug_activation("Kernel cannot poll for dm events, using timed waits.");
+		if (close(_event_fd))
+			log_sys_debug("close", "dm control");
+		_event_fd = -2;
+		return;
+	}
+
+	_event_armed = 1;
+}
+
+/*
+ * Wait up to timeout_ms, or less if a dm event arrives after the last
+ * activation_event_arm().  Returns early on a signal too.
+ */
+void activation_event_wait(unsigned timeout_ms)
+{
+	struct pollfd pfd = { .fd = _event_fd, .events = POLLIN };
+
+	if (!_event_armed) {
+		usleep(timeout_ms * 1000);
+		return;
+	}
+
+	_event_armed = 0;
+
+	if ((poll(&pfd, 1, (int) timeout_ms) < 0) && (errno != EINTR))
+		log_sys_debug("poll", "dm control");
+}
+
+/*
+ * Snapshot the list of existing dm devices with one ioctl, so queries of
+ * inactive LVs need none until the snapshot is dropped or any LV changes.
+ */
+int activation_cache_devs(struct cmd_context *cmd)
+{
+	if (!activation())
+		return 1;
+
+	return dev_manager_cache_devs(cmd);
+}
+
+void activation_uncache_devs(void)
+{
+	dev_manager_uncache_devs();
 }
 #endif
 
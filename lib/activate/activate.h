@@ -89,6 +89,7 @@ struct lv_activate_opts {
 				 * flags are persistent in udev db for any spurious event
 				 * that follows. */
 	unsigned resuming;	/* Set when resuming after a suspend. */
+	unsigned tables_changed; /* Set by preload when suspend/resume has work to do. */
 	const struct logical_volume *component_lv;
 };
 
@@ -115,8 +116,13 @@ int list_lv_modules(struct dm_pool *mem, const struct logical_volume *lv,
 
 void activation_release(void);
 void activation_exit(void);
+int activation_cache_devs(struct cmd_context *cmd);
+void activation_uncache_devs(void);
+void activation_event_arm(void);
+void activation_event_wait(unsigned timeout_ms);
 
 /* int lv_suspend(struct cmd_context *cmd, const char *lvid_s); */
+int lv_refresh_changes_tables(struct cmd_context *cmd, const struct logical_volume *lv);
 int lv_suspend_if_active(struct cmd_context *cmd, const char *lvid_s, unsigned origin_only, unsigned exclusive,
 			 const struct logical_volume *lv, const struct logical_volume *lv_pre);
 int lv_resume(struct cmd_context *cmd, const char *lvid_s, unsigned origin_only, const struct logical_volume *lv);
@@ -133,6 +139,7 @@ int lv_mknodes(struct cmd_context *cmd, const struct logical_volume *lv);
 int lv_deactivate_any_missing_subdevs(const struct logical_volume *lv);
 
 int activate_lv(struct cmd_context *cmd, const struct logical_volume *lv);
+int activate_lvs_batch(struct cmd_context *cmd, struct dm_list *lvs);
 int deactivate_lv(struct cmd_context *cmd, const struct logical_volume *lv);
 int suspend_lv(struct cmd_context *cmd, const struct logical_volume *lv);
 int suspend_lv_origin(struct cmd_context *cmd, const struct logical_volume *lv);
@@ -189,6 +196,8 @@ int lv_raid_mismatch_count(const struct logical_volume *lv, uint64_t *cnt);
 int lv_raid_sync_action(const struct logical_volume *lv, char **sync_action);
 int lv_raid_message(const struct logical_volume *lv, const char *msg);
 int lv_writecache_message(const struct logical_volume *lv, const char *msg);
+int lv_sample_io(const struct logical_volume *lv, unsigned seconds,
+		 struct lv_io_sample *sample);
 int lv_cache_status(const struct logical_volume *cache_lv,
 		    struct lv_status_cache **status);
 int lv_thin_device_id(const struct logical_volume *lv, uint32_t *device_id);
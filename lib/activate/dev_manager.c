@@ -26,6 +26,7 @@
 #include "lib/activate/activate.h"
 #include "lib/misc/lvm-exec.h"
 #include "lib/datastruct/str_list.h"
+#include "lib/log/timing.h"
 
 #include <limits.h>
 #include <dirent.h>
@@ -803,17 +804,139 @@ static int _original_uuid_format_check_required(struct cmd_context *cmd)
 	return (_kernel_major == -1);
 }
 
-static int _info(struct cmd_context *cmd,
-		 const char *name, const char *dlid,
-		 int with_open_count, int with_read_ahead, int with_name_check,
-		 struct dm_info *dminfo, uint32_t *read_ahead,
-		 struct lv_seg_status *seg_status)
+/*
+ * Command-scoped snapshot of existing dm devices indexed by uuid,
+ * taken with one DM_DEVICE_LIST ioctl.  While it exists, queries for
+ * devices missing from it are answered without any ioctl.  Any tree
+ * change drops it.
+ */
+static struct dm_pool *_dm_devs_mem = NULL;
+static struct dm_hash_table *_dm_devs_cache = NULL;
+
+/*
+ * Along with the snapshot, the plain info and the raid status read for
+ * a device are kept by dlid, so report fields that each need them for
+ * the same LV share one ioctl.
+ */
+static struct dm_hash_table *_dm_info_cache = NULL;
+static struct dm_hash_table *_raid_status_cache = NULL;
+
+void dev_manager_uncache_devs(void)
+{
+	if (_raid_status_cache) {
+		dm_hash_destroy(_raid_status_cache);
+		_raid_status_cache = NULL;
+	}
+
+	if (_dm_info_cache) {
+		dm_hash_destroy(_dm_info_cache);
+		_dm_info_cache = NULL;
+	}
+
+	if (_dm_devs_cache) {
+		dm_hash_destroy(_dm_devs_cache);
+		_dm_devs_cache = NULL;
+	}
+
+	if (_dm_devs_mem) {
+		dm_pool_destroy(_dm_devs_mem);
+		_dm_devs_mem = NULL;
+	}
+}
+
+int dev_manager_cache_devs(struct cmd_context *cmd)
+{
+	struct dm_task *dmt;
+	struct dm_list devs;
+	struct dm_active_device *dm_dev;
+	unsigned devs_features, count = 0;
+	int r = 0;
+
+	dev_manager_uncache_devs();
+
+	/* Cache could not answer lookups of the oldest uuid format */
+	if (_original_uuid_format_check_required(cmd))
+		return 1;
+
+	if (!(dmt = _setup_task_run(DM_DEVICE_LIST, NULL, NULL, NULL, 0, 0, 0, 0, 0, 0)))
+		return_0;
+
+	if (!(_dm_devs_mem = dm_pool_create("dm_devs_cache", 16 * 1024)))
+		goto_out;
+
+	if (!dm_task_get_device_list(dmt, _dm_devs_mem, &devs, &devs_features))
+		goto_out;
+
+	if (!dm_list_empty(&devs) && !(devs_features & DM_DEVICE_LIST_HAS_UUID)) {
+		log_debug_activation("Kernel does not list device uuids, not caching dm devices.");
+		r = 1;
+		goto out;
+	}
+
+	if (!(_dm_devs_cache = dm_hash_create(dm_list_size(&devs) + 32))) {
+		log_error("Failed to create dm devices cache.");
+		goto out;
+	}
+
+	dm_list_iterate_items(dm_dev, &devs) {
+		if (!dm_dev->uuid)
+			continue;
+		if (!dm_hash_insert(_dm_devs_cache, dm_dev->uuid, dm_dev)) {
+			log_error("Failed to cache dm device %s.", dm_dev->name);
+			goto out;
+		}
+		count++;
+	}
+
+	if (!(_dm_info_cache = dm_hash_create(count + 32)) ||
+	    !(_raid_status_cache = dm_hash_create(32))) {
+		log_error("Failed to create dm status cache.");
+		goto out;
+	}
+
+	log_debug_activation("Cached %u dm devices with uuid.", count);
+	r = 1;
+out:
+	dm_task_destroy(dmt);
+
+	if (!_dm_devs_cache || !r)
+		dev_manager_uncache_devs();
+
+	return r;
+}
+
+/* Is there a device with dlid or its pre-2.02.106 form without suffix? */
+static int _cached_dlid_exists(const char *dlid)
+{
+	char old_style_dlid[sizeof(UUID_PREFIX) + 2 * ID_LEN];
+
+	if (dm_hash_lookup(_dm_devs_cache, dlid))
+		return 1;
+
+	(void) dm_strncpy(old_style_dlid, dlid, sizeof(old_style_dlid));
+
+	return dm_hash_lookup(_dm_devs_cache, old_style_dlid) ? 1 : 0;
+}
+
+static int _info_uncached(struct cmd_context *cmd,
+			  const char *name, const char *dlid,
+			  int with_open_count, int with_read_ahead, int with_name_check,
+			  struct dm_info *dminfo, uint32_t *read_ahead,
+			  struct lv_seg_status *seg_status)
 {
 	char old_style_dlid[sizeof(UUID_PREFIX) + 2 * ID_LEN];
 	const char *suffix, *suffix_position;
 	const char *name_check = (with_name_check) ? name : NULL;
 	unsigned i = 0;
 
+	if (_dm_devs_cache && !_cached_dlid_exists(dlid)) {
+		log_debug_activation("Device %s [%s] is not in dm devices cache.", name, dlid);
+		memset(dminfo, 0, sizeof(*dminfo));
+		if (read_ahead)
+			*read_ahead = DM_READ_AHEAD_NONE;
+		return 1;
+	}
+
 	log_debug_activation("Getting device info for %s [%s].", name, dlid);
 
 	/* Check for dlid */
@@ -853,6 +976,34 @@ static int _info(struct cmd_context *cmd,
 	return 1;
 }
 
+static int _info(struct cmd_context *cmd,
+		 const char *name, const char *dlid,
+		 int with_open_count, int with_read_ahead, int with_name_check,
+		 struct dm_info *dminfo, uint32_t *read_ahead,
+		 struct lv_seg_status *seg_status)
+{
+	struct dm_info *cached;
+	int plain = _dm_info_cache && !with_open_count && !with_name_check &&
+		!read_ahead && !seg_status;
+
+	if (plain && (cached = dm_hash_lookup(_dm_info_cache, dlid))) {
+		*dminfo = *cached;
+		return 1;
+	}
+
+	if (!_info_uncached(cmd, name, dlid, with_open_count, with_read_ahead,
+			    with_name_check, dminfo, read_ahead, seg_status))
+		return_0;
+
+	if (plain && (cached = dm_pool_alloc(_dm_devs_mem, sizeof(*cached)))) {
+		*cached = *dminfo;
+		if (!dm_hash_insert(_dm_info_cache, dlid, cached))
+			dm_pool_free(_dm_devs_mem, cached);
+	}
+
+	return 1;
+}
+
 int dev_manager_remove_dm_major_minor(uint32_t major, uint32_t minor)
 {
 	struct dm_task *dmt;
@@ -860,6 +1011,8 @@ int dev_manager_remove_dm_major_minor(uint32_t major, uint32_t minor)
 
 	log_verbose("Removing dm dev %u:%u", major, minor);
 
+	dev_manager_uncache_devs();
+
 	if (!(dmt = dm_task_create(DM_DEVICE_REMOVE)))
 		return_0;
 
@@ -1345,6 +1498,7 @@ void dev_manager_release(void)
 
 void dev_manager_exit(void)
 {
+	dev_manager_uncache_devs();
 	dm_lib_exit();
 }
 
@@ -1443,6 +1597,9 @@ int dev_manager_raid_status(struct dev_manager *dm,
 	if (!(dlid = build_dm_uuid(dm->mem, lv, layer)))
 		return_0;
 
+	if (_raid_status_cache && (*status = dm_hash_lookup(_raid_status_cache, dlid)))
+		return 1;
+
 	if (!(dmt = _setup_task_run(DM_DEVICE_STATUS, &info, NULL, dlid, 0, 0, 0, 0, 0, 0)))
 		return_0;
 
@@ -1459,9 +1616,12 @@ int dev_manager_raid_status(struct dev_manager *dm,
 
 	/* FIXME Check there's only one target */
 
-	if (!dm_get_status_raid(dm->mem, params, status))
+	if (!dm_get_status_raid(_raid_status_cache ? _dm_devs_mem : dm->mem, params, status))
 		goto_out;
 
+	if (_raid_status_cache && !dm_hash_insert(_raid_status_cache, dlid, *status))
+		stack;
+
 	r = 1;
 out:
 	dm_task_destroy(dmt);
@@ -1548,6 +1708,121 @@ out:
 	return r;
 }
 
+#define SAMPLE_AREAS 64
+
+static int _stats_message(const char *dlid, const char *msg,
+			  char *resp, size_t resp_size)
+{
+	int r = 0;
+	struct dm_task *dmt;
+	const char *p;
+
+	if (!(dmt = _setup_task_run(DM_DEVICE_TARGET_MSG, NULL, NULL, dlid, 0, 0, 0, 0, 1, 0)))
+		return_0;
+
+	if (!dm_task_set_message(dmt, msg))
+		goto_out;
+
+	if (!dm_task_run(dmt))
+		goto_out;
+
+	if (resp) {
+		p = dm_task_get_message_response(dmt);
+		if (!dm_strncpy(resp, p ? : "", resp_size)) {
+			log_error("Response to %s is too long.", msg);
+			goto out;
+		}
+	}
+
+	r = 1;
+out:
+	dm_task_destroy(dmt);
+
+	return r;
+}
+
+static int _cmp_u64_desc(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x < y) ? 1 : (x > y) ? -1 : 0;
+}
+
+/*
+ * Split the LV into SAMPLE_AREAS dm-stats areas, sleep and collect
+ * the counters.  The region is private to this command and removed
+ * before returning.
+ */
+int dev_manager_sample_io(struct dev_manager *dm,
+			  const struct logical_volume *lv,
+			  unsigned seconds, struct lv_io_sample *sample)
+{
+	char msg[64], resp[SAMPLE_AREAS * 128];
+	uint64_t area_ios[SAMPLE_AREAS];
+	uint64_t rd, rd_merged, rd_sectors, wr, wr_merged, wr_sectors, busy;
+	uint64_t start, len, sum;
+	const char *dlid, *line;
+	unsigned region_id, i;
+	int r = 0;
+
+	memset(sample, 0, sizeof(*sample));
+
+	if (!(dlid = build_dm_uuid(dm->mem, lv, lv_layer(lv))))
+		return_0;
+
+	if (dm_snprintf(msg, sizeof(msg), "@stats_create - /%u lvm_sample", SAMPLE_AREAS) < 0)
+		return_0;
+
+	if (!_stats_message(dlid, msg, resp, sizeof(resp)))
+		return_0;
+
+	if (sscanf(resp, "%u", &region_id) != 1) {
+		log_error("Unexpected response to %s: %s.", msg, resp);
+		return 0;
+	}
+
+	log_verbose("Sampling I/O of %s for %u seconds.", display_lvname(lv), seconds);
+	sleep(seconds);
+
+	if (dm_snprintf(msg, sizeof(msg), "@stats_print %u", region_id) < 0)
+		goto_out;
+
+	if (!_stats_message(dlid, msg, resp, sizeof(resp)))
+		goto_out;
+
+	/* <start>+<len> reads reads_merged sectors ms writes writes_merged sectors ... */
+	for (line = resp; *line && sample->areas < SAMPLE_AREAS;) {
+		if (sscanf(line, FMTu64 "+" FMTu64 " " FMTu64 " " FMTu64 " " FMTu64 " "
+			   FMTu64 " " FMTu64 " " FMTu64 " " FMTu64,
+			   &start, &len, &rd, &rd_merged, &rd_sectors, &busy,
+			   &wr, &wr_merged, &wr_sectors) != 9) {
+			log_error("Unexpected response to %s.", msg);
+			goto out;
+		}
+		area_ios[sample->areas++] = rd + wr;
+		sample->ios += rd + wr;
+		sample->sectors += rd_sectors + wr_sectors;
+		if (!(line = strchr(line, '\n')))
+			break;
+		line++;
+	}
+
+	/* Smallest set of areas holding 90% of the I/O */
+	qsort(area_ios, sample->areas, sizeof(area_ios[0]), _cmp_u64_desc);
+	for (i = 0, sum = 0; (i < sample->areas) && (sum * 10 < sample->ios * 9); i++)
+		sum += area_ios[i];
+	sample->areas_used = i;
+
+	r = 1;
+out:
+	if ((dm_snprintf(msg, sizeof(msg), "@stats_delete %u", region_id) < 0) ||
+	    !_stats_message(dlid, msg, NULL, 0))
+		log_warn("WARNING: Failed to remove dm-stats region %u from %s.",
+			 region_id, display_lvname(lv));
+
+	return r;
+}
+
 int dev_manager_cache_status(struct dev_manager *dm,
 			     const struct logical_volume *lv,
 			     struct lv_status_cache **status)
@@ -3670,8 +3945,8 @@ static int _clean_tree(struct dev_manager *dm, struct dm_tree_node *root, const
 	return 1;
 }
 
-static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
-			struct lv_activate_opts *laopts, action_t action)
+static int _do_tree_action(struct dev_manager *dm, const struct logical_volume *lv,
+			   struct lv_activate_opts *laopts, action_t action)
 {
 	static const char _action_names[][24] = {
 		"PRELOAD", "ACTIVATE", "DEACTIVATE", "SUSPEND", "SUSPEND_WITH_LOCKFS", "CLEAN"
@@ -3695,6 +3970,9 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 			  display_lvname(lv));
 		return 0;
 	}
+	/* Device set is changing */
+	dev_manager_uncache_devs();
+
 	/* Some targets may build bigger tree for activation */
 	dm->activation = ((action == PRELOAD) || (action == ACTIVATE));
 	dm->suspend = (action == SUSPEND_WITH_LOCKFS) || (action == SUSPEND);
@@ -3726,6 +4004,8 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 	case DEACTIVATE:
 		if (retry_deactivation())
 			dm_tree_retry_remove(root);
+		if (deferred_remove())
+			dm_tree_deferred_remove(root);
 		/* Deactivate LV and all devices it references that nothing else has open. */
 		if (!dm_tree_deactivate_children(root, dlid, DLID_SIZE))
 			goto_out;
@@ -3757,6 +4037,9 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 		if (!dm_tree_preload_children(root, dlid, DLID_SIZE))
 			goto_out;
 
+		if (dm_tree_node_tables_changed(root))
+			laopts->tables_changed = 1;
+
 		if ((dm_tree_node_size_changed(root) < 0))
 			dm->flush_required = 1;
 		/* Currently keep the code require flush for any
@@ -3790,6 +4073,18 @@ out_no_root:
 	return r;
 }
 
+static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
+			struct lv_activate_opts *laopts, action_t action)
+{
+	int r;
+
+	timing_start(TIMING_ACTIVATION);
+	r = _do_tree_action(dm, lv, laopts, action);
+	timing_end(TIMING_ACTIVATION);
+
+	return r;
+}
+
 /* origin_only may only be set if we are resuming (not activating) an origin LV */
 int dev_manager_activate(struct dev_manager *dm, const struct logical_volume *lv,
 			 struct lv_activate_opts *laopts)
@@ -3803,6 +4098,124 @@ int dev_manager_activate(struct dev_manager *dm, const struct logical_volume *lv
 	return 1;
 }
 
+static struct dm_tree *_create_lvs_dtree(struct dev_manager *dm, struct dm_list *lvs)
+{
+	struct dm_tree *dtree;
+	struct lv_list *lvl;
+
+	if (!(dtree = dm_tree_create())) {
+		log_debug_activation("Dtree creation failed for VG %s.", dm->vg_name);
+		return NULL;
+	}
+
+	dm_tree_set_optional_uuid_suffixes(dtree, &uuid_suffix_list[0]);
+
+	dm_list_iterate_items(lvl, lvs)
+		if (!_add_lv_to_dtree(dm, dtree, lvl->lv, 0))
+			goto_bad;
+
+	return dtree;
+
+bad:
+	dm_tree_free(dtree);
+	return NULL;
+}
+
+/*
+ * Variant of _tree_action() working with a list of top-level LVs of one VG.
+ * All LVs share one tree, so every device is queried, loaded and resumed
+ * once and all udev events end up on a single cookie.
+ */
+static int _tree_action_lvs(struct dev_manager *dm, struct dm_list *lvs,
+			    struct lv_activate_opts *laopts, action_t action)
+{
+	const size_t DLID_SIZE = ID_LEN + sizeof(UUID_PREFIX) - 1;
+	struct dm_tree *dtree;
+	struct dm_tree_node *root;
+	struct lv_list *lvl;
+	char *dlid;
+	int r = 0;
+
+	if (dm_list_empty(lvs))
+		return 1;
+
+	log_debug_activation("Creating %s tree for %u LVs in VG %s.",
+			     (action == ACTIVATE) ? "ACTIVATE" : "CLEAN",
+			     dm_list_size(lvs), dm->vg_name);
+
+	dev_manager_uncache_devs();
+
+	dm->activation = (action == ACTIVATE);
+	dm->suspend = 0;
+	dm->track_external_lv_deps = 1;
+
+	if (!(dtree = _create_lvs_dtree(dm, lvs)))
+		return_0;
+
+	if (!(root = dm_tree_find_node(dtree, 0, 0))) {
+		log_error("Lost dependency tree root node.");
+		goto out_no_root;
+	}
+
+	/* Restore fs cookie */
+	dm_tree_set_cookie(root, fs_get_cookie());
+
+	/* Only the "LVM-" plus VG id part is used as the prefix */
+	lvl = dm_list_item(dm_list_first(lvs), struct lv_list);
+	if (!(dlid = build_dm_uuid(dm->mem, lvl->lv, NULL)))
+		goto_out;
+
+	switch (action) {
+	case CLEAN:
+		if (retry_deactivation())
+			dm_tree_retry_remove(root);
+		/* Deactivate any unused non-toplevel nodes */
+		if (!_clean_tree(dm, root, NULL))
+			goto_out;
+		break;
+	case ACTIVATE:
+		dm_list_iterate_items(lvl, lvs)
+			if (!_add_new_lv_to_dtree(dm, dtree, lvl->lv, laopts, NULL))
+				goto_out;
+
+		if (!dm_tree_preload_children(root, dlid, DLID_SIZE))
+			goto_out;
+
+		if (!dm_tree_activate_children(root, dlid, DLID_SIZE))
+			goto_out;
+
+		if (!_create_lv_symlinks(dm, root))
+			log_warn("Failed to create symlinks for LVs in VG %s.",
+				 dm->vg_name);
+		break;
+	default:
+		log_error(INTERNAL_ERROR "_tree_action_lvs: Action %u not supported.", action);
+		goto out;
+	}
+	r = 1;
+
+out:
+	/* Save fs cookie for udev settle, do not wait here */
+	fs_set_cookie(dm_tree_get_cookie(root));
+out_no_root:
+	dm_tree_free(dtree);
+
+	return r;
+}
+
+/* Activate a list of plain top-level LVs of one VG in one tree */
+int dev_manager_activate_lvs(struct dev_manager *dm, struct dm_list *lvs,
+			     struct lv_activate_opts *laopts)
+{
+	if (!_tree_action_lvs(dm, lvs, laopts, ACTIVATE))
+		return_0;
+
+	if (!_tree_action_lvs(dm, lvs, laopts, CLEAN))
+		return_0;
+
+	return 1;
+}
+
 /* origin_only may only be set if we are resuming (not activating) an origin LV */
 int dev_manager_preload(struct dev_manager *dm, const struct logical_volume *lv,
 			struct lv_activate_opts *laopts, int *flush_required)
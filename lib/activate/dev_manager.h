@@ -38,6 +38,8 @@ struct dev_manager *dev_manager_create(struct cmd_context *cmd,
 void dev_manager_destroy(struct dev_manager *dm);
 void dev_manager_release(void);
 void dev_manager_exit(void);
+int dev_manager_cache_devs(struct cmd_context *cmd);
+void dev_manager_uncache_devs(void);
 
 /*
  * The device handler is responsible for creating all the layered
@@ -66,6 +68,9 @@ int dev_manager_raid_message(struct dev_manager *dm,
 int dev_manager_writecache_message(struct dev_manager *dm,
                                    const struct logical_volume *lv,
                                    const char *msg);
+int dev_manager_sample_io(struct dev_manager *dm,
+			  const struct logical_volume *lv,
+			  unsigned seconds, struct lv_io_sample *sample);
 int dev_manager_cache_status(struct dev_manager *dm,
 			     const struct logical_volume *lv,
 			     struct lv_status_cache **status);
@@ -86,6 +91,8 @@ int dev_manager_suspend(struct dev_manager *dm, const struct logical_volume *lv,
 			struct lv_activate_opts *laopts, int lockfs, int flush_required);
 int dev_manager_activate(struct dev_manager *dm, const struct logical_volume *lv,
 			 struct lv_activate_opts *laopts);
+int dev_manager_activate_lvs(struct dev_manager *dm, struct dm_list *lvs,
+			     struct lv_activate_opts *laopts);
 int dev_manager_preload(struct dev_manager *dm, const struct logical_volume *lv,
 			struct lv_activate_opts *laopts, int *flush_required);
 int dev_manager_deactivate(struct dev_manager *dm, const struct logical_volume *lv);
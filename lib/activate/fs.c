@@ -20,6 +20,7 @@
 #include "lib/misc/lvm-string.h"
 #include "lib/misc/lvm-file.h"
 #include "lib/mm/memlock.h"
+#include "lib/log/timing.h"
 
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -491,8 +492,10 @@ void fs_unlock(void)
 	if (!dm_get_suspended_counter()) {
 		log_debug_activation("Syncing device names");
 		/* Wait for all processed udev devices */
+		timing_start(TIMING_UDEV_WAIT);
 		if (!dm_udev_wait(_fs_cookie))
 			stack;
+		timing_end(TIMING_UDEV_WAIT);
 		_fs_cookie = DM_COOKIE_AUTO_CREATE; /* Reset cookie */
 		dm_lib_release();
 		_pop_fs_ops();
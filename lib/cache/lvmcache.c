@@ -51,6 +51,7 @@ struct lvmcache_info {
 /* One per VG */
 struct lvmcache_vginfo {
 	struct dm_list list;	 /* _vginfos */
+	struct dm_list name_list; /* lvmcache_vgname_list vginfos */
 	struct dm_list infos;	/* List head for lvmcache_infos */
 	struct dm_list outdated_infos; /* vg_read moves info from infos to outdated_infos */
 	struct dm_list pvsummaries; /* pv_list taken directly from vgsummary */
@@ -65,20 +66,31 @@ struct lvmcache_vginfo {
 	uint32_t mda_checksum;
 	size_t mda_size;
 	uint32_t seqno;
+	uint32_t lockd_seqno;	/* seqno in the lvmlockd VG lock while held, else 0 */
 	bool scan_summary_mismatch; /* vgsummary from devs had mismatching seqno or checksum */
 	bool has_duplicate_local_vgname;   /* this local vg and another local vg have same name */
 	bool has_duplicate_foreign_vgname; /* this foreign vg and another foreign vg have same name */
 };
 
+/*
+ * The vginfos with one vgname, in the same order as in _vginfos.
+ * This replaces _vgname_hash for looking up a vgname when there
+ * are duplicate vgnames.
+ */
+struct lvmcache_vgname_list {
+	struct dm_list vginfos;
+};
+
 /*
  * Each VG found during scan gets a vginfo struct.
- * Each vginfo is in _vginfos and _vgid_hash, and
+ * Each vginfo is in _vginfos, _vgid_hash and _vgname_list_hash, and
  * _vgname_hash (unless disabled due to duplicate vgnames).
  */
 
-static struct dm_hash_table *_pvid_hash = NULL;
+static struct dm_flat_hash *_pvid_hash = NULL;
 static struct dm_hash_table *_vgid_hash = NULL;
 static struct dm_hash_table *_vgname_hash = NULL;
+static struct dm_hash_table *_vgname_list_hash = NULL;
 static DM_LIST_INIT(_vginfos);
 static DM_LIST_INIT(_initial_duplicates);
 static DM_LIST_INIT(_unused_duplicates);
@@ -103,10 +115,13 @@ int lvmcache_init(struct cmd_context *cmd)
 	if (!(_vgname_hash = dm_hash_create(128)))
 		return 0;
 
+	if (!(_vgname_list_hash = dm_hash_create(128)))
+		return 0;
+
 	if (!(_vgid_hash = dm_hash_create(128)))
 		return 0;
 
-	if (!(_pvid_hash = dm_hash_create(128)))
+	if (!(_pvid_hash = dm_flat_hash_create(128)))
 		return 0;
 
 	return 1;
@@ -271,6 +286,17 @@ void lvmcache_get_mdas(struct cmd_context *cmd,
 	}
 }
 
+/* Size of the VG metadata text found by the label scan, 0 if unknown. */
+size_t lvmcache_vg_mda_size(const char *vgname, const char *vgid)
+{
+	struct lvmcache_vginfo *vginfo;
+
+	if (!(vginfo = lvmcache_vginfo_from_vgname(vgname, vgid)))
+		return 0;
+
+	return vginfo->mda_size;
+}
+
 struct metadata_area *lvmcache_get_dev_mda(struct device *dev, int mda_num)
 {
 	struct lvmcache_info *info;
@@ -296,22 +322,64 @@ static void _vginfo_detach_info(struct lvmcache_info *info)
 	info->vginfo = NULL;
 }
 
+static int _vgname_list_add(struct lvmcache_vginfo *vginfo, int at_head)
+{
+	struct lvmcache_vgname_list *vgnl;
+
+	if (!(vgnl = dm_hash_lookup(_vgname_list_hash, vginfo->vgname))) {
+		if (!(vgnl = zalloc(sizeof(*vgnl))))
+			return_0;
+		dm_list_init(&vgnl->vginfos);
+		if (!dm_hash_insert(_vgname_list_hash, vginfo->vgname, vgnl)) {
+			free(vgnl);
+			return_0;
+		}
+	}
+
+	if (at_head)
+		dm_list_add_h(&vgnl->vginfos, &vginfo->name_list);
+	else
+		dm_list_add(&vgnl->vginfos, &vginfo->name_list);
+
+	return 1;
+}
+
+static void _vgname_list_del(struct lvmcache_vginfo *vginfo)
+{
+	struct lvmcache_vgname_list *vgnl;
+
+	if (dm_list_empty(&vginfo->name_list))
+		return;
+
+	dm_list_del(&vginfo->name_list);
+	dm_list_init(&vginfo->name_list);
+
+	if ((vgnl = dm_hash_lookup(_vgname_list_hash, vginfo->vgname)) &&
+	    dm_list_empty(&vgnl->vginfos)) {
+		dm_hash_remove(_vgname_list_hash, vginfo->vgname);
+		free(vgnl);
+	}
+}
+
+/*
+ * Used in place of _vgname_hash when there are duplicate vgnames,
+ * returning the first vginfo in _vginfos with the name (or vgid.)
+ */
 static struct lvmcache_vginfo *_search_vginfos_list(const char *vgname, const char *vgid)
 {
-	struct lvmcache_vginfo *vginfo;
+	char id[ID_LEN + 1] __attribute__((aligned(8)));
+	struct lvmcache_vgname_list *vgnl;
 
 	if (vgid) {
-		dm_list_iterate_items(vginfo, &_vginfos) {
-			if (!strcmp(vgid, vginfo->vgid))
-				return vginfo;
-		}
-	} else {
-		dm_list_iterate_items(vginfo, &_vginfos) {
-			if (!strcmp(vgname, vginfo->vgname))
-				return vginfo;
-		}
+		(void) dm_strncpy(id, vgid, sizeof(id));
+		return dm_hash_lookup(_vgid_hash, id);
 	}
-	return NULL;
+
+	if (!(vgnl = dm_hash_lookup(_vgname_list_hash, vgname)) ||
+	    dm_list_empty(&vgnl->vginfos))
+		return NULL;
+
+	return dm_list_item(dm_list_first(&vgnl->vginfos), struct lvmcache_vginfo);
 }
 
 static struct lvmcache_vginfo *_vginfo_lookup(const char *vgname, const char *vgid)
@@ -446,7 +514,7 @@ struct lvmcache_info *lvmcache_info_from_pvid(const char *pvid, struct device *d
 
 	(void) dm_strncpy(id, pvid, sizeof(id));
 
-	if (!(info = dm_hash_lookup(_pvid_hash, id)))
+	if (!(info = dm_flat_hash_lookup(_pvid_hash, id)))
 		return NULL;
 
 	/*
@@ -473,40 +541,150 @@ const char *lvmcache_vgname_from_info(struct lvmcache_info *info)
 	return NULL;
 }
 
-static uint64_t _get_pvsummary_size(char *pvid)
+/*
+ * Lookups for _choose_duplicates, which would otherwise search lists
+ * for each duplicate dev.  If the index can't be created, the lists
+ * are searched.
+ */
+struct duplicates_index {
+	struct dm_pool *mem;
+	struct dm_hash_table *pvsummaries;	/* pvid -> pv in vginfo pvsummaries */
+	struct dm_hash_table *unused;		/* devs in _unused_duplicates */
+	struct dm_hash_table *prev_unused;	/* devs in _prev_unused_duplicate_devs */
+	struct dm_list pvids;			/* duplicate_pvid */
+};
+
+/* The _initial_duplicates devs for one pvid. */
+struct duplicate_pvid {
+	struct dm_list list;
+	struct dm_list devs;
+	char *pvid;
+};
+
+static int _index_device_list(struct dm_hash_table *t, struct dm_list *head)
+{
+	struct device_list *devl;
+
+	dm_list_iterate_items(devl, head)
+		if (!dm_hash_insert_binary(t, &devl->dev, sizeof(devl->dev), devl->dev))
+			return_0;
+
+	return 1;
+}
+
+static int _create_duplicates_index(struct duplicates_index *idx)
 {
 	char pvid_s[ID_LEN + 1] __attribute__((aligned(8)));
 	struct lvmcache_vginfo *vginfo;
 	struct pv_list *pvl;
+	struct device_list *devl, *devl_safe;
+	struct duplicate_pvid *dp;
+	struct dm_hash_table *by_pvid = NULL;
 
+	memset(idx, 0, sizeof(*idx));
+	dm_list_init(&idx->pvids);
+
+	if (!(idx->mem = dm_pool_create("duplicates_index", 1024)) ||
+	    !(idx->pvsummaries = dm_hash_create(128)) ||
+	    !(idx->unused = dm_hash_create(32)) ||
+	    !(idx->prev_unused = dm_hash_create(32)) ||
+	    !(by_pvid = dm_hash_create(32)))
+		goto_bad;
+
+	/* The first pvsummary with the pvid is used, as when searching. */
 	dm_list_iterate_items(vginfo, &_vginfos) {
 		dm_list_iterate_items(pvl, &vginfo->pvsummaries) {
 			(void) dm_strncpy(pvid_s, (char *) &pvl->pv->id, sizeof(pvid_s));
-			if (!strcmp(pvid_s, pvid))
-				return pvl->pv->size;
+			if (!dm_hash_lookup(idx->pvsummaries, pvid_s) &&
+			    !dm_hash_insert(idx->pvsummaries, pvid_s, pvl->pv))
+				goto_bad;
 		}
 	}
 
+	if (!_index_device_list(idx->unused, &_unused_duplicates) ||
+	    !_index_device_list(idx->prev_unused, &_prev_unused_duplicate_devs))
+		goto_bad;
+
+	/*
+	 * Group the initial duplicates by pvid, keeping the order of
+	 * the devs and of the first dev with each pvid.
+	 */
+	dm_list_iterate_items(devl, &_initial_duplicates) {
+		if (dm_hash_lookup(by_pvid, devl->dev->pvid))
+			continue;
+		if (!(dp = dm_pool_zalloc(idx->mem, sizeof(*dp))) ||
+		    !dm_hash_insert(by_pvid, devl->dev->pvid, dp))
+			goto_bad;
+		dm_list_init(&dp->devs);
+		dp->pvid = devl->dev->pvid;
+		dm_list_add(&idx->pvids, &dp->list);
+	}
+
+	/* Nothing can fail after devs are moved from _initial_duplicates. */
+	dm_list_iterate_items_safe(devl, devl_safe, &_initial_duplicates) {
+		dp = dm_hash_lookup(by_pvid, devl->dev->pvid);
+		dm_list_move(&dp->devs, &devl->list);
+	}
+
+	dm_hash_destroy(by_pvid);
+
+	return 1;
+bad:
+	if (by_pvid)
+		dm_hash_destroy(by_pvid);
+	if (idx->prev_unused)
+		dm_hash_destroy(idx->prev_unused);
+	if (idx->unused)
+		dm_hash_destroy(idx->unused);
+	if (idx->pvsummaries)
+		dm_hash_destroy(idx->pvsummaries);
+	if (idx->mem)
+		dm_pool_destroy(idx->mem);
+	memset(idx, 0, sizeof(*idx));
+	dm_list_init(&idx->pvids);
 	return 0;
 }
 
-static const char *_get_pvsummary_device_hint(char *pvid)
+static void _destroy_duplicates_index(struct duplicates_index *idx)
+{
+	if (!idx->mem)
+		return;
+
+	dm_hash_destroy(idx->prev_unused);
+	dm_hash_destroy(idx->unused);
+	dm_hash_destroy(idx->pvsummaries);
+	dm_pool_destroy(idx->mem);
+}
+
+static struct physical_volume *_get_pvsummary(struct duplicates_index *idx, char *pvid)
 {
 	char pvid_s[ID_LEN + 1] __attribute__((aligned(8)));
 	struct lvmcache_vginfo *vginfo;
 	struct pv_list *pvl;
 
+	if (idx->mem)
+		return dm_hash_lookup(idx->pvsummaries, pvid);
+
 	dm_list_iterate_items(vginfo, &_vginfos) {
 		dm_list_iterate_items(pvl, &vginfo->pvsummaries) {
 			(void) dm_strncpy(pvid_s, (char *) &pvl->pv->id, sizeof(pvid_s));
 			if (!strcmp(pvid_s, pvid))
-				return pvl->pv->device_hint;
+				return pvl->pv;
 		}
 	}
 
 	return NULL;
 }
 
+static int _dev_in_index(struct duplicates_index *idx, struct dm_hash_table *t,
+			 struct device *dev, struct dm_list *head)
+{
+	if (idx->mem)
+		return dm_hash_lookup_binary(t, &dev, sizeof(dev)) ? 1 : 0;
+
+	return dev_in_device_list(dev, head);
+}
+
 /*
  * Check if any PVs in vg->pvs have the same PVID as any
  * entries in _unused_duplicates.
@@ -608,9 +786,12 @@ static void _choose_duplicates(struct cmd_context *cmd,
 	const char *device_hint;
 	struct dm_list altdevs;
 	struct dm_list new_unused;
+	struct duplicates_index idx;
+	struct duplicate_pvid *dp;
 	struct dev_types *dt = cmd->dev_types;
 	struct device_list *devl, *devl_safe, *devl_add, *devl_del;
 	struct lvmcache_info *info;
+	struct physical_volume *pvsummary;
 	struct device *dev1, *dev2;
 	uint32_t dev1_major, dev1_minor, dev2_major, dev2_minor;
 	uint64_t dev1_size, dev2_size, pvsummary_size;
@@ -625,6 +806,9 @@ static void _choose_duplicates(struct cmd_context *cmd,
 
 	dm_list_init(&new_unused);
 
+	if (!_create_duplicates_index(&idx))
+		log_debug_cache("Searching lists for duplicates.");
+
 	/*
 	 * Create a list of all alternate devs for the same pvid: altdevs.
 	 */
@@ -632,18 +816,26 @@ next:
 	dm_list_init(&altdevs);
 	pvid = NULL;
 
-	dm_list_iterate_items_safe(devl, devl_safe, &_initial_duplicates) {
-		if (!pvid) {
-			dm_list_move(&altdevs, &devl->list);
-			pvid = devl->dev->pvid;
-		} else {
-			if (!strcmp(pvid, devl->dev->pvid))
+	if (!dm_list_empty(&idx.pvids)) {
+		dp = dm_list_item(dm_list_first(&idx.pvids), struct duplicate_pvid);
+		dm_list_del(&dp->list);
+		dm_list_splice(&altdevs, &dp->devs);
+		pvid = dp->pvid;
+	} else if (!idx.mem) {
+		dm_list_iterate_items_safe(devl, devl_safe, &_initial_duplicates) {
+			if (!pvid) {
 				dm_list_move(&altdevs, &devl->list);
+				pvid = devl->dev->pvid;
+			} else {
+				if (!strcmp(pvid, devl->dev->pvid))
+					dm_list_move(&altdevs, &devl->list);
+			}
 		}
 	}
 
 	/* done, no more entries to process */
 	if (!pvid) {
+		_destroy_duplicates_index(&idx);
 		_destroy_device_list(&_unused_duplicates);
 		dm_list_splice(&_unused_duplicates, &new_unused);
 		return;
@@ -716,8 +908,8 @@ next:
 		if (dev1 == dev2)
 			continue;
 
-		prev_unchosen1 = dev_in_device_list(dev1, &_unused_duplicates);
-		prev_unchosen2 = dev_in_device_list(dev2, &_unused_duplicates);
+		prev_unchosen1 = _dev_in_index(&idx, idx.unused, dev1, &_unused_duplicates);
+		prev_unchosen2 = _dev_in_index(&idx, idx.unused, dev2, &_unused_duplicates);
 
 		if (!prev_unchosen1 && !prev_unchosen2) {
 			/*
@@ -727,8 +919,8 @@ next:
 			 * want the same duplicate preference to be preserved
 			 * in each instance of lvmcache for a single command.
 			 */
-			prev_unchosen1 = dev_in_device_list(dev1, &_prev_unused_duplicate_devs);
-			prev_unchosen2 = dev_in_device_list(dev2, &_prev_unused_duplicate_devs);
+			prev_unchosen1 = _dev_in_index(&idx, idx.prev_unused, dev1, &_prev_unused_duplicate_devs);
+			prev_unchosen2 = _dev_in_index(&idx, idx.prev_unused, dev2, &_prev_unused_duplicate_devs);
 		}
 
 		dev1_major = MAJOR(dev1->dev);
@@ -741,11 +933,12 @@ next:
 		if (!dev_get_size(dev2, &dev2_size))
 			dev2_size = 0;
 
-		pvsummary_size = _get_pvsummary_size(devl->dev->pvid);
+		pvsummary = _get_pvsummary(&idx, devl->dev->pvid);
+		pvsummary_size = pvsummary ? pvsummary->size : 0;
 		same_size1 = (dev1_size == pvsummary_size);
 		same_size2 = (dev2_size == pvsummary_size);
 
-		if ((device_hint = _get_pvsummary_device_hint(devl->dev->pvid))) {
+		if ((device_hint = pvsummary ? pvsummary->device_hint : NULL)) {
 			same_name1 = !strcmp(device_hint, dev_name(dev1));
 			same_name2 = !strcmp(device_hint, dev_name(dev2));
 		}
@@ -1245,6 +1438,8 @@ static void _drop_vginfo(struct lvmcache_info *info, struct lvmcache_vginfo *vgi
 
 	dm_hash_remove(_vgid_hash, vginfo->vgid);
 
+	_vgname_list_del(vginfo);
+
 	dm_list_del(&vginfo->list); /* _vginfos list */
 
 	_free_vginfo(vginfo);
@@ -1253,7 +1448,7 @@ static void _drop_vginfo(struct lvmcache_info *info, struct lvmcache_vginfo *vgi
 void lvmcache_del(struct lvmcache_info *info)
 {
 	if (info->dev->pvid[0] && _pvid_hash)
-		dm_hash_remove(_pvid_hash, info->dev->pvid);
+		dm_flat_hash_remove(_pvid_hash, info->dev->pvid);
 
 	_drop_vginfo(info, info->vginfo);
 
@@ -1340,6 +1535,7 @@ static int _lvmcache_update_vgname(struct cmd_context *cmd,
 		dm_list_init(&vginfo->infos);
 		dm_list_init(&vginfo->outdated_infos);
 		dm_list_init(&vginfo->pvsummaries);
+		dm_list_init(&vginfo->name_list);
 		vginfo->fmt = fmt;
 
 		if (!dm_hash_insert(_vgname_hash, vgname, vginfo)) {
@@ -1354,6 +1550,9 @@ static int _lvmcache_update_vgname(struct cmd_context *cmd,
 			return_0;
 		}
 
+		if (!_vgname_list_add(vginfo, 0))
+			return_0;
+
 		/* Ensure orphans appear last on list_iterate */
 		dm_list_add(&_vginfos, &vginfo->list);
 		return 1;
@@ -1381,6 +1580,7 @@ static int _lvmcache_update_vgname(struct cmd_context *cmd,
 		dm_list_init(&vginfo->infos);
 		dm_list_init(&vginfo->outdated_infos);
 		dm_list_init(&vginfo->pvsummaries);
+		dm_list_init(&vginfo->name_list);
 
 		if ((other = dm_hash_lookup(_vgname_hash, vgname))) {
 			log_debug_cache("lvmcache adding vginfo found duplicate VG name %s", vgname);
@@ -1441,6 +1641,11 @@ static int _lvmcache_update_vgname(struct cmd_context *cmd,
 			}
 		}
 
+		if (!_vgname_list_add(vginfo, 1)) {
+			log_error("lvmcache adding vg to name list failed %s", vgname);
+			return 0;
+		}
+
 		dm_list_add_h(&_vginfos, &vginfo->list);
 	}
 
@@ -2043,16 +2248,16 @@ struct lvmcache_info *lvmcache_add(struct cmd_context *cmd, struct labeller *lab
 	 * Add or update the _pvid_hash mapping, pvid to info.
 	 */
 
-	info_lookup = dm_hash_lookup(_pvid_hash, pvid_s);
+	info_lookup = dm_flat_hash_lookup(_pvid_hash, pvid_s);
 	if ((info_lookup == info) && !strcmp(info->dev->pvid, pvid_s))
 		goto update_vginfo;
 
 	if (info->dev->pvid[0])
-		dm_hash_remove(_pvid_hash, info->dev->pvid);
+		dm_flat_hash_remove(_pvid_hash, info->dev->pvid);
 
 	strncpy(info->dev->pvid, pvid_s, sizeof(info->dev->pvid));
 
-	if (!dm_hash_insert(_pvid_hash, pvid_s, info)) {
+	if (!dm_flat_hash_insert(_pvid_hash, pvid_s, info)) {
 		log_error("Adding pvid to hash failed %s", pvid_s);
 		return NULL;
 	}
@@ -2065,7 +2270,7 @@ update_vginfo:
 
 	if (!lvmcache_update_vgname_and_id(cmd, info, &vgsummary)) {
 		if (created) {
-			dm_hash_remove(_pvid_hash, pvid_s);
+			dm_flat_hash_remove(_pvid_hash, pvid_s);
 			strcpy(info->dev->pvid, "");
 			free(info->label);
 			free(info);
@@ -2096,8 +2301,8 @@ void lvmcache_destroy(struct cmd_context *cmd, int retain_orphans, int reset)
 	}
 
 	if (_pvid_hash) {
-		dm_hash_iter(_pvid_hash, (dm_hash_iterate_fn) _lvmcache_destroy_info);
-		dm_hash_destroy(_pvid_hash);
+		dm_flat_hash_iter(_pvid_hash, (dm_hash_iterate_fn) _lvmcache_destroy_info);
+		dm_flat_hash_destroy(_pvid_hash);
 		_pvid_hash = NULL;
 	}
 
@@ -2106,6 +2311,12 @@ void lvmcache_destroy(struct cmd_context *cmd, int retain_orphans, int reset)
 		_vgname_hash = NULL;
 	}
 
+	if (_vgname_list_hash) {
+		dm_hash_iter(_vgname_list_hash, free);
+		dm_hash_destroy(_vgname_list_hash);
+		_vgname_list_hash = NULL;
+	}
+
 	dm_list_iterate_items_safe(vginfo, vginfo2, &_vginfos) {
 		dm_list_del(&vginfo->list);
 		_free_vginfo(vginfo);
@@ -2344,6 +2555,38 @@ int lvmcache_foreach_mda(struct lvmcache_info *info,
 	return 1;
 }
 
+/*
+ * The summary of the VG metadata that label_scan read from mda1 of the PV,
+ * when it matches the metadata used for the VG.
+ */
+int lvmcache_mda1_summary_from_info(struct lvmcache_info *info,
+				    struct lvmcache_vgsummary *vgsummary,
+				    uint64_t *text_offset)
+{
+	struct lvmcache_vginfo *vginfo = info->vginfo;
+	struct metadata_area *mda;
+
+	if (!vginfo || is_orphan_vg(vginfo->vgname) || vginfo->scan_summary_mismatch)
+		return 0;
+
+	dm_list_iterate_items(mda, &info->mdas) {
+		if ((mda->mda_num != 1) || mda_is_ignored(mda) || !mda->scan_text_offset)
+			continue;
+
+		if (mda->scan_text_checksum != vginfo->mda_checksum)
+			return 0;
+
+		memcpy(&vgsummary->vgid, vginfo->vgid, sizeof(vgsummary->vgid));
+		vgsummary->seqno = vginfo->seqno;
+		vgsummary->mda_checksum = vginfo->mda_checksum;
+		vgsummary->mda_size = vginfo->mda_size;
+		*text_offset = mda->scan_text_offset;
+		return 1;
+	}
+
+	return 0;
+}
+
 unsigned lvmcache_mda_count(struct lvmcache_info *info)
 {
 	return dm_list_size(&info->mdas);
@@ -2559,6 +2802,44 @@ bool lvmcache_scan_mismatch(struct cmd_context *cmd, const char *vgname, const c
 	return true;
 }
 
+/* The latest seqno seen in the mda headers of the VG's devices. */
+uint32_t lvmcache_seqno(struct cmd_context *cmd, const char *vgid)
+{
+	struct lvmcache_vginfo *vginfo;
+
+	if (vgid && (vginfo = lvmcache_vginfo_from_vgid(vgid)))
+		return vginfo->seqno;
+
+	return 0;
+}
+
+/*
+ * lvmlockd returns the VG seqno kept in the lock value block when the
+ * VG lock is acquired, see lockd_vg().  0 when unknown or unlocked.
+ */
+void lvmcache_set_lockd_seqno(const char *vgname, uint32_t seqno)
+{
+	struct lvmcache_vginfo *vginfo;
+
+	if ((vginfo = lvmcache_vginfo_from_vgname(vgname, NULL)))
+		vginfo->lockd_seqno = seqno;
+}
+
+/*
+ * The VG lock says the latest seqno is the one seen by the label scan,
+ * so the metadata has not changed since the scan.
+ */
+bool lvmcache_lockd_seqno_unchanged(const char *vgid)
+{
+	struct lvmcache_vginfo *vginfo;
+
+	if (!vgid || !(vginfo = lvmcache_vginfo_from_vgid(vgid)))
+		return false;
+
+	return vginfo->lock_type && vginfo->lockd_seqno &&
+		(vginfo->lockd_seqno == vginfo->seqno);
+}
+
 static uint64_t _max_metadata_size;
 
 void lvmcache_save_metadata_size(uint64_t val)
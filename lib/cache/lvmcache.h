@@ -160,6 +160,9 @@ uint64_t lvmcache_device_size(struct lvmcache_info *info);
 void lvmcache_set_device_size(struct lvmcache_info *info, uint64_t size);
 struct device *lvmcache_device(struct lvmcache_info *info);
 unsigned lvmcache_mda_count(struct lvmcache_info *info);
+int lvmcache_mda1_summary_from_info(struct lvmcache_info *info,
+				    struct lvmcache_vgsummary *vgsummary,
+				    uint64_t *text_offset);
 uint64_t lvmcache_smallest_mda_size(struct lvmcache_info *info);
 
 bool lvmcache_has_duplicate_devs(void);
@@ -180,6 +183,9 @@ void lvmcache_get_max_name_lengths(struct cmd_context *cmd,
 int lvmcache_vg_is_foreign(struct cmd_context *cmd, const char *vgname, const char *vgid);
 
 bool lvmcache_scan_mismatch(struct cmd_context *cmd, const char *vgname, const char *vgid);
+uint32_t lvmcache_seqno(struct cmd_context *cmd, const char *vgid);
+void lvmcache_set_lockd_seqno(const char *vgname, uint32_t seqno);
+bool lvmcache_lockd_seqno_unchanged(const char *vgid);
 
 int lvmcache_vginfo_has_pvid(struct lvmcache_vginfo *vginfo, char *pvid);
 
@@ -217,6 +223,8 @@ void lvmcache_get_mdas(struct cmd_context *cmd,
                        const char *vgname, const char *vgid,
                        struct dm_list *mda_list);
 
+size_t lvmcache_vg_mda_size(const char *vgname, const char *vgid);
+
 const char *dev_filtered_reason(struct device *dev);
 const char *devname_error_reason(const char *devname);
 
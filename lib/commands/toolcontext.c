@@ -32,6 +32,7 @@
 #include "lib/cache/lvmcache.h"
 #include "lib/format_text/archiver.h"
 #include "lib/lvmpolld/lvmpolld-client.h"
+#include "lib/lvmcached/lvmcached-client.h"
 
 #include <locale.h>
 #include <sys/stat.h>
@@ -378,6 +379,8 @@ static void _init_logging(struct cmd_context *cmd)
 		init_log_file(log_file, append);
 	}
 
+	init_log_buffer((size_t) find_config_tree_int(cmd, log_buffer_size_CFG, NULL) * 1024);
+
 	init_log_while_suspended(find_config_tree_bool(cmd, log_activation_CFG, NULL));
 
 	cmd->default_settings.debug_classes = _parse_debug_classes(cmd);
@@ -661,6 +664,7 @@ static int _process_config(struct cmd_context *cmd)
 	cmd->default_settings.udev_fallback = udev_disabled ? 1 : -1;
 
 	init_retry_deactivation(find_config_tree_bool(cmd, activation_retry_deactivation_CFG, NULL));
+	init_deferred_remove(find_config_tree_bool(cmd, activation_deferred_remove_CFG, NULL));
 
 	init_activation_checks(find_config_tree_bool(cmd, activation_checks_CFG, NULL));
 
@@ -997,6 +1001,8 @@ static void _destroy_config(struct cmd_context *cmd)
 	if (cmd->cft)
 		log_error(INTERNAL_ERROR "_destroy_config: "
 			  "cmd config tree not destroyed fully");
+
+	config_values_reset(cmd);
 }
 
 static int _init_dev_cache(struct cmd_context *cmd)
@@ -1022,6 +1028,7 @@ static int _init_dev_cache(struct cmd_context *cmd)
 			find_config_tree_bool(cmd, devices_obtain_device_list_from_udev_CFG, NULL) : 0;
 
 	init_obtain_device_list_from_udev(device_list_from_udev);
+	init_obtain_device_list_from_sysfs(find_config_tree_bool(cmd, devices_obtain_device_list_from_sysfs_CFG, NULL));
 
 	if (!(cn = find_config_tree_array(cmd, devices_scan_CFG, NULL))) {
 		log_error(INTERNAL_ERROR "Unable to find configuration for devices/scan.");
@@ -1076,15 +1083,16 @@ static struct dev_filter *_init_filter_chain(struct cmd_context *cmd)
 	struct dev_filter *composite;
 
 	/*
-	 * Filters listed in order: top one gets applied first.
+	 * The composite filter applies these in order of their cost,
+	 * filters of the same cost in the order listed here.
 	 * Failure to initialise some filters is not fatal.
 	 * Update MAX_FILTERS definition above when adding new filters.
 	 */
 
 	/*
 	 * sysfs filter. Only available on 2.6 kernels.  Non-critical.
-	 * Listed first because it's very efficient at eliminating
-	 * unavailable devices.
+	 * Runs right after the name based filters because it's very
+	 * efficient at eliminating unavailable devices.
 	 */
 	if (find_config_tree_bool(cmd, devices_sysfs_scan_CFG, NULL)) {
 		if ((filters[nr_filt] = sysfs_filter_create()))
@@ -1192,6 +1200,9 @@ int init_filters(struct cmd_context *cmd, unsigned load_persistent_cache)
 		return 0;
 	}
 
+	if (!init_devices(cmd))
+		return_0;
+
 	filter = _init_filter_chain(cmd);
 	if (!filter)
 		goto_bad;
@@ -1310,11 +1321,76 @@ int lvm_register_segtype(struct segtype_library *seglib,
 	return 1;
 }
 
+/*
+ * Segment type families set up only when a name or flag they provide is
+ * looked up, so commands pay for the segtypes their VGs use and not for
+ * all of them.  The basic segtypes are always registered by
+ * _init_segtypes().
+ */
+struct segtype_family {
+	const char *prefix;	/* of the names registered */
+	uint64_t flags;		/* registered type flags */
+	int (*init)(struct cmd_context *cmd, struct segtype_library *seglib);
+};
+
+static const struct segtype_family _segtype_families[] = {
+#ifdef RAID_INTERNAL
+	{ SEG_TYPE_NAME_RAID, SEG_RAID | SEG_RAID0 | SEG_RAID0_META | SEG_RAID1 |
+	  SEG_RAID10_NEAR | SEG_RAID4 | SEG_RAID5_N | SEG_RAID5_LA | SEG_RAID5_LS |
+	  SEG_RAID5_RA | SEG_RAID5_RS | SEG_RAID6_NC | SEG_RAID6_NR | SEG_RAID6_ZR |
+	  SEG_RAID6_LA_6 | SEG_RAID6_LS_6 | SEG_RAID6_RA_6 | SEG_RAID6_RS_6 |
+	  SEG_RAID6_N_6, init_raid_segtypes },
+#endif
+#ifdef THIN_INTERNAL
+	{ SEG_TYPE_NAME_THIN, SEG_THIN_POOL | SEG_THIN_VOLUME, init_thin_segtypes },
+#endif
+#ifdef CACHE_INTERNAL
+	{ SEG_TYPE_NAME_CACHE, SEG_CACHE | SEG_CACHE_POOL, init_cache_segtypes },
+#endif
+#ifdef VDO_INTERNAL
+	{ SEG_TYPE_NAME_VDO, SEG_VDO | SEG_VDO_POOL, init_vdo_segtypes },
+#endif
+#ifdef WRITECACHE_INTERNAL
+	{ SEG_TYPE_NAME_WRITECACHE, SEG_WRITECACHE, init_writecache_segtypes },
+#endif
+#ifdef INTEGRITY_INTERNAL
+	{ SEG_TYPE_NAME_INTEGRITY, SEG_INTEGRITY, init_integrity_segtypes },
+#endif
+	{ NULL, 0, NULL }
+};
+
+int load_segtypes(struct cmd_context *cmd, const char *name, uint64_t flag)
+{
+	struct segtype_library seglib = { .cmd = cmd, .lib = NULL };
+	const struct segtype_family *f;
+	unsigned bit;
+
+	for (f = _segtype_families, bit = 1; f->init; f++, bit <<= 1) {
+		if (cmd->segtype_families_loaded & bit)
+			continue;
+
+		if (name && strncmp(name, f->prefix, strlen(f->prefix)))
+			continue;
+
+		if (flag && !(flag & f->flags))
+			continue;
+
+		log_debug("Registering %s segment types.", f->prefix);
+
+		/* Marked first, a failure is not retried on every lookup */
+		cmd->segtype_families_loaded |= bit;
+
+		if (!f->init(cmd, &seglib))
+			return_0;
+	}
+
+	return 1;
+}
+
 static int _init_segtypes(struct cmd_context *cmd)
 {
 	int i;
 	struct segment_type *segtype;
-	struct segtype_library seglib = { .cmd = cmd, .lib = NULL };
 	struct segment_type *(*init_segtype_array[])(struct cmd_context *cmd) = {
 		init_linear_segtype,
 		init_striped_segtype,
@@ -1337,35 +1413,8 @@ static int _init_segtypes(struct cmd_context *cmd)
 		dm_list_add(&cmd->segtypes, &segtype->list);
 	}
 
-#ifdef RAID_INTERNAL
-	if (!init_raid_segtypes(cmd, &seglib))
-		return 0;
-#endif
-
-#ifdef THIN_INTERNAL
-	if (!init_thin_segtypes(cmd, &seglib))
-		return 0;
-#endif
-
-#ifdef CACHE_INTERNAL
-	if (!init_cache_segtypes(cmd, &seglib))
-		return 0;
-#endif
-
-#ifdef VDO_INTERNAL
-	if (!init_vdo_segtypes(cmd, &seglib))
-		return_0;
-#endif
-
-#ifdef WRITECACHE_INTERNAL
-	if (!init_writecache_segtypes(cmd, &seglib))
-		return 0;
-#endif
-
-#ifdef INTEGRITY_INTERNAL
-	if (!init_integrity_segtypes(cmd, &seglib))
-		return 0;
-#endif
+	/* The other families are registered by load_segtypes() when used */
+	cmd->segtype_families_loaded = 0;
 
 	return 1;
 }
@@ -1396,11 +1445,12 @@ static int _init_backup(struct cmd_context *cmd)
 {
 	uint32_t days, min;
 	const char *dir;
+	int compress;
 
 	if (!cmd->system_dir[0]) {
 		log_warn("WARNING: Metadata changes will NOT be backed up");
 		backup_init(cmd, "", 0);
-		archive_init(cmd, "", 0, 0, 0);
+		archive_init(cmd, "", 0, 0, 0, 0);
 		return 1;
 	}
 
@@ -1412,10 +1462,12 @@ static int _init_backup(struct cmd_context *cmd)
 
 	min = (uint32_t) find_config_tree_int(cmd, backup_retain_min_CFG, NULL);
 
+	compress = find_config_tree_bool(cmd, backup_compress_archive_CFG, NULL);
+
 	if (!(dir = find_config_tree_str(cmd, backup_archive_dir_CFG, NULL)))
 		return_0;
 
-	if (!archive_init(cmd, dir, days, min,
+	if (!archive_init(cmd, dir, days, min, compress,
 			  cmd->default_settings.archive)) {
 		log_debug("archive_init failed.");
 		return 0;
@@ -1466,6 +1518,20 @@ static int _init_lvmpolld(struct cmd_context *cmd)
 	return 1;
 }
 
+static void _init_lvmcached(struct cmd_context *cmd)
+{
+	const char *lvmcached_socket;
+
+	lvmcached_disconnect();
+
+	if (!(lvmcached_socket = getenv("LVM_LVMCACHED_SOCKET")))
+		lvmcached_socket = DEFAULT_RUN_DIR "/lvmcached.socket";
+	lvmcached_set_socket(lvmcached_socket);
+
+	/* Only a cache, it is connected to when metadata is first read */
+	lvmcached_set_active(find_config_tree_bool(cmd, global_use_lvmcached_CFG, NULL));
+}
+
 int init_connections(struct cmd_context *cmd)
 {
 	if (!_init_lvmpolld(cmd)) {
@@ -1473,6 +1539,8 @@ int init_connections(struct cmd_context *cmd)
 		goto bad;
 	}
 
+	_init_lvmcached(cmd);
+
 	cmd->initialized.connections = 1;
 	return 1;
 bad:
@@ -1708,14 +1776,9 @@ struct cmd_context *create_toolcontext(unsigned is_clvmd,
 	if (!_init_profiles(cmd))
 		goto_out;
 
-	if (!(cmd->dev_types = create_dev_types(cmd->proc_dir,
-						find_config_tree_array(cmd, devices_types_CFG, NULL))))
-		goto_out;
-
 	init_use_aio(find_config_tree_bool(cmd, global_use_aio_CFG, NULL));
-
-	if (!_init_dev_cache(cmd))
-		goto_out;
+	init_use_io_uring(find_config_tree_bool(cmd, global_use_io_uring_CFG, NULL));
+	init_io_threads(find_config_tree_int(cmd, global_io_threads_CFG, NULL));
 
 	memlock_init(cmd);
 
@@ -1788,7 +1851,7 @@ static void _destroy_dev_types(struct cmd_context *cmd)
 	if (!cmd->dev_types)
 		return;
 
-	free(cmd->dev_types);
+	destroy_dev_types(cmd->dev_types);
 	cmd->dev_types = NULL;
 }
 
@@ -1801,6 +1864,30 @@ static void _destroy_filters(struct cmd_context *cmd)
 	cmd->initialized.filters = 0;
 }
 
+/*
+ * The device types from /proc/devices and the device cache are only
+ * set up once something needs devices, so commands that do no metadata
+ * processing never pay for them.
+ */
+int init_devices(struct cmd_context *cmd)
+{
+	if (cmd->initialized.devices)
+		return 1;
+
+	if (!(cmd->dev_types = create_dev_types(cmd->proc_dir,
+						find_config_tree_array(cmd, devices_types_CFG, NULL))))
+		return_0;
+
+	if (!_init_dev_cache(cmd)) {
+		_destroy_dev_types(cmd);
+		return_0;
+	}
+
+	cmd->initialized.devices = 1;
+
+	return 1;
+}
+
 int refresh_filters(struct cmd_context *cmd)
 {
 	int r, saved_ignore_suspended_devices = ignore_suspended_devices();
@@ -1826,6 +1913,7 @@ int refresh_toolcontext(struct cmd_context *cmd)
 	struct dm_config_tree *cft_cmdline, *cft_tmp;
 	const char *profile_command_name, *profile_metadata_name;
 	struct profile *profile;
+	int devices = cmd->initialized.devices;
 
 	log_verbose("Reloading config files");
 
@@ -1845,6 +1933,7 @@ int refresh_toolcontext(struct cmd_context *cmd)
 	if (!dev_cache_exit())
 		stack;
 	_destroy_dev_types(cmd);
+	cmd->initialized.devices = 0;
 	_destroy_tags(cmd);
 
 	/* save config string passed on the command line */
@@ -1914,11 +2003,7 @@ int refresh_toolcontext(struct cmd_context *cmd)
 	if (!_init_profiles(cmd))
 		return_0;
 
-	if (!(cmd->dev_types = create_dev_types(cmd->proc_dir,
-						find_config_tree_array(cmd, devices_types_CFG, NULL))))
-		return_0;
-
-	if (!_init_dev_cache(cmd))
+	if (devices && !init_devices(cmd))
 		return_0;
 
 	if (!_init_formats(cmd))
@@ -1968,6 +2053,7 @@ void destroy_toolcontext(struct cmd_context *cmd)
 	_destroy_segtypes(&cmd->segtypes);
 	_destroy_formats(cmd, &cmd->formats);
 	_destroy_filters(cmd);
+	vdo_stats_cache_destroy(cmd);
 	if (cmd->mem)
 		dm_pool_destroy(cmd->mem);
 	dev_cache_exit();
@@ -2013,8 +2099,10 @@ void destroy_toolcontext(struct cmd_context *cmd)
 	free(cmd);
 
 	lvmpolld_disconnect();
+	lvmcached_disconnect();
 
 	activation_exit();
+	str_set_intern_destroy();
 	reset_log_duplicated();
 	fin_log();
 	fin_syslog();
@@ -51,6 +51,7 @@ struct config_info {
 
 struct dm_config_tree;
 struct profile_params;
+struct config_values;
 struct archive_params;
 struct backup_params;
 struct arg_values;
@@ -64,6 +65,7 @@ struct cmd_context_initialized_parts {
 	unsigned config:1; /* used to reinitialize config if previous init was not successful */
 	unsigned filters:1;
 	unsigned connections:1;
+	unsigned devices:1;
 };
 
 struct cmd_report {
@@ -110,6 +112,7 @@ struct cmd_context {
 	struct format_type *fmt_backup;		/* format to use for backups */
 	struct dm_list formats;			/* available formats */
 	struct dm_list segtypes;		/* available segment types */
+	unsigned segtype_families_loaded;	/* bitmask, see load_segtypes() */
 
 	/*
 	 * Machine and system identification.
@@ -133,6 +136,8 @@ struct cmd_context {
 	 */
 	unsigned is_long_lived:1;		/* optimises persistent_filter handling */
 	unsigned is_interactive:1;
+	unsigned reuse_parsed_metadata:1;	/* keep parsed VG metadata across commands */
+	unsigned keep_scan_state:1;		/* keep bcache and device list across commands */
 	unsigned check_pv_dev_sizes:1;
 	unsigned handles_missing_pvs:1;
 	unsigned handles_unknown_segments:1;
@@ -173,6 +178,7 @@ struct cmd_context {
 	unsigned mirror_warn_printed:1;		/* command already printed warning about non-monitored mirrors */
 	unsigned pvscan_cache_single:1;
 	unsigned can_use_one_scan:1;
+	unsigned read_without_lock:1;		/* report/read_without_lock */
 	unsigned is_clvmd:1;
 	unsigned md_component_detection:1;
 	unsigned use_full_md_check:1;
@@ -183,6 +189,9 @@ struct cmd_context {
 	unsigned scan_lvs:1;
 	unsigned wipe_outdated_pvs:1;
 	unsigned filter_nodata_only:1;          /* only use filters that do not require data from the dev */
+	unsigned poll_single_check:1;		/* lvpoll checks progress once and returns */
+	unsigned poll_in_progress:1;		/* set by a single check that found work left */
+	unsigned udev_sync_deferred:1;		/* wait for udev once when the command ends */
 
 	/*
 	 * Devices and filtering.
@@ -198,6 +207,7 @@ struct cmd_context {
 	struct profile_params *profile_params;	/* profile handling params including loaded profile configs */
 	struct dm_config_tree *cft;		/* the whole cascade: CONFIG_STRING -> CONFIG_PROFILE -> CONFIG_FILE/CONFIG_MERGED_FILES */
 	struct dm_hash_table *cft_def_hash;	/* config definition hash used for validity check (item type + item recognized) */
+	struct config_values *cft_values;	/* settings already resolved from the cascade, by setting ID */
 	struct config_info default_settings;	/* selected settings with original default/configured value which can be changed during cmd processing */
 	struct config_info current_settings; 	/* may contain changed values compared to default_settings */
 
@@ -242,6 +252,7 @@ struct cmd_context {
 	unsigned rand_seed;
 	struct dm_list pending_delete;		/* list of LVs for removal */
 	struct dm_pool *pending_delete_mem;	/* memory pool for pending deletes */
+	struct dm_hash_table *vdo_stats;	/* kvdo statistics read by this command, in mem */
 };
 
 /*
@@ -260,6 +271,7 @@ int refresh_filters(struct cmd_context *cmd);
 int process_profilable_config(struct cmd_context *cmd);
 int config_files_changed(struct cmd_context *cmd);
 int init_lvmcache_orphans(struct cmd_context *cmd);
+int init_devices(struct cmd_context *cmd);
 int init_filters(struct cmd_context *cmd, unsigned load_persistent_cache);
 int init_connections(struct cmd_context *cmd);
 int init_run_by_dmeventd(struct cmd_context *cmd);
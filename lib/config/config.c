@@ -14,10 +14,12 @@
  */
 
 
+#include "base/memory/zalloc.h"
 #include "lib/misc/lib.h"
 
 #include "lib/config/config.h"
 #include "lib/misc/crc.h"
+#include "lib/misc/lvm-compress.h"
 #include "lib/device/device.h"
 #include "lib/datastruct/str_list.h"
 #include "lib/commands/toolcontext.h"
@@ -491,6 +493,100 @@ int override_config_tree_from_profile(struct cmd_context *cmd,
 	return 0;
 }
 
+struct checksum_walk {
+	checksum_fn_t checksum_fn;
+	uint32_t checksum;
+};
+
+static bool _checksum_walk(void *context, const void *data, size_t len)
+{
+	struct checksum_walk *cw = context;
+
+	cw->checksum = cw->checksum_fn(cw->checksum, (const uint8_t *) data, len);
+
+	return true;
+}
+
+static int _config_parse_buf(struct dm_config_tree *cft, const char *fb, const char *fe,
+			     int no_dup_node_check)
+{
+	char *text = NULL;
+	size_t text_size;
+	int r;
+
+	/* VG metadata written with metadata/compress_metadata. */
+	if (text_is_compressed(fb, fe - fb)) {
+		if (!(text = decompress_text(fb, fe - fb, &text_size)))
+			return_0;
+		fb = text;
+		fe = text + text_size;
+	}
+
+	/* Delta metadata is plain text after its marker line. */
+	if (text_is_delta(fb, fe - fb))
+		fb += DELTA_TEXT_MAGIC_LEN;
+
+	if (no_dup_node_check)
+		r = dm_config_parse_without_dup_node_check(cft, fb, fe);
+	else
+		r = dm_config_parse(cft, fb, fe);
+
+	free(text);
+
+	return r;
+}
+
+int config_read_buf(struct dm_config_tree *cft, const char *buf, size_t size,
+		    int no_dup_node_check)
+{
+	return _config_parse_buf(cft, buf, buf + size, no_dup_node_check);
+}
+
+/*
+ * Checksum and parse metadata text in place in bcache blocks.
+ * The checksum is computed over each block in turn, and when the text
+ * lies within one block (no wrap in the circular buffer) the parser
+ * runs directly over the pinned block.  Parsing duplicates every token
+ * into the cft pool, so the tree outlives the pin.
+ * Returns -1 if the text still needs a contiguous copy to be parsed.
+ */
+static int _config_file_read_bcache(struct dm_config_tree *cft, struct device *dev,
+				    off_t offset, size_t size, off_t offset2, size_t size2,
+				    checksum_fn_t checksum_fn, uint32_t checksum,
+				    int checksum_only, int no_dup_node_check)
+{
+	struct checksum_walk cw = { .checksum_fn = checksum_fn, .checksum = INITIAL_CRC };
+	struct block *b;
+	const char *fb;
+	int r;
+
+	if (checksum_fn) {
+		if (!dev_walk_bytes(dev, offset, size, _checksum_walk, &cw) ||
+		    (size2 && !dev_walk_bytes(dev, offset2, size2, _checksum_walk, &cw)))
+			return_0;
+
+		/* See comment in config_file_read_fd(). */
+		if (checksum != cw.checksum) {
+			log_error("%s: Checksum error at offset %" PRIu64, dev_name(dev), (uint64_t) offset);
+			return 0;
+		}
+	}
+
+	if (checksum_only)
+		return 1;
+
+	if (size2 || !(fb = dev_get_bytes(dev, offset, size, &b)))
+		return -1;
+
+	r = _config_parse_buf(cft, fb, fb + size, no_dup_node_check);
+	dev_put_bytes(b);
+
+	if (!r)
+		stack;
+
+	return r;
+}
+
 /*
  * When checksum_only is set, the checksum of buffer is only matched
  * and function avoids parsing of mda into config tree which
@@ -519,6 +615,17 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 	if (!(dev->flags & DEV_REGULAR) || size2)
 		use_plain_read = 0;
 
+	if (!use_plain_read) {
+		if ((r = _config_file_read_bcache(cft, dev, offset, size, offset2, size2,
+						  checksum_fn, checksum, checksum_only,
+						  no_dup_node_check)) >= 0)
+			return r;
+
+		/* Already checksummed, only the contiguous copy is needed. */
+		checksum_fn = NULL;
+		r = 0;
+	}
+
 	if (!(buf = malloc(size + size2))) {
 		log_error("Failed to allocate circular buffer.");
 		return 0;
@@ -563,13 +670,8 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 
 	if (!checksum_only) {
 		fe = fb + size + size2;
-		if (no_dup_node_check) {
-			if (!dm_config_parse_without_dup_node_check(cft, fb, fe))
-				goto_out;
-		} else {
-			if (!dm_config_parse(cft, fb, fe))
-				goto_out;
-		}
+		if (!_config_parse_buf(cft, fb, fe, no_dup_node_check))
+			goto_out;
 	}
 
 	r = 1;
@@ -580,12 +682,354 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 	return r;
 }
 
+/*
+ * Config files and profiles are kept in binary form under the run dir,
+ * keyed by the identity of the file they came from.  Loading one only
+ * rebuilds the nodes, so a large lvm.conf is not lexed by every command.
+ * Anything unexpected in a cache file just falls back to parsing.
+ */
+#define CONFIG_CACHE_MAGIC "LVMCFGC1"
+
+struct config_cache_header {
+	char magic[8];
+	uint64_t st_dev;
+	uint64_t st_ino;
+	uint64_t st_size;
+	int64_t ctime_sec;
+	int64_t ctime_nsec;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	uint32_t payload_size;
+	uint32_t payload_crc;
+};
+
+struct config_cache_buf {
+	char *data;
+	size_t size;
+	size_t alloc;
+	const char *pos;
+	const char *end;
+};
+
+static int _config_cache_path(char *buf, size_t buf_size, const char *filename)
+{
+	char *p;
+
+	if (dm_snprintf(buf, buf_size, "%s/config%s.cache", DEFAULT_RUN_DIR, filename) < 0)
+		return 0;
+
+	/* Flatten the config file path into one file name */
+	for (p = buf + strlen(DEFAULT_RUN_DIR) + 1; *p; p++)
+		if (*p == '/')
+			*p = '_';
+
+	return 1;
+}
+
+static void _config_cache_fill_header(struct config_cache_header *hdr, const struct stat *info)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->magic, CONFIG_CACHE_MAGIC, sizeof(hdr->magic));
+	hdr->st_dev = (uint64_t) info->st_dev;
+	hdr->st_ino = (uint64_t) info->st_ino;
+	hdr->st_size = (uint64_t) info->st_size;
+	hdr->ctime_sec = (int64_t) info->st_ctim.tv_sec;
+	hdr->ctime_nsec = (int64_t) info->st_ctim.tv_nsec;
+	hdr->mtime_sec = (int64_t) info->st_mtim.tv_sec;
+	hdr->mtime_nsec = (int64_t) info->st_mtim.tv_nsec;
+}
+
+static int _config_cache_put(struct config_cache_buf *cb, const void *data, size_t len)
+{
+	char *n;
+	size_t alloc;
+
+	if (cb->size + len > cb->alloc) {
+		alloc = cb->alloc ? cb->alloc : 4096;
+		while (cb->size + len > alloc)
+			alloc *= 2;
+		if (!(n = realloc(cb->data, alloc)))
+			return 0;
+		cb->data = n;
+		cb->alloc = alloc;
+	}
+
+	memcpy(cb->data + cb->size, data, len);
+	cb->size += len;
+
+	return 1;
+}
+
+static int _config_cache_put_u32(struct config_cache_buf *cb, uint32_t v)
+{
+	return _config_cache_put(cb, &v, sizeof(v));
+}
+
+static int _config_cache_put_str(struct config_cache_buf *cb, const char *str)
+{
+	uint32_t len = (uint32_t) strlen(str);
+
+	return _config_cache_put_u32(cb, len) && _config_cache_put(cb, str, len);
+}
+
+/* A sibling list: count, then key, values and children of each node */
+static int _config_cache_put_nodes(struct config_cache_buf *cb, const struct dm_config_node *cn)
+{
+	const struct dm_config_node *n;
+	const struct dm_config_value *v;
+	uint32_t count = 0;
+	uint8_t type;
+
+	for (n = cn; n; n = n->sib)
+		count++;
+
+	if (!_config_cache_put_u32(cb, count))
+		return 0;
+
+	for (n = cn; n; n = n->sib) {
+		if (!_config_cache_put_str(cb, n->key))
+			return 0;
+
+		count = 0;
+		for (v = n->v; v; v = v->next)
+			count++;
+
+		if (!_config_cache_put_u32(cb, count))
+			return 0;
+
+		for (v = n->v; v; v = v->next) {
+			type = (uint8_t) v->type;
+			if (!_config_cache_put(cb, &type, sizeof(type)) ||
+			    !_config_cache_put_u32(cb, v->format_flags))
+				return 0;
+
+			switch (v->type) {
+			case DM_CFG_INT:
+				if (!_config_cache_put(cb, &v->v.i, sizeof(v->v.i)))
+					return 0;
+				break;
+			case DM_CFG_FLOAT:
+				if (!_config_cache_put(cb, &v->v.f, sizeof(v->v.f)))
+					return 0;
+				break;
+			case DM_CFG_STRING:
+				if (!_config_cache_put_str(cb, v->v.str))
+					return 0;
+				break;
+			case DM_CFG_EMPTY_ARRAY:
+				break;
+			default:
+				return 0;
+			}
+		}
+
+		if (!_config_cache_put_nodes(cb, n->child))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int _config_cache_get(struct config_cache_buf *cb, void *data, size_t len)
+{
+	if ((size_t) (cb->end - cb->pos) < len)
+		return 0;
+
+	memcpy(data, cb->pos, len);
+	cb->pos += len;
+
+	return 1;
+}
+
+static const char *_config_cache_get_str(struct config_cache_buf *cb, struct dm_pool *mem)
+{
+	uint32_t len;
+	const char *str;
+
+	if (!_config_cache_get(cb, &len, sizeof(len)) ||
+	    ((size_t) (cb->end - cb->pos) < len))
+		return NULL;
+
+	str = dm_pool_strndup(mem, cb->pos, len);
+	cb->pos += len;
+
+	return str;
+}
+
+static int _config_cache_get_nodes(struct config_cache_buf *cb, struct dm_config_tree *cft,
+				   struct dm_config_node *parent, struct dm_config_node **first,
+				   unsigned depth)
+{
+	struct dm_pool *mem = dm_config_memory(cft);
+	struct dm_config_node *cn, *last = NULL;
+	struct dm_config_value *cv, *last_v;
+	uint32_t count, values;
+	uint8_t type;
+
+	*first = NULL;
+
+	if ((depth > 64) || !_config_cache_get(cb, &count, sizeof(count)))
+		return 0;
+
+	while (count--) {
+		if (!(cn = dm_pool_zalloc(mem, sizeof(*cn))) ||
+		    !(cn->key = _config_cache_get_str(cb, mem)) ||
+		    !_config_cache_get(cb, &values, sizeof(values)))
+			return 0;
+
+		cn->parent = parent;
+		last_v = NULL;
+
+		while (values--) {
+			if (!(cv = dm_config_create_value(cft)) ||
+			    !_config_cache_get(cb, &type, sizeof(type)) ||
+			    !_config_cache_get(cb, &cv->format_flags, sizeof(cv->format_flags)))
+				return 0;
+
+			switch ((cv->type = (dm_config_value_type_t) type)) {
+			case DM_CFG_INT:
+				if (!_config_cache_get(cb, &cv->v.i, sizeof(cv->v.i)))
+					return 0;
+				break;
+			case DM_CFG_FLOAT:
+				if (!_config_cache_get(cb, &cv->v.f, sizeof(cv->v.f)))
+					return 0;
+				break;
+			case DM_CFG_STRING:
+				if (!(cv->v.str = _config_cache_get_str(cb, mem)))
+					return 0;
+				break;
+			case DM_CFG_EMPTY_ARRAY:
+				break;
+			default:
+				return 0;
+			}
+
+			if (last_v)
+				last_v->next = cv;
+			else
+				cn->v = cv;
+			last_v = cv;
+		}
+
+		if (!_config_cache_get_nodes(cb, cft, cn, &cn->child, depth + 1))
+			return 0;
+
+		if (last)
+			last->sib = cn;
+		else
+			*first = cn;
+		last = cn;
+	}
+
+	return 1;
+}
+
+static int _config_cache_load(struct dm_config_tree *cft, const char *filename,
+			      const struct stat *info)
+{
+	struct config_cache_header hdr, want;
+	struct config_cache_buf cb = { 0 };
+	struct dm_config_node *root;
+	char path[PATH_MAX];
+	struct stat st;
+	char *data = NULL;
+	int fd, r = 0;
+
+	if (!_config_cache_path(path, sizeof(path), filename))
+		return 0;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 0;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+	    (read(fd, &hdr, sizeof(hdr)) != (ssize_t) sizeof(hdr)))
+		goto out;
+
+	_config_cache_fill_header(&want, info);
+	want.payload_size = hdr.payload_size;
+	want.payload_crc = hdr.payload_crc;
+
+	if (memcmp(&hdr, &want, sizeof(hdr)) ||
+	    ((uint64_t) st.st_size != sizeof(hdr) + hdr.payload_size))
+		goto out;
+
+	if (!(data = malloc(hdr.payload_size ? : 1)) ||
+	    (read(fd, data, hdr.payload_size) != (ssize_t) hdr.payload_size) ||
+	    (calc_crc(INITIAL_CRC, (const uint8_t *) data, hdr.payload_size) != hdr.payload_crc))
+		goto out;
+
+	cb.pos = data;
+	cb.end = data + hdr.payload_size;
+
+	if (!_config_cache_get_nodes(&cb, cft, NULL, &root, 0) || (cb.pos != cb.end) || !root)
+		goto out;
+
+	cft->root = root;
+	log_debug("Loaded %s from config cache %s.", filename, path);
+	r = 1;
+out:
+	free(data);
+	if (close(fd))
+		log_sys_debug("close", path);
+
+	return r;
+}
+
+static void _config_cache_save(struct dm_config_tree *cft, const char *filename,
+			       const struct stat *info)
+{
+	struct config_cache_header hdr;
+	struct config_cache_buf cb = { 0 };
+	char path[PATH_MAX], tmp[PATH_MAX];
+	int fd, r = 0;
+
+	if (!cft->root ||
+	    !_config_cache_path(path, sizeof(path), filename) ||
+	    (dm_snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int) getpid()) < 0))
+		return;
+
+	if (!_config_cache_put_nodes(&cb, cft->root))
+		goto out;
+
+	_config_cache_fill_header(&hdr, info);
+	hdr.payload_size = (uint32_t) cb.size;
+	hdr.payload_crc = calc_crc(INITIAL_CRC, (const uint8_t *) cb.data, (uint32_t) cb.size);
+
+	if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_EXCL, 0600)) < 0) {
+		log_sys_debug("open", tmp);
+		goto out;
+	}
+
+	if ((write(fd, &hdr, sizeof(hdr)) == (ssize_t) sizeof(hdr)) &&
+	    (write(fd, cb.data, cb.size) == (ssize_t) cb.size))
+		r = 1;
+	else
+		log_sys_debug("write", tmp);
+
+	if (close(fd)) {
+		log_sys_debug("close", tmp);
+		r = 0;
+	}
+
+	if (r && rename(tmp, path)) {
+		log_sys_debug("rename", path);
+		r = 0;
+	}
+
+	if (!r && unlink(tmp))
+		log_sys_debug("unlink", tmp);
+out:
+	free(cb.data);
+}
+
 int config_file_read(struct dm_config_tree *cft)
 {
 	const char *filename = NULL;
 	struct config_source *cs = dm_config_get_custom(cft);
 	struct config_file *cf;
 	struct stat info;
+	int use_cache;
 	int r;
 
 	if (!config_file_check(cft, &filename, &info))
@@ -597,6 +1041,11 @@ int config_file_read(struct dm_config_tree *cft)
 
 	cf = cs->source.file;
 
+	use_cache = (cs->type == CONFIG_FILE) || _is_profile_based_config_source(cs->type);
+
+	if (use_cache && !cf->keep_open && _config_cache_load(cft, filename, &info))
+		return 1;
+
 	if (!cf->dev) {
 		if (!(cf->dev = dev_create_file(filename, NULL, NULL, 1)))
 			return_0;
@@ -617,6 +1066,9 @@ int config_file_read(struct dm_config_tree *cft)
 		cf->dev = NULL;
 	}
 
+	if (r && use_cache && !cf->keep_open)
+		_config_cache_save(cft, filename, &info);
+
 	return r;
 }
 
@@ -1229,6 +1681,76 @@ static int _config_disabled(struct cmd_context *cmd, cfg_def_item_t *item, const
 	return 0;
 }
 
+/*
+ * Settings resolved by the find_config_tree_* functions are kept in a
+ * table indexed by setting ID, so looking the same setting up again
+ * neither builds its path nor walks the cascade.  The table belongs to
+ * the cascade it was filled from; lookups under a local profile and
+ * settings with run time defaults or disabled settings are not kept.
+ */
+#define CONFIG_VALUES_CASCADE_MAX 8
+
+enum {
+	CONFIG_VALUE_UNSET = 0,
+	CONFIG_VALUE_STR,
+	CONFIG_VALUE_STR_ALLOW_EMPTY,
+	CONFIG_VALUE_INT,
+	CONFIG_VALUE_INT64,
+	CONFIG_VALUE_FLOAT,
+	CONFIG_VALUE_BOOL,
+};
+
+struct config_value {
+	unsigned kind;
+	union {
+		int64_t i;
+		float f;
+		const char *str;
+	} v;
+};
+
+struct config_values {
+	struct dm_config_tree *cascade[CONFIG_VALUES_CASCADE_MAX];
+	struct config_value value[CFG_COUNT];
+};
+
+void config_values_reset(struct cmd_context *cmd)
+{
+	free(cmd->cft_values);
+	cmd->cft_values = NULL;
+}
+
+static struct config_value *_config_value(struct cmd_context *cmd, cfg_def_item_t *item,
+					  int profile_applied)
+{
+	struct config_values *cv;
+	struct dm_config_tree *cft;
+	unsigned i = 0;
+
+	if (profile_applied || (item->flags & (CFG_DEFAULT_RUN_TIME | CFG_DISABLED)))
+		return NULL;
+
+	if (!(cv = cmd->cft_values) &&
+	    !(cv = cmd->cft_values = zalloc(sizeof(*cv))))
+		return NULL;
+
+	for (cft = cmd->cft; cft && (i < CONFIG_VALUES_CASCADE_MAX); cft = cft->cascade, i++)
+		if (cv->cascade[i] != cft)
+			break;
+
+	if (cft || ((i < CONFIG_VALUES_CASCADE_MAX) && cv->cascade[i])) {
+		/* Cascade changed since the values were resolved */
+		memset(cv, 0, sizeof(*cv));
+		for (i = 0, cft = cmd->cft; cft; cft = cft->cascade, i++) {
+			if (i == CONFIG_VALUES_CASCADE_MAX)
+				return NULL;
+			cv->cascade[i] = cft;
+		}
+	}
+
+	return &cv->value[item->id];
+}
+
 const struct dm_config_node *find_config_node(struct cmd_context *cmd, struct dm_config_tree *cft, int id)
 {
 	cfg_def_item_t *item = cfg_def_get_item_p(id);
@@ -1265,9 +1787,14 @@ const char *find_config_tree_str(struct cmd_context *cmd, int id, struct profile
 	cfg_def_item_t *item = cfg_def_get_item_p(id);
 	char path[CFG_PATH_MAX_LEN];
 	int profile_applied;
+	struct config_value *cv;
 	const char *str;
 
 	profile_applied = _apply_local_profile(cmd, profile);
+
+	if ((cv = _config_value(cmd, item, profile_applied)) && (cv->kind == CONFIG_VALUE_STR))
+		return cv->v.str;
+
 	_cfg_def_make_path(path, sizeof(path), item->id, item, 0);
 
 	if (item->type != CFG_TYPE_STRING)
@@ -1278,6 +1805,10 @@ const char *find_config_tree_str(struct cmd_context *cmd, int id, struct profile
 
 	if (profile_applied && profile)
 		remove_config_tree_by_source(cmd, profile->source);
+	else if (cv) {
+		cv->kind = CONFIG_VALUE_STR;
+		cv->v.str = str;
+	}
 
 	return str;
 }
@@ -1287,9 +1818,14 @@ const char *find_config_tree_str_allow_empty(struct cmd_context *cmd, int id, st
 	cfg_def_item_t *item = cfg_def_get_item_p(id);
 	char path[CFG_PATH_MAX_LEN];
 	int profile_applied;
+	struct config_value *cv;
 	const char *str;
 
 	profile_applied = _apply_local_profile(cmd, profile);
+
+	if ((cv = _config_value(cmd, item, profile_applied)) && (cv->kind == CONFIG_VALUE_STR_ALLOW_EMPTY))
+		return cv->v.str;
+
 	_cfg_def_make_path(path, sizeof(path), item->id, item, 0);
 
 	if (item->type != CFG_TYPE_STRING)
@@ -1302,6 +1838,10 @@ const char *find_config_tree_str_allow_empty(struct cmd_context *cmd, int id, st
 
 	if (profile_applied && profile)
 		remove_config_tree_by_source(cmd, profile->source);
+	else if (cv) {
+		cv->kind = CONFIG_VALUE_STR_ALLOW_EMPTY;
+		cv->v.str = str;
+	}
 
 	return str;
 }
@@ -1311,9 +1851,14 @@ int find_config_tree_int(struct cmd_context *cmd, int id, struct profile *profil
 	cfg_def_item_t *item = cfg_def_get_item_p(id);
 	char path[CFG_PATH_MAX_LEN];
 	int profile_applied;
+	struct config_value *cv;
 	int i;
 
 	profile_applied = _apply_local_profile(cmd, profile);
+
+	if ((cv = _config_value(cmd, item, profile_applied)) && (cv->kind == CONFIG_VALUE_INT))
+		return cv->v.i;
+
 	_cfg_def_make_path(path, sizeof(path), item->id, item, 0);
 
 	if (item->type != CFG_TYPE_INT)
@@ -1324,6 +1869,10 @@ int find_config_tree_int(struct cmd_context *cmd, int id, struct profile *profil
 
 	if (profile_applied && profile)
 		remove_config_tree_by_source(cmd, profile->source);
+	else if (cv) {
+		cv->kind = CONFIG_VALUE_INT;
+		cv->v.i = i;
+	}
 
 	return i;
 }
@@ -1333,9 +1882,14 @@ int64_t find_config_tree_int64(struct cmd_context *cmd, int id, struct profile *
 	cfg_def_item_t *item = cfg_def_get_item_p(id);
 	char path[CFG_PATH_MAX_LEN];
 	int profile_applied;
+	struct config_value *cv;
 	int i64;
 
 	profile_applied = _apply_local_profile(cmd, profile);
+
+	if ((cv = _config_value(cmd, item, profile_applied)) && (cv->kind == CONFIG_VALUE_INT64))
+		return cv->v.i;
+
 	_cfg_def_make_path(path, sizeof(path), item->id, item, 0);
 
 	if (item->type != CFG_TYPE_INT)
@@ -1346,6 +1900,10 @@ int64_t find_config_tree_int64(struct cmd_context *cmd, int id, struct profile *
 
 	if (profile_applied && profile)
 		remove_config_tree_by_source(cmd, profile->source);
+	else if (cv) {
+		cv->kind = CONFIG_VALUE_INT64;
+		cv->v.i = i64;
+	}
 
 	return i64;
 }
@@ -1355,9 +1913,14 @@ float find_config_tree_float(struct cmd_context *cmd, int id, struct profile *pr
 	cfg_def_item_t *item = cfg_def_get_item_p(id);
 	char path[CFG_PATH_MAX_LEN];
 	int profile_applied;
+	struct config_value *cv;
 	float f;
 
 	profile_applied = _apply_local_profile(cmd, profile);
+
+	if ((cv = _config_value(cmd, item, profile_applied)) && (cv->kind == CONFIG_VALUE_FLOAT))
+		return cv->v.f;
+
 	_cfg_def_make_path(path, sizeof(path), item->id, item, 0);
 
 	if (item->type != CFG_TYPE_FLOAT)
@@ -1368,6 +1931,10 @@ float find_config_tree_float(struct cmd_context *cmd, int id, struct profile *pr
 
 	if (profile_applied && profile)
 		remove_config_tree_by_source(cmd, profile->source);
+	else if (cv) {
+		cv->kind = CONFIG_VALUE_FLOAT;
+		cv->v.f = f;
+	}
 
 	return f;
 }
@@ -1394,9 +1961,14 @@ int find_config_tree_bool(struct cmd_context *cmd, int id, struct profile *profi
 	cfg_def_item_t *item = cfg_def_get_item_p(id);
 	char path[CFG_PATH_MAX_LEN];
 	int profile_applied;
+	struct config_value *cv;
 	int b;
 
 	profile_applied = _apply_local_profile(cmd, profile);
+
+	if ((cv = _config_value(cmd, item, profile_applied)) && (cv->kind == CONFIG_VALUE_BOOL))
+		return cv->v.i;
+
 	_cfg_def_make_path(path, sizeof(path), item->id, item, 0);
 
 	if (item->type != CFG_TYPE_BOOL)
@@ -1407,6 +1979,10 @@ int find_config_tree_bool(struct cmd_context *cmd, int id, struct profile *profi
 
 	if (profile_applied && profile)
 		remove_config_tree_by_source(cmd, profile->source);
+	else if (cv) {
+		cv->kind = CONFIG_VALUE_BOOL;
+		cv->v.i = b;
+	}
 
 	return b;
 }
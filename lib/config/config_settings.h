@@ -237,6 +237,17 @@ cfg(devices_obtain_device_list_from_udev_CFG, "obtain_device_list_from_udev", de
 	"directories will be scanned fully. LVM needs to be compiled with\n"
 	"udev support for this setting to apply.\n")
 
+cfg(devices_obtain_device_list_from_sysfs_CFG, "obtain_device_list_from_sysfs", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_OBTAIN_DEVICE_LIST_FROM_SYSFS, vsn(2, 3, 11), NULL, 0, NULL,
+	"Obtain the list of available devices from sysfs.\n"
+	"Devices are enumerated with one pass over /sys/dev/block instead\n"
+	"of reading the devices/scan directories, which avoids a stat for\n"
+	"every symlink under /dev/disk. Each device is known by its kernel\n"
+	"name, or its /dev/mapper name for device-mapper devices, and other\n"
+	"names only once they are used, e.g. on the command line. Filters\n"
+	"and preferred_names matching other names, e.g. /dev/disk/by-id,\n"
+	"do not see them. This setting takes precedence over\n"
+	"obtain_device_list_from_udev.\n")
+
 cfg(devices_external_device_info_source_CFG, "external_device_info_source", devices_CFG_SECTION, 0, CFG_TYPE_STRING, DEFAULT_EXTERNAL_DEVICE_INFO_SOURCE, vsn(2, 2, 116), NULL, 0, NULL,
 	"Select an external device information source.\n"
 	"Some information may already be available in the system and LVM can\n"
@@ -269,6 +280,28 @@ cfg(devices_hints_CFG, "hints", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_
 	"    Use no hints.\n"
 	"#\n")
 
+cfg(devices_hints_binary_CFG, "hints_binary", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_HINTS_BINARY, vsn(2, 3, 11), NULL, 0, NULL,
+	"Write the hint file in a binary format.\n"
+	"The binary format has fixed size records sorted by device number,\n"
+	"which are faster to read and look up than the text format when\n"
+	"there are many PVs. Either format is read, whatever this setting.\n")
+
+cfg(devices_hints_journal_max_CFG, "hints_journal_max", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_HINTS_JOURNAL_MAX, vsn(2, 3, 11), NULL, 0, NULL,
+	"The number of hint updates kept in the hints journal.\n"
+	"When set, pvcreate and pvremove record the PVs they create or\n"
+	"remove in a journal next to the hint file, instead of clearing\n"
+	"the hint file and causing the next command to scan all devices.\n"
+	"Commands using hints apply the journal after reading the hints.\n"
+	"When the journal holds this many updates, the hint file is\n"
+	"cleared and recreated by the next scan. 0 disables the journal.\n")
+
+cfg(devices_filter_cache_CFG, "filter_cache", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_FILTER_CACHE, vsn(2, 3, 11), NULL, 0, NULL,
+	"Save the devices excluded by filters next to the hint file.\n"
+	"Commands using hints then exclude a saved device with unchanged\n"
+	"device number, size and diskseq without running the filters,\n"
+	"including those that read device data, again. The saved devices\n"
+	"are invalidated and recreated together with the hints.\n")
+
 cfg_array(devices_preferred_names_CFG, "preferred_names", devices_CFG_SECTION, CFG_ALLOW_EMPTY | CFG_DEFAULT_UNDEFINED , CFG_TYPE_STRING, NULL, vsn(1, 2, 19), NULL, 0, NULL,
 	"Select which path name to display for a block device.\n"
 	"If multiple path names exist for a block device, and LVM needs to\n"
@@ -364,6 +397,32 @@ cfg(devices_scan_lvs_CFG, "scan_lvs", devices_CFG_SECTION, 0, CFG_TYPE_BOOL, DEF
 	"an LV. The LVs are ignored using a built in device filter that\n"
 	"identifies and excludes LVs.\n")
 
+cfg(devices_scan_probe_CFG, "scan_probe", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_SCAN_PROBE, vsn(2, 3, 11), NULL, 0, NULL,
+	"Read only the first 4KiB of each device when scanning for labels.\n"
+	"The rest of the first 128KiB, which usually holds the VG metadata,\n"
+	"is then read only from devices that have an LVM label. This avoids\n"
+	"most of the scanning io on systems with many devices that are not\n"
+	"PVs, at the cost of one more read for each PV.\n")
+
+cfg(devices_scan_controller_max_io_CFG, "scan_controller_max_io", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_SCAN_CONTROLLER_MAX_IO, vsn(2, 3, 11), NULL, 0, NULL,
+	"The maximum number of concurrent label scan reads per controller.\n"
+	"Devices are grouped by the SCSI host and target, or other controller,\n"
+	"they are attached to in sysfs, and dm devices such as multipath are\n"
+	"grouped with the first of their underlying devices. Devices in\n"
+	"different groups are still scanned in parallel. Use this to avoid\n"
+	"flooding a controller that queues requests badly, e.g. an array\n"
+	"behind one HBA on shared storage. Set to 0 for no limit.\n")
+
+cfg(devices_scan_fd_window_CFG, "scan_fd_window", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_SCAN_FD_WINDOW, vsn(2, 3, 11), NULL, 0, NULL,
+	"The maximum number of devices kept open while scanning.\n"
+	"By default, a command keeps every PV it finds open until it exits,\n"
+	"and raises its open file limit to the number of devices. When set,\n"
+	"PVs are closed after their labels are scanned and reopened when\n"
+	"their metadata is read, and no more than this many are kept open\n"
+	"at once. This keeps the number of open files bounded on systems\n"
+	"with very many devices, at the cost of reading each PV's label area\n"
+	"twice. Set to 0 to keep PVs open.\n")
+
 cfg(devices_multipath_component_detection_CFG, "multipath_component_detection", devices_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_MULTIPATH_COMPONENT_DETECTION, vsn(2, 2, 89), NULL, 0, NULL,
 	"Ignore devices that are components of DM multipath devices.\n")
 
@@ -490,6 +549,12 @@ cfg(devices_issue_discards_CFG, "issue_discards", devices_CFG_SECTION, 0, CFG_TY
 	"generally do. If enabled, discards will only be issued if both the\n"
 	"storage and kernel provide support.\n")
 
+cfg(devices_discard_threads_CFG, "discard_threads", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_DISCARD_THREADS, vsn(2, 3, 11), NULL, 0, NULL,
+	"The number of discards issued at the same time with issue_discards.\n"
+	"Discards of the space freed by a command are issued once its\n"
+	"metadata is committed, split over this many threads and across\n"
+	"all PVs involved. Set to 1 to issue them one at a time.\n")
+
 cfg(devices_allow_changes_with_duplicate_pvs_CFG, "allow_changes_with_duplicate_pvs", devices_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_ALLOW_CHANGES_WITH_DUPLICATE_PVS, vsn(2, 2, 153), NULL, 0, NULL,
 	"Allow VG modification while a PV appears on multiple devices.\n"
 	"When a PV appears on multiple devices, LVM attempts to choose the\n"
@@ -568,6 +633,13 @@ cfg(allocation_raid_stripe_all_devices_CFG, "raid_stripe_all_devices", allocatio
 	"stripes to use.\n"
 	"This was the default behaviour until release 2.02.162.\n")
 
+cfg(allocation_raid_integrity_buffer_sectors_CFG, "raid_integrity_buffer_sectors", allocation_CFG_SECTION, CFG_PROFILABLE | CFG_PROFILABLE_METADATA | CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_RAID_INTEGRITY_BUFFER_SECTORS, vsn(2, 3, 11), NULL, 0, NULL,
+	"Size of the dm-integrity metadata buffer in 512-byte sectors.\n"
+	"Used for raid images when integrity is added. A larger buffer lets\n"
+	"the kernel initialize (recalculate) the integrity tags of a large\n"
+	"raid LV in bigger steps. The value is kept in the VG metadata.\n"
+	"0 uses the kernel default.\n")
+
 cfg(allocation_cache_pool_metadata_require_separate_pvs_CFG, "cache_pool_metadata_require_separate_pvs", allocation_CFG_SECTION, CFG_PROFILABLE | CFG_PROFILABLE_METADATA | CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_CACHE_POOL_METADATA_REQUIRE_SEPARATE_PVS, vsn(2, 2, 106), NULL, 0, NULL,
 	"Cache pool metadata and data will always use different PVs.\n")
 
@@ -625,6 +697,14 @@ cfg(allocation_cache_pool_max_chunks_CFG, "cache_pool_max_chunks", allocation_CF
 	"For cache target v1.9 the recommended maximumm is 1000000 chunks.\n"
 	"Using cache pool with more chunks may degrade cache performance.\n")
 
+cfg(allocation_cache_chunk_size_sample_time_CFG, "cache_chunk_size_sample_time", allocation_CFG_SECTION, CFG_PROFILABLE | CFG_PROFILABLE_METADATA | CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_CACHE_CHUNK_SIZE_SAMPLE_TIME, vsn(2, 3, 11), NULL, 0, NULL,
+	"Seconds to sample the I/O of an active LV before attaching a cachevol.\n"
+	"When set and no chunk size is given, lvconvert --type cache --cachevol\n"
+	"watches the LV with a temporary dm-stats region for this long and\n"
+	"picks the cache chunk size from the average I/O size and from how\n"
+	"concentrated the I/O is. The cache metadata size follows from it.\n"
+	"0 disables sampling.\n")
+
 cfg(allocation_thin_pool_metadata_require_separate_pvs_CFG, "thin_pool_metadata_require_separate_pvs", allocation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_THIN_POOL_METADATA_REQUIRE_SEPARATE_PVS, vsn(2, 2, 89), NULL, 0, NULL,
 	"Thin pool metadata and data will always use different PVs.\n")
 
@@ -853,6 +933,14 @@ cfg(log_level_CFG, "level", log_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_LOGLEVEL,
 	"There are 6 syslog-like log levels currently in use: 2 to 7 inclusive.\n"
 	"7 is the most verbose (LOG_DEBUG).\n")
 
+cfg(log_buffer_size_CFG, "buffer_size", log_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_LOG_BUFFER_SIZE, vsn(2, 3, 11), NULL, 0, NULL,
+	"Size in KiB of an in-memory buffer for log file messages.\n"
+	"When non-zero, messages for the log file are kept in a ring\n"
+	"buffer and written out when an error is logged or the command\n"
+	"finishes, which keeps debug logging from slowing commands down.\n"
+	"When the buffer fills, the oldest messages are dropped.\n"
+	"The buffer is not used with LVM_LOG_FILE_MAX_LINES.\n")
+
 cfg(log_indent_CFG, "indent", log_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_INDENT, vsn(1, 0, 0), NULL, 0, NULL,
 	"Indent messages according to their severity.\n")
 
@@ -866,6 +954,12 @@ cfg(log_prefix_CFG, "prefix", log_CFG_SECTION, CFG_ALLOW_EMPTY, CFG_TYPE_STRING,
 	"To make the messages look similar to the original LVM tools use:\n"
 	"indent = 0, command_names = 1, prefix = \" -- \"\n")
 
+cfg(log_io_stats_CFG, "io_stats", log_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_IO_STATS, vsn(2, 3, 11), NULL, 0, NULL,
+	"Print device I/O statistics when the command finishes.\n"
+	"Shows cache hits and misses, the number and size of reads and\n"
+	"writes issued, and how long they took.  The same summary is\n"
+	"always logged at debug level with the io debug class.\n")
+
 cfg(log_activation_CFG, "activation", log_CFG_SECTION, 0, CFG_TYPE_BOOL, 0, vsn(1, 0, 0), NULL, 0, NULL,
 	"Log messages during activation.\n"
 	"Don't use this in low memory situations (can deadlock).\n")
@@ -909,6 +1003,15 @@ cfg(backup_retain_min_CFG, "retain_min", backup_CFG_SECTION, 0, CFG_TYPE_INT, DE
 cfg(backup_retain_days_CFG, "retain_days", backup_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_ARCHIVE_DAYS, vsn(1, 0, 0), NULL, 0, NULL,
 	"Minimum number of days to keep archive files.\n")
 
+cfg(backup_compress_archive_CFG, "compress_archive", backup_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_COMPRESS_ARCHIVE, vsn(2, 3, 11), NULL, 0, NULL,
+	"Write archive files in a compressed encoding.\n"
+	"Archives of large VGs changed by frequent commands take much\n"
+	"space and time to write. When enabled, archive files are\n"
+	"compressed with zlib like metadata/compress_metadata, if that\n"
+	"makes them smaller. vgcfgrestore reads them as usual, but they\n"
+	"can only be read by versions of LVM that support it. Requires\n"
+	"LVM to be built with --enable-metadata-compression.\n")
+
 cfg(shell_history_size_CFG, "history_size", shell_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_MAX_HISTORY, vsn(1, 0, 0), NULL, 0, NULL,
 	"Number of lines of history to store in ~/.lvm_history.\n")
 
@@ -1093,6 +1196,14 @@ cfg(global_event_activation_CFG, "event_activation", global_CFG_SECTION, CFG_DEF
 	"When event_activation is disabled, the system will generally run\n"
 	"a direct activation command to activate LVs in complete VGs.\n")
 
+cfg(global_event_activation_coalesce_ms_CFG, "event_activation_coalesce_ms", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_EVENT_ACTIVATION_COALESCE_MS, vsn(2, 3, 11), NULL, 0, NULL,
+	"Coalesce event based activation for this many milliseconds.\n"
+	"When many devices appear at once, e.g. during boot, each device\n"
+	"event runs its own pvscan. With this set, the first pvscan waits\n"
+	"for this long, collecting the devices of the pvscans that follow,\n"
+	"which exit immediately. It then scans all of the devices together\n"
+	"and activates each complete VG once. 0 disables coalescing.\n")
+
 cfg(global_use_lvmetad_CFG, "use_lvmetad", global_CFG_SECTION, 0, CFG_TYPE_BOOL, 0, vsn(2, 2, 93), 0, vsn(2, 3, 0), NULL,
 	"This setting is no longer used.\n")
 
@@ -1102,6 +1213,18 @@ cfg(global_lvmetad_update_wait_time_CFG, "lvmetad_update_wait_time", global_CFG_
 cfg(global_use_aio_CFG, "use_aio", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_USE_AIO, vsn(2, 2, 183), NULL, 0, NULL,
 	"Use async I/O when reading and writing devices.\n")
 
+cfg(global_use_io_uring_CFG, "use_io_uring", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_USE_IO_URING, vsn(2, 3, 11), NULL, 0, NULL,
+	"Use io_uring for async I/O when the kernel supports it.\n"
+	"Only applies when use_aio is enabled. If io_uring cannot be\n"
+	"set up, libaio is used instead.\n")
+
+cfg(global_io_threads_CFG, "io_threads", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_IO_THREADS, vsn(2, 3, 11), NULL, 0, NULL,
+	"The number of threads used for sync I/O when async I/O is not used.\n"
+	"When use_aio is disabled, or async I/O cannot be set up (e.g. the\n"
+	"system aio-max-nr limit is reached), device reads and writes are\n"
+	"done by this many threads so that several of them can be in flight.\n"
+	"Set to 0 to do sync I/O one request at a time.\n")
+
 cfg(global_use_lvmlockd_CFG, "use_lvmlockd", global_CFG_SECTION, 0, CFG_TYPE_BOOL, 0, vsn(2, 2, 124), NULL, 0, NULL,
 	"Use lvmlockd for locking among hosts using LVM on shared storage.\n"
 	"Applicable only if LVM is compiled with lockd support in which\n"
@@ -1259,18 +1382,27 @@ cfg(global_use_lvmpolld_CFG, "use_lvmpolld", global_CFG_SECTION, 0, CFG_TYPE_BOO
 	"commands will supervise long running operations by forking themselves.\n"
 	"Applicable only if LVM is compiled with lvmpolld support.\n")
 
+cfg(global_use_lvmcached_CFG, "use_lvmcached", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_USE_LVMCACHED, vsn(2, 3, 11), NULL, 0, NULL,
+	"Take VG metadata from lvmcached when it has a copy.\n"
+	"lvmcached keeps the metadata text LVM commands read from disk.\n"
+	"A command that finds an mda header on disk describing metadata the\n"
+	"daemon has, by checksum and size, takes the text from the daemon\n"
+	"rather than reading it again. When the daemon is not running, or\n"
+	"has no matching copy, metadata is read from disk as usual.\n"
+	"Applicable only if LVM is compiled with lvmcached support.\n")
+
 cfg(global_notify_dbus_CFG, "notify_dbus", global_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_NOTIFY_DBUS, vsn(2, 2, 145), NULL, 0, NULL,
 	"Enable D-Bus notification from LVM commands.\n"
 	"When enabled, an LVM command that changes PVs, changes VG metadata,\n"
 	"or changes the activation state of an LV will send a notification.\n")
 
 cfg(global_io_memory_size_CFG, "io_memory_size", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_IO_MEMORY_SIZE_KB, vsn(2, 3, 2), NULL, 0, NULL,
-	"The amount of memory in KiB that LVM allocates to perform disk io.\n"
-	"LVM performance may benefit from more io memory when there are many\n"
-	"disks or VG metadata is large. Increasing this size may be necessary\n"
-	"when a single copy of VG metadata is larger than the current setting.\n"
-	"This value should usually not be decreased from the default; setting\n"
-	"it too low can result in lvm failing to read VGs.\n")
+	"The maximum memory in KiB that LVM uses to cache devices for io.\n"
+	"LVM starts with a small io cache and grows it by one block for each\n"
+	"device it scans, up to this size. LVM performance may benefit from\n"
+	"more io memory when there are many disks. The cache is grown beyond\n"
+	"this size when VG metadata needs it, so it does not need to be\n"
+	"raised for large metadata.\n")
 
 cfg(activation_udev_sync_CFG, "udev_sync", activation_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_UDEV_SYNC, vsn(2, 2, 51), NULL, 0, NULL,
 	"Use udev notifications to synchronize udev and LVM.\n"
@@ -1282,6 +1414,16 @@ cfg(activation_udev_sync_CFG, "udev_sync", activation_CFG_SECTION, 0, CFG_TYPE_B
 	"running, and LVM processes are waiting for udev, run the command\n"
 	"'dmsetup udevcomplete_all' to wake them up.\n")
 
+cfg(activation_udev_sync_deferred_CFG, "udev_sync_deferred", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_UDEV_SYNC_DEFERRED, vsn(2, 3, 11), NULL, 0, NULL,
+	"Wait for udev once at the end of an activation command.\n"
+	"By default, vgchange -ay and pvscan autoactivation wait for udev to\n"
+	"process the devices of each VG before moving on to the next VG.\n"
+	"When enabled, the devices of all VGs are put on one udev cookie that\n"
+	"is waited for once when the command finishes. A VG lock may then be\n"
+	"released before the device nodes of the VG exist.\n"
+	"With udev_sync disabled, LVM does not wait at all, and with\n"
+	"udev_rules also disabled, LVM creates the device nodes and symlinks.\n")
+
 cfg(activation_udev_rules_CFG, "udev_rules", activation_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_UDEV_RULES, vsn(2, 2, 57), NULL, 0, NULL,
 	"Use udev rules to manage LV device nodes and symlinks.\n"
 	"When disabled, LVM will manage the device nodes and symlinks for\n"
@@ -1300,6 +1442,14 @@ cfg(activation_retry_deactivation_CFG, "retry_deactivation", activation_CFG_SECT
 	"failing. This may happen because a process run from a quick udev rule\n"
 	"temporarily opened the device.\n")
 
+cfg(activation_deferred_remove_CFG, "deferred_remove", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_DEFERRED_REMOVE, vsn(2, 3, 11), NULL, 0, NULL,
+	"Use deferred removal when deactivating an open LV.\n"
+	"When enabled, an LV that is open but neither mounted nor used by\n"
+	"another device is not waited for as retry_deactivation would.\n"
+	"Instead, the kernel removes the device when the last opener closes\n"
+	"it, and the command does not block. Devices that the LV itself uses\n"
+	"are left active until a later deactivation finds them unused.\n")
+
 cfg(activation_missing_stripe_filler_CFG, "missing_stripe_filler", activation_CFG_SECTION, CFG_ADVANCED, CFG_TYPE_STRING, DEFAULT_STRIPE_FILLER, vsn(1, 0, 0), NULL, 0, NULL,
 	"Method to fill missing stripes when activating an incomplete LV.\n"
 	"Using 'error' will make inaccessible parts of the device return I/O\n"
@@ -1423,6 +1573,14 @@ cfg(activation_raid_region_size_CFG, "raid_region_size", activation_CFG_SECTION,
 	"The value is rounded down to a power of two if necessary, and\n"
 	"is ignored if it is not a multiple of the machine memory page size.\n")
 
+cfg(activation_raid_recovery_bandwidth_CFG, "raid_recovery_bandwidth", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_RAID_RECOVERY_BANDWIDTH, vsn(2, 3, 11), NULL, 0, NULL,
+	"Recovery bandwidth in KiB/sec per device shared by raid LVs.\n"
+	"When set, each raid LV without its own --maxrecoveryrate is loaded\n"
+	"with a max recovery rate of this value divided by the number of raid\n"
+	"LVs with images on the same PVs. Resync and recovery of many LVs\n"
+	"after a repair or --resync then leave bandwidth for other I/O.\n"
+	"0 leaves recovery unlimited.\n")
+
 cfg(activation_error_when_full_CFG, "error_when_full", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_ERROR_WHEN_FULL, vsn(2, 2, 115), NULL, 0, NULL,
 	"Return errors if a thin pool runs out of space.\n"
 	"The --errorwhenfull option overrides this setting.\n"
@@ -1618,6 +1776,14 @@ cfg(activation_polling_interval_CFG, "polling_interval", activation_CFG_SECTION,
 	"is only one thing to wait for, there are no progress reports, but\n"
 	"the process is awoken immediately once the operation is complete.\n")
 
+cfg(activation_pvmove_max_running_segments_CFG, "pvmove_max_running_segments", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_PVMOVE_MAX_RUNNING_SEGMENTS, vsn(2, 3, 11), NULL, 0, NULL,
+	"The number of pvmove segments copied at the same time.\n"
+	"pvmove copies the extents of each moved LV segment through its own\n"
+	"mirror. When there are several segments to move, up to this many\n"
+	"of them are mirrored in parallel and the next ones start when all\n"
+	"of them are in sync. Use a higher value to keep the storage busy\n"
+	"when moving many LVs or many small segments.\n")
+
 cfg(activation_auto_set_activation_skip_CFG, "auto_set_activation_skip", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_AUTO_SET_ACTIVATION_SKIP, vsn(2,2,99), NULL, 0, NULL,
 	"Set the activation skip flag on new thin snapshot LVs.\n"
 	"The --setactivationskip option overrides this setting.\n"
@@ -1675,6 +1841,38 @@ cfg(metadata_lvs_history_retention_time_CFG, "lvs_history_retention_time", metad
 	"historical logical volume is automatically destroyed.\n"
 	"A value of 0 disables this feature.\n")
 
+cfg(metadata_compress_metadata_CFG, "compress_metadata", metadata_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_COMPRESS_METADATA, vsn(2, 3, 11), NULL, 0, NULL,
+	"Write VG metadata to disk in a compressed encoding.\n"
+	"Metadata for VGs with thousands of LVs can fill much of the\n"
+	"metadata area, making every commit and read large. When enabled,\n"
+	"metadata is compressed with zlib before it is written, if that\n"
+	"makes it smaller. Compressed metadata is flagged in the metadata\n"
+	"area header and can only be read by versions of LVM that support\n"
+	"it. Backup files are not compressed, archive files follow\n"
+	"backup/compress_archive. Requires LVM to be built with\n"
+	"--enable-metadata-compression.\n")
+
+cfg(metadata_delta_commits_CFG, "delta_commits", metadata_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_DELTA_COMMITS, vsn(2, 3, 11), NULL, 0, NULL,
+	"Write small VG changes as deltas against the last full metadata.\n"
+	"When a command changes only a few LVs in a large VG, LVM can write\n"
+	"just those LVs, recording where the last full copy of the metadata\n"
+	"(the checkpoint) is in the metadata area, instead of the whole text.\n"
+	"The value is the number of consecutive deltas written before a new\n"
+	"full checkpoint. A full copy is also written whenever the delta\n"
+	"would not be much smaller, the metadata areas of the VG differ, or\n"
+	"the checkpoint would be overwritten. Delta metadata is flagged in\n"
+	"the metadata area header and can only be read by versions of LVM\n"
+	"that support it. A value of 0 disables this feature.\n")
+
+cfg(metadata_validate_changed_only_CFG, "validate_changed_only", metadata_CFG_SECTION, CFG_ADVANCED | CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_VALIDATE_CHANGED_ONLY, vsn(2, 3, 11), NULL, 0, NULL,
+	"Validate only the changed LVs when a command changes LV properties.\n"
+	"Before each metadata write the whole VG is checked for internal\n"
+	"consistency, which takes a large share of the write time in VGs\n"
+	"with many LVs. Commands that change only properties of some LVs,\n"
+	"like lvchange --addtag, mark those LVs, and only they, the LVs they\n"
+	"use and the LVs using them are checked. Disable to always check\n"
+	"the whole VG, e.g. when debugging. vgck always checks the whole VG.\n")
+
 cfg(metadata_pvmetadatacopies_CFG, "pvmetadatacopies", metadata_CFG_SECTION, CFG_ADVANCED | CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_PVMETADATACOPIES, vsn(1, 0, 0), NULL, 0, NULL,
 	"Number of copies of metadata to store on each PV.\n"
 	"The --pvmetadatacopies option overrides this setting.\n"
@@ -1744,7 +1942,10 @@ cfg(report_output_format_CFG, "output_format", report_CFG_SECTION, CFG_PROFILABL
 	"    one report per command, each report is prefixed with report's\n"
 	"    name for identification.\n"
 	"  json\n"
-	"    JSON format.\n")
+	"    JSON format.\n"
+	"  binary\n"
+	"    Typed values by column with a schema header, for programs\n"
+	"    reading reports without parsing text.\n")
 
 cfg(report_compact_output_CFG, "compact_output", report_CFG_SECTION, CFG_PROFILABLE | CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_REP_COMPACT_OUTPUT, vsn(2, 2, 115), NULL, 0, NULL,
 	"Do not print empty values for all report fields.\n"
@@ -2049,6 +2250,14 @@ cfg(report_two_word_unknown_device_CFG, "two_word_unknown_device", report_CFG_SE
 	"Use the two words 'unknown device' in place of '[unknown]'.\n"
 	"This is displayed when the device for a PV is not known.\n")
 
+cfg(report_read_without_lock_CFG, "read_without_lock", report_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_REP_READ_WITHOUT_LOCK, vsn(2, 3, 11), NULL, 0, NULL,
+	"Reporting and display commands read VG metadata without the VG lock.\n"
+	"Commands such as lvs, vgs and pvs then do not wait while another\n"
+	"command holds the VG write lock. The metadata read is checked to be\n"
+	"intact and the same on all metadata areas of the VG; if it is not,\n"
+	"the command waits for the lock and reads the VG again. The report\n"
+	"may show the state from before a change that is still in progress.\n")
+
 cfg(dmeventd_mirror_library_CFG, "mirror_library", dmeventd_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_STRING, DEFAULT_DMEVENTD_MIRROR_LIB, vsn(1, 2, 3), NULL, 0, NULL,
 	"The library dmeventd uses when monitoring a mirror device.\n"
 	"libdevmapper-event-lvm2mirror.so attempts to recover from\n"
@@ -38,11 +38,13 @@
 
 #define DEFAULT_ARCHIVE_DAYS 30
 #define DEFAULT_ARCHIVE_NUMBER 10
+#define DEFAULT_COMPRESS_ARCHIVE 0
 
 #define DEFAULT_DEV_DIR "/dev"
 #define DEFAULT_PROC_DIR "/proc"
 #define DEFAULT_SYSTEM_ID_SOURCE "none"
 #define DEFAULT_OBTAIN_DEVICE_LIST_FROM_UDEV 1
+#define DEFAULT_OBTAIN_DEVICE_LIST_FROM_SYSFS 0
 #define DEFAULT_EXTERNAL_DEVICE_INFO_SOURCE "none"
 #define DEFAULT_SYSFS_SCAN 1
 #define DEFAULT_MD_COMPONENT_DETECTION 1
@@ -55,6 +57,8 @@
 #define DEFAULT_DATA_ALIGNMENT_OFFSET_DETECTION 1
 #define DEFAULT_DATA_ALIGNMENT_DETECTION 1
 #define DEFAULT_ISSUE_DISCARDS 0
+#define DEFAULT_DISCARD_THREADS 8
+#define DISCARD_THREADS_MAX 64
 #define DEFAULT_PV_MIN_SIZE_KB 2048
 #define DEFAULT_ALLOW_CHANGES_WITH_DUPLICATE_PVS 0
 
@@ -71,6 +75,10 @@
 #define DEFAULT_LVDISPLAY_SHOWS_FULL_DEVICE_PATH 0
 #define DEFAULT_UNKNOWN_DEVICE_NAME "[unknown]"
 #define DEFAULT_USE_AIO 1
+#define DEFAULT_USE_IO_URING 1
+#define DEFAULT_IO_THREADS 4
+#define DEFAULT_EVENT_ACTIVATION_COALESCE_MS 0
+#define DEFAULT_IO_STATS 0
 
 #define DEFAULT_SANLOCK_LV_EXTEND_MB 256
 
@@ -148,6 +156,8 @@
 #define DEFAULT_CACHE_POOL_MAX_CHUNKS 1000000
 #define DEFAULT_CACHE_POOL_MIN_METADATA_SIZE 2048  /* KB */
 #define DEFAULT_CACHE_POOL_MAX_METADATA_SIZE (16 * 1024 * 1024)  /* KB */
+#define DEFAULT_CACHE_CHUNK_SIZE_SAMPLE_TIME 0 /* Seconds */
+#define DEFAULT_RAID_INTEGRITY_BUFFER_SECTORS 0
 #define DEFAULT_CACHE_POLICY "mq"
 #define DEFAULT_CACHE_METADATA_FORMAT CACHE_METADATA_FORMAT_UNSELECTED /* Autodetect */
 #define DEFAULT_CACHE_MODE "writethrough"
@@ -191,6 +201,9 @@
 
 #define DEFAULT_STRIPESIZE 64	/* KB */
 #define DEFAULT_RECORD_LVS_HISTORY 0
+#define DEFAULT_COMPRESS_METADATA 0
+#define DEFAULT_DELTA_COMMITS 0
+#define DEFAULT_VALIDATE_CHANGED_ONLY 1
 #define DEFAULT_LVS_HISTORY_RETENTION_TIME 0
 #define DEFAULT_PVMETADATAIGNORE 0
 #define DEFAULT_PVMETADATACOPIES 1
@@ -199,9 +212,12 @@
 #define DEFAULT_READ_AHEAD "auto"
 #define DEFAULT_UDEV_RULES 1
 #define DEFAULT_UDEV_SYNC 1
+#define DEFAULT_UDEV_SYNC_DEFERRED 0
 #define DEFAULT_NOTIFY_DBUS 1
+#define DEFAULT_USE_LVMCACHED 0
 #define DEFAULT_VERIFY_UDEV_OPERATIONS 0
 #define DEFAULT_RETRY_DEACTIVATION 1
+#define DEFAULT_DEFERRED_REMOVE 0
 #define DEFAULT_ACTIVATION_CHECKS 0
 #define DEFAULT_EXTENT_SIZE 4096	/* In KB */
 #define DEFAULT_MAX_PV 0
@@ -224,6 +240,7 @@
 #define DEFAULT_VERBOSE 0
 #define DEFAULT_SILENT 0
 #define DEFAULT_LOGLEVEL 0
+#define DEFAULT_LOG_BUFFER_SIZE 0	/* KiB */
 #define DEFAULT_INDENT 0
 #define DEFAULT_ABORT_ON_INTERNAL_ERRORS 0
 #define DEFAULT_UNITS "r"
@@ -249,7 +266,9 @@
 #define DEFAULT_USE_LINEAR_TARGET 1
 #define DEFAULT_STRIPE_FILLER "error"
 #define DEFAULT_RAID_REGION_SIZE   2048	/* KB */
+#define DEFAULT_RAID_RECOVERY_BANDWIDTH 0	/* KiB/sec */
 #define DEFAULT_INTERVAL 15
+#define DEFAULT_PVMOVE_MAX_RUNNING_SEGMENTS 1
 
 #define DEFAULT_MAX_HISTORY 100
 
@@ -262,6 +281,7 @@
 #define DEFAULT_REP_QUOTED 1
 #define DEFAULT_REP_SEPARATOR " "
 #define DEFAULT_REP_LIST_ITEM_SEPARATOR ","
+#define DEFAULT_REP_READ_WITHOUT_LOCK 0
 #define DEFAULT_TIME_FORMAT "%Y-%m-%d %T %z"
 
 #define DEFAULT_REP_OUTPUT_FORMAT "basic"
@@ -314,8 +334,14 @@
 #define DEFAULT_VDO_POOL_AUTOEXTEND_PERCENT 20
 
 #define DEFAULT_SCAN_LVS 0
+#define DEFAULT_SCAN_PROBE 0
+#define DEFAULT_SCAN_CONTROLLER_MAX_IO 0
+#define DEFAULT_SCAN_FD_WINDOW 0
 
 #define DEFAULT_HINTS "all"
+#define DEFAULT_HINTS_BINARY 0
+#define DEFAULT_HINTS_JOURNAL_MAX 0
+#define DEFAULT_FILTER_CACHE 0
 
 #define DEFAULT_IO_MEMORY_SIZE_KB 8192
 
@@ -251,3 +251,140 @@ bad:
 
 	return NULL;
 }
+
+static struct dm_hash_table *_str_ids = NULL;
+static uint32_t _str_ids_count = 0;
+
+/* Returns 0 when str was never interned and intern is unset. */
+static uint32_t _str_id(const char *str, int intern)
+{
+	uint32_t id;
+
+	if (_str_ids && (id = (uint32_t)(uintptr_t) dm_hash_lookup(_str_ids, str)))
+		return id;
+
+	if (!intern)
+		return 0;
+
+	if (!_str_ids && !(_str_ids = dm_hash_create(128)))
+		return_0;
+
+	id = ++_str_ids_count;
+	if (!dm_hash_insert(_str_ids, str, (void *)(uintptr_t) id))
+		return_0;
+
+	return id;
+}
+
+static int _cmp_id(const void *a, const void *b)
+{
+	uint32_t id1 = *(const uint32_t *) a, id2 = *(const uint32_t *) b;
+
+	return (id1 > id2) - (id1 < id2);
+}
+
+static int _str_set_add_list(struct str_set *set, const struct dm_list *sll)
+{
+	struct dm_str_list *sl;
+
+	dm_list_iterate_items(sl, sll)
+		if (!(set->ids[set->count++] = _str_id(sl->str, 1)))
+			return_0;
+
+	return 1;
+}
+
+/*
+ * Build a set holding the items of sll and, if given, sll2.
+ */
+struct str_set *str_set_create(struct dm_pool *mem, const struct dm_list *sll,
+			       const struct dm_list *sll2)
+{
+	struct str_set *set;
+	unsigned size = dm_list_size(sll) + (sll2 ? dm_list_size(sll2) : 0);
+	unsigned i, j;
+
+	if (!(set = dm_pool_alloc(mem, sizeof(*set) + size * sizeof(set->ids[0])))) {
+		log_errno(ENOMEM, "str_set allocation failed");
+		return NULL;
+	}
+
+	set->count = 0;
+	if (!_str_set_add_list(set, sll) ||
+	    (sll2 && !_str_set_add_list(set, sll2))) {
+		dm_pool_free(mem, set);
+		return NULL;
+	}
+
+	qsort(set->ids, set->count, sizeof(set->ids[0]), _cmp_id);
+
+	/* Drop duplicates */
+	for (i = j = 0; i < set->count; i++)
+		if (!j || (set->ids[j - 1] != set->ids[i]))
+			set->ids[j++] = set->ids[i];
+	set->count = j;
+
+	return set;
+}
+
+static int _str_set_has_id(const struct str_set *set, uint32_t id)
+{
+	return id && bsearch(&id, set->ids, set->count, sizeof(set->ids[0]), _cmp_id);
+}
+
+/*
+ * Is item in set?
+ */
+int str_set_match_item(const struct str_set *set, const char *str)
+{
+	return _str_set_has_id(set, _str_id(str, 0));
+}
+
+/*
+ * Is at least one item in both sets?
+ */
+int str_set_match_set(const struct str_set *set, const struct str_set *set2)
+{
+	unsigned i = 0, j = 0;
+
+	while ((i < set->count) && (j < set2->count)) {
+		if (set->ids[i] == set2->ids[j])
+			return 1;
+		if (set->ids[i] < set2->ids[j])
+			i++;
+		else
+			j++;
+	}
+
+	return 0;
+}
+
+/*
+ * Is at least one item of the list in the set?
+ * If tag_matched is non-NULL, it is set to the first list item that matched.
+ */
+int str_set_match_list(const struct str_set *set, const struct dm_list *sll, const char **tag_matched)
+{
+	struct dm_str_list *sl;
+
+	if (!set->count)
+		return 0;
+
+	dm_list_iterate_items(sl, sll)
+		if (str_set_match_item(set, sl->str)) {
+			if (tag_matched)
+				*tag_matched = sl->str;
+			return 1;
+		}
+
+	return 0;
+}
+
+void str_set_intern_destroy(void)
+{
+	if (_str_ids) {
+		dm_hash_destroy(_str_ids);
+		_str_ids = NULL;
+	}
+	_str_ids_count = 0;
+}
@@ -34,4 +34,22 @@ int str_list_dup(struct dm_pool *mem, struct dm_list *sllnew,
 char *str_list_to_str(struct dm_pool *mem, const struct dm_list *list, const char *delim);
 struct dm_list *str_to_str_list(struct dm_pool *mem, const char *str, const char *delim, int ignore_multiple_delim);
 
+/*
+ * Set of strings interned to process-wide IDs and kept sorted, so
+ * matching against it is integer comparison instead of strcmp walks.
+ * Build one for a list that is matched repeatedly, e.g. tags given
+ * on the command line or in a config setting.
+ */
+struct str_set {
+	unsigned count;
+	uint32_t ids[];
+};
+
+struct str_set *str_set_create(struct dm_pool *mem, const struct dm_list *sll,
+			       const struct dm_list *sll2);
+int str_set_match_item(const struct str_set *set, const char *str);
+int str_set_match_set(const struct str_set *set, const struct str_set *set2);
+int str_set_match_list(const struct str_set *set, const struct dm_list *sll, const char **tag_matched);
+void str_set_intern_destroy(void);
+
 #endif
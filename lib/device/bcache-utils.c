@@ -64,10 +64,12 @@ bool bcache_read_bytes(struct bcache *cache, int di, uint64_t start, size_t len,
 	byte_range_to_block_range(cache, start, len, &bb, &be);
 
 	for (; bb != be; bb++) {
-        	if (!bcache_get(cache, di, bb, 0, &b))
+		size_t blen = _min(block_size - block_offset, len);
+		sector_t nr_sectors = (block_offset + blen + (1 << SECTOR_SHIFT) - 1) >> SECTOR_SHIFT;
+
+		if (!bcache_get_head(cache, di, bb, nr_sectors, 0, &b))
 			return false;
 
-		size_t blen = _min(block_size - block_offset, len);
 		memcpy(data, ((unsigned char *) b->data) + block_offset, blen);
 		bcache_put(b);
 
@@ -79,6 +81,58 @@ bool bcache_read_bytes(struct bcache *cache, int di, uint64_t start, size_t len,
 	return true;
 }
 
+bool bcache_walk_bytes(struct bcache *cache, int di, uint64_t start, size_t len,
+		       bcache_bytes_fn fn, void *context)
+{
+	struct block *b;
+	block_address bb, be;
+	uint64_t block_size = bcache_block_sectors(cache) << SECTOR_SHIFT;
+	uint64_t block_offset = start % block_size;
+	bool r;
+
+	bcache_prefetch_bytes(cache, di, start, len);
+
+	byte_range_to_block_range(cache, start, len, &bb, &be);
+
+	for (; bb != be; bb++) {
+		size_t blen = _min(block_size - block_offset, len);
+		sector_t nr_sectors = (block_offset + blen + (1 << SECTOR_SHIFT) - 1) >> SECTOR_SHIFT;
+
+		if (!bcache_get_head(cache, di, bb, nr_sectors, 0, &b))
+			return false;
+
+		r = fn(context, ((unsigned char *) b->data) + block_offset, blen);
+		bcache_put(b);
+
+		if (!r)
+			return false;
+
+		block_offset = 0;
+		len -= blen;
+	}
+
+	return true;
+}
+
+bool bcache_get_bytes(struct bcache *cache, int di, uint64_t start, size_t len,
+		      struct block **result, const void **data)
+{
+	uint64_t block_size = bcache_block_sectors(cache) << SECTOR_SHIFT;
+	uint64_t block_offset = start % block_size;
+
+	if (!len || (block_offset + len > block_size))
+		return false;
+
+	if (!bcache_get_head(cache, di, start / block_size,
+			     (block_offset + len + (1 << SECTOR_SHIFT) - 1) >> SECTOR_SHIFT,
+			     0, result))
+		return false;
+
+	*data = ((unsigned char *) (*result)->data) + block_offset;
+
+	return true;
+}
+
 bool bcache_invalidate_bytes(struct bcache *cache, int di, uint64_t start, size_t len)
 {
 	block_address bb, be;
@@ -17,9 +17,12 @@
 #include "base/data-struct/radix-tree.h"
 #include "lib/log/lvm-logging.h"
 #include "lib/log/log.h"
+#include "lib/misc/crc.h"
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdbool.h>
@@ -30,12 +33,31 @@
 #include <unistd.h>
 #include <linux/fs.h>
 #include <sys/user.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
 
 #define SECTOR_SHIFT 9L
 
 #define FD_TABLE_INC 1024
 static int _fd_table_size;
 static int *_fd_table;
+static struct bcache_di_stats *_di_stats;
+
+static struct bcache_di_stats *_get_di_stats(int di)
+{
+	if ((di < 0) || (di >= _fd_table_size) || !_di_stats)
+		return NULL;
+
+	return _di_stats + di;
+}
 
 
 //----------------------------------------------------------------
@@ -60,6 +82,7 @@ static inline struct dm_list *_list_pop(struct dm_list *head)
 struct control_block {
 	struct dm_list list;
 	void *context;
+	uint64_t nbytes;
 	struct iocb cb;
 };
 
@@ -157,6 +180,135 @@ static int _last_byte_di;
 static uint64_t _last_byte_offset;
 static int _last_byte_sector_size;
 
+/*
+ * If bcache block goes past where lvm wants to write, then clamp it.
+ */
+static bool _limit_write(enum dir d, int di, uint64_t offset, uint64_t *nbytes_p)
+{
+	uint64_t nbytes = *nbytes_p;
+	uint64_t limit_nbytes;
+	uint64_t orig_nbytes;
+	uint64_t extra_nbytes = 0;
+
+	if ((d != DIR_WRITE) || !_last_byte_offset || (di != _last_byte_di))
+		return true;
+
+	if (offset > _last_byte_offset) {
+		log_error("Limit write at %llu len %llu beyond last byte %llu",
+			  (unsigned long long)offset,
+			  (unsigned long long)nbytes,
+			  (unsigned long long)_last_byte_offset);
+		return false;
+	}
+
+	/*
+	 * If the bcache block offset+len goes beyond where lvm is
+	 * intending to write, then reduce the len being written
+	 * (which is the bcache block size) so we don't write past
+	 * the limit set by lvm.  If after applying the limit, the
+	 * resulting size is not a multiple of the sector size (512
+	 * or 4096) then extend the reduced size to be a multiple of
+	 * the sector size (we don't want to write partial sectors.)
+	 */
+	if (offset + nbytes > _last_byte_offset) {
+		limit_nbytes = _last_byte_offset - offset;
+
+		if (limit_nbytes % _last_byte_sector_size) {
+			extra_nbytes = _last_byte_sector_size - (limit_nbytes % _last_byte_sector_size);
+
+			/*
+			 * adding extra_nbytes to the reduced nbytes (limit_nbytes)
+			 * should make the final write size a multiple of the
+			 * sector size.  This should never result in a final size
+			 * larger than the bcache block size (as long as the bcache
+			 * block size is a multiple of the sector size).
+			 */
+			if (limit_nbytes + extra_nbytes > nbytes) {
+				log_warn("Skip extending write at %llu len %llu limit %llu extra %llu sector_size %llu",
+					 (unsigned long long)offset,
+					 (unsigned long long)nbytes,
+					 (unsigned long long)limit_nbytes,
+					 (unsigned long long)extra_nbytes,
+					 (unsigned long long)_last_byte_sector_size);
+				extra_nbytes = 0;
+			}
+		}
+
+		orig_nbytes = nbytes;
+
+		if (extra_nbytes) {
+			log_debug("Limit write at %llu len %llu to len %llu rounded to %llu",
+				  (unsigned long long)offset,
+				  (unsigned long long)nbytes,
+				  (unsigned long long)limit_nbytes,
+				  (unsigned long long)(limit_nbytes + extra_nbytes));
+			nbytes = limit_nbytes + extra_nbytes;
+		} else {
+			log_debug("Limit write at %llu len %llu to len %llu",
+				  (unsigned long long)offset,
+				  (unsigned long long)nbytes,
+				  (unsigned long long)limit_nbytes);
+			nbytes = limit_nbytes;
+		}
+
+		/*
+		 * This shouldn't happen, the reduced+extended
+		 * nbytes value should never be larger than the
+		 * bcache block size.
+		 */
+		if (nbytes > orig_nbytes) {
+			log_error("Invalid adjusted write at %llu len %llu adjusted %llu limit %llu extra %llu sector_size %llu",
+				  (unsigned long long)offset,
+				  (unsigned long long)orig_nbytes,
+				  (unsigned long long)nbytes,
+				  (unsigned long long)limit_nbytes,
+				  (unsigned long long)extra_nbytes,
+				  (unsigned long long)_last_byte_sector_size);
+			return false;
+		}
+	}
+
+	*nbytes_p = nbytes;
+	return true;
+}
+
+static uint64_t _vec_bytes(const struct iovec *vec, unsigned nr)
+{
+	uint64_t nbytes = 0;
+	unsigned i;
+
+	for (i = 0; i < nr; i++)
+		nbytes += vec[i].iov_len;
+
+	return nbytes;
+}
+
+/*
+ * Vectored version of _limit_write(), trims the iovecs so they end
+ * where lvm wants the write to end.
+ */
+static bool _limit_write_vec(enum dir d, int di, uint64_t offset,
+			     struct iovec *vec, unsigned *nr, uint64_t *nbytes_p)
+{
+	uint64_t nbytes = _vec_bytes(vec, *nr);
+	uint64_t left;
+	unsigned i;
+
+	if (!_limit_write(d, di, offset, &nbytes))
+		return false;
+
+	for (left = nbytes, i = 0; (i < *nr) && left; i++) {
+		if (vec[i].iov_len > left)
+			vec[i].iov_len = left;
+		left -= vec[i].iov_len;
+	}
+
+	*nr = i;
+	*nbytes_p = nbytes;
+
+	return true;
+}
+
 static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 			 sector_t sb, sector_t se, void *data, void *context)
 {
@@ -166,9 +318,6 @@ static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 	struct async_engine *e = _to_async(ioe);
 	sector_t offset;
 	sector_t nbytes;
-	sector_t limit_nbytes;
-	sector_t orig_nbytes;
-	sector_t extra_nbytes = 0;
 
 	if (((uintptr_t) data) & e->page_mask) {
 		log_warn("misaligned data buffer");
@@ -178,85 +327,8 @@ static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 	offset = sb << SECTOR_SHIFT;
 	nbytes = (se - sb) << SECTOR_SHIFT;
 
-	/*
-	 * If bcache block goes past where lvm wants to write, then clamp it.
-	 */
-	if ((d == DIR_WRITE) && _last_byte_offset && (di == _last_byte_di)) {
-		if (offset > _last_byte_offset) {
-			log_error("Limit write at %llu len %llu beyond last byte %llu",
-				  (unsigned long long)offset,
-				  (unsigned long long)nbytes,
-				  (unsigned long long)_last_byte_offset);
-			return false;
-		}
-
-		/*
-		 * If the bcache block offset+len goes beyond where lvm is
-		 * intending to write, then reduce the len being written
-		 * (which is the bcache block size) so we don't write past
-		 * the limit set by lvm.  If after applying the limit, the
-		 * resulting size is not a multiple of the sector size (512
-		 * or 4096) then extend the reduced size to be a multiple of
-		 * the sector size (we don't want to write partial sectors.)
-		 */
-		if (offset + nbytes > _last_byte_offset) {
-			limit_nbytes = _last_byte_offset - offset;
-
-			if (limit_nbytes % _last_byte_sector_size) {
-				extra_nbytes = _last_byte_sector_size - (limit_nbytes % _last_byte_sector_size);
-
-				/*
-				 * adding extra_nbytes to the reduced nbytes (limit_nbytes)
-				 * should make the final write size a multiple of the
-				 * sector size.  This should never result in a final size
-				 * larger than the bcache block size (as long as the bcache
-				 * block size is a multiple of the sector size).
-				 */
-				if (limit_nbytes + extra_nbytes > nbytes) {
-					log_warn("Skip extending write at %llu len %llu limit %llu extra %llu sector_size %llu",
-						 (unsigned long long)offset,
-						 (unsigned long long)nbytes,
-						 (unsigned long long)limit_nbytes,
-						 (unsigned long long)extra_nbytes,
-						 (unsigned long long)_last_byte_sector_size);
-					extra_nbytes = 0;
-				}
-			}
-
-			orig_nbytes = nbytes;
-
-			if (extra_nbytes) {
-				log_debug("Limit write at %llu len %llu to len %llu rounded to %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)(limit_nbytes + extra_nbytes));
-				nbytes = limit_nbytes + extra_nbytes;
-			} else {
-				log_debug("Limit write at %llu len %llu to len %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes);
-				nbytes = limit_nbytes;
-			}
-
-			/*
-			 * This shouldn't happen, the reduced+extended
-			 * nbytes value should never be larger than the
-			 * bcache block size.
-			 */
-			if (nbytes > orig_nbytes) {
-				log_error("Invalid adjusted write at %llu len %llu adjusted %llu limit %llu extra %llu sector_size %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)orig_nbytes,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)extra_nbytes,
-					  (unsigned long long)_last_byte_sector_size);
-				return false;
-			}
-		}
-	}
+	if (!_limit_write(d, di, offset, &nbytes))
+		return false;
 
 	cb = _cb_alloc(e->cbs, context);
 	if (!cb) {
@@ -266,6 +338,7 @@ static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 
 	memset(&cb->cb, 0, sizeof(cb->cb));
 
+	cb->nbytes = nbytes;
 	cb->cb.aio_fildes = (int) _fd_table[di];
 	cb->cb.u.c.buf = data;
 	cb->cb.u.c.offset = offset;
@@ -299,6 +372,54 @@ static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 	return true;
 }
 
+static bool _async_issue_vec(struct io_engine *ioe, enum dir d, int di, sector_t sb,
+			     struct iovec *vec, unsigned nr, void *context)
+{
+	int r;
+	struct iocb *cb_array[1];
+	struct control_block *cb;
+	struct async_engine *e = _to_async(ioe);
+	uint64_t offset = sb << SECTOR_SHIFT;
+	uint64_t nbytes;
+	unsigned i;
+
+	for (i = 0; i < nr; i++)
+		if (((uintptr_t) vec[i].iov_base) & e->page_mask) {
+			log_warn("misaligned data buffer");
+			return false;
+		}
+
+	if (!_limit_write_vec(d, di, offset, vec, &nr, &nbytes))
+		return false;
+
+	cb = _cb_alloc(e->cbs, context);
+	if (!cb) {
+		log_warn("couldn't allocate control block");
+		return false;
+	}
+
+	memset(&cb->cb, 0, sizeof(cb->cb));
+
+	cb->nbytes = nbytes;
+	cb->cb.aio_fildes = (int) _fd_table[di];
+	cb->cb.u.v.vec = vec;
+	cb->cb.u.v.nr = (int) nr;
+	cb->cb.u.v.offset = offset;
+	cb->cb.aio_lio_opcode = (d == DIR_READ) ? IO_CMD_PREADV : IO_CMD_PWRITEV;
+
+	cb_array[0] = &cb->cb;
+	do {
+		r = io_submit(e->aio_context, 1, cb_array);
+	} while (r == -EAGAIN);
+
+	if (r < 0) {
+		_cb_free(e->cbs, cb);
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * MAX_IO is returned to the layer above via bcache_max_prefetches() which
  * tells the caller how many devices to submit io for concurrently.  There will
@@ -330,7 +451,7 @@ static bool _async_wait(struct io_engine *ioe, io_complete_fn fn)
 
 		cb = _iocb_to_cb((struct iocb *) ev->obj);
 
-		if (ev->res == cb->cb.u.c.nbytes)
+		if (ev->res == cb->nbytes)
 			fn((void *) cb->context, 0);
 
 		else if ((int) ev->res < 0)
@@ -368,6 +489,8 @@ struct io_engine *create_async_io_engine(void)
 	e->e.issue = _async_issue;
 	e->e.wait = _async_wait;
 	e->e.max_io = _async_max_io;
+	e->e.register_buffer = NULL;
+	e->e.issue_vec = _async_issue_vec;
 
 	e->aio_context = 0;
 	r = io_setup(MAX_IO, &e->aio_context);
@@ -391,217 +514,1588 @@ struct io_engine *create_async_io_engine(void)
 
 //----------------------------------------------------------------
 
-struct sync_io {
-        struct dm_list list;
+#ifdef HAVE_LINUX_IO_URING_H
+/*
+ * io_uring engine.
+ *
+ * Talks to the kernel through the raw syscalls so there is no dependency
+ * on liburing.  Issued io is only queued on the submission ring, it is
+ * passed to the kernel in a single io_uring_enter() call that also waits
+ * for completions, so a label scan prefetching MAX_IO devices costs one
+ * syscall rather than one per device.
+ *
+ * If the bcache data pool can be registered with the kernel, reads and
+ * writes that land within it use the _FIXED opcodes which saves the kernel
+ * mapping the pages for every io.
+ */
+struct uring_io {
 	void *context;
+	uint64_t nbytes;
+	struct iovec iov;	/* for single buffer io not using _FIXED */
 };
 
-struct sync_engine {
+struct uring_engine {
 	struct io_engine e;
-	struct dm_list complete;
+	int fd;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	unsigned nr_queued;	/* on the sq ring, not yet submitted */
+	unsigned nr_inflight;	/* queued or submitted, not yet reaped */
+
+	char *fixed_buf;
+	size_t fixed_len;
+
+	unsigned nr_free;
+	unsigned free_slots[MAX_IO];
+	struct uring_io slots[MAX_IO];
 };
 
-static struct sync_engine *_to_sync(struct io_engine *e)
+static struct uring_engine *_to_uring(struct io_engine *e)
 {
-        return container_of(e, struct sync_engine, e);
+	return container_of(e, struct uring_engine, e);
 }
 
-static void _sync_destroy(struct io_engine *ioe)
+static int _io_uring_setup(unsigned entries, struct io_uring_params *p)
 {
-        struct sync_engine *e = _to_sync(ioe);
-        free(e);
+	return (int) syscall(__NR_io_uring_setup, entries, p);
 }
 
-static bool _sync_issue(struct io_engine *ioe, enum dir d, int di,
-                        sector_t sb, sector_t se, void *data, void *context)
+static int _io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
 {
-	int rv;
-	off_t off;
-	uint64_t where;
-	uint64_t pos = 0;
-	uint64_t len = (se - sb) * 512;
-	struct sync_engine *e = _to_sync(ioe);
-	struct sync_io *io = malloc(sizeof(*io));
-	if (!io) {
-		log_warn("unable to allocate sync_io");
-        	return false;
-	}
-
-	where = sb * 512;
-	off = lseek(_fd_table[di], where, SEEK_SET);
-	if (off == (off_t) -1) {
-		log_warn("Device seek error %d for offset %llu", errno, (unsigned long long)where);
-		free(io);
-		return false;
-	}
-	if (off != (off_t) where) {
-		log_warn("Device seek failed for offset %llu", (unsigned long long)where);
-		free(io);
-		return false;
-	}
+	return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
 
-	/*
-	 * If bcache block goes past where lvm wants to write, then clamp it.
-	 */
-	if ((d == DIR_WRITE) && _last_byte_offset && (di == _last_byte_di)) {
-		uint64_t offset = where;
-		uint64_t nbytes = len;
-		sector_t limit_nbytes = 0;
-		sector_t extra_nbytes = 0;
-		sector_t orig_nbytes = 0;
-
-		if (offset > _last_byte_offset) {
-			log_error("Limit write at %llu len %llu beyond last byte %llu",
-				  (unsigned long long)offset,
-				  (unsigned long long)nbytes,
-				  (unsigned long long)_last_byte_offset);
-			free(io);
-			return false;
-		}
+static int _io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+	return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
 
-		if (offset + nbytes > _last_byte_offset) {
-			limit_nbytes = _last_byte_offset - offset;
-
-			if (limit_nbytes % _last_byte_sector_size) {
-				extra_nbytes = _last_byte_sector_size - (limit_nbytes % _last_byte_sector_size);
-
-				/*
-				 * adding extra_nbytes to the reduced nbytes (limit_nbytes)
-				 * should make the final write size a multiple of the
-				 * sector size.  This should never result in a final size
-				 * larger than the bcache block size (as long as the bcache
-				 * block size is a multiple of the sector size).
-				 */
-				if (limit_nbytes + extra_nbytes > nbytes) {
-					log_warn("Skip extending write at %llu len %llu limit %llu extra %llu sector_size %llu",
-						 (unsigned long long)offset,
-						 (unsigned long long)nbytes,
-						 (unsigned long long)limit_nbytes,
-						 (unsigned long long)extra_nbytes,
-						 (unsigned long long)_last_byte_sector_size);
-					extra_nbytes = 0;
-				}
-			}
+static void _uring_unmap(struct uring_engine *e)
+{
+	if (e->sqes)
+		(void) munmap(e->sqes, e->sqes_size);
+	if (e->cq_ring && (e->cq_ring != e->sq_ring))
+		(void) munmap(e->cq_ring, e->cq_ring_size);
+	if (e->sq_ring)
+		(void) munmap(e->sq_ring, e->sq_ring_size);
+}
 
-			orig_nbytes = nbytes;
+static void _uring_destroy(struct io_engine *ioe)
+{
+	struct uring_engine *e = _to_uring(ioe);
 
-			if (extra_nbytes) {
-				log_debug("Limit write at %llu len %llu to len %llu rounded to %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)(limit_nbytes + extra_nbytes));
-				nbytes = limit_nbytes + extra_nbytes;
-			} else {
-				log_debug("Limit write at %llu len %llu to len %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes);
-				nbytes = limit_nbytes;
-			}
+	if (e->nr_inflight)
+		log_error("uring io still in flight");
 
-			/*
-			 * This shouldn't happen, the reduced+extended
-			 * nbytes value should never be larger than the
-			 * bcache block size.
-			 */
-			if (nbytes > orig_nbytes) {
-				log_error("Invalid adjusted write at %llu len %llu adjusted %llu limit %llu extra %llu sector_size %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)orig_nbytes,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)extra_nbytes,
-					  (unsigned long long)_last_byte_sector_size);
-				free(io);
-				return false;
-			}
-		}
+	_uring_unmap(e);
+	if (close(e->fd))
+		log_sys_warn("close");
 
-		where = offset;
-		len = nbytes;
-	}
+	free(e);
+}
 
-	while (pos < len) {
-		if (d == DIR_READ)
-			rv = read(_fd_table[di], (char *)data + pos, len - pos);
-		else
-			rv = write(_fd_table[di], (char *)data + pos, len - pos);
+/*
+ * Passes everything queued on the sq ring to the kernel, optionally
+ * waiting for at least one completion.
+ */
+static bool _uring_enter(struct uring_engine *e, unsigned min_complete)
+{
+	unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+	int r;
 
-		if (rv == -1 && errno == EINTR)
-			continue;
-		if (rv == -1 && errno == EAGAIN)
-			continue;
+	for (;;) {
+		r = _io_uring_enter(e->fd, e->nr_queued, min_complete, flags);
+		if (r >= 0) {
+			e->nr_queued -= ((unsigned) r < e->nr_queued) ? (unsigned) r : e->nr_queued;
+			return true;
+		}
 
-		if (!rv)
+		if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
 			break;
-
-		if (rv < 0) {
-			if (d == DIR_READ)
-				log_debug("Device read error %d offset %llu len %llu", errno,
-					  (unsigned long long)(where + pos),
-					  (unsigned long long)(len - pos));
-			else
-				log_debug("Device write error %d offset %llu len %llu", errno,
-					  (unsigned long long)(where + pos),
-					  (unsigned long long)(len - pos));
-			free(io);
-			return false;
-		}
-		pos += rv;
 	}
 
-	if (pos < len) {
-		if (d == DIR_READ)
-			log_warn("Device read short %u bytes remaining", (unsigned)(len - pos));
-		else
-			log_warn("Device write short %u bytes remaining", (unsigned)(len - pos));
-		/*
-        	free(io);
-        	return false;
-		*/
-	}
+	log_sys_warn("io_uring_enter");
+	return false;
+}
 
+static bool _uring_register_buffer(struct io_engine *ioe, void *data, size_t len)
+{
+	struct uring_engine *e = _to_uring(ioe);
+	struct iovec iov = { .iov_base = data, .iov_len = len };
 
-	dm_list_add(&e->complete, &io->list);
-	io->context = context;
+	if (_io_uring_register(e->fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+		/* Usually RLIMIT_MEMLOCK; plain reads and writes still work. */
+		log_debug("io_uring buffer registration of %llu bytes failed: %s",
+			  (unsigned long long) len, strerror(errno));
+		return false;
+	}
+
+	e->fixed_buf = data;
+	e->fixed_len = len;
 
 	return true;
 }
 
-static bool _sync_wait(struct io_engine *ioe, io_complete_fn fn)
+/*
+ * Claims an io slot and the next sqe, which the caller fills in
+ * before calling _uring_queue_sqe().
+ */
+static struct io_uring_sqe *_uring_get_sqe(struct uring_engine *e, int di, uint64_t offset,
+					   uint64_t nbytes, void *context, struct uring_io **io_p)
 {
-        struct sync_io *io, *tmp;
-	struct sync_engine *e = _to_sync(ioe);
+	struct io_uring_sqe *sqe;
+	struct uring_io *io;
+	unsigned slot;
 
-	dm_list_iterate_items_safe(io, tmp, &e->complete) {
-		fn(io->context, 0);
-		dm_list_del(&io->list);
-		free(io);
+	if (!e->nr_free) {
+		log_warn("couldn't allocate uring io slot");
+		return NULL;
 	}
 
-	return true;
+	if ((*e->sq_tail - __atomic_load_n(e->sq_head, __ATOMIC_ACQUIRE)) > *e->sq_mask) {
+		/* Ring full, hand what we have to the kernel. */
+		if (!_uring_enter(e, 0))
+			return NULL;
+	}
+
+	slot = e->free_slots[--e->nr_free];
+	io = e->slots + slot;
+	io->context = context;
+	io->nbytes = nbytes;
+
+	sqe = e->sqes + (*e->sq_tail & *e->sq_mask);
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->fd = _fd_table[di];
+	sqe->off = offset;
+	sqe->user_data = slot;
+
+	*io_p = io;
+
+	return sqe;
 }
 
-static unsigned _sync_max_io(struct io_engine *e)
+static void _uring_queue_sqe(struct uring_engine *e)
 {
-        return 1;
+	unsigned tail = *e->sq_tail;
+	unsigned idx = tail & *e->sq_mask;
+
+	e->sq_array[idx] = idx;
+	__atomic_store_n(e->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	e->nr_queued++;
+	e->nr_inflight++;
 }
 
-struct io_engine *create_sync_io_engine(void)
+static bool _uring_issue(struct io_engine *ioe, enum dir d, int di,
+			 sector_t sb, sector_t se, void *data, void *context)
 {
-	struct sync_engine *e = malloc(sizeof(*e));
+	struct uring_engine *e = _to_uring(ioe);
+	struct io_uring_sqe *sqe;
+	struct uring_io *io;
+	uint64_t offset = sb << SECTOR_SHIFT;
+	uint64_t nbytes = (se - sb) << SECTOR_SHIFT;
+
+	if (!_limit_write(d, di, offset, &nbytes))
+		return false;
+
+	if (!(sqe = _uring_get_sqe(e, di, offset, nbytes, context, &io)))
+		return false;
+
+	if (e->fixed_buf && ((char *) data >= e->fixed_buf) &&
+	    ((char *) data + nbytes <= e->fixed_buf + e->fixed_len)) {
+		sqe->opcode = (d == DIR_READ) ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+		sqe->addr = (uintptr_t) data;
+		sqe->len = nbytes;
+		sqe->buf_index = 0;
+	} else {
+		io->iov.iov_base = data;
+		io->iov.iov_len = nbytes;
+		sqe->opcode = (d == DIR_READ) ? IORING_OP_READV : IORING_OP_WRITEV;
+		sqe->addr = (uintptr_t) &io->iov;
+		sqe->len = 1;
+	}
+
+	_uring_queue_sqe(e);
+
+	return true;
+}
+
+static bool _uring_issue_vec(struct io_engine *ioe, enum dir d, int di, sector_t sb,
+			     struct iovec *vec, unsigned nr, void *context)
+{
+	struct uring_engine *e = _to_uring(ioe);
+	struct io_uring_sqe *sqe;
+	struct uring_io *io;
+	uint64_t offset = sb << SECTOR_SHIFT;
+	uint64_t nbytes;
+
+	if (!_limit_write_vec(d, di, offset, vec, &nr, &nbytes))
+		return false;
+
+	if (!(sqe = _uring_get_sqe(e, di, offset, nbytes, context, &io)))
+		return false;
+
+	sqe->opcode = (d == DIR_READ) ? IORING_OP_READV : IORING_OP_WRITEV;
+	sqe->addr = (uintptr_t) vec;
+	sqe->len = nr;
+
+	_uring_queue_sqe(e);
+
+	return true;
+}
+
+static bool _uring_wait(struct io_engine *ioe, io_complete_fn fn)
+{
+	struct uring_engine *e = _to_uring(ioe);
+	struct io_uring_cqe *cqe;
+	struct uring_io *io;
+	unsigned head, slot;
+	int res;
+
+	if (!e->nr_inflight)
+		return true;
+
+	head = *e->cq_head;
+	if (e->nr_queued || (head == __atomic_load_n(e->cq_tail, __ATOMIC_ACQUIRE)))
+		if (!_uring_enter(e, 1))
+			return false;
+
+	while (head != __atomic_load_n(e->cq_tail, __ATOMIC_ACQUIRE)) {
+		cqe = e->cqes + (head & *e->cq_mask);
+		slot = (unsigned) cqe->user_data;
+		res = cqe->res;
+		head++;
+		__atomic_store_n(e->cq_head, head, __ATOMIC_RELEASE);
+
+		io = e->slots + slot;
+		e->free_slots[e->nr_free++] = slot;
+		e->nr_inflight--;
+
+		if ((uint64_t) res == io->nbytes)
+			fn(io->context, 0);
+
+		else if (res < 0)
+			fn(io->context, res);
+
+		/* Same short read rule as the aio engine. */
+		else if (res >= (1 << SECTOR_SHIFT))
+			fn(io->context, 0);
+
+		else
+			fn(io->context, -ENODATA);
+	}
+
+	return true;
+}
+
+static unsigned _uring_max_io(struct io_engine *e)
+{
+	return MAX_IO;
+}
+
+struct io_engine *create_uring_io_engine(void)
+{
+	struct io_uring_params p;
+	struct uring_engine *e;
+	char *sq, *cq;
+	unsigned i;
+
+	if (!(e = malloc(sizeof(*e))))
+		return NULL;
+
+	memset(e, 0, sizeof(*e));
+
+	memset(&p, 0, sizeof(p));
+	if ((e->fd = _io_uring_setup(MAX_IO, &p)) < 0) {
+		log_debug("io_uring_setup failed: %s", strerror(errno));
+		free(e);
+		return NULL;
+	}
+
+	e->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	e->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (e->cq_ring_size > e->sq_ring_size)
+			e->sq_ring_size = e->cq_ring_size;
+		e->cq_ring_size = e->sq_ring_size;
+	}
+
+	e->sq_ring = mmap(NULL, e->sq_ring_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, e->fd, IORING_OFF_SQ_RING);
+	if (e->sq_ring == MAP_FAILED) {
+		e->sq_ring = NULL;
+		goto_bad;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		e->cq_ring = e->sq_ring;
+	else {
+		e->cq_ring = mmap(NULL, e->cq_ring_size, PROT_READ | PROT_WRITE,
+				  MAP_SHARED | MAP_POPULATE, e->fd, IORING_OFF_CQ_RING);
+		if (e->cq_ring == MAP_FAILED) {
+			e->cq_ring = NULL;
+			goto_bad;
+		}
+	}
+
+	e->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	e->sqes = mmap(NULL, e->sqes_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, e->fd, IORING_OFF_SQES);
+	if (e->sqes == MAP_FAILED) {
+		e->sqes = NULL;
+		goto_bad;
+	}
+
+	sq = e->sq_ring;
+	e->sq_head = (unsigned *) (sq + p.sq_off.head);
+	e->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+	e->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+	e->sq_array = (unsigned *) (sq + p.sq_off.array);
+
+	cq = e->cq_ring;
+	e->cq_head = (unsigned *) (cq + p.cq_off.head);
+	e->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+	e->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+	e->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+	for (i = 0; i < MAX_IO; i++)
+		e->free_slots[i] = MAX_IO - 1 - i;
+	e->nr_free = MAX_IO;
+
+	e->e.destroy = _uring_destroy;
+	e->e.issue = _uring_issue;
+	e->e.wait = _uring_wait;
+	e->e.max_io = _uring_max_io;
+	e->e.register_buffer = _uring_register_buffer;
+	e->e.issue_vec = _uring_issue_vec;
+
+	return &e->e;
+
+bad:
+	_uring_unmap(e);
+	(void) close(e->fd);
+	free(e);
+
+	return NULL;
+}
+
+#else /* HAVE_LINUX_IO_URING_H */
+
+struct io_engine *create_uring_io_engine(void)
+{
+	log_debug("io_uring support not compiled in.");
+	return NULL;
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
+
+//----------------------------------------------------------------
+
+struct sync_io {
+        struct dm_list list;
+	void *context;
+};
+
+struct sync_engine {
+	struct io_engine e;
+	struct dm_list complete;
+};
+
+static struct sync_engine *_to_sync(struct io_engine *e)
+{
+        return container_of(e, struct sync_engine, e);
+}
+
+static void _sync_destroy(struct io_engine *ioe)
+{
+        struct sync_engine *e = _to_sync(ioe);
+        free(e);
+}
+
+static bool _sync_issue(struct io_engine *ioe, enum dir d, int di,
+                        sector_t sb, sector_t se, void *data, void *context)
+{
+	int rv;
+	off_t off;
+	uint64_t where;
+	uint64_t pos = 0;
+	uint64_t len = (se - sb) * 512;
+	struct sync_engine *e = _to_sync(ioe);
+	struct sync_io *io = malloc(sizeof(*io));
+	if (!io) {
+		log_warn("unable to allocate sync_io");
+        	return false;
+	}
+
+	where = sb * 512;
+	off = lseek(_fd_table[di], where, SEEK_SET);
+	if (off == (off_t) -1) {
+		log_warn("Device seek error %d for offset %llu", errno, (unsigned long long)where);
+		free(io);
+		return false;
+	}
+	if (off != (off_t) where) {
+		log_warn("Device seek failed for offset %llu", (unsigned long long)where);
+		free(io);
+		return false;
+	}
+
+	if (!_limit_write(d, di, where, &len)) {
+		free(io);
+		return false;
+	}
+
+	while (pos < len) {
+		if (d == DIR_READ)
+			rv = read(_fd_table[di], (char *)data + pos, len - pos);
+		else
+			rv = write(_fd_table[di], (char *)data + pos, len - pos);
+
+		if (rv == -1 && errno == EINTR)
+			continue;
+		if (rv == -1 && errno == EAGAIN)
+			continue;
+
+		if (!rv)
+			break;
+
+		if (rv < 0) {
+			if (d == DIR_READ)
+				log_debug("Device read error %d offset %llu len %llu", errno,
+					  (unsigned long long)(where + pos),
+					  (unsigned long long)(len - pos));
+			else
+				log_debug("Device write error %d offset %llu len %llu", errno,
+					  (unsigned long long)(where + pos),
+					  (unsigned long long)(len - pos));
+			free(io);
+			return false;
+		}
+		pos += rv;
+	}
+
+	if (pos < len) {
+		if (d == DIR_READ)
+			log_warn("Device read short %u bytes remaining", (unsigned)(len - pos));
+		else
+			log_warn("Device write short %u bytes remaining", (unsigned)(len - pos));
+		/*
+        	free(io);
+        	return false;
+		*/
+	}
+
+
+	dm_list_add(&e->complete, &io->list);
+	io->context = context;
+
+	return true;
+}
+
+/*
+ * Transfers len bytes at offset where, returning 0 or the errno of a
+ * failed transfer.  The number of bytes actually transferred, which is
+ * less than len if the end of the device is reached, is set in pos_p.
+ * vec is updated as the transfer progresses.
+ */
+static int _pio_vec(enum dir d, int fd, struct iovec *vec, unsigned nr,
+		    uint64_t where, uint64_t len, uint64_t *pos_p)
+{
+	ssize_t rv;
+	uint64_t pos = 0;
+
+	while (pos < len) {
+		if (d == DIR_READ)
+			rv = preadv(fd, vec, nr, where + pos);
+		else
+			rv = pwritev(fd, vec, nr, where + pos);
+
+		if (rv == -1 && errno == EINTR)
+			continue;
+		if (rv == -1 && errno == EAGAIN)
+			continue;
+
+		if (!rv)
+			break;
+
+		if (rv < 0) {
+			*pos_p = pos;
+			return errno;
+		}
+		pos += rv;
+
+		/* Skip past whatever the short transfer completed. */
+		while (nr && (size_t) rv >= vec->iov_len) {
+			rv -= vec->iov_len;
+			vec++;
+			nr--;
+		}
+		if (nr && rv) {
+			vec->iov_base = (char *) vec->iov_base + rv;
+			vec->iov_len -= rv;
+		}
+	}
+
+	*pos_p = pos;
+	return 0;
+}
+
+static bool _sync_issue_vec(struct io_engine *ioe, enum dir d, int di, sector_t sb,
+			    struct iovec *vec, unsigned nr, void *context)
+{
+	int err;
+	uint64_t where = sb * 512;
+	uint64_t pos = 0;
+	uint64_t len;
+	struct sync_engine *e = _to_sync(ioe);
+	struct sync_io *io = malloc(sizeof(*io));
+
+	if (!io) {
+		log_warn("unable to allocate sync_io");
+		return false;
+	}
+
+	if (!_limit_write_vec(d, di, where, vec, &nr, &len)) {
+		free(io);
+		return false;
+	}
+
+	if ((err = _pio_vec(d, _fd_table[di], vec, nr, where, len, &pos))) {
+		log_debug("Device %s error %d offset %llu len %llu",
+			  (d == DIR_READ) ? "read" : "write", err,
+			  (unsigned long long)(where + pos),
+			  (unsigned long long)(len - pos));
+		free(io);
+		return false;
+	}
+
+	if (pos < len)
+		log_warn("Device %s short %u bytes remaining",
+			 (d == DIR_READ) ? "read" : "write", (unsigned)(len - pos));
+
+	dm_list_add(&e->complete, &io->list);
+	io->context = context;
+
+	return true;
+}
+
+static bool _sync_wait(struct io_engine *ioe, io_complete_fn fn)
+{
+        struct sync_io *io, *tmp;
+	struct sync_engine *e = _to_sync(ioe);
+
+	dm_list_iterate_items_safe(io, tmp, &e->complete) {
+		fn(io->context, 0);
+		dm_list_del(&io->list);
+		free(io);
+	}
+
+	return true;
+}
+
+static unsigned _sync_max_io(struct io_engine *e)
+{
+        return 1;
+}
+
+struct io_engine *create_sync_io_engine(void)
+{
+	struct sync_engine *e = malloc(sizeof(*e));
+
+	if (!e)
+        	return NULL;
+
+        e->e.destroy = _sync_destroy;
+        e->e.issue = _sync_issue;
+        e->e.wait = _sync_wait;
+        e->e.max_io = _sync_max_io;
+        e->e.register_buffer = NULL;
+        e->e.issue_vec = _sync_issue_vec;
+
+        dm_list_init(&e->complete);
+        return &e->e;
+}
+
+//----------------------------------------------------------------
+
+/*
+ * The thread engine does the same blocking io as the sync engine, but
+ * hands it to a pool of worker threads so that several ios can be in
+ * flight at once.  Everything apart from the transfer itself, including
+ * the fd lookup, logging and the completion callbacks, happens in the
+ * thread calling issue() and wait().
+ */
+
+#define THREAD_STACK_SIZE (128 * 1024)
+
+struct thread_io {
+	struct dm_list list;
+	enum dir d;
+	int fd;
+	uint64_t where;
+	uint64_t len;
+	struct iovec one;	/* vec for a single buffer issue() */
+	struct iovec *vec;
+	unsigned nr;
+	void *context;
+
+	/* set by the worker */
+	int err;
+	uint64_t pos;
+};
+
+struct thread_engine {
+	struct io_engine e;
+	struct dm_list list;	/* _thread_engines */
+
+	pthread_mutex_t lock;
+	pthread_cond_t queued_cond;
+	pthread_cond_t complete_cond;
+	struct dm_list queued;
+	struct dm_list complete;
+	unsigned nr_in_flight;	/* issued, but not yet returned by wait() */
+	bool stopping;
+
+	unsigned max_threads;
+	unsigned nr_threads;	/* running, none after fork() */
+	pthread_t threads[0];
+};
+
+static DM_LIST_INIT(_thread_engines);
+static int _thread_atfork_registered;
+
+static struct thread_engine *_to_thread(struct io_engine *e)
+{
+	return container_of(e, struct thread_engine, e);
+}
+
+static void *_thread_worker(void *arg)
+{
+	struct thread_engine *e = arg;
+	struct thread_io *io;
+
+	pthread_mutex_lock(&e->lock);
+	for (;;) {
+		while (!e->stopping && dm_list_empty(&e->queued))
+			pthread_cond_wait(&e->queued_cond, &e->lock);
+
+		if (e->stopping)
+			break;
+
+		io = dm_list_item(dm_list_first(&e->queued), struct thread_io);
+		dm_list_del(&io->list);
+		pthread_mutex_unlock(&e->lock);
+
+		io->err = _pio_vec(io->d, io->fd, io->vec, io->nr, io->where, io->len, &io->pos);
+
+		pthread_mutex_lock(&e->lock);
+		dm_list_add(&e->complete, &io->list);
+		pthread_cond_signal(&e->complete_cond);
+	}
+	pthread_mutex_unlock(&e->lock);
+
+	return NULL;
+}
+
+/*
+ * Start the worker threads.  Signals are for the main thread.  The
+ * stacks are kept small as they get locked in memory along with
+ * everything else when lvm is activating devices.
+ */
+static unsigned _thread_start(struct thread_engine *e)
+{
+	pthread_attr_t attr;
+	sigset_t all, old;
+	unsigned i;
+	int r;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+
+	for (i = 0; i < e->max_threads; i++)
+		if ((r = pthread_create(&e->threads[i], &attr, _thread_worker, e))) {
+			log_debug("Failed to create io thread %u: %d", i, r);
+			break;
+		}
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	pthread_attr_destroy(&attr);
+
+	return (e->nr_threads = i);
+}
+
+/*
+ * Only the thread calling fork() exists in the child, so the workers
+ * are gone and the lock may be left held by one of them.  The child
+ * gets a fresh lock and starts its own workers when it next queues or
+ * waits for io.  Io queued but not yet taken by a worker is kept;
+ * fork() is only called with no io being executed.
+ */
+static void _thread_atfork_child(void)
+{
+	struct thread_engine *e;
+
+	dm_list_iterate_items(e, &_thread_engines) {
+		pthread_mutex_init(&e->lock, NULL);
+		pthread_cond_init(&e->queued_cond, NULL);
+		pthread_cond_init(&e->complete_cond, NULL);
+		e->nr_in_flight = dm_list_size(&e->queued) + dm_list_size(&e->complete);
+		e->nr_threads = 0;
+	}
+}
+
+static void _thread_stop(struct thread_engine *e)
+{
+	unsigned i;
+
+	pthread_mutex_lock(&e->lock);
+	e->stopping = true;
+	pthread_cond_broadcast(&e->queued_cond);
+	pthread_mutex_unlock(&e->lock);
+
+	for (i = 0; i < e->nr_threads; i++)
+		pthread_join(e->threads[i], NULL);
+}
+
+static void _thread_destroy(struct io_engine *ioe)
+{
+	struct thread_engine *e = _to_thread(ioe);
+	struct thread_io *io, *tmp;
+
+	_thread_stop(e);
+	dm_list_del(&e->list);
+
+	dm_list_iterate_items_safe(io, tmp, &e->queued)
+		free(io);
+	dm_list_iterate_items_safe(io, tmp, &e->complete)
+		free(io);
+
+	pthread_cond_destroy(&e->complete_cond);
+	pthread_cond_destroy(&e->queued_cond);
+	pthread_mutex_destroy(&e->lock);
+	free(e);
+}
+
+static bool _thread_queue(struct thread_engine *e, struct thread_io *io)
+{
+	if (!e->nr_threads && !_thread_start(e)) {
+		free(io);
+		return false;
+	}
+
+	pthread_mutex_lock(&e->lock);
+	dm_list_add(&e->queued, &io->list);
+	e->nr_in_flight++;
+	pthread_cond_signal(&e->queued_cond);
+	pthread_mutex_unlock(&e->lock);
+
+	return true;
+}
+
+static struct thread_io *_thread_io_alloc(enum dir d, int di, uint64_t where, void *context)
+{
+	struct thread_io *io = malloc(sizeof(*io));
+
+	if (!io) {
+		log_warn("unable to allocate thread_io");
+		return NULL;
+	}
+
+	io->d = d;
+	io->fd = _fd_table[di];
+	io->where = where;
+	io->context = context;
+	io->err = 0;
+	io->pos = 0;
+
+	return io;
+}
+
+static bool _thread_issue(struct io_engine *ioe, enum dir d, int di,
+			  sector_t sb, sector_t se, void *data, void *context)
+{
+	struct thread_io *io;
+	uint64_t where = sb << SECTOR_SHIFT;
+	uint64_t len = (se - sb) << SECTOR_SHIFT;
+
+	if (!_limit_write(d, di, where, &len))
+		return false;
+
+	if (!(io = _thread_io_alloc(d, di, where, context)))
+		return false;
+
+	io->one.iov_base = data;
+	io->one.iov_len = len;
+	io->vec = &io->one;
+	io->nr = 1;
+	io->len = len;
+
+	return _thread_queue(_to_thread(ioe), io);
+}
+
+static bool _thread_issue_vec(struct io_engine *ioe, enum dir d, int di, sector_t sb,
+			      struct iovec *vec, unsigned nr, void *context)
+{
+	struct thread_io *io;
+	uint64_t where = sb << SECTOR_SHIFT;
+	uint64_t len;
+
+	if (!_limit_write_vec(d, di, where, vec, &nr, &len))
+		return false;
+
+	if (!(io = _thread_io_alloc(d, di, where, context)))
+		return false;
+
+	io->vec = vec;
+	io->nr = nr;
+	io->len = len;
+
+	return _thread_queue(_to_thread(ioe), io);
+}
+
+static bool _thread_wait(struct io_engine *ioe, io_complete_fn fn)
+{
+	struct thread_engine *e = _to_thread(ioe);
+	struct thread_io *io, *tmp;
+	struct dm_list complete;
+
+	dm_list_init(&complete);
+
+	if (!e->nr_threads && !dm_list_empty(&e->queued) && !_thread_start(e))
+		return false;
+
+	pthread_mutex_lock(&e->lock);
+	while (e->nr_in_flight && dm_list_empty(&e->complete))
+		pthread_cond_wait(&e->complete_cond, &e->lock);
+
+	dm_list_splice(&complete, &e->complete);
+	e->nr_in_flight -= dm_list_size(&complete);
+	pthread_mutex_unlock(&e->lock);
+
+	dm_list_iterate_items_safe(io, tmp, &complete) {
+		if (io->err)
+			log_debug("Device %s error %d offset %llu len %llu",
+				  (io->d == DIR_READ) ? "read" : "write", io->err,
+				  (unsigned long long)(io->where + io->pos),
+				  (unsigned long long)(io->len - io->pos));
+		else if (io->pos < io->len)
+			log_warn("Device %s short %u bytes remaining",
+				 (io->d == DIR_READ) ? "read" : "write",
+				 (unsigned)(io->len - io->pos));
+
+		fn(io->context, io->err ? -EIO : 0);
+		dm_list_del(&io->list);
+		free(io);
+	}
+
+	return true;
+}
+
+static unsigned _thread_max_io(struct io_engine *e)
+{
+	return MAX_IO;
+}
+
+struct io_engine *create_thread_io_engine(unsigned nr_threads)
+{
+	struct thread_engine *e;
+
+	if (!nr_threads)
+		return NULL;
+
+	if (!_thread_atfork_registered) {
+		if (pthread_atfork(NULL, NULL, _thread_atfork_child)) {
+			log_debug("Failed to register io thread fork handler.");
+			return NULL;
+		}
+		_thread_atfork_registered = 1;
+	}
+
+	if (!(e = malloc(sizeof(*e) + nr_threads * sizeof(e->threads[0])))) {
+		log_warn("unable to allocate thread engine");
+		return NULL;
+	}
+
+	e->e.destroy = _thread_destroy;
+	e->e.issue = _thread_issue;
+	e->e.wait = _thread_wait;
+	e->e.max_io = _thread_max_io;
+	e->e.register_buffer = NULL;
+	e->e.issue_vec = _thread_issue_vec;
+
+	pthread_mutex_init(&e->lock, NULL);
+	pthread_cond_init(&e->queued_cond, NULL);
+	pthread_cond_init(&e->complete_cond, NULL);
+	dm_list_init(&e->queued);
+	dm_list_init(&e->complete);
+	e->nr_in_flight = 0;
+	e->stopping = false;
+	e->max_threads = nr_threads;
+
+	if (!_thread_start(e)) {
+		pthread_cond_destroy(&e->complete_cond);
+		pthread_cond_destroy(&e->queued_cond);
+		pthread_mutex_destroy(&e->lock);
+		free(e);
+		return NULL;
+	}
+
+	dm_list_add(&_thread_engines, &e->list);
+
+	return &e->e;
+}
+
+//----------------------------------------------------------------
+
+/*
+ * The delay engine wraps another engine for testing, holding back each
+ * completion until a simulated device latency has passed.  See
+ * create_delay_io_engine() for the spec it takes.
+ */
+
+#define MAX_DELAY_RULES 64
+
+static uint64_t _now_ns(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+enum delay_dist {
+	DELAY_FIXED,
+	DELAY_UNIFORM,
+	DELAY_EXP
+};
+
+/* Overrides for one device, by major:minor */
+struct delay_rule {
+	dev_t dev;
+	uint64_t latency_ns;	/* 0 keeps the engine's latency */
+	unsigned fail_percent;
+};
+
+struct delay_engine;
+
+struct delay_io {
+	struct dm_list list;
+	struct delay_engine *e;
+	void *context;
+	uint64_t due_ns;
+	int err;
+};
+
+struct delay_engine {
+	struct io_engine e;
+	struct io_engine *inner;
+
+	enum delay_dist dist;
+	uint64_t latency_ns;
+	uint64_t jitter_ns;
+	uint64_t bw_bytes;	/* per second, 0 for no limit */
+	uint64_t bw_free_ns;	/* when the simulated device is next idle */
+	unsigned max_io;
+	unsigned seed;
+
+	unsigned nr_rules;
+	struct delay_rule rules[MAX_DELAY_RULES];
+
+	struct dm_list done;	/* completed, ordered by due_ns */
+	unsigned nr_inner;	/* issued to the inner engine, not completed */
+};
+
+static struct delay_engine *_to_delay(struct io_engine *e)
+{
+	return container_of(e, struct delay_engine, e);
+}
+
+static void _delay_destroy(struct io_engine *ioe)
+{
+	struct delay_engine *e = _to_delay(ioe);
+	struct delay_io *io, *tmp;
+
+	e->inner->destroy(e->inner);
+
+	dm_list_iterate_items_safe(io, tmp, &e->done)
+		free(io);
+
+	free(e);
+}
+
+static void _delay_queue_done(struct delay_io *io)
+{
+	struct delay_io *pos;
+
+	dm_list_iterate_back_items(pos, &io->e->done)
+		if (pos->due_ns <= io->due_ns) {
+			dm_list_add_h(&pos->list, &io->list);
+			return;
+		}
+
+	dm_list_add_h(&io->e->done, &io->list);
+}
+
+static void _delay_complete(void *context, int io_error)
+{
+	struct delay_io *io = context;
+
+	io->err = io_error;
+	io->e->nr_inner--;
+	_delay_queue_done(io);
+}
+
+static struct delay_rule *_delay_find_rule(struct delay_engine *e, int di)
+{
+	struct stat info;
+	unsigned i;
+
+	if (!e->nr_rules || (di < 0) || (di >= _fd_table_size) || (_fd_table[di] < 0) ||
+	    fstat(_fd_table[di], &info) || !S_ISBLK(info.st_mode))
+		return NULL;
+
+	for (i = 0; i < e->nr_rules; i++)
+		if (e->rules[i].dev == info.st_rdev)
+			return &e->rules[i];
+
+	return NULL;
+}
+
+static uint64_t _delay_sample(struct delay_engine *e, uint64_t latency_ns)
+{
+	double u = (rand_r(&e->seed) + 1.0) / (RAND_MAX + 2.0);
+	uint64_t jitter;
+
+	switch (e->dist) {
+	case DELAY_UNIFORM:
+		jitter = (uint64_t) (u * 2 * e->jitter_ns);
+		if (latency_ns + jitter < e->jitter_ns)
+			return 0;
+		return latency_ns + jitter - e->jitter_ns;
+	case DELAY_EXP:
+		return (uint64_t) (-log(u) * latency_ns);
+	case DELAY_FIXED:
+		break;
+	}
+
+	return latency_ns;
+}
+
+/*
+ * Returns the io to pass as context to the inner engine, or NULL with
+ * *injected set if the io was failed without reaching it.
+ */
+static struct delay_io *_delay_io_alloc(struct delay_engine *e, int di,
+					uint64_t len, void *context, bool *injected)
+{
+	struct delay_rule *rule = _delay_find_rule(e, di);
+	struct delay_io *io;
+	uint64_t now = _now_ns(), start;
+
+	*injected = false;
+
+	if (!(io = malloc(sizeof(*io)))) {
+		log_warn("unable to allocate delay_io");
+		return NULL;
+	}
+
+	io->e = e;
+	io->context = context;
+	io->err = 0;
+	io->due_ns = now + _delay_sample(e, (rule && rule->latency_ns) ? rule->latency_ns : e->latency_ns);
+
+	/* Transfers share the bandwidth one after another. */
+	if (e->bw_bytes) {
+		start = (e->bw_free_ns > now) ? e->bw_free_ns : now;
+		e->bw_free_ns = start + len * 1000000000 / e->bw_bytes;
+		if (io->due_ns < e->bw_free_ns)
+			io->due_ns = e->bw_free_ns;
+	}
+
+	if (rule && rule->fail_percent &&
+	    ((unsigned) rand_r(&e->seed) % 100 < rule->fail_percent)) {
+		io->err = -EIO;
+		_delay_queue_done(io);
+		*injected = true;
+		return NULL;
+	}
+
+	return io;
+}
+
+static bool _delay_issue(struct io_engine *ioe, enum dir d, int di,
+			 sector_t sb, sector_t se, void *data, void *context)
+{
+	struct delay_engine *e = _to_delay(ioe);
+	struct delay_io *io;
+	bool injected;
+
+	if (!(io = _delay_io_alloc(e, di, (se - sb) << SECTOR_SHIFT, context, &injected)))
+		return injected;
+
+	if (!e->inner->issue(e->inner, d, di, sb, se, data, io)) {
+		free(io);
+		return false;
+	}
+
+	e->nr_inner++;
+
+	return true;
+}
+
+static bool _delay_issue_vec(struct io_engine *ioe, enum dir d, int di, sector_t sb,
+			     struct iovec *vec, unsigned nr, void *context)
+{
+	struct delay_engine *e = _to_delay(ioe);
+	struct delay_io *io;
+	uint64_t len = 0;
+	unsigned i;
+	bool injected;
+
+	for (i = 0; i < nr; i++)
+		len += vec[i].iov_len;
+
+	if (!(io = _delay_io_alloc(e, di, len, context, &injected)))
+		return injected;
+
+	if (!e->inner->issue_vec(e->inner, d, di, sb, vec, nr, io)) {
+		free(io);
+		return false;
+	}
+
+	e->nr_inner++;
+
+	return true;
+}
+
+/*
+ * Completions are handed on in due order, among those the inner engine
+ * has returned; the inner engine is only waited on when none are left.
+ */
+static bool _delay_wait(struct io_engine *ioe, io_complete_fn fn)
+{
+	struct delay_engine *e = _to_delay(ioe);
+	struct delay_io *io, *tmp;
+	struct timespec ts;
+	uint64_t now;
+
+	if (dm_list_empty(&e->done) && e->nr_inner &&
+	    !e->inner->wait(e->inner, _delay_complete))
+		return false;
+
+	if (dm_list_empty(&e->done))
+		return true;
+
+	io = dm_list_item(dm_list_first(&e->done), struct delay_io);
+	while ((now = _now_ns()) < io->due_ns) {
+		ts.tv_sec = (io->due_ns - now) / 1000000000;
+		ts.tv_nsec = (io->due_ns - now) % 1000000000;
+		nanosleep(&ts, NULL);
+	}
+
+	dm_list_iterate_items_safe(io, tmp, &e->done) {
+		if (io->due_ns > now)
+			break;
+		dm_list_del(&io->list);
+		fn(io->context, io->err);
+		free(io);
+	}
+
+	return true;
+}
+
+static unsigned _delay_max_io(struct io_engine *ioe)
+{
+	struct delay_engine *e = _to_delay(ioe);
+	unsigned max_io = e->inner->max_io(e->inner);
+
+	return (e->max_io && (e->max_io < max_io)) ? e->max_io : max_io;
+}
+
+static bool _delay_register_buffer(struct io_engine *ioe, void *data, size_t len)
+{
+	struct delay_engine *e = _to_delay(ioe);
+
+	return e->inner->register_buffer(e->inner, data, len);
+}
+
+static bool _delay_parse_rule(struct delay_engine *e, const char *val, bool fail)
+{
+	struct delay_rule *rule = NULL;
+	unsigned major, minor, i;
+	unsigned long long arg;
+	dev_t dev;
+
+	if (sscanf(val, "%u:%u/%llu", &major, &minor, &arg) != 3)
+		return false;
+
+	dev = makedev(major, minor);
+
+	for (i = 0; i < e->nr_rules; i++)
+		if (e->rules[i].dev == dev)
+			rule = &e->rules[i];
+
+	if (!rule) {
+		if (e->nr_rules == MAX_DELAY_RULES)
+			return false;
+		rule = &e->rules[e->nr_rules++];
+		rule->dev = dev;
+		rule->latency_ns = 0;
+		rule->fail_percent = 0;
+	}
+
+	if (fail)
+		rule->fail_percent = (arg > 100) ? 100 : arg;
+	else
+		rule->latency_ns = arg * 1000;
+
+	return true;
+}
+
+static bool _delay_parse(struct delay_engine *e, const char *spec)
+{
+	char *buf, *key, *val, *save = NULL;
+	unsigned long long n;
+	bool r = false;
+
+	if (!(buf = strdup(spec)))
+		return false;
+
+	for (key = strtok_r(buf, ",", &save); key; key = strtok_r(NULL, ",", &save)) {
+		if (!(val = strchr(key, '=')))
+			goto out;
+		*val++ = '\0';
+
+		if (!strcmp(key, "dist")) {
+			if (!strcmp(val, "fixed"))
+				e->dist = DELAY_FIXED;
+			else if (!strcmp(val, "uniform"))
+				e->dist = DELAY_UNIFORM;
+			else if (!strcmp(val, "exp"))
+				e->dist = DELAY_EXP;
+			else
+				goto out;
+			continue;
+		}
+
+		if (!strcmp(key, "dev") || !strcmp(key, "fail")) {
+			if (!_delay_parse_rule(e, val, key[0] == 'f'))
+				goto out;
+			continue;
+		}
+
+		if (sscanf(val, "%llu", &n) != 1)
+			goto out;
+
+		if (!strcmp(key, "latency"))
+			e->latency_ns = n * 1000;
+		else if (!strcmp(key, "jitter"))
+			e->jitter_ns = n * 1000;
+		else if (!strcmp(key, "bw"))
+			e->bw_bytes = n * 1024;
+		else if (!strcmp(key, "max_io"))
+			e->max_io = n;
+		else if (!strcmp(key, "seed"))
+			e->seed = n;
+		else
+			goto out;
+	}
+
+	r = true;
+out:
+	free(buf);
+
+	return r;
+}
+
+struct io_engine *create_delay_io_engine(struct io_engine *inner, const char *spec)
+{
+	struct delay_engine *e;
+
+	if (!(e = calloc(1, sizeof(*e)))) {
+		log_warn("unable to allocate delay engine");
+		return NULL;
+	}
+
+	e->e.destroy = _delay_destroy;
+	e->e.issue = _delay_issue;
+	e->e.wait = _delay_wait;
+	e->e.max_io = _delay_max_io;
+	e->e.register_buffer = inner->register_buffer ? _delay_register_buffer : NULL;
+	e->e.issue_vec = inner->issue_vec ? _delay_issue_vec : NULL;
+
+	e->inner = inner;
+	e->dist = DELAY_FIXED;
+	e->seed = 1;
+	dm_list_init(&e->done);
+
+	if (!_delay_parse(e, spec)) {
+		log_warn("WARNING: Invalid io delay spec \"%s\".", spec);
+		free(e);
+		return NULL;
+	}
+
+	return &e->e;
+}
+
+//----------------------------------------------------------------
+
+/*
+ * The trace engine wraps another engine and appends a line to a file
+ * for every io it completes, so slow commands on one host can be
+ * replayed elsewhere (test/bench/replay-io-trace.sh).  See
+ * create_trace_io_engine() for the format.
+ */
+
+#define TRACE_LABEL_BYTES 2048	/* the sectors searched for a label */
+
+struct trace_engine;
+
+struct trace_io {
+	struct trace_engine *e;
+	void *context;
+	enum dir d;
+	dev_t dev;
+	uint64_t offset;
+	uint64_t len;
+	uint64_t issue_ns;
+	void *data;		/* start of the first buffer */
+	uint64_t data_len;
+};
+
+struct trace_engine {
+	struct io_engine e;
+	struct io_engine *inner;
+	FILE *fp;
+	uint64_t start_ns;
+	io_complete_fn *fn;	/* of the wait() in progress */
+};
+
+static struct trace_engine *_to_trace(struct io_engine *e)
+{
+	return container_of(e, struct trace_engine, e);
+}
+
+static void _trace_destroy(struct io_engine *ioe)
+{
+	struct trace_engine *e = _to_trace(ioe);
+
+	e->inner->destroy(e->inner);
+
+	if (fclose(e->fp))
+		log_debug("Failed to close io trace.");
+
+	free(e);
+}
+
+static dev_t _trace_dev(int di)
+{
+	struct stat info;
+
+	if ((di < 0) || (di >= _fd_table_size) || (_fd_table[di] < 0) ||
+	    fstat(_fd_table[di], &info) || !S_ISBLK(info.st_mode))
+		return 0;
+
+	return info.st_rdev;
+}
+
+static struct trace_io *_trace_io_alloc(struct trace_engine *e, enum dir d, int di,
+					sector_t sb, uint64_t len, void *data,
+					uint64_t data_len, void *context)
+{
+	struct trace_io *io;
+
+	if (!(io = malloc(sizeof(*io)))) {
+		log_warn("unable to allocate trace_io");
+		return NULL;
+	}
+
+	io->e = e;
+	io->context = context;
+	io->d = d;
+	io->dev = _trace_dev(di);
+	io->offset = sb << SECTOR_SHIFT;
+	io->len = len;
+	io->data = data;
+	io->data_len = data_len;
+	io->issue_ns = _now_ns();
+
+	return io;
+}
+
+static void _trace_complete(void *context, int io_error)
+{
+	struct trace_io *io = context;
+	struct trace_engine *e = io->e;
+	uint64_t now = _now_ns();
+	uint64_t label_len, sector;
+	bool label = false;
+
+	fprintf(e->fp, "%llu %u:%u %c %llu %llu %llu %d",
+		(unsigned long long)((io->issue_ns - e->start_ns) / 1000),
+		major(io->dev), minor(io->dev), (io->d == DIR_READ) ? 'r' : 'w',
+		(unsigned long long)io->offset, (unsigned long long)io->len,
+		(unsigned long long)((now - io->issue_ns) / 1000), io_error);
+
+	/* Identify label areas by their content, without recording it. */
+	if (!io_error && (io->offset < TRACE_LABEL_BYTES)) {
+		label_len = TRACE_LABEL_BYTES - io->offset;
+		if (label_len > io->data_len)
+			label_len = io->data_len;
+
+		for (sector = (io->offset + 511) >> SECTOR_SHIFT;
+		     (sector << SECTOR_SHIFT) + 8 <= io->offset + label_len; sector++)
+			if (!memcmp((char *) io->data + (sector << SECTOR_SHIFT) - io->offset,
+				    "LABELONE", 8))
+				label = true;
+
+		fprintf(e->fp, " %08x%s", calc_crc(INITIAL_CRC, io->data, (uint32_t) label_len),
+			label ? " L" : "");
+	}
+
+	fputc('\n', e->fp);
+
+	e->fn(io->context, io_error);
+	free(io);
+}
+
+static bool _trace_issue(struct io_engine *ioe, enum dir d, int di,
+			 sector_t sb, sector_t se, void *data, void *context)
+{
+	struct trace_engine *e = _to_trace(ioe);
+	uint64_t len = (se - sb) << SECTOR_SHIFT;
+	struct trace_io *io;
+
+	if (!(io = _trace_io_alloc(e, d, di, sb, len, data, len, context)))
+		return false;
+
+	if (!e->inner->issue(e->inner, d, di, sb, se, data, io)) {
+		free(io);
+		return false;
+	}
+
+	return true;
+}
+
+static bool _trace_issue_vec(struct io_engine *ioe, enum dir d, int di, sector_t sb,
+			     struct iovec *vec, unsigned nr, void *context)
+{
+	struct trace_engine *e = _to_trace(ioe);
+	struct trace_io *io;
+	uint64_t len = 0;
+	unsigned i;
+
+	for (i = 0; i < nr; i++)
+		len += vec[i].iov_len;
+
+	/* The engine may change vec, so keep the first buffer now */
+	if (!(io = _trace_io_alloc(e, d, di, sb, len, vec[0].iov_base, vec[0].iov_len, context)))
+		return false;
+
+	if (!e->inner->issue_vec(e->inner, d, di, sb, vec, nr, io)) {
+		free(io);
+		return false;
+	}
+
+	return true;
+}
+
+static bool _trace_wait(struct io_engine *ioe, io_complete_fn fn)
+{
+	struct trace_engine *e = _to_trace(ioe);
+
+	e->fn = fn;
+
+	return e->inner->wait(e->inner, _trace_complete);
+}
+
+static unsigned _trace_max_io(struct io_engine *ioe)
+{
+	struct trace_engine *e = _to_trace(ioe);
+
+	return e->inner->max_io(e->inner);
+}
+
+static bool _trace_register_buffer(struct io_engine *ioe, void *data, size_t len)
+{
+	struct trace_engine *e = _to_trace(ioe);
+
+	return e->inner->register_buffer(e->inner, data, len);
+}
+
+/* The command being traced, from /proc/self/cmdline */
+static void _trace_header(FILE *fp)
+{
+	char buf[512];
+	size_t len, i;
+	FILE *cmdline;
+
+	fprintf(fp, "# pid %d", (int) getpid());
+
+	if ((cmdline = fopen("/proc/self/cmdline", "r"))) {
+		if ((len = fread(buf, 1, sizeof(buf) - 1, cmdline))) {
+			for (i = 0; i < len; i++)
+				if (!buf[i] || (buf[i] == '\n'))
+					buf[i] = ' ';
+			buf[len] = '\0';
+			fprintf(fp, " cmd %s", buf);
+		}
+		(void) fclose(cmdline);
+	}
+
+	fputc('\n', fp);
+}
+
+struct io_engine *create_trace_io_engine(struct io_engine *inner, const char *path)
+{
+	struct trace_engine *e;
+
+	if (!(e = malloc(sizeof(*e)))) {
+		log_warn("unable to allocate trace engine");
+		return NULL;
+	}
+
+	if (!(e->fp = fopen(path, "a"))) {
+		log_warn("WARNING: Cannot open io trace %s: %s.", path, strerror(errno));
+		free(e);
+		return NULL;
+	}
 
-	if (!e)
-        	return NULL;
+	/* Each line is one write, so traces of concurrent commands do not mix */
+	setvbuf(e->fp, NULL, _IOLBF, 0);
+	_trace_header(e->fp);
 
-        e->e.destroy = _sync_destroy;
-        e->e.issue = _sync_issue;
-        e->e.wait = _sync_wait;
-        e->e.max_io = _sync_max_io;
+	e->e.destroy = _trace_destroy;
+	e->e.issue = _trace_issue;
+	e->e.wait = _trace_wait;
+	e->e.max_io = _trace_max_io;
+	e->e.register_buffer = inner->register_buffer ? _trace_register_buffer : NULL;
+	e->e.issue_vec = inner->issue_vec ? _trace_issue_vec : NULL;
 
-        dm_list_init(&e->complete);
-        return &e->e;
+	e->inner = inner;
+	e->start_ns = _now_ns();
+	e->fn = NULL;
+
+	return &e->e;
 }
 
 //----------------------------------------------------------------
@@ -610,6 +2104,19 @@ struct io_engine *create_sync_io_engine(void)
 #define WRITEBACK_LOW_THRESHOLD_PERCENT 33
 #define WRITEBACK_HIGH_THRESHOLD_PERCENT 66
 
+/*
+ * With BCACHE_POLICY_2Q, blocks referenced only once are evicted in
+ * preference to re-referenced blocks while they make up more than this
+ * share of the cache.
+ */
+#define PROBATION_THRESHOLD_PERCENT 25
+
+/*
+ * Maximum number of adjacent dirty blocks merged into one vectored
+ * write.
+ */
+#define MAX_WRITE_RUN 32
+
 //----------------------------------------------------------------
 
 static void *_alloc_aligned(size_t len, size_t alignment)
@@ -644,6 +2151,9 @@ static void _clear_flags(struct block *b, unsigned bits)
 enum block_flags {
 	BF_IO_PENDING = (1 << 0),
 	BF_DIRTY = (1 << 1),
+	BF_HOT = (1 << 2),	/* re-referenced, lives on the hot list when clean */
+	BF_CLEAN = (1 << 3),	/* on either the clean or hot list */
+	BF_PREFETCHED = (1 << 4),	/* read by prefetch, not yet got */
 };
 
 struct bcache {
@@ -651,11 +2161,13 @@ struct bcache {
 	uint64_t nr_data_blocks;
 	uint64_t nr_cache_blocks;
 	unsigned max_io;
+	enum bcache_policy policy;
 
 	struct io_engine *engine;
 
 	void *raw_data;
 	struct block *raw_blocks;
+	struct dm_list grown;	/* struct block_chunk added by bcache_grow() */
 
 	/*
 	 * Lists that categorise the blocks.
@@ -663,24 +2175,32 @@ struct bcache {
 	unsigned nr_locked;
 	unsigned nr_dirty;
 	unsigned nr_io_pending;
+	unsigned nr_clean;
+	unsigned nr_hot;
 
 	struct dm_list free;
 	struct dm_list errored;
 	struct dm_list dirty;
-	struct dm_list clean;
+	struct dm_list clean;	/* LRU, or probationary blocks with 2Q */
+	struct dm_list hot;	/* 2Q only, re-referenced clean blocks */
 	struct dm_list io_pending;
 
 	struct radix_tree *rtree;
 
-	/*
-	 * Statistics
-	 */
-	unsigned read_hits;
-	unsigned read_misses;
-	unsigned write_zeroes;
-	unsigned write_hits;
-	unsigned write_misses;
-	unsigned prefetches;
+	/* Scratch space for batching up writes, nr_cache_blocks long. */
+	struct block **write_batch;
+
+	struct bcache_stats stats;
+};
+
+/*
+ * Blocks added after creation.  Blocks are referenced by pointer, so
+ * growing adds new chunks rather than moving the existing blocks.
+ */
+struct block_chunk {
+	struct dm_list list;
+	void *data;
+	struct block blocks[0];
 };
 
 //----------------------------------------------------------------
@@ -750,11 +2270,19 @@ static bool _init_free_list(struct bcache *cache, unsigned count, unsigned pgsiz
 		return false;
 	}
 
+	cache->write_batch = malloc(count * sizeof(*cache->write_batch));
+	if (!cache->write_batch) {
+		free(cache->raw_blocks);
+		free(data);
+		return false;
+	}
+
 	cache->raw_data = data;
 
 	for (i = 0; i < count; i++) {
 		struct block *b = cache->raw_blocks + i;
 		b->cache = cache;
+		b->run = NULL;
 		b->data = data + (block_size * i);
 		dm_list_add(&cache->free, &b->list);
 	}
@@ -764,8 +2292,16 @@ static bool _init_free_list(struct bcache *cache, unsigned count, unsigned pgsiz
 
 static void _exit_free_list(struct bcache *cache)
 {
+	struct block_chunk *chunk, *tmp;
+
+	dm_list_iterate_items_safe(chunk, tmp, &cache->grown) {
+		free(chunk->data);
+		free(chunk);
+	}
+
 	free(cache->raw_data);
 	free(cache->raw_blocks);
+	free(cache->write_batch);
 }
 
 static struct block *_alloc_block(struct bcache *cache)
@@ -786,10 +2322,25 @@ static void _free_block(struct block *b)
  * Always use these methods to ensure nr_dirty_ is correct.
  *--------------------------------------------------------------*/
 
+static void _unlink_clean(struct block *b)
+{
+	if (!_test_flags(b, BF_CLEAN))
+		return;
+
+	if (_test_flags(b, BF_HOT))
+		b->cache->nr_hot--;
+	else
+		b->cache->nr_clean--;
+
+	_clear_flags(b, BF_CLEAN);
+}
+
 static void _unlink_block(struct block *b)
 {
 	if (_test_flags(b, BF_DIRTY))
 		b->cache->nr_dirty--;
+	else
+		_unlink_clean(b);
 
 	dm_list_del(&b->list);
 }
@@ -801,8 +2352,15 @@ static void _link_block(struct block *b)
 	if (_test_flags(b, BF_DIRTY)) {
 		dm_list_add(&cache->dirty, &b->list);
 		cache->nr_dirty++;
-	} else
+	} else if (_test_flags(b, BF_HOT)) {
+		dm_list_add(&cache->hot, &b->list);
+		cache->nr_hot++;
+		_set_flags(b, BF_CLEAN);
+	} else {
 		dm_list_add(&cache->clean, &b->list);
+		cache->nr_clean++;
+		_set_flags(b, BF_CLEAN);
+	}
 }
 
 static void _relink(struct block *b)
@@ -824,11 +2382,42 @@ static void _relink(struct block *b)
  *
  *--------------------------------------------------------------*/
 
-static void _complete_io(void *context, int err)
+static unsigned _latency_bucket(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	unsigned bucket = 0;
+
+	while (us && (bucket < BCACHE_LATENCY_BUCKETS - 1)) {
+		us >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static void _account_completion(struct block *b, int err)
+{
+	struct bcache_stats *stats = &b->cache->stats;
+	struct bcache_di_stats *di_stats;
+	uint64_t *hist = (b->io_dir == DIR_READ) ? stats->read_latency : stats->write_latency;
+	uint64_t now = _now_ns();
+
+	if (b->issue_ns && (now >= b->issue_ns))
+		hist[_latency_bucket(now - b->issue_ns)]++;
+
+	if (err) {
+		stats->io_errors++;
+		if ((di_stats = _get_di_stats(b->di)))
+			di_stats->io_errors++;
+	}
+}
+
+static void _complete_block(struct block *b, int err)
 {
-	struct block *b = context;
 	struct bcache *cache = b->cache;
 
+	_account_completion(b, err);
+
 	b->error = err;
 	_clear_flags(b, BF_IO_PENDING);
 	cache->nr_io_pending--;
@@ -848,25 +2437,94 @@ static void _complete_io(void *context, int err)
 	}
 }
 
+/*
+ * A run of adjacent blocks written with a single vectored io.  The
+ * first block is passed to the engine as the context, and points at
+ * the run so completion can be fanned out to every block.
+ */
+struct io_run {
+	unsigned nr;
+	struct iovec *vec;
+	struct block *blocks[];
+};
+
+static void _complete_io(void *context, int err)
+{
+	struct block *b = context;
+	struct io_run *run = b->run;
+	unsigned i;
+
+	if (!run) {
+		_complete_block(b, err);
+		return;
+	}
+
+	for (i = 0; i < run->nr; i++) {
+		run->blocks[i]->run = NULL;
+		_complete_block(run->blocks[i], err);
+	}
+
+	free(run);
+}
+
+static void _account_issue(struct block *b, enum dir d)
+{
+	struct bcache *cache = b->cache;
+	uint64_t len = cache->block_sectors << SECTOR_SHIFT;
+	struct bcache_di_stats *di_stats = _get_di_stats(b->di);
+
+	b->issue_ns = _now_ns();
+
+	if (d == DIR_READ) {
+		len = b->nr_valid << SECTOR_SHIFT;
+		cache->stats.reads_issued++;
+		cache->stats.bytes_read += len;
+		if (di_stats) {
+			di_stats->reads_issued++;
+			di_stats->bytes_read += len;
+		}
+	} else {
+		cache->stats.writes_issued++;
+		cache->stats.bytes_written += len;
+		if (di_stats) {
+			di_stats->writes_issued++;
+			di_stats->bytes_written += len;
+		}
+	}
+}
+
 /*
  * |b->list| should be valid (either pointing to itself, on one of the other
  * lists.
  */
-static void _issue_low_level(struct block *b, enum dir d)
+static bool _prepare_io(struct block *b, enum dir d)
 {
 	struct bcache *cache = b->cache;
-	sector_t sb = b->index * cache->block_sectors;
-	sector_t se = sb + cache->block_sectors;
 
 	if (_test_flags(b, BF_IO_PENDING))
-		return;
+		return false;
 
 	b->io_dir = d;
+	_unlink_clean(b);
 	_set_flags(b, BF_IO_PENDING);
 	cache->nr_io_pending++;
 
 	dm_list_move(&cache->io_pending, &b->list);
 
+	_account_issue(b, d);
+
+	return true;
+}
+
+static void _issue_low_level(struct block *b, enum dir d)
+{
+	struct bcache *cache = b->cache;
+	sector_t sb = b->index * cache->block_sectors;
+	sector_t se = sb + ((d == DIR_READ) ? b->nr_valid : cache->block_sectors);
+
+	if (!_prepare_io(b, d))
+		return;
+
 	if (!cache->engine->issue(cache->engine, d, b->di, sb, se, b->data, b)) {
 		/* FIXME: if io_submit() set an errno, return that instead of EIO? */
 		_complete_io(b, -EIO);
@@ -884,6 +2542,87 @@ static inline void _issue_write(struct block *b)
 	_issue_low_level(b, DIR_WRITE);
 }
 
+/*
+ * Writes blocks[0..nr) which are adjacent blocks of one di, none of
+ * them with io in flight, using a single vectored io.
+ */
+static void _issue_write_run(struct bcache *cache, struct block **blocks, unsigned nr)
+{
+	struct io_run *run;
+	size_t block_size = cache->block_sectors << SECTOR_SHIFT;
+	unsigned i;
+
+	if (!(run = malloc(sizeof(*run) + nr * (sizeof(*run->blocks) + sizeof(*run->vec))))) {
+		for (i = 0; i < nr; i++)
+			_issue_write(blocks[i]);
+		return;
+	}
+
+	run->nr = nr;
+	run->vec = (struct iovec *) (run->blocks + nr);
+
+	for (i = 0; i < nr; i++) {
+		(void) _prepare_io(blocks[i], DIR_WRITE);
+		run->blocks[i] = blocks[i];
+		run->vec[i].iov_base = blocks[i]->data;
+		run->vec[i].iov_len = block_size;
+	}
+
+	blocks[0]->run = run;
+	cache->stats.vec_writes++;
+
+	if (!cache->engine->issue_vec(cache->engine, DIR_WRITE, blocks[0]->di,
+				      blocks[0]->index * cache->block_sectors,
+				      run->vec, nr, blocks[0]))
+		_complete_io(blocks[0], -EIO);
+}
+
+static int _cmp_block_addr(const void *lhs, const void *rhs)
+{
+	const struct block *l = *(const struct block * const *) lhs;
+	const struct block *r = *(const struct block * const *) rhs;
+
+	if (l->di != r->di)
+		return (l->di < r->di) ? -1 : 1;
+
+	if (l->index != r->index)
+		return (l->index < r->index) ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * Issues writes for a batch of dirty blocks, sorted so that runs of
+ * adjacent blocks can go to the engine as one vectored io.
+ */
+static void _issue_writes(struct bcache *cache, struct block **blocks, unsigned nr)
+{
+	unsigned i, len;
+
+	if (!cache->engine->issue_vec) {
+		for (i = 0; i < nr; i++)
+			_issue_write(blocks[i]);
+		return;
+	}
+
+	qsort(blocks, nr, sizeof(*blocks), _cmp_block_addr);
+
+	for (i = 0; i < nr; i += len) {
+		len = 1;
+		if (!_test_flags(blocks[i], BF_IO_PENDING))
+			for (; (i + len < nr) && (len < MAX_WRITE_RUN); len++)
+				if ((blocks[i + len]->di != blocks[i]->di) ||
+				    (blocks[i + len]->index != blocks[i]->index + len) ||
+				    _test_flags(blocks[i + len], BF_IO_PENDING))
+					break;
+
+		if (len == 1)
+			_issue_write(blocks[i]);
+		else
+			_issue_write_run(cache, blocks + i, len);
+	}
+}
+
 static bool _wait_io(struct bcache *cache)
 {
 	return cache->engine->wait(cache->engine, _complete_io);
@@ -915,12 +2654,13 @@ static unsigned _writeback(struct bcache *cache, unsigned count)
 			break;
 
 		// We can't writeback anything that's still in use.
-		if (!b->ref_count) {
-			_issue_write(b);
-			actual++;
-		}
+		if (!b->ref_count)
+			cache->write_batch[actual++] = b;
 	}
 
+	_issue_writes(cache, cache->write_batch, actual);
+	cache->stats.writebacks += actual;
+
 	return actual;
 }
 
@@ -928,14 +2668,15 @@ static unsigned _writeback(struct bcache *cache, unsigned count)
  * High level allocation
  *--------------------------------------------------------------*/
 
-static struct block *_find_unused_clean_block(struct bcache *cache)
+static struct block *_find_unused_on_list(struct dm_list *head)
 {
 	struct block *b;
 
-	dm_list_iterate_items (b, &cache->clean) {
+	dm_list_iterate_items (b, head) {
 		if (!b->ref_count) {
 			_unlink_block(b);
 			_block_remove(b);
+			b->cache->stats.evictions++;
 			return b;
 		}
 	}
@@ -943,6 +2684,29 @@ static struct block *_find_unused_clean_block(struct bcache *cache)
 	return NULL;
 }
 
+/*
+ * The clean list is kept in LRU order.  With the 2Q policy, blocks move
+ * to the hot list when referenced a second time, and the hot list is
+ * only raided once the single reference blocks have shrunk below
+ * PROBATION_THRESHOLD_PERCENT of the cache.  This stops a scan of many
+ * devices flushing out the metadata blocks that will be re-read.
+ */
+static struct block *_find_unused_clean_block(struct bcache *cache)
+{
+	struct block *b;
+
+	if ((cache->policy == BCACHE_POLICY_2Q) &&
+	    (cache->nr_clean <= (PROBATION_THRESHOLD_PERCENT * cache->nr_cache_blocks / 100))) {
+		if ((b = _find_unused_on_list(&cache->hot)))
+			return b;
+	}
+
+	if ((b = _find_unused_on_list(&cache->clean)))
+		return b;
+
+	return _find_unused_on_list(&cache->hot);
+}
+
 static struct block *_new_block(struct bcache *cache, int di, block_address i, bool can_wait)
 {
 	struct block *b;
@@ -975,6 +2739,7 @@ static struct block *_new_block(struct bcache *cache, int di, block_address i, b
 		b->index = i;
 		b->ref_count = 0;
 		b->error = 0;
+		b->nr_valid = cache->block_sectors;
 
 		if (!_block_insert(b)) {
         		log_error("bcache unable to insert block in radix tree (OOM?)");
@@ -991,38 +2756,61 @@ static struct block *_new_block(struct bcache *cache, int di, block_address i, b
  *--------------------------------------------------------------*/
 static void _zero_block(struct block *b)
 {
-	b->cache->write_zeroes++;
+	b->cache->stats.write_zeroes++;
 	memset(b->data, 0, b->cache->block_sectors << SECTOR_SHIFT);
+	b->nr_valid = b->cache->block_sectors;
 	_set_flags(b, BF_DIRTY);
 }
 
-static void _hit(struct block *b, unsigned flags)
+/*
+ * The first get of a prefetched block is its first real reference, so
+ * it does not promote the block under 2Q.
+ */
+static void _hit(struct block *b, unsigned flags, bool rereference)
 {
 	struct bcache *cache = b->cache;
+	struct bcache_di_stats *di_stats;
 
 	if (flags & (GF_ZERO | GF_DIRTY))
-		cache->write_hits++;
+		cache->stats.write_hits++;
 	else
-		cache->read_hits++;
+		cache->stats.read_hits++;
+
+	if ((di_stats = _get_di_stats(b->di)))
+		di_stats->hits++;
+
+	if (rereference && (cache->policy == BCACHE_POLICY_2Q))
+		_set_flags(b, BF_HOT);
 
 	_relink(b);
 }
 
-static void _miss(struct bcache *cache, unsigned flags)
+static void _miss(struct bcache *cache, int di, unsigned flags)
 {
+	struct bcache_di_stats *di_stats;
+
 	if (flags & (GF_ZERO | GF_DIRTY))
-		cache->write_misses++;
+		cache->stats.write_misses++;
 	else
-		cache->read_misses++;
+		cache->stats.read_misses++;
+
+	if ((di_stats = _get_di_stats(di)))
+		di_stats->misses++;
 }
 
 static struct block *_lookup_or_read_block(struct bcache *cache,
 				  	   int di, block_address i,
-					   unsigned flags)
+					   sector_t nr_sectors, unsigned flags)
 {
 	struct block *b = _block_lookup(cache, di, i);
+	bool prefetched;
 
 	if (b) {
+		if ((prefetched = _test_flags(b, BF_PREFETCHED)) && !(flags & GF_PEEK)) {
+			_clear_flags(b, BF_PREFETCHED);
+			cache->stats.prefetch_hits++;
+		}
+
 		// FIXME: this is insufficient.  We need to also catch a read
 		// lock of a write locked block.  Ref count needs to distinguish.
 		if (b->ref_count && (flags & (GF_DIRTY | GF_ZERO))) {
@@ -1031,11 +2819,22 @@ static struct block *_lookup_or_read_block(struct bcache *cache,
 		}
 
 		if (_test_flags(b, BF_IO_PENDING)) {
-			_miss(cache, flags);
+			_miss(cache, di, flags);
 			_wait_specific(b);
 
-		} else
-			_hit(b, flags);
+		} else if (b->nr_valid < nr_sectors)
+			_miss(cache, di, flags);
+		else
+			_hit(b, flags, !prefetched && !(flags & GF_PEEK));
+
+		if ((b->nr_valid < nr_sectors) && !b->error && !(flags & GF_ZERO)) {
+			// Only the head of the block was read in by
+			// bcache_prefetch_head(), fetch the whole of it.
+			cache->stats.head_rereads++;
+			b->nr_valid = cache->block_sectors;
+			_issue_read(b);
+			_wait_specific(b);
+		}
 
 		_unlink_block(b);
 
@@ -1043,7 +2842,7 @@ static struct block *_lookup_or_read_block(struct bcache *cache,
 			_zero_block(b);
 
 	} else {
-		_miss(cache, flags);
+		_miss(cache, di, flags);
 
 		b = _new_block(cache, di, i, true);
 		if (b) {
@@ -1056,6 +2855,9 @@ static struct block *_lookup_or_read_block(struct bcache *cache,
 
 				// we know the block is clean and unerrored.
 				_unlink_block(b);
+
+				if (flags & GF_PEEK)
+					_set_flags(b, BF_PREFETCHED);
 			}
 		}
 	}
@@ -1085,7 +2887,7 @@ static void _preemptive_writeback(struct bcache *cache)
  * Public interface
  *--------------------------------------------------------------*/
 struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
-			     struct io_engine *engine)
+			     struct io_engine *engine, enum bcache_policy policy)
 {
 	struct bcache *cache;
 	unsigned max_io = engine->max_io(engine);
@@ -1120,14 +2922,19 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 	cache->nr_cache_blocks = nr_cache_blocks;
 	cache->max_io = nr_cache_blocks < max_io ? nr_cache_blocks : max_io;
 	cache->engine = engine;
+	cache->policy = policy;
 	cache->nr_locked = 0;
 	cache->nr_dirty = 0;
 	cache->nr_io_pending = 0;
+	cache->nr_clean = 0;
+	cache->nr_hot = 0;
 
 	dm_list_init(&cache->free);
+	dm_list_init(&cache->grown);
 	dm_list_init(&cache->errored);
 	dm_list_init(&cache->dirty);
 	dm_list_init(&cache->clean);
+	dm_list_init(&cache->hot);
 	dm_list_init(&cache->io_pending);
 
         cache->rtree = radix_tree_create(NULL, NULL);
@@ -1137,12 +2944,7 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 		return NULL;
 	}
 
-	cache->read_hits = 0;
-	cache->read_misses = 0;
-	cache->write_zeroes = 0;
-	cache->write_hits = 0;
-	cache->write_misses = 0;
-	cache->prefetches = 0;
+	memset(&cache->stats, 0, sizeof(cache->stats));
 
 	if (!_init_free_list(cache, nr_cache_blocks, pgsize)) {
 		cache->engine->destroy(cache->engine);
@@ -1151,6 +2953,11 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 		return NULL;
 	}
 
+	if (engine->register_buffer &&
+	    !engine->register_buffer(engine, cache->raw_data,
+				     nr_cache_blocks * (block_sectors << SECTOR_SHIFT)))
+		log_debug("bcache data not registered with io engine.");
+
 	_fd_table_size = FD_TABLE_INC;
 
 	if (!(_fd_table = malloc(sizeof(int) * _fd_table_size))) {
@@ -1160,6 +2967,15 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 		return NULL;
 	}
 
+	if (!(_di_stats = calloc(_fd_table_size, sizeof(*_di_stats)))) {
+		cache->engine->destroy(cache->engine);
+		radix_tree_destroy(cache->rtree);
+		free(_fd_table);
+		_fd_table = NULL;
+		free(cache);
+		return NULL;
+	}
+
 	for (i = 0; i < _fd_table_size; i++)
 		_fd_table[i] = -1;
 
@@ -1180,6 +2996,8 @@ void bcache_destroy(struct bcache *cache)
 	free(cache);
 	free(_fd_table);
 	_fd_table = NULL;
+	free(_di_stats);
+	_di_stats = NULL;
 	_fd_table_size = 0;
 }
 
@@ -1193,12 +3011,92 @@ unsigned bcache_nr_cache_blocks(struct bcache *cache)
 	return cache->nr_cache_blocks;
 }
 
+bool bcache_grow(struct bcache *cache, unsigned nr_cache_blocks)
+{
+	struct block_chunk *chunk;
+	struct block **write_batch;
+	size_t block_size = cache->block_sectors << SECTOR_SHIFT;
+	unsigned count, i;
+	unsigned max_io;
+	long pgsize = sysconf(_SC_PAGESIZE);
+	unsigned char *data;
+
+	if (nr_cache_blocks <= cache->nr_cache_blocks)
+		return true;
+
+	max_io = cache->engine->max_io(cache->engine);
+
+	if (pgsize < 0)
+		return false;
+
+	count = nr_cache_blocks - cache->nr_cache_blocks;
+
+	/* write_batch is only used within a single bcache call */
+	if (!(write_batch = realloc(cache->write_batch,
+				    nr_cache_blocks * sizeof(*write_batch))))
+		return false;
+	cache->write_batch = write_batch;
+
+	if (!(chunk = malloc(sizeof(*chunk) + count * sizeof(struct block))))
+		return false;
+
+	if (!(data = _alloc_aligned(count * block_size, pgsize))) {
+		free(chunk);
+		return false;
+	}
+
+	chunk->data = data;
+	dm_list_add(&cache->grown, &chunk->list);
+
+	/*
+	 * The new data is not registered with the engine, io to it uses
+	 * the engine's unregistered path.
+	 */
+	for (i = 0; i < count; i++) {
+		struct block *b = chunk->blocks + i;
+		b->cache = cache;
+		b->run = NULL;
+		b->data = data + (block_size * i);
+		dm_list_add(&cache->free, &b->list);
+	}
+
+	cache->nr_cache_blocks = nr_cache_blocks;
+	cache->max_io = nr_cache_blocks < max_io ? nr_cache_blocks : max_io;
+
+	return true;
+}
+
 unsigned bcache_max_prefetches(struct bcache *cache)
 {
 	return cache->max_io;
 }
 
-void bcache_prefetch(struct bcache *cache, int di, block_address i)
+void bcache_get_stats(struct bcache *cache, struct bcache_stats *stats)
+{
+	*stats = cache->stats;
+}
+
+bool bcache_get_di_stats(struct bcache *cache, int di, struct bcache_di_stats *stats)
+{
+	struct bcache_di_stats *di_stats;
+
+	if (!(di_stats = _get_di_stats(di)))
+		return false;
+
+	*stats = *di_stats;
+
+	return true;
+}
+
+static sector_t _clamp_sectors(struct bcache *cache, sector_t nr_sectors)
+{
+	if (!nr_sectors || (nr_sectors > cache->block_sectors))
+		return cache->block_sectors;
+
+	return nr_sectors;
+}
+
+void bcache_prefetch_head(struct bcache *cache, int di, block_address i, sector_t nr_sectors)
 {
 	struct block *b = _block_lookup(cache, di, i);
 
@@ -1206,13 +3104,22 @@ void bcache_prefetch(struct bcache *cache, int di, block_address i)
 		if (cache->nr_io_pending < cache->max_io) {
 			b = _new_block(cache, di, i, false);
 			if (b) {
-				cache->prefetches++;
+				cache->stats.prefetches++;
+				b->nr_valid = _clamp_sectors(cache, nr_sectors);
+				if (b->nr_valid < cache->block_sectors)
+					cache->stats.head_prefetches++;
+				_set_flags(b, BF_PREFETCHED);
 				_issue_read(b);
 			}
 		}
 	}
 }
 
+void bcache_prefetch(struct bcache *cache, int di, block_address i)
+{
+	bcache_prefetch_head(cache, di, i, cache->block_sectors);
+}
+
 //----------------------------------------------------------------
 
 static void _recycle_block(struct bcache *cache, struct block *b)
@@ -1222,15 +3129,19 @@ static void _recycle_block(struct bcache *cache, struct block *b)
 	_free_block(b);
 }
 
-bool bcache_get(struct bcache *cache, int di, block_address i,
-	        unsigned flags, struct block **result)
+bool bcache_get_head(struct bcache *cache, int di, block_address i,
+		     sector_t nr_sectors, unsigned flags, struct block **result)
 {
 	struct block *b;
 
 	if (di >= _fd_table_size)
 		goto bad;
 
-	b = _lookup_or_read_block(cache, di, i, flags);
+	// Anything written back must have been read in full.
+	if (flags & (GF_DIRTY | GF_ZERO))
+		nr_sectors = cache->block_sectors;
+
+	b = _lookup_or_read_block(cache, di, i, _clamp_sectors(cache, nr_sectors), flags);
 	if (b) {
 		if (b->error) {
 			if (b->io_dir == DIR_READ) {
@@ -1256,6 +3167,12 @@ bad:
 	return false;
 }
 
+bool bcache_get(struct bcache *cache, int di, block_address i,
+	        unsigned flags, struct block **result)
+{
+	return bcache_get_head(cache, di, i, cache->block_sectors, flags, result);
+}
+
 //----------------------------------------------------------------
 
 static void _put_ref(struct block *b)
@@ -1280,7 +3197,7 @@ void bcache_put(struct block *b)
 
 //----------------------------------------------------------------
 
-bool bcache_flush(struct bcache *cache)
+void bcache_issue_writes(struct bcache *cache)
 {
 	// Only dirty data is on the errored list, since bad read blocks get
 	// recycled straight away.  So we put these back on the dirty list, and
@@ -1288,20 +3205,49 @@ bool bcache_flush(struct bcache *cache)
 	dm_list_splice(&cache->dirty, &cache->errored);
 
 	while (!dm_list_empty(&cache->dirty)) {
-		struct block *b = dm_list_item(_list_pop(&cache->dirty), struct block);
-		if (b->ref_count || _test_flags(b, BF_IO_PENDING)) {
-			// The superblock may well be still locked.
-			continue;
+		unsigned nr = 0;
+
+		while (!dm_list_empty(&cache->dirty) && (nr < cache->nr_cache_blocks)) {
+			struct block *b = dm_list_item(_list_pop(&cache->dirty), struct block);
+			if (b->ref_count || _test_flags(b, BF_IO_PENDING)) {
+				// The superblock may well be still locked.
+				continue;
+			}
+
+			// Off the list until the write is issued.
+			dm_list_init(&b->list);
+			cache->write_batch[nr++] = b;
 		}
 
-		_issue_write(b);
+		_issue_writes(cache, cache->write_batch, nr);
 	}
+}
 
+bool bcache_wait_writes(struct bcache *cache)
+{
 	_wait_all(cache);
 
 	return dm_list_empty(&cache->errored);
 }
 
+bool bcache_flush(struct bcache *cache)
+{
+	bcache_issue_writes(cache);
+
+	return bcache_wait_writes(cache);
+}
+
+bool bcache_has_write_errors(struct bcache *cache, int di)
+{
+	struct block *b;
+
+	dm_list_iterate_items_gen(b, &cache->errored, list)
+		if (b->di == di)
+			return true;
+
+	return false;
+}
+
 //----------------------------------------------------------------
 /*
  * You can safely call this with a NULL block.
@@ -1462,6 +3408,7 @@ void bcache_unset_last_byte(struct bcache *cache, int di)
 int bcache_set_fd(int fd)
 {
 	int *new_table = NULL;
+	struct bcache_di_stats *new_stats;
 	int new_size = 0;
 	int i;
 
@@ -1469,6 +3416,7 @@ int bcache_set_fd(int fd)
 	for (i = 0; i < _fd_table_size; i++) {
 		if (_fd_table[i] == -1) {
 			_fd_table[i] = fd;
+			memset(_di_stats + i, 0, sizeof(*_di_stats));
 			return i;
 		}
 	}
@@ -1484,11 +3432,17 @@ int bcache_set_fd(int fd)
 		log_error("Cannot extend bcache fd table");
 		return -1;
 	}
+	_fd_table = new_table;
+
+	if (!(new_stats = realloc(_di_stats, sizeof(*_di_stats) * new_size))) {
+		log_error("Cannot extend bcache fd table");
+		return -1;
+	}
+	_di_stats = new_stats;
 
 	for (i = _fd_table_size; i < new_size; i++)
 		new_table[i] = -1;
 
-	_fd_table = new_table;
 	_fd_table_size = new_size;
 
 	goto retry;
@@ -21,6 +21,7 @@
 #include <linux/fs.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/uio.h>
 
 enum dir {
 	DIR_READ,
@@ -38,14 +39,74 @@ struct io_engine {
 		      sector_t sb, sector_t se, void *data, void *context);
 	bool (*wait)(struct io_engine *e, io_complete_fn fn);
 	unsigned (*max_io)(struct io_engine *e);
+
+	/*
+	 * Optional, may be NULL.  Called once by bcache_create() with the
+	 * block data pool, so the engine can pin it with the kernel.  All
+	 * data pointers later passed to issue() lie within this range.
+	 */
+	bool (*register_buffer)(struct io_engine *e, void *data, size_t len);
+
+	/*
+	 * Optional, may be NULL.  Issues a single io covering the
+	 * contiguous range starting at sector sb, gathered from (or
+	 * scattered to) the nr buffers in vec.  vec must stay valid until
+	 * the io completes, and may be modified by the engine.
+	 */
+	bool (*issue_vec)(struct io_engine *e, enum dir d, int di, sector_t sb,
+			  struct iovec *vec, unsigned nr, void *context);
 };
 
 struct io_engine *create_async_io_engine(void);
 struct io_engine *create_sync_io_engine(void);
 
+/*
+ * A sync engine that does the io in nr_threads worker threads, so it
+ * can have several ios in flight.  Returns NULL if no thread could be
+ * started.
+ */
+struct io_engine *create_thread_io_engine(unsigned nr_threads);
+
+/*
+ * Returns NULL if the running kernel does not support io_uring, or
+ * lvm was built without <linux/io_uring.h>.
+ */
+struct io_engine *create_uring_io_engine(void);
+
+/*
+ * For testing.  Wraps inner, delaying each completion by a simulated
+ * latency.  spec is a comma separated list of:
+ *
+ *   latency=<us>		mean latency of each io [0]
+ *   dist=fixed|uniform|exp	latency distribution [fixed]
+ *   jitter=<us>		uniform: latency +/- jitter
+ *   bw=<KiB/s>			bandwidth shared by all io [unlimited]
+ *   max_io=<n>			lower the inner engine's queue depth
+ *   dev=<major>:<minor>/<us>	latency for one device
+ *   fail=<major>:<minor>/<%>	fail this share of io to one device
+ *   seed=<n>			random seed, runs with the same seed repeat
+ *
+ * Returns NULL for an invalid spec, inner is then still the caller's.
+ */
+struct io_engine *create_delay_io_engine(struct io_engine *inner, const char *spec);
+
+/*
+ * Wraps inner, appending a line to the file at path for every io that
+ * completes.  Each process first writes "# pid <pid> cmd <command>",
+ * then for each io:
+ *
+ *   <issue us> <major>:<minor> <r|w> <offset> <len> <latency us> <error> [<crc> [L]]
+ *
+ * The crc of the data is added for io within the label sectors, with L
+ * if a label was found.  Returns NULL if path cannot be opened, inner is
+ * then still the caller's.
+ */
+struct io_engine *create_trace_io_engine(struct io_engine *inner, const char *path);
+
 /*----------------------------------------------------------------*/
 
 struct bcache;
+struct io_run;
 struct block {
 	/* clients may only access these three fields */
 	int di;
@@ -59,13 +120,32 @@ struct block {
 	unsigned ref_count;
 	int error;
 	enum dir io_dir;
+	sector_t nr_valid;	/* sectors of data read in, see bcache_prefetch_head() */
+	uint64_t issue_ns;	/* for io latency statistics */
+	struct io_run *run;	/* set on the first block of a vectored write */
+};
+
+/*
+ * Eviction policy for clean blocks.
+ *
+ * BCACHE_POLICY_LRU evicts the least recently used block.
+ *
+ * BCACHE_POLICY_2Q keeps blocks that have been referenced more than once
+ * on a separate list, which is only evicted from once the blocks seen
+ * just once no longer dominate the cache.  Use it when one-shot reads
+ * (e.g. scanning the labels of many devices) would otherwise push out
+ * blocks that are about to be re-read.
+ */
+enum bcache_policy {
+	BCACHE_POLICY_LRU,
+	BCACHE_POLICY_2Q
 };
 
 /*
  * Ownership of engine passes.  Engine will be destroyed even if this fails.
  */
 struct bcache *bcache_create(sector_t block_size, unsigned nr_cache_blocks,
-			     struct io_engine *engine);
+			     struct io_engine *engine, enum bcache_policy policy);
 void bcache_destroy(struct bcache *cache);
 
 enum bcache_get_flags {
@@ -80,13 +160,78 @@ enum bcache_get_flags {
 	 * Indicates the caller is intending to change the data in the block, a
 	 * writeback will occur after the block is released.
 	 */
-	GF_DIRTY = (1 << 1)
+	GF_DIRTY = (1 << 1),
+
+	/*
+	 * A look at the block that does not count as a reference for the
+	 * cache policy.  A block that was prefetched, or read in by this
+	 * get, is left as not yet got, so the next get of it is not taken
+	 * for a re-reference.
+	 */
+	GF_PEEK = (1 << 2)
 };
 
 sector_t bcache_block_sectors(struct bcache *cache);
 unsigned bcache_nr_cache_blocks(struct bcache *cache);
+
+/*
+ * Adds free blocks until the cache holds nr_cache_blocks.  Existing
+ * blocks are not moved.  Must not be called while blocks are being
+ * written back.
+ */
+bool bcache_grow(struct bcache *cache, unsigned nr_cache_blocks);
 unsigned bcache_max_prefetches(struct bcache *cache);
 
+/*
+ * Statistics, reset when the cache is created.
+ *
+ * Latencies are measured from issue to completion of each io and
+ * collected in log2 buckets of microseconds, so bucket i counts io
+ * taking [2^(i-1), 2^i) us (bucket 0 is anything below 1us).
+ */
+#define BCACHE_LATENCY_BUCKETS 32
+
+struct bcache_stats {
+	uint64_t read_hits;
+	uint64_t read_misses;
+	uint64_t write_hits;
+	uint64_t write_misses;
+	uint64_t write_zeroes;
+	uint64_t prefetches;
+	uint64_t prefetch_hits;		/* gets satisfied by an earlier prefetch */
+	uint64_t evictions;		/* clean blocks recycled for new data */
+	uint64_t writebacks;		/* dirty blocks written in the background */
+	uint64_t vec_writes;		/* vectored writes of adjacent dirty blocks */
+	uint64_t head_prefetches;	/* prefetches of just the head of a block */
+	uint64_t head_rereads;		/* head prefetches later read in full */
+
+	uint64_t reads_issued;
+	uint64_t writes_issued;
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+	uint64_t io_errors;
+
+	uint64_t read_latency[BCACHE_LATENCY_BUCKETS];
+	uint64_t write_latency[BCACHE_LATENCY_BUCKETS];
+};
+
+/*
+ * Per descriptor counters, reset when the di is handed out by
+ * bcache_set_fd().
+ */
+struct bcache_di_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t reads_issued;
+	uint64_t writes_issued;
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+	uint64_t io_errors;
+};
+
+void bcache_get_stats(struct bcache *cache, struct bcache_stats *stats);
+bool bcache_get_di_stats(struct bcache *cache, int di, struct bcache_di_stats *stats);
+
 /*
  * Use the prefetch method to take advantage of asynchronous IO.  For example,
  * if you wanted to read a block from many devices concurrently you'd do
@@ -113,6 +258,19 @@ void bcache_prefetch(struct bcache *cache, int di, block_address index);
  */
 bool bcache_get(struct bcache *cache, int di, block_address index,
 	        unsigned flags, struct block **result);
+
+/*
+ * Variants for callers that only look at the start of a block, such as
+ * label scanning.  bcache_prefetch_head() reads in just the first
+ * nr_sectors of the block.  bcache_get_head() only guarantees that the
+ * first nr_sectors of b->data are valid, reading the rest of the block
+ * if a head prefetch did not cover them.  A nr_sectors of zero means the
+ * whole block, and GF_DIRTY or GF_ZERO always get the whole block.
+ */
+void bcache_prefetch_head(struct bcache *cache, int di, block_address index,
+			  sector_t nr_sectors);
+bool bcache_get_head(struct bcache *cache, int di, block_address index,
+		     sector_t nr_sectors, unsigned flags, struct block **result);
 void bcache_put(struct block *b);
 
 /*
@@ -121,6 +279,17 @@ void bcache_put(struct block *b);
  */
 bool bcache_flush(struct bcache *cache);
 
+/*
+ * flush() is issue_writes() followed by wait_writes().  Issuing without
+ * waiting lets writes to several devices be in flight together.
+ * wait_writes() waits for all outstanding io and fails if any dirty
+ * data could not be written; has_write_errors() tells whether that
+ * includes data on the given device.
+ */
+void bcache_issue_writes(struct bcache *cache);
+bool bcache_wait_writes(struct bcache *cache);
+bool bcache_has_write_errors(struct bcache *cache, int di);
+
 /*
  * Removes a block from the cache.
  * 
@@ -146,7 +315,7 @@ bool bcache_invalidate_di(struct bcache *cache, int di);
 void bcache_abort_di(struct bcache *cache, int di);
 
 //----------------------------------------------------------------
-// The next four functions are utilities written in terms of the above api.
+// The next functions are utilities written in terms of the above api.
  
 // Prefetches the blocks neccessary to satisfy a byte range.
 void bcache_prefetch_bytes(struct bcache *cache, int di, uint64_t start, size_t len);
@@ -158,6 +327,19 @@ bool bcache_zero_bytes(struct bcache *cache, int di, uint64_t start, size_t len)
 bool bcache_set_bytes(struct bcache *cache, int di, uint64_t start, size_t len, uint8_t val);
 bool bcache_invalidate_bytes(struct bcache *cache, int di, uint64_t start, size_t len);
 
+// Calls fn on each run of bytes in the range in turn, straight from the
+// cached blocks, so the data can be checksummed or scanned without a copy.
+// Stops and returns false if fn does.
+typedef bool (*bcache_bytes_fn)(void *context, const void *data, size_t len);
+bool bcache_walk_bytes(struct bcache *cache, int di, uint64_t start, size_t len,
+		       bcache_bytes_fn fn, void *context);
+
+// Pins the block holding a byte range and points data at the bytes, for
+// ranges that do not cross a block boundary (returns false otherwise).
+// The data is only valid until the block is released with bcache_put().
+bool bcache_get_bytes(struct bcache *cache, int di, uint64_t start, size_t len,
+		      struct block **result, const void **data);
+
 void bcache_set_last_byte(struct bcache *cache, int di, uint64_t offset, int sector_size);
 void bcache_unset_last_byte(struct bcache *cache, int di);
 
@@ -16,11 +16,13 @@
 #include "base/memory/zalloc.h"
 #include "lib/misc/lib.h"
 #include "lib/device/dev-type.h"
-#include "lib/datastruct/btree.h"
+#include "base/data-struct/radix-tree.h"
+#include "base/memory/container_of.h"
 #include "lib/config/config.h"
 #include "lib/commands/toolcontext.h"
 #include "device_mapper/misc/dm-ioctl.h"
 #include "lib/misc/lvm-string.h"
+#include "lib/log/timing.h"
 
 #ifdef UDEV_SYNC_SUPPORT
 #include <libudev.h>
@@ -29,8 +31,10 @@
 #include <dirent.h>
 
 struct dev_iter {
-	struct btree_iter *current;
 	struct dev_filter *filter;
+	unsigned nr;
+	unsigned current;
+	struct device *devs[];
 };
 
 struct dir_list {
@@ -40,15 +44,18 @@ struct dir_list {
 
 static struct {
 	struct dm_pool *mem;
-	struct dm_hash_table *names;
+	struct dm_flat_hash *names;
 	struct dm_hash_table *vgid_index;
 	struct dm_hash_table *lvid_index;
-	struct btree *sysfs_only_devices; /* see comments in _get_device_for_sysfs_dev_name_using_devno */
-	struct btree *devices;
+	struct radix_tree *sysfs_only_devices; /* see comments in _get_device_for_sysfs_dev_name_using_devno */
+	struct radix_tree *devices;
 	struct dm_regex *preferred_names_matcher;
 	const char *dev_dir;
 
 	int has_scanned;
+	unsigned scan_count;
+	uint64_t scan_signature;	/* block devices at the last scan */
+	int scan_signature_valid;
 	struct dm_list dirs;
 	struct dm_list files;
 
@@ -58,6 +65,67 @@ static struct {
 #define _free(x) dm_pool_free(_cache.mem, (x))
 #define _strdup(x) dm_pool_strdup(_cache.mem, (x))
 
+/*
+ * Devices are indexed by devno in radix trees.  The key is the devno
+ * stored big-endian, so iteration visits devices in major:minor order.
+ */
+#define DEVNO_KEY_LEN sizeof(uint64_t)
+
+static void _devno_key(dev_t devno, uint8_t *k)
+{
+	uint64_t d = (uint64_t) devno;
+	int i;
+
+	for (i = DEVNO_KEY_LEN - 1; i >= 0; i--, d >>= 8)
+		k[i] = d & 0xff;
+}
+
+static struct device *_devno_lookup(struct radix_tree *rt, dev_t devno)
+{
+	uint8_t k[DEVNO_KEY_LEN];
+	union radix_value v;
+
+	_devno_key(devno, k);
+
+	if (!radix_tree_lookup(rt, k, k + sizeof(k), &v))
+		return NULL;
+
+	return v.ptr;
+}
+
+static int _devno_insert(struct radix_tree *rt, dev_t devno, struct device *dev)
+{
+	uint8_t k[DEVNO_KEY_LEN];
+	union radix_value v = { .ptr = dev };
+
+	_devno_key(devno, k);
+
+	return radix_tree_insert(rt, k, k + sizeof(k), v);
+}
+
+struct dev_visitor {
+	struct radix_tree_iterator it;
+	/* Returns 0 to end the iteration */
+	int (*fn)(struct dev_visitor *dv, struct device *dev);
+	void *context;
+	int r;
+};
+
+static bool _visit_dev(struct radix_tree_iterator *it,
+		       uint8_t *kb, uint8_t *ke, union radix_value v)
+{
+	struct dev_visitor *dv = container_of(it, struct dev_visitor, it);
+
+	return dv->fn(dv, v.ptr) ? true : false;
+}
+
+/* Calls dv->fn for every device in _cache.devices, in devno order */
+static void _iterate_devs(struct dev_visitor *dv)
+{
+	dv->it.visit = _visit_dev;
+	radix_tree_iterate(_cache.devices, NULL, NULL, &dv->it);
+}
+
 static int _insert(const char *path, const struct stat *info,
 		   int rec, int check_with_udev_db);
 
@@ -161,6 +229,7 @@ void dev_set_preferred_name(struct dm_str_list *sl, struct device *dev)
 	log_debug_devs("%s: New preferred name", sl->str);
 	dm_list_del(&sl->list);
 	dm_list_add_h(&dev->aliases, &sl->list);
+	dev->flags &= ~DEV_ALIASES_UNSORTED;
 }
 
 /*
@@ -321,12 +390,101 @@ static int _compare_paths(const char *path0, const char *path1)
 	return 1;
 }
 
+/*
+ * Rank of a path by the preferred_names patterns, the built-in rules and
+ * the number of slashes, which decide between most paths in
+ * _compare_paths() without calling stat.  Lower values are preferred.
+ */
+struct path_rank {
+	int match;
+	int builtin;
+	int slashes;
+};
+
+static void _get_path_rank(const char *path, struct path_rank *rank)
+{
+	size_t devdir_len = strlen(_cache.dev_dir);
+	const char *p;
+	int m;
+
+	rank->match = INT_MAX;
+	if (_cache.preferred_names_matcher &&
+	    ((m = dm_regex_match(_cache.preferred_names_matcher, path)) >= 0))
+		rank->match = m;
+
+	/* /dev/block/ < /dev/dm-* < /dev/disk/ < /dev/mapper/ < anything else */
+	rank->builtin = 0;
+	if (!strncmp(path, _cache.dev_dir, devdir_len)) {
+		if (!strncmp(path + devdir_len, "block/", 6))
+			rank->builtin = 4;
+		else if (!strncmp(path + devdir_len, "dm-", 3))
+			rank->builtin = 3;
+		else if (!strncmp(path + devdir_len, "disk/", 5))
+			rank->builtin = 2;
+		else if (!strncmp(path, dm_dir(), strlen(dm_dir())))
+			rank->builtin = 1;
+	}
+
+	rank->slashes = 0;
+	for (p = path; p++; p = (const char *) strchr(p, '/'))
+		rank->slashes++;
+}
+
+static int _cmp_path_rank(const struct path_rank *r0, const struct path_rank *r1)
+{
+	if (r0->match != r1->match)
+		return (r0->match < r1->match) ? -1 : 1;
+
+	if (r0->builtin != r1->builtin)
+		return (r0->builtin < r1->builtin) ? -1 : 1;
+
+	if (r0->slashes != r1->slashes)
+		return (r0->slashes < r1->slashes) ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * Move the preferred alias to the head of the list.  Each alias is
+ * ranked once, and only aliases tied for the best rank are compared
+ * with _compare_paths(), which may lstat them.
+ */
+static void _sort_aliases(struct device *dev)
+{
+	struct dm_str_list *strl, *best = NULL;
+	struct path_rank rank, best_rank;
+	int r;
+
+	dev->flags &= ~DEV_ALIASES_UNSORTED;
+
+	dm_list_iterate_items(strl, &dev->aliases) {
+		_get_path_rank(strl->str, &rank);
+
+		if (best) {
+			if ((r = _cmp_path_rank(&rank, &best_rank)) > 0)
+				continue;
+			if (!r && !_compare_paths(best->str, strl->str))
+				continue;
+		}
+
+		best = strl;
+		best_rank = rank;
+	}
+
+	if (best && (&best->list != dev->aliases.n)) {
+		dm_list_del(&best->list);
+		dm_list_add_h(&dev->aliases, &best->list);
+	}
+}
+
+/*
+ * The preferred name is chosen by _sort_aliases() when dev_name()
+ * is first used after aliases were added, not on every insert.
+ */
 static int _add_alias(struct device *dev, const char *path)
 {
 	struct dm_str_list *sl = _zalloc(sizeof(*sl));
 	struct dm_str_list *strl;
-	const char *oldpath;
-	int prefer_old = 1;
 
 	if (!sl)
 		return_0;
@@ -339,15 +497,10 @@ static int _add_alias(struct device *dev, const char *path)
 
 	sl->str = path;
 
-	if (!dm_list_empty(&dev->aliases)) {
-		oldpath = dm_list_item(dev->aliases.n, struct dm_str_list)->str;
-		prefer_old = _compare_paths(path, oldpath);
-	}
+	if (!dm_list_empty(&dev->aliases))
+		dev->flags |= DEV_ALIASES_UNSORTED;
 
-	if (prefer_old)
-		dm_list_add(&dev->aliases, &sl->list);
-	else
-		dm_list_add_h(&dev->aliases, &sl->list);
+	dm_list_add(&dev->aliases, &sl->list);
 
 	return 1;
 }
@@ -452,8 +605,8 @@ static struct device *_insert_sysfs_dev(dev_t devno, const char *devname)
 		return NULL;
 	}
 
-	if (!btree_insert(_cache.sysfs_only_devices, (uint32_t) devno, dev)) {
-		log_error("Couldn't add device to binary tree of sysfs-only devices in dev cache.");
+	if (!_devno_insert(_cache.sysfs_only_devices, devno, dev)) {
+		log_error("Couldn't add device to index of sysfs-only devices in dev cache.");
 		_free(dev);
 		return NULL;
 	}
@@ -483,7 +636,7 @@ static struct device *_get_device_for_sysfs_dev_name_using_devno(const char *dev
 	}
 
 	devno = MKDEV(major, minor);
-	if (!(dev = (struct device *) btree_lookup(_cache.devices, (uint32_t) devno))) {
+	if (!(dev = (struct device *) _devno_lookup(_cache.devices, devno))) {
 		/*
 		 * If we get here, it means the device is referenced in sysfs, but it's not yet in /dev.
 		 * This may happen in some rare cases right after LVs get created - we sync with udev
@@ -495,7 +648,7 @@ static struct device *_get_device_for_sysfs_dev_name_using_devno(const char *dev
 		 * where different directory for dev nodes is used (e.g. our test suite). So track
 		 * such devices in _cache.sysfs_only_devices hash for the vgid/lvid check to work still.
 		 */
-		if (!(dev = (struct device *) btree_lookup(_cache.sysfs_only_devices, (uint32_t) devno)) &&
+		if (!(dev = (struct device *) _devno_lookup(_cache.sysfs_only_devices, devno)) &&
 		    !(dev = _insert_sysfs_dev(devno, devname)))
 			return_NULL;
 	}
@@ -577,7 +730,7 @@ static int _index_dev_by_vgid_and_lvid(struct device *dev)
 			goto out;
 		}
 
-		if (!(holder_dev = (struct device *) dm_hash_lookup(_cache.names, devpath))) {
+		if (!(holder_dev = (struct device *) dm_flat_hash_lookup(_cache.names, devpath))) {
 			/*
 			 * Cope with situation where canonical /<dev_dir>/<dirent->d_name>
 			 * does not exist, but some other node name or symlink exists in
@@ -671,8 +824,8 @@ void dev_cache_failed_path(struct device *dev, const char *path)
 {
 	struct dm_str_list *strl;
 
-	if (dm_hash_lookup(_cache.names, path))
-		dm_hash_remove(_cache.names, path);
+	if (dm_flat_hash_lookup(_cache.names, path))
+		dm_flat_hash_remove(_cache.names, path);
 
 	dm_list_iterate_items(strl, &dev->aliases) {
 		if (!strcmp(strl->str, path)) {
@@ -693,8 +846,8 @@ static int _insert_dev(const char *path, dev_t d)
 	struct device *dev_by_path;
 	char *path_copy;
 
-	dev_by_devt = (struct device *) btree_lookup(_cache.devices, (uint32_t) d);
-	dev_by_path = (struct device *) dm_hash_lookup(_cache.names, path);
+	dev_by_devt = _devno_lookup(_cache.devices, d);
+	dev_by_path = (struct device *) dm_flat_hash_lookup(_cache.names, path);
 	dev = dev_by_devt;
 
 	/*
@@ -713,14 +866,14 @@ static int _insert_dev(const char *path, dev_t d)
 		log_debug_devs("Found dev %d:%d %s - new.",
 			       (int)MAJOR(d), (int)MINOR(d), path);
 
-		if (!(dev = (struct device *) btree_lookup(_cache.sysfs_only_devices, (uint32_t) d))) {
+		if (!(dev = _devno_lookup(_cache.sysfs_only_devices, d))) {
 			/* create new device */
 			if (!(dev = _dev_create(d)))
 				return_0;
 		}
 
-		if (!(btree_insert(_cache.devices, (uint32_t) d, dev))) {
-			log_error("Couldn't insert device into binary tree.");
+		if (!_devno_insert(_cache.devices, d, dev)) {
+			log_error("Couldn't insert device into dev cache index.");
 			_free(dev);
 			return 0;
 		}
@@ -735,7 +888,7 @@ static int _insert_dev(const char *path, dev_t d)
 			return 0;
 		}
 
-		if (!dm_hash_insert(_cache.names, path_copy, dev)) {
+		if (!dm_flat_hash_insert(_cache.names, path_copy, dev)) {
 			log_error("Couldn't add name to hash in dev cache.");
 			return 0;
 		}
@@ -760,7 +913,7 @@ static int _insert_dev(const char *path, dev_t d)
 			return 0;
 		}
 
-		if (!dm_hash_insert(_cache.names, path_copy, dev)) {
+		if (!dm_flat_hash_insert(_cache.names, path_copy, dev)) {
 			log_error("Couldn't add name to hash in dev cache.");
 			return 0;
 		}
@@ -777,14 +930,14 @@ static int _insert_dev(const char *path, dev_t d)
 			       (int)MAJOR(d), (int)MINOR(d), path,
 			       (int)MAJOR(dev_by_path->dev), (int)MINOR(dev_by_path->dev));
 
-		if (!(dev = (struct device *) btree_lookup(_cache.sysfs_only_devices, (uint32_t) d))) {
+		if (!(dev = _devno_lookup(_cache.sysfs_only_devices, d))) {
 			/* create new device */
 			if (!(dev = _dev_create(d)))
 				return_0;
 		}
 
-		if (!(btree_insert(_cache.devices, (uint32_t) d, dev))) {
-			log_error("Couldn't insert device into binary tree.");
+		if (!_devno_insert(_cache.devices, d, dev)) {
+			log_error("Couldn't insert device into dev cache index.");
 			_free(dev);
 			return 0;
 		}
@@ -799,9 +952,9 @@ static int _insert_dev(const char *path, dev_t d)
 			return 0;
 		}
 
-		dm_hash_remove(_cache.names, path);
+		dm_flat_hash_remove(_cache.names, path);
 
-		if (!dm_hash_insert(_cache.names, path_copy, dev)) {
+		if (!dm_flat_hash_insert(_cache.names, path_copy, dev)) {
 			log_error("Couldn't add name to hash in dev cache.");
 			return 0;
 		}
@@ -829,9 +982,9 @@ static int _insert_dev(const char *path, dev_t d)
 			return 0;
 		}
 
-		dm_hash_remove(_cache.names, path);
+		dm_flat_hash_remove(_cache.names, path);
 
-		if (!dm_hash_insert(_cache.names, path_copy, dev)) {
+		if (!dm_flat_hash_insert(_cache.names, path_copy, dev)) {
 			log_error("Couldn't add name to hash in dev cache.");
 			return 0;
 		}
@@ -904,22 +1057,80 @@ static int _insert_dir(const char *dir)
 	return r;
 }
 
-static int _dev_cache_iterate_devs_for_index(void)
+/*
+ * Populate the cache from one pass over <sysfs>/dev/block instead of
+ * walking the scan directories, which on hosts with many paths mostly
+ * contain /dev/disk/by-* symlinks that all need a stat.  Each device
+ * gets only its canonical name: /dev/mapper/<name> for dm devices and
+ * /dev/<kernel name> for others.  Other names are added when they are
+ * used, e.g. on the command line through dev_cache_get().
+ */
+static int _insert_sysfs_devs(void)
 {
-	struct btree_iter *iter = btree_first(_cache.devices);
-	struct device *dev;
+	char dir[PATH_MAX], path[PATH_MAX], devname[PATH_MAX];
+	struct dirent *dirent;
+	DIR *d;
+	int major, minor;
+	char *p;
 	int r = 1;
 
-	while (iter) {
-		dev = btree_get_data(iter);
+	if (dm_snprintf(dir, sizeof(dir), "%sdev/block", dm_sysfs_dir()) < 0) {
+		log_error("_insert_sysfs_devs: dm_snprintf failed.");
+		return 0;
+	}
 
-		if (!_index_dev_by_vgid_and_lvid(dev))
-			r = 0;
+	if (!(d = opendir(dir))) {
+		log_sys_very_verbose("opendir", dir);
+		return 0;
+	}
+
+	while ((dirent = readdir(d))) {
+		if (sscanf(dirent->d_name, "%d:%d", &major, &minor) != 2)
+			continue;
 
-		iter = btree_next(iter);
+		if (!dm_device_get_name(major, minor, 0, devname, sizeof(devname))) {
+			log_debug_devs("%d:%d: Failed to get device name from sysfs.", major, minor);
+			continue;
+		}
+
+		/* Kernel names use '!' for '/' (e.g. cciss!c0d0) */
+		for (p = devname; (p = strchr(p, '!')); p++)
+			*p = '/';
+
+		if ((dm_is_dm_major(major) ?
+		     dm_snprintf(path, sizeof(path), "%s/%s", dm_dir(), devname) :
+		     dm_snprintf(path, sizeof(path), "%s%s", _cache.dev_dir, devname)) < 0) {
+			log_debug_devs("%s: Device path is too long.", devname);
+			continue;
+		}
+
+		r &= _insert_dev(path, MKDEV(major, minor));
 	}
 
-	return r;
+	if (closedir(d))
+		log_sys_debug("closedir", dir);
+
+	if (!r)
+		log_debug_devs("Failed to insert devices from sysfs to device cache fully.");
+
+	return 1;
+}
+
+static int _index_dev_visit(struct dev_visitor *dv, struct device *dev)
+{
+	if (!_index_dev_by_vgid_and_lvid(dev))
+		dv->r = 0;
+
+	return 1;
+}
+
+static int _dev_cache_iterate_devs_for_index(void)
+{
+	struct dev_visitor dv = { .fn = _index_dev_visit, .r = 1 };
+
+	_iterate_devs(&dv);
+
+	return dv.r;
 }
 
 static int _dev_cache_iterate_sysfs_for_index(const char *path)
@@ -951,8 +1162,8 @@ static int _dev_cache_iterate_sysfs_for_index(const char *path)
 		}
 
 		devno = MKDEV(major, minor);
-		if (!(dev = (struct device *) btree_lookup(_cache.devices, (uint32_t) devno)) &&
-		    !(dev = (struct device *) btree_lookup(_cache.sysfs_only_devices, (uint32_t) devno))) {
+		if (!(dev = (struct device *) _devno_lookup(_cache.devices, devno)) &&
+		    !(dev = (struct device *) _devno_lookup(_cache.sysfs_only_devices, devno))) {
 			if (!dm_device_get_name(major, minor, 1, devname, sizeof(devname)) ||
 			    !(dev = _insert_sysfs_dev(devno, devname))) {
 				partial_failure = 1;
@@ -1174,11 +1385,91 @@ void dev_cache_scan(void)
 {
 	log_debug_devs("Creating list of system devices.");
 
+	timing_start(TIMING_DEV_CACHE_SCAN);
+
 	_cache.has_scanned = 1;
+	_cache.scan_count++;
+
+	udev_dev_cache_destroy();
 
-	_insert_dirs(&_cache.dirs);
+	if (!obtain_device_list_from_sysfs() || !_insert_sysfs_devs())
+		_insert_dirs(&_cache.dirs);
 
 	(void) dev_cache_index_devs();
+
+	timing_end(TIMING_DEV_CACHE_SCAN);
+}
+
+/*
+ * A cheap summary of the block devices on the system: the devnos listed
+ * in <sysfs>/dev/block and the mtime of the dm directory, which changes
+ * when a dm device is renamed.
+ */
+static int _scan_signature(uint64_t *sig)
+{
+	char dir[PATH_MAX];
+	struct dirent *dirent;
+	struct stat info;
+	const char *c;
+	uint64_t h, sum = 0;
+	unsigned count = 0;
+	DIR *d;
+
+	if (dm_snprintf(dir, sizeof(dir), "%sdev/block", dm_sysfs_dir()) < 0)
+		return 0;
+
+	if (!(d = opendir(dir)))
+		return 0;
+
+	/* Order independent, readdir order is not guaranteed */
+	while ((dirent = readdir(d))) {
+		if (dirent->d_name[0] == '.')
+			continue;
+		for (h = 14695981039346656037ULL, c = dirent->d_name; *c; c++)
+			h = (h ^ (unsigned char) *c) * 1099511628211ULL;
+		sum += h;
+		count++;
+	}
+
+	if (closedir(d))
+		log_sys_debug("closedir", dir);
+
+	if (stat(dm_dir(), &info))
+		memset(&info, 0, sizeof(info));
+
+	*sig = sum ^ ((uint64_t) count << 48) ^
+		((uint64_t) info.st_mtim.tv_sec * 1000000000ULL + info.st_mtim.tv_nsec);
+
+	return 1;
+}
+
+/*
+ * Used by processes running several commands, like the lvm shell:
+ * the list of devices from an earlier scan is kept while no block
+ * device was added, removed or renamed since.  The scan count is
+ * still bumped so state read from sysfs, like dm holders, is redone.
+ */
+void dev_cache_scan_if_changed(void)
+{
+	uint64_t sig;
+
+	if (!_scan_signature(&sig)) {
+		_cache.scan_signature_valid = 0;
+		dev_cache_scan();
+		return;
+	}
+
+	if (_cache.has_scanned && _cache.scan_signature_valid &&
+	    (sig == _cache.scan_signature)) {
+		log_debug_devs("Block devices unchanged, reusing list of system devices.");
+		_cache.scan_count++;
+		return;
+	}
+
+	dev_cache_scan();
+
+	_cache.scan_signature = sig;
+	_cache.scan_signature_valid = 1;
 }
 
 int dev_cache_has_scanned(void)
@@ -1186,6 +1477,15 @@ int dev_cache_has_scanned(void)
 	return _cache.has_scanned;
 }
 
+/*
+ * Incremented by every dev_cache_scan() so users caching sysfs
+ * state can tell when it may have gone stale.
+ */
+unsigned dev_cache_scan_count(void)
+{
+	return _cache.scan_count;
+}
+
 static int _init_preferred_names(struct cmd_context *cmd)
 {
 	const struct dm_config_node *cn;
@@ -1253,7 +1553,7 @@ int dev_cache_init(struct cmd_context *cmd)
 	if (!(_cache.mem = dm_pool_create("dev_cache", 10 * 1024)))
 		return_0;
 
-	if (!(_cache.names = dm_hash_create(128)) ||
+	if (!(_cache.names = dm_flat_hash_create(128)) ||
 	    !(_cache.vgid_index = dm_hash_create(32)) ||
 	    !(_cache.lvid_index = dm_hash_create(32))) {
 		dm_pool_destroy(_cache.mem);
@@ -1261,13 +1561,13 @@ int dev_cache_init(struct cmd_context *cmd)
 		return_0;
 	}
 
-	if (!(_cache.devices = btree_create(_cache.mem))) {
-		log_error("Couldn't create binary tree for dev-cache.");
+	if (!(_cache.devices = radix_tree_create(NULL, NULL))) {
+		log_error("Couldn't create device index for dev-cache.");
 		goto bad;
 	}
 
-	if (!(_cache.sysfs_only_devices = btree_create(_cache.mem))) {
-		log_error("Couldn't create binary tree for sysfs-only devices in dev cache.");
+	if (!(_cache.sysfs_only_devices = radix_tree_create(NULL, NULL))) {
+		log_error("Couldn't create index of sysfs-only devices in dev cache.");
 		goto bad;
 	}
 
@@ -1294,11 +1594,11 @@ int dev_cache_init(struct cmd_context *cmd)
 static int _check_for_open_devices(int close_immediate)
 {
 	struct device *dev;
-	struct dm_hash_node *n;
+	struct dm_flat_hash_entry *e;
 	int num_open = 0;
 
-	dm_hash_iterate(n, _cache.names) {
-		dev = (struct device *) dm_hash_get_data(_cache.names, n);
+	dm_flat_hash_iterate(e, _cache.names) {
+		dev = (struct device *) dm_flat_hash_get_data(_cache.names, e);
 		if (dev->fd >= 0) {
 			log_error("Device '%s' has been left open (%d remaining references).",
 				  dev_name(dev), dev->open_count);
@@ -1331,7 +1631,13 @@ int dev_cache_exit(void)
 		dm_pool_destroy(_cache.mem);
 
 	if (_cache.names)
-		dm_hash_destroy(_cache.names);
+		dm_flat_hash_destroy(_cache.names);
+
+	if (_cache.devices)
+		radix_tree_destroy(_cache.devices);
+
+	if (_cache.sysfs_only_devices)
+		radix_tree_destroy(_cache.sysfs_only_devices);
 
 	if (_cache.vgid_index)
 		dm_hash_destroy(_cache.vgid_index);
@@ -1339,6 +1645,8 @@ int dev_cache_exit(void)
 	if (_cache.lvid_index)
 		dm_hash_destroy(_cache.lvid_index);
 
+	udev_dev_cache_destroy();
+
 	memset(&_cache, 0, sizeof(_cache));
 
 	return (!num_open);
@@ -1383,6 +1691,9 @@ const char *dev_name_confirmed(struct device *dev, int quiet)
 	if ((dev->flags & DEV_REGULAR))
 		return dev_name(dev);
 
+	if (dev->flags & DEV_ALIASES_UNSORTED)
+		_sort_aliases(dev);
+
 	while ((r = stat(name = dm_list_item(dev->aliases.n,
 					  struct dm_str_list)->str, &buf)) ||
 	       (buf.st_rdev != dev->dev)) {
@@ -1402,7 +1713,7 @@ const char *dev_name_confirmed(struct device *dev, int quiet)
 				 (int) MINOR(dev->dev));
 
 		/* Remove the incorrect hash entry */
-		dm_hash_remove(_cache.names, name);
+		dm_flat_hash_remove(_cache.names, name);
 
 		/* Leave list alone if there isn't an alternative name */
 		/* so dev_name will always find something to return. */
@@ -1425,13 +1736,13 @@ const char *dev_name_confirmed(struct device *dev, int quiet)
 
 struct device *dev_hash_get(const char *name)
 {
-	return (struct device *) dm_hash_lookup(_cache.names, name);
+	return (struct device *) dm_flat_hash_lookup(_cache.names, name);
 }
 
 struct device *dev_cache_get(struct cmd_context *cmd, const char *name, struct dev_filter *f)
 {
 	struct stat buf;
-	struct device *d = (struct device *) dm_hash_lookup(_cache.names, name);
+	struct device *d = (struct device *) dm_flat_hash_lookup(_cache.names, name);
 	int info_available = 0;
 	int ret = 1;
 
@@ -1441,24 +1752,24 @@ struct device *dev_cache_get(struct cmd_context *cmd, const char *name, struct d
 	/* If the entry's wrong, remove it */
 	if (stat(name, &buf) < 0) {
 		if (d)
-			dm_hash_remove(_cache.names, name);
+			dm_flat_hash_remove(_cache.names, name);
 		log_sys_very_verbose("stat", name);
 		d = NULL;
 	} else
 		info_available = 1;
 
 	if (d && (buf.st_rdev != d->dev)) {
-		dm_hash_remove(_cache.names, name);
+		dm_flat_hash_remove(_cache.names, name);
 		d = NULL;
 	}
 
 	if (!d) {
 		_insert(name, info_available ? &buf : NULL, 0, obtain_device_list_from_udev());
-		d = (struct device *) dm_hash_lookup(_cache.names, name);
+		d = (struct device *) dm_flat_hash_lookup(_cache.names, name);
 		if (!d) {
 			log_debug_devs("Device name not found in dev_cache repeat dev_cache_scan for %s", name);
 			dev_cache_scan();
-			d = (struct device *) dm_hash_lookup(_cache.names, name);
+			d = (struct device *) dm_flat_hash_lookup(_cache.names, name);
 		}
 	}
 
@@ -1484,29 +1795,12 @@ struct device *dev_cache_get(struct cmd_context *cmd, const char *name, struct d
 	return d;
 }
 
-static struct device *_dev_cache_seek_devt(dev_t dev)
-{
-	struct device *d = NULL;
-	struct dm_hash_node *n = dm_hash_get_first(_cache.names);
-	while (n) {
-		d = dm_hash_get_data(_cache.names, n);
-		if (d->dev == dev)
-			return d;
-		n = dm_hash_get_next(_cache.names, n);
-	}
-	return NULL;
-}
-
-/*
- * TODO This is very inefficient. We probably want a hash table indexed by
- * major:minor for keys to speed up these lookups.
- */
 struct device *dev_cache_get_by_devt(struct cmd_context *cmd, dev_t dev, struct dev_filter *f, int *filtered)
 {
 	char path[PATH_MAX];
 	const char *sysfs_dir;
 	struct stat info;
-	struct device *d = _dev_cache_seek_devt(dev);
+	struct device *d = _devno_lookup(_cache.devices, dev);
 	int ret;
 
 	if (filtered)
@@ -1535,7 +1829,7 @@ struct device *dev_cache_get_by_devt(struct cmd_context *cmd, dev_t dev, struct
 		log_debug_devs("Device num not found in dev_cache repeat dev_cache_scan for %d:%d",
 				(int)MAJOR(dev), (int)MINOR(dev));
 		dev_cache_scan();
-		d = _dev_cache_seek_devt(dev);
+		d = _devno_lookup(_cache.devices, dev);
 	}
 
 	if (!d)
@@ -1563,16 +1857,35 @@ struct device *dev_cache_get_by_devt(struct cmd_context *cmd, dev_t dev, struct
 	return NULL;
 }
 
+static int _collect_dev_visit(struct dev_visitor *dv, struct device *dev)
+{
+	struct dev_iter *di = dv->context;
+
+	di->devs[di->nr++] = dev;
+
+	return 1;
+}
+
+/*
+ * The iterator takes a snapshot of the devices, so devices added to
+ * the cache while iterating are not visited.
+ */
 struct dev_iter *dev_iter_create(struct dev_filter *f, int unused)
 {
-	struct dev_iter *di = malloc(sizeof(*di));
+	unsigned nr = radix_tree_size(_cache.devices);
+	struct dev_iter *di = malloc(sizeof(*di) + nr * sizeof(di->devs[0]));
+	struct dev_visitor dv = { .fn = _collect_dev_visit };
 
 	if (!di) {
 		log_error("dev_iter allocation failed");
 		return NULL;
 	}
 
-	di->current = btree_first(_cache.devices);
+	di->nr = 0;
+	di->current = 0;
+	dv.context = di;
+	_iterate_devs(&dv);
+
 	di->filter = f;
 	if (di->filter)
 		di->filter->use_count++;
@@ -1589,9 +1902,7 @@ void dev_iter_destroy(struct dev_iter *iter)
 
 static struct device *_iter_next(struct dev_iter *iter)
 {
-	struct device *d = btree_get_data(iter->current);
-	iter->current = btree_next(iter->current);
-	return d;
+	return iter->devs[iter->current++];
 }
 
 struct device *dev_iter_get(struct cmd_context *cmd, struct dev_iter *iter)
@@ -1599,7 +1910,7 @@ struct device *dev_iter_get(struct cmd_context *cmd, struct dev_iter *iter)
 	struct dev_filter *f;
 	int ret;
 
-	while (iter->current) {
+	while (iter->current < iter->nr) {
 		struct device *d = _iter_next(iter);
 		ret = 1;
 
@@ -1629,23 +1940,28 @@ int dev_fd(struct device *dev)
 
 const char *dev_name(const struct device *dev)
 {
+	if (dev && (dev->flags & DEV_ALIASES_UNSORTED))
+		_sort_aliases((struct device *) dev);
+
 	return (dev && dev->aliases.n) ? dm_list_item(dev->aliases.n, struct dm_str_list)->str :
 	    unknown_device_name();
 }
 
-bool dev_cache_has_md_with_end_superblock(struct dev_types *dt)
+static int _md_end_visit(struct dev_visitor *dv, struct device *dev)
 {
-	struct btree_iter *iter = btree_first(_cache.devices);
-	struct device *dev;
+	if (dev_is_md_with_end_superblock(dv->context, dev)) {
+		dv->r = 1;
+		return 0;
+	}
 
-	while (iter) {
-		dev = btree_get_data(iter);
+	return 1;
+}
 
-		if (dev_is_md_with_end_superblock(dt, dev))
-			return true;
+bool dev_cache_has_md_with_end_superblock(struct dev_types *dt)
+{
+	struct dev_visitor dv = { .fn = _md_end_visit, .context = dt };
 
-		iter = btree_next(iter);
-	}
+	_iterate_devs(&dv);
 
-	return false;
+	return dv.r ? true : false;
 }
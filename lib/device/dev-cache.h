@@ -22,6 +22,18 @@
 
 struct cmd_context;
 
+/*
+ * What a filter looks at to decide, cheapest first.
+ * The composite filter runs its filters in this order.
+ */
+typedef enum {
+	FILTER_COST_NAME,	/* device name, devno or in-memory state */
+	FILTER_COST_SYSFS,	/* sysfs lookups */
+	FILTER_COST_EXT,	/* external device info like the udev db */
+	FILTER_COST_IOCTL,	/* opens the device */
+	FILTER_COST_DATA	/* device data read by label scan */
+} filter_cost_t;
+
 /*
  * predicate for devices.
  */
@@ -32,6 +44,7 @@ struct dev_filter {
 	void *private;
 	unsigned use_count;
 	const char *name;
+	filter_cost_t cost;
 };
 
 int dev_cache_index_devs(void);
@@ -50,7 +63,9 @@ int dev_cache_exit(void);
 int dev_cache_check_for_open_devices(void);
 
 void dev_cache_scan(void);
+void dev_cache_scan_if_changed(void);
 int dev_cache_has_scanned(void);
+unsigned dev_cache_scan_count(void);
 
 int dev_cache_add_dir(const char *path);
 struct device *dev_cache_get(struct cmd_context *cmd, const char *name, struct dev_filter *f);
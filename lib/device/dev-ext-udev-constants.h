@@ -31,7 +31,10 @@
 /* FW RAIDs are all *_raid_member types except linux_raid_member which denotes SW RAID */
 #define DEV_EXT_UDEV_BLKID_TYPE_RAID_SUFFIX     "_raid_member"
 #define DEV_EXT_UDEV_BLKID_TYPE_SW_RAID         "linux_raid_member"
+#define DEV_EXT_UDEV_BLKID_TYPE_LVM2            "LVM2_member"
 #define DEV_EXT_UDEV_BLKID_PART_TABLE_TYPE      "ID_PART_TABLE_TYPE"
+/* the PVID of an LVM2_member, in the dashed uuid format */
+#define DEV_EXT_UDEV_BLKID_UUID                 "ID_FS_UUID"
 
 #define DEV_EXT_UDEV_DEVTYPE			"DEVTYPE"
 #define DEV_EXT_UDEV_DEVTYPE_DISK		"disk"
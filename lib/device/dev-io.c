@@ -17,8 +17,10 @@
 #include "lib/device/device.h"
 #include "lib/metadata/metadata.h"
 #include "lib/mm/memlock.h"
+#include "lib/misc/lvm-signal.h"
 
 #include <limits.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -80,6 +82,39 @@ static int _dev_get_size_file(struct device *dev, uint64_t *size)
 	return 1;
 }
 
+/*
+ * The size in sysfs is in 512-byte sectors, as from BLKGETSIZE64, and
+ * reading it does not need the device opened, which dominates listing
+ * thousands of devices that the scan has already closed.
+ */
+static int _dev_get_size_sysfs(struct device *dev, uint64_t *size)
+{
+	char path[PATH_MAX];
+	unsigned long long sectors;
+	FILE *fp;
+	int r = 0;
+
+	if (!*dm_sysfs_dir() ||
+	    (dm_snprintf(path, sizeof(path), "%sdev/block/%d:%d/size",
+			 dm_sysfs_dir(),
+			 (int) MAJOR(dev->dev),
+			 (int) MINOR(dev->dev)) < 0))
+		return 0;
+
+	if (!(fp = fopen(path, "r")))
+		return 0;
+
+	if (fscanf(fp, "%llu", &sectors) == 1) {
+		*size = sectors;
+		r = 1;
+	}
+
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+
+	return r;
+}
+
 static int _dev_get_size_dev(struct device *dev, uint64_t *size)
 {
 	const char *name = dev_name(dev);
@@ -96,6 +131,15 @@ static int _dev_get_size_dev(struct device *dev, uint64_t *size)
 		return 1;
 	}
 
+	if ((fd <= 0) && _dev_get_size_sysfs(dev, size)) {
+		dev->size = *size;
+		dev->size_seqno = _dev_size_seqno;
+
+		log_very_verbose("%s: size is %" PRIu64 " sectors (sysfs)", name, *size);
+
+		return 1;
+	}
+
 	if (fd <= 0) {
 		if (!dev_open_readonly_quiet(dev))
 			return_0;
@@ -246,6 +290,11 @@ void dev_size_seqno_inc(void)
 	_dev_size_seqno++;
 }
 
+unsigned dev_size_seqno(void)
+{
+	return _dev_size_seqno;
+}
+
 int dev_get_size(struct device *dev, uint64_t *size)
 {
 	if (!dev)
@@ -281,6 +330,238 @@ int dev_discard_blocks(struct device *dev, uint64_t offset_bytes, uint64_t size_
 	return _dev_discard_blocks(dev, offset_bytes, size_bytes);
 }
 
+/*
+ * Pieces of the ranges are handed out to the io threads in order.
+ * Without buf the pieces are discarded, otherwise buf is written
+ * over them.
+ */
+struct range_queue {
+	pthread_mutex_t lock;
+	struct dm_list *ranges;
+	struct dev_io_range *range;
+	uint64_t done;		/* Bytes of range handed out */
+	const void *buf;
+	uint64_t bytes_done;	/* Bytes of all ranges completed */
+	uint64_t bytes_total;
+	dev_progress_fn progress;
+	void *context;
+};
+
+static int _next_range_piece(struct range_queue *q, struct dev_io_range **range,
+			     uint64_t *piece)
+{
+	uint64_t len;
+
+	/* Stop handing out work once interrupted */
+	if (q->buf && sigint_caught())
+		return 0;
+
+	while (q->range && (q->done == q->range->size_bytes)) {
+		q->range = dm_list_item(q->range->list.n, struct dev_io_range);
+		if (&q->range->list == q->ranges)
+			q->range = NULL;
+		q->done = 0;
+	}
+
+	if (!q->range)
+		return 0;
+
+	len = q->range->size_bytes - q->done;
+	if (q->range->chunk_bytes && (len > q->range->chunk_bytes))
+		len = q->range->chunk_bytes;
+
+	*range = q->range;
+	piece[0] = q->range->offset_bytes + q->done;
+	piece[1] = len;
+	q->done += len;
+
+	return 1;
+}
+
+static int _range_piece_io(struct range_queue *q, int fd, uint64_t *piece)
+{
+	uint64_t done = 0;
+	ssize_t n;
+
+	if (!q->buf)
+		return ioctl(fd, BLKDISCARD, piece);
+
+	/* Pieces of written ranges are never bigger than buf */
+	while (done < piece[1]) {
+		if ((n = pwrite(fd, q->buf, piece[1] - done, piece[0] + done)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!n) {
+			errno = ENOSPC;
+			return -1;
+		}
+		done += n;
+	}
+
+	return 0;
+}
+
+/* Only the calling thread reports progress */
+static void _range_worker(struct range_queue *q, int report)
+{
+	struct dev_io_range *range;
+	uint64_t piece[2];
+	int r, err;
+
+	pthread_mutex_lock(&q->lock);
+	while (_next_range_piece(q, &range, piece)) {
+		pthread_mutex_unlock(&q->lock);
+		r = _range_piece_io(q, range->fd, piece);
+		err = errno;
+		pthread_mutex_lock(&q->lock);
+		if ((r < 0) && !range->error) {
+			range->error = err;
+			range->error_offset = piece[0];
+		}
+		q->bytes_done += piece[1];
+		if (report && q->progress)
+			q->progress(q->context, q->bytes_done, q->bytes_total);
+	}
+	pthread_mutex_unlock(&q->lock);
+}
+
+static void *_range_thread(void *arg)
+{
+	_range_worker(arg, 0);
+
+	return NULL;
+}
+
+static int _dev_io_ranges(struct dm_list *ranges, const void *buf, unsigned threads,
+			  dev_progress_fn progress, void *context)
+{
+	struct dev_io_range *range, *opened = NULL;
+	struct range_queue q = {
+		.ranges = ranges,
+		.buf = buf,
+		.progress = progress,
+		.context = context,
+	};
+	pthread_t thread[threads ? : 1];
+	const char *op = buf ? "write" : "BLKDISCARD ioctl";
+	unsigned i, started = 0;
+	int r = 1;
+
+	if (dm_list_empty(ranges))
+		return 1;
+
+	/* Devices are opened here, the threads only issue the io */
+	dm_list_iterate_items(range, ranges) {
+		range->error = 0;
+		if (!dev_open_flags(range->dev, O_RDWR, buf ? 1 : 0, 0)) {
+			r = 0;
+			goto_out;
+		}
+		opened = range;
+		q.bytes_total += range->size_bytes;
+		log_debug_devs("%s %" PRIu64 " bytes offset %" PRIu64 " bytes on %s. %s",
+			       buf ? "Writing" : "Discarding",
+			       range->size_bytes, range->offset_bytes, dev_name(range->dev),
+			       test_mode() ? " (test mode - suppressed)" : "");
+	}
+
+	if (test_mode())
+		goto out;
+
+	dm_list_iterate_items(range, ranges)
+		range->fd = range->dev->fd;
+
+	q.range = dm_list_item(dm_list_first(ranges), struct dev_io_range);
+
+	if (pthread_mutex_init(&q.lock, NULL)) {
+		log_sys_error("pthread_mutex_init", op);
+		r = 0;
+		goto out;
+	}
+
+	for (i = 1; i < threads; i++) {
+		if (pthread_create(&thread[i], NULL, _range_thread, &q)) {
+			log_sys_debug("pthread_create", op);
+			break; /* Continue with fewer threads */
+		}
+		started++;
+	}
+
+	_range_worker(&q, 1);
+
+	for (i = 1; i <= started; i++)
+		pthread_join(thread[i], NULL);
+
+	pthread_mutex_destroy(&q.lock);
+
+	dm_list_iterate_items(range, ranges) {
+		if (buf && !range->error && fdatasync(range->fd))
+			range->error = errno;
+
+		if (range->error) {
+			log_error("%s: %s at offset %" PRIu64 " size %" PRIu64 " failed: %s.",
+				  dev_name(range->dev), op, range->error_offset,
+				  range->size_bytes - (range->error_offset - range->offset_bytes),
+				  strerror(range->error));
+			/* It doesn't matter if discard failed, so return success. */
+			if (buf)
+				r = 0;
+		}
+	}
+
+	if (buf && sigint_caught())
+		r = 0;
+out:
+	if (opened)
+		dm_list_iterate_items(range, ranges) {
+			if (!dev_close(range->dev))
+				stack;
+			if (range == opened)
+				break;
+		}
+
+	return r;
+}
+
+int dev_discard_ranges(struct dm_list *ranges, unsigned threads)
+{
+	return _dev_io_ranges(ranges, NULL, threads, NULL, NULL);
+}
+
+int dev_write_ranges(struct dm_list *ranges, uint8_t val, unsigned threads,
+		     dev_progress_fn progress, void *context)
+{
+	struct dev_io_range *range;
+	uint64_t buf_size = 0;
+	void *buf;
+	int r;
+
+	dm_list_iterate_items(range, ranges)
+		if (range->chunk_bytes > buf_size)
+			buf_size = range->chunk_bytes;
+
+	if (!buf_size || (buf_size > DEV_WRITE_RANGE_MAX_CHUNK)) {
+		log_error(INTERNAL_ERROR "Invalid chunk size " FMTu64 " for writing ranges.", buf_size);
+		return 0;
+	}
+
+	/* Aligned for O_DIRECT, shared read-only by all threads */
+	if (posix_memalign(&buf, 4096, (size_t) buf_size)) {
+		log_error("Failed to allocate " FMTu64 " bytes write buffer.", buf_size);
+		return 0;
+	}
+
+	memset(buf, val, (size_t) buf_size);
+
+	r = _dev_io_ranges(ranges, buf, threads, progress, context);
+
+	free(buf);
+
+	return r;
+}
+
 void dev_flush(struct device *dev)
 {
 	if (!(dev->flags & DEV_REGULAR) && ioctl(dev->fd, BLKFLSBUF, 0) >= 0)
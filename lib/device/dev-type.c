@@ -15,12 +15,14 @@
 #include "base/memory/zalloc.h"
 #include "lib/misc/lib.h"
 #include "lib/device/dev-type.h"
+#include "lib/device/dev-cache.h"
 #include "lib/device/device-types.h"
 #include "lib/mm/xlate.h"
 #include "lib/config/config.h"
 #include "lib/metadata/metadata.h"
 #include "lib/device/bcache.h"
 #include "lib/label/label.h"
+#include "lib/commands/toolcontext.h"
 
 #ifdef BLKID_WIPING_SUPPORT
 #include <blkid.h>
@@ -33,6 +35,7 @@
 
 #include <libgen.h>
 #include <ctype.h>
+#include <dirent.h>
 
 /*
  * dev is pmem if /sys/dev/block/<major>:<minor>/queue/dax is 1
@@ -270,6 +273,15 @@ bad:
 	return NULL;
 }
 
+void destroy_dev_types(struct dev_types *dt)
+{
+#ifdef BLKID_WIPING_SUPPORT
+	if (dt->wipe_probe)
+		blkid_free_probe(dt->wipe_probe);
+#endif
+	free(dt);
+}
+
 int dev_subsystem_part_major(struct dev_types *dt, struct device *dev)
 {
 	dev_t primary_dev;
@@ -646,6 +658,124 @@ out:
 	return ret;
 }
 
+/*
+ * Picks the first (by name) slave of a stacked device, so that the same
+ * slave is chosen every time.
+ */
+static int _get_first_slave_devt(const char *sysfs_dir, dev_t devno, dev_t *result)
+{
+	char path[PATH_MAX];
+	char name[NAME_LEN] = "";
+	char buffer[64];
+	struct dirent *d;
+	DIR *dr;
+	FILE *fp;
+	int major, minor;
+	int r = 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d/slaves",
+			sysfs_dir, (int) MAJOR(devno), (int) MINOR(devno)) < 0)
+		return 0;
+
+	if (!(dr = opendir(path)))
+		return 0;
+
+	while ((d = readdir(dr))) {
+		if (d->d_name[0] == '.')
+			continue;
+		if (!name[0] || (strcmp(d->d_name, name) < 0))
+			(void) dm_strncpy(name, d->d_name, sizeof(name));
+	}
+
+	if (closedir(dr))
+		log_sys_debug("closedir", path);
+
+	if (!name[0])
+		return 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/class/block/%s/dev", sysfs_dir, name) < 0)
+		return 0;
+
+	if (!(fp = fopen(path, "r")))
+		return 0;
+
+	if (fgets(buffer, sizeof(buffer), fp) &&
+	    (sscanf(buffer, "%d:%d", &major, &minor) == 2)) {
+		*result = MKDEV(major, minor);
+		r = 1;
+	}
+
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+
+	return r;
+}
+
+#define MAX_IO_GROUP_DEPTH 8
+
+/*
+ * Devices that share a SCSI host/target or another controller (e.g. an
+ * nvme controller or virtio device) share a request queue in the
+ * hardware, so too many concurrent ios to them will queue badly.
+ * Sets buf to the sysfs path of the controller a device is behind:
+ *
+ * /sys/dev/block/8:17 -> ../../devices/pci0000:00/0000:00:10.0/host2/
+ *                        target2:0:0/2:0:0:0/block/sdb/sdb1
+ * group               = ../../devices/pci0000:00/0000:00:10.0/host2/
+ *                        target2:0:0
+ *
+ * Stacked devices (e.g. dm multipath) take the group of their first
+ * slave.  Virtual devices without slaves (e.g. loop) are their own group.
+ *
+ * Returns 0 if sysfs has no entry for the device.
+ */
+int dev_get_io_group(struct device *dev, char *buf, size_t buf_size)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+	char path[PATH_MAX];
+	struct stat info;
+	dev_t devno = dev->dev;
+	char *p;
+	int depth, size;
+
+	for (depth = 0; depth < MAX_IO_GROUP_DEPTH; depth++) {
+		if (dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d",
+				sysfs_dir, (int) MAJOR(devno), (int) MINOR(devno)) < 0)
+			return 0;
+
+		if ((size = readlink(path, buf, buf_size - 1)) < 0)
+			return 0;
+		buf[size] = '\0';
+
+		if (!strstr(buf, "/virtual/"))
+			break;
+
+		if (!_get_first_slave_devt(sysfs_dir, devno, &devno))
+			return 1;
+	}
+
+	/* A partition is in the directory of its whole disk. */
+	if ((dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d/partition",
+			 sysfs_dir, (int) MAJOR(devno), (int) MINOR(devno)) >= 0) &&
+	    !stat(path, &info) && (p = strrchr(buf, '/')))
+		*p = '\0';
+
+	if ((p = strstr(buf, "/target"))) {
+		if ((p = strchr(p + 1, '/')))
+			*p = '\0';
+		return 1;
+	}
+
+	/* Parent of the disk, skipping any "block" directory. */
+	if ((p = strrchr(buf, '/'))) {
+		*p = '\0';
+		if ((p = strrchr(buf, '/')) && !strcmp(p, "/block"))
+			*p = '\0';
+	}
+
+	return 1;
+}
+
 #ifdef BLKID_WIPING_SUPPORT
 int get_fs_block_size(struct device *dev, uint32_t *fs_block_size)
 {
@@ -769,14 +899,46 @@ static int _blkid_wipe(blkid_probe probe, struct device *dev, const char *name,
 	return 1;
 }
 
-static int _wipe_known_signatures_with_blkid(struct device *dev, const char *name,
+/*
+ * The probe and its settings are created once and then pointed at each
+ * device in turn, rather than set up again for every device pvcreate
+ * or lvcreate wipes.
+ */
+static blkid_probe _get_wipe_probe(struct dev_types *dt)
+{
+	blkid_probe probe;
+
+	if (dt->wipe_probe)
+		return dt->wipe_probe;
+
+	if (!(probe = blkid_new_probe()))
+		return_NULL;
+
+	blkid_probe_enable_partitions(probe, 1);
+	blkid_probe_set_partitions_flags(probe, BLKID_PARTS_MAGIC);
+
+	blkid_probe_enable_superblocks(probe, 1);
+	blkid_probe_set_superblocks_flags(probe, BLKID_SUBLKS_LABEL |
+						 BLKID_SUBLKS_UUID |
+						 BLKID_SUBLKS_TYPE |
+						 BLKID_SUBLKS_USAGE |
+						 BLKID_SUBLKS_VERSION |
+						 BLKID_SUBLKS_MAGIC |
+						 BLKID_SUBLKS_BADCSUM);
+
+	return dt->wipe_probe = probe;
+}
+
+static int _wipe_known_signatures_with_blkid(struct dev_types *dt,
+					     struct device *dev, const char *name,
 					     uint32_t types_to_exclude,
 					     uint32_t types_no_prompt,
 					     int yes, force_t force, int *wiped)
 {
-	blkid_probe probe = NULL;
+	blkid_probe probe;
 	int found = 0, left = 0, wiped_tmp;
 	int r_wipe;
+	int fd;
 	int r = 0;
 
 	if (!wiped)
@@ -785,23 +947,17 @@ static int _wipe_known_signatures_with_blkid(struct device *dev, const char *nam
 
 	/* TODO: Should we check for valid dev - _dev_is_valid(dev)? */
 
-	if (!(probe = blkid_new_probe_from_filename(dev_name(dev)))) {
+	if ((fd = open(dev_name(dev), O_RDONLY | O_CLOEXEC)) < 0) {
+		log_sys_error("open", dev_name(dev));
+		return 0;
+	}
+
+	if (!(probe = _get_wipe_probe(dt)) ||
+	    blkid_probe_set_device(probe, fd, 0, 0)) {
 		log_error("Failed to create a new blkid probe for device %s.", dev_name(dev));
 		goto out;
 	}
 
-	blkid_probe_enable_partitions(probe, 1);
-	blkid_probe_set_partitions_flags(probe, BLKID_PARTS_MAGIC);
-
-	blkid_probe_enable_superblocks(probe, 1);
-	blkid_probe_set_superblocks_flags(probe, BLKID_SUBLKS_LABEL |
-						 BLKID_SUBLKS_UUID |
-						 BLKID_SUBLKS_TYPE |
-						 BLKID_SUBLKS_USAGE |
-						 BLKID_SUBLKS_VERSION |
-						 BLKID_SUBLKS_MAGIC |
-						 BLKID_SUBLKS_BADCSUM);
-
 	while (!blkid_do_probe(probe)) {
 		if ((r_wipe = _blkid_wipe(probe, dev, name, types_to_exclude, types_no_prompt, yes, force)) == 1) {
 			(*wiped)++;
@@ -825,8 +981,8 @@ static int _wipe_known_signatures_with_blkid(struct device *dev, const char *nam
 		log_warn("%d existing signature%s left on the device.",
 			  left, left > 1 ? "s" : "");
 out:
-	if (probe)
-		blkid_free_probe(probe);
+	if (close(fd))
+		log_sys_debug("close", dev_name(dev));
 	return r;
 }
 
@@ -895,7 +1051,7 @@ int wipe_known_signatures(struct cmd_context *cmd, struct device *dev,
 
 #ifdef BLKID_WIPING_SUPPORT
 	if (blkid_wiping_enabled)
-		return _wipe_known_signatures_with_blkid(dev, name,
+		return _wipe_known_signatures_with_blkid(cmd->dev_types, dev, name,
 							 types_to_exclude,
 							 types_no_prompt,
 							 yes, force, wiped);
@@ -1006,34 +1162,68 @@ out:
 	return result;
 }
 
+static const struct {
+	const char *attribute;
+	unsigned long default_value;
+} _topology_attrs[DEV_TOPOLOGY_NUM] = {
+	[DEV_TOPOLOGY_ALIGNMENT_OFFSET] = { "alignment_offset", 0UL },
+	[DEV_TOPOLOGY_MINIMUM_IO_SIZE] = { "queue/minimum_io_size", 0UL },
+	[DEV_TOPOLOGY_OPTIMAL_IO_SIZE] = { "queue/optimal_io_size", 0UL },
+	[DEV_TOPOLOGY_DISCARD_MAX_BYTES] = { "queue/discard_max_bytes", 0UL },
+	[DEV_TOPOLOGY_DISCARD_GRANULARITY] = { "queue/discard_granularity", 0UL },
+	[DEV_TOPOLOGY_ROTATIONAL] = { "queue/rotational", 1UL },
+};
+
+/*
+ * Each attribute is read from sysfs once and then kept in the device
+ * for as long as its cached size, so the many callers asking for the
+ * same device's topology share one read.
+ */
+static unsigned long _dev_topology(struct dev_types *dt, struct device *dev,
+				   dev_topology_t attr)
+{
+	if (dev->topology_seqno != dev_size_seqno()) {
+		dev->topology_seqno = dev_size_seqno();
+		dev->topology_valid = 0;
+	}
+
+	if (!(dev->topology_valid & (1U << attr))) {
+		dev->topology[attr] = _dev_topology_attribute(dt, _topology_attrs[attr].attribute, dev,
+							      _topology_attrs[attr].default_value);
+		dev->topology_valid |= 1U << attr;
+	}
+
+	return dev->topology[attr];
+}
+
 unsigned long dev_alignment_offset(struct dev_types *dt, struct device *dev)
 {
-	return _dev_topology_attribute(dt, "alignment_offset", dev, 0UL);
+	return _dev_topology(dt, dev, DEV_TOPOLOGY_ALIGNMENT_OFFSET);
 }
 
 unsigned long dev_minimum_io_size(struct dev_types *dt, struct device *dev)
 {
-	return _dev_topology_attribute(dt, "queue/minimum_io_size", dev, 0UL);
+	return _dev_topology(dt, dev, DEV_TOPOLOGY_MINIMUM_IO_SIZE);
 }
 
 unsigned long dev_optimal_io_size(struct dev_types *dt, struct device *dev)
 {
-	return _dev_topology_attribute(dt, "queue/optimal_io_size", dev, 0UL);
+	return _dev_topology(dt, dev, DEV_TOPOLOGY_OPTIMAL_IO_SIZE);
 }
 
 unsigned long dev_discard_max_bytes(struct dev_types *dt, struct device *dev)
 {
-	return _dev_topology_attribute(dt, "queue/discard_max_bytes", dev, 0UL);
+	return _dev_topology(dt, dev, DEV_TOPOLOGY_DISCARD_MAX_BYTES);
 }
 
 unsigned long dev_discard_granularity(struct dev_types *dt, struct device *dev)
 {
-	return _dev_topology_attribute(dt, "queue/discard_granularity", dev, 0UL);
+	return _dev_topology(dt, dev, DEV_TOPOLOGY_DISCARD_GRANULARITY);
 }
 
 int dev_is_rotational(struct dev_types *dt, struct device *dev)
 {
-	return (int) _dev_topology_attribute(dt, "queue/rotational", dev, 1UL);
+	return (int) _dev_topology(dt, dev, DEV_TOPOLOGY_ROTATIONAL);
 }
 #else
 
@@ -1094,6 +1284,102 @@ int dev_is_rotational(struct dev_types *dt, struct device *dev)
 #define UDEV_DEV_IS_COMPONENT_ITERATION_COUNT 100
 #define UDEV_DEV_IS_COMPONENT_USLEEP 100000
 
+/*
+ * udev records indexed by devno, so the filters and the label scan
+ * asking about the same device share one lookup and one read of its
+ * udev db entry.  Once the device cache has scanned all devices, the
+ * first lookup loads records for every block device with a single
+ * enumeration.  The records are dropped when the device cache rescans.
+ */
+static struct dm_hash_table *_udev_devices;
+static int _udev_devices_enumerated;
+
+static int _udev_is_initialized(struct udev_device *udev_device)
+{
+#ifdef HAVE_LIBUDEV_UDEV_DEVICE_GET_IS_INITIALIZED
+	return udev_device_get_is_initialized(udev_device);
+#else
+	return udev_device_get_property_value(udev_device, DEV_EXT_UDEV_DEVLINKS) != NULL;
+#endif
+}
+
+/* Takes over the caller's reference to udev_device. */
+static void _udev_store_dev(dev_t devno, struct udev_device *udev_device)
+{
+	struct udev_device *old;
+
+	if (!_udev_devices && !(_udev_devices = dm_hash_create(1024))) {
+		udev_device_unref(udev_device);
+		return;
+	}
+
+	if ((old = dm_hash_lookup_binary(_udev_devices, &devno, sizeof(devno))))
+		udev_device_unref(old);
+
+	if (!dm_hash_insert_binary(_udev_devices, &devno, sizeof(devno), udev_device)) {
+		dm_hash_remove_binary(_udev_devices, &devno, sizeof(devno));
+		udev_device_unref(udev_device);
+	}
+}
+
+static void _udev_enumerate_devs(struct udev *udev_context)
+{
+	struct udev_enumerate *udev_enum;
+	struct udev_list_entry *entry;
+	struct udev_device *udev_device;
+
+	_udev_devices_enumerated = 1;
+
+	if (!(udev_enum = udev_enumerate_new(udev_context))) {
+		log_debug("Failed to create udev enumeration.");
+		return;
+	}
+
+	if (udev_enumerate_add_match_subsystem(udev_enum, "block") ||
+	    udev_enumerate_scan_devices(udev_enum)) {
+		log_debug("Failed to enumerate block devices in udev db.");
+		goto out;
+	}
+
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(udev_enum)) {
+		if (!(udev_device = udev_device_new_from_syspath(udev_context, udev_list_entry_get_name(entry))))
+			continue;
+
+		_udev_store_dev(udev_device_get_devnum(udev_device), udev_device);
+	}
+out:
+	udev_enumerate_unref(udev_enum);
+}
+
+static struct udev_device *_udev_cached_dev(struct udev *udev_context, dev_t devno)
+{
+	struct udev_device *udev_device;
+
+	if (!_udev_devices_enumerated && dev_cache_has_scanned())
+		_udev_enumerate_devs(udev_context);
+
+	if (!_udev_devices ||
+	    !(udev_device = dm_hash_lookup_binary(_udev_devices, &devno, sizeof(devno))) ||
+	    !_udev_is_initialized(udev_device))
+		return NULL;
+
+	return udev_device_ref(udev_device);
+}
+
+void udev_dev_cache_destroy(void)
+{
+	struct dm_hash_node *n;
+
+	if (_udev_devices) {
+		dm_hash_iterate(n, _udev_devices)
+			udev_device_unref(dm_hash_get_data(_udev_devices, n));
+		dm_hash_destroy(_udev_devices);
+		_udev_devices = NULL;
+	}
+
+	_udev_devices_enumerated = 0;
+}
+
 static struct udev_device *_udev_get_dev(struct device *dev)
 {
 	struct udev *udev_context = udev_get_library_context();
@@ -1106,6 +1392,9 @@ static struct udev_device *_udev_get_dev(struct device *dev)
 		return NULL;
 	}
 
+	if ((udev_device = _udev_cached_dev(udev_context, dev->dev)))
+		return udev_device;
+
 	while (1) {
 		if (i >= UDEV_DEV_IS_COMPONENT_ITERATION_COUNT)
 			break;
@@ -1118,13 +1407,8 @@ static struct udev_device *_udev_get_dev(struct device *dev)
 			return NULL;
 		}
 
-#ifdef HAVE_LIBUDEV_UDEV_DEVICE_GET_IS_INITIALIZED
-		if ((initialized = udev_device_get_is_initialized(udev_device)))
+		if ((initialized = _udev_is_initialized(udev_device)))
 			break;
-#else
-		if ((initialized = (udev_device_get_property_value(udev_device, DEV_EXT_UDEV_DEVLINKS) != NULL)))
-			break;
-#endif
 
 		log_debug("Device %s not initialized in udev database (%u/%u, %u microseconds).", dev_name(dev),
 			   i + 1, UDEV_DEV_IS_COMPONENT_ITERATION_COUNT,
@@ -1143,6 +1427,7 @@ static struct udev_device *_udev_get_dev(struct device *dev)
 		goto out;
 	}
 
+	_udev_store_dev(dev->dev, udev_device_ref(udev_device));
 out:
 	return udev_device;
 }
@@ -1206,6 +1491,44 @@ out:
 	return ret;
 }
 
+/*
+ * Get the PVID that blkid found on the dev from the udev db, without
+ * reading the dev.  pvid must have space for ID_LEN + 1 chars.
+ */
+int udev_dev_get_pvid(struct device *dev, char *pvid)
+{
+	struct udev_device *udev_device;
+	const char *value;
+	int len = 0;
+	int ret = 0;
+
+	if (!obtain_device_list_from_udev())
+		return 0;
+
+	if (!(udev_device = _udev_get_dev(dev)))
+		return 0;
+
+	value = udev_device_get_property_value(udev_device, DEV_EXT_UDEV_BLKID_TYPE);
+	if (!value || strcmp(value, DEV_EXT_UDEV_BLKID_TYPE_LVM2))
+		goto out;
+
+	if (!(value = udev_device_get_property_value(udev_device, DEV_EXT_UDEV_BLKID_UUID)))
+		goto out;
+
+	for (; *value && (len < ID_LEN); value++)
+		if (*value != '-')
+			pvid[len++] = *value;
+	pvid[len] = '\0';
+
+	if ((len == ID_LEN) && !*value) {
+		log_debug("Device %s has PVID %s in udev db.", dev_name(dev), pvid);
+		ret = 1;
+	}
+out:
+	udev_device_unref(udev_device);
+	return ret;
+}
+
 #else
 
 int udev_dev_is_mpath_component(struct device *dev)
@@ -1213,10 +1536,19 @@ int udev_dev_is_mpath_component(struct device *dev)
 	return 0;
 }
 
+int udev_dev_get_pvid(struct device *dev, char *pvid)
+{
+	return 0;
+}
+
 int udev_dev_is_md_component(struct device *dev)
 {
 	dev->flags |= DEV_UDEV_INFO_MISSING;
 	return 0;
 }
 
+void udev_dev_cache_destroy(void)
+{
+}
+
 #endif
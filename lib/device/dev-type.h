@@ -47,9 +47,11 @@ struct dev_types {
 	int dasd_major;
 	int loop_major;
 	struct dev_type_def dev_type_array[NUMBER_OF_MAJORS];
+	void *wipe_probe;	/* blkid probe reused for each device wiped */
 };
 
 struct dev_types *create_dev_types(const char *proc_dir, const struct dm_config_node *cn);
+void destroy_dev_types(struct dev_types *dt);
 
 /* Subsystems */
 int dev_subsystem_part_major(struct dev_types *dt, struct device *dev);
@@ -63,6 +65,8 @@ int dev_is_luks(struct device *dev, uint64_t *signature, int full);
 int dasd_is_cdl_formatted(struct device *dev);
 int udev_dev_is_mpath_component(struct device *dev);
 int udev_dev_is_md_component(struct device *dev);
+int udev_dev_get_pvid(struct device *dev, char *pvid);
+void udev_dev_cache_destroy(void);
 
 int dev_is_lvm1(struct device *dev, char *buf, int buflen);
 int dev_is_pool(struct device *dev, char *buf, int buflen);
@@ -84,6 +88,9 @@ int major_max_partitions(struct dev_types *dt, int major);
 int dev_is_partitioned(struct dev_types *dt, struct device *dev);
 int dev_get_primary_dev(struct dev_types *dt, struct device *dev, dev_t *result);
 
+/* Grouping of devices by the controller they sit behind */
+int dev_get_io_group(struct device *dev, char *buf, size_t buf_size);
+
 /* Various device properties */
 unsigned long dev_alignment_offset(struct dev_types *dt, struct device *dev);
 unsigned long dev_minimum_io_size(struct dev_types *dt, struct device *dev);
@@ -38,6 +38,7 @@
 #define DEV_SCAN_FOUND_LABEL	0x00010000      /* label scan read dev and found label */
 #define DEV_IS_MD_COMPONENT	0x00020000	/* device is an md component */
 #define DEV_UDEV_INFO_MISSING   0x00040000	/* we have no udev info for this device */
+#define DEV_ALIASES_UNSORTED	0x00080000	/* preferred name among aliases not chosen yet */
 
 /*
  * Support for external device info.
@@ -56,10 +57,35 @@ struct dev_ext {
 	void *handle;
 };
 
+/*
+ * Sysfs topology attributes cached in struct device.
+ */
+typedef enum dev_topology_e {
+	DEV_TOPOLOGY_ALIGNMENT_OFFSET,
+	DEV_TOPOLOGY_MINIMUM_IO_SIZE,
+	DEV_TOPOLOGY_OPTIMAL_IO_SIZE,
+	DEV_TOPOLOGY_DISCARD_MAX_BYTES,
+	DEV_TOPOLOGY_DISCARD_GRANULARITY,
+	DEV_TOPOLOGY_ROTATIONAL,
+	DEV_TOPOLOGY_NUM
+} dev_topology_t;
+
 /*
  * All devices in LVM will be represented by one of these.
  * pointer comparisons are valid.
  */
+/*
+ * A metadata text copy on the device whose checksum has been verified
+ * against its mda header in this command.
+ */
+struct dev_mda_copy {
+	uint64_t offset;
+	uint32_t size;
+	uint32_t checksum;
+};
+
+#define DEV_MDA_COPIES 2
+
 struct device {
 	struct dm_list aliases;	/* struct dm_str_list */
 	dev_t dev;
@@ -77,7 +103,11 @@ struct device {
 	unsigned size_seqno;
 	uint64_t size;
 	uint64_t end;
+	unsigned topology_seqno;
+	unsigned topology_valid;	/* bitmask of dev_topology_t read */
+	unsigned long topology[DEV_TOPOLOGY_NUM];
 	struct dev_ext ext;
+	struct dev_mda_copy mda_verified[DEV_MDA_COPIES];
 	const char *duplicate_prefer_reason;
 
 	const char *vgid; /* if device is an LV */
@@ -129,6 +159,7 @@ int dev_ext_release(struct device *dev);
  * of cached device size.
  */
 void dev_size_seqno_inc(void);
+unsigned dev_size_seqno(void);
 
 /*
  * All io should use these routines.
@@ -139,6 +170,35 @@ int dev_get_size(struct device *dev, uint64_t *size);
 int dev_get_read_ahead(struct device *dev, uint32_t *read_ahead);
 int dev_discard_blocks(struct device *dev, uint64_t offset_bytes, uint64_t size_bytes);
 
+/*
+ * A range for dev_discard_ranges() and dev_write_ranges().  Ranges are
+ * processed in pieces of chunk_bytes (0 for the whole range at once,
+ * only for discards).
+ */
+struct dev_io_range {
+	struct dm_list list;
+	struct device *dev;
+	uint64_t offset_bytes;
+	uint64_t size_bytes;
+	uint64_t chunk_bytes;
+	int fd;		/* Internal */
+	int error;	/* Internal: errno of the first failed piece */
+	uint64_t error_offset;	/* Internal */
+};
+
+#define DEV_WRITE_RANGE_MAX_CHUNK (UINT64_C(64) << 20)
+
+typedef void (*dev_progress_fn)(void *context, uint64_t done_bytes, uint64_t total_bytes);
+
+/* Discard all ranges using up to 'threads' BLKDISCARD ioctls in flight. */
+int dev_discard_ranges(struct dm_list *ranges, unsigned threads);
+/*
+ * Fill all ranges with val using up to 'threads' direct writes in flight.
+ * Offsets and chunk sizes must suit O_DIRECT.  Bypasses bcache.
+ */
+int dev_write_ranges(struct dm_list *ranges, uint8_t val, unsigned threads,
+		     dev_progress_fn progress, void *context);
+
 /* Use quiet version if device number could change e.g. when opening LV */
 int dev_open(struct device *dev);
 int dev_open_quiet(struct device *dev);
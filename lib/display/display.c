@@ -861,10 +861,13 @@ void display_formats(const struct cmd_context *cmd)
 	}
 }
 
-void display_segtypes(const struct cmd_context *cmd)
+void display_segtypes(struct cmd_context *cmd)
 {
 	const struct segment_type *segtype;
 
+	if (!load_segtypes(cmd, NULL, 0))
+		stack;
+
 	dm_list_iterate_items(segtype, &cmd->segtypes) {
 		log_print("%s", segtype->name);
 	}
@@ -72,9 +72,28 @@ static void _wipe(struct cmd_context *cmd, struct dev_filter *f, struct device *
 	}
 }
 
+/*
+ * Sort filters by ascending cost so cheap checks reject devices before
+ * anything opens or reads them.  Insertion sort keeps the given order
+ * among filters of equal cost.
+ */
+static void _sort_by_cost(struct dev_filter **filters, int n)
+{
+	struct dev_filter *f;
+	int i, j;
+
+	for (i = 1; i < n; i++) {
+		f = filters[i];
+		for (j = i; j > 0 && filters[j - 1]->cost > f->cost; j--)
+			filters[j] = filters[j - 1];
+		filters[j] = f;
+	}
+}
+
 struct dev_filter *composite_filter_create(int n, int use_dev_ext_info, struct dev_filter **filters)
 {
 	struct dev_filter **filters_copy, *cft;
+	int i;
 
 	if (!filters)
 		return_NULL;
@@ -86,6 +105,7 @@ struct dev_filter *composite_filter_create(int n, int use_dev_ext_info, struct d
 
 	memcpy(filters_copy, filters, sizeof(*filters) * n);
 	filters_copy[n] = NULL;
+	_sort_by_cost(filters_copy, n);
 
 	if (!(cft = zalloc(sizeof(*cft)))) {
 		log_error("Composite filters allocation failed.");
@@ -100,6 +120,13 @@ struct dev_filter *composite_filter_create(int n, int use_dev_ext_info, struct d
 	cft->private = filters_copy;
 	cft->name = "composite";
 
+	for (i = 0; i < n; i++) {
+		if (filters_copy[i]->cost > cft->cost)
+			cft->cost = filters_copy[i]->cost;
+		log_debug_devs("Composite filter runs %s filter (cost %d).",
+			       filters_copy[i]->name, filters_copy[i]->cost);
+	}
+
 	log_debug_devs("Composite filter initialised.");
 
 	return cft;
@@ -122,6 +122,7 @@ struct dev_filter *fwraid_filter_create(struct dev_types *dt __attribute__((unus
 	f->use_count = 0;
 	f->private = NULL;
 	f->name = "fwraid";
+	f->cost = FILTER_COST_DATA;
 
 	log_debug_devs("Firmware RAID filter initialised.");
 
@@ -78,6 +78,7 @@ struct dev_filter *internal_filter_create(void)
 	f->destroy = _destroy;
 	f->use_count = 0;
 	f->name = "internal";
+	f->cost = FILTER_COST_NAME;
 
 	log_debug_devs("Internal filter initialised.");
 
@@ -153,6 +153,7 @@ struct dev_filter *md_filter_create(struct cmd_context *cmd, struct dev_types *d
 	f->use_count = 0;
 	f->private = dt;
 	f->name = "md";
+	f->cost = FILTER_COST_DATA;
 
 	log_debug_devs("MD filter initialised.");
 
@@ -28,59 +28,19 @@
 #define MPATH_PREFIX "mpath-"
 
 
+/* Component held by more than one dm device */
+#define HOLDER_MULTIPLE ((void *) -1)
+
 struct mpath_priv {
 	struct dm_pool *mem;
 	struct dev_filter f;
 	struct dev_types *dt;
 	struct dm_hash_table *hash;
+	struct dm_hash_table *holders;	/* component devno -> dm minor + 1 */
+	unsigned holders_scan;		/* dev_cache scan the holders map is from */
+	int holders_valid;
 };
 
-static const char *_get_sysfs_name(struct device *dev)
-{
-	const char *name;
-
-	if (!(name = strrchr(dev_name(dev), '/'))) {
-		log_error("Cannot find '/' in device name.");
-		return NULL;
-	}
-	name++;
-
-	if (!*name) {
-		log_error("Device name is not valid.");
-		return NULL;
-	}
-
-	return name;
-}
-
-static const char *_get_sysfs_name_by_devt(const char *sysfs_dir, dev_t devno,
-					  char *buf, size_t buf_size)
-{
-	const char *name;
-	char path[PATH_MAX];
-	int size;
-
-	if (dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d", sysfs_dir,
-			(int) MAJOR(devno), (int) MINOR(devno)) < 0) {
-		log_error("Sysfs path string is too long.");
-		return NULL;
-	}
-
-	if ((size = readlink(path, buf, buf_size - 1)) < 0) {
-		log_sys_error("readlink", path);
-		return NULL;
-	}
-	buf[size] = '\0';
-
-	if (!(name = strrchr(buf, '/'))) {
-		log_error("Cannot find device name in sysfs path.");
-		return NULL;
-	}
-	name++;
-
-	return name;
-}
-
 static int _get_sysfs_string(const char *path, char *buffer, int max_size)
 {
 	FILE *fp;
@@ -102,14 +62,9 @@ static int _get_sysfs_string(const char *path, char *buffer, int max_size)
 	return r;
 }
 
-static int _get_sysfs_get_major_minor(const char *sysfs_dir, const char *kname, int *major, int *minor)
+static int _get_sysfs_major_minor(const char *path, int *major, int *minor)
 {
-	char path[PATH_MAX], buffer[64];
-
-	if (dm_snprintf(path, sizeof(path), "%s/block/%s/dev", sysfs_dir, kname) < 0) {
-		log_error("Sysfs path string is too long.");
-		return 0;
-	}
+	char buffer[64];
 
 	if (!_get_sysfs_string(path, buffer, sizeof(buffer)))
 		return_0;
@@ -122,30 +77,54 @@ static int _get_sysfs_get_major_minor(const char *sysfs_dir, const char *kname,
 	return 1;
 }
 
-static int _get_parent_mpath(const char *dir, char *name, int max_size)
+/*
+ * Record every device held by a dm device as a component of that holder
+ * with one pass over <sysfs>/block/dm-<minor>/slaves, so each device
+ * checked afterwards costs a single hash lookup instead of several sysfs
+ * reads of its own holders directory.
+ */
+static int _add_dm_slaves(struct mpath_priv *mp, const char *sysfs_dir,
+			  const char *dm_name, int dm_minor)
 {
+	char dir[PATH_MAX], path[PATH_MAX];
 	struct dirent *d;
 	DIR *dr;
-	int r = 0;
+	dev_t devno;
+	void *holder;
+	int major, minor;
+	int r = 1;
 
-	if (!(dr = opendir(dir))) {
-		log_sys_error("opendir", dir);
+	if (dm_snprintf(dir, sizeof(dir), "%s/block/%s/slaves", sysfs_dir, dm_name) < 0) {
+		log_error("Sysfs path string is too long.");
 		return 0;
 	}
 
-	*name = '\0';
+	if (!(dr = opendir(dir)))
+		return 1; /* Device went away */
+
 	while ((d = readdir(dr))) {
 		if (!strcmp(d->d_name, ".") || !strcmp(d->d_name, ".."))
 			continue;
 
+		if (dm_snprintf(path, sizeof(path), "%s/%s/dev", dir, d->d_name) < 0) {
+			log_error("Sysfs path string is too long.");
+			continue;
+		}
+
+		if (!_get_sysfs_major_minor(path, &major, &minor))
+			continue;
+
+		devno = MKDEV(major, minor);
+
 		/* There should be only one holder if it is multipath */
-		if (*name) {
+		holder = dm_hash_lookup_binary(mp->holders, &devno, sizeof(devno)) ?
+			HOLDER_MULTIPLE : (void *) (long) (dm_minor + 1);
+
+		if (!dm_hash_insert_binary(mp->holders, &devno, sizeof(devno), holder)) {
+			log_error("mpath holders hash insertion failed.");
 			r = 0;
 			break;
 		}
-
-		strncpy(name, d->d_name, max_size);
-		r = 1;
 	}
 
 	if (closedir(dr))
@@ -154,6 +133,53 @@ static int _get_parent_mpath(const char *dir, char *name, int max_size)
 	return r;
 }
 
+static int _update_holders(struct mpath_priv *mp)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+	char path[PATH_MAX];
+	struct dirent *d;
+	DIR *dr;
+	int dm_minor;
+	char c;
+
+	if (mp->holders_valid && (mp->holders_scan == dev_cache_scan_count()))
+		return 1;
+
+	dm_hash_wipe(mp->holders);
+	mp->holders_valid = 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/block", sysfs_dir) < 0) {
+		log_error("Sysfs path string is too long.");
+		return 0;
+	}
+
+	if (!(dr = opendir(path))) {
+		log_sys_error("opendir", path);
+		return 0;
+	}
+
+	while ((d = readdir(dr))) {
+		/* dm devices are named after their minor number */
+		if (strncmp(d->d_name, "dm-", 3) ||
+		    (sscanf(d->d_name + 3, "%d%c", &dm_minor, &c) != 1))
+			continue;
+
+		if (!_add_dm_slaves(mp, sysfs_dir, d->d_name, dm_minor))
+			stack;
+	}
+
+	if (closedir(dr))
+		log_sys_error("closedir", path);
+
+	log_debug_devs("mpath filter found %u devices held by dm devices.",
+		       dm_hash_get_num_entries(mp->holders));
+
+	mp->holders_scan = dev_cache_scan_count();
+	mp->holders_valid = 1;
+
+	return 1;
+}
+
 #ifdef UDEV_SYNC_SUPPORT
 static int _udev_dev_is_mpath(struct device *dev)
 {
@@ -184,12 +210,8 @@ static int _native_dev_is_mpath(struct dev_filter *f, struct device *dev)
 {
 	struct mpath_priv *mp = (struct mpath_priv *) f->private;
 	struct dev_types *dt = mp->dt;
-	const char *part_name, *name;
-	struct stat info;
-	char path[PATH_MAX], parent_name[PATH_MAX];
-	const char *sysfs_dir = dm_sysfs_dir();
 	int major = MAJOR(dev->dev);
-	int minor = MINOR(dev->dev);
+	int minor;
 	dev_t primary_dev;
 	long look;
 
@@ -197,52 +219,37 @@ static int _native_dev_is_mpath(struct dev_filter *f, struct device *dev)
 	if (!major_is_scsi_device(dt, MAJOR(dev->dev)))
 		return 0;
 
-	switch (dev_get_primary_dev(dt, dev, &primary_dev)) {
-	case 2: /* The dev is partition. */
-		part_name = dev_name(dev); /* name of original dev for log_debug msg */
-		if (!(name = _get_sysfs_name_by_devt(sysfs_dir, primary_dev, parent_name, sizeof(parent_name))))
-			return_0;
-		log_debug_devs("%s: Device is a partition, using primary "
-			       "device %s for mpath component detection",
-			       part_name, name);
-		break;
-	case 1: /* The dev is already a primary dev. Just continue with the dev. */
-		if (!(name = _get_sysfs_name(dev)))
-			return_0;
-		break;
-	default: /* 0, error. */
-		log_warn("Failed to get primary device for %d:%d.", major, minor);
-		return 0;
-	}
-
-	if (dm_snprintf(path, sizeof(path), "%s/block/%s/holders", sysfs_dir, name) < 0) {
-		log_warn("Sysfs path to check mpath is too long.");
-		return 0;
-	}
-
-	/* also will filter out partitions */
-	if (stat(path, &info))
-		return 0;
+	if (!_update_holders(mp))
+		return_0;
 
-	if (!S_ISDIR(info.st_mode)) {
-		log_warn("Path %s is not a directory.", path);
-		return 0;
+	if (!(look = (long) dm_hash_lookup_binary(mp->holders, &dev->dev, sizeof(dev->dev)))) {
+		/* Not held itself, so only a partition of a component may qualify. */
+		switch (dev_get_primary_dev(dt, dev, &primary_dev)) {
+		case 2: /* The dev is partition. */
+			log_debug_devs("%s: Device is a partition, using primary "
+				       "device %d:%d for mpath component detection",
+				       dev_name(dev), (int) MAJOR(primary_dev), (int) MINOR(primary_dev));
+			look = (long) dm_hash_lookup_binary(mp->holders, &primary_dev, sizeof(primary_dev));
+			break;
+		case 1: /* The dev is already a primary dev. */
+			break;
+		default: /* 0, error. */
+			log_warn("Failed to get primary device for %d:%d.", major, (int) MINOR(dev->dev));
+			return 0;
+		}
 	}
 
-	if (!_get_parent_mpath(path, parent_name, sizeof(parent_name)))
+	if (!look || ((void *) look == HOLDER_MULTIPLE))
 		return 0;
 
-	if (!_get_sysfs_get_major_minor(sysfs_dir, parent_name, &major, &minor))
-		return_0;
-
-	if (major != dt->device_mapper_major)
-		return 0;
+	major = dt->device_mapper_major;
+	minor = (int) look - 1;
 
 	/* Avoid repeated detection of multipath device and use first checked result */
 	look = (long) dm_hash_lookup_binary(mp->hash, &minor, sizeof(minor));
 	if (look > 0) {
-		log_debug_devs("%s(%u:%u): already checked as %sbeing mpath.",
-			       parent_name, major, minor, (look > 1) ? "" : "not ");
+		log_debug_devs("dm-%d(%u:%u): already checked as %sbeing mpath.",
+			       minor, major, minor, (look > 1) ? "" : "not ");
 		return (look > 1) ? 1 : 0;
 	}
 
@@ -296,6 +303,7 @@ static void _destroy(struct dev_filter *f)
 	if (f->use_count)
 		log_error(INTERNAL_ERROR "Destroying mpath filter while in use %u times.", f->use_count);
 
+	dm_hash_destroy(mp->holders);
 	dm_hash_destroy(mp->hash);
 	dm_pool_destroy(mp->mem);
 }
@@ -305,7 +313,7 @@ struct dev_filter *mpath_filter_create(struct dev_types *dt)
 	const char *sysfs_dir = dm_sysfs_dir();
 	struct dm_pool *mem;
 	struct mpath_priv *mp;
-	struct dm_hash_table *hash;
+	struct dm_hash_table *hash, *holders;
 
 	if (!*sysfs_dir) {
 		log_verbose("No proc filesystem found: skipping multipath filter");
@@ -317,8 +325,15 @@ struct dev_filter *mpath_filter_create(struct dev_types *dt)
 		return NULL;
 	}
 
+	if (!(holders = dm_hash_create(256))) {
+		log_error("mpath holders hash table creation failed.");
+		dm_hash_destroy(hash);
+		return NULL;
+	}
+
 	if (!(mem = dm_pool_create("mpath", 256))) {
 		log_error("mpath pool creation failed.");
+		dm_hash_destroy(holders);
 		dm_hash_destroy(hash);
 		return NULL;
 	}
@@ -338,16 +353,19 @@ struct dev_filter *mpath_filter_create(struct dev_types *dt)
 	mp->f.use_count = 0;
 	mp->f.private = mp;
 	mp->f.name = "mpath";
+	mp->f.cost = FILTER_COST_EXT;
 
 	mp->mem = mem;
 	mp->dt = dt;
 	mp->hash = hash;
+	mp->holders = holders;
 
 	log_debug_devs("mpath filter initialised.");
 
 	return &mp->f;
 bad:
 	dm_pool_destroy(mem);
+	dm_hash_destroy(holders);
 	dm_hash_destroy(hash);
 	return NULL;
 }
@@ -74,6 +74,7 @@ struct dev_filter *partitioned_filter_create(struct dev_types *dt)
 	f->use_count = 0;
 	f->private = dt;
 	f->name = "partitioned";
+	f->cost = FILTER_COST_DATA;
 
 	log_debug_devs("Partitioned filter initialised.");
 
@@ -18,8 +18,17 @@
 #include "lib/filters/filter.h"
 #include "lib/config/config.h"
 
+/* A device excluded by a previous command, from the filter cache file */
+struct saved_verdict {
+	dev_t devt;
+	uint64_t size;
+	uint64_t diskseq;
+};
+
 struct pfilter {
 	struct dm_hash_table *devices;
+	struct dm_hash_table *saved;	/* devt -> struct saved_verdict */
+	struct saved_verdict *saved_verdicts;
 	struct dev_filter *real;
 	struct dev_types *dt;
 };
@@ -64,6 +73,85 @@ static int _init_hash(struct pfilter *pf)
 	return 1;
 }
 
+/*
+ * The filter cache file optionally carries the bad results of this filter
+ * over to later commands, so devices that are known not to be PVs skip
+ * the real filters (including those reading device data) entirely.
+ * A saved result is only used for a device with the same devno, size and
+ * diskseq (when the kernel provides one) as when it was saved, and the
+ * whole file is ignored when the filter configuration differs.  The
+ * caller (hints) decides when the file is current and replaces it
+ * together with the hint file.
+ *
+ * Good results are not saved: a device can become a multipath component
+ * or get a signature without any of those changing.  Nor are results for
+ * dm devices, which the usable filter checks for transient states.
+ */
+static int _read_sysfs_u64(const char *sysfs_dir, dev_t devt, const char *attr, uint64_t *val)
+{
+	char path[PATH_MAX], buf[64];
+	unsigned long long v;
+	FILE *fp;
+	int r = 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d/%s", sysfs_dir,
+			(int) MAJOR(devt), (int) MINOR(devt), attr) < 0)
+		return 0;
+
+	if (!(fp = fopen(path, "r")))
+		return 0;
+
+	if (fgets(buf, sizeof(buf), fp) && (sscanf(buf, "%llu", &v) == 1)) {
+		*val = v;
+		r = 1;
+	}
+
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+
+	return r;
+}
+
+static int _get_dev_identity(struct device *dev, uint64_t *size, uint64_t *diskseq)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+
+	if (!*sysfs_dir || !_read_sysfs_u64(sysfs_dir, dev->dev, "size", size))
+		return 0;
+
+	/* Kernels without diskseq report 0, which still matches itself. */
+	if (!_read_sysfs_u64(sysfs_dir, dev->dev, "diskseq", diskseq))
+		*diskseq = 0;
+
+	return 1;
+}
+
+static void _free_saved(struct pfilter *pf)
+{
+	if (pf->saved)
+		dm_hash_destroy(pf->saved);
+	free(pf->saved_verdicts);
+	pf->saved = NULL;
+	pf->saved_verdicts = NULL;
+}
+
+static int _saved_bad(struct pfilter *pf, struct device *dev)
+{
+	struct saved_verdict *sv;
+	uint64_t size, diskseq;
+
+	if (!(sv = dm_hash_lookup_binary(pf->saved, &dev->dev, sizeof(dev->dev))))
+		return 0;
+
+	if (!_get_dev_identity(dev, &size, &diskseq) ||
+	    (size != sv->size) || (diskseq != sv->diskseq)) {
+		log_debug_devs("%s: filter cache ignoring changed device", dev_name(dev));
+		return 0;
+	}
+
+	return 1;
+}
+
 static void _persistent_filter_wipe(struct cmd_context *cmd, struct dev_filter *f, struct device *dev, const char *use_filter_name)
 {
 	struct pfilter *pf = (struct pfilter *) f->private;
@@ -95,6 +183,17 @@ static int _lookup_p(struct cmd_context *cmd, struct dev_filter *f, struct devic
 
 	l = dm_hash_lookup(pf->devices, dev_name(dev));
 
+	/* Excluded by an earlier command, keep it excluded for this one too */
+	if (!l && pf->saved && _saved_bad(pf, dev)) {
+		log_debug_devs("%s: filter cache using saved bad result", dev_name(dev));
+		l = PF_BAD_DEVICE;
+		dm_list_iterate_items(sl, &dev->aliases)
+			if (!dm_hash_insert(pf->devices, sl->str, l)) {
+				log_error("Failed to hash alias to filter.");
+				return 0;
+			}
+	}
+
 	/* Cached bad, skip dev */
 	if (l == PF_BAD_DEVICE) {
 		log_debug_devs("%s: filter cache skipping (cached bad)", dev_name(dev));
@@ -157,11 +256,146 @@ static void _persistent_destroy(struct dev_filter *f)
 		log_error(INTERNAL_ERROR "Destroying persistent filter while in use %u times.", f->use_count);
 
 	dm_hash_destroy(pf->devices);
+	_free_saved(pf);
 	pf->real->destroy(pf->real);
 	free(pf);
 	free(f);
 }
 
+int persistent_filter_load(struct dev_filter *f, const char *path, uint32_t config_hash)
+{
+	struct pfilter *pf = (struct pfilter *) f->private;
+	struct saved_verdict *sv;
+	char line[256];
+	unsigned major, minor, nr = 0, alloc = 0;
+	unsigned long long size, diskseq;
+	uint32_t hash;
+	FILE *fp;
+	int r = 0;
+
+	if (f->passes_filter != _lookup_p)
+		return_0;
+
+	_free_saved(pf);
+
+	if (!(fp = fopen(path, "r"))) {
+		if (errno != ENOENT)
+			log_sys_debug("fopen", path);
+		return 0;
+	}
+
+	if (!fgets(line, sizeof(line), fp) || (sscanf(line, "config: %u", &hash) != 1) ||
+	    (hash != config_hash)) {
+		log_debug_devs("Ignoring filter cache %s for other filter settings.", path);
+		goto out;
+	}
+
+	if (!(pf->saved = dm_hash_create(128)))
+		goto_out;
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%u:%u %llu %llu", &major, &minor, &size, &diskseq) != 4)
+			continue;
+
+		if (nr == alloc) {
+			alloc = alloc ? alloc * 2 : 128;
+			if (!(sv = realloc(pf->saved_verdicts, alloc * sizeof(*sv))))
+				goto_out;
+			pf->saved_verdicts = sv;
+		}
+
+		sv = &pf->saved_verdicts[nr++];
+		sv->devt = MKDEV(major, minor);
+		sv->size = size;
+		sv->diskseq = diskseq;
+	}
+
+	/* Entries point into the array, so hash them once it stops moving. */
+	for (sv = pf->saved_verdicts; sv < pf->saved_verdicts + nr; sv++)
+		if (!dm_hash_insert_binary(pf->saved, &sv->devt, sizeof(sv->devt), sv))
+			goto_out;
+
+	log_debug_devs("Read %u excluded devices from %s.", nr, path);
+	r = 1;
+out:
+	if (!r)
+		_free_saved(pf);
+
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+
+	return r;
+}
+
+int persistent_filter_save(struct cmd_context *cmd, struct dev_filter *f,
+			   const char *path, uint32_t config_hash)
+{
+	struct pfilter *pf = (struct pfilter *) f->private;
+	char tmp[PATH_MAX];
+	struct dev_iter *iter;
+	struct device *dev;
+	uint64_t size, diskseq;
+	unsigned nr = 0;
+	FILE *fp;
+	int r = 1;
+
+	if (f->passes_filter != _lookup_p)
+		return_0;
+
+	if (dm_snprintf(tmp, sizeof(tmp), "%s.tmp", path) < 0)
+		return_0;
+
+	if (!(iter = dev_iter_create(NULL, 0)))
+		return_0;
+
+	if (!(fp = fopen(tmp, "w"))) {
+		log_sys_debug("fopen", tmp);
+		dev_iter_destroy(iter);
+		return 0;
+	}
+
+	fprintf(fp, "config: %u\n", config_hash);
+
+	while ((dev = dev_iter_get(cmd, iter))) {
+		if (dm_list_empty(&dev->aliases) ||
+		    dm_is_dm_major(MAJOR(dev->dev)) ||
+		    (dm_hash_lookup(pf->devices, dev_name(dev)) != PF_BAD_DEVICE) ||
+		    !_get_dev_identity(dev, &size, &diskseq))
+			continue;
+
+		fprintf(fp, "%d:%d %llu %llu\n",
+			(int) MAJOR(dev->dev), (int) MINOR(dev->dev),
+			(unsigned long long) size, (unsigned long long) diskseq);
+		nr++;
+	}
+	dev_iter_destroy(iter);
+
+	if (fflush(fp) || ferror(fp)) {
+		log_sys_debug("fflush", tmp);
+		r = 0;
+	}
+
+	if (fclose(fp)) {
+		log_sys_debug("fclose", tmp);
+		r = 0;
+	}
+
+	if (r && rename(tmp, path)) {
+		log_sys_debug("rename", path);
+		r = 0;
+	}
+
+	if (!r) {
+		if (unlink(tmp))
+			log_sys_debug("unlink", tmp);
+		return 0;
+	}
+
+	log_debug_devs("Wrote %u excluded devices to %s.", nr, path);
+
+	return 1;
+}
+
 struct dev_filter *persistent_filter_create(struct dev_types *dt, struct dev_filter *real)
 {
 	struct pfilter *pf;
@@ -192,6 +426,7 @@ struct dev_filter *persistent_filter_create(struct dev_types *dt, struct dev_fil
 	f->private = pf;
 	f->wipe = _persistent_filter_wipe;
 	f->name = "persistent";
+	f->cost = real->cost;
 
 	log_debug_devs("Persistent filter initialised.");
 
@@ -217,6 +217,7 @@ struct dev_filter *regex_filter_create(const struct dm_config_value *patterns)
 	f->use_count = 0;
 	f->private = rf;
 	f->name = "regex";
+	f->cost = FILTER_COST_NAME;
 
 	log_debug_devs("Regex filter initialised.");
 
@@ -327,6 +327,7 @@ struct dev_filter *sysfs_filter_create(void)
 	f->use_count = 0;
 	f->private = ds;
 	f->name = "sysfs";
+	f->cost = FILTER_COST_SYSFS;
 
 	log_debug_devs("Sysfs filter initialised.");
 
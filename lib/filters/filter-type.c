@@ -57,6 +57,7 @@ struct dev_filter *lvm_type_filter_create(struct dev_types *dt)
 	f->use_count = 0;
 	f->private = dt;
 	f->name = "type";
+	f->cost = FILTER_COST_NAME;
 
 	log_debug_devs("LVM type filter initialised.");
 
@@ -28,6 +28,9 @@ struct dev_filter *fwraid_filter_create(struct dev_types *dt);
 struct dev_filter *mpath_filter_create(struct dev_types *dt);
 struct dev_filter *partitioned_filter_create(struct dev_types *dt);
 struct dev_filter *persistent_filter_create(struct dev_types *dt, struct dev_filter *f);
+int persistent_filter_load(struct dev_filter *f, const char *path, uint32_t config_hash);
+int persistent_filter_save(struct cmd_context *cmd, struct dev_filter *f,
+			   const char *path, uint32_t config_hash);
 struct dev_filter *sysfs_filter_create(void);
 struct dev_filter *signature_filter_create(struct dev_types *dt);
 
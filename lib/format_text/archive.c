@@ -20,6 +20,7 @@
 #include "import-export.h"
 #include "lib/misc/lvm-string.h"
 #include "lib/misc/lvm-file.h"
+#include "lib/misc/lvm-compress.h"
 #include "lib/commands/toolcontext.h"
 
 #include <dirent.h>
@@ -40,8 +41,18 @@
  * the volume group name.
  *
  * Backup files that have expired will be removed.
+ *
+ * Each volume group also has an index of its archives in the
+ * directory, named '.<vgname>.index', so archiving does not need to
+ * scan the whole directory and stat its files.  It holds an
+ * '<index> <mtime> <file name>' line per archive, oldest first.
+ * It is only trusted while it has changed no earlier than the
+ * directory itself: anything else adding or removing files there
+ * makes the next archive fall back to a scan, which rewrites it.
  */
 
+#define ARCHIVE_INDEX_SUFFIX ".index"
+
 /*
  * A list of these is built up for our volume group.  Ordered
  * with the least recent at the head.
@@ -51,6 +62,7 @@ struct archive_file {
 
 	const char *path;
 	uint32_t index;
+	time_t mtime;		/* 0 until known */
 };
 
 /*
@@ -169,6 +181,7 @@ static struct dm_list *_scan_archive(struct dm_pool *mem,
 
 		af->index = ix;
 		af->path = path;
+		af->mtime = 0;
 
 		/*
 		 * Insert it to the correct part of the list.
@@ -184,52 +197,236 @@ static struct dm_list *_scan_archive(struct dm_pool *mem,
 	return results;
 }
 
-static void _remove_expired(struct dm_list *archives, uint32_t archives_size,
-			    uint32_t retain_days, uint32_t min_archive)
+static char *_index_path(struct dm_pool *mem, const char *dir, const char *vgname)
+{
+	if (!dm_pool_begin_object(mem, 32) ||
+	    !dm_pool_grow_object(mem, dir, strlen(dir)) ||
+	    !dm_pool_grow_object(mem, "/.", 2) ||
+	    !dm_pool_grow_object(mem, vgname, strlen(vgname)) ||
+	    !dm_pool_grow_object(mem, ARCHIVE_INDEX_SUFFIX, sizeof(ARCHIVE_INDEX_SUFFIX)))
+		return_NULL;
+
+	return dm_pool_end_object(mem);
+}
+
+/*
+ * Returns the list of archive_files from the index, ordered like
+ * _scan_archive(), or NULL when the index is missing, stale or invalid.
+ */
+static struct dm_list *_read_index(struct dm_pool *mem, const char *vgname,
+				   const char *dir, const char *index_path)
+{
+	char line[PATH_MAX + 64], name[PATH_MAX], vgname_found[64], *path;
+	struct timespec dir_ctim, index_ctim;
+	struct archive_file *af;
+	struct dm_list *results;
+	struct stat sb;
+	long long mtime;
+	uint32_t ix, name_ix, last_ix = 0;
+	FILE *fp;
+
+	if (stat(dir, &sb))
+		return NULL;
+	lvm_stat_ctim(&dir_ctim, &sb);
+
+	if (!(fp = fopen(index_path, "r")))
+		return NULL;
+
+	if (fstat(fileno(fp), &sb))
+		goto_bad;
+	lvm_stat_ctim(&index_ctim, &sb);
+
+	if (timespeccmp(&index_ctim, &dir_ctim, <)) {
+		log_debug_metadata("Archive index %s is older than %s.", index_path, dir);
+		goto bad;
+	}
+
+	if (!(results = dm_pool_alloc(mem, sizeof(*results))))
+		goto_bad;
+
+	dm_list_init(results);
+
+	while (fgets(line, sizeof(line), fp)) {
+		if ((sscanf(line, "%u %lld %4095s", &ix, &mtime, name) != 3) ||
+		    !_split_vg(name, vgname_found, sizeof(vgname_found), &name_ix) ||
+		    (ix != name_ix) || strcmp(vgname, vgname_found) ||
+		    (!dm_list_empty(results) && (ix <= last_ix))) {
+			log_debug_metadata("Ignoring invalid archive index %s.", index_path);
+			goto bad;
+		}
+
+		if (!(path = _join_file_to_dir(mem, dir, name)) ||
+		    !(af = dm_pool_alloc(mem, sizeof(*af))))
+			goto_bad;
+
+		af->index = last_ix = ix;
+		af->path = path;
+		af->mtime = (time_t) mtime;
+
+		/* The index is oldest first, the list newest first. */
+		dm_list_add_h(results, &af->list);
+	}
+
+	if (fclose(fp))
+		log_sys_debug("fclose", index_path);
+
+	return results;
+bad:
+	if (fclose(fp))
+		log_sys_debug("fclose", index_path);
+
+	return NULL;
+}
+
+/*
+ * Rewrites the index from the list, or only appends 'added' to it.
+ * A failure just leaves the index for the next archive to rebuild.
+ */
+static void _write_index(struct dm_list *archives, const char *index_path,
+			 struct archive_file *added)
+{
+	struct archive_file *af;
+	const char *name;
+	FILE *fp;
+
+	if (!(fp = fopen(index_path, added ? "a" : "w"))) {
+		log_sys_debug("fopen", index_path);
+		return;
+	}
+
+	dm_list_iterate_back_items(af, archives) {
+		if (added && (af != added))
+			continue;
+		name = strrchr(af->path, '/') + 1;
+		fprintf(fp, "%u %lld %s\n", af->index, (long long) af->mtime, name);
+	}
+
+	if (dm_fclose(fp)) {
+		log_sys_debug("write", index_path);
+		if (unlink(index_path))
+			log_sys_debug("unlink", index_path);
+	}
+}
+
+/*
+ * Returns the number of archives removed from the list and the directory.
+ */
+static uint32_t _remove_expired(struct dm_list *archives, uint32_t archives_size,
+				uint32_t retain_days, uint32_t min_archive)
 {
 	struct archive_file *bf;
+	struct dm_list *a, *prev;
 	struct stat sb;
 	time_t retain_time;
+	uint32_t expired = 0;
 
 	/* Make sure there are enough archives to even bother looking for
 	 * expired ones... */
 	if (archives_size <= min_archive)
-		return;
+		return 0;
 
 	/* Convert retain_days into the time after which we must retain */
 	retain_time = time(NULL) - (time_t) retain_days *SECS_PER_DAY;
 
 	/* Assume list is ordered newest first (by index) */
-	dm_list_iterate_back_items(bf, archives) {
+	for (a = archives->p; a != archives; a = prev) {
+		prev = a->p;
+		bf = dm_list_item(a, struct archive_file);
+
 		/* Get the mtime of the file and unlink if too old */
-		if (stat(bf->path, &sb)) {
-			log_sys_error("stat", bf->path);
-			continue;
+		if (!bf->mtime) {
+			if (stat(bf->path, &sb)) {
+				log_sys_error("stat", bf->path);
+				continue;
+			}
+			bf->mtime = sb.st_mtime;
 		}
 
-		if (sb.st_mtime > retain_time)
-			return;
+		if (bf->mtime > retain_time)
+			break;
 
 		log_very_verbose("Expiring archive %s", bf->path);
-		if (unlink(bf->path))
+		if (unlink(bf->path) && (errno != ENOENT))
 			log_sys_error("unlink", bf->path);
 
+		dm_list_del(&bf->list);
+		expired++;
+
 		/* Don't delete any more if we've reached the minimum */
 		if (--archives_size <= min_archive)
-			return;
+			break;
+	}
+
+	return expired;
+}
+
+/*
+ * Write the metadata as a text file.  A VG read for writing keeps the
+ * exported text of what is on disk in vg_committed_text, which is what
+ * an archive records, so that is reused instead of exporting again.
+ */
+static int _export_file(struct volume_group *vg, const char *desc, FILE *fp)
+{
+	if (vg->vg_committed_text)
+		return text_vg_export_file_from_buffer(vg->cmd, vg->vg_committed_text,
+						       desc, fp);
+
+	return text_vg_export_file(vg, desc, fp);
+}
+
+/*
+ * Writes the metadata compressed when that makes it smaller.  The
+ * text is the same as in the metadata area, which vgcfgrestore reads
+ * just like the commented text of an uncompressed archive.
+ */
+static int _export_compressed(struct volume_group *vg, const char *desc,
+			      FILE *fp)
+{
+	char *text = NULL, *buf = NULL;
+	size_t text_size, size;
+	uint32_t buf_size;
+	int r = 0;
+
+	if (vg->vg_committed_text)
+		text_size = text_vg_export_raw_from_buffer(vg->cmd, vg->vg_committed_text,
+							   desc, &text);
+	else
+		text_size = text_vg_export_raw(vg, desc, &text, NULL);
+
+	if (!text_size)
+		return_0;
+
+	/* Exported size includes the terminating NUL. */
+	if (!(size = compress_text(text, text_size - 1, &buf, &buf_size))) {
+		r = _export_file(vg, desc, fp);
+		goto out;
 	}
+
+	if (fwrite(buf, 1, size, fp) != size) {
+		log_sys_error("fwrite", "archive");
+		goto out;
+	}
+
+	r = 1;
+out:
+	free(buf);
+	free(text);
+
+	return r;
 }
 
 int archive_vg(struct volume_group *vg,
 	       const char *dir, const char *desc,
-	       uint32_t retain_days, uint32_t min_archive)
+	       uint32_t retain_days, uint32_t min_archive, int compress)
 {
-	int i, fd, rnum, renamed = 0;
-	uint32_t ix = 0;
-	struct archive_file *last;
+	int i, fd, rnum, renamed = 0, exported;
+	uint32_t ix = 0, expired;
+	struct archive_file *last, *af = NULL;
 	FILE *fp = NULL;
 	char temp_file[PATH_MAX], archive_name[PATH_MAX];
 	struct dm_list *archives;
+	char *index_path;
+	int scanned = 0;
 
 	/*
 	 * Write the vg out to a temporary file.
@@ -247,7 +444,15 @@ int archive_vg(struct volume_group *vg,
 		return 0;
 	}
 
-	if (!text_vg_export_file(vg, desc, fp)) {
+	if (compress && !compressed_text_supported()) {
+		log_warn("WARNING: Ignoring backup/compress_archive, compressed metadata is not supported by this build.");
+		compress = 0;
+	}
+
+	exported = compress ? _export_compressed(vg, desc, fp) :
+		_export_file(vg, desc, fp);
+
+	if (!exported) {
 		if (fclose(fp))
 			log_sys_error("fclose", temp_file);
 		return_0;
@@ -259,9 +464,15 @@ int archive_vg(struct volume_group *vg,
 	/*
 	 * Now we want to rename this file to <vg>_index.vg.
 	 */
-	if (!(archives = _scan_archive(vg->cmd->mem, vg->name, dir)))
+	if (!(index_path = _index_path(vg->cmd->mem, dir, vg->name)))
 		return_0;
 
+	if (!(archives = _read_index(vg->cmd->mem, vg->name, dir, index_path))) {
+		if (!(archives = _scan_archive(vg->cmd->mem, vg->name, dir)))
+			return_0;
+		scanned = 1;
+	}
+
 	if (dm_list_empty(archives))
 		ix = 0;
 	else {
@@ -288,8 +499,24 @@ int archive_vg(struct volume_group *vg,
 	if (!renamed)
 		log_error("Archive rename failed for %s", temp_file);
 
-	_remove_expired(archives, dm_list_size(archives) + renamed, retain_days,
-			min_archive);
+	expired = _remove_expired(archives, dm_list_size(archives) + renamed, retain_days,
+				  min_archive);
+
+	if (renamed) {
+		if (!(af = dm_pool_alloc(vg->cmd->mem, sizeof(*af))) ||
+		    !(af->path = dm_pool_strdup(vg->cmd->mem, archive_name))) {
+			/* Leave the index for the next archive to rebuild. */
+			if (unlink(index_path) && (errno != ENOENT))
+				log_sys_debug("unlink", index_path);
+			return 1;
+		}
+		af->index = ix;
+		af->mtime = time(NULL);
+		dm_list_add_h(archives, &af->list);
+	}
+
+	if (renamed || scanned || expired)
+		_write_index(archives, index_path, (scanned || expired) ? NULL : af);
 
 	return 1;
 }
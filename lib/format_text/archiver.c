@@ -16,30 +16,58 @@
 #include "lib/misc/lib.h"
 #include "lib/format_text/archiver.h"
 #include "lib/format_text/format-text.h"
+#include "lib/format_text/import-export.h"
 #include "lib/misc/lvm-string.h"
 #include "lib/cache/lvmcache.h"
 #include "lib/mm/memlock.h"
 #include "lib/commands/toolcontext.h"
 #include "lib/locking/locking.h"
+#include "lib/misc/lvm-file.h"
 
 #include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/*
+ * Snapshots of VG metadata for reports run with --cached, one file per
+ * VG named <vgname>.<seqno>.  Commands reading or committing a VG under
+ * its lock touch the file, so its mtime tells when the metadata was
+ * last known to be current.
+ */
+#define VG_SNAPSHOT_DIR DEFAULT_RUN_DIR "/vgs_cached"
 
 struct archive_params {
 	int enabled;
 	char *dir;
 	unsigned int keep_days;
 	unsigned int keep_number;
+	int compress;
 };
 
 struct backup_params {
 	int enabled;
 	char *dir;
 	int suppress;
+	struct dm_list pending;	/* struct pending_backup */
+};
+
+/*
+ * Backup taken after a commit, written out when the VG is unlocked.
+ * Commands committing the same VG several times write the file once,
+ * from the metadata text already exported for the metadata areas.
+ */
+struct pending_backup {
+	struct dm_list list;
+	char *vg_name;
+	char *desc;
+	char *text;
+	uint32_t seqno;
 };
 
 int archive_init(struct cmd_context *cmd, const char *dir,
 		 unsigned int keep_days, unsigned int keep_min,
-		 int enabled)
+		 int compress, int enabled)
 {
 	archive_exit(cmd);
 
@@ -61,6 +89,7 @@ int archive_init(struct cmd_context *cmd, const char *dir,
 
 	cmd->archive_params->keep_days = keep_days;
 	cmd->archive_params->keep_number = keep_min;
+	cmd->archive_params->compress = compress;
 	archive_enable(cmd, enabled);
 
 	return 1;
@@ -145,7 +174,8 @@ static int _archive(struct volume_group *vg, int compulsory)
 
 	if (!archive_vg(vg, vg->cmd->archive_params->dir, desc,
 			vg->cmd->archive_params->keep_days,
-			vg->cmd->archive_params->keep_number))
+			vg->cmd->archive_params->keep_number,
+			vg->cmd->archive_params->compress))
 		return_0;
 
 	vg->status |= ARCHIVED_VG;
@@ -189,6 +219,7 @@ int backup_init(struct cmd_context *cmd, const char *dir,
 	}
 
 	cmd->backup_params->dir = NULL;
+	dm_list_init(&cmd->backup_params->pending);
 	if (!*dir)
 		return 1;
 
@@ -205,8 +236,11 @@ void backup_exit(struct cmd_context *cmd)
 {
 	if (!cmd->backup_params)
 		return;
+	if (!backup_flush(cmd, NULL))
+		stack;
 	free(cmd->backup_params->dir);
 	memset(cmd->backup_params, 0, sizeof(*cmd->backup_params));
+	dm_list_init(&cmd->backup_params->pending);
 }
 
 void backup_enable(struct cmd_context *cmd, int flag)
@@ -232,6 +266,155 @@ static int _backup(struct volume_group *vg)
 	return backup_to_file(name, desc, vg);
 }
 
+static void _free_pending_backup(struct pending_backup *pb)
+{
+	dm_list_del(&pb->list);
+	free(pb->vg_name);
+	free(pb->desc);
+	free(pb->text);
+	free(pb);
+}
+
+static struct pending_backup *_find_pending_backup(struct cmd_context *cmd,
+						   const char *vg_name)
+{
+	struct pending_backup *pb;
+
+	dm_list_iterate_items(pb, &cmd->backup_params->pending)
+		if (!strcmp(pb->vg_name, vg_name))
+			return pb;
+
+	return NULL;
+}
+
+/*
+ * Queue the committed metadata of vg for writing at unlock time.
+ * The text exported by vg_write() is reused when it is still around.
+ */
+static int _queue_backup(struct volume_group *vg)
+{
+	struct pending_backup *pb;
+	char *desc, *text = NULL;
+
+	if (!(desc = _build_desc(vg->cmd->mem, vg->cmd->cmd_line, 0)))
+		return_0;
+
+	if (vg->vg_committed_text) {
+		if (!(text = strdup(vg->vg_committed_text)))
+			return_0;
+	} else if (!export_vg_to_buffer(vg, &text))
+		return_0;
+
+	if (!(pb = _find_pending_backup(vg->cmd, vg->name))) {
+		if (!(pb = zalloc(sizeof(*pb))) ||
+		    !(pb->vg_name = strdup(vg->name))) {
+			free(pb);
+			free(text);
+			return_0;
+		}
+		dm_list_add(&vg->cmd->backup_params->pending, &pb->list);
+	}
+
+	free(pb->desc);
+	free(pb->text);
+	pb->text = text;
+	pb->seqno = vg->seqno;
+
+	if (!(pb->desc = strdup(desc))) {
+		_free_pending_backup(pb);
+		return_0;
+	}
+
+	log_debug_metadata("Queued backup of volume group %s (seqno %u).",
+			   vg->name, vg->seqno);
+
+	return 1;
+}
+
+/* Same steps as the text format's file write and commit */
+static int _write_pending_backup(struct cmd_context *cmd, struct pending_backup *pb)
+{
+	char path[PATH_MAX], temp_file[PATH_MAX];
+	FILE *fp;
+	int fd;
+
+	if (dm_snprintf(path, sizeof(path), "%s/%s",
+			cmd->backup_params->dir, pb->vg_name) < 0) {
+		log_error("Failed to generate volume group metadata backup "
+			  "filename.");
+		return 0;
+	}
+
+	log_verbose("Creating volume group backup \"%s\" (seqno %u).", path, pb->seqno);
+
+	if (!create_temp_name(cmd->backup_params->dir, temp_file, sizeof(temp_file),
+			      &fd, &cmd->rand_seed)) {
+		log_error("Couldn't create temporary text file name.");
+		return 0;
+	}
+
+	if (!(fp = fdopen(fd, "w"))) {
+		log_sys_error("fdopen", temp_file);
+		if (close(fd))
+			log_sys_error("fclose", temp_file);
+		goto bad;
+	}
+
+	if (!text_vg_export_file_from_buffer(cmd, pb->text, pb->desc, fp)) {
+		log_error("Failed to write metadata to %s.", temp_file);
+		if (fclose(fp))
+			log_sys_error("fclose", temp_file);
+		goto bad;
+	}
+
+	if (fsync(fd) && (errno != EROFS) && (errno != EINVAL)) {
+		log_sys_error("fsync", temp_file);
+		if (fclose(fp))
+			log_sys_error("fclose", temp_file);
+		goto bad;
+	}
+
+	if (lvm_fclose(fp, temp_file))
+		goto_bad;
+
+	if (rename(temp_file, path)) {
+		log_error("%s: rename to %s failed: %s", temp_file,
+			  path, strerror(errno));
+		goto bad;
+	}
+
+	sync_dir(path);
+
+	return 1;
+bad:
+	if (unlink(temp_file))
+		log_sys_debug("unlink", temp_file);
+
+	return 0;
+}
+
+int backup_flush(struct cmd_context *cmd, const char *vg_name)
+{
+	struct pending_backup *pb, *tmp;
+	int r = 1;
+
+	if (!cmd->backup_params)
+		return 1;
+
+	dm_list_iterate_items_safe(pb, tmp, &cmd->backup_params->pending) {
+		if (vg_name && strcmp(pb->vg_name, vg_name))
+			continue;
+		if (!_write_pending_backup(cmd, pb)) {
+			log_error("Backup of volume group %s metadata failed.",
+				  pb->vg_name);
+			r = 0;
+		}
+		_free_pending_backup(pb);
+	}
+
+	return r;
+}
+
 int backup_locally(struct volume_group *vg)
 {
 	if (!vg->cmd->backup_params->enabled || !vg->cmd->backup_params->dir) {
@@ -256,6 +439,9 @@ int backup_locally(struct volume_group *vg)
 		return 0;
 	}
 
+	if (_queue_backup(vg))
+		return 1;
+
 	if (!_backup(vg)) {
 		log_error("Backup of volume group %s metadata failed.",
 			  vg->name);
@@ -279,8 +465,12 @@ int backup(struct volume_group *vg)
 
 int backup_remove(struct cmd_context *cmd, const char *vg_name)
 {
+	struct pending_backup *pb;
 	char path[PATH_MAX];
 
+	if ((pb = _find_pending_backup(cmd, vg_name)))
+		_free_pending_backup(pb);
+
 	if (dm_snprintf(path, sizeof(path), "%s/%s",
 			 cmd->backup_params->dir, vg_name) < 0) {
 		log_error("Failed to generate backup filename (for removal).");
@@ -293,11 +483,13 @@ int backup_remove(struct cmd_context *cmd, const char *vg_name)
 	if (unlink(path))
 		log_sys_debug("unlink", path);
 
+	vg_snapshot_remove(cmd, vg_name);
+
 	return 1;
 }
 
-struct volume_group *backup_read_vg(struct cmd_context *cmd,
-				    const char *vg_name, const char *file)
+static struct volume_group *_read_vg_file(struct cmd_context *cmd,
+					  const char *vg_name, const char *file)
 {
 	struct volume_group *vg = NULL;
 	struct format_instance *tf;
@@ -320,15 +512,23 @@ struct volume_group *backup_read_vg(struct cmd_context *cmd,
 		break;
 	}
 
-	if (vg)
-		set_pv_devices(tf, vg, NULL);
-
 	if (!vg)
 		tf->fmt->ops->destroy_instance(tf);
 
 	return vg;
 }
 
+struct volume_group *backup_read_vg(struct cmd_context *cmd,
+				    const char *vg_name, const char *file)
+{
+	struct volume_group *vg;
+
+	if ((vg = _read_vg_file(cmd, vg_name, file)))
+		set_pv_devices(vg->fid, vg, NULL);
+
+	return vg;
+}
+
 static int _restore_vg_should_write_pv(struct physical_volume *pv, int do_pvcreate)
 {
 	struct lvmcache_info *info;
@@ -650,3 +850,214 @@ void check_current_backup(struct volume_group *vg)
 	if (!backup_locally(vg))
 		stack;
 }
+
+/* Returns the length of the VG name in a snapshot file name, 0 if it is not one */
+static size_t _snapshot_name(const char *file, uint32_t *seqno)
+{
+	const char *dot = strrchr(file, '.');
+	char *end;
+
+	if (!dot || (dot == file) || (file[0] == '.') ||
+	    !isdigit((unsigned char) dot[1]))
+		return 0;
+
+	errno = 0;
+	*seqno = (uint32_t) strtoul(dot + 1, &end, 10);
+	if (*end || errno)
+		return 0;
+
+	return dot - file;
+}
+
+/* Removes the snapshots of vg_name other than the one named keep */
+static void _remove_snapshots(const char *vg_name, const char *keep)
+{
+	char path[PATH_MAX];
+	struct dirent *dirent;
+	uint32_t seqno;
+	DIR *d;
+
+	if (!(d = opendir(VG_SNAPSHOT_DIR)))
+		return;
+
+	while ((dirent = readdir(d))) {
+		if ((_snapshot_name(dirent->d_name, &seqno) != strlen(vg_name)) ||
+		    strncmp(dirent->d_name, vg_name, strlen(vg_name)) ||
+		    (keep && !strcmp(dirent->d_name, keep)))
+			continue;
+
+		if ((dm_snprintf(path, sizeof(path), "%s/%s", VG_SNAPSHOT_DIR, dirent->d_name) < 0) ||
+		    unlink(path))
+			log_debug("Failed to remove VG snapshot %s.", dirent->d_name);
+	}
+
+	if (closedir(d))
+		log_sys_debug("closedir", VG_SNAPSHOT_DIR);
+}
+
+/* Like _write_pending_backup(), without fsync as the directory is under /run */
+static int _write_snapshot(struct cmd_context *cmd, const char *path, const char *text)
+{
+	char temp_file[PATH_MAX];
+	FILE *fp;
+	int fd;
+
+	if (!create_temp_name(VG_SNAPSHOT_DIR, temp_file, sizeof(temp_file),
+			      &fd, &cmd->rand_seed))
+		return_0;
+
+	if (!(fp = fdopen(fd, "w"))) {
+		log_sys_debug("fdopen", temp_file);
+		if (close(fd))
+			log_sys_debug("close", temp_file);
+		goto bad;
+	}
+
+	if (!text_vg_export_file_from_buffer(cmd, text, "Snapshot for reports run with --cached", fp)) {
+		if (fclose(fp))
+			log_sys_debug("fclose", temp_file);
+		goto bad;
+	}
+
+	if (fclose(fp)) {
+		log_sys_debug("fclose", temp_file);
+		goto bad;
+	}
+
+	if (rename(temp_file, path)) {
+		log_sys_debug("rename", temp_file);
+		goto bad;
+	}
+
+	return 1;
+bad:
+	if (unlink(temp_file))
+		log_sys_debug("unlink", temp_file);
+
+	return 0;
+}
+
+/*
+ * Called with the VG lock held after vg is read or committed.
+ * Failing is not an error, --cached reports then show the age.
+ */
+void vg_snapshot_update(struct volume_group *vg)
+{
+	struct cmd_context *cmd = vg->cmd;
+	char path[PATH_MAX], file[NAME_LEN + 16];
+	char *text = NULL;
+
+	if (is_orphan_vg(vg->name) || vg_is_exported(vg) ||
+	    test_mode() || critical_section())
+		return;
+
+	if ((dm_snprintf(file, sizeof(file), "%s.%u", vg->name, vg->seqno) < 0) ||
+	    (dm_snprintf(path, sizeof(path), "%s/%s", VG_SNAPSHOT_DIR, file) < 0))
+		return;
+
+	/* Metadata unchanged since the snapshot, just mark it current */
+	if (!utimensat(AT_FDCWD, path, NULL, 0))
+		return;
+
+	if (errno != ENOENT) {
+		log_sys_debug("utimensat", path);
+		return;
+	}
+
+	if ((mkdir(VG_SNAPSHOT_DIR, 0700) < 0) && (errno != EEXIST)) {
+		log_sys_debug("mkdir", VG_SNAPSHOT_DIR);
+		return;
+	}
+
+	if (vg->vg_committed_text) {
+		if (!(text = strdup(vg->vg_committed_text)))
+			return;
+	} else if (!export_vg_to_buffer(vg, &text))
+		return;
+
+	if (_write_snapshot(cmd, path, text)) {
+		log_debug_metadata("Updated VG snapshot %s.", path);
+		_remove_snapshots(vg->name, file);
+	} else
+		log_debug("Failed to write VG snapshot %s.", path);
+
+	free(text);
+}
+
+void vg_snapshot_remove(struct cmd_context *cmd __attribute__((unused)),
+			const char *vg_name)
+{
+	_remove_snapshots(vg_name, NULL);
+}
+
+int vg_snapshot_list(struct cmd_context *cmd, struct dm_list *snapshots)
+{
+	struct vg_snapshot *snap, *found;
+	struct dirent *dirent;
+	struct stat info;
+	uint32_t seqno;
+	size_t len;
+	DIR *d;
+	int r = 1;
+
+	dm_list_init(snapshots);
+
+	if (!(d = opendir(VG_SNAPSHOT_DIR))) {
+		if (errno != ENOENT)
+			log_sys_debug("opendir", VG_SNAPSHOT_DIR);
+		return 1;
+	}
+
+	while ((dirent = readdir(d))) {
+		if (!(len = _snapshot_name(dirent->d_name, &seqno)))
+			continue;
+
+		if (!(snap = dm_pool_zalloc(cmd->mem, sizeof(*snap))) ||
+		    !(snap->vgname = dm_pool_strndup(cmd->mem, dirent->d_name, len)) ||
+		    !(snap->path = dm_pool_zalloc(cmd->mem, PATH_MAX)) ||
+		    (dm_snprintf(snap->path, PATH_MAX, "%s/%s", VG_SNAPSHOT_DIR, dirent->d_name) < 0)) {
+			r = 0;
+			break;
+		}
+
+		/* Replaced or removed since readdir */
+		if (stat(snap->path, &info))
+			continue;
+
+		snap->seqno = seqno;
+		snap->mtime = info.st_mtime;
+
+		/* A writer may not have removed the previous one yet */
+		found = NULL;
+		dm_list_iterate_items(found, snapshots)
+			if (!strcmp(found->vgname, snap->vgname))
+				break;
+
+		if (&found->list == snapshots)
+			dm_list_add(snapshots, &snap->list);
+		else if (found->seqno < snap->seqno) {
+			found->seqno = snap->seqno;
+			found->mtime = snap->mtime;
+			found->path = snap->path;
+		}
+	}
+
+	if (closedir(d))
+		log_sys_debug("closedir", VG_SNAPSHOT_DIR);
+
+	return r;
+}
+
+/* PVs are not matched to devices, the caller sets pv->dev if it can */
+struct volume_group *vg_snapshot_read(struct cmd_context *cmd, struct vg_snapshot *snap)
+{
+	struct volume_group *vg;
+
+	if (!(vg = _read_vg_file(cmd, snap->vgname, snap->path)))
+		return_NULL;
+
+	if (vg->seqno != snap->seqno)
+		log_debug("VG snapshot %s has seqno %u.", snap->path, vg->seqno);
+
+	return vg;
+}
@@ -33,7 +33,7 @@
 
 int archive_init(struct cmd_context *cmd, const char *dir,
 		 unsigned int keep_days, unsigned int keep_min,
-		 int enabled);
+		 int compress, int enabled);
 void archive_exit(struct cmd_context *cmd);
 
 void archive_enable(struct cmd_context *cmd, int flag);
@@ -48,6 +48,8 @@ void backup_enable(struct cmd_context *cmd, int flag);
 int backup(struct volume_group *vg);
 int backup_locally(struct volume_group *vg);
 int backup_remove(struct cmd_context *cmd, const char *vg_name);
+/* Write backups queued by backup(), all of them if vg_name is NULL */
+int backup_flush(struct cmd_context *cmd, const char *vg_name);
 
 struct volume_group *backup_read_vg(struct cmd_context *cmd,
 				    const char *vg_name, const char *file);
@@ -63,4 +65,17 @@ int backup_to_file(const char *file, const char *desc, struct volume_group *vg);
 
 void check_current_backup(struct volume_group *vg);
 
+struct vg_snapshot {
+	struct dm_list list;
+	const char *vgname;
+	char *path;
+	uint32_t seqno;
+	time_t mtime;	/* when a command last found the metadata unchanged */
+};
+
+void vg_snapshot_update(struct volume_group *vg);
+void vg_snapshot_remove(struct cmd_context *cmd, const char *vg_name);
+int vg_snapshot_list(struct cmd_context *cmd, struct dm_list *snapshots);
+struct volume_group *vg_snapshot_read(struct cmd_context *cmd, struct vg_snapshot *snap);
+
 #endif
@@ -196,10 +196,17 @@ static int _out_with_comment_raw(struct formatter *f,
 	int n;
 	va_list apc;
 
-	va_copy(apc, ap);
-	n = vsnprintf(f->data.buf.start + f->data.buf.used,
-		      f->data.buf.size - f->data.buf.used, fmt, apc);
-	va_end(apc);
+	if (!strchr(fmt, '%')) {
+		/* Plain text such as closing braces needs no formatting */
+		n = strlen(fmt);
+		if (n + f->data.buf.used + 2 <= f->data.buf.size)
+			memcpy(f->data.buf.start + f->data.buf.used, fmt, n + 1);
+	} else {
+		va_copy(apc, ap);
+		n = vsnprintf(f->data.buf.start + f->data.buf.used,
+			      f->data.buf.size - f->data.buf.used, fmt, apc);
+		va_end(apc);
+	}
 
 	/* If metadata doesn't fit, extend buffer */
 	if (n < 0 || (n + f->data.buf.used + 2 > f->data.buf.size)) {
@@ -331,6 +338,8 @@ int out_config_node(struct formatter *f, const struct dm_config_node *cn)
 	return dm_config_write_node(cn, _out_line, f);
 }
 
+#define HEADER_START "# Generated by LVM2 version"
+
 static int _print_header(struct cmd_context *cmd, struct formatter *f,
 			 const char *desc)
 {
@@ -339,7 +348,7 @@ static int _print_header(struct cmd_context *cmd, struct formatter *f,
 
 	t = time(NULL);
 
-	outf(f, "# Generated by LVM2 version %s: %s", LVM_VERSION, ctime(&t));
+	outf(f, HEADER_START " %s: %s", LVM_VERSION, ctime(&t));
 	outf(f, CONTENTS_FIELD " = \"" CONTENTS_VALUE "\"");
 	outf(f, FORMAT_VERSION_FIELD " = %d", FORMAT_VERSION_VALUE);
 	outnl(f);
@@ -1063,7 +1072,15 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf,
 	if (!(f = zalloc(sizeof(*f))))
 		return_0;
 
-	f->data.buf.size = 65536;	/* Initial metadata limit */
+	/*
+	 * Initial metadata limit.  When this VG was exported before, start
+	 * with room for that size plus some growth, in 64K multiples, so
+	 * big VGs are not repeatedly doubled and reformatted.
+	 */
+	f->data.buf.size = 65536;
+	if (vg->text_size)
+		f->data.buf.size = (vg->text_size + vg->text_size / 8 + 65535) & ~65535U;
+
 	if (!(f->data.buf.start = zalloc(f->data.buf.size))) {
 		log_error("text_export buffer allocation failed");
 		goto out;
@@ -1081,6 +1098,7 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf,
 
 	r = f->data.buf.used + 1;
 	*buf = f->data.buf.start;
+	vg->text_size = f->data.buf.used;
 
 	if (buf_size)
 		*buf_size = f->data.buf.size;
@@ -1090,17 +1108,92 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf,
 	return r;
 }
 
-static size_t _export_vg_to_buffer(struct volume_group *vg, char **buf)
+size_t export_vg_to_buffer(struct volume_group *vg, char **buf)
 {
 	return text_vg_export_raw(vg, "", buf, NULL);
 }
 
+/*
+ * Write metadata text produced by export_vg_to_buffer() as a file
+ * with its own header.  The raw text ends with a header of its own,
+ * only the VG section before it is copied.  Raw text has no comments,
+ * so the first line starting with HEADER_START is where it begins.
+ */
+int text_vg_export_file_from_buffer(struct cmd_context *cmd, const char *buf,
+				    const char *desc, FILE *fp)
+{
+	struct formatter f = { 0 };
+	const char *end;
+
+	_init();
+
+	if (!(end = strstr(buf, "\n" HEADER_START))) {
+		log_error(INTERNAL_ERROR "Metadata text has no volume group section.");
+		return 0;
+	}
+
+	f.data.fp = fp;
+	f.header = 1;
+	f.out_with_comment = &_out_with_comment_file;
+	f.nl = &_nl_file;
+
+	if (!_print_header(cmd, &f, desc))
+		return_0;
+
+	if (fwrite(buf, end + 1 - buf, 1, fp) != 1)
+		return_0;
+
+	return !ferror(fp);
+}
+
+/*
+ * Same as text_vg_export_file_from_buffer(), producing raw text like
+ * text_vg_export_raw() with desc in its trailing header.
+ * Returns amount of buffer used incl. terminating NUL.
+ */
+size_t text_vg_export_raw_from_buffer(struct cmd_context *cmd, const char *buf,
+				      const char *desc, char **out)
+{
+	struct formatter f = { 0 };
+	const char *end;
+	size_t len;
+
+	_init();
+
+	if (!(end = strstr(buf, "\n" HEADER_START))) {
+		log_error(INTERNAL_ERROR "Metadata text has no volume group section.");
+		return 0;
+	}
+
+	len = end + 1 - buf;
+	f.data.buf.size = (len + 4096 + 65535) & ~65535U;
+
+	if (!(f.data.buf.start = zalloc(f.data.buf.size))) {
+		log_error("text_export buffer allocation failed");
+		return 0;
+	}
+
+	memcpy(f.data.buf.start, buf, len);
+	f.data.buf.used = len;
+	f.out_with_comment = &_out_with_comment_raw;
+	f.nl = &_nl_raw;
+
+	if (!_print_header(cmd, &f, desc)) {
+		free(f.data.buf.start);
+		return_0;
+	}
+
+	*out = f.data.buf.start;
+
+	return f.data.buf.used + 1;
+}
+
 struct dm_config_tree *export_vg_to_config_tree(struct volume_group *vg)
 {
 	char *buf = NULL;
 	struct dm_config_tree *vg_cft;
 
-	if (!_export_vg_to_buffer(vg, &buf)) {
+	if (!export_vg_to_buffer(vg, &buf)) {
 		log_error("Could not format metadata for VG %s.", vg->name);
 		return NULL;
 	}
@@ -25,9 +25,11 @@
 #include "lib/misc/lvm-string.h"
 #include "lib/uuid/uuid.h"
 #include "lib/misc/crc.h"
+#include "lib/misc/lvm-compress.h"
 #include "lib/mm/xlate.h"
 #include "lib/label/label.h"
 #include "lib/cache/lvmcache.h"
+#include "lib/label/hints.h"
 
 #include <unistd.h>
 #include <limits.h>
@@ -41,6 +43,7 @@ struct text_fid_context {
 	char *write_buf;         /* buffer containing metadata text to write to disk */
 	uint32_t write_buf_size; /* mem size of write_buf, increases in 64K multiples */
 	uint32_t new_metadata_size; /* size of text metadata in buf */
+	uint32_t new_metadata_checksum; /* crc of text metadata in buf */
 	unsigned preserve:1;
 };
 
@@ -68,6 +71,7 @@ void free_text_fidtc(struct volume_group *vg)
 	fidtc->write_buf = NULL;
 	fidtc->write_buf_size = 0;
 	fidtc->new_metadata_size = 0;
+	fidtc->new_metadata_checksum = 0;
 }
 
 int rlocn_is_ignored(const struct raw_locn *rlocn)
@@ -83,6 +87,37 @@ void rlocn_set_ignored(struct raw_locn *rlocn, unsigned mda_ignored)
 		rlocn->flags &= ~RAW_LOCN_IGNORED;
 }
 
+int rlocn_is_compressed(const struct raw_locn *rlocn)
+{
+	return (rlocn->flags & RAW_LOCN_COMPRESSED ? 1 : 0);
+}
+
+void rlocn_set_compressed(struct raw_locn *rlocn, unsigned compressed)
+{
+	if (compressed)
+		rlocn->flags |= RAW_LOCN_COMPRESSED;
+	else
+		rlocn->flags &= ~RAW_LOCN_COMPRESSED;
+}
+
+int rlocn_is_delta(const struct raw_locn *rlocn)
+{
+	return (rlocn->flags & RAW_LOCN_DELTA ? 1 : 0);
+}
+
+void rlocn_set_delta(struct raw_locn *rlocn, unsigned delta)
+{
+	if (delta)
+		rlocn->flags |= RAW_LOCN_DELTA;
+	else
+		rlocn->flags &= ~RAW_LOCN_DELTA;
+}
+
+static void _rlocn_copy_encoding(struct raw_locn *dst, const struct raw_locn *src)
+{
+	dst->flags = (dst->flags & ~RAW_LOCN_ENCODING) | (src->flags & RAW_LOCN_ENCODING);
+}
+
 /*
  * NOTE: Currently there can be only one vg per text file.
  */
@@ -297,7 +332,8 @@ static struct raw_locn *_read_metadata_location_vg(struct cmd_context *cmd,
 				       int *precommitted)
 {
 	size_t len;
-	char vgnamebuf[NAME_LEN + 2] __attribute__((aligned(8)));
+	char vgnamebuf[DELTA_TEXT_MAGIC_LEN + NAME_LEN + 2] __attribute__((aligned(8)));
+	char *name = vgnamebuf;
 	struct raw_locn *rlocn, *rlocn_precommitted;
 	struct lvmcache_info *info;
 	struct lvmcache_vgsummary vgsummary_orphan = {
@@ -357,17 +393,43 @@ static struct raw_locn *_read_metadata_location_vg(struct cmd_context *cmd,
 	 */
 	memset(vgnamebuf, 0, sizeof(vgnamebuf));
 
-	if (!dev_read_bytes(dev_area->dev, dev_area->start + rlocn->offset, NAME_LEN, vgnamebuf))
+	if (!dev_read_bytes(dev_area->dev, dev_area->start + rlocn->offset,
+			    DELTA_TEXT_MAGIC_LEN + NAME_LEN, vgnamebuf))
 		goto fail;
 
-	if (!strncmp(vgnamebuf, vgname, len = strlen(vgname)) &&
-	    (isspace(vgnamebuf[len]) || vgnamebuf[len] == '{'))
+	/*
+	 * Compressed text has no VG name to check up front,
+	 * the name is checked once the metadata is parsed.
+	 */
+	if (rlocn_is_compressed(rlocn)) {
+		if (text_is_compressed(vgnamebuf, NAME_LEN))
+			return rlocn;
+		log_error("Metadata on %s at %llu is flagged compressed but has no compressed header.",
+			  dev_name(dev_area->dev),
+			  (unsigned long long)(dev_area->start + rlocn->offset));
+		goto fail_name;
+	}
+
+	/* Delta text has the VG name after its marker line. */
+	if (rlocn_is_delta(rlocn)) {
+		if (!text_is_delta(vgnamebuf, DELTA_TEXT_MAGIC_LEN)) {
+			log_error("Metadata on %s at %llu is flagged delta but has no delta marker.",
+				  dev_name(dev_area->dev),
+				  (unsigned long long)(dev_area->start + rlocn->offset));
+			goto fail_name;
+		}
+		name += DELTA_TEXT_MAGIC_LEN;
+	}
+
+	if (!strncmp(name, vgname, len = strlen(vgname)) &&
+	    (isspace(name[len]) || name[len] == '{'))
 		return rlocn;
  fail:
 	log_error("Metadata on %s at %llu has wrong VG name \"%s\" expected %s.",
 		  dev_name(dev_area->dev),
 		  (unsigned long long)(dev_area->start + rlocn->offset),
-		  vgnamebuf, vgname);
+		  name, vgname);
+ fail_name:
 
 	if ((info = lvmcache_info_from_pvid(dev_area->dev->pvid, dev_area->dev, 0)) &&
 	    !lvmcache_update_vgname_and_id(cmd, info, &vgsummary_orphan))
@@ -485,6 +547,7 @@ static struct volume_group *_vg_read_raw_area(struct cmd_context *cmd,
 				wrap,
 				calc_crc,
 				rlocn->checksum,
+				area->start, mdah->size,
 				&when, &desc);
 
 	if (!vg) {
@@ -576,6 +639,233 @@ static struct volume_group *_vg_read_precommit_raw(struct cmd_context *cmd,
  * into slot 0.
  */
 
+/*
+ * Copy metadata text already exported by vg_write into a new write_buf,
+ * sized in 64K multiples and zero padded like text_vg_export_raw's.
+ */
+static size_t _copy_write_buf(const char *text, size_t size,
+			      char **write_buf, uint32_t *write_buf_size)
+{
+	uint32_t buf_size = (size + 65535) & ~65535U;
+
+	if (!(*write_buf = zalloc(buf_size))) {
+		log_error("Failed to allocate metadata write buffer.");
+		return 0;
+	}
+
+	memcpy(*write_buf, text, size);
+	*write_buf_size = buf_size;
+
+	return size;
+}
+
+/*
+ * Replace the exported text in write_buf with its compressed encoding,
+ * keeping the text when it cannot be compressed or would not shrink.
+ */
+static size_t _compress_write_buf(struct volume_group *vg, size_t text_size,
+				  char **write_buf, uint32_t *write_buf_size)
+{
+	char *buf;
+	uint32_t buf_size;
+	size_t size;
+
+	if (!compressed_text_supported()) {
+		log_warn("WARNING: Ignoring metadata/compress_metadata, compressed metadata is not supported by this build.");
+		return text_size;
+	}
+
+	if (!(size = compress_text(*write_buf, text_size, &buf, &buf_size)))
+		return text_size;
+
+	log_debug_metadata("VG %s %u metadata compressed from %zu to %zu bytes",
+			   vg->name, vg->seqno, text_size, size);
+
+	free(*write_buf);
+	*write_buf = buf;
+	*write_buf_size = buf_size;
+
+	return size;
+}
+
+static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
+			 struct metadata_area *mda);
+
+static int _mda_dev_in_vg(struct volume_group *vg, struct mda_context *mdac)
+{
+	struct pv_list *pvl;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (pvl->pv->dev == mdac->area.dev)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Find the full metadata a delta at rlocn was written against, or
+ * rlocn itself when it is full metadata.
+ */
+static int _read_delta_base(struct mda_context *mdac, int primary_mda,
+			    const struct raw_locn *rlocn, uint64_t mda_size,
+			    struct text_delta_base *base)
+{
+	struct text_delta_base locn = {
+		.offset = rlocn->offset,
+		.size = rlocn->size,
+		.checksum = rlocn->checksum,
+	};
+	struct dm_config_tree *cft;
+	int r;
+
+	if (!rlocn_is_delta(rlocn)) {
+		*base = locn;
+		return 1;
+	}
+
+	if (!(cft = text_delta_read(mdac->area.dev, MDA_CONTENT_REASON(primary_mda),
+				    mdac->area.start, mda_size, &locn)))
+		return_0;
+
+	r = (text_delta_get_base(cft, base) == 1);
+
+	config_destroy(cft);
+
+	return r;
+}
+
+/*
+ * Does the ring region starting at offset1 overlap the one at offset2?
+ * Offsets are relative to the start of the metadata area.
+ */
+static int _ring_regions_overlap(uint64_t mda_size,
+				 uint64_t offset1, uint64_t size1,
+				 uint64_t offset2, uint64_t size2)
+{
+	uint64_t ring = mda_size - MDA_HEADER_SIZE;
+
+	return (((offset2 + ring - offset1) % ring) < size1) ||
+		(((offset1 + ring - offset2) % ring) < size2);
+}
+
+/*
+ * Replace the exported text in write_buf with a delta against the last
+ * full metadata (see text_delta.c).  Returns the delta size, or 0 to
+ * write the full text.
+ */
+static size_t _delta_write_buf(struct format_instance *fid, struct volume_group *vg,
+			       size_t text_size, char **write_buf, uint32_t *write_buf_size)
+{
+	int delta_commits = find_config_tree_int(vg->cmd, metadata_delta_commits_CFG, NULL);
+	struct metadata_area *mda;
+	struct mda_context *mdac, *mdac_base = NULL;
+	struct mda_header *mdah;
+	struct raw_locn *rlocn, rlocn_old = { 0 };
+	struct text_delta_base base;
+	struct dm_config_tree *cft_base;
+	uint64_t mda_size = 0, ring, max_size, old_last, span;
+	uint32_t bad_fields = 0;
+	uint32_t buf_size;
+	char *buf;
+	size_t size;
+	int primary_mda = 0;
+
+	if (delta_commits <= 0)
+		return 0;
+
+	/*
+	 * Every mda written must hold the same committed metadata in the
+	 * same place, so that one delta and its base location suit them all.
+	 */
+	dm_list_iterate_items(mda, &fid->metadata_areas_in_use) {
+		if (mda->ops->vg_write != _vg_write_raw)
+			return 0;
+
+		mdac = (struct mda_context *) mda->metadata_locn;
+
+		if (!_mda_dev_in_vg(vg, mdac))
+			continue;
+
+		if (!(mdah = raw_read_mda_header(fid->fmt, &mdac->area, mda_is_primary(mda), 0, &bad_fields)))
+			return 0;
+
+		rlocn = &mdah->raw_locns[0];
+
+		if (rlocn_is_ignored(rlocn) || !rlocn->offset || !rlocn->size)
+			return 0;
+
+		if (!mdac_base) {
+			mdac_base = mdac;
+			rlocn_old = *rlocn;
+			mda_size = mdah->size;
+			primary_mda = mda_is_primary(mda);
+		} else if ((mdah->size != mda_size) ||
+			   (rlocn->offset != rlocn_old.offset) ||
+			   (rlocn->size != rlocn_old.size) ||
+			   (rlocn->checksum != rlocn_old.checksum)) {
+			log_debug_metadata("VG %s %u metadata areas differ, writing full metadata.",
+					   vg->name, vg->seqno);
+			return 0;
+		}
+	}
+
+	if (!mdac_base)
+		return 0;
+
+	if (!_read_delta_base(mdac_base, primary_mda, &rlocn_old, mda_size, &base))
+		return 0;
+
+	if (base.count >= (uint32_t) delta_commits) {
+		log_debug_metadata("VG %s %u writing full metadata after %u deltas.",
+				   vg->name, vg->seqno, base.count);
+		return 0;
+	}
+
+	if (!(cft_base = text_delta_read(mdac_base->area.dev, MDA_CONTENT_REASON(primary_mda),
+					 mdac_base->area.start, mda_size, &base)))
+		return 0;
+
+	base.count++;
+	size = text_delta_export(*write_buf, text_size, cft_base, &base, &buf, &buf_size);
+	config_destroy(cft_base);
+
+	if (!size)
+		return 0;
+
+	/*
+	 * The base stays part of the committed metadata until the next full
+	 * copy, so the text from the base through this delta, plus a copy of
+	 * the largest allowed metadata, must all fit in the circular buffer.
+	 */
+	ring = mda_size - MDA_HEADER_SIZE;
+	max_size = (ring / 2) - 512;
+	old_last = rlocn_old.offset + rlocn_old.size - 1;
+	span = ((old_last + ring - base.offset) % ring) + 1;
+
+	if (size * 2 > text_size) {
+		log_debug_metadata("VG %s %u delta metadata %zu bytes not worth writing for %zu bytes.",
+				   vg->name, vg->seqno, size, text_size);
+		free(buf);
+		return 0;
+	}
+
+	if (span + size + max_size + 3 * 512 > ring) {
+		log_debug_metadata("VG %s %u no room for delta metadata after base at %llu, writing full metadata.",
+				   vg->name, vg->seqno, (unsigned long long)base.offset);
+		free(buf);
+		return 0;
+	}
+
+	log_debug_metadata("VG %s %u metadata written as delta %u of %zu bytes for %zu bytes.",
+			   vg->name, vg->seqno, base.count, size, text_size);
+
+	free(*write_buf);
+	*write_buf = buf;
+	*write_buf_size = buf_size;
+
+	return size;
+}
+
 static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 			 struct metadata_area *mda)
 {
@@ -590,12 +880,14 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	uint64_t max_size;
 	uint64_t old_start = 0, old_last = 0, old_size = 0, old_wrap = 0;
 	uint64_t new_start = 0, new_last = 0, new_size = 0, new_wrap = 0;
+	uint64_t delta_size;
 	uint64_t write1_start = 0, write1_last = 0, write1_size = 0;
 	uint64_t write2_start = 0, write2_last = 0, write2_size = 0;
 	uint32_t write1_over = 0, write2_over = 0;
 	uint32_t write_buf_size;
 	uint32_t extra_size;
 	uint32_t bad_fields = 0;
+	struct text_delta_base delta_base;
 	char *write_buf = NULL;
 	const char *devname = dev_name(mdac->area.dev);
 	bool overlap;
@@ -648,21 +940,37 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	 * new_size) is zeroed.  More than new_size can be written from
 	 * write_buf to zero data on disk following the new text metadata,
 	 * up to the next 512 byte boundary.
+	 *
+	 * vg_write exports the text up front as the precommitted copy,
+	 * so it is only copied here rather than formatted again.
 	 */
 	if (fidtc->write_buf) {
 		write_buf = fidtc->write_buf;
 		write_buf_size = fidtc->write_buf_size;
 		new_size = fidtc->new_metadata_size;
 	} else {
-		if (!vg->write_count++)
-			(void) dm_snprintf(desc, sizeof(desc), "Write from %s.", vg->cmd->cmd_line);
-		else
-			(void) dm_snprintf(desc, sizeof(desc), "Write[%u] from %s.", vg->write_count, vg->cmd->cmd_line);
+		if (vg->write_text)
+			new_size = _copy_write_buf(vg->write_text, vg->write_text_size,
+						   &write_buf, &write_buf_size);
+		else {
+			if (!vg->write_count++)
+				(void) dm_snprintf(desc, sizeof(desc), "Write from %s.", vg->cmd->cmd_line);
+			else
+				(void) dm_snprintf(desc, sizeof(desc), "Write[%u] from %s.", vg->write_count, vg->cmd->cmd_line);
 
-		new_size = text_vg_export_raw(vg, desc, &write_buf, &write_buf_size);
+			new_size = text_vg_export_raw(vg, desc, &write_buf, &write_buf_size);
+		}
+		if (new_size && (delta_size = _delta_write_buf(fid, vg, new_size, &write_buf, &write_buf_size)))
+			new_size = delta_size;
+		else if (new_size && find_config_tree_bool(vg->cmd, metadata_compress_metadata_CFG, NULL))
+			new_size = _compress_write_buf(vg, new_size, &write_buf, &write_buf_size);
 		fidtc->write_buf = write_buf;
 		fidtc->write_buf_size = write_buf_size;
 		fidtc->new_metadata_size = new_size;
+		/* Same for every mda, a wrapped copy sums the same bytes */
+		if (new_size && write_buf)
+			fidtc->new_metadata_checksum = calc_crc(INITIAL_CRC, (uint8_t *)write_buf,
+								(uint32_t)new_size);
 	}
 
 	if (!new_size || !write_buf) {
@@ -670,6 +978,10 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		goto out;
 	}
 
+	if (!label_scan_reserve_bcache(new_size))
+		log_debug_metadata("VG %s metadata size %llu is larger than bcache can hold.",
+				   vg->name, (unsigned long long)new_size);
+
 	log_debug_metadata("VG %s seqno %u metadata write to %s mda_start %llu mda_size %llu mda_last %llu",
 			   vg->name, vg->seqno, devname,
 			   (unsigned long long)mda_start,
@@ -762,6 +1074,19 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	 */
 	new_start = _next_rlocn_offset(vg, rlocn_old, old_last, mdah, mda_start, MDA_ORIGINAL_ALIGNMENT);
 
+	/*
+	 * Rather than wrap around the end of the area, start over at the
+	 * beginning when the new copy fits there before the old one.
+	 * A contiguous copy is read and checksummed with a single read.
+	 */
+	if ((new_start + new_size > mdah->size) && rlocn_old && !old_wrap &&
+	    (MDA_HEADER_SIZE + new_size <= old_start)) {
+		log_debug_metadata("VG %s %u new metadata start moved from %llu to beginning %u to avoid wrapping",
+				   vg->name, vg->seqno,
+				   (unsigned long long)new_start, MDA_HEADER_SIZE);
+		new_start = MDA_HEADER_SIZE;
+	}
+
 	if (new_start + new_size > mdah->size) {
 		new_wrap = (new_start + new_size) - mdah->size;
 		new_last = new_wrap + MDA_HEADER_SIZE - 1;
@@ -772,6 +1097,9 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 				   (unsigned long long)new_size,
 				   (unsigned long long)(new_size - new_wrap),
 				   (unsigned long long)new_wrap);
+		/* Neither the rest of the area nor the space before the old copy fits */
+		log_verbose("VG %s metadata on %s wraps around the end of its %llu byte metadata area.",
+			    vg->name, devname, (unsigned long long)mdah->size);
 	} else {
 		new_wrap = 0;
 		new_last = new_start + new_size - 1;
@@ -784,6 +1112,8 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	rlocn_new = &mdac->rlocn;
 	rlocn_new->offset = new_start;
 	rlocn_new->size = new_size;
+	rlocn_set_compressed(rlocn_new, text_is_compressed(write_buf, new_size));
+	rlocn_set_delta(rlocn_new, text_is_delta(write_buf, new_size));
 
 	log_debug_metadata("VG %s %u metadata area location old start %llu last %llu size %llu wrap %llu",
 			   vg->name, vg->seqno,
@@ -857,6 +1187,27 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		goto out;
 	}
 
+	/*
+	 * When the committed metadata is a delta, its base is still needed
+	 * until the new metadata is committed.  The new copy (and the
+	 * zeroing to the next 512 byte boundary) must not overwrite it.
+	 */
+	if (rlocn_old && rlocn_is_delta(rlocn_old)) {
+		if (!_read_delta_base(mdac, mda_is_primary(mda), rlocn_old, mdah->size, &delta_base)) {
+			log_error("VG %s %u failed to find base of delta metadata on %s.",
+				  vg->name, vg->seqno, devname);
+			goto out;
+		}
+
+		if (_ring_regions_overlap(mdah->size, new_start, new_size + 512,
+					  delta_base.offset, delta_base.size)) {
+			log_error("VG %s %u metadata on %s (%llu bytes) would overwrite the base of the committed delta metadata.",
+				  vg->name, vg->seqno, devname,
+				  (unsigned long long)new_size);
+			goto out;
+		}
+	}
+
 	if (!new_wrap) {
 		write1_start = mda_start + new_start;
 		write1_size = new_size;
@@ -991,13 +1342,7 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 
 	dev_unset_last_byte(mdac->area.dev);
 
-	rlocn_new->checksum = calc_crc(INITIAL_CRC,
-				       (uint8_t *)write_buf,
-				       (uint32_t)(new_size - new_wrap));
-	if (new_wrap)
-		rlocn_new->checksum = calc_crc(rlocn_new->checksum,
-					(uint8_t *)write_buf + new_size - new_wrap,
-					(uint32_t)new_wrap);
+	rlocn_new->checksum = fidtc->new_metadata_checksum;
 
 	r = 1;
 
@@ -1108,6 +1453,7 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		rlocn_slot1->offset   = rlocn_new->offset;
 		rlocn_slot1->size     = rlocn_new->size;
 		rlocn_slot1->checksum = rlocn_new->checksum;
+		_rlocn_copy_encoding(rlocn_slot1, rlocn_new);
 	} else {
 		/*
 		 * vg_commit writes the new raw_locn into slot 0,
@@ -1116,6 +1462,7 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		rlocn_slot0->offset   = rlocn_new->offset;
 		rlocn_slot0->size     = rlocn_new->size;
 		rlocn_slot0->checksum = rlocn_new->checksum;
+		_rlocn_copy_encoding(rlocn_slot0, rlocn_new);
 
 		rlocn_slot1->offset   = 0;
 		rlocn_slot1->size     = 0;
@@ -1518,7 +1865,8 @@ int read_metadata_location_summary(const struct format_type *fmt,
 	struct raw_locn *rlocn;
 	uint32_t wrap = 0;
 	unsigned int len = 0;
-	char namebuf[NAME_LEN + 1] __attribute__((aligned(8)));
+	char namebuf[DELTA_TEXT_MAGIC_LEN + NAME_LEN + 1] __attribute__((aligned(8)));
+	char *name = namebuf;
 	uint64_t max_size;
 
 	if (!mdah) {
@@ -1549,26 +1897,35 @@ int read_metadata_location_summary(const struct format_type *fmt,
 
 	memset(namebuf, 0, sizeof(namebuf));
 
-	if (!dev_read_bytes(dev_area->dev, dev_area->start + rlocn->offset, NAME_LEN, namebuf))
+	if (!dev_read_bytes(dev_area->dev, dev_area->start + rlocn->offset,
+			    DELTA_TEXT_MAGIC_LEN + NAME_LEN, namebuf))
 		stack;
 
-	while (namebuf[len] && !isspace(namebuf[len]) && namebuf[len] != '{' &&
+	/* The VG name in compressed text is found when it is parsed. */
+	if (rlocn_is_compressed(rlocn) && text_is_compressed(namebuf, NAME_LEN))
+		goto skip_name;
+
+	if (rlocn_is_delta(rlocn) && text_is_delta(namebuf, NAME_LEN))
+		name += DELTA_TEXT_MAGIC_LEN;
+
+	while (name[len] && !isspace(name[len]) && name[len] != '{' &&
 	       len < (NAME_LEN - 1))
 		len++;
 
-	namebuf[len] = '\0';
+	name[len] = '\0';
 
 	/*
 	 * Check that the text metadata in the circular buffer begins with a
 	 * valid vg name.
 	 */
-	if (!validate_name(namebuf)) {
+	if (!validate_name(name)) {
 		log_warn("WARNING: Metadata location on %s at %llu begins with invalid VG name.",
 			  dev_name(dev_area->dev),
 			  (unsigned long long)(dev_area->start + rlocn->offset));
 		return 0;
 	}
 
+ skip_name:
 	/*
 	 * This function is used to read the vg summary during label scan.
 	 * Save the text start location and checksum during scan.  After the VG
@@ -1632,9 +1989,16 @@ int read_metadata_location_summary(const struct format_type *fmt,
 	/* Keep track of largest metadata size we find. */
 	lvmcache_save_metadata_size(rlocn->size);
 
-	lvmcache_lookup_mda(vgsummary);
-
-	if (!text_read_metadata_summary(fmt, dev_area->dev, MDA_CONTENT_REASON(primary_mda),
+	/*
+	 * The hints can say that this same metadata was read from this dev
+	 * when the hints were created, in which case the unchanged mda_header
+	 * is enough and the metadata only needs to be read from one PV.
+	 */
+	if (lvmcache_lookup_mda(vgsummary) && (mda->mda_num == 1) &&
+	    hint_matches_mda_summary(dev_area->dev, rlocn->offset, vgsummary))
+		log_debug_metadata("Skipped reading metadata summary on %s matching hint",
+				   dev_name(dev_area->dev));
+	else if (!text_read_metadata_summary(fmt, dev_area->dev, MDA_CONTENT_REASON(primary_mda),
 				(off_t) (dev_area->start + rlocn->offset),
 				(uint32_t) (rlocn->size - wrap),
 				(off_t) (dev_area->start + MDA_HEADER_SIZE),
@@ -2021,6 +2385,8 @@ static void _text_destroy(struct format_type *fmt)
 	if (fmt->private)
 		free(fmt->private);
 
+	text_parsed_metadata_destroy();
+
 	free(fmt);
 }
 
@@ -27,11 +27,13 @@
  * Archives a vg config.  'retain_days' is the minimum number of
  * days that an archive file must be held for.  'min_archives' is
  * the minimum number of archives required to be kept for each
- * volume group.
+ * volume group.  'compress' writes the archive compressed when
+ * that makes it smaller.
  */
 int archive_vg(struct volume_group *vg,
 	       const char *dir,
-	       const char *desc, uint32_t retain_days, uint32_t min_archive);
+	       const char *desc, uint32_t retain_days, uint32_t min_archive,
+	       int compress);
 
 /*
  * Displays a list of vg backups in a particular archive directory.
@@ -70,7 +70,12 @@ int print_segtype_lvflags(char *buffer, size_t size, uint64_t status);
 int read_segtype_lvflags(uint64_t *status, char *segtype_str);
 
 int text_vg_export_file(struct volume_group *vg, const char *desc, FILE *fp);
+int text_vg_export_file_from_buffer(struct cmd_context *cmd, const char *buf,
+				    const char *desc, FILE *fp);
 size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf, uint32_t *alloc_size);
+size_t text_vg_export_raw_from_buffer(struct cmd_context *cmd, const char *buf,
+				      const char *desc, char **out);
+void text_parsed_metadata_destroy(void);
 struct volume_group *text_read_metadata_file(struct format_instance *fid,
 					 const char *file,
 					 time_t *when, char **desc);
@@ -83,8 +88,28 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 				       off_t offset2, uint32_t size2,
 				       checksum_fn_t checksum_fn,
 				       uint32_t checksum,
+				       uint64_t area_start, uint64_t area_size,
 				       time_t *when, char **desc);
 
+struct text_delta_base {
+	uint64_t offset;	/* Relative to the start of the metadata area */
+	uint64_t size;
+	uint32_t checksum;
+	uint32_t count;		/* Number of deltas written against the base */
+};
+
+int text_delta_get_base(const struct dm_config_tree *cft, struct text_delta_base *base);
+size_t text_delta_export(const char *text, size_t text_size,
+			 const struct dm_config_tree *cft_base,
+			 const struct text_delta_base *base,
+			 char **buf, uint32_t *buf_size);
+int text_delta_merge(struct dm_config_tree *cft, const struct dm_config_tree *cft_base);
+struct dm_config_tree *text_delta_read(struct device *dev, dev_io_reason_t reason,
+				       uint64_t area_start, uint64_t area_size,
+				       const struct text_delta_base *base);
+int text_delta_resolve(struct dm_config_tree *cft, struct device *dev, dev_io_reason_t reason,
+		       uint64_t area_start, uint64_t area_size);
+
 int text_read_metadata_summary(const struct format_type *fmt,
 		       struct device *dev, dev_io_reason_t reason,
 		       off_t offset, uint32_t size,
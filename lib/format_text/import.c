@@ -17,6 +17,8 @@
 #include "lib/metadata/metadata.h"
 #include "lib/commands/toolcontext.h"
 #include "import-export.h"
+#include "libdaemon/client/config-util.h"
+#include "lib/lvmcached/lvmcached-client.h"
 
 /* FIXME Use tidier inclusion method */
 static struct text_vg_version_ops *(_text_vsn_list[2]);
@@ -33,6 +35,45 @@ static void _init_text_import(void)
 	_text_import_initialised = 1;
 }
 
+/*
+ * The scan checksums every metadata copy it reads, and vg_read reads
+ * the same copies again, often only to checksum them when they match
+ * the metadata already parsed from another device.  A copy verified
+ * once in the command is identified by its location, size and the
+ * checksum in its mda header, so when the header read again still
+ * describes it, the text is not read and checksummed a second time.
+ */
+static int _copy_verified(struct device *dev, off_t offset, uint32_t size, uint32_t checksum)
+{
+	unsigned i;
+
+	for (i = 0; i < DEV_MDA_COPIES; i++)
+		if (dev->mda_verified[i].size &&
+		    (dev->mda_verified[i].offset == (uint64_t) offset) &&
+		    (dev->mda_verified[i].size == size) &&
+		    (dev->mda_verified[i].checksum == checksum))
+			return 1;
+
+	return 0;
+}
+
+static void _set_copy_verified(struct device *dev, off_t offset, uint32_t size, uint32_t checksum)
+{
+	unsigned i, slot = DEV_MDA_COPIES - 1;
+
+	/* Replace the entry of the same copy, or take a free one. */
+	for (i = 0; i < DEV_MDA_COPIES; i++)
+		if (!dev->mda_verified[i].size ||
+		    (dev->mda_verified[i].offset == (uint64_t) offset)) {
+			slot = i;
+			break;
+		}
+
+	dev->mda_verified[slot].offset = (uint64_t) offset;
+	dev->mda_verified[slot].size = size;
+	dev->mda_verified[slot].checksum = checksum;
+}
+
 /*
  * Find out vgname on a given device.
  */
@@ -50,6 +91,12 @@ int text_read_metadata_summary(const struct format_type *fmt,
 
 	_init_text_import();
 
+	if (dev && checksum_fn && checksum_only &&
+	    _copy_verified(dev, offset, size + size2, vgsummary->mda_checksum)) {
+		log_debug_metadata("Skipped reading verified metadata summary on %s", dev_name(dev));
+		return 1;
+	}
+
 	if (!(cft = config_open(CONFIG_FILE_SPECIAL, NULL, 0)))
 		return_0;
 
@@ -66,6 +113,9 @@ int text_read_metadata_summary(const struct format_type *fmt,
 				 dev_name(dev), (unsigned long long)offset);
 			goto out;
 		}
+
+		if (checksum_fn)
+			_set_copy_verified(dev, offset, size + size2, vgsummary->mda_checksum);
 	} else {
 		if (!config_file_read(cft)) {
 			log_warn("WARNING: invalid metadata text from file.");
@@ -104,6 +154,92 @@ struct cached_vg_fmtdata {
         size_t cached_mda_size;
 };
 
+/*
+ * Parsed metadata kept across commands in a long-lived process
+ * (lvm shell, lvm2cmd library users).  An entry is found from the
+ * checksum and size in the mda header's rlocn, so a header read is
+ * enough to reuse the config tree without reading or parsing the
+ * metadata text again.  The struct volume_group itself still belongs
+ * to the command's fid, so it is imported again from the cached cft.
+ */
+#define PARSED_METADATA_CACHE_MAX 16
+
+struct parsed_metadata {
+	struct dm_list list;
+	uint32_t mda_checksum;
+	size_t mda_size;
+	struct id vgid;
+	uint32_t seqno;
+	struct dm_config_tree *cft;
+};
+
+static DM_LIST_INIT(_parsed_metadata);
+static unsigned _parsed_metadata_count = 0;
+
+static void _drop_parsed_metadata(struct parsed_metadata *pm)
+{
+	dm_list_del(&pm->list);
+	config_destroy(pm->cft);
+	free(pm);
+	_parsed_metadata_count--;
+}
+
+static struct parsed_metadata *_find_parsed_metadata(uint32_t checksum, size_t size)
+{
+	struct parsed_metadata *pm;
+
+	dm_list_iterate_items(pm, &_parsed_metadata)
+		if (pm->mda_checksum == checksum && pm->mda_size == size) {
+			/* Keep recently used entries at the head. */
+			dm_list_move(&_parsed_metadata, &pm->list);
+			return pm;
+		}
+
+	return NULL;
+}
+
+/*
+ * Takes ownership of cft on success.  Older entries for the same VG
+ * can never match a header again once the seqno has moved on.
+ */
+static int _save_parsed_metadata(struct dm_config_tree *cft, uint32_t checksum,
+				 size_t size, struct volume_group *vg)
+{
+	struct parsed_metadata *pm, *tmp;
+
+	dm_list_iterate_items_safe(pm, tmp, &_parsed_metadata)
+		if (id_equal(&pm->vgid, &vg->id) && pm->seqno != vg->seqno)
+			_drop_parsed_metadata(pm);
+
+	if (_parsed_metadata_count >= PARSED_METADATA_CACHE_MAX)
+		_drop_parsed_metadata(dm_list_item(dm_list_last(&_parsed_metadata),
+						   struct parsed_metadata));
+
+	if (!(pm = zalloc(sizeof(*pm))))
+		return 0;
+
+	pm->mda_checksum = checksum;
+	pm->mda_size = size;
+	pm->vgid = vg->id;
+	pm->seqno = vg->seqno;
+	pm->cft = cft;
+	dm_list_add_h(&_parsed_metadata, &pm->list);
+	_parsed_metadata_count++;
+
+	log_debug_metadata("Saved parsed metadata for VG %s seqno %u.",
+			   vg->name, vg->seqno);
+
+	return 1;
+}
+
+void text_parsed_metadata_destroy(void)
+{
+	struct parsed_metadata *pm, *tmp;
+
+	dm_list_iterate_items_safe(pm, tmp, &_parsed_metadata)
+		_drop_parsed_metadata(pm);
+}
+
 struct volume_group *text_read_metadata(struct format_instance *fid,
 				       const char *file,
 				       struct cached_vg_fmtdata **vg_fmtdata,
@@ -113,11 +249,15 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 				       off_t offset2, uint32_t size2,
 				       checksum_fn_t checksum_fn,
 				       uint32_t checksum,
+				       uint64_t area_start, uint64_t area_size,
 				       time_t *when, char **desc)
 {
 	struct volume_group *vg = NULL;
 	struct dm_config_tree *cft;
 	struct text_vg_version_ops **vsn;
+	struct parsed_metadata *pm = NULL;
+	char *cached_text;
+	int reuse_parsed = dev && checksum_fn && fid->fmt->cmd->reuse_parsed_metadata;
 	int skip_parse;
 
 	/*
@@ -140,16 +280,53 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 	*desc = NULL;
 	*when = 0;
 
-	if (!(cft = config_open(CONFIG_FILE_SPECIAL, file, 0)))
-		return_NULL;
-
 	/* Does the metadata match the already-cached VG? */
 	skip_parse = vg_fmtdata && 
 		     ((*vg_fmtdata)->cached_mda_checksum == checksum) &&
 		     ((*vg_fmtdata)->cached_mda_size == (size + size2));
 
+	/* Does the metadata match one parsed by an earlier command? */
+	if (reuse_parsed && (pm = _find_parsed_metadata(checksum, size + size2))) {
+		log_debug_metadata("Reusing parsed metadata for %s at %llu size %d (+%d)",
+				   dev_name(dev), (unsigned long long)offset,
+				   size, size2);
+		if (skip_parse) {
+			/* Nothing to read: the header matches the VG already imported. */
+			if (use_previous_vg)
+				*use_previous_vg = 1;
+			return NULL;
+		}
+		cft = pm->cft;
+		goto parse;
+	}
 
-	if (dev) {
+	/* The header matches the VG already imported and a copy verified. */
+	if (skip_parse && dev && checksum_fn &&
+	    _copy_verified(dev, offset, size + size2, checksum)) {
+		log_debug_metadata("Skipped reading verified metadata on %s", dev_name(dev));
+		if (use_previous_vg)
+			*use_previous_vg = 1;
+		return NULL;
+	}
+
+	if (!(cft = config_open(CONFIG_FILE_SPECIAL, file, 0)))
+		return_NULL;
+
+
+	if (dev && checksum_fn && !skip_parse &&
+	    (cached_text = lvmcached_metadata_get(checksum, size + size2))) {
+		/* lvmcached has the text the mda header describes */
+		log_debug_metadata("Using metadata from lvmcached for %s at %llu size %d (+%d)",
+				   dev_name(dev), (unsigned long long)offset,
+				   size, size2);
+
+		if (!config_read_buf(cft, cached_text, size + size2, 1)) {
+			log_error("Couldn't parse volume group metadata from lvmcached.");
+			free(cached_text);
+			goto out;
+		}
+		free(cached_text);
+	} else if (dev) {
 		log_debug_metadata("Reading metadata from %s at %llu size %d (+%d)",
 				   dev_name(dev), (unsigned long long)offset,
 				   size, size2);
@@ -161,6 +338,12 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 			log_error("Couldn't read volume group metadata from %s.", dev_name(dev));
 			goto out;
 		}
+
+		if (checksum_fn)
+			_set_copy_verified(dev, offset, size + size2, checksum);
+
+		if (checksum_fn && !skip_parse)
+			lvmcached_metadata_put(dev, offset, size, offset2, size2, checksum);
 	} else {
 		if (!config_file_read(cft)) {
 			log_error("Couldn't read volume group metadata from file.");
@@ -175,6 +358,11 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 		goto out;
 	}
 
+	/* Delta metadata is completed from its base before import. */
+	if (!text_delta_resolve(cft, dev, MDA_CONTENT_REASON(primary_mda), area_start, area_size))
+		goto_out;
+
+      parse:
 	/*
 	 * Find a set of version functions that can read this file
 	 */
@@ -197,8 +385,18 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 	if (use_previous_vg)
 		*use_previous_vg = 0;
 
+	if (vg && reuse_parsed && !pm &&
+	    _save_parsed_metadata(cft, checksum, size + size2, vg))
+		cft = NULL;
+
       out:
-	config_destroy(cft);
+	if (pm) {
+		/* A cached tree that no longer imports is not kept. */
+		if (!vg)
+			_drop_parsed_metadata(pm);
+	} else if (cft)
+		config_destroy(cft);
+
 	return vg;
 }
 
@@ -207,7 +405,7 @@ struct volume_group *text_read_metadata_file(struct format_instance *fid,
 					 time_t *when, char **desc)
 {
 	return text_read_metadata(fid, file, NULL, NULL, NULL, 0,
-				  (off_t)0, 0, (off_t)0, 0, NULL, 0,
+				  (off_t)0, 0, (off_t)0, 0, NULL, 0, 0, 0,
 				  when, desc);
 }
 
@@ -251,6 +449,25 @@ struct volume_group *import_vg_from_config_tree(struct cmd_context *cmd,
 	return _import_vg_from_config_tree(cmd, fid, cft);
 }
 
+struct volume_group *import_vg_from_buffer(struct cmd_context *cmd,
+					   struct format_instance *fid,
+					   const char *buf)
+{
+	struct dm_config_tree *cft;
+	struct volume_group *vg;
+
+	if (!(cft = config_tree_from_string_without_dup_node_check(buf))) {
+		log_error("Error parsing cached metadata.");
+		return NULL;
+	}
+
+	vg = _import_vg_from_config_tree(cmd, fid, cft);
+
+	dm_config_destroy(cft);
+
+	return vg;
+}
+
 struct volume_group *vg_from_config_tree(struct cmd_context *cmd, const struct dm_config_tree *cft)
 {
 	static struct text_vg_version_ops *ops;
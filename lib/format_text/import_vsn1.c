@@ -154,7 +154,8 @@ static int _read_flag_config(const struct dm_config_node *n, uint64_t *status, i
 	return 1;
 }
 
-static int _read_str_list(struct dm_pool *mem, struct dm_list *list, const struct dm_config_value *cv)
+/* Strings are interned per VG as the same tags tend to repeat on many objects */
+static int _read_str_list(struct volume_group *vg, struct dm_list *list, const struct dm_config_value *cv)
 {
 	if (cv->type == DM_CFG_EMPTY_ARRAY)
 		return 1;
@@ -165,7 +166,7 @@ static int _read_str_list(struct dm_pool *mem, struct dm_list *list, const struc
 			return 0;
 		}
 
-		if (!str_list_add(mem, list, dm_pool_strdup(mem, cv->v.str)))
+		if (!str_list_add(vg->vgmem, list, vg_intern_str(vg, cv->v.str)))
 			return_0;
 
 		cv = cv->next;
@@ -271,7 +272,7 @@ static int _read_pv(struct cmd_context *cmd,
 
 	/* Optional tags */
 	if (dm_config_get_list(pvn, "tags", &cv) &&
-	    !(_read_str_list(mem, &pv->tags, cv))) {
+	    !(_read_str_list(vg, &pv->tags, cv))) {
 		log_error("Couldn't read tags for physical volume %s in %s.",
 			  pv_dev_name(pv), vg->name);
 		return 0;
@@ -434,7 +435,7 @@ static int _read_segment(struct cmd_context *cmd,
 
 	/* Optional tags */
 	if (dm_config_get_list(sn_child, "tags", &cv) &&
-	    !(_read_str_list(mem, &seg->tags, cv))) {
+	    !(_read_str_list(lv->vg, &seg->tags, cv))) {
 		log_error("Couldn't read tags for a segment of %s/%s.",
 			  lv->vg->name, lv->name);
 		return 0;
@@ -706,7 +707,7 @@ static int _read_lvnames(struct cmd_context *cmd,
 
 	/* Optional tags */
 	if (dm_config_get_list(lvn, "tags", &cv) &&
-	    !(_read_str_list(mem, &lv->tags, cv))) {
+	    !(_read_str_list(vg, &lv->tags, cv))) {
 		log_error("Couldn't read tags for logical volume %s.",
 			  display_lvname(lv));
 		return 0;
@@ -1191,7 +1192,7 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 
 	/* Optional tags */
 	if (dm_config_get_list(vgn, "tags", &cv) &&
-	    !(_read_str_list(mem, &vg->tags, cv))) {
+	    !(_read_str_list(vg, &vg->tags, cv))) {
 		log_error("Couldn't read tags for volume group %s.", vg->name);
 		goto bad;
 	}
@@ -55,6 +55,9 @@ struct pv_header {
  * metadata across VGs with many PVs.
  */
 #define RAW_LOCN_IGNORED 0x00000001
+#define RAW_LOCN_COMPRESSED 0x00000002	/* Text is compressed, see lvm-compress.h */
+#define RAW_LOCN_DELTA 0x00000004	/* Text is a delta, see text_delta.c */
+#define RAW_LOCN_ENCODING (RAW_LOCN_COMPRESSED | RAW_LOCN_DELTA)
 
 /* On disk */
 struct raw_locn {
@@ -66,6 +69,10 @@ struct raw_locn {
 
 int rlocn_is_ignored(const struct raw_locn *rlocn);
 void rlocn_set_ignored(struct raw_locn *rlocn, unsigned mda_ignored);
+int rlocn_is_compressed(const struct raw_locn *rlocn);
+void rlocn_set_compressed(struct raw_locn *rlocn, unsigned compressed);
+int rlocn_is_delta(const struct raw_locn *rlocn);
+void rlocn_set_delta(struct raw_locn *rlocn, unsigned delta);
 
 /* On disk */
 /* Structure size limited to one sector */
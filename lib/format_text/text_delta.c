@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Delta encoding of VG metadata text.
+ *
+ * A delta is written in place of the full metadata text when only a few
+ * LVs differ from the last full copy (the base) that is still present in
+ * the circular buffer.  The delta is ordinary metadata text beginning
+ * with DELTA_TEXT_MAGIC: the VG section keeps every setting, PV and
+ * historical LV, but logical_volumes lists only the LVs that are new or
+ * changed since the base, and removed_logical_volumes names those that
+ * are gone.  A top level delta_base section records where the base is
+ * in the metadata area and its checksum.  Readers merge the base LVs
+ * back in before importing, so the result is equivalent to the full
+ * text.  Deltas are always taken against a full copy, never chained.
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/format_text/import-export.h"
+#include "lib/format_text/layout.h"
+#include "lib/misc/lvm-compress.h"
+#include "lib/misc/crc.h"
+
+#define DELTA_BASE_SECTION "delta_base"
+#define DELTA_LVS_SECTION "logical_volumes"
+#define DELTA_REMOVED_LVS "removed_logical_volumes"
+
+struct delta_output {
+	char *buf;
+	uint32_t size;
+	size_t used;
+};
+
+static struct dm_config_node *_vg_section(const struct dm_config_tree *cft)
+{
+	struct dm_config_node *cn;
+
+	/* The VG is the first section, as in import_vsn1. */
+	for (cn = cft->root; cn && cn->v; cn = cn->sib)
+		;
+
+	return cn;
+}
+
+static struct dm_config_node *_find_child(const struct dm_config_node *parent, const char *key)
+{
+	struct dm_config_node *cn;
+
+	for (cn = parent->child; cn; cn = cn->sib)
+		if (!strcmp(cn->key, key))
+			return cn;
+
+	return NULL;
+}
+
+static int _values_equal(const struct dm_config_value *a, const struct dm_config_value *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (a->type != b->type)
+			return 0;
+
+		switch (a->type) {
+		case DM_CFG_INT:
+			if (a->v.i != b->v.i)
+				return 0;
+			break;
+		case DM_CFG_FLOAT:
+			if (memcmp(&a->v.f, &b->v.f, sizeof(a->v.f)))
+				return 0;
+			break;
+		case DM_CFG_STRING:
+			if (strcmp(a->v.str, b->v.str))
+				return 0;
+			break;
+		case DM_CFG_EMPTY_ARRAY:
+			break;
+		}
+	}
+
+	return !a && !b;
+}
+
+static int _siblings_equal(const struct dm_config_node *a, const struct dm_config_node *b);
+
+static int _node_equal(const struct dm_config_node *a, const struct dm_config_node *b)
+{
+	return !strcmp(a->key, b->key) &&
+		_values_equal(a->v, b->v) &&
+		_siblings_equal(a->child, b->child);
+}
+
+static int _siblings_equal(const struct dm_config_node *a, const struct dm_config_node *b)
+{
+	for (; a && b; a = a->sib, b = b->sib)
+		if (!_node_equal(a, b))
+			return 0;
+
+	return !a && !b;
+}
+
+static int _delta_putline(const char *line, void *baton)
+{
+	struct delta_output *out = baton;
+	size_t len = strlen(line);
+	uint32_t new_size;
+	char *new_buf;
+
+	/* Keep the buffer a multiple of 64K, zeroed past the text, as export does. */
+	while (out->used + len + 2 > out->size) {
+		new_size = out->size ? out->size * 2 : 65536;
+		if (!(new_buf = realloc(out->buf, new_size)))
+			return_0;
+		memset(new_buf + out->size, 0, new_size - out->size);
+		out->buf = new_buf;
+		out->size = new_size;
+	}
+
+	memcpy(out->buf + out->used, line, len);
+	out->used += len;
+	out->buf[out->used++] = '\n';
+
+	return 1;
+}
+
+static struct dm_config_node *_add_int(struct dm_config_tree *cft, struct dm_config_node *parent,
+				       struct dm_config_node **last, const char *key, uint64_t i)
+{
+	struct dm_config_node *cn;
+
+	if (!(cn = dm_config_create_node(cft, key)) ||
+	    !(cn->v = dm_config_create_value(cft)))
+		return_NULL;
+
+	cn->v->type = DM_CFG_INT;
+	cn->v->v.i = (int64_t) i;
+	cn->parent = parent;
+
+	if (*last)
+		(*last)->sib = cn;
+	else
+		parent->child = cn;
+	*last = cn;
+
+	return cn;
+}
+
+int text_delta_get_base(const struct dm_config_tree *cft, struct text_delta_base *base)
+{
+	const struct dm_config_node *cn;
+	uint64_t checksum, count;
+
+	if (!(cn = dm_config_find_node(cft->root, DELTA_BASE_SECTION)))
+		return 0;
+
+	if (!cn->child ||
+	    !dm_config_get_uint64(cn->child, "offset", &base->offset) ||
+	    !dm_config_get_uint64(cn->child, "size", &base->size) ||
+	    !dm_config_get_uint64(cn->child, "checksum", &checksum) ||
+	    !dm_config_get_uint64(cn->child, "count", &count) ||
+	    (checksum > UINT32_MAX) || (count > UINT32_MAX)) {
+		log_error("Invalid " DELTA_BASE_SECTION " section in delta metadata.");
+		return -1;
+	}
+
+	base->checksum = (uint32_t) checksum;
+	base->count = (uint32_t) count;
+
+	return 1;
+}
+
+/*
+ * Build the delta of the full metadata text against cft_base, the tree
+ * of the full text described by base.  Returns the number of bytes used
+ * in *buf (which is zeroed after them and freed by the caller), or 0 if
+ * no delta can be made and the full text should be written.
+ */
+size_t text_delta_export(const char *text, size_t text_size,
+			 const struct dm_config_tree *cft_base,
+			 const struct text_delta_base *base,
+			 char **buf, uint32_t *buf_size)
+{
+	struct delta_output out = { 0 };
+	struct dm_config_tree *cft;
+	struct dm_config_node *vgn, *vgn_base, *lvs, *lvs_base, *cn, *base_lv, *last, *removed, *dbn;
+	struct dm_config_value *cv, *cv_last = NULL;
+	struct dm_hash_table *names = NULL;
+	struct dm_hash_node *hn;
+	size_t r = 0;
+
+	if (!(cft = config_open(CONFIG_FILE_SPECIAL, NULL, 0)))
+		return_0;
+
+	if (!dm_config_parse_without_dup_node_check(cft, text, text + text_size))
+		goto_out;
+
+	if (!(vgn = _vg_section(cft)) || !(vgn_base = _vg_section(cft_base)) ||
+	    strcmp(vgn->key, vgn_base->key))
+		goto out;
+
+	lvs = _find_child(vgn, DELTA_LVS_SECTION);
+	lvs_base = _find_child(vgn_base, DELTA_LVS_SECTION);
+
+	if (!(names = dm_hash_create(128)))
+		goto_out;
+
+	/* Drop the LVs that are unchanged since the base. */
+	if (lvs_base)
+		for (cn = lvs_base->child; cn; cn = cn->sib)
+			if (!dm_hash_insert(names, cn->key, cn))
+				goto_out;
+
+	if (lvs) {
+		for (last = NULL, cn = lvs->child; cn; cn = cn->sib) {
+			if ((base_lv = dm_hash_lookup(names, cn->key))) {
+				dm_hash_remove(names, cn->key);
+				if (_node_equal(cn, base_lv))
+					continue;
+			}
+			if (last)
+				last->sib = cn;
+			else
+				lvs->child = cn;
+			last = cn;
+		}
+		if (last)
+			last->sib = NULL;
+		else
+			lvs->child = NULL;
+	}
+
+	/* Base LVs left in the table no longer exist. */
+	if (dm_hash_get_num_entries(names)) {
+		if (!(removed = dm_config_create_node(cft, DELTA_REMOVED_LVS)))
+			goto_out;
+		dm_hash_iterate(hn, names) {
+			if (!(cv = dm_config_create_value(cft)) ||
+			    !(cv->v.str = dm_pool_strdup(cft->mem, dm_hash_get_key(names, hn))))
+				goto_out;
+			cv->type = DM_CFG_STRING;
+			if (cv_last)
+				cv_last->next = cv;
+			else
+				removed->v = cv;
+			cv_last = cv;
+		}
+		removed->parent = vgn;
+		removed->sib = vgn->child;
+		vgn->child = removed;
+	}
+
+	if (!(dbn = dm_config_create_node(cft, DELTA_BASE_SECTION)))
+		goto_out;
+
+	last = NULL;
+	if (!_add_int(cft, dbn, &last, "offset", base->offset) ||
+	    !_add_int(cft, dbn, &last, "size", base->size) ||
+	    !_add_int(cft, dbn, &last, "checksum", base->checksum) ||
+	    !_add_int(cft, dbn, &last, "count", base->count))
+		goto_out;
+
+	for (cn = cft->root; cn->sib; cn = cn->sib)
+		;
+	cn->sib = dbn;
+
+	if (!_delta_putline(DELTA_TEXT_MAGIC, &out) ||
+	    !dm_config_write_node(cft->root, _delta_putline, &out))
+		goto_out;
+
+	/* Metadata text on disk includes the terminating NUL, as export_raw does. */
+	out.buf[out.used++] = '\0';
+
+	*buf = out.buf;
+	*buf_size = out.size;
+	out.buf = NULL;
+	r = out.used;
+out:
+	free(out.buf);
+	if (names)
+		dm_hash_destroy(names);
+	config_destroy(cft);
+
+	return r;
+}
+
+/*
+ * Replace the LVs in the delta tree cft with the full set: the base LVs
+ * in their original order, each replaced by its delta version if there
+ * is one and dropped if removed, followed by the LVs new in the delta.
+ */
+int text_delta_merge(struct dm_config_tree *cft, const struct dm_config_tree *cft_base)
+{
+	struct dm_config_node *vgn, *vgn_base, *lvs, *lvs_base, *cn, *lvn, *last = NULL, *dbn;
+	struct dm_config_node **delta_lvs = NULL;
+	const struct dm_config_value *cv;
+	struct dm_hash_table *names = NULL, *removed = NULL;
+	unsigned i, count = 0;
+	int r = 0;
+
+	if (!(vgn = _vg_section(cft)) || !(vgn_base = _vg_section(cft_base)) ||
+	    strcmp(vgn->key, vgn_base->key)) {
+		log_error("Delta metadata does not match the VG of its base.");
+		return 0;
+	}
+
+	if (!(names = dm_hash_create(128)) ||
+	    !(removed = dm_hash_create(32)))
+		goto_out;
+
+	if (!(lvs = _find_child(vgn, DELTA_LVS_SECTION))) {
+		if (!(lvs = dm_config_create_node(cft, DELTA_LVS_SECTION)))
+			goto_out;
+		lvs->parent = vgn;
+		lvs->sib = vgn->child;
+		vgn->child = lvs;
+	}
+
+	for (cn = lvs->child; cn; cn = cn->sib)
+		count++;
+
+	if (count && !(delta_lvs = dm_pool_alloc(cft->mem, count * sizeof(*delta_lvs))))
+		goto_out;
+
+	for (i = 0, cn = lvs->child; cn; cn = cn->sib) {
+		delta_lvs[i++] = cn;
+		if (!dm_hash_insert(names, cn->key, cn))
+			goto_out;
+	}
+
+	if ((cn = _find_child(vgn, DELTA_REMOVED_LVS))) {
+		for (cv = cn->v; cv; cv = cv->next)
+			if ((cv->type == DM_CFG_STRING) &&
+			    !dm_hash_insert(removed, cv->v.str, cn))
+				goto_out;
+		dm_config_remove_node(vgn, cn);
+	}
+
+	lvs->child = NULL;
+
+	if ((lvs_base = _find_child(vgn_base, DELTA_LVS_SECTION)))
+		for (cn = lvs_base->child; cn; cn = cn->sib) {
+			if (dm_hash_lookup(removed, cn->key))
+				continue;
+
+			if ((lvn = dm_hash_lookup(names, cn->key)))
+				dm_hash_remove(names, cn->key);
+			else if (!(lvn = dm_config_clone_node_with_mem(cft->mem, cn, 0)))
+				goto_out;
+
+			lvn->parent = lvs;
+			lvn->sib = NULL;
+			if (last)
+				last->sib = lvn;
+			else
+				lvs->child = lvn;
+			last = lvn;
+		}
+
+	/* LVs created since the base, in the order written. */
+	for (i = 0; i < count; i++) {
+		if (dm_hash_lookup(names, delta_lvs[i]->key) != delta_lvs[i])
+			continue;
+		delta_lvs[i]->sib = NULL;
+		if (last)
+			last->sib = delta_lvs[i];
+		else
+			lvs->child = delta_lvs[i];
+		last = delta_lvs[i];
+	}
+
+	/* Leave no trace of the delta encoding for the importer. */
+	if ((dbn = dm_config_find_node(cft->root, DELTA_BASE_SECTION))) {
+		if (cft->root == dbn)
+			cft->root = dbn->sib;
+		else
+			for (cn = cft->root; cn; cn = cn->sib)
+				if (cn->sib == dbn) {
+					cn->sib = dbn->sib;
+					break;
+				}
+	}
+
+	r = 1;
+out:
+	if (names)
+		dm_hash_destroy(names);
+	if (removed)
+		dm_hash_destroy(removed);
+
+	return r;
+}
+
+/*
+ * Read and parse the text at offset/size (relative to area_start) in a
+ * metadata area of area_size bytes, following the wrap at the end of
+ * the circular buffer.
+ */
+struct dm_config_tree *text_delta_read(struct device *dev, dev_io_reason_t reason,
+				       uint64_t area_start, uint64_t area_size,
+				       const struct text_delta_base *base)
+{
+	struct dm_config_tree *cft;
+	uint64_t wrap = 0;
+
+	if ((base->offset < MDA_HEADER_SIZE) || (base->offset >= area_size) ||
+	    !base->size || (base->size > area_size - MDA_HEADER_SIZE)) {
+		log_error("Invalid metadata location %llu size %llu on %s.",
+			  (unsigned long long)base->offset,
+			  (unsigned long long)base->size, dev_name(dev));
+		return NULL;
+	}
+
+	if (base->offset + base->size > area_size)
+		wrap = base->offset + base->size - area_size;
+
+	if (!(cft = config_open(CONFIG_FILE_SPECIAL, NULL, 0)))
+		return_NULL;
+
+	if (!config_file_read_fd(cft, dev, reason,
+				 (off_t) (area_start + base->offset),
+				 (size_t) (base->size - wrap),
+				 (off_t) (area_start + MDA_HEADER_SIZE),
+				 (size_t) wrap, calc_crc, base->checksum, 0, 1)) {
+		config_destroy(cft);
+		return_NULL;
+	}
+
+	return cft;
+}
+
+/*
+ * If cft was read from delta text, read its base from the same metadata
+ * area and merge the two so cft holds the complete VG.
+ */
+int text_delta_resolve(struct dm_config_tree *cft, struct device *dev, dev_io_reason_t reason,
+		       uint64_t area_start, uint64_t area_size)
+{
+	struct dm_config_tree *cft_base;
+	struct text_delta_base base, base2;
+	int r;
+
+	if (!(r = text_delta_get_base(cft, &base)))
+		return 1;
+
+	if (r < 0)
+		return_0;
+
+	if (!dev || !area_size) {
+		log_error("Delta metadata can only be read from a metadata area.");
+		return 0;
+	}
+
+	log_debug_metadata("Reading delta metadata base from %s at %llu size %llu",
+			   dev_name(dev), (unsigned long long)(area_start + base.offset),
+			   (unsigned long long)base.size);
+
+	if (!(cft_base = text_delta_read(dev, reason, area_start, area_size, &base))) {
+		log_error("Failed to read base of delta metadata on %s.", dev_name(dev));
+		return 0;
+	}
+
+	if (text_delta_get_base(cft_base, &base2)) {
+		log_error("Base of delta metadata on %s is itself a delta.", dev_name(dev));
+		r = 0;
+	} else
+		r = text_delta_merge(cft, cft_base);
+
+	config_destroy(cft_base);
+
+	return r;
+}
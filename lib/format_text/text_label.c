@@ -619,10 +619,80 @@ static void _fmt_text_destroy(struct labeller *l)
 	free(l);
 }
 
+/*
+ * The label scan calls this with the first block of every PV it read,
+ * before processing any of them, so the reads of the metadata text by
+ * _text_read() find it in bcache instead of waiting for it one PV at a
+ * time.  The headers are not verified yet, only kept within the mda.
+ */
+static void _text_prefetch(struct labeller *l __attribute__((unused)),
+			   struct device *dev, const char *block, size_t block_size,
+			   void *label_buf)
+{
+	struct label_header *lh = (struct label_header *) label_buf;
+	const char *label_end = (const char *) label_buf + LABEL_SIZE;
+	const struct mda_header *mdah;
+	const struct raw_locn *rlocn;
+	struct pv_header *pvhdr;
+	struct disk_locn *dlocn_xl;
+	uint64_t offset, size, text_offset, text_size, wrap;
+	int mdas = 0;
+
+	if (xlate32(lh->offset_xl) >= LABEL_SIZE)
+		return;
+
+	pvhdr = (struct pv_header *) ((char *) label_buf + xlate32(lh->offset_xl));
+	dlocn_xl = pvhdr->disk_areas_xl;
+
+	/* Data areas, then metadata areas, each list ends with a zero offset */
+	for (; (const char *) (dlocn_xl + 1) <= label_end; dlocn_xl++) {
+		if (!(offset = xlate64(dlocn_xl->offset))) {
+			if (mdas++)
+				break;
+			continue;
+		}
+
+		if (!mdas)
+			continue;
+
+		size = xlate64(dlocn_xl->size);
+
+		/* e.g. the second mda at the end of the device */
+		if (offset + MDA_HEADER_SIZE > block_size) {
+			dev_prefetch_bytes(dev, offset, MDA_HEADER_SIZE);
+			continue;
+		}
+
+		mdah = (const struct mda_header *) (block + offset);
+		rlocn = mdah->raw_locns;
+
+		if (memcmp(mdah->magic, FMTT_MAGIC, sizeof(mdah->magic)) ||
+		    (xlate32(rlocn->flags) & RAW_LOCN_IGNORED))
+			continue;
+
+		text_offset = xlate64(rlocn->offset);
+		text_size = xlate64(rlocn->size);
+
+		if (!text_size || (size <= MDA_HEADER_SIZE) ||
+		    (text_offset < MDA_HEADER_SIZE) || (text_offset >= size) ||
+		    (text_size > size - MDA_HEADER_SIZE))
+			continue;
+
+		wrap = 0;
+		if (text_offset + text_size > size)
+			wrap = text_offset + text_size - size;
+
+		dev_prefetch_bytes(dev, offset + text_offset, text_size - wrap);
+		if (wrap)
+			dev_prefetch_bytes(dev, offset + MDA_HEADER_SIZE, wrap);
+	}
+}
+
 struct label_ops _text_ops = {
 	.can_handle = _text_can_handle,
 	.write = _text_write,
 	.read = _text_read,
+	.prefetch = _text_prefetch,
 	.initialise_label = _text_initialise_label,
 	.destroy_label = _text_destroy_label,
 	.destroy = _fmt_text_destroy,
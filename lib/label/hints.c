@@ -145,6 +145,7 @@
 #include "lib/activate/activate.h"
 #include "lib/label/hints.h"
 #include "lib/device/dev-type.h"
+#include "lib/filters/filter.h"
 
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -152,11 +153,15 @@
 #include <time.h>
 #include <sys/types.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/sysmacros.h>
+#include <stdarg.h>
 
 static const char *_hints_file = DEFAULT_RUN_DIR "/hints";
 static const char *_nohints_file = DEFAULT_RUN_DIR "/nohints";
 static const char *_newhints_file = DEFAULT_RUN_DIR "/newhints";
+static const char *_journal_file = DEFAULT_RUN_DIR "/hints.journal";
+static const char *_filter_cache_file = DEFAULT_RUN_DIR "/hints.filter";
 
 /*
  * Format of hints file.  Increase the major number when
@@ -168,14 +173,70 @@ static const char *_newhints_file = DEFAULT_RUN_DIR "/newhints";
  * ignore while continuing to use the other content.
  */
 #define HINTS_VERSION_MAJOR 1
-#define HINTS_VERSION_MINOR 1
+#define HINTS_VERSION_MINOR 2
 
 #define HINT_LINE_LEN (PATH_MAX + NAME_LEN + ID_LEN + 64)
 #define HINT_LINE_WORDS 4
 static char _hint_line[HINT_LINE_LEN];
 
+/*
+ * Binary format of hints file (devices/hints_binary), in host byte order
+ * since the file is local to the host.  A header is followed by one fixed
+ * size record per PV, sorted by major:minor.  The file is mapped and
+ * checked against the header, without parsing, and devices are looked up
+ * in the records by binary search.
+ *
+ * A device with a name that doesn't fit in a record causes an empty file
+ * to be written, so that hints are not used.
+ */
+#define HINTS_BINARY_MAGIC "LVMHINTS"
+#define HINTS_BINARY_VERSION_MAJOR 1
+#define HINTS_BINARY_VERSION_MINOR 1
+
+#define HINTS_BINARY_DUPLICATE_PVS	0x00000001
+#define HINTS_BINARY_DUPLICATE_VGNAMES	0x00000002
+#define HINTS_BINARY_NAME_TOO_LONG	0x00000004
+
+#define HINT_RECORD_NAME_LEN 256
+
+struct hints_binary_header {
+	char magic[8];
+	uint32_t version_major;
+	uint32_t version_minor;
+	uint32_t filter_hash;	/* global_filter, filter and scan_lvs */
+	uint32_t devs_hash;	/* see write_hint_file */
+	uint32_t devs_count;
+	uint32_t record_size;
+	uint32_t nr_records;
+	uint32_t flags;		/* why the file is empty */
+};
+
+struct hint_record {
+	uint32_t major;
+	uint32_t minor;
+	char pvid[ID_LEN + 8];
+	char vgname[NAME_LEN];
+	char name[HINT_RECORD_NAME_LEN];
+	char vgid[ID_LEN + 8];	/* the rest is the mda1 summary, if mda_size */
+	uint32_t seqno;
+	uint32_t mda_checksum;
+	uint64_t mda_offset;
+	uint64_t mda_size;
+};
+
+/*
+ * Hints returned by get_hints are indexed by devno and by name,
+ * until they are freed.
+ */
+static struct hint **_hints_by_devt;
+static struct hint **_hints_by_name;
+static uint32_t _hints_indexed;
+
 static int _hints_fd = -1;
 
+/* Open while a command journals its changes, see journal_hint_file_begin. */
+static FILE *_journal_fp;
+
 #define NONBLOCK 1
 
 #define NEWHINTS_NONE     0
@@ -278,11 +339,20 @@ static void _unlink_newhints(void)
 		log_debug("unlink_newhints errno %d %s", errno, _newhints_file);
 }
 
+static void _unlink_journal(void)
+{
+	if (unlink(_journal_file) && (errno != ENOENT))
+		log_debug("unlink_journal errno %d %s", errno, _journal_file);
+}
+
 static int _clear_hints(struct cmd_context *cmd)
 {
 	FILE *fp;
 	time_t t;
 
+	/* The journal only applies to the hints being cleared. */
+	_unlink_journal();
+
 	if (!(fp = fopen(_hints_file, "w"))) {
 		log_debug("clear_hints open errno %d", errno);
 		/* shouldn't happen, but try to unlink in case */
@@ -362,16 +432,30 @@ static void _unlock_hints(struct cmd_context *cmd)
 
 void hints_exit(struct cmd_context *cmd)
 {
+	/* A command that journals its changes exited before finishing them. */
+	journal_hint_file_end(cmd, 0);
+
 	free_hints(&cmd->hints);
 	if (_hints_fd == -1)
 		return;
 	_unlock_hints(cmd);
 }
 
+static void _free_hint_index(void)
+{
+	free(_hints_by_devt);
+	free(_hints_by_name);
+	_hints_by_devt = NULL;
+	_hints_by_name = NULL;
+	_hints_indexed = 0;
+}
+
 void free_hints(struct dm_list *hints)
 {
 	struct hint *hint, *hint2;
 
+	_free_hint_index();
+
 	dm_list_iterate_items_safe(hint, hint2, hints) {
 		dm_list_del(&hint->list);
 		free(hint);
@@ -389,6 +473,81 @@ static struct hint *_find_hint_name(struct dm_list *hints, const char *name)
 	return NULL;
 }
 
+static int _cmp_hint_devt(const void *key, const void *elem)
+{
+	dev_t devt = *(const dev_t *) key;
+	const struct hint *hint = *(struct hint * const *) elem;
+
+	if (major(devt) != major(hint->devt))
+		return (major(devt) < major(hint->devt)) ? -1 : 1;
+	if (minor(devt) != minor(hint->devt))
+		return (minor(devt) < minor(hint->devt)) ? -1 : 1;
+	return 0;
+}
+
+static int _cmp_hint_name_key(const void *key, const void *elem)
+{
+	return strcmp((const char *) key, (*(struct hint * const *) elem)->name);
+}
+
+static int _cmp_hint_name(const void *a, const void *b)
+{
+	return strcmp((*(struct hint * const *) a)->name, (*(struct hint * const *) b)->name);
+}
+
+static int _cmp_hint_devt_elem(const void *a, const void *b)
+{
+	return _cmp_hint_devt(&(*(struct hint * const *) a)->devt, b);
+}
+
+/*
+ * Like _find_hint_name, but uses the index of binary hints.  The devno
+ * normally finds the hint, but the name is what identifies it, as for
+ * text hints, so the dev may have a different devno from the hint.
+ */
+static struct hint *_find_hint_dev(struct dm_list *hints, struct device *dev, const char *name)
+{
+	struct hint **found;
+
+	if (!_hints_indexed)
+		return _find_hint_name(hints, name);
+
+	if ((found = bsearch(&dev->dev, _hints_by_devt, _hints_indexed,
+			     sizeof(*found), _cmp_hint_devt)) &&
+	    !strcmp((*found)->name, name))
+		return *found;
+
+	if ((found = bsearch(name, _hints_by_name, _hints_indexed,
+			     sizeof(*found), _cmp_hint_name_key)))
+		return *found;
+
+	return NULL;
+}
+
+/*
+ * label_scan found the metadata in mda1 of dev at text_offset with the
+ * checksum and size in vgsummary, and the same metadata has already been
+ * read from another PV (lvmcache_lookup_mda filled in the rest of vgsummary.)
+ * If the full scan that created the hints read the same metadata from this
+ * dev, it doesn't need to be read from this dev again: a matching mda_header
+ * verifies it's unchanged.
+ */
+int hint_matches_mda_summary(struct device *dev, uint64_t text_offset,
+			     const struct lvmcache_vgsummary *vgsummary)
+{
+	struct hint *hint;
+
+	if (!_hints_indexed || !(hint = _find_hint_dev(NULL, dev, dev_name(dev))))
+		return 0;
+
+	return hint->mda_size &&
+	       (hint->mda_offset == text_offset) &&
+	       (hint->mda_size == vgsummary->mda_size) &&
+	       (hint->mda_checksum == vgsummary->mda_checksum) &&
+	       (hint->seqno == vgsummary->seqno) &&
+	       !strncmp(hint->vgid, (const char *) &vgsummary->vgid, ID_LEN);
+}
+
 /*
  * Decide if a given device name should be included in the hint hash.
  * If it is, then the hash changes if the device is added or removed
@@ -495,7 +654,7 @@ int validate_hints(struct cmd_context *cmd, struct dm_list *hints)
 	if (!(iter = dev_iter_create(NULL, 0)))
 		return 0;
 	while ((dev = dev_iter_get(cmd, iter))) {
-		if (!(hint = _find_hint_name(hints, dev_name(dev))))
+		if (!(hint = _find_hint_dev(hints, dev, dev_name(dev))))
 			continue;
 
 		/* The cmd hasn't needed this hint's dev so it's not been scanned. */
@@ -580,15 +739,12 @@ static void _apply_hints(struct cmd_context *cmd, struct dm_list *hints,
 {
 	struct hint *hint;
 	struct device_list *devl, *devl2;
-	struct dm_list *name_list;
-	struct dm_str_list *name_sl;
 
 	dm_list_iterate_items_safe(devl, devl2, devs_in) {
-		if (!(name_list = dm_list_first(&devl->dev->aliases)))
+		if (dm_list_empty(&devl->dev->aliases))
 			continue;
-		name_sl = dm_list_item(name_list, struct dm_str_list);
 
-		if (!(hint = _find_hint_name(hints, name_sl->str)))
+		if (!(hint = _find_hint_dev(hints, devl->dev, dev_name(devl->dev))))
 			continue;
 
 		/* if vgname is set, pick hints with matching vgname */
@@ -650,6 +806,239 @@ static void _filter_to_str(struct cmd_context *cmd, int filter_cfg, char **strp)
 	*strp = str;
 }
 
+/*
+ * The settings that the text hints file keeps as strings, hashed for the
+ * binary format.
+ */
+static uint32_t _filter_hash(struct cmd_context *cmd)
+{
+	char *filter_str = NULL;
+	uint32_t hash = INITIAL_CRC;
+	uint32_t scan_lvs = cmd->scan_lvs;
+	const char *str;
+
+	_filter_to_str(cmd, devices_global_filter_CFG, &filter_str);
+	str = filter_str ?: "-";
+	hash = calc_crc(hash, (const uint8_t *)str, strlen(str) + 1);
+	free(filter_str);
+
+	_filter_to_str(cmd, devices_filter_CFG, &filter_str);
+	str = filter_str ?: "-";
+	hash = calc_crc(hash, (const uint8_t *)str, strlen(str) + 1);
+	free(filter_str);
+
+	return calc_crc(hash, (const uint8_t *)&scan_lvs, sizeof(scan_lvs));
+}
+
+/*
+ * Besides the filter lists, the component detection settings decide
+ * which filters exclude a device.
+ */
+static uint32_t _filter_cache_hash(struct cmd_context *cmd)
+{
+	uint32_t settings[] = {
+		find_config_tree_bool(cmd, devices_sysfs_scan_CFG, NULL),
+		find_config_tree_bool(cmd, devices_multipath_component_detection_CFG, NULL),
+		find_config_tree_bool(cmd, devices_md_component_detection_CFG, NULL),
+		find_config_tree_bool(cmd, devices_fw_raid_component_detection_CFG, NULL),
+		cmd->use_full_md_check,
+	};
+
+	return calc_crc(_filter_hash(cmd), (const uint8_t *)settings, sizeof(settings));
+}
+
+/*
+ * Calculate hash of devices that may be scanned.
+ */
+static int _calc_devs_hash(struct cmd_context *cmd, uint32_t *hash, uint32_t *count)
+{
+	char devpath[PATH_MAX];
+	struct dev_iter *iter;
+	struct device *dev;
+
+	*hash = INITIAL_CRC;
+	*count = 0;
+
+	if (!(iter = dev_iter_create(NULL, 0)))
+		return 0;
+	while ((dev = dev_iter_get(cmd, iter))) {
+		if (!_dev_in_hint_hash(cmd, dev))
+			continue;
+		(void) dm_strncpy(devpath, dev_name(dev), sizeof(devpath));
+		*hash = calc_crc(*hash, (const uint8_t *)devpath, strlen(devpath));
+		(*count)++;
+	}
+	dev_iter_destroy(iter);
+
+	return 1;
+}
+
+static int _build_hint_index(struct dm_list *hints)
+{
+	struct hint *hint;
+	uint32_t nr = dm_list_size(hints);
+	uint32_t i = 0;
+
+	if (!(_hints_by_devt = malloc(nr * sizeof(*_hints_by_devt))) ||
+	    !(_hints_by_name = malloc(nr * sizeof(*_hints_by_name)))) {
+		_free_hint_index();
+		return 0;
+	}
+
+	dm_list_iterate_items(hint, hints) {
+		_hints_by_devt[i] = hint;
+		_hints_by_name[i] = hint;
+		i++;
+	}
+
+	/* Binary records are already sorted, journal entries may not be. */
+	qsort(_hints_by_devt, nr, sizeof(*_hints_by_devt), _cmp_hint_devt_elem);
+	qsort(_hints_by_name, nr, sizeof(*_hints_by_name), _cmp_hint_name);
+	_hints_indexed = nr;
+
+	return 1;
+}
+
+/*
+ * Return values are the same as _read_hint_file.
+ */
+static int _read_hint_file_binary(struct cmd_context *cmd, int fd, struct dm_list *hints,
+				  int *needs_refresh)
+{
+	const struct hints_binary_header *hdr;
+	const struct hint_record *rec;
+	struct hint *hint;
+	struct stat buf;
+	void *map;
+	uint32_t calc_hash, calc_count;
+	uint32_t i;
+	int ret = 1;
+
+	if (fstat(fd, &buf) || (buf.st_size < (off_t) sizeof(*hdr)))
+		return 0;
+
+	if ((map = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		log_debug("read_hint_file mmap errno %d", errno);
+		return 0;
+	}
+
+	hdr = map;
+	rec = (const struct hint_record *)(hdr + 1);
+
+	log_debug("Reading binary hint file with %u records", hdr->nr_records);
+
+	if (hdr->version_major > HINTS_BINARY_VERSION_MAJOR) {
+		log_debug("ignore hints with newer major version %u.%u",
+			  hdr->version_major, hdr->version_minor);
+		*needs_refresh = 1;
+		goto out;
+	}
+
+	if ((hdr->record_size != sizeof(*rec)) ||
+	    ((uint64_t) buf.st_size < sizeof(*hdr) + (uint64_t) hdr->nr_records * sizeof(*rec))) {
+		log_debug("ignore hints with invalid size");
+		*needs_refresh = 1;
+		goto out;
+	}
+
+	if (hdr->flags)
+		log_debug("binary hints empty flags 0x%x", hdr->flags);
+
+	if (hdr->filter_hash != _filter_hash(cmd)) {
+		log_debug("ignore hints with different filter or scan_lvs");
+		*needs_refresh = 1;
+		goto out;
+	}
+
+	if (!hdr->nr_records)
+		goto out;
+
+	if (!_calc_devs_hash(cmd, &calc_hash, &calc_count)) {
+		ret = 0;
+		goto out;
+	}
+
+	if (hdr->devs_hash != calc_hash) {
+		/* The count is just informational. */
+		log_debug("ignore hints with read_hash %u count %u calc_hash %u count %u",
+			  hdr->devs_hash, hdr->devs_count, calc_hash, calc_count);
+		*needs_refresh = 1;
+		goto out;
+	}
+
+	for (i = 0; i < hdr->nr_records; i++, rec++) {
+		if (!(hint = zalloc(sizeof(*hint)))) {
+			ret = 0;
+			goto out;
+		}
+
+		if (!dm_strncpy(hint->name, rec->name, sizeof(rec->name)) ||
+		    !dm_strncpy(hint->pvid, rec->pvid, sizeof(hint->pvid)) ||
+		    !dm_strncpy(hint->vgname, rec->vgname, sizeof(hint->vgname))) {
+			log_debug("ignore hints with invalid record %u", i);
+			free(hint);
+			*needs_refresh = 1;
+			goto out;
+		}
+		hint->devt = makedev(rec->major, rec->minor);
+
+		if (rec->mda_size && dm_strncpy(hint->vgid, rec->vgid, sizeof(hint->vgid))) {
+			hint->seqno = rec->seqno;
+			hint->mda_checksum = rec->mda_checksum;
+			hint->mda_offset = rec->mda_offset;
+			hint->mda_size = rec->mda_size;
+		}
+
+		dm_list_add(hints, &hint->list);
+	}
+
+	log_debug("accept hints found %d", dm_list_size(hints));
+out:
+	if (munmap(map, buf.st_size))
+		log_debug("read_hint_file munmap errno %d", errno);
+
+	return ret;
+}
+
+/*
+ * "mda:<name> vgid:<vgid> seqno:<seqno> locn:<offset>:<size>:<checksum>"
+ * is the summary of the metadata that the full scan found in mda1 of the dev.
+ */
+static void _parse_hint_mda(char *line, struct hint *hint)
+{
+	char *split[HINT_LINE_WORDS] = { NULL };
+	uint64_t offset, size;
+	uint32_t seqno, checksum;
+
+	if ((dm_split_words(line, HINT_LINE_WORDS, 0, split) != HINT_LINE_WORDS) ||
+	    strcmp(split[0] + 4, hint->name) ||
+	    strncmp(split[1], "vgid:", 5) ||
+	    (sscanf(split[2], "seqno:%u", &seqno) != 1) ||
+	    (sscanf(split[3], "locn:%" SCNu64 ":%" SCNu64 ":%u", &offset, &size, &checksum) != 3) ||
+	    !dm_strncpy(hint->vgid, split[1] + 5, sizeof(hint->vgid))) {
+		log_debug("ignore hint mda summary for %s", hint->name);
+		return;
+	}
+
+	hint->seqno = seqno;
+	hint->mda_checksum = checksum;
+	hint->mda_offset = offset;
+	hint->mda_size = size;
+}
+
+static int _hint_file_is_binary(FILE *fp)
+{
+	char magic[sizeof(((struct hints_binary_header *)0)->magic)];
+	int binary;
+
+	binary = (fread(magic, sizeof(magic), 1, fp) == 1) &&
+		 !memcmp(magic, HINTS_BINARY_MAGIC, sizeof(magic));
+
+	rewind(fp);
+
+	return binary;
+}
+
 /*
  * Return 1 and needs_refresh 0: the hints can be used
  * Return 1 and needs_refresh 1: the hints can't be used and should be updated
@@ -659,18 +1048,15 @@ static void _filter_to_str(struct cmd_context *cmd, int filter_cfg, char **strp)
  */
 static int _read_hint_file(struct cmd_context *cmd, struct dm_list *hints, int *needs_refresh)
 {
-	char devpath[PATH_MAX];
 	FILE *fp;
-	struct dev_iter *iter;
 	struct hint hint;
-	struct hint *alloc_hint;
-	struct device *dev;
+	struct hint *alloc_hint = NULL;
 	char *split[HINT_LINE_WORDS];
 	char *name, *pvid, *devn, *vgname, *p, *filter_str = NULL;
 	uint32_t read_hash = 0;
-	uint32_t calc_hash = INITIAL_CRC;
+	uint32_t calc_hash;
 	uint32_t read_count = 0;
-	uint32_t calc_count = 0;
+	uint32_t calc_count;
 	int found = 0;
 	int keylen;
 	int hv_major, hv_minor;
@@ -681,6 +1067,13 @@ static int _read_hint_file(struct cmd_context *cmd, struct dm_list *hints, int *
 	if (!(fp = fopen(_hints_file, "r")))
 		return 0;
 
+	if (_hint_file_is_binary(fp)) {
+		ret = _read_hint_file_binary(cmd, fileno(fp), hints, needs_refresh);
+		if (fclose(fp))
+			log_debug("read_hint_file close errno %d", errno);
+		return ret;
+	}
+
 	log_debug("Reading hint file");
 
 	for (i = 0; i < HINT_LINE_WORDS; i++)
@@ -768,6 +1161,14 @@ static int _read_hint_file(struct cmd_context *cmd, struct dm_list *hints, int *
 			continue;
 		}
 
+		/* The mda summary follows the scan line of the same dev. */
+		keylen = strlen("mda:");
+		if (!strncmp(_hint_line, "mda:", keylen)) {
+			if (alloc_hint)
+				_parse_hint_mda(_hint_line, alloc_hint);
+			continue;
+		}
+
 		/*
 		 * Ignore any other line prefixes that we don't recognize.
 		 */
@@ -824,16 +1225,8 @@ static int _read_hint_file(struct cmd_context *cmd, struct dm_list *hints, int *
 	/*
 	 * Calculate and compare hash of devices that may be scanned.
 	 */
-	if (!(iter = dev_iter_create(NULL, 0)))
+	if (!_calc_devs_hash(cmd, &calc_hash, &calc_count))
 		return 0;
-	while ((dev = dev_iter_get(cmd, iter))) {
-		if (!_dev_in_hint_hash(cmd, dev))
-			continue;
-		(void) dm_strncpy(devpath, dev_name(dev), sizeof(devpath));
-		calc_hash = calc_crc(calc_hash, (const uint8_t *)devpath, strlen(devpath));
-		calc_count++;
-	}
-	dev_iter_destroy(iter);
 
 	if (read_hash && (read_hash != calc_hash)) {
 		/* The count is just informational. */
@@ -847,13 +1240,129 @@ static int _read_hint_file(struct cmd_context *cmd, struct dm_list *hints, int *
 	return 1;
 }
 
+/*
+ * Apply the changes that pvcreate/pvremove recorded in the journal to the
+ * hints read from the hint file.  Each line is "add:<name> pvid:<pvid>
+ * devn:<major>:<minor> vg:<vgname>" or "del:<name>", and the lines of one
+ * command are enclosed by "begin:<pid>" and "end:<pid>".  A begin without
+ * an end is left by a command that did not finish, so its changes are not
+ * known and the hints need to be refreshed.
+ *
+ * Return values are the same as _read_hint_file.
+ */
+static int _read_hint_journal(struct cmd_context *cmd, struct dm_list *hints, int *needs_refresh)
+{
+	FILE *fp;
+	struct hint *hint;
+	char *split[HINT_LINE_WORDS];
+	char *name, *pvid, *devn, *vgname, *p;
+	int in_update = 0;
+	int major, minor;
+	int found = 0;
+	int ret = 1;
+	int i;
+
+	if (!(fp = fopen(_journal_file, "r"))) {
+		if (errno == ENOENT)
+			return 1;
+		log_debug("read_hint_journal open errno %d %s", errno, _journal_file);
+		return 0;
+	}
+
+	while (fgets(_hint_line, sizeof(_hint_line), fp)) {
+		if (_hint_line[0] == '#')
+			continue;
+
+		if ((p = strchr(_hint_line, '\n')))
+			*p = '\0';
+
+		if (!strncmp(_hint_line, "begin:", 6)) {
+			in_update = 1;
+			continue;
+		}
+
+		if (!strncmp(_hint_line, "end:", 4)) {
+			in_update = 0;
+			continue;
+		}
+
+		for (i = 0; i < HINT_LINE_WORDS; i++)
+			split[i] = NULL;
+
+		if (dm_split_words(_hint_line, HINT_LINE_WORDS, 0, split) < 1)
+			continue;
+
+		if (!strncmp(_hint_line, "del:", 4)) {
+			if ((hint = _find_hint_name(hints, split[0] + 4))) {
+				log_debug("journal del hint %s", hint->name);
+				dm_list_del(&hint->list);
+				free(hint);
+			}
+			found++;
+			continue;
+		}
+
+		/* Ignore any other line prefixes that we don't recognize. */
+		if (strncmp(_hint_line, "add:", 4))
+			continue;
+
+		name = split[0] + 4;
+		pvid = split[1];
+		devn = split[2];
+		vgname = split[3];
+
+		if (!pvid || strncmp(pvid, "pvid:", 5) ||
+		    !devn || (sscanf(devn, "devn:%d:%d", &major, &minor) != 2) ||
+		    !vgname || strncmp(vgname, "vg:", 3)) {
+			log_debug("ignore hints with invalid journal line");
+			*needs_refresh = 1;
+			break;
+		}
+
+		if (!(hint = _find_hint_name(hints, name))) {
+			if (!(hint = zalloc(sizeof(*hint)))) {
+				ret = 0;
+				break;
+			}
+			dm_list_add(hints, &hint->list);
+		}
+
+		if (!dm_strncpy(hint->name, name, sizeof(hint->name)) ||
+		    !dm_strncpy(hint->pvid, pvid + 5, sizeof(hint->pvid)) ||
+		    !dm_strncpy(hint->vgname, strcmp(vgname, "vg:-") ? vgname + 3 : "",
+				sizeof(hint->vgname))) {
+			log_debug("ignore hints with invalid journal line");
+			*needs_refresh = 1;
+			break;
+		}
+		hint->devt = makedev(major, minor);
+		hint->mda_size = 0;
+
+		log_debug("journal add hint %s %s %d:%d %s", hint->name, hint->pvid, major, minor, vgname);
+		found++;
+	}
+
+	if (fclose(fp))
+		log_debug("read_hint_journal close errno %d", errno);
+
+	if (ret && in_update && !*needs_refresh) {
+		log_debug("ignore hints with incomplete journal update");
+		*needs_refresh = 1;
+	}
+
+	log_debug("applied hint journal records %d", found);
+	return ret;
+}
+
 /*
  * Include any device in the hints that label_scan saw which had an lvm label
  * header. label_scan set DEV_SCAN_FOUND_LABEL on the dev if it saw an lvm
  * header.  We only create new hints here after a complete label_scan at the
  * start of the command.  (It makes things far simpler to always just recreate
  * hints from a clean, full scan, than to try to make granular updates to the
- * content of an existing hint file.)
+ * content of an existing hint file.  The only granular updates are the ones
+ * appended to the journal by pvcreate/pvremove, and the new file written
+ * here replaces the journal.)
  *
  * Hints are not valid from one command to the next if the commands are using
  * different filters or different scan_lvs settings.  These differences would
@@ -878,17 +1387,99 @@ static int _read_hint_file(struct cmd_context *cmd, struct dm_list *hints, int *
  * It is left out since it is not often changed, but could be easily added.
  */
 
+static int _cmp_hint_record(const void *a, const void *b)
+{
+	const struct hint_record *ra = a, *rb = b;
+
+	if (ra->major != rb->major)
+		return (ra->major < rb->major) ? -1 : 1;
+	if (ra->minor != rb->minor)
+		return (ra->minor < rb->minor) ? -1 : 1;
+	return 0;
+}
+
+static int _add_hint_record(struct hint_record **records, uint32_t *nr, uint32_t *alloc,
+			    struct device *dev, const char *vgname,
+			    struct lvmcache_vgsummary *mda_summary, uint64_t mda_offset)
+{
+	struct hint_record *rec, *new_records;
+
+	if (*nr == *alloc) {
+		*alloc = *alloc ? *alloc * 2 : 64;
+		if (!(new_records = realloc(*records, *alloc * sizeof(*rec))))
+			return_0;
+		*records = new_records;
+	}
+
+	rec = &(*records)[*nr];
+	memset(rec, 0, sizeof(*rec));
+	rec->major = major(dev->dev);
+	rec->minor = minor(dev->dev);
+	(void) dm_strncpy(rec->pvid, dev->pvid, sizeof(rec->pvid));
+	(void) dm_strncpy(rec->vgname, vgname ?: "-", sizeof(rec->vgname));
+	if (!dm_strncpy(rec->name, dev_name(dev), sizeof(rec->name))) {
+		log_debug("binary hints cannot hold name %s", dev_name(dev));
+		return 0;
+	}
+
+	if (mda_summary) {
+		memcpy(rec->vgid, &mda_summary->vgid, ID_LEN);
+		rec->seqno = mda_summary->seqno;
+		rec->mda_checksum = mda_summary->mda_checksum;
+		rec->mda_offset = mda_offset;
+		rec->mda_size = mda_summary->mda_size;
+	}
+
+	(*nr)++;
+	return 1;
+}
+
+static void _write_hint_file_binary(FILE *fp, struct cmd_context *cmd,
+				    struct hint_record *records, uint32_t nr,
+				    uint32_t hash, uint32_t count, uint32_t flags)
+{
+	struct hints_binary_header hdr;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, HINTS_BINARY_MAGIC, sizeof(hdr.magic));
+	hdr.version_major = HINTS_BINARY_VERSION_MAJOR;
+	hdr.version_minor = HINTS_BINARY_VERSION_MINOR;
+	hdr.filter_hash = _filter_hash(cmd);
+	hdr.devs_hash = hash;
+	hdr.devs_count = count;
+	hdr.record_size = sizeof(*records);
+	hdr.flags = flags;
+
+	if (!flags && nr) {
+		qsort(records, nr, sizeof(*records), _cmp_hint_record);
+		hdr.nr_records = nr;
+	}
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+		log_debug("write_hint_file header errno %d", errno);
+	else if (hdr.nr_records &&
+		 (fwrite(records, sizeof(*records), nr, fp) != nr))
+		log_debug("write_hint_file records errno %d", errno);
+}
+
 int write_hint_file(struct cmd_context *cmd, int newhints)
 {
 	char devpath[PATH_MAX];
 	FILE *fp;
 	struct lvmcache_info *info;
+	struct lvmcache_vgsummary mda_summary;
 	struct dev_iter *iter;
 	struct device *dev;
+	struct hint_record *records = NULL;
+	uint64_t mda_offset = 0;
+	int has_mda_summary;
 	const char *vgname;
 	char *filter_str = NULL;
 	uint32_t hash = INITIAL_CRC;
 	uint32_t count = 0;
+	uint32_t nr_records = 0, alloc_records = 0;
+	uint32_t binary_flags = 0;
+	int binary;
 	time_t t;
 	int ret = 1;
 
@@ -914,7 +1505,9 @@ int write_hint_file(struct cmd_context *cmd, int newhints)
 			return 1;
 	}
 
-	log_debug("Writing hint file %d", newhints);
+	binary = find_config_tree_bool(cmd, devices_hints_binary_CFG, NULL);
+
+	log_debug("Writing %shint file %d", binary ? "binary " : "", newhints);
 
 	if (!(fp = fopen(_hints_file, "w"))) {
 		ret = 0;
@@ -923,6 +1516,15 @@ int write_hint_file(struct cmd_context *cmd, int newhints)
 
 	t = time(NULL);
 
+	if (binary && (lvmcache_has_duplicate_devs() || lvmcache_found_duplicate_vgnames())) {
+		if (lvmcache_has_duplicate_devs())
+			binary_flags |= HINTS_BINARY_DUPLICATE_PVS;
+		if (lvmcache_found_duplicate_vgnames())
+			binary_flags |= HINTS_BINARY_DUPLICATE_VGNAMES;
+		_write_hint_file_binary(fp, cmd, NULL, 0, hash, count, binary_flags);
+		goto out_flush;
+	}
+
 	if (lvmcache_has_duplicate_devs() || lvmcache_found_duplicate_vgnames()) {
 		fprintf(fp, "# Created empty by %s pid %d %s", cmd->name, getpid(), ctime(&t));
 
@@ -934,18 +1536,20 @@ int write_hint_file(struct cmd_context *cmd, int newhints)
 		goto out_flush;
 	}
 
-	fprintf(fp, "# Created by %s pid %d %s", cmd->name, getpid(), ctime(&t));
-	fprintf(fp, "hints_version: %d.%d\n", HINTS_VERSION_MAJOR, HINTS_VERSION_MINOR);
+	if (!binary) {
+		fprintf(fp, "# Created by %s pid %d %s", cmd->name, getpid(), ctime(&t));
+		fprintf(fp, "hints_version: %d.%d\n", HINTS_VERSION_MAJOR, HINTS_VERSION_MINOR);
 
-	_filter_to_str(cmd, devices_global_filter_CFG, &filter_str);
-	fprintf(fp, "global_filter:%s\n", filter_str ?: "-");
-	free(filter_str);
+		_filter_to_str(cmd, devices_global_filter_CFG, &filter_str);
+		fprintf(fp, "global_filter:%s\n", filter_str ?: "-");
+		free(filter_str);
 
-	_filter_to_str(cmd, devices_filter_CFG, &filter_str);
-	fprintf(fp, "filter:%s\n", filter_str ?: "-");
-	free(filter_str);
+		_filter_to_str(cmd, devices_filter_CFG, &filter_str);
+		fprintf(fp, "filter:%s\n", filter_str ?: "-");
+		free(filter_str);
 
-	fprintf(fp, "scan_lvs:%d\n", cmd->scan_lvs);
+		fprintf(fp, "scan_lvs:%d\n", cmd->scan_lvs);
+	}
 
 	/* 
 	 * iterate through all devs and write a line for each
@@ -1006,22 +1610,59 @@ int write_hint_file(struct cmd_context *cmd, int newhints)
 		if (vgname && is_orphan_vg(vgname))
 			vgname = NULL;
 
+		/*
+		 * Save where this scan read the metadata from mda1 so the
+		 * next scan can skip reading it again (hint_matches_mda_summary.)
+		 */
+		memset(&mda_summary, 0, sizeof(mda_summary));
+		has_mda_summary = info && vgname &&
+				  lvmcache_mda1_summary_from_info(info, &mda_summary, &mda_offset);
+
+		if (binary) {
+			if (!binary_flags &&
+			    !_add_hint_record(&records, &nr_records, &alloc_records, dev, vgname,
+					      has_mda_summary ? &mda_summary : NULL, mda_offset))
+				binary_flags |= HINTS_BINARY_NAME_TOO_LONG;
+			continue;
+		}
+
 		fprintf(fp, "scan:%s pvid:%s devn:%d:%d vg:%s\n",
 			dev_name(dev),
 			dev->pvid,
 			major(dev->dev), minor(dev->dev),
 			vgname ?: "-");
+
+		if (has_mda_summary)
+			fprintf(fp, "mda:%s vgid:%.*s seqno:%u locn:%llu:%llu:%u\n",
+				dev_name(dev),
+				ID_LEN, (const char *) &mda_summary.vgid,
+				mda_summary.seqno,
+				(unsigned long long) mda_offset,
+				(unsigned long long) mda_summary.mda_size,
+				mda_summary.mda_checksum);
 	}
 
-	fprintf(fp, "devs_hash: %u %u\n", hash, count);
+	if (binary)
+		_write_hint_file_binary(fp, cmd, records, nr_records, hash, count, binary_flags);
+	else
+		fprintf(fp, "devs_hash: %u %u\n", hash, count);
 	dev_iter_destroy(iter);
+	free(records);
 
  out_flush:
 	if (fflush(fp))
 		stack;
 
+	/* The scan saw the changes recorded in the journal. */
+	_unlink_journal();
+
 	log_debug("Wrote hint file with devs_hash %u count %u", hash, count);
 
+	/* The scan also produced filter results for every device it read. */
+	if (find_config_tree_bool(cmd, devices_filter_cache_CFG, NULL) &&
+	    !persistent_filter_save(cmd, cmd->filter, _filter_cache_file, _filter_cache_hash(cmd)))
+		stack;
+
 	/*
 	 * We are writing refreshed hints because another command told us to by
 	 * touching newhints, so unlink the newhints file.
@@ -1117,6 +1758,170 @@ void clear_hint_file(struct cmd_context *cmd)
 		stack;
 }
 
+/*
+ * pvcreate and pvremove know exactly which devs they change, so in place
+ * of clear_hint_file they can record those changes in the hints journal
+ * when devices/hints_journal_max is set.  The hint file then remains usable
+ * and the next command does not need to scan all devices to recreate it.
+ * Readers apply the journal after reading the hint file (_read_hint_journal).
+ *
+ * The journal is written while holding the ex hints lock, taken the same
+ * way as clear_hint_file, so no other command reads it while it changes.
+ * The changes of one command are enclosed between begin and end lines,
+ * and end is only written by journal_hint_file_end() after every change
+ * succeeded.  A failed or killed command leaves an unmatched begin, which
+ * causes readers to refresh the hints.
+ *
+ * The journal is compacted into the hint file by the next command that
+ * writes a hint file after a full scan.  Once the journal holds
+ * hints_journal_max entries, the hint file is cleared here as usual so
+ * the next command does that.
+ */
+
+static int _count_journal_records(void)
+{
+	FILE *fp;
+	int nr = 0;
+
+	if (!(fp = fopen(_journal_file, "r")))
+		return (errno == ENOENT) ? 0 : -1;
+
+	while (fgets(_hint_line, sizeof(_hint_line), fp))
+		if (!strncmp(_hint_line, "add:", 4) || !strncmp(_hint_line, "del:", 4))
+			nr++;
+
+	if (fclose(fp))
+		log_debug("count_journal_records close errno %d", errno);
+
+	return nr;
+}
+
+__attribute__ ((format(printf, 1, 2)))
+static int _append_journal(const char *fmt, ...)
+{
+	va_list ap;
+	int r;
+
+	va_start(ap, fmt);
+	r = vfprintf(_journal_fp, fmt, ap);
+	va_end(ap);
+
+	if ((r < 0) || fflush(_journal_fp)) {
+		log_debug("append_journal errno %d %s", errno, _journal_file);
+		return 0;
+	}
+
+	return 1;
+}
+
+void journal_hint_file_begin(struct cmd_context *cmd)
+{
+	int max;
+	int nr;
+
+	/* No commands are using hints. */
+	if (!cmd->enable_hints)
+		return;
+
+	max = find_config_tree_int(cmd, devices_hints_journal_max_CFG, NULL);
+
+	if ((max <= 0) || !_hints_exists()) {
+		clear_hint_file(cmd);
+		return;
+	}
+
+	log_debug("journal_hint_file_begin");
+
+	/* limit potential delay blocking on hints lock next, as clear_hint_file */
+	if (!_touch_nohints())
+		stack;
+
+	if (!_lock_hints(cmd, LOCK_EX, 0)) {
+		stack;
+		goto clear;
+	}
+
+	_unlink_nohints();
+
+	/* Hints are being recreated, the journal would be discarded. */
+	if (_newhints_exists())
+		goto clear;
+
+	if ((nr = _count_journal_records()) < 0)
+		goto clear;
+
+	if (nr >= max) {
+		log_debug("journal_hint_file_begin compact %d records", nr);
+		goto clear;
+	}
+
+	if (!(_journal_fp = fopen(_journal_file, "a"))) {
+		log_debug("journal_hint_file_begin open errno %d %s", errno, _journal_file);
+		goto clear;
+	}
+
+	if (!_append_journal("begin:%d\n", getpid())) {
+		journal_hint_file_end(cmd, 0);
+		return;
+	}
+
+	return;
+
+ clear:
+	if (!_clear_hints(cmd))
+		stack;
+
+	if (!_touch_newhints())
+		stack;
+}
+
+void journal_hint_add(struct cmd_context *cmd, struct device *dev, const char *pvid)
+{
+	if (!_journal_fp)
+		return;
+
+	if (!_append_journal("add:%s pvid:%.*s devn:%d:%d vg:-\n", dev_name(dev),
+			     ID_LEN, pvid, (int) major(dev->dev), (int) minor(dev->dev)))
+		journal_hint_file_end(cmd, 0);
+}
+
+void journal_hint_remove(struct cmd_context *cmd, struct device *dev)
+{
+	if (!_journal_fp)
+		return;
+
+	if (!_append_journal("del:%s\n", dev_name(dev)))
+		journal_hint_file_end(cmd, 0);
+}
+
+/*
+ * When the command did not complete all of its changes, fall back to
+ * clearing the hint file, as clear_hint_file would have done at the start.
+ */
+void journal_hint_file_end(struct cmd_context *cmd, int success)
+{
+	if (!_journal_fp)
+		return;
+
+	log_debug("journal_hint_file_end %s", success ? "done" : "failed");
+
+	if (success && !_append_journal("end:%d\n", getpid()))
+		success = 0;
+
+	if (fclose(_journal_fp))
+		log_debug("journal_hint_file_end close errno %d", errno);
+	_journal_fp = NULL;
+
+	if (success)
+		return;
+
+	if (!_clear_hints(cmd))
+		stack;
+
+	if (!_touch_newhints())
+		stack;
+}
+
 /*
  * This is only used at the start of pvscan --cache [-aay] to
  * set up for recreating the hint file.
@@ -1162,6 +1967,110 @@ void invalidate_hints(struct cmd_context *cmd)
 		stack;
 }
 
+/*
+ * With devices/filter_cache the devices excluded by the scan that wrote
+ * the hint file are saved next to it, and later commands using hints
+ * exclude them again without running the filters.  Anything that makes
+ * the hints stale (nohints, newhints, a missing hint file) makes the
+ * saved results stale too, and they are replaced together with the
+ * hints by the next full scan.
+ */
+void read_filter_cache(struct cmd_context *cmd)
+{
+	if (!cmd->enable_hints || !cmd->use_hints || !cmd->filter ||
+	    !find_config_tree_bool(cmd, devices_filter_cache_CFG, NULL))
+		return;
+
+	if (_nohints_exists() || _newhints_exists() || !_hints_exists())
+		return;
+
+	(void) persistent_filter_load(cmd->filter, _filter_cache_file, _filter_cache_hash(cmd));
+}
+
+/*
+ * Find the dev that the hints say has the given pvid, to avoid reading
+ * every dev to find it.  The hints may be outdated, so the caller needs
+ * to check the dev.  The hints are not kept: this is used by commands
+ * that don't otherwise use them, so cmd->hints and the index don't change.
+ */
+/*
+ * The hints as last written, not checked against the system, for
+ * reports that do not look at devices.  Free with free_hints().
+ */
+int get_hints_unchecked(struct cmd_context *cmd, struct dm_list *hints)
+{
+	int needs_refresh = 0;
+	int ret = 0;
+
+	dm_list_init(hints);
+
+	if (!cmd->enable_hints || (_hints_fd != -1))
+		return 0;
+
+	if (_nohints_exists() || _newhints_exists() || !_hints_exists())
+		return 0;
+
+	if (!_lock_hints(cmd, LOCK_SH, NONBLOCK))
+		return 0;
+
+	if (_read_hint_file(cmd, hints, &needs_refresh) && !needs_refresh &&
+	    _read_hint_journal(cmd, hints, &needs_refresh) && !needs_refresh)
+		ret = 1;
+
+	_unlock_hints(cmd);
+
+	if (!ret)
+		free_hints(hints);
+
+	return ret;
+}
+
+int get_hint_pvid_devt(struct cmd_context *cmd, const char *pvid, dev_t *devt)
+{
+	struct dm_list hints_list;
+	struct hint *hint, *hint2;
+	int needs_refresh = 0;
+	int ret = 0;
+
+	/* No commands are using hints. */
+	if (!cmd->enable_hints)
+		return 0;
+
+	/* This command is changing the hints, e.g. after clear_hint_file. */
+	if (_hints_fd != -1)
+		return 0;
+
+	if (_nohints_exists() || _newhints_exists() || !_hints_exists())
+		return 0;
+
+	if (!_lock_hints(cmd, LOCK_SH, NONBLOCK))
+		return 0;
+
+	dm_list_init(&hints_list);
+
+	if (_read_hint_file(cmd, &hints_list, &needs_refresh) && !needs_refresh &&
+	    !dm_list_empty(&hints_list) &&
+	    _read_hint_journal(cmd, &hints_list, &needs_refresh) && !needs_refresh) {
+		dm_list_iterate_items(hint, &hints_list) {
+			if (!strncmp(hint->pvid, pvid, ID_LEN)) {
+				log_debug("get_hint_pvid_devt %s %s", pvid, hint->name);
+				*devt = hint->devt;
+				ret = 1;
+				break;
+			}
+		}
+	}
+
+	_unlock_hints(cmd);
+
+	dm_list_iterate_items_safe(hint, hint2, &hints_list) {
+		dm_list_del(&hint->list);
+		free(hint);
+	}
+
+	return ret;
+}
+
 /*
  * Currently, all the commands using hints (ALLOW_HINTS) take an optional or
  * required first position arg of a VG name or LV name.  If some other command
@@ -1330,7 +2239,9 @@ int get_hints(struct cmd_context *cmd, struct dm_list *hints_out, int *newhints,
 	/*
 	 * couln't read file for some reason, not normal, just skip using hints
 	 */
-	if (!_read_hint_file(cmd, &hints_list, &needs_refresh)) {
+	if (!_read_hint_file(cmd, &hints_list, &needs_refresh) ||
+	    (!needs_refresh && !dm_list_empty(&hints_list) &&
+	     !_read_hint_journal(cmd, &hints_list, &needs_refresh))) {
 		log_debug("get_hints: read fail");
 		free_hints(&hints_list);
 		_unlock_hints(cmd);
@@ -1381,6 +2292,9 @@ int get_hints(struct cmd_context *cmd, struct dm_list *hints_out, int *newhints,
 	 * us which devs are PVs. We might want to enable this optimization
 	 * separately.)
 	 */
+	if (!_build_hint_index(&hints_list))
+		log_debug("get_hints: hints not indexed");
+
 	_get_single_vgname_cmd_arg(cmd, &hints_list, &vgname);
 
 	_apply_hints(cmd, &hints_list, vgname, devs_in, devs_out);
@@ -15,12 +15,20 @@
 #ifndef _LVM_HINTS_H
 #define _LVM_HINTS_H
 
+struct lvmcache_vgsummary;
+
 struct hint {
 	struct dm_list list;
 	char name[PATH_MAX];
 	char pvid[ID_LEN + 1];
 	char vgname[NAME_LEN];
 	dev_t devt;
+	/* summary of the metadata in mda1, when mda_size is set */
+	char vgid[ID_LEN + 1];
+	uint32_t seqno;
+	uint32_t mda_checksum;
+	uint64_t mda_offset;
+	uint64_t mda_size;
 	unsigned chosen:1; /* this hint's dev was chosen for scanning */
 };
 
@@ -30,13 +38,30 @@ int write_hint_file(struct cmd_context *cmd, int newhints);
 
 void clear_hint_file(struct cmd_context *cmd);
 
+void journal_hint_file_begin(struct cmd_context *cmd);
+
+void journal_hint_add(struct cmd_context *cmd, struct device *dev, const char *pvid);
+
+void journal_hint_remove(struct cmd_context *cmd, struct device *dev);
+
+void journal_hint_file_end(struct cmd_context *cmd, int success);
+
 void invalidate_hints(struct cmd_context *cmd);
 
+void read_filter_cache(struct cmd_context *cmd);
+
 int get_hints(struct cmd_context *cmd, struct dm_list *hints, int *newhints,
               struct dm_list *devs_in, struct dm_list *devs_out);
 
 int validate_hints(struct cmd_context *cmd, struct dm_list *hints);
 
+int get_hints_unchecked(struct cmd_context *cmd, struct dm_list *hints);
+
+int get_hint_pvid_devt(struct cmd_context *cmd, const char *pvid, dev_t *devt);
+
+int hint_matches_mda_summary(struct device *dev, uint64_t text_offset,
+			     const struct lvmcache_vgsummary *vgsummary);
+
 void hints_exit(struct cmd_context *cmd);
 
 void pvscan_recreate_hints_begin(struct cmd_context *cmd);
@@ -25,6 +25,7 @@
 #include "lib/label/hints.h"
 #include "lib/metadata/metadata.h"
 #include "lib/format_text/layout.h"
+#include "lib/log/timing.h"
 
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -34,7 +35,6 @@
 
 /* FIXME Allow for larger labels?  Restricted to single sector currently */
 
-static uint64_t _current_bcache_size_bytes;
 
 /*
  * Internal labeller struct.
@@ -342,6 +342,36 @@ static struct labeller *_find_lvm_header(struct device *dev,
 	return labeller_ret;
 }
 
+/*
+ * Let the labeller start reading the metadata of the PV in the scanned
+ * block bb, see _scan_list().  No messages: _process_block() reports
+ * anything wrong with the label afterwards.
+ */
+static void _prefetch_metadata(struct device *dev, struct block *bb)
+{
+	struct labeller_i *li;
+	struct label_header *lh;
+	uint64_t sector;
+
+	for (sector = 0; sector < LABEL_SCAN_SECTORS;
+	     sector += LABEL_SIZE >> SECTOR_SHIFT) {
+		lh = (struct label_header *) ((char *) bb->data + (sector << SECTOR_SHIFT));
+
+		if (memcmp(lh->id, LABEL_ID, sizeof(lh->id)) ||
+		    (xlate64(lh->sector_xl) != sector))
+			continue;
+
+		dm_list_iterate_items(li, &_labellers) {
+			if (li->l->ops->prefetch &&
+			    li->l->ops->can_handle(li->l, (char *) lh, sector)) {
+				li->l->ops->prefetch(li->l, dev, (const char *) bb->data,
+						     BCACHE_BLOCK_SIZE_IN_SECTORS << SECTOR_SHIFT, lh);
+				return;
+			}
+		}
+	}
+}
+
 /*
  * Process/parse the headers from the data read from a device.
  * Populates lvmcache with device / mda locations / vgname
@@ -361,6 +391,7 @@ static int _process_block(struct cmd_context *cmd, struct dev_filter *f,
 	struct labeller *labeller;
 	uint64_t sector = 0;
 	int is_duplicate = 0;
+	int passed;
 	int ret = 0;
 
 	dev->flags &= ~DEV_SCAN_FOUND_LABEL;
@@ -373,7 +404,11 @@ static int _process_block(struct cmd_context *cmd, struct dev_filter *f,
 	 * begins to be processed as a PV.
 	 */
 	if (f) {
-		if (!f->passes_filter(cmd, f, dev, NULL)) {
+		timing_start(TIMING_FILTERS);
+		passed = f->passes_filter(cmd, f, dev, NULL);
+		timing_end(TIMING_FILTERS);
+
+		if (!passed) {
 			/*
 			 * If this device was previously scanned (not common)
 			 * and if it passed filters at that point, lvmcache
@@ -468,8 +503,6 @@ static int _process_block(struct cmd_context *cmd, struct dev_filter *f,
 
 static int _scan_dev_open(struct device *dev)
 {
-	struct dm_list *name_list;
-	struct dm_str_list *name_sl;
 	const char *name;
 	const char *modestr;
 	struct stat sbuf;
@@ -497,14 +530,13 @@ static int _scan_dev_open(struct device *dev)
 	 * All the names for this device (major:minor) are kept on
 	 * dev->aliases, the first one is the primary/preferred name.
 	 */
-	if (!(name_list = dm_list_first(&dev->aliases))) {
+	if (dm_list_empty(&dev->aliases)) {
 		/* Shouldn't happen */
 		log_error("Device open %s %d:%d has no path names.",
 			  dev_name(dev), (int)MAJOR(dev->dev), (int)MINOR(dev->dev));
 		return 0;
 	}
-	name_sl = dm_list_item(name_list, struct dm_str_list);
-	name = name_sl->str;
+	name = dev_name(dev);
 
 	flags |= O_DIRECT;
 	flags |= O_NOATIME;
@@ -593,6 +625,24 @@ retry_open:
 	return 1;
 }
 
+static void _log_dev_io_stats(struct device *dev)
+{
+	struct bcache_di_stats st;
+
+	if (!scan_bcache || !bcache_get_di_stats(scan_bcache, dev->bcache_di, &st))
+		return;
+
+	if (!st.reads_issued && !st.writes_issued)
+		return;
+
+	log_debug_io("Device IO stats %s: hits %llu misses %llu reads %llu (%llu bytes) writes %llu (%llu bytes) errors %llu",
+		     dev_name(dev),
+		     (unsigned long long)st.hits, (unsigned long long)st.misses,
+		     (unsigned long long)st.reads_issued, (unsigned long long)st.bytes_read,
+		     (unsigned long long)st.writes_issued, (unsigned long long)st.bytes_written,
+		     (unsigned long long)st.io_errors);
+}
+
 static int _scan_dev_close(struct device *dev)
 {
 	if (!(dev->flags & DEV_IN_BCACHE))
@@ -607,6 +657,8 @@ static int _scan_dev_close(struct device *dev)
 		return 0;
 	}
 
+	_log_dev_io_stats(dev);
+
 	bcache_clear_fd(dev->bcache_di);
 
 	if (close(dev->bcache_fd))
@@ -668,6 +720,180 @@ static void _invalidate_di(struct bcache *cache, int di)
  * its info is removed from lvmcache.
  */
 
+/*
+ * With devices/scan_fd_window, no more than this many devices are
+ * opened at once by a scan, and PVs are closed once their label has
+ * been processed, like other devices.  PVs are then reopened when their
+ * metadata is read, and the least recently reopened ones are closed
+ * again to keep the number of open devices within the window.  This
+ * costs a second read of each PV's first block, but avoids raising the
+ * open file limit to the number of PVs.
+ */
+static int _fd_window;
+static struct device **_window_devs;
+static int _window_size;
+static int _window_next;
+
+static void _window_exit(void)
+{
+	free(_window_devs);
+	_window_devs = NULL;
+	_window_size = 0;
+	_window_next = 0;
+}
+
+/*
+ * Called for devices reopened outside of a scan.  Devices opened for
+ * writing are left alone, they are not closed until the command is done
+ * with them.
+ */
+static void _window_add(struct device *dev)
+{
+	struct device *old;
+
+	if (_fd_window <= 0)
+		return;
+
+	if (_window_size != _fd_window) {
+		_window_exit();
+		if (!(_window_devs = zalloc(_fd_window * sizeof(*_window_devs))))
+			return;
+		_window_size = _fd_window;
+	}
+
+	old = _window_devs[_window_next];
+
+	if (old && (old != dev) && _in_bcache(old) &&
+	    !(old->flags & (DEV_BCACHE_WRITE | DEV_BCACHE_EXCL)) &&
+	    bcache_invalidate_di(scan_bcache, old->bcache_di)) {
+		log_debug_devs("Closing %s to stay within fd window %d", dev_name(old), _fd_window);
+		_scan_dev_close(old);
+	}
+
+	_window_devs[_window_next] = dev;
+	_window_next = (_window_next + 1) % _window_size;
+}
+
+/*
+ * With devices/scan_probe, only this much of each device is read
+ * to look for a label.  It covers the label sectors, and is a
+ * single page, so it can be read with O_DIRECT on any device.
+ */
+#define LABEL_PROBE_SECTORS 8
+
+/*
+ * Returns 1 if a label is found in the probed head of the device,
+ * otherwise the device is not a PV and needs no further reading.
+ */
+static int _probe_found_label(struct device *dev, struct block *bb)
+{
+	char label_buf[LABEL_SIZE] __attribute__((aligned(8)));
+
+	if (_find_lvm_header(dev, bb->data, LABEL_PROBE_SECTORS, label_buf, NULL, 0, 0))
+		return 1;
+
+	log_very_verbose("%s: No lvm label detected in probe", dev_name(dev));
+
+	if (dev->pvid[0]) {
+		log_debug_devs("Clear pvid and info for %s without label", dev_name(dev));
+		lvmcache_del_dev(dev);
+		memset(dev->pvid, 0, sizeof(dev->pvid));
+	}
+
+	dev->flags &= ~DEV_SCAN_FOUND_LABEL;
+
+	return 0;
+}
+
+/*
+ * With devices/scan_controller_max_io, at most that many devices behind
+ * one controller (see dev_get_io_group) are read in each round of
+ * _scan_list.
+ */
+struct scan_group {
+	struct dm_list list;
+	int in_flight;
+};
+
+struct scan_groups {
+	struct dm_pool *mem;
+	struct dm_hash_table *by_name;
+	struct dm_hash_table *by_dev;
+	struct dm_list list;
+	int max_io;
+};
+
+static int _scan_groups_init(struct scan_groups *sg, int max_io)
+{
+	memset(sg, 0, sizeof(*sg));
+	dm_list_init(&sg->list);
+
+	if (max_io <= 0)
+		return 1;
+
+	if (!(sg->mem = dm_pool_create("scan_groups", 1024)))
+		return_0;
+
+	if (!(sg->by_name = dm_hash_create(32)) ||
+	    !(sg->by_dev = dm_hash_create(128))) {
+		if (sg->by_name)
+			dm_hash_destroy(sg->by_name);
+		dm_pool_destroy(sg->mem);
+		return_0;
+	}
+
+	sg->max_io = max_io;
+
+	return 1;
+}
+
+static void _scan_groups_exit(struct scan_groups *sg)
+{
+	if (!sg->max_io)
+		return;
+
+	dm_hash_destroy(sg->by_dev);
+	dm_hash_destroy(sg->by_name);
+	dm_pool_destroy(sg->mem);
+}
+
+static void _scan_groups_reset(struct scan_groups *sg)
+{
+	struct scan_group *group;
+
+	dm_list_iterate_items(group, &sg->list)
+		group->in_flight = 0;
+}
+
+/* Returns NULL for devices that are not limited. */
+static struct scan_group *_dev_scan_group(struct scan_groups *sg, struct device *dev)
+{
+	char name[PATH_MAX];
+	struct scan_group *group;
+
+	if (!sg->max_io)
+		return NULL;
+
+	if ((group = dm_hash_lookup_binary(sg->by_dev, &dev, sizeof(dev))))
+		return group;
+
+	if (!dev_get_io_group(dev, name, sizeof(name)))
+		return NULL;
+
+	if (!(group = dm_hash_lookup(sg->by_name, name))) {
+		if (!(group = dm_pool_zalloc(sg->mem, sizeof(*group))) ||
+		    !dm_hash_insert(sg->by_name, name, group))
+			return_NULL;
+		dm_list_add(&sg->list, &group->list);
+		log_debug_devs("Scan group %d is %s", dm_list_size(&sg->list), name);
+	}
+
+	if (!dm_hash_insert_binary(sg->by_dev, &dev, sizeof(dev), group))
+		return_NULL;
+
+	return group;
+}
+
 static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 		      struct dm_list *devs, int want_other_devs, int *failed)
 {
@@ -675,11 +901,17 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 	struct dm_list done_devs;
 	struct dm_list reopen_devs;
 	struct device_list *devl, *devl2;
+	struct scan_groups groups;
+	struct scan_group *group;
 	struct block *bb;
 	int retried_open = 0;
 	int scan_read_errors = 0;
 	int scan_process_errors = 0;
 	int scan_failed_count = 0;
+	int scan_probed = 0;
+	int scan_probe_skipped = 0;
+	int scan_group_deferred = 0;
+	int probe;
 	int rem_prefetches;
 	int submit_count;
 	int is_lvm_device;
@@ -689,11 +921,26 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 	dm_list_init(&done_devs);
 	dm_list_init(&reopen_devs);
 
-	log_debug_devs("Scanning %d devices for VG info", dm_list_size(devs));
+	/*
+	 * Callers wanting non-lvm devs will look at them further, so
+	 * read them in full.
+	 */
+	probe = !want_other_devs && find_config_tree_bool(cmd, devices_scan_probe_CFG, NULL);
+
+	_fd_window = find_config_tree_int(cmd, devices_scan_fd_window_CFG, NULL);
+
+	if (!_scan_groups_init(&groups, find_config_tree_int(cmd, devices_scan_controller_max_io_CFG, NULL)))
+		log_debug_devs("Scanning without controller limits.");
+
+	log_debug_devs("Scanning %d devices for VG info%s", dm_list_size(devs),
+		       probe ? " with label probe" : "");
 
  scan_more:
 	rem_prefetches = bcache_max_prefetches(scan_bcache);
+	if ((_fd_window > 0) && (rem_prefetches > _fd_window))
+		rem_prefetches = _fd_window;
 	submit_count = 0;
+	_scan_groups_reset(&groups);
 
 	dm_list_iterate_items_safe(devl, devl2, devs) {
 
@@ -707,6 +954,13 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 		if (!rem_prefetches)
 			break;
 
+		/* Leave the dev for the next round if its controller is busy. */
+		group = _dev_scan_group(&groups, devl->dev);
+		if (group && (group->in_flight >= groups.max_io)) {
+			scan_group_deferred++;
+			continue;
+		}
+
 		if (!_in_bcache(devl->dev)) {
 			if (!_scan_dev_open(devl->dev)) {
 				log_debug_devs("Scan failed to open %s.", dev_name(devl->dev));
@@ -716,10 +970,15 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 			}
 		}
 
-		bcache_prefetch(scan_bcache, devl->dev->bcache_di, 0);
+		if (probe)
+			bcache_prefetch_head(scan_bcache, devl->dev->bcache_di, 0, LABEL_PROBE_SECTORS);
+		else
+			bcache_prefetch(scan_bcache, devl->dev->bcache_di, 0);
 
 		rem_prefetches--;
 		submit_count++;
+		if (group)
+			group->in_flight++;
 
 		dm_list_del(&devl->list);
 		dm_list_add(&wait_devs, &devl->list);
@@ -727,10 +986,48 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 
 	log_debug_devs("Scanning submitted %d reads", submit_count);
 
+	/*
+	 * As each label block arrives, start the reads of the metadata it
+	 * points to, so those are in flight together while the blocks are
+	 * processed below, rather than read serially by each _text_read().
+	 * With probing, the full block is only read for labelled devices
+	 * below, so this is skipped.  The block is got again for
+	 * processing, so this get is only a peek.
+	 */
+	if (!probe) {
+		dm_list_iterate_items(devl, &wait_devs) {
+			if (!bcache_get(scan_bcache, devl->dev->bcache_di, 0, GF_PEEK, &bb))
+				continue;
+			_prefetch_metadata(devl->dev, bb);
+			bcache_put(bb);
+		}
+	}
+
 	dm_list_iterate_items_safe(devl, devl2, &wait_devs) {
 		bb = NULL;
 		is_lvm_device = 0;
 
+		if (probe) {
+			scan_probed++;
+
+			if (!bcache_get_head(scan_bcache, devl->dev->bcache_di, 0, LABEL_PROBE_SECTORS, 0, &bb)) {
+				log_debug_devs("Scan failed to probe %s.", dev_name(devl->dev));
+				scan_read_errors++;
+				scan_failed_count++;
+				lvmcache_del_dev(devl->dev);
+				goto next;
+			}
+
+			if (!_probe_found_label(devl->dev, bb)) {
+				scan_probe_skipped++;
+				goto next;
+			}
+
+			/* The full block is read in by the bcache_get below. */
+			bcache_put(bb);
+			bb = NULL;
+		}
+
 		if (!bcache_get(scan_bcache, devl->dev->bcache_di, 0, 0, &bb)) {
 			log_debug_devs("Scan failed to read %s.", dev_name(devl->dev));
 			scan_read_errors++;
@@ -751,7 +1048,7 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 				scan_failed_count++;
 			}
 		}
-
+next:
 		if (bb)
 			bcache_put(bb);
 
@@ -761,9 +1058,11 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 		 * read the block, or the device does not belong to lvm, then
 		 * drop it from bcache.  When "want_other_devs" is set, it
 		 * means the caller wants to scan and keep open non-lvm devs,
-		 * e.g. to pvcreate them.
+		 * e.g. to pvcreate them.  With an fd window, lvm devices
+		 * are also closed, to be reopened when their metadata is
+		 * read.
 		 */
-		if (!is_lvm_device && !want_other_devs) {
+		if ((!is_lvm_device || (_fd_window > 0)) && !want_other_devs) {
 			_invalidate_di(scan_bcache, devl->dev->bcache_di);
 			_scan_dev_close(devl->dev);
 		}
@@ -820,8 +1119,11 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 		goto scan_more;
 	}
 out:
-	log_debug_devs("Scanned devices: read errors %d process errors %d failed %d",
-			scan_read_errors, scan_process_errors, scan_failed_count);
+	log_debug_devs("Scanned devices: read errors %d process errors %d failed %d probed %d skipped %d deferred %d",
+			scan_read_errors, scan_process_errors, scan_failed_count,
+			scan_probed, scan_probe_skipped, scan_group_deferred);
+
+	_scan_groups_exit(&groups);
 
 	if (failed)
 		*failed = scan_failed_count;
@@ -832,26 +1134,25 @@ out:
 }
 
 /*
- * We don't know ahead of time if we will find some VG metadata 
- * that is larger than the total size of the bcache, which would
- * prevent us from reading/writing the VG since we do not dynamically
- * increase the bcache size when we find it's too small.  In these
- * cases the user would need to set io_memory_size to be larger
- * than the max VG metadata size (lvm does not impose any limit on
- * the metadata size.)
+ * bcache starts with MIN_BCACHE_BLOCKS and grows as the command finds
+ * out what it needs: a block per device it is about to scan, up to
+ * io_memory_size, and room for the largest VG metadata it has seen or
+ * is about to write, up to MAX_BCACHE_BLOCKS.  So a small system with
+ * a few disks does not allocate io_memory_size up front, and large
+ * metadata no longer needs io_memory_size raised by hand.  Blocks are
+ * kept until bcache is destroyed.
  */
 
 #define MIN_BCACHE_BLOCKS 32    /* 4MB (32 * 128KB) */
 #define MAX_BCACHE_BLOCKS 4096  /* 512MB (4096 * 128KB) */
 
-static int _setup_bcache(void)
-{
-	struct io_engine *ioe = NULL;
-	int iomem_kb = io_memory_size();
-	int block_size_kb = (BCACHE_BLOCK_SIZE_IN_SECTORS * 512) / 1024;
-	int cache_blocks;
+#define BCACHE_BLOCK_SIZE_BYTES (BCACHE_BLOCK_SIZE_IN_SECTORS * 512)
 
-	cache_blocks = iomem_kb / block_size_kb;
+/* Blocks allowed for caching devices, from io_memory_size. */
+static unsigned _io_memory_blocks(void)
+{
+	int block_size_kb = BCACHE_BLOCK_SIZE_BYTES / 1024;
+	int cache_blocks = io_memory_size() / block_size_kb;
 
 	if (cache_blocks < MIN_BCACHE_BLOCKS)
 		cache_blocks = MIN_BCACHE_BLOCKS;
@@ -859,23 +1160,100 @@ static int _setup_bcache(void)
 	if (cache_blocks > MAX_BCACHE_BLOCKS)
 		cache_blocks = MAX_BCACHE_BLOCKS;
 
-	_current_bcache_size_bytes = cache_blocks * BCACHE_BLOCK_SIZE_IN_SECTORS * 512;
+	return cache_blocks;
+}
+
+static int _grow_bcache(unsigned want_blocks, unsigned max_blocks)
+{
+	unsigned cur_blocks;
 
-	if (use_aio()) {
-		if (!(ioe = create_async_io_engine())) {
+	if (!scan_bcache)
+		return 1;
+
+	if (want_blocks > max_blocks)
+		want_blocks = max_blocks;
+
+	cur_blocks = bcache_nr_cache_blocks(scan_bcache);
+
+	if (want_blocks <= cur_blocks)
+		return 1;
+
+	if (!bcache_grow(scan_bcache, want_blocks)) {
+		log_debug("Failed to grow bcache from %u to %u blocks.", cur_blocks, want_blocks);
+		return 0;
+	}
+
+	log_debug("Grew bcache from %u to %u blocks.", cur_blocks, want_blocks);
+
+	return 1;
+}
+
+/*
+ * Make room for metadata of the given size, with 1MB to spare.
+ * Returns 0 if bcache cannot be that large.
+ */
+int label_scan_reserve_bcache(uint64_t metadata_bytes)
+{
+	uint64_t want_blocks = (metadata_bytes + (1024 * 1024) + BCACHE_BLOCK_SIZE_BYTES - 1) / BCACHE_BLOCK_SIZE_BYTES;
+
+	if (want_blocks > MAX_BCACHE_BLOCKS)
+		return 0;
+
+	return _grow_bcache((unsigned) want_blocks, MAX_BCACHE_BLOCKS);
+}
+
+static int _setup_bcache(void)
+{
+	struct io_engine *ioe = NULL, *delay_ioe, *trace_ioe;
+	const char *delay_spec, *trace_path;
+	int cache_blocks = MIN_BCACHE_BLOCKS;
+
+	if (use_aio() && use_io_uring()) {
+		if ((ioe = create_uring_io_engine()))
+			log_debug("Using io_uring io engine.");
+		else
+			log_debug("Failed to set up io_uring, trying libaio.");
+	}
+
+	if (use_aio() && !ioe) {
+		if ((ioe = create_async_io_engine()))
+			log_debug("Using libaio io engine.");
+		else {
 			log_warn("Failed to set up async io, using sync io.");
 			init_use_aio(0);
 		}
 	}
 
+	if (!ioe && (io_threads() > 0)) {
+		if ((ioe = create_thread_io_engine(io_threads())))
+			log_debug("Using sync io engine with %d threads.", io_threads());
+		else
+			log_debug("Failed to set up io threads, using sync io.");
+	}
+
 	if (!ioe) {
 		if (!(ioe = create_sync_io_engine())) {
 			log_error("Failed to set up sync io.");
 			return 0;
 		}
+		log_debug("Using sync io engine.");
+	}
+
+	/* Simulated device latency for the test suite */
+	if ((delay_spec = getenv("LVM_TEST_IO_DELAY")) && *delay_spec &&
+	    (delay_ioe = create_delay_io_engine(ioe, delay_spec))) {
+		log_debug("Using io delay %s.", delay_spec);
+		ioe = delay_ioe;
+	}
+
+	/* Outside the delay, so a replay records the latency it simulates */
+	if ((trace_path = getenv("LVM_IO_TRACE")) && *trace_path &&
+	    (trace_ioe = create_trace_io_engine(ioe, trace_path))) {
+		log_debug("Tracing io to %s.", trace_path);
+		ioe = trace_ioe;
 	}
 
-	if (!(scan_bcache = bcache_create(BCACHE_BLOCK_SIZE_IN_SECTORS, cache_blocks, ioe))) {
+	if (!(scan_bcache = bcache_create(BCACHE_BLOCK_SIZE_IN_SECTORS, cache_blocks, ioe, BCACHE_POLICY_2Q))) {
 		log_error("Failed to create bcache with %d cache blocks.", cache_blocks);
 		return 0;
 	}
@@ -939,17 +1317,22 @@ static void _prepare_open_file_limit(struct cmd_context *cmd, unsigned int num_d
 int label_scan_for_pvid(struct cmd_context *cmd, char *pvid, struct device **dev_out)
 {
 	char buf[LABEL_SIZE] __attribute__((aligned(8)));
+	char udev_pvid[ID_LEN + 1];
 	struct dm_list devs;
 	struct dev_iter *iter;
 	struct device_list *devl, *devl2;
 	struct device *dev;
 	struct pv_header *pvh;
+	dev_t hint_devt = 0;
+	int found_hint;
 	int ret = 0;
 
 	dm_list_init(&devs);
 
 	dev_cache_scan();
 
+	found_hint = get_hint_pvid_devt(cmd, pvid, &hint_devt);
+
 	if (!(iter = dev_iter_create(cmd->filter, 0))) {
 		log_error("Scanning failed to get devices.");
 		return 0;
@@ -957,11 +1340,20 @@ int label_scan_for_pvid(struct cmd_context *cmd, char *pvid, struct device **dev
 
 	log_debug_devs("Filtering devices to scan");
 
+	/*
+	 * Devs that the hints or the udev db say have the pvid are read
+	 * first, so the other devs are only read if those are wrong.
+	 */
 	while ((dev = dev_iter_get(cmd, iter))) {
 		if (!(devl = zalloc(sizeof(*devl))))
 			continue;
 		devl->dev = dev;
-		dm_list_add(&devs, &devl->list);
+		if ((found_hint && (dev->dev == hint_devt)) ||
+		    (udev_dev_get_pvid(dev, udev_pvid) && !memcmp(udev_pvid, pvid, ID_LEN))) {
+			log_debug_devs("Reading %s first for pvid", dev_name(dev));
+			dm_list_add_h(&devs, &devl->list);
+		} else
+			dm_list_add(&devs, &devl->list);
 	};
 	dev_iter_destroy(iter);
 
@@ -1012,7 +1404,7 @@ int label_scan_for_pvid(struct cmd_context *cmd, char *pvid, struct device **dev
  * processing a given VG.
  */
 
-int label_scan(struct cmd_context *cmd)
+static int _label_scan(struct cmd_context *cmd)
 {
 	struct dm_list all_devs;
 	struct dm_list filtered_devs;
@@ -1023,6 +1415,7 @@ int label_scan(struct cmd_context *cmd)
 	struct device *dev;
 	uint64_t max_metadata_size_bytes;
 	int using_hints;
+	int fd_window;
 	int create_hints = 0; /* NEWHINTS_NONE */
 
 	log_debug_devs("Finding devices to scan");
@@ -1043,7 +1436,10 @@ int label_scan(struct cmd_context *cmd)
 	 * search for LVM devs.  The dev cache list either comes from
 	 * looking at dev nodes under /dev, or from udev.
 	 */
-	dev_cache_scan();
+	if (cmd->keep_scan_state)
+		dev_cache_scan_if_changed();
+	else
+		dev_cache_scan();
 
 	/*
 	 * If we know that there will be md components with an end
@@ -1059,6 +1455,12 @@ int label_scan(struct cmd_context *cmd)
 		cmd->use_full_md_check = 1;
 	}
 
+	/*
+	 * Devices excluded by filters in an earlier command, used
+	 * while they are as current as the hints.
+	 */
+	read_filter_cache(cmd);
+
 	/*
 	 * Create a list of all devices in dev-cache (all found on the system.)
 	 * Do not apply filters and do not read any (the filter arg is NULL).
@@ -1080,6 +1482,9 @@ int label_scan(struct cmd_context *cmd)
 		 * so this will usually do nothing.
 		 */
 		label_scan_invalidate(dev);
+
+		/* Metadata copies are verified again by each command. */
+		memset(dev->mda_verified, 0, sizeof(dev->mda_verified));
 	};
 	dev_iter_destroy(iter);
 
@@ -1095,6 +1500,7 @@ int label_scan(struct cmd_context *cmd)
 	log_debug_devs("Filtering devices to scan (nodata)");
 
 	cmd->filter_nodata_only = 1;
+	timing_start(TIMING_FILTERS);
 	dm_list_iterate_items_safe(devl, devl2, &all_devs) {
 		dev = devl->dev;
 		if (!cmd->filter->passes_filter(cmd, cmd->filter, dev, NULL)) {
@@ -1108,6 +1514,7 @@ int label_scan(struct cmd_context *cmd)
 			}
 		}
 	}
+	timing_end(TIMING_FILTERS);
 	cmd->filter_nodata_only = 0;
 
 	dm_list_iterate_items(devl, &all_devs)
@@ -1141,9 +1548,15 @@ int label_scan(struct cmd_context *cmd)
 	 * limit, then increase the soft limit to the hard/max limit
 	 * in case the number of PVs in scan_devs (it's only the PVs
 	 * which we want to keep open) is higher than the current
-	 * soft limit.
+	 * soft limit.  With an fd window only the window is kept open.
 	 */
-	_prepare_open_file_limit(cmd, dm_list_size(&scan_devs));
+	if ((fd_window = find_config_tree_int(cmd, devices_scan_fd_window_CFG, NULL)) > 0)
+		_prepare_open_file_limit(cmd, fd_window);
+	else
+		_prepare_open_file_limit(cmd, dm_list_size(&scan_devs));
+
+	/* A block per device keeps each label block cached for vg_read. */
+	_grow_bcache(MIN_BCACHE_BLOCKS + dm_list_size(&scan_devs), _io_memory_blocks());
 
 	/*
 	 * Do the main scan.
@@ -1151,39 +1564,16 @@ int label_scan(struct cmd_context *cmd)
 	_scan_list(cmd, cmd->filter, &scan_devs, 0, NULL);
 
 	/*
-	 * Metadata could be larger than total size of bcache, and bcache
-	 * cannot currently be resized during the command.  If this is the
-	 * case (or within reach), warn that io_memory_size needs to be
-	 * set larger.
-	 *
-	 * Even if bcache out of space did not cause a failure during scan, it
-	 * may cause a failure during the next vg_read phase or during vg_write.
-	 *
-	 * If there was an error during scan, we could recreate bcache here
-	 * with a larger size and then restart label_scan.  But, this does not
-	 * address the problem of writing new metadata that excedes the bcache
-	 * size and failing, which would often be hit first, i.e. we'll fail
-	 * to write new metadata exceding the max size before we have a chance
-	 * to read any metadata with that size, unless we find an existing vg
-	 * that has been previously created with the larger size.
-	 *
-	 * If the largest metadata is within 1MB of the bcache size, then start
-	 * warning.
+	 * Grow bcache to hold the largest metadata found, with 1MB to
+	 * spare, so the following vg_read and vg_write do not run out of
+	 * blocks.  vg_write reserves again for new metadata it creates.
 	 */
 	max_metadata_size_bytes = lvmcache_max_metadata_size();
 
-	if (max_metadata_size_bytes + (1024 * 1024) > _current_bcache_size_bytes) {
-		/* we want bcache to be 1MB larger than the max metadata seen */
-		uint64_t want_size_kb = (max_metadata_size_bytes / 1024) + 1024;
-		uint64_t remainder;
-		if ((remainder = (want_size_kb % 1024)))
-			want_size_kb = want_size_kb + 1024 - remainder;
-
-		log_warn("WARNING: metadata may not be usable with current io_memory_size %d KiB",
-			 io_memory_size());
-		log_warn("WARNING: increase lvm.conf io_memory_size to at least %llu KiB",
-			 (unsigned long long)want_size_kb);
-	}
+	if (!label_scan_reserve_bcache(max_metadata_size_bytes))
+		log_warn("WARNING: metadata size %llu KiB may not be usable with the maximum io memory %u KiB.",
+			 (unsigned long long)(max_metadata_size_bytes / 1024),
+			 (MAX_BCACHE_BLOCKS * BCACHE_BLOCK_SIZE_BYTES) / 1024);
 
 	dm_list_init(&cmd->hints);
 
@@ -1256,6 +1646,17 @@ int label_scan(struct cmd_context *cmd)
 	return 1;
 }
 
+int label_scan(struct cmd_context *cmd)
+{
+	int r;
+
+	timing_start(TIMING_LABEL_SCAN);
+	r = _label_scan(cmd);
+	timing_end(TIMING_LABEL_SCAN);
+
+	return r;
+}
+
 /*
  * Read the header of the disk and if it's a PV
  * save the pvid in dev->pvid.
@@ -1436,11 +1837,94 @@ void label_scan_drop(struct cmd_context *cmd)
 	dev_iter_destroy(iter);
 }
 
+/*
+ * Close devices and drop their blocks, but keep the bcache and its io
+ * engine for the next command run by the same process.
+ */
+void label_scan_release(struct cmd_context *cmd)
+{
+	struct dev_iter *iter;
+	struct device *dev;
+
+	if (!scan_bcache)
+		return;
+
+	if (!(iter = dev_iter_create(NULL, 0))) {
+		label_scan_destroy(cmd);
+		return;
+	}
+
+	while ((dev = dev_iter_get(cmd, iter)))
+		label_scan_invalidate(dev);
+	dev_iter_destroy(iter);
+
+	_window_exit();
+}
+
 /*
  * Close devices that are open because bcache is holding blocks for them.
  * Destroy the bcache.
  */
 
+static void _format_latency(char *buf, size_t len, const uint64_t *hist)
+{
+	int i, r;
+
+	buf[0] = '\0';
+
+	/* Bucket i holds io that took under 2^i us. */
+	for (i = 0; i < BCACHE_LATENCY_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		r = snprintf(buf, len, " <%lluus:%llu", 1ULL << i, (unsigned long long)hist[i]);
+		if (r < 0 || (size_t) r >= len)
+			return;
+		buf += r;
+		len -= r;
+	}
+}
+
+static void _log_io_stats(struct cmd_context *cmd)
+{
+	struct bcache_stats st;
+	char rd_lat[512], wr_lat[512];
+	int print = cmd && find_config_tree_bool(cmd, log_io_stats_CFG, NULL);
+
+	bcache_get_stats(scan_bcache, &st);
+
+	_format_latency(rd_lat, sizeof(rd_lat), st.read_latency);
+	_format_latency(wr_lat, sizeof(wr_lat), st.write_latency);
+
+#define _IO_STATS_LOG(fmt, args...) \
+	do { \
+		if (print) \
+			log_print_unless_silent(fmt, ## args); \
+		else \
+			log_debug_io(fmt, ## args); \
+	} while (0)
+
+	_IO_STATS_LOG("IO stats: read hits %llu misses %llu, write hits %llu misses %llu zeroes %llu",
+		      (unsigned long long)st.read_hits, (unsigned long long)st.read_misses,
+		      (unsigned long long)st.write_hits, (unsigned long long)st.write_misses,
+		      (unsigned long long)st.write_zeroes);
+	_IO_STATS_LOG("IO stats: prefetches %llu prefetch hits %llu evictions %llu writebacks %llu errors %llu",
+		      (unsigned long long)st.prefetches, (unsigned long long)st.prefetch_hits,
+		      (unsigned long long)st.evictions, (unsigned long long)st.writebacks,
+		      (unsigned long long)st.io_errors);
+	if (st.head_prefetches)
+		_IO_STATS_LOG("IO stats: head prefetches %llu reread in full %llu",
+			      (unsigned long long)st.head_prefetches,
+			      (unsigned long long)st.head_rereads);
+	_IO_STATS_LOG("IO stats: reads %llu (%llu bytes) writes %llu (%llu bytes)",
+		      (unsigned long long)st.reads_issued, (unsigned long long)st.bytes_read,
+		      (unsigned long long)st.writes_issued, (unsigned long long)st.bytes_written);
+	if (st.reads_issued)
+		_IO_STATS_LOG("IO stats: read latency%s", rd_lat);
+	if (st.writes_issued)
+		_IO_STATS_LOG("IO stats: write latency%s", wr_lat);
+#undef _IO_STATS_LOG
+}
+
 void label_scan_destroy(struct cmd_context *cmd)
 {
 	if (!scan_bcache)
@@ -1448,8 +1932,12 @@ void label_scan_destroy(struct cmd_context *cmd)
 
 	label_scan_drop(cmd);
 
+	_log_io_stats(cmd);
+
 	bcache_destroy(scan_bcache);
 	scan_bcache = NULL;
+
+	_window_exit();
 }
 
 /*
@@ -1593,7 +2081,7 @@ int label_scan_reopen_rw(struct device *dev)
 	return 1;
 }
 
-bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data)
+static bool _dev_read_prepare(struct device *dev, uint64_t start, size_t len)
 {
 	if (!scan_bcache) {
 		/* Should not happen */
@@ -1602,13 +2090,78 @@ bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 	}
 
 	if (dev->bcache_di < 0) {
-		/* This is not often needed. */
+		/* This is not often needed, unless using an fd window. */
 		if (!label_scan_open(dev)) {
 			log_error("Error opening device %s for reading at %llu length %u.",
 				  dev_name(dev), (unsigned long long)start, (uint32_t)len);
 			return false;
 		}
+		_window_add(dev);
+	}
+
+	return true;
+}
+
+/*
+ * Pass the bytes to fn in pieces straight from bcache blocks,
+ * avoiding the copy dev_read_bytes() makes.
+ */
+bool dev_walk_bytes(struct device *dev, uint64_t start, size_t len,
+		    bcache_bytes_fn fn, void *context)
+{
+	if (!_dev_read_prepare(dev, start, len))
+		return false;
+
+	if (!bcache_walk_bytes(scan_bcache, dev->bcache_di, start, len, fn, context)) {
+		log_error("Error reading device %s at %llu length %u.",
+			  dev_name(dev), (unsigned long long)start, (uint32_t)len);
+		label_scan_invalidate(dev);
+		return false;
 	}
+	return true;
+}
+
+/*
+ * Pin the bcache block holding the bytes and return a pointer to them.
+ * Only possible when the bytes do not cross a block boundary; returns
+ * NULL quietly otherwise, and callers fall back to dev_read_bytes().
+ * Release with dev_put_bytes().
+ */
+const void *dev_get_bytes(struct device *dev, uint64_t start, size_t len,
+			  struct block **b)
+{
+	const void *data;
+
+	if (!scan_bcache || (dev->bcache_di < 0))
+		return NULL;
+
+	if (!bcache_get_bytes(scan_bcache, dev->bcache_di, start, len, b, &data))
+		return NULL;
+
+	return data;
+}
+
+void dev_put_bytes(struct block *b)
+{
+	bcache_put(b);
+}
+
+/*
+ * Start reading the bytes into bcache without waiting for them.
+ * Devices that are not open are skipped; a later read opens them.
+ */
+void dev_prefetch_bytes(struct device *dev, uint64_t start, size_t len)
+{
+	if (!scan_bcache || (dev->bcache_di < 0))
+		return;
+
+	bcache_prefetch_bytes(scan_bcache, dev->bcache_di, start, len);
+}
+
+bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data)
+{
+	if (!_dev_read_prepare(dev, start, len))
+		return false;
 
 	if (!bcache_read_bytes(scan_bcache, dev->bcache_di, start, len, data)) {
 		log_error("Error reading device %s at %llu length %u.",
@@ -1620,6 +2173,97 @@ bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 
 }
 
+/*
+ * Metadata written to many devices is issued as one batch.  Between
+ * dev_write_batch_begin() and dev_write_batch_end(), dev_write_bytes()
+ * and dev_set_bytes() issue their writes through the io engine without
+ * waiting for them, so writes to all the devices are in flight together.
+ * Each write is still issued while its last byte limit is set.  The end
+ * waits for the whole batch; dev_write_batch_failed() then tells which
+ * devices had a write fail.
+ */
+struct write_batch_dev {
+	struct device *dev;
+	int failed;
+};
+
+static int _write_batch_active;
+static struct write_batch_dev *_write_batch_devs;
+static unsigned _write_batch_count;
+static unsigned _write_batch_alloc;
+
+void dev_write_batch_begin(void)
+{
+	_write_batch_active = 1;
+	_write_batch_count = 0;
+}
+
+static bool _write_batch_add(struct device *dev)
+{
+	struct write_batch_dev *new_devs;
+	unsigned i;
+
+	bcache_issue_writes(scan_bcache);
+
+	for (i = 0; i < _write_batch_count; i++)
+		if (_write_batch_devs[i].dev == dev)
+			return true;
+
+	if (_write_batch_count == _write_batch_alloc) {
+		if (!(new_devs = realloc(_write_batch_devs, sizeof(*new_devs) * (_write_batch_alloc + 64)))) {
+			/* Without a record of the device, wait for it now. */
+			log_debug("Writing %s outside batch.", dev_name(dev));
+			return bcache_wait_writes(scan_bcache);
+		}
+		_write_batch_devs = new_devs;
+		_write_batch_alloc += 64;
+	}
+
+	_write_batch_devs[_write_batch_count].dev = dev;
+	_write_batch_devs[_write_batch_count].failed = 0;
+	_write_batch_count++;
+
+	return true;
+}
+
+bool dev_write_batch_end(void)
+{
+	struct device *dev;
+	bool r = true;
+	unsigned i;
+
+	if (!_write_batch_active)
+		return true;
+
+	_write_batch_active = 0;
+
+	if (!_write_batch_count || bcache_wait_writes(scan_bcache))
+		return true;
+
+	for (i = 0; i < _write_batch_count; i++) {
+		dev = _write_batch_devs[i].dev;
+		if (!bcache_has_write_errors(scan_bcache, dev->bcache_di))
+			continue;
+		log_error("Error writing device %s.", dev_name(dev));
+		_write_batch_devs[i].failed = 1;
+		label_scan_invalidate(dev);
+		r = false;
+	}
+
+	return r;
+}
+
+bool dev_write_batch_failed(struct device *dev)
+{
+	unsigned i;
+
+	for (i = 0; i < _write_batch_count; i++)
+		if (_write_batch_devs[i].dev == dev)
+			return _write_batch_devs[i].failed ? true : false;
+
+	return false;
+}
+
 bool dev_write_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 {
 	if (test_mode())
@@ -1659,6 +2303,9 @@ bool dev_write_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 		return false;
 	}
 
+	if (_write_batch_active)
+		return _write_batch_add(dev);
+
 	if (!bcache_flush(scan_bcache)) {
 		log_error("Error writing device %s at %llu length %u.",
 			  dev_name(dev), (unsigned long long)start, (uint32_t)len);
@@ -1721,6 +2368,12 @@ bool dev_set_bytes(struct device *dev, uint64_t start, size_t len, uint8_t val)
 		goto fail;
 	}
 
+	if (_write_batch_active) {
+		rv = _write_batch_add(dev);
+		dev_unset_last_byte(dev);
+		return rv;
+	}
+
 	if (!bcache_flush(scan_bcache)) {
 		log_error("Error writing device %s at %llu length %u.",
 			  dev_name(dev), (unsigned long long)start, (uint32_t)len);
@@ -67,6 +67,13 @@ struct label_ops {
 	int (*read) (struct cmd_context *cmd, struct labeller * l, struct device * dev,
 		     void *label_buf, uint64_t label_sector, int *is_duplicate);
 
+	/*
+	 * Optionally start reading what read() will need, given the
+	 * scanned block holding the label.
+	 */
+	void (*prefetch) (struct labeller * l, struct device * dev,
+			  const char *block, size_t block_size, void *label_buf);
+
 	/*
 	 * Populate label_type etc.
 	 */
@@ -112,8 +119,10 @@ void label_scan_invalidate(struct device *dev);
 void label_scan_invalidate_lv(struct cmd_context *cmd, struct logical_volume *lv);
 void label_scan_drop(struct cmd_context *cmd);
 void label_scan_destroy(struct cmd_context *cmd);
+void label_scan_release(struct cmd_context *cmd);
 void label_scan_confirm(struct device *dev);
 int label_scan_setup_bcache(void);
+int label_scan_reserve_bcache(uint64_t metadata_bytes);
 int label_scan_open(struct device *dev);
 int label_scan_open_excl(struct device *dev);
 int label_scan_open_rw(struct device *dev);
@@ -127,9 +136,18 @@ int label_scan_for_pvid(struct cmd_context *cmd, char *pvid, struct device **dev
  * (these make it easier to disable bcache and revert to direct rw if needed)
  */
 bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data);
+bool dev_walk_bytes(struct device *dev, uint64_t start, size_t len,
+		    bcache_bytes_fn fn, void *context);
+const void *dev_get_bytes(struct device *dev, uint64_t start, size_t len,
+			  struct block **b);
+void dev_put_bytes(struct block *b);
+void dev_prefetch_bytes(struct device *dev, uint64_t start, size_t len);
 bool dev_write_bytes(struct device *dev, uint64_t start, size_t len, void *data);
 bool dev_write_zeros(struct device *dev, uint64_t start, size_t len);
 bool dev_set_bytes(struct device *dev, uint64_t start, size_t len, uint8_t val);
+void dev_write_batch_begin(void);
+bool dev_write_batch_end(void);
+bool dev_write_batch_failed(struct device *dev);
 bool dev_invalidate_bytes(struct device *dev, uint64_t start, size_t len);
 void dev_set_last_byte(struct device *dev, uint64_t offset);
 void dev_unset_last_byte(struct device *dev);
@@ -18,12 +18,15 @@
 #include "lib/locking/lvmlockd.h"
 #include "locking_types.h"
 #include "lib/misc/lvm-string.h"
+#include "lib/device/dev-type.h"
 #include "lib/activate/activate.h"
 #include "lib/commands/toolcontext.h"
 #include "lib/mm/memlock.h"
 #include "lib/config/defaults.h"
 #include "lib/cache/lvmcache.h"
 #include "lib/misc/lvm-signal.h"
+#include "lib/log/timing.h"
+#include "lib/format_text/archiver.h"
 
 #include <assert.h>
 #include <sys/stat.h>
@@ -70,7 +73,8 @@ void reset_locking(void)
 static void _update_vg_lock_count(const char *resource, uint32_t flags)
 {
 	/* Ignore locks not associated with updating VG metadata */
-	if (!strcmp(resource, VG_GLOBAL))
+	if (!strcmp(resource, VG_GLOBAL) ||
+	    !strncmp(resource, VG_DEVICE, sizeof(VG_DEVICE) - 1))
 		return;
 
 	if ((flags & LCK_TYPE_MASK) == LCK_UNLOCK)
@@ -179,11 +183,15 @@ void fin_locking(struct cmd_context *cmd)
  */
 static int _lock_vol(struct cmd_context *cmd, const char *resource, uint32_t flags)
 {
-	int ret = 0;
+	int ret;
 
 	block_signals(flags);
 
-	if ((ret = _locking.lock_resource(cmd, resource, flags, NULL)))
+	timing_start(TIMING_LOCKING);
+	ret = _locking.lock_resource(cmd, resource, flags, NULL);
+	timing_end(TIMING_LOCKING);
+
+	if (ret)
 		/* ensure signals are blocked while VG_GLOBAL lock is held */
 		_update_vg_lock_count(resource, flags);
 	else
@@ -198,11 +206,16 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 {
 	char resource[258] __attribute__((aligned(8)));
 	uint32_t lck_type = flags & LCK_TYPE_MASK;
-	int is_global = !strcmp(vol, VG_GLOBAL);
+	int is_global = !strcmp(vol, VG_GLOBAL) ||
+		!strncmp(vol, VG_DEVICE, sizeof(VG_DEVICE) - 1);
 
 	if (is_orphan_vg(vol))
 		return 1;
 
+	/* Write backups queued under this lock before anyone else may commit */
+	if ((lck_type == LCK_UNLOCK) && !is_global && !backup_flush(cmd, vol))
+		stack;
+
 	if (!_blocking_supported)
 		flags |= LCK_NONBLOCK;
 
@@ -331,6 +344,13 @@ int vg_write_lock_held(void)
 int sync_local_dev_names(struct cmd_context* cmd)
 {
 	memlock_unlock(cmd);
+
+	/* Leave udev events on the cookie for the wait at the end of the command */
+	if (cmd->udev_sync_deferred) {
+		log_debug_activation("Deferring sync of device names.");
+		return 1;
+	}
+
 	fs_unlock();
 	return 1;
 }
@@ -433,3 +453,45 @@ int lock_global_convert(struct cmd_context *cmd, const char *mode)
 
 	return 1;
 }
+
+static int _cmp_devt(const void *a, const void *b)
+{
+	dev_t d1 = (*(struct device * const *) a)->dev;
+	dev_t d2 = (*(struct device * const *) b)->dev;
+
+	return (d1 > d2) - (d1 < d2);
+}
+
+/*
+ * Per-device locks, P_dev_<major>_<minor>, taken ex by pvcreate and
+ * pvremove for the devices they change while they hold the global lock
+ * sh, so that commands changing different orphan devices run in
+ * parallel.  Commands changing orphans together with VGs still take the
+ * global lock ex, which excludes all of these.  The devs are sorted
+ * (and reordered in place) and locked by devno to avoid deadlocks.
+ * The locks are released with the other file locks by fin_locking().
+ */
+int lockf_devices(struct cmd_context *cmd, struct device **devs, unsigned count)
+{
+	char resource[64];
+	unsigned i;
+
+	qsort(devs, count, sizeof(*devs), _cmp_devt);
+
+	for (i = 0; i < count; i++) {
+		/* The same device may be named by more than one arg */
+		if (i && (devs[i]->dev == devs[i - 1]->dev))
+			continue;
+
+		if (dm_snprintf(resource, sizeof(resource), VG_DEVICE "%d_%d",
+				(int) MAJOR(devs[i]->dev), (int) MINOR(devs[i]->dev)) < 0)
+			return_0;
+
+		if (!lock_vol(cmd, resource, LCK_WRITE, NULL)) {
+			log_error("Can't get lock for device %s.", dev_name(devs[i]));
+			return 0;
+		}
+	}
+
+	return 1;
+}
@@ -49,6 +49,7 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 
 #define VG_ORPHANS	"#orphans"
 #define VG_GLOBAL	"#global"
+#define VG_DEVICE	"#dev_"		/* Prefix of per-device locks */
 
 #define LCK_VG_READ		LCK_READ
 #define LCK_VG_WRITE		LCK_WRITE
@@ -58,7 +59,10 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 	do { \
 		if (is_real_vg(vol) && !sync_local_dev_names(cmd)) \
 			stack; \
-		if (!lock_vol(cmd, vol, LCK_VG_UNLOCK, NULL)) \
+		if (vg) \
+			discard_pending_pv_areas(vg); \
+		if (!vg_read_without_lock(vg) && \
+		    !lock_vol(cmd, vol, LCK_VG_UNLOCK, NULL)) \
 			stack;	\
 	} while (0)
 #define unlock_and_release_vg(cmd, vg, vol) \
@@ -69,8 +73,11 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 
 int sync_local_dev_names(struct cmd_context* cmd);
 
-/* Process list of LVs */
 struct volume_group;
+int vg_read_without_lock(const struct volume_group *vg);
+void discard_pending_pv_areas(struct volume_group *vg);
+
+/* Process list of LVs */
 int activate_lvs(struct cmd_context *cmd, struct dm_list *lvs, unsigned exclusive);
 
 int lockf_global(struct cmd_context *cmd, const char *mode);
@@ -79,4 +86,7 @@ int lockf_global_nonblock(struct cmd_context *cmd, const char *mode);
 int lock_global(struct cmd_context *cmd, const char *mode);
 int lock_global_convert(struct cmd_context *cmd, const char *mode);
 
+struct device;
+int lockf_devices(struct cmd_context *cmd, struct device **devs, unsigned count);
+
 #endif
@@ -15,6 +15,7 @@
 #include "lib/activate/activate.h"
 #include "lib/locking/lvmlockd.h"
 #include "lib/cache/lvmcache.h"
+#include "lib/log/timing.h"
 #include "daemons/lvmlockd/lvmlockd-client.h"
 
 #include <mntent.h>
@@ -24,6 +25,8 @@ static const char *_lvmlockd_socket = NULL;
 static int _use_lvmlockd = 0;         /* is 1 if command is configured to use lvmlockd */
 static int _lvmlockd_connected = 0;   /* is 1 if command is connected to lvmlockd */
 static int _lvmlockd_init_failed = 0; /* used to suppress further warnings */
+static int _lvmlockd_lock_lv_batch = -1; /* lvmlockd takes lock_lv_batch, -1 until asked */
+static struct dm_hash_table *_lv_batch_locked = NULL; /* lv uuid -> mode locked by lockd_lv_batch */
 
 void lvmlockd_set_socket(const char *sock)
 {
@@ -101,6 +104,12 @@ void lvmlockd_disconnect(void)
 	if (_lvmlockd_connected)
 		daemon_close(_lvmlockd);
 	_lvmlockd_connected = 0;
+	_lvmlockd_lock_lv_batch = -1;
+
+	if (_lv_batch_locked) {
+		dm_hash_destroy(_lv_batch_locked);
+		_lv_batch_locked = NULL;
+	}
 }
 
 /* Translate the result strings from lvmlockd to bit flags. */
@@ -190,13 +199,87 @@ static daemon_reply _lockd_send(const char *req_name, ...)
 	daemon_request_extend_v(req, ap);
 	va_end(ap);
 
+	timing_start(TIMING_LOCKING);
 	repl = daemon_send(_lvmlockd, req);
+	timing_end(TIMING_LOCKING);
 
 	daemon_request_destroy(req);
 
 	return repl;
 }
 
+/*
+ * The lock_lv_batch reply carries a result for each LV, which is read in
+ * one pass over the reply text rather than by looking up lv_results/lv<N>
+ * in a parsed config tree, a search per LV.  Like _lockd_result, returns
+ * 0 when no op_result could be obtained.
+ */
+static int _lockd_batch_result(daemon_reply reply, int *result,
+			       int count, int64_t *results)
+{
+	struct config_scan scan;
+	enum config_scan_item item;
+	const char *key, *value;
+	int64_t reply_result = NO_LOCKD_RESULT;
+	int response_ok = 0, in_results = 0;
+	char *end;
+	long idx;
+
+	*result = -1;
+
+	if (reply.error) {
+		log_error("lockd_result reply error %d", reply.error);
+		return 0;
+	}
+
+	config_scan_init(&scan, reply.buffer.mem, reply.buffer.used);
+
+	while ((item = config_scan_next(&scan, &key, &value)) != CONFIG_SCAN_END) {
+		switch (item) {
+		case CONFIG_SCAN_ERROR:
+			log_error("lockd_result cannot read reply");
+			return 0;
+		case CONFIG_SCAN_SECTION:
+			in_results = (scan.depth == 1) && !strcmp(key, "lv_results");
+			break;
+		case CONFIG_SCAN_SECTION_END:
+			in_results = 0;
+			break;
+		case CONFIG_SCAN_VALUE:
+			if (in_results) {
+				if (strncmp(key, "lv", 2))
+					break;
+				idx = strtol(key + 2, &end, 10);
+				if (!*end && (idx >= 0) && (idx < count))
+					results[idx] = strtoll(value, NULL, 10);
+			} else if (scan.depth)
+				break;
+			else if (!strcmp(key, "response"))
+				response_ok = !strcmp(value, "OK");
+			else if (!strcmp(key, "op_result"))
+				reply_result = strtoll(value, NULL, 10);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!response_ok) {
+		log_error("lockd_result bad response");
+		return 0;
+	}
+
+	if (reply_result == NO_LOCKD_RESULT) {
+		log_error("lockd_result no op_result");
+		return 0;
+	}
+
+	*result = (int) reply_result;
+
+	log_debug("lockd_result %d for batch of %d", *result, count);
+	return 1;
+}
+
 /*
  * result/lockd_flags are values returned from lvmlockd.
  *
@@ -217,6 +300,9 @@ static daemon_reply _lockd_send(const char *req_name, ...)
  * indicate a locking failure.
  */
 
+/* The VG seqno returned by the last lock_vg, 0 if not known */
+static uint32_t _lock_vg_version;
+
 static int _lockd_request(struct cmd_context *cmd,
 		          const char *req_name,
 		          const char *vg_name,
@@ -284,8 +370,10 @@ static int _lockd_request(struct cmd_context *cmd,
 		if (!_lockd_result(reply, result, lockd_flags))
 			goto fail;
 
-		log_debug("lvmlockd %s %s vg %s result %d %x",
-			  req_name, mode, vg_name, *result, *lockd_flags);
+		_lock_vg_version = (uint32_t) daemon_reply_int(reply, "vg_version", 0);
+
+		log_debug("lvmlockd %s %s vg %s result %d %x version %u",
+			  req_name, mode, vg_name, *result, *lockd_flags, _lock_vg_version);
 
 	} else {
 		reply = _lockd_send(req_name,
@@ -1233,10 +1321,19 @@ out:
 	return ret;
 }
 
+/*
+ * The lockspaces requested by start_vg are all started in parallel by
+ * lvmlockd, each by its own thread, so waiting here takes about as long
+ * as the slowest of them.  The progress opt makes lvmlockd reply at once
+ * with the number of lockspaces still starting, which is repeated each
+ * second to report progress.  An lvmlockd without the opt simply waits
+ * for all of them and replies 0.
+ */
 int lockd_start_wait(struct cmd_context *cmd)
 {
 	daemon_reply reply;
 	int result;
+	int last = 0;
 	int ret;
 
 	if (!_use_lvmlockd)
@@ -1244,8 +1341,10 @@ int lockd_start_wait(struct cmd_context *cmd)
 	if (!_lvmlockd_connected)
 		return 0;
 
+ req:
 	reply = _lockd_send("start_wait",
 			"pid = " FMTd64, (int64_t) getpid(),
+			"opts = %s", "progress",
 			NULL);
 
 	if (!_lockd_result(reply, &result, NULL)) {
@@ -1254,6 +1353,17 @@ int lockd_start_wait(struct cmd_context *cmd)
 		ret = (result < 0) ? 0 : 1;
 	}
 
+	if (ret && (result > 0)) {
+		daemon_reply_destroy(reply);
+
+		if (result != last)
+			log_print_unless_silent("Waiting for %d lockspace%s to start.",
+						result, (result > 1) ? "s" : "");
+		last = result;
+		sleep(1);
+		goto req;
+	}
+
 	if (!ret)
 		log_error("Lock start failed");
 
@@ -1902,6 +2012,7 @@ int lockd_vg(struct cmd_context *cmd, const char *vg_name, const char *def_mode,
 	 * Normal success.
 	 */
 	if (!result) {
+		lvmcache_set_lockd_seqno(vg_name, strcmp(mode, "un") ? _lock_vg_version : 0);
 		ret = 1;
 		goto out;
 	}
@@ -2185,6 +2296,17 @@ int lockd_lv_name(struct cmd_context *cmd, struct volume_group *vg,
 	if (flags & LDLV_PERSISTENT)
 		opts = "persistent";
 
+	if (_lv_batch_locked) {
+		const char *batch_mode = dm_hash_lookup(_lv_batch_locked, lv_uuid);
+
+		if (!strcmp(mode, "un"))
+			dm_hash_remove(_lv_batch_locked, lv_uuid);
+		else if (batch_mode && !strcmp(batch_mode, mode)) {
+			log_debug("lockd LV %s/%s mode %s already locked by batch", vg->name, lv_name, mode);
+			return 1;
+		}
+	}
+
  retry:
 	log_debug("lockd LV %s/%s mode %s uuid %s", vg->name, lv_name, mode, lv_uuid);
 
@@ -2429,6 +2551,191 @@ int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 			     lv->lock_args, def_mode, flags);
 }
 
+/*
+ * Find the lock that lockd_lv would take for activating lv, for the
+ * simple cases only: an LV with its own lock, or the pool lock of a thin
+ * LV.  Anything else, or anything lv_change_activate may refuse, is left
+ * out and goes through lockd_lv on its own.
+ */
+static struct logical_volume *_lockd_lv_batch_lock(struct logical_volume *lv, const char *mode)
+{
+	if (lv_is_cache_pool(lv) || lv_is_merging_origin(lv) ||
+	    lv_is_vdo_type(lv) || lv_is_cache_vol(lv) ||
+	    lv_has_integrity_recalculate_metadata(lv))
+		return NULL;
+
+	if (lv_is_thin_volume(lv))
+		lv = first_seg(lv) ? first_seg(lv)->pool_lv : NULL;
+	else if (!lv_is_thin_pool(lv) && lv_is_thin_type(lv))
+		return NULL;
+
+	if (!lv || !lv->lock_args)
+		return NULL;
+
+	/* lockd_lv reports these as errors */
+	if (!strcmp(mode, "sh") &&
+	    (lv_is_external_origin(lv) || lv_is_thin_type(lv) ||
+	     lv_is_mirror_type(lv) || lv_is_raid_type(lv) ||
+	     lv_is_cache_type(lv)))
+		return NULL;
+
+	return lv;
+}
+
+static int _lockd_lv_batch_supported(void)
+{
+	daemon_reply reply;
+
+	if (_lvmlockd_lock_lv_batch < 0) {
+		reply = _lockd_send("hello", NULL);
+		_lvmlockd_lock_lv_batch = !reply.error &&
+			(daemon_reply_int(reply, "lock_lv_batch", 0) > 0);
+		daemon_reply_destroy(reply);
+		log_debug("lvmlockd %s lock_lv_batch", _lvmlockd_lock_lv_batch ? "supports" : "does not support");
+	}
+
+	return _lvmlockd_lock_lv_batch;
+}
+
+/*
+ * Acquire the LV locks needed to activate the LVs on the list with one
+ * lock_lv_batch request instead of a lock_lv round trip per LV.  This only
+ * saves work for the lockd_lv calls that follow during activation, which
+ * find the lock already held.  LVs that could not be locked here are left
+ * for lockd_lv, which retries them and reports any error.
+ */
+int lockd_lv_batch(struct cmd_context *cmd, struct dm_list *lvs,
+		   const char *def_mode, uint32_t flags)
+{
+	const char *cmd_name = get_cmd_name();
+	const char *mode = def_mode ? : "ex";
+	struct dm_hash_table *pending;
+	struct logical_volume *lock_lv;
+	struct volume_group *vg;
+	struct lv_list *lvl;
+	struct buffer block;
+	daemon_request req = { .cft = NULL };
+	daemon_reply reply;
+	const char **uuids;
+	int64_t *results;
+	char lv_uuid[64] __attribute__((aligned(8)));
+	char name[16];
+	int count = 0, locked = 0;
+	int result;
+	int i, r = 0;
+
+	if (dm_list_empty(lvs))
+		return 1;
+
+	buffer_init(&block);
+
+	vg = dm_list_item(dm_list_first(lvs), struct lv_list)->lv->vg;
+
+	if (!vg_is_shared(vg) || !_use_lvmlockd || !_lvmlockd_connected ||
+	    cmd->lockd_lv_disable || cmd->metadata_read_only)
+		return 1;
+
+	if (!_lockd_lv_batch_supported())
+		return 1;
+
+	if (!_lv_batch_locked && !(_lv_batch_locked = dm_hash_create(128)))
+		return_0;
+
+	if (!(pending = dm_hash_create(128)))
+		return_0;
+
+	if (!(uuids = dm_pool_alloc(cmd->mem, dm_list_size(lvs) * sizeof(*uuids))) ||
+	    !(results = dm_pool_alloc(cmd->mem, dm_list_size(lvs) * sizeof(*results))))
+		goto_out;
+
+	if (!cmd_name || !cmd_name[0])
+		cmd_name = "none";
+
+	/* The request is written out directly, it grows with the LV count */
+	if (!buffer_append_key_str(&block, "request", "lock_lv_batch") ||
+	    !buffer_append_key_str(&block, "cmd", cmd_name) ||
+	    !buffer_append_key_int(&block, "pid", getpid()) ||
+	    !buffer_append_key_str(&block, "mode", mode) ||
+	    !buffer_append_key_str(&block, "opts", (flags & LDLV_PERSISTENT) ? "persistent" : "none") ||
+	    !buffer_append_key_str(&block, "vg_name", vg->name) ||
+	    !buffer_append_key_str(&block, "vg_lock_type", vg->lock_type ?: "none") ||
+	    !buffer_append_key_str(&block, "vg_lock_args", vg->lock_args ?: "none") ||
+	    !buffer_append_section(&block, "lvs"))
+		goto_out;
+
+	dm_list_iterate_items(lvl, lvs) {
+		if (!(lock_lv = _lockd_lv_batch_lock(lvl->lv, mode)))
+			continue;
+
+		if (!id_write_format(&lock_lv->lvid.id[1], lv_uuid, sizeof(lv_uuid)))
+			goto_out;
+
+		/* Thin LVs in one pool share its lock */
+		if (dm_hash_lookup(pending, lv_uuid) || dm_hash_lookup(_lv_batch_locked, lv_uuid))
+			continue;
+
+		if (!(uuids[count] = dm_pool_strdup(cmd->mem, lv_uuid)) ||
+		    !dm_hash_insert(pending, lv_uuid, (void *) uuids[count]))
+			goto_out;
+
+		if ((dm_snprintf(name, sizeof(name), "lv%d", count) < 0) ||
+		    !buffer_append_section(&block, name) ||
+		    !buffer_append_key_str(&block, "lv_name", lock_lv->name) ||
+		    !buffer_append_key_str(&block, "lv_uuid", lv_uuid) ||
+		    !buffer_append_key_str(&block, "lv_lock_args", lock_lv->lock_args ?: "none") ||
+		    !buffer_append_section_end(&block))
+			goto_out;
+
+		results[count++] = NO_LOCKD_RESULT;
+	}
+
+	if (!buffer_append_section_end(&block))
+		goto_out;
+
+	if (count < 2) {
+		/* Nothing to gain over lockd_lv */
+		r = 1;
+		goto out;
+	}
+
+	log_debug("lockd LV batch of %d in VG %s mode %s", count, vg->name, mode);
+
+	req.buffer = block;
+
+	timing_start(TIMING_LOCKING);
+	reply = daemon_send_raw(_lvmlockd, req);
+	timing_end(TIMING_LOCKING);
+
+	if (!_lockd_batch_result(reply, &result, count, results) || (result < 0)) {
+		log_debug("lvmlockd lock_lv_batch failed, locking LVs one by one.");
+		daemon_reply_destroy(reply);
+		r = 1;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (results[i] && (results[i] != -EALREADY)) {
+			log_debug("lockd LV uuid %s batch result " FMTd64, uuids[i], results[i]);
+			continue;
+		}
+
+		if (!dm_hash_insert(_lv_batch_locked, uuids[i], (void *) (!strcmp(mode, "sh") ? "sh" : "ex")))
+			break;
+		locked++;
+	}
+
+	daemon_reply_destroy(reply);
+
+	log_debug("lockd LV batch locked %d of %d in VG %s", locked, count, vg->name);
+
+	r = 1;
+out:
+	buffer_destroy(&block);
+	dm_hash_destroy(pending);
+
+	return r;
+}
+
 /*
  * Check if the LV being resized is used by gfs2/ocfs2 which we
  * know allow resizing under a shared lock.
@@ -83,6 +83,8 @@ int lockd_lv_name(struct cmd_context *cmd, struct volume_group *vg,
 		  const char *lock_args, const char *def_mode, uint32_t flags);
 int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags);
+int lockd_lv_batch(struct cmd_context *cmd, struct dm_list *lvs,
+		   const char *def_mode, uint32_t flags);
 int lockd_lv_resize(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags, struct lvresize_params *lp);
 
@@ -213,6 +215,12 @@ static inline int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	return 1;
 }
 
+static inline int lockd_lv_batch(struct cmd_context *cmd, struct dm_list *lvs,
+		   const char *def_mode, uint32_t flags)
+{
+	return 1;
+}
+
 static inline int lockd_lv_resize(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags, struct lvresize_params *lp)
 {
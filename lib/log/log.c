@@ -41,6 +41,24 @@ static int _abort_on_internal_errors_config = 0;
 static uint32_t _debug_file_fields;
 static uint32_t _debug_output_fields;
 
+/*
+ * Optional ring buffer holding log file messages until flushed.
+ * Records are a struct log_record followed by the message text and
+ * may wrap around the end of the buffer.
+ */
+struct log_record {
+	struct timespec ts;
+	const char *file;
+	int line;
+	unsigned len;		/* Message length without '\0' */
+};
+
+static char *_log_buffer;
+static size_t _log_buffer_size;
+static size_t _log_buffer_head;		/* Oldest record */
+static size_t _log_buffer_used;
+static unsigned _log_buffer_dropped;
+
 static lvm2_log_fn_t _lvm2_log_fn = NULL;
 
 static int _lvm_errno = 0;
@@ -331,6 +349,7 @@ int log_suppress(int suppress)
 void fin_log(void)
 {
 	if (_log_to_file) {
+		log_flush_buffer();
 		if (dm_fclose(_log_file)) {
 			if (errno)
 			      fprintf(err_stream, "failed to write log file: %s\n",
@@ -455,24 +474,27 @@ void init_debug_output_fields(uint32_t debug_fields)
 	_debug_output_fields = debug_fields;
 }
 
-static void _set_time_prefix(char *prefix, int buflen)
+static void _set_time_prefix(char *prefix, int buflen, const struct timespec *ts)
 {
 
-	struct timespec ts;
+	struct timespec now;
 	struct tm time_info;
 	int len;
 
-	if (clock_gettime(CLOCK_REALTIME, &ts) < 0)
-		goto fail;
+	if (!ts) {
+		if (clock_gettime(CLOCK_REALTIME, &now) < 0)
+			goto fail;
+		ts = &now;
+	}
 
-	if (!localtime_r(&ts.tv_sec, &time_info))
+	if (!localtime_r(&ts->tv_sec, &time_info))
 		goto fail;
 
 	len = strftime(prefix, buflen, "%H:%M:%S", &time_info);
 	if (!len)
 		goto fail;
 
-	len = dm_snprintf(prefix + len, buflen - len, ".%ld ", ts.tv_nsec/1000);
+	len = dm_snprintf(prefix + len, buflen - len, ".%ld ", ts->tv_nsec/1000);
 	if (len < 0)
 		goto fail;
 
@@ -482,6 +504,125 @@ fail:
 	*prefix = '\0';
 }
 
+static void _write_log_file_line(const struct timespec *ts, const char *file, int line,
+				 const char *message)
+{
+	char time_prefix[32] = "";
+	const char *command_prefix = NULL;
+
+	if (!_debug_file_fields || (_debug_file_fields & LOG_DEBUG_FIELD_TIME))
+		_set_time_prefix(time_prefix, sizeof(time_prefix), ts);
+
+	if (!_debug_file_fields || (_debug_file_fields & LOG_DEBUG_FIELD_COMMAND))
+		command_prefix = log_command_file();
+
+	if (!_debug_file_fields || (_debug_file_fields & LOG_DEBUG_FIELD_FILELINE))
+		fprintf(_log_file, "%s%s %s:%d%s%s\n", time_prefix, command_prefix ?: "", file, line, _msg_prefix, message);
+	else
+		fprintf(_log_file, "%s%s %s%s\n", time_prefix, command_prefix ?: "", _msg_prefix, message);
+}
+
+static void _log_buffer_copy_in(const void *src, size_t len)
+{
+	size_t tail = (_log_buffer_head + _log_buffer_used) % _log_buffer_size;
+	size_t part = min(len, _log_buffer_size - tail);
+
+	memcpy(_log_buffer + tail, src, part);
+	memcpy(_log_buffer, (const char *) src + part, len - part);
+	_log_buffer_used += len;
+}
+
+static void _log_buffer_copy_out(void *dst, size_t len)
+{
+	size_t part = min(len, _log_buffer_size - _log_buffer_head);
+
+	memcpy(dst, _log_buffer + _log_buffer_head, part);
+	memcpy((char *) dst + part, _log_buffer, len - part);
+	_log_buffer_head = (_log_buffer_head + len) % _log_buffer_size;
+	_log_buffer_used -= len;
+}
+
+/*
+ * Only the message text is formatted here as its arguments may not
+ * outlive the call.  Prefixes, timestamps and file output wait for
+ * log_flush_buffer().  The oldest records are dropped to make room.
+ */
+static void _log_buffer_record(const char *file, int line, const char *message)
+{
+	struct log_record rec;
+	size_t max_len = _log_buffer_size - sizeof(rec);
+
+	if (clock_gettime(CLOCK_REALTIME, &rec.ts) < 0)
+		rec.ts.tv_sec = rec.ts.tv_nsec = 0;
+	rec.file = file;
+	rec.line = line;
+	rec.len = min(strlen(message), max_len);
+
+	while (_log_buffer_used + sizeof(rec) + rec.len > _log_buffer_size) {
+		struct log_record old;
+
+		_log_buffer_copy_out(&old, sizeof(old));
+		_log_buffer_head = (_log_buffer_head + old.len) % _log_buffer_size;
+		_log_buffer_used -= old.len;
+		_log_buffer_dropped++;
+	}
+
+	_log_buffer_copy_in(&rec, sizeof(rec));
+	_log_buffer_copy_in(message, rec.len);
+}
+
+void log_flush_buffer(void)
+{
+	struct log_record rec;
+	char message[4096];
+	size_t len;
+
+	if (!_log_buffer_used || !_log_to_file)
+		return;
+
+	if (_log_buffer_dropped) {
+		fprintf(_log_file, "%s(%u older messages dropped from log buffer)\n",
+			_msg_prefix, _log_buffer_dropped);
+		_log_buffer_dropped = 0;
+	}
+
+	while (_log_buffer_used) {
+		_log_buffer_copy_out(&rec, sizeof(rec));
+		len = min((size_t) rec.len, sizeof(message) - 1);
+		_log_buffer_copy_out(message, len);
+		/* Skip any part not fitting the message buffer */
+		_log_buffer_head = (_log_buffer_head + rec.len - len) % _log_buffer_size;
+		_log_buffer_used -= rec.len - len;
+		message[len] = '\0';
+		_write_log_file_line(&rec.ts, rec.file, rec.line, message);
+	}
+
+	fflush(_log_file);
+}
+
+void init_log_buffer(size_t size)
+{
+	if (size == _log_buffer_size)
+		return;
+
+	log_flush_buffer();
+	free(_log_buffer);
+	_log_buffer = NULL;
+	_log_buffer_size = _log_buffer_head = _log_buffer_used = 0;
+	_log_buffer_dropped = 0;
+
+	/* Keep LVM_LOG_FILE_MAX_LINES accounting exact */
+	if (!size || (size <= sizeof(struct log_record)) || _log_file_max_lines)
+		return;
+
+	if (!(_log_buffer = malloc(size))) {
+		log_error("Failed to allocate %zu bytes for log buffer.", size);
+		return;
+	}
+
+	_log_buffer_size = size;
+}
+
 __attribute__ ((format(printf, 5, 0)))
 static void _vprint_log(int level, const char *file, int line, int dm_errno_or_class,
 			const char *format, va_list orig_ap)
@@ -615,7 +756,7 @@ static void _vprint_log(int level, const char *file, int line, int dm_errno_or_c
 
 			if (!_debug_output_fields || (_debug_output_fields & LOG_DEBUG_FIELD_TIME)) {
 				if (!time_prefix[0])
-					_set_time_prefix(time_prefix, sizeof(time_prefix));
+					_set_time_prefix(time_prefix, sizeof(time_prefix), NULL);
 				else
 					time_prefix[0] = '\0';
 			}
@@ -677,11 +818,21 @@ static void _vprint_log(int level, const char *file, int line, int dm_errno_or_c
 		return;
 	}
 
-	if (_log_to_file && (_log_while_suspended || !critical_section())) {
+	if (_log_to_file && _log_buffer && (_log_while_suspended || !critical_section())) {
+		va_copy(ap, orig_ap);
+		(void) vsnprintf(message, sizeof(message), trformat, ap);
+		va_end(ap);
+
+		_log_buffer_record(file, line, message);
+
+		/* Errors carry the context leading up to them out at once */
+		if (level <= _LOG_ERR)
+			log_flush_buffer();
+	} else if (_log_to_file && (_log_while_suspended || !critical_section())) {
 
 		if (!_debug_file_fields || (_debug_file_fields & LOG_DEBUG_FIELD_TIME)) {
 			if (!time_prefix[0])
-				_set_time_prefix(time_prefix, sizeof(time_prefix));
+				_set_time_prefix(time_prefix, sizeof(time_prefix), NULL);
 			else
 				time_prefix[0] = '\0';
 		}
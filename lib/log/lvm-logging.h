@@ -52,6 +52,8 @@ void init_debug_file_fields(uint32_t debug_fields);
 void init_debug_output_fields(uint32_t debug_fields);
 
 void init_log_file(const char *log_file, int append);
+void init_log_buffer(size_t size);
+void log_flush_buffer(void);
 void unlink_log_file(int ret);
 void init_log_while_suspended(int log_while_suspended);
 void init_abort_on_internal_errors(int fatal);
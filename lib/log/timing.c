@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/log/timing.h"
+#include "lib/report/report.h"
+
+#include <time.h>
+
+struct timing_phase {
+	const char *name;
+	uint64_t started;
+	uint64_t total;
+	unsigned count;
+	unsigned depth;
+};
+
+static struct timing_phase _phases[TIMING_COUNT] = {
+	[TIMING_DEV_CACHE_SCAN] = { .name = "dev_cache_scan" },
+	[TIMING_FILTERS] = { .name = "filters" },
+	[TIMING_LABEL_SCAN] = { .name = "label_scan" },
+	[TIMING_LOCKING] = { .name = "locking" },
+	[TIMING_VG_READ] = { .name = "vg_read" },
+	[TIMING_VG_WRITE] = { .name = "vg_write" },
+	[TIMING_VG_COMMIT] = { .name = "vg_commit" },
+	[TIMING_ACTIVATION] = { .name = "activation" },
+	[TIMING_UDEV_WAIT] = { .name = "udev_wait" },
+	[TIMING_MEMLOCK] = { .name = "memlock" },
+};
+
+static int _timing_enabled = 0;
+static int _timing_reported = 0;
+static uint64_t _timing_started = 0;
+
+/* libdevmapper suspension totals when accounting started */
+static uint64_t _suspended_usec = 0;
+static unsigned _suspended_count = 0;
+
+static uint64_t _now_usec(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void timing_init(int enable)
+{
+	unsigned i;
+
+	for (i = 0; i < TIMING_COUNT; i++) {
+		_phases[i].total = 0;
+		_phases[i].count = 0;
+		_phases[i].depth = 0;
+	}
+
+	_timing_enabled = enable;
+	_timing_reported = 0;
+	_timing_started = enable ? _now_usec() : 0;
+	dm_get_suspended_time(&_suspended_usec, &_suspended_count);
+}
+
+void timing_start(timing_phase_t phase)
+{
+	struct timing_phase *tp = &_phases[phase];
+
+	if (!_timing_enabled)
+		return;
+
+	if (!tp->depth++)
+		tp->started = _now_usec();
+}
+
+void timing_end(timing_phase_t phase)
+{
+	struct timing_phase *tp = &_phases[phase];
+
+	if (!_timing_enabled || !tp->depth)
+		return;
+
+	if (!--tp->depth) {
+		tp->total += _now_usec() - tp->started;
+		tp->count++;
+	}
+}
+
+static int _report_phase(struct dm_report *log_rh, const char *name,
+			 uint64_t usec, unsigned count)
+{
+	char msg[64];
+
+	if (!log_rh) {
+		log_print("%-16s %12.3f ms %8u", name, usec / 1000.0, count);
+		return 1;
+	}
+
+	/* Keep values machine readable for aggregation from json output */
+	if (dm_snprintf(msg, sizeof(msg), "usec=" FMTu64 " count=%u", usec, count) < 0)
+		return_0;
+
+	return report_cmdlog(log_rh, TIMING_LOG_TYPE,
+			     log_get_report_context_name(LOG_REPORT_CONTEXT_PROCESSING),
+			     log_get_report_object_type_name(LOG_REPORT_OBJECT_TYPE_CMD),
+			     name, NULL, NULL, NULL, msg, 0, 0);
+}
+
+void timing_report(struct dm_report *log_rh)
+{
+	uint64_t suspended_usec;
+	unsigned suspended_count;
+	unsigned i;
+
+	if (!_timing_enabled || _timing_reported)
+		return;
+
+	_timing_reported = 1;
+
+	if (!log_rh)
+		log_print("%-16s %15s %8s", "Phase", "Time", "Count");
+
+	for (i = 0; i < TIMING_COUNT; i++)
+		if (_phases[i].count &&
+		    !_report_phase(log_rh, _phases[i].name, _phases[i].total, _phases[i].count))
+			stack;
+
+	/*
+	 * Time devices spent suspended, summed over devices, so it may
+	 * exceed the command's wall time.  Each device's own time is logged
+	 * with -vvvv when it is resumed.
+	 */
+	dm_get_suspended_time(&suspended_usec, &suspended_count);
+	if ((suspended_count > _suspended_count) &&
+	    !_report_phase(log_rh, "suspended", suspended_usec - _suspended_usec,
+			   suspended_count - _suspended_count))
+		stack;
+
+	if (!_report_phase(log_rh, "total", _now_usec() - _timing_started, 1))
+		stack;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_TIMING_H
+#define _LVM_TIMING_H
+
+struct dm_report;
+
+/*
+ * Phases of a command whose time is accounted with --timing.
+ * Phases may nest (e.g. filters run within label_scan) so their
+ * times are not meant to add up to the command's wall time.
+ */
+typedef enum {
+	TIMING_DEV_CACHE_SCAN,
+	TIMING_FILTERS,
+	TIMING_LABEL_SCAN,
+	TIMING_LOCKING,
+	TIMING_VG_READ,
+	TIMING_VG_WRITE,
+	TIMING_VG_COMMIT,
+	TIMING_ACTIVATION,
+	TIMING_UDEV_WAIT,
+	TIMING_MEMLOCK,
+	TIMING_COUNT
+} timing_phase_t;
+
+#define TIMING_LOG_TYPE "timing"
+
+/* Enables accounting and restarts it from zero. */
+void timing_init(int enable);
+
+/* Recursive entries into a phase are accounted to the outermost one. */
+void timing_start(timing_phase_t phase);
+void timing_end(timing_phase_t phase);
+
+/*
+ * Reports collected times once per command, as log report rows
+ * when log_rh is given or as printed lines otherwise.
+ */
+void timing_report(struct dm_report *log_rh);
+
+#endif
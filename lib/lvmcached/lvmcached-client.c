@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/misc/lib.h"
+
+#include "libdaemon/client/daemon-client.h"
+#include "lib/lvmcached/lvmcached-client.h"
+#include "daemons/lvmcached/lvmcached-protocol.h"
+#include "lib/device/device.h"
+#include "lib/label/label.h"
+#include "lib/misc/crc.h"
+#include "lib/misc/lvm-compress.h"
+
+static int _lvmcached_use;
+static int _lvmcached_connected;
+static int _lvmcached_failed;
+static const char *_lvmcached_socket;
+
+static daemon_handle _lvmcached = { .error = 0 };
+
+void lvmcached_set_active(int active)
+{
+	_lvmcached_use = active;
+}
+
+void lvmcached_set_socket(const char *socket)
+{
+	_lvmcached_socket = socket;
+}
+
+void lvmcached_disconnect(void)
+{
+	if (_lvmcached_connected) {
+		daemon_close(_lvmcached);
+		_lvmcached_connected = 0;
+	}
+	_lvmcached_failed = 0;
+}
+
+/* Connects once per command, a daemon that is not there is not retried. */
+static int _lvmcached_connect(void)
+{
+	daemon_info lvmcached_info = {
+		.path = "lvmcached",
+		.socket = _lvmcached_socket ?: LVMCACHED_SOCKET,
+		.protocol = LVMCACHED_PROTOCOL,
+		.protocol_version = LVMCACHED_PROTOCOL_VERSION
+	};
+
+	if (!_lvmcached_use || _lvmcached_failed)
+		return 0;
+
+	if (_lvmcached_connected)
+		return 1;
+
+	_lvmcached = daemon_open(lvmcached_info);
+	if (_lvmcached.socket_fd < 0 || _lvmcached.error) {
+		log_debug("lvmcached is not available, reading metadata from disk.");
+		_lvmcached_failed = 1;
+		return 0;
+	}
+
+	log_debug("Connected to lvmcached on fd %d.", _lvmcached.socket_fd);
+	_lvmcached_connected = 1;
+
+	return 1;
+}
+
+/* After an IO error the connection is unusable, stop using the daemon. */
+static void _lvmcached_error(const char *req, int error)
+{
+	log_debug("lvmcached %s failed: %s, reading metadata from disk.", req, strerror(error));
+	daemon_close(_lvmcached);
+	_lvmcached_connected = 0;
+	_lvmcached_failed = 1;
+}
+
+static daemon_reply _send(const char *req, struct buffer *buf, int parse)
+{
+	daemon_request rq = { .cft = NULL, .buffer = *buf };
+	daemon_reply reply = parse ? daemon_send(_lvmcached, rq) : daemon_send_raw(_lvmcached, rq);
+
+	if (reply.error)
+		_lvmcached_error(req, reply.error);
+
+	return reply;
+}
+
+char *lvmcached_metadata_get(uint32_t checksum, uint32_t size)
+{
+	struct config_scan scan;
+	enum config_scan_item item;
+	const char *key, *value, *text = NULL;
+	struct buffer buf;
+	daemon_reply reply;
+	int ok = 0;
+
+	if (!_lvmcached_connect())
+		return NULL;
+
+	buffer_init(&buf);
+	if (!buffer_append_key_str(&buf, "request", LVMCD_REQ_GET) ||
+	    !buffer_append_key_int(&buf, LVMCD_PARM_CHECKSUM, checksum) ||
+	    !buffer_append_key_int(&buf, LVMCD_PARM_SIZE, size)) {
+		buffer_destroy(&buf);
+		return NULL;
+	}
+
+	/* The text is large, so it is read in place without a config tree */
+	reply = _send(LVMCD_REQ_GET, &buf, 0);
+	buffer_destroy(&buf);
+
+	if (reply.error)
+		return NULL;
+
+	config_scan_init(&scan, reply.buffer.mem, reply.buffer.used);
+
+	while ((item = config_scan_next(&scan, &key, &value)) == CONFIG_SCAN_VALUE) {
+		if (!strcmp(key, "response"))
+			ok = !strcmp(value, LVMCD_RESP_OK);
+		else if (!strcmp(key, LVMCD_PARM_METADATA))
+			text = value;
+	}
+
+	if (!ok || !text) {
+		daemon_reply_destroy(reply);
+		return NULL;
+	}
+
+	/*
+	 * Trust nothing but what the mda header on disk says.
+	 * Its size counts the terminating NUL, as does the checksum.
+	 */
+	if (!size || (strlen(text) != size - 1) ||
+	    (calc_crc(INITIAL_CRC, (const uint8_t *) text, size) != checksum)) {
+		log_debug("lvmcached returned metadata not matching %08x size %u.", checksum, size);
+		daemon_reply_destroy(reply);
+		return NULL;
+	}
+
+	/* Hand the reply buffer over, with the text moved to its start */
+	memmove(reply.buffer.mem, text, size);
+
+	return reply.buffer.mem;
+}
+
+void lvmcached_metadata_put(struct device *dev, off_t offset, uint32_t size,
+			    off_t offset2, uint32_t size2, uint32_t checksum)
+{
+	struct buffer buf;
+	daemon_reply reply;
+	char *text;
+
+	if (!_lvmcached_connect())
+		return;
+
+	if (!(text = malloc(size + size2 + 1)))
+		return;
+
+	/* Just read and checksummed, so these come from bcache */
+	if (!dev_read_bytes(dev, offset, size, text) ||
+	    (size2 && !dev_read_bytes(dev, offset2, size2, text + size)))
+		goto out;
+
+	text[size + size2] = '\0';
+
+	/* Only plain text goes over the protocol, its size including the NUL */
+	if (text_is_compressed(text, size + size2) || text[size + size2 - 1] ||
+	    (strlen(text) != size + size2 - 1))
+		goto out;
+
+	buffer_init(&buf);
+	if (buffer_append_key_str(&buf, "request", LVMCD_REQ_PUT) &&
+	    buffer_append_key_int(&buf, LVMCD_PARM_CHECKSUM, checksum) &&
+	    buffer_append_key_int(&buf, LVMCD_PARM_SIZE, size + size2) &&
+	    buffer_append_key_int(&buf, LVMCD_PARM_DEVICE, (int64_t) dev->dev) &&
+	    buffer_append_key_str(&buf, LVMCD_PARM_METADATA, text)) {
+		reply = _send(LVMCD_REQ_PUT, &buf, 1);
+		daemon_reply_destroy(reply);
+	}
+	buffer_destroy(&buf);
+out:
+	free(text);
+}
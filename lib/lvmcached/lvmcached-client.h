@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_LVMCACHED_CLIENT_H
+#define _LVM_LVMCACHED_CLIENT_H
+#  ifdef LVMCACHED_SUPPORT
+
+#	define LVMCACHED_SOCKET DEFAULT_RUN_DIR "/lvmcached.socket"
+
+struct device;
+
+/*
+ * lvmcached is strictly a cache of VG metadata text: every failure to
+ * reach it or to get a usable answer from it just means reading from
+ * disk, without a message beyond debug logging.
+ */
+void lvmcached_set_active(int active);
+void lvmcached_set_socket(const char *socket);
+void lvmcached_disconnect(void);
+
+/*
+ * Returns the metadata text the mda header describes by checksum and
+ * size, checked against both, to be released with free().
+ */
+char *lvmcached_metadata_get(uint32_t checksum, uint32_t size);
+
+/* Pass the metadata text just read and checked from dev to lvmcached. */
+void lvmcached_metadata_put(struct device *dev, off_t offset, uint32_t size,
+			    off_t offset2, uint32_t size2, uint32_t checksum);
+
+#  else
+
+#	define lvmcached_set_active(active) do {} while (0)
+#	define lvmcached_set_socket(socket) do {} while (0)
+#	define lvmcached_disconnect() do {} while (0)
+#	define lvmcached_metadata_get(checksum, size) (NULL)
+#	define lvmcached_metadata_put(dev, offset, size, offset2, size2, checksum) do {} while (0)
+
+#  endif /* LVMCACHED_SUPPORT */
+
+#endif /* _LVM_LVMCACHED_CLIENT_H */
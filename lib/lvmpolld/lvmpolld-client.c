@@ -134,7 +134,11 @@ static void _process_error_response(daemon_reply rep)
 	log_print_unless_silent("For more information see lvmpolld messages in syslog or lvmpolld log file.");
 }
 
-static struct progress_info _request_progress_info(const char *uuid, unsigned abort_polling)
+/* wait for the next update at least this long while aborting */
+#define UPDATE_WAIT 10
+
+static struct progress_info _request_progress_info(const char *uuid, unsigned abort_polling,
+						   unsigned interval, struct lvmpolld_update *update)
 {
 	daemon_reply rep;
 	const char *e = getenv("LVM_SYSTEM_DIR");
@@ -159,6 +163,14 @@ static struct progress_info _request_progress_info(const char *uuid, unsigned ab
 		goto out_req;
 	}
 
+	if (update && update->nr &&
+	    !daemon_request_extend(req, LVMPD_PARM_UPDATE " = " FMTd64, (int64_t) update->nr,
+				   LVMPD_PARM_WAIT " = " FMTd64, (int64_t) (interval ? : UPDATE_WAIT),
+				   NULL)) {
+		log_error("Failed to create " LVMPD_REQ_PROGRESS " request.");
+		goto out_req;
+	}
+
 	rep = daemon_send(_lvmpolld, req);
 	if (rep.error) {
 		log_error("Failed to process request with error %s (errno: %d).",
@@ -169,6 +181,13 @@ static struct progress_info _request_progress_info(const char *uuid, unsigned ab
 	if (!strcmp(daemon_reply_str(rep, "response", ""), LVMPD_RESP_IN_PROGRESS)) {
 		ret.finished = 0;
 		ret.error = 0;
+		if (update) {
+			update->nr = daemon_reply_int(rep, LVMPD_PARM_UPDATE, 0);
+			if (!dm_strncpy(update->progress,
+					daemon_reply_str(rep, LVMPD_PARM_PROGRESS, ""),
+					sizeof(update->progress)))
+				update->progress[0] = '\0';
+		}
 	} else if (!strcmp(daemon_reply_str(rep, "response", ""), LVMPD_RESP_FINISHED)) {
 		if (!strcmp(daemon_reply_str(rep, "reason", ""), LVMPD_REAS_SIGNAL))
 			ret.cmd_signal = daemon_reply_int(rep, LVMPD_PARM_VALUE, 0);
@@ -319,7 +338,8 @@ int lvmpolld_poll_init(const struct cmd_context *cmd, const struct poll_operatio
 	return r;
 }
 
-int lvmpolld_request_info(const struct poll_operation_id *id, const struct daemon_parms *parms, unsigned *finished)
+int lvmpolld_request_info(const struct poll_operation_id *id, const struct daemon_parms *parms,
+			  unsigned *finished, struct lvmpolld_update *update)
 {
 	struct progress_info info;
 	int ret = 0;
@@ -333,7 +353,7 @@ int lvmpolld_request_info(const struct poll_operation_id *id, const struct daemo
 
 	log_debug_lvmpolld("Asking lvmpolld for progress status of an operation on %s/%s.",
 			   id->vg_name, id->lv_name);
-	info = _request_progress_info(id->uuid, parms->aborting);
+	info = _request_progress_info(id->uuid, parms->aborting, parms->interval, update);
 	*finished = info.finished;
 
 	if (info.error)
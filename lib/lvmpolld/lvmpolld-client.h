@@ -24,13 +24,23 @@ struct cmd_context;
 struct poll_operation_id;
 struct daemon_parms;
 
+/*
+ * Progress pushed by lvmpolld.  Once nr is set by a reply, the next
+ * lvmpolld_request_info() waits in the daemon for a newer update.
+ * nr stays 0 with an lvmpolld that does not report updates.
+ */
+struct lvmpolld_update {
+	unsigned nr;
+	char progress[16];
+};
+
 void lvmpolld_disconnect(void);
 
 int lvmpolld_poll_init(const struct cmd_context *cmd, const struct poll_operation_id *id,
 		       const struct daemon_parms *parms);
 
 int lvmpolld_request_info(const struct poll_operation_id *id, const struct daemon_parms *parms,
-			  unsigned *finished);
+			  unsigned *finished, struct lvmpolld_update *update);
 
 int lvmpolld_use(void);
 
@@ -42,7 +52,7 @@ void lvmpolld_set_socket(const char *socket);
 
 #	define lvmpolld_disconnect() do {} while (0)
 #	define lvmpolld_poll_init(cmd, id, parms) (0)
-#	define lvmpolld_request_info(id, parms, finished) (0)
+#	define lvmpolld_request_info(id, parms, finished, update) (0)
 #	define lvmpolld_use() (0)
 #	define lvmpolld_set_active(active) do {} while (0)
 #	define lvmpolld_set_socket(socket) do {} while (0)
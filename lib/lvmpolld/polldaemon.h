@@ -57,6 +57,7 @@ struct daemon_parms {
 	unsigned background;
 	unsigned outstanding_count;
 	unsigned progress_display;
+	unsigned single_check;
 	const char *progress_title;
 	uint64_t lv_type;
 	struct poll_functions *poll_fns;
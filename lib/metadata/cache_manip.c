@@ -24,6 +24,8 @@
 #include "lib/metadata/lv_alloc.h"
 #include "lib/misc/lvm-signal.h"
 
+#include <time.h>
+
 /* https://github.com/jthornber/thin-provisioning-tools/blob/master/caching/cache_metadata_size.cc */
 #define DM_TRANSACTION_OVERHEAD		4096  /* KiB */
 #define DM_BYTES_PER_BLOCK		16 /* bytes */
@@ -416,6 +418,36 @@ int validate_cache_chunk_size(struct cmd_context *cmd, uint32_t chunk_size)
 	return r;
 }
 
+/* Largest chunk size picked from sampled I/O (1MiB) */
+#define SAMPLE_MAX_CHUNK_SIZE 2048
+
+/*
+ * Pick a cache chunk size for the I/O seen in a sample: the smallest
+ * power of 2 covering the average request, doubled when most of the I/O
+ * lands in a quarter of the LV or less, since neighbouring blocks are then
+ * likely to be wanted too and fewer, larger chunks keep metadata small.
+ * Returns 0 when nothing was sampled.
+ */
+uint32_t cache_chunk_size_from_sample(const struct lv_io_sample *sample)
+{
+	uint64_t mean;
+	uint32_t chunk_size = DM_CACHE_MIN_DATA_BLOCK_SIZE;
+
+	if (!sample->ios)
+		return 0;
+
+	mean = sample->sectors / sample->ios;
+
+	while ((chunk_size < mean) && (chunk_size < SAMPLE_MAX_CHUNK_SIZE))
+		chunk_size *= 2;
+
+	if (sample->areas && (sample->areas_used * 4 <= sample->areas) &&
+	    (chunk_size < SAMPLE_MAX_CHUNK_SIZE))
+		chunk_size *= 2;
+
+	return chunk_size;
+}
+
 /*
  * lv_cache_create
  * @pool
@@ -471,6 +503,70 @@ struct logical_volume *lv_cache_create(struct logical_volume *pool_lv,
 	return cache_lv;
 }
 
+#define FLUSH_WAIT_MIN_MS	20
+#define FLUSH_WAIT_INITIAL_MS	100
+#define FLUSH_WAIT_MAX_MS	5000
+#define FLUSH_REPORT_USEC	1000000
+
+static uint64_t _now_usec(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void cache_flush_progress_init(struct cache_flush_progress *fp)
+{
+	memset(fp, 0, sizeof(*fp));
+	fp->wait_ms = FLUSH_WAIT_INITIAL_MS;
+}
+
+/*
+ * Record the dirty block count of a cache being flushed, report progress
+ * at most once a second and return how long to wait before the next
+ * check: about half the time the observed flush rate needs for what is
+ * left, backing off while no progress is seen.
+ */
+unsigned cache_flush_progress(struct cache_flush_progress *fp,
+			      const struct logical_volume *lv, uint64_t dirty)
+{
+	uint64_t now = _now_usec(), wait_ms = fp->wait_ms;
+	uint64_t rate = 0;
+
+	if (fp->last_usec && (now > fp->last_usec)) {
+		if (dirty < fp->last_dirty) {
+			rate = (fp->last_dirty - dirty) * 1000000 / (now - fp->last_usec);
+			wait_ms = dirty * (now - fp->last_usec) /
+				(fp->last_dirty - dirty) / 2000;
+		} else
+			wait_ms *= 2;
+	}
+
+	if (wait_ms < FLUSH_WAIT_MIN_MS)
+		wait_ms = FLUSH_WAIT_MIN_MS;
+	else if (wait_ms > FLUSH_WAIT_MAX_MS)
+		wait_ms = FLUSH_WAIT_MAX_MS;
+
+	if (!fp->last_report_usec || (now - fp->last_report_usec >= FLUSH_REPORT_USEC)) {
+		if (rate)
+			log_print_unless_silent("Flushing " FMTu64 " blocks for cache %s (" FMTu64 " blocks/s).",
+						dirty, display_lvname(lv), rate);
+		else
+			log_print_unless_silent("Flushing " FMTu64 " blocks for cache %s.",
+						dirty, display_lvname(lv));
+		fp->last_report_usec = now;
+	}
+
+	fp->last_dirty = dirty;
+	fp->last_usec = now;
+	fp->wait_ms = (unsigned) wait_ms;
+
+	return fp->wait_ms;
+}
+
 /*
  * Checks cache status and loops until there are not dirty blocks
  * Set 1 to *is_clean when there are no dirty blocks on return.
@@ -480,17 +576,20 @@ int lv_cache_wait_for_clean(struct logical_volume *cache_lv, int *is_clean)
 	const struct logical_volume *lock_lv = lv_lock_holder(cache_lv);
 	struct lv_segment *cache_seg = first_seg(cache_lv);
 	struct lv_status_cache *status;
+	struct cache_flush_progress fp;
 	int cleaner_policy = 0, writeback;
 	uint64_t dirty_blocks;
+	unsigned wait_ms = 0;
 
 	*is_clean = 0;
 
-	//FIXME: use polling to do this...
+	cache_flush_progress_init(&fp);
+
 	for (;;) {
 		sigint_allow();
 		if (cleaner_policy)
-			/* TODO: Use centralized place */
-			usleep(500000);
+			/* Woken early by any dm event, e.g. cleaning done */
+			activation_event_wait(wait_ms);
 		sigint_restore();
 		if (sigint_caught()) {
 			sigint_clear();
@@ -504,6 +603,9 @@ int lv_cache_wait_for_clean(struct logical_volume *cache_lv, int *is_clean)
 			return 0;
 		}
 
+		/* Arm before reading status so no event is missed */
+		activation_event_arm();
+
 		if (!lv_cache_status(cache_lv, &status))
 			return_0;
 
@@ -523,8 +625,7 @@ int lv_cache_wait_for_clean(struct logical_volume *cache_lv, int *is_clean)
 		if (!dirty_blocks && (cleaner_policy || !writeback))
 			break;
 
-		log_print_unless_silent("Flushing " FMTu64 " blocks for cache %s.",
-					dirty_blocks, display_lvname(cache_lv));
+		wait_ms = cache_flush_progress(&fp, cache_lv, dirty_blocks);
 
 		if (cleaner_policy)
 			continue;
@@ -569,6 +670,57 @@ int lv_cache_wait_for_clean(struct logical_volume *cache_lv, int *is_clean)
 	return 1;
 }
 
+/*
+ * Start flushing an active cache by switching it to the cleaner policy,
+ * without waiting for the flush to finish, and return the number of
+ * dirty blocks left in *dirty.  Once the cleaner is in place this only
+ * reads the dirty count, so it can be repeated to follow the flush.
+ * The cleaner stays in the metadata, so lv_cache_remove() later finds
+ * the cache clean (or still cleaning) after an interrupted command.
+ */
+int lv_cache_flush_start(struct logical_volume *cache_lv, uint64_t *dirty)
+{
+	struct lv_segment *cache_seg = first_seg(cache_lv);
+	struct lv_status_cache *status;
+	int cleaner_policy;
+
+	*dirty = 0;
+
+	if (!lv_info(cache_lv->vg->cmd, cache_lv, 1, NULL, 0, 0))
+		return 1;	/* Inactive, flushed by lv_cache_remove() */
+
+	if (!lv_cache_status(cache_lv, &status))
+		return_0;
+
+	if (status->cache->fail) {
+		dm_pool_destroy(status->mem);
+		return 1;
+	}
+
+	cleaner_policy = !strcmp(status->cache->policy_name, "cleaner");
+	*dirty = status->cache->dirty_blocks;
+	dm_pool_destroy(status->mem);
+
+	if (!*dirty || cleaner_policy)
+		return 1;
+
+	if (!(cache_lv->status & LVM_WRITE))
+		log_warn("WARNING: Dirty blocks found on read-only cache volume %s.",
+			 display_lvname(cache_lv));
+
+	cache_seg->cleaner_policy = 1;
+	if (!lv_update_and_reload_origin(cache_lv))
+		return_0;
+
+	if (!sync_local_dev_names(cache_lv->vg->cmd)) {
+		log_error("Failed to sync local devices when clearing cache volume %s.",
+			  display_lvname(cache_lv));
+		return 0;
+	}
+
+	return 1;
+}
+
 /*
  * lv_cache_remove
  * @cache_lv
@@ -498,6 +498,7 @@ int lv_add_integrity_to_raid(struct logical_volume *lv, struct integrity_setting
 	uint32_t revert_meta_lvs = 0;
 	int lbs_4k = 0, lbs_512 = 0, lbs_unknown = 0;
 	int pbs_4k = 0, pbs_512 = 0, pbs_unknown = 0;
+	int buffer_sectors;
 	int is_active;
 
 	memset(imeta_lvs, 0, sizeof(imeta_lvs));
@@ -718,6 +719,12 @@ int lv_add_integrity_to_raid(struct logical_volume *lv, struct integrity_setting
 
 		if (!set->internal_hash)
 			set->internal_hash = DEFAULT_INTERNAL_HASH;
+
+		if (!set->buffer_sectors_set &&
+		    ((buffer_sectors = find_config_tree_int(cmd, allocation_raid_integrity_buffer_sectors_CFG, lv->profile)) > 0)) {
+			set->buffer_sectors = (uint32_t) buffer_sectors;
+			set->buffer_sectors_set = 1;
+		}
 	}
 
 	if (is_active) {
@@ -932,18 +939,12 @@ int lv_raid_integrity_total_mismatches(struct cmd_context *cmd,
 	return 1;
 }
 
-int lv_integrity_mismatches(struct cmd_context *cmd,
-			    const struct logical_volume *lv,
-			    uint64_t *mismatches)
+static int _integrity_status(struct cmd_context *cmd,
+			     const struct logical_volume *lv,
+			     struct dm_status_integrity *integrity)
 {
 	struct lv_with_info_and_seg_status status;
 
-	if (lv_is_raid(lv) && lv_raid_has_integrity((struct logical_volume *)lv))
-		return lv_raid_integrity_total_mismatches(cmd, lv, mismatches);
-
-	if (!lv_is_integrity(lv))
-		return_0;
-
 	memset(&status, 0, sizeof(status));
 	status.seg_status.type = SEG_STATUS_NONE;
 
@@ -969,7 +970,7 @@ int lv_integrity_mismatches(struct cmd_context *cmd,
 		goto fail;
 	}
 
-	*mismatches = status.seg_status.integrity->number_of_mismatches;
+	*integrity = *status.seg_status.integrity;
 
 	dm_pool_destroy(status.seg_status.mem);
 	return 1;
@@ -979,3 +980,62 @@ fail:
 	return 0;
 }
 
+int lv_integrity_mismatches(struct cmd_context *cmd,
+			    const struct logical_volume *lv,
+			    uint64_t *mismatches)
+{
+	struct dm_status_integrity integrity;
+
+	if (lv_is_raid(lv) && lv_raid_has_integrity((struct logical_volume *)lv))
+		return lv_raid_integrity_total_mismatches(cmd, lv, mismatches);
+
+	if (!lv_is_integrity(lv))
+		return_0;
+
+	if (!_integrity_status(cmd, lv, &integrity))
+		return_0;
+
+	*mismatches = integrity.number_of_mismatches;
+
+	return 1;
+}
+
+/*
+ * Percentage of data initialized (recalculated) for an active integrity
+ * LV, or summed over the integrity images of a raid LV.  The kernel
+ * recalculates the images concurrently; an image no longer
+ * recalculating counts as done.
+ */
+int lv_integrity_init_percent(struct cmd_context *cmd,
+			      const struct logical_volume *lv,
+			      dm_percent_t *percent)
+{
+	struct dm_status_integrity integrity;
+	const struct lv_segment *seg = first_seg(lv);
+	const struct logical_volume *lv_image;
+	uint64_t done = 0, total = 0;
+	uint32_t s, count = 1;
+
+	if (lv_is_raid(lv) && lv_raid_has_integrity((struct logical_volume *)lv))
+		count = seg->area_count;
+	else if (!lv_is_integrity(lv))
+		return_0;
+
+	for (s = 0; s < count; s++) {
+		lv_image = lv_is_raid(lv) ? seg_lv(seg, s) : lv;
+
+		if (!lv_is_integrity(lv_image))
+			continue;
+
+		if (!_integrity_status(cmd, lv_image, &integrity))
+			return_0;
+
+		total += integrity.provided_data_sectors;
+		done += integrity.recalc_sector ? : integrity.provided_data_sectors;
+	}
+
+	*percent = (done == total) ? DM_PERCENT_100 : dm_make_percent(done, total);
+
+	return 1;
+}
+
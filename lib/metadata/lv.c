@@ -589,6 +589,53 @@ int lv_is_on_pvs(struct logical_volume *lv, struct dm_list *pvs)
 	return 0;
 }
 
+struct vg_and_int {
+	struct volume_group *vg;
+	int found;
+};
+
+static int _lv_is_on_vg_pv(struct logical_volume *lv, void *data)
+{
+	struct vg_and_int *context = data;
+	struct lv_segment *seg;
+	uint32_t s;
+
+	if (!lv || !(first_seg(lv)))
+		return_0;
+
+	if (context->found)
+		return 1;
+
+	dm_list_iterate_items(seg, &lv->segments)
+		for (s = 0; s < seg->area_count; s++)
+			if ((seg_type(seg, s) == AREA_PV) && (seg_pv(seg, s)->vg == context->vg)) {
+				context->found = 1;
+				return 1;
+			}
+
+	return 1;
+}
+
+/*
+ * lv_is_on_vg_pvs
+ * @lv
+ * @vg
+ *
+ * Like lv_is_on_pvs(lv, &vg->pvs) in a single walk of the LV, going by
+ * the VG each PV is linked into.  For use while PVs move between VGs.
+ */
+int lv_is_on_vg_pvs(struct logical_volume *lv, struct volume_group *vg)
+{
+	struct vg_and_int context = { .vg = vg };
+
+	if (!_lv_is_on_vg_pv(lv, &context) ||
+	    !for_each_sub_lv(lv, _lv_is_on_vg_pv, &context))
+		/* Failure only happens if bad arguments are passed */
+		log_error(INTERNAL_ERROR "for_each_sub_lv failure.");
+
+	return context.found;
+}
+
 
 struct logical_volume *lv_origin_lv(const struct logical_volume *lv)
 {
@@ -43,6 +43,7 @@ struct logical_volume {
 	struct lv_segment *snapshot;
 
 	struct dm_list segments;
+	struct lv_seg_index *seg_index; /* Built by find_seg_by_le() */
 	struct dm_list tags;
 	struct dm_list segs_using_this_lv;
 	struct dm_list indirect_glvs; /* For keeping track of historical LVs in ancestry chain */
@@ -33,6 +33,8 @@
 #include "lib/label/label.h"
 #include "lib/misc/lvm-signal.h"
 
+#include <time.h>
+
 #ifdef HAVE_BLKZEROOUT
 #include <sys/ioctl.h>
 #include <linux/fs.h>
@@ -1052,25 +1054,23 @@ struct lv_segment *alloc_lv_segment(const struct segment_type *segtype,
 	struct lv_segment *seg;
 	struct dm_pool *mem = lv->vg->vgmem;
 	uint32_t areas_sz = area_count * sizeof(*seg->areas);
+	int with_meta = segtype && segtype_is_raid_with_meta(segtype);
 
 	if (!segtype) {
 		log_error(INTERNAL_ERROR "alloc_lv_segment: Missing segtype.");
 		return NULL;
 	}
 
-	if (!(seg = dm_pool_zalloc(mem, sizeof(*seg))))
-		return_NULL;
-
-	if (!(seg->areas = dm_pool_zalloc(mem, areas_sz))) {
-		dm_pool_free(mem, seg);
+	/*
+	 * Areas (and RAID metadata areas) share one allocation with the
+	 * segment.  Code replacing them later allocates new arrays.
+	 */
+	if (!(seg = dm_pool_zalloc(mem, sizeof(*seg) + (with_meta ? 2 : 1) * areas_sz)))
 		return_NULL;
-	}
 
-	if (segtype_is_raid_with_meta(segtype) &&
-	    !(seg->meta_areas = dm_pool_zalloc(mem, areas_sz))) {
-		dm_pool_free(mem, seg); /* frees everything alloced since seg */
-		return_NULL;
-	}
+	seg->areas = (struct lv_segment_area *) (seg + 1);
+	if (with_meta)
+		seg->meta_areas = seg->areas + area_count;
 
 	seg->segtype = segtype;
 	seg->lv = lv;
@@ -1809,6 +1809,15 @@ struct alloc_handle {
 
 	const struct dm_config_node *cling_tag_list_cn;
 
+	/*
+	 * Without a wildcard, cling_tag_list entries are numbered once so
+	 * each PV's tags reduce to a bitmask computed on first use and two
+	 * PVs match when their masks intersect.
+	 */
+	const char **cling_tags;		/* Entries without the '@' */
+	unsigned cling_tags_count;
+	struct dm_hash_table *cling_tag_masks;	/* PV -> uint64_t mask */
+
 	struct dm_list *parallel_areas;	/* PVs to avoid */
 
 	/*
@@ -2403,20 +2412,92 @@ static int _pv_has_matching_tag(const struct dm_config_node *cling_tag_list_cn,
 	return _match_pv_tags(cling_tag_list_cn, pv1, pv1_start_pe, area_num, NULL, pv_tags, 0, NULL, 0);
 }
 
+#define MAX_CLING_TAGS 64
+
+/*
+ * Number the valid allocation/cling_tag_list entries for _cling_tag_mask().
+ * A wildcard or an oversized list leaves cling_tag_masks unset so
+ * matching falls back to walking the list.
+ */
+static int _index_cling_tags(struct alloc_handle *ah)
+{
+	const struct dm_config_value *cv;
+	unsigned count = 0;
+
+	for (cv = ah->cling_tag_list_cn->v; cv; cv = cv->next) {
+		if ((cv->type != DM_CFG_STRING) || (cv->v.str[0] != '@') || !cv->v.str[1])
+			continue;
+		if (!strcmp(cv->v.str + 1, "*") || (++count > MAX_CLING_TAGS))
+			return 1;
+	}
+
+	if (!(ah->cling_tags = dm_pool_alloc(ah->mem, (count ? : 1) * sizeof(*ah->cling_tags))))
+		return_0;
+
+	for (cv = ah->cling_tag_list_cn->v; cv; cv = cv->next)
+		if ((cv->type == DM_CFG_STRING) && (cv->v.str[0] == '@') && cv->v.str[1])
+			ah->cling_tags[ah->cling_tags_count++] = cv->v.str + 1;
+
+	if (!(ah->cling_tag_masks = dm_hash_create(64)))
+		return_0;
+
+	return 1;
+}
+
+static uint64_t _cling_tag_mask(struct alloc_handle *ah, struct physical_volume *pv)
+{
+	uint64_t *mask;
+	unsigned i;
+
+	if ((mask = dm_hash_lookup_binary(ah->cling_tag_masks, &pv, sizeof(pv))))
+		return *mask;
+
+	if (!(mask = dm_pool_zalloc(ah->mem, sizeof(*mask))))
+		return_0;
+
+	for (i = 0; i < ah->cling_tags_count; i++)
+		if (str_list_match_item(&pv->tags, ah->cling_tags[i]))
+			*mask |= UINT64_C(1) << i;
+
+	if (!dm_hash_insert_binary(ah->cling_tag_masks, &pv, sizeof(pv), mask))
+		return_0;
+
+	return *mask;
+}
+
 /*
  * Does PV area have a tag listed in allocation/cling_tag_list that
  * matches a tag of the PV of the existing segment?
  */
-static int _pvs_have_matching_tag(const struct dm_config_node *cling_tag_list_cn,
+static int _pvs_have_matching_tag(struct alloc_handle *ah,
 				  struct physical_volume *pv1, struct physical_volume *pv2,
 				  unsigned parallel_pv)
 {
-	return _match_pv_tags(cling_tag_list_cn, pv1, 0, 0, pv2, NULL, 0, NULL, parallel_pv);
+	uint64_t matched;
+	const char *str;
+
+	if (!ah->cling_tag_masks)
+		return _match_pv_tags(ah->cling_tag_list_cn, pv1, 0, 0, pv2, NULL, 0, NULL, parallel_pv);
+
+	if (!(matched = _cling_tag_mask(ah, pv1) & _cling_tag_mask(ah, pv2)))
+		return 0;
+
+	/* Report the first matching entry in list order */
+	str = ah->cling_tags[__builtin_ctzll(matched)];
+
+	if (parallel_pv)
+		log_debug_alloc("Not using free space on %s: Matched allocation PV tag %s on existing parallel PV %s.",
+				pv_dev_name(pv2), str, pv_dev_name(pv1));
+	else
+		log_debug_alloc("Matched allocation PV tag %s on existing %s with free space on %s.",
+				str, pv_dev_name(pv1), pv_dev_name(pv2));
+
+	return 1;
 }
 
 static int _has_matching_pv_tag(struct pv_match *pvmatch, struct pv_segment *pvseg, struct pv_area *pva)
 {
-	return _pvs_have_matching_tag(pvmatch->cling_tag_list_cn, pvseg->pv, pva->map->pv, 0);
+	return _pvs_have_matching_tag(pvmatch->ah, pvseg->pv, pva->map->pv, 0);
 }
 
 static int _log_parallel_areas(struct dm_pool *mem, struct dm_list *parallel_areas,
@@ -2661,6 +2742,78 @@ static int _check_contiguous(struct alloc_handle *ah,
 	return 1;
 }
 
+/*
+ * PEs immediately following the end of prev_lvseg on each PV it uses.
+ * Lets a search for contiguous space go straight to the matching area
+ * of a PV through its start PE index instead of checking every area.
+ */
+struct next_pe {
+	struct dm_list list;
+	struct physical_volume *pv;
+	uint32_t pe;
+};
+
+struct next_pe_baton {
+	struct dm_pool *mem;
+	struct dm_list pes;
+};
+
+static int _add_next_pe(struct cmd_context *cmd __attribute__((unused)),
+			struct pv_segment *pvseg, uint32_t s __attribute__((unused)),
+			void *data)
+{
+	struct next_pe_baton *npb = data;
+	struct next_pe *npe;
+
+	if (!(npe = dm_pool_alloc(npb->mem, sizeof(*npe)))) {
+		log_error("Next PE allocation failed.");
+		return 0;
+	}
+
+	npe->pv = pvseg->pv;
+	npe->pe = pvseg->pe + pvseg->len;
+	dm_list_add(&npb->pes, &npe->list);
+
+	return 1;
+}
+
+static struct dm_list *_contiguous_next_pes(struct alloc_handle *ah,
+					    struct lv_segment *prev_lvseg)
+{
+	struct next_pe_baton *npb;
+
+	if (!(npb = dm_pool_alloc(ah->mem, sizeof(*npb)))) {
+		log_error("Next PE list allocation failed.");
+		return NULL;
+	}
+
+	npb->mem = ah->mem;
+	dm_list_init(&npb->pes);
+
+	/* Same extent _check_contiguous() examines */
+	if (_for_each_pv(ah->cmd, prev_lvseg->lv,
+			 prev_lvseg->le + prev_lvseg->len - 1, 1, NULL, NULL,
+			 0, 0, -1, 1,
+			 _add_next_pe, npb) != 1)
+		return_NULL;
+
+	return &npb->pes;
+}
+
+/*
+ * Could any area of pvm be contiguous to prev_lvseg?
+ */
+static int _pv_map_has_next_pe(struct pv_map *pvm, struct dm_list *next_pes)
+{
+	struct next_pe *npe;
+
+	dm_list_iterate_items(npe, next_pes)
+		if (npe->pv == pvm->pv && find_pv_area_at(pvm, npe->pe))
+			return 1;
+
+	return 0;
+}
+
 /*
  * Is pva on same PV as any areas already used in this allocation attempt?
  */
@@ -2683,7 +2836,7 @@ static int _check_cling_to_alloced(struct alloc_handle *ah, const struct dm_conf
 			continue;	/* Area already assigned */
 		dm_list_iterate_items(aa, &ah->alloced_areas[s]) {
 			if ((!cling_tag_list_cn && (pva->map->pv == aa[0].pv)) ||
-			    (cling_tag_list_cn && _pvs_have_matching_tag(cling_tag_list_cn, pva->map->pv, aa[0].pv, 0))) {
+			    (cling_tag_list_cn && _pvs_have_matching_tag(ah, pva->map->pv, aa[0].pv, 0))) {
 				if (positional &&
 				    !_reserve_required_area(ah, alloc_state, pva, pva->count, s, 0))
 					return_0;
@@ -2695,7 +2848,7 @@ static int _check_cling_to_alloced(struct alloc_handle *ah, const struct dm_conf
 	return 0;
 }
 
-static int _pv_is_parallel(struct physical_volume *pv, struct dm_list *parallel_pvs, const struct dm_config_node *cling_tag_list_cn)
+static int _pv_is_parallel(struct alloc_handle *ah, struct physical_volume *pv, struct dm_list *parallel_pvs)
 {
 	struct pv_list *pvl;
 
@@ -2705,7 +2858,7 @@ static int _pv_is_parallel(struct physical_volume *pv, struct dm_list *parallel_
 					pv_dev_name(pvl->pv));
 			return 1;
 		}
-		if (cling_tag_list_cn && _pvs_have_matching_tag(cling_tag_list_cn, pvl->pv, pv, 1))
+		if (ah->cling_tag_list_cn && _pvs_have_matching_tag(ah, pvl->pv, pv, 1))
 			return 1;
 	}
 
@@ -2935,10 +3088,15 @@ static int _find_some_parallel_space(struct alloc_handle *ah,
 	uint32_t s;
 	uint32_t devices_needed = ah->area_count + ah->parity_count;
 	uint32_t required;
+	struct dm_list *next_pes = NULL;
 
 	_clear_areas(alloc_state);
 	_reset_unreserved(pvms);
 
+	/* Without a list every area still gets checked */
+	if (alloc_parms->flags & A_CONTIGUOUS_TO_LVSEG)
+		next_pes = _contiguous_next_pes(ah, alloc_parms->prev_lvseg);
+
 	/* num_positional_areas holds the number of parallel allocations that must be contiguous/cling */
 	/* These appear first in the array, so it is also the offset to the non-preferred allocations */
 	/* At most one of A_CONTIGUOUS_TO_LVSEG, A_CLING_TO_LVSEG or A_CLING_TO_ALLOCED may be set */
@@ -2997,7 +3155,7 @@ static int _find_some_parallel_space(struct alloc_handle *ah,
 				/* FIXME Split into log and non-log parallel_pvs and only check the log ones if log_iteration? */
 				/* (I've temporatily disabled the check.) */
 				/* Avoid PVs used by existing parallel areas */
-				if (!log_iteration_count && parallel_pvs && _pv_is_parallel(pvm->pv, parallel_pvs, ah->cling_tag_list_cn))
+				if (!log_iteration_count && parallel_pvs && _pv_is_parallel(ah, pvm->pv, parallel_pvs))
 					goto next_pv;
 
 				/*
@@ -3016,6 +3174,14 @@ static int _find_some_parallel_space(struct alloc_handle *ah,
 							goto next_pv;
 			}
 
+			/*
+			 * Only an area starting right after prev_lvseg can be
+			 * contiguous so every other area would be skipped.
+			 */
+			if (next_pes && !iteration_count && !log_iteration_count &&
+			    !_pv_map_has_next_pe(pvm, next_pes))
+				goto next_pv;
+
 			already_found_one = 0;
 			/* First area in each list is the largest */
 			dm_list_iterate_items(pva, &pvm->areas) {
@@ -3665,8 +3831,13 @@ static struct alloc_handle *_alloc_init(struct cmd_context *cmd,
 
 	ah->parallel_areas = parallel_areas;
 
-	if ((ah->cling_tag_list_cn = find_config_tree_array(cmd, allocation_cling_tag_list_CFG, NULL)))
+	if ((ah->cling_tag_list_cn = find_config_tree_array(cmd, allocation_cling_tag_list_CFG, NULL))) {
 		(void) _validate_tag_list(ah->cling_tag_list_cn);
+		if (!_index_cling_tags(ah)) {
+			alloc_destroy(ah);
+			return_NULL;
+		}
+	}
 
 	ah->maximise_cling = find_config_tree_bool(cmd, allocation_maximise_cling_CFG, NULL);
 
@@ -3677,8 +3848,12 @@ static struct alloc_handle *_alloc_init(struct cmd_context *cmd,
 
 void alloc_destroy(struct alloc_handle *ah)
 {
-	if (ah)
-		dm_pool_destroy(ah->mem);
+	if (!ah)
+		return;
+
+	if (ah->cling_tag_masks)
+		dm_hash_destroy(ah->cling_tag_masks);
+	dm_pool_destroy(ah->mem);
 }
 
 /*
@@ -4531,6 +4706,7 @@ out:
 static int _rename_single_lv(struct logical_volume *lv, char *new_name)
 {
 	struct volume_group *vg = lv->vg;
+	const char *old_name;
 	int historical;
 
 	if (lv_name_is_used_in_vg(vg, new_name, &historical)) {
@@ -4545,7 +4721,9 @@ static int _rename_single_lv(struct logical_volume *lv, char *new_name)
 		return 0;
 	}
 
+	old_name = lv->name;
 	lv->name = new_name;
+	lv_index_rename(lv, old_name);
 
 	return 1;
 }
@@ -4764,6 +4942,7 @@ int lv_rename_update(struct cmd_context *cmd, struct logical_volume *lv,
 
 		/* rename main LV */
 		lv->name = lv_names.new;
+		lv_index_rename(lv, lv_names.old);
 
 		if (lv_is_cow(lv))
 			lv = origin_from_cow(lv);
@@ -4897,16 +5076,14 @@ enum fsadm_cmd_e { FSADM_CMD_CHECK, FSADM_CMD_RESIZE };
  * fsadm --dry-run --verbose --force check lv_path
  * fsadm --dry-run --verbose --force resize lv_path size
  */
-static int _fsadm_cmd(enum fsadm_cmd_e fcmd,
-		      struct logical_volume *lv,
-		      uint32_t extents,
-		      int yes,
-		      int force,
-		      int *status)
+static int _fsadm_exec(struct cmd_context *cmd,
+		       enum fsadm_cmd_e fcmd,
+		       const char *lv_path,
+		       uint64_t size_k,
+		       int yes,
+		       int force,
+		       int *status)
 {
-	struct volume_group *vg = lv->vg;
-	struct cmd_context *cmd = vg->cmd;
-	char lv_path[PATH_MAX];
 	char size_buf[SIZE_BUF];
 	const char *argv[FSADM_CMD_MAX_ARGS + 4];
 	unsigned i = 0;
@@ -4930,17 +5107,10 @@ static int _fsadm_cmd(enum fsadm_cmd_e fcmd,
 	if (status)
 		*status = -1;
 
-	if (dm_snprintf(lv_path, sizeof(lv_path), "%s%s/%s", cmd->dev_dir,
-			vg->name, lv->name) < 0) {
-		log_error("Couldn't create LV path for %s.", display_lvname(lv));
-		return 0;
-	}
-
 	argv[i++] = lv_path;
 
 	if (fcmd == FSADM_CMD_RESIZE) {
-		if (dm_snprintf(size_buf, sizeof(size_buf), FMTu64 "K",
-				(uint64_t) extents * (vg->extent_size / 2)) < 0) {
+		if (dm_snprintf(size_buf, sizeof(size_buf), FMTu64 "K", size_k) < 0) {
 			log_error("Couldn't generate new LV size string.");
 			return 0;
 		}
@@ -4953,6 +5123,53 @@ static int _fsadm_cmd(enum fsadm_cmd_e fcmd,
 	return exec_cmd(cmd, argv, status, 1);
 }
 
+static int _fsadm_lv_path(const struct logical_volume *lv, char *lv_path, size_t size)
+{
+	if (dm_snprintf(lv_path, size, "%s%s/%s", lv->vg->cmd->dev_dir,
+			lv->vg->name, lv->name) < 0) {
+		log_error("Couldn't create LV path for %s.", display_lvname(lv));
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _fsadm_cmd(enum fsadm_cmd_e fcmd,
+		      struct logical_volume *lv,
+		      uint32_t extents,
+		      int yes,
+		      int force,
+		      int *status)
+{
+	char lv_path[PATH_MAX];
+
+	if (status)
+		*status = -1;
+
+	if (!_fsadm_lv_path(lv, lv_path, sizeof(lv_path)))
+		return_0;
+
+	return _fsadm_exec(lv->vg->cmd, fcmd, lv_path,
+			   (uint64_t) extents * (lv->vg->extent_size / 2),
+			   yes, force, status);
+}
+
+/*
+ * Grow the filesystem of an extended LV after the VG lock is released.
+ * The LV is already active with its new size, so the VG metadata is
+ * not needed, and other commands on the VG need not wait for fsadm.
+ */
+int lv_resize_fs(struct cmd_context *cmd, struct lvresize_params *lp)
+{
+	if (!_fsadm_exec(cmd, FSADM_CMD_RESIZE, lp->resizefs_path, lp->resizefs_size,
+			 lp->yes, lp->force, NULL)) {
+		log_error("Filesystem resize of %s failed.", lp->resizefs_path);
+		return 0;
+	}
+
+	return 1;
+}
+
 static uint32_t _adjust_amount(dm_percent_t percent, int policy_threshold, int policy_amount)
 {
 	if (!((50 * DM_PERCENT_1) < percent && percent <= DM_PERCENT_100) ||
@@ -5845,6 +6062,7 @@ int lv_resize(struct logical_volume *lv,
 	int status;
 	struct device *dev;
 	char name[PATH_MAX];
+	char lv_path[PATH_MAX];
 
 	if (!_lvresize_check(lv, lp))
 		return_0;
@@ -6062,9 +6280,16 @@ out:
 	log_print_unless_silent("Logical volume %s successfully resized.",
 				display_lvname(lv));
 
-	if (lp->resizefs && (lp->resize == LV_EXTEND) &&
-	    !_fsadm_cmd(FSADM_CMD_RESIZE, lv, lp->extents, lp->yes, lp->force, NULL))
-		return_0;
+	if (lp->resizefs && (lp->resize == LV_EXTEND)) {
+		/* Unless it is deactivated below, grow the fs once unlocked */
+		if (!activated) {
+			if (!_fsadm_lv_path(lv, lv_path, sizeof(lv_path)) ||
+			    !(lp->resizefs_path = dm_pool_strdup(cmd->mem, lv_path)))
+				return_0;
+			lp->resizefs_size = (uint64_t) lp->extents * (vg->extent_size / 2);
+		} else if (!_fsadm_cmd(FSADM_CMD_RESIZE, lv, lp->extents, lp->yes, lp->force, NULL))
+			return_0;
+	}
 
 	ret = 1;
 bad:
@@ -6433,6 +6658,8 @@ int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 	struct seg_list *sl;
 	struct lv_segment *seg = first_seg(lv);
 	int is_last_pool = lv_is_pool(lv);
+	char msg[NAME_LEN + 64];
+	char *msg_dup;
 
 	vg = lv->vg;
 
@@ -6594,7 +6821,9 @@ int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 	}
 
 	/* Clear thin pool stacked messages */
-	if (pool_lv && !pool_has_message(first_seg(pool_lv), lv, 0) &&
+	/* With deferred commit they are the deletes queued by previous removals */
+	if (pool_lv && !vg->defer_remove_commit &&
+	    !pool_has_message(first_seg(pool_lv), lv, 0) &&
 	    !update_pool_lv(pool_lv, 1)) {
 		if (force < DONT_PROMPT_OVERRIDE) {
 			log_error("Failed to update pool %s.", display_lvname(pool_lv));
@@ -6682,12 +6911,25 @@ int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 		}
 	}
 
+	if (vg->defer_remove_commit) {
+		/* vg_commit_removed_lvs() reports the removal once committed */
+		if (!suppress_remove_message && (visible || historical)) {
+			if (dm_snprintf(msg, sizeof(msg), "%sogical volume \"%s\" successfully removed",
+					historical ? "Historical l" : "L",
+					historical ? lv->this_glv->historical->name : lv->name) < 0)
+				return_0;
+			if (!(msg_dup = dm_pool_strdup(vg->vgmem, msg)) ||
+			    !str_list_add(vg->vgmem, &vg->removed_lv_msgs, msg_dup))
+				return_0;
+		}
+		return 1;
+	}
+
 	/* store it on disks */
 	if (!vg_write(vg) || !vg_commit(vg))
 		return_0;
 
 	/* Release unneeded blocks in thin pool */
-	/* TODO: defer when multiple LVs relased at once */
 	if (pool_lv && !update_pool_lv(pool_lv, 1)) {
 		if (force < DONT_PROMPT_OVERRIDE) {
 			log_error("Failed to update pool %s.", display_lvname(pool_lv));
@@ -6710,6 +6952,50 @@ int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 	return 1;
 }
 
+/*
+ * Commit the removals lv_remove_single() deferred while
+ * vg->defer_remove_commit was set: one metadata write for the whole
+ * set and one message update for each thin pool that lost volumes.
+ */
+int vg_commit_removed_lvs(struct volume_group *vg, force_t force)
+{
+	struct lv_list *lvl;
+	struct dm_str_list *sl;
+	int r = 1;
+
+	if (!vg->defer_remove_commit)
+		return 1;
+
+	vg->defer_remove_commit = 0;
+
+	if (!vg_write(vg) || !vg_commit(vg))
+		return_0;
+
+	/* Release unneeded blocks in thin pools */
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (!lv_is_thin_pool(lvl->lv) ||
+		    !pool_has_message(first_seg(lvl->lv), NULL, 0))
+			continue;
+		if (!update_pool_lv(lvl->lv, 1)) {
+			if (force < DONT_PROMPT_OVERRIDE) {
+				log_error("Failed to update pool %s.", display_lvname(lvl->lv));
+				r = 0;
+				continue;
+			}
+			log_print_unless_silent("Ignoring update failure of pool %s.",
+						display_lvname(lvl->lv));
+		}
+	}
+
+	backup(vg);
+
+	dm_list_iterate_items(sl, &vg->removed_lv_msgs)
+		log_print_unless_silent("%s", sl->str);
+	dm_list_init(&vg->removed_lv_msgs);
+
+	return r;
+}
+
 static int _lv_remove_segs_using_this_lv(struct cmd_context *cmd, struct logical_volume *lv,
 					 const force_t force, unsigned level,
 					 const char *lv_type)
@@ -7624,6 +7910,96 @@ int insert_layer_for_segments_on_pv(struct cmd_context *cmd,
 	return 1;
 }
 
+#define WIPE_ZEROOUT_STEP	(UINT64_C(64) << 20)	/* Interruptible BLKZEROOUT steps */
+#define WIPE_DIRECT_ALIGN	UINT64_C(4096)
+#define WIPE_DIRECT_MIN		(UINT64_C(1) << 20)	/* Smaller wipes go through bcache */
+#define WIPE_DIRECT_CHUNK	(UINT64_C(4) << 20)
+#define WIPE_PROGRESS_INTERVAL	5	/* Seconds */
+
+struct wipe_progress {
+	const struct logical_volume *lv;
+	time_t last;
+};
+
+static void _wipe_progress(void *context, uint64_t done_bytes, uint64_t total_bytes)
+{
+	struct wipe_progress *wpr = context;
+	time_t now = time(NULL);
+
+	if ((now - wpr->last) < WIPE_PROGRESS_INTERVAL)
+		return;
+
+	wpr->last = now;
+	log_print_unless_silent("Initializing logical volume %s: %s%% done.",
+				display_lvname(wpr->lv),
+				display_percent(wpr->lv->vg->cmd,
+						dm_make_percent(done_bytes, total_bytes)));
+}
+
+/*
+ * Write 'value' over the first 'len' bytes of the LV.
+ * Zeroes are offloaded with BLKZEROOUT when the kernel has it.
+ * Otherwise big wipes use direct writes from several threads so
+ * they do not go block by block through bcache.
+ */
+static int _wipe_lv_bytes(struct logical_volume *lv, struct device *dev,
+			  uint64_t len, uint8_t value)
+{
+	struct wipe_progress wpr = { .lv = lv, .last = time(NULL) };
+	struct dev_io_range range = { .dev = dev };
+	struct dm_list ranges;
+	uint64_t aligned = len & ~(WIPE_DIRECT_ALIGN - 1);
+	int threads = io_threads();
+
+#ifdef HAVE_BLKZEROOUT
+	if (!value) {
+		uint64_t zr[2] = { 0, WIPE_ZEROOUT_STEP };
+
+		for (/* empty */ ; zr[0] < len; zr[0] += zr[1]) {
+			if ((zr[0] + zr[1]) > len)
+				zr[1] = len - zr[0];
+
+			if (ioctl(dev->bcache_fd, BLKZEROOUT, &zr)) {
+				if (errno == EINVAL)
+					goto retry_with_writes; /* Kernel without support for BLKZEROOUT */
+				log_sys_debug("ioctl", "BLKZEROOUT");
+				log_debug("Failed to zero %s at position " FMTu64 " and size " FMTu64 ".",
+					  display_lvname(lv), zr[0], zr[1]);
+				return 0;
+			}
+
+			if (sigint_caught())
+				return_0;
+
+			_wipe_progress(&wpr, zr[0] + zr[1], len);
+		}
+
+		return 1;
+	}
+retry_with_writes:
+#endif
+	if (aligned >= WIPE_DIRECT_MIN) {
+		/* Drop anything bcache holds for the device first */
+		label_scan_invalidate(dev);
+
+		range.offset_bytes = 0;
+		range.size_bytes = aligned;
+		range.chunk_bytes = min(aligned, WIPE_DIRECT_CHUNK);
+		dm_list_init(&ranges);
+		dm_list_add(&ranges, &range.list);
+
+		if (!dev_write_ranges(&ranges, value, (threads > 0) ? threads : 1,
+				      _wipe_progress, &wpr))
+			return_0;
+	} else
+		aligned = 0;
+
+	if ((len > aligned) && !dev_set_bytes(dev, aligned, (size_t) (len - aligned), value))
+		return_0;
+
+	return 1;
+}
+
 /*
  * Initialize the LV with 'value'.
  */
@@ -7715,32 +8091,10 @@ int wipe_lv(struct logical_volume *lv, struct wipe_params wp)
 			    display_size(lv->vg->cmd, zero_sectors),
 			    display_lvname(lv), wp.zero_value);
 
-#ifdef HAVE_BLKZEROOUT
-		if (!test_mode() && !wp.zero_value) {
-			/* TODO: maybe integrate with bcache_zero_set() */
-			const uint64_t end = zero_sectors << SECTOR_SHIFT;
-			uint64_t range[2] = { 0, 1024 * 1024 }; /* zeroing with 1M steps (for better ^C support) */
-			for (/* empty */ ; range[0] < end; range[0] += range[1]) {
-				if ((range[0] + range[1]) > end)
-					range[1] = end - range[0];
-
-				if (ioctl(dev->bcache_fd, BLKZEROOUT, &range)) {
-					if (errno == EINVAL)
-						goto retry_with_dev_set; /* Kernel without support for BLKZEROOUT */
-					log_sys_debug("ioctl", "BLKZEROOUT");
-					sigint_restore();
-					label_scan_invalidate(dev);
-					log_error("%s logical volume %s at position " FMTu64 " and size " FMTu64 ".",
-						  sigint_caught() ? "Interrupted initialization of" : "Failed to initialize",
-						  display_lvname(lv), range[0], range[1]);
-					return 0;
-				}
-			}
-		} else
-retry_with_dev_set:
-#endif
-		if (!dev_set_bytes(dev, UINT64_C(0), (size_t) zero_sectors << SECTOR_SHIFT, wp.zero_value)) {
+		if (!test_mode() &&
+		    !_wipe_lv_bytes(lv, dev, zero_sectors << SECTOR_SHIFT, (uint8_t) wp.zero_value)) {
 			sigint_restore();
+			label_scan_invalidate(dev);
 			log_error("%s %s of logical volume %s with value %d.",
 				  sigint_caught() ? "Interrupted initialization" : "Failed to initialize",
 				  display_size(lv->vg->cmd, zero_sectors),
@@ -8443,6 +8797,10 @@ static struct logical_volume *_lv_create_an_lv(struct volume_group *vg,
 	if (lv_activation_skip(lv, lp->activate, lp->activation_skip & ACTIVATION_SKIP_IGNORE))
 		lp->activate = CHANGE_AN;
 
+	/* lv_create_batch() commits and activates the whole batch */
+	if (lp->defer_commit)
+		goto out;
+
 	/* store vg on disk(s) */
 	if (!vg_write(vg) || !vg_commit(vg))
 		/* Pool created metadata LV, but better avoid recover when vg_write/commit fails */
@@ -8805,3 +9163,183 @@ struct logical_volume *lv_create_single(struct volume_group *vg,
 
 	return lv;
 }
+
+int lv_create_batch(struct volume_group *vg, struct lvcreate_params *lp,
+		    struct dm_list *batch)
+{
+	struct cmd_context *cmd = vg->cmd;
+	struct lvcreate_batch_lv *blv;
+	struct logical_volume *pool_lv = NULL, *origin_lv = NULL;
+	activation_change_t activate = lp->activate;
+	struct lv_status_thin_pool *tpstatus;
+	uint64_t transaction_id = 0;
+	int thin_pool_was_active = 0;
+	int r = 1;
+
+	if (lp->create_pool || lp->snapshot ||
+	    !(seg_is_striped(lp) || seg_is_thin_volume(lp))) {
+		log_error(INTERNAL_ERROR "Batch creation of %s LVs is not supported.",
+			  lp->segtype->name);
+		return 0;
+	}
+
+	/* Creating the first thin LV activates the pool */
+	if (seg_is_thin_volume(lp)) {
+		if (!lp->pool_name || !(pool_lv = find_lv(vg, lp->pool_name))) {
+			log_error("Thin pool %s not found in volume group %s.",
+				  lp->pool_name ? : "", vg->name);
+			return 0;
+		}
+		thin_pool_was_active = lv_is_active(pool_lv);
+		transaction_id = first_seg(pool_lv)->transaction_id;
+
+		/* Thin snapshots of one origin */
+		if (lp->origin_name && !(origin_lv = find_lv(vg, lp->origin_name))) {
+			log_error("Snapshot origin LV %s not found in volume group %s.",
+				  lp->origin_name, vg->name);
+			return 0;
+		}
+	}
+
+	/* Nothing is written until every LV of the batch is in the VG */
+	lp->defer_commit = 1;
+
+	dm_list_iterate_items(blv, batch) {
+		lp->lv_name = blv->lv_name;
+		lp->activate = activate;
+		if (seg_is_thin_volume(lp))
+			lp->virtual_extents = blv->extents;
+		else
+			lp->extents = blv->extents;
+
+		if (!(blv->lv = _lv_create_an_lv(vg, lp, lp->lv_name))) {
+			log_error("Aborting. No logical volumes were created.");
+			lp->defer_commit = 0;
+			return 0;
+		}
+
+		/* Resolved per LV from autoactivation and activation skip */
+		blv->activate = lp->activate;
+	}
+
+	lp->defer_commit = 0;
+
+	if (!vg_write(vg) || !vg_commit(vg))
+		return_0;
+
+	backup(vg);
+
+	if (test_mode()) {
+		log_verbose("Test mode: Skipping activation, zeroing and signature wiping.");
+		goto out;
+	}
+
+	/*
+	 * Snapshots of an active thin origin: a single suspend of the origin
+	 * sends create_snap messages for the whole batch to the pool.
+	 */
+	if (origin_lv && lv_is_thin_volume(origin_lv) &&
+	    (first_seg(origin_lv)->pool_lv == pool_lv) && lv_is_active(origin_lv)) {
+		if (!(r = suspend_lv_origin(cmd, origin_lv)))
+			log_error("Failed to suspend thin snapshot origin %s.",
+				  display_lvname(origin_lv));
+		/* Note: always proceed with resume_lv() to leave critical_section */
+		if (!resume_lv_origin(cmd, origin_lv)) { /* deptree updates thin-pool */
+			log_error("Failed to resume thin snapshot origin %s.",
+				  display_lvname(origin_lv));
+			if (r)
+				/* suspend with messages was OK, only resume failed */
+				goto revert_batch; /* hard to fix things here */
+		}
+		if (!r) {
+			/* Restore transaction_id of the pool from before the canceled batch */
+			if (!lv_thin_pool_status(pool_lv, 1, &tpstatus))
+				log_error("Aborting. Failed to read transaction_id from thin pool %s.",
+					  display_lvname(pool_lv));
+			else {
+				if (tpstatus->thin_pool->transaction_id != transaction_id)
+					log_warn("WARNING: Metadata for thin pool %s have transaction_id " FMTu64
+						 ", but active pool has " FMTu64 ".",
+						 display_lvname(pool_lv), transaction_id,
+						 tpstatus->thin_pool->transaction_id);
+				dm_pool_destroy(tpstatus->mem);
+				log_debug_metadata("Restoring previous transaction_id " FMTu64 " for thin pool %s.",
+						   transaction_id, display_lvname(pool_lv));
+				first_seg(pool_lv)->transaction_id = transaction_id;
+				/* no delete of never existing thin devices */
+				dm_list_iterate_items(blv, batch)
+					first_seg(blv->lv)->device_id = 0;
+			}
+			goto revert_batch;
+		}
+		/* At this point remove pool messages, snapshots exist in the pool */
+		if (!update_pool_lv(pool_lv, 0)) {
+			stack;
+			goto revert_batch;
+		}
+	}
+
+	/* A single thin pool message transaction creates all thin devices */
+	if (pool_lv && !dm_list_empty(&first_seg(pool_lv)->thin_messages)) {
+		if (!lv_is_active(pool_lv) && !activate_lv(cmd, pool_lv)) {
+			log_error("Failed to activate thin pool %s.",
+				  display_lvname(pool_lv));
+			return 0;
+		}
+		if (!update_pool_lv(pool_lv, 1))
+			return_0;
+	}
+
+	dm_list_iterate_items(blv, batch) {
+		/* Do not scan this LV until properly zeroed/wiped. */
+		if (_should_wipe_lv(lp, blv->lv, 0))
+			blv->lv->status |= LV_NOSCAN;
+
+		if (!lv_active_change(cmd, blv->lv, blv->activate)) {
+			log_error("Failed to activate new LV %s.", display_lvname(blv->lv));
+			r = 0;
+			continue;
+		}
+
+		if (_should_wipe_lv(lp, blv->lv, !lp->suppress_zero_warn) &&
+		    !wipe_lv(blv->lv, (struct wipe_params)
+			     {
+				     .do_zero = lp->zero,
+				     .do_wipe_signatures = lp->wipe_signatures,
+				     .yes = lp->yes,
+				     .force = lp->force,
+			     })) {
+			log_error("Failed to wipe start of new LV %s.",
+				  display_lvname(blv->lv));
+			r = 0;
+		}
+	}
+
+	if (pool_lv && !thin_pool_was_active && !deactivate_lv(cmd, pool_lv)) {
+		log_error("Failed to deactivate thin pool %s.",
+			  display_lvname(pool_lv));
+		r = 0;
+	}
+out:
+	dm_list_iterate_items(blv, batch)
+		log_print_unless_silent("Logical volume \"%s\" created.", blv->lv->name);
+
+	return r;
+
+revert_batch:
+	/* FIXME Better to revert to backup of metadata? */
+	dm_list_iterate_items(blv, batch)
+		if (!lv_remove(blv->lv))
+			goto_bad;
+
+	if (!vg_write(vg) || !vg_commit(vg))
+		goto_bad;
+
+	backup(vg);
+
+	return 0;
+bad:
+	log_error("Manual intervention may be required to remove "
+		  "abandoned LV(s) before retrying.");
+	return 0;
+}
@@ -650,6 +650,7 @@ struct pvcreate_params {
 struct lvresize_params {
 	int argc;
 	char **argv;
+	int lv_argc;	/* leading argv entries naming more LVs (--use-policies) */
 
 	const char *vg_name; /* only-used when VG is not yet opened (in /tools) */
 	const char *lv_name;
@@ -692,6 +693,8 @@ struct lvresize_params {
 	const char *lockopt;
 	char *lockd_lv_refresh_path; /* set during resize to use for refresh at the end */
 	char *lockd_lv_refresh_uuid; /* set during resize to use for refresh at the end */
+	char *resizefs_path; /* set during extend to grow the fs at the end, unlocked */
+	uint64_t resizefs_size; /* in KiB */
 };
 
 void pvcreate_params_set_defaults(struct pvcreate_params *pp);
@@ -735,6 +738,7 @@ uint32_t vg_lock_newname(struct cmd_context *cmd, const char *vgname);
 int lv_resize(struct logical_volume *lv,
 	      struct lvresize_params *lp,
 	      struct dm_list *pvh);
+int lv_resize_fs(struct cmd_context *cmd, struct lvresize_params *lp);
 
 struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const char *vgid,
 			     uint32_t read_flags, uint32_t lockd_state,
@@ -742,6 +746,7 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 struct volume_group *vg_read_for_update(struct cmd_context *cmd, const char *vg_name,
 			 const char *vgid, uint32_t read_flags, uint32_t lockd_state);
 struct volume_group *vg_read_orphans(struct cmd_context *cmd, const char *orphan_vgname);
+void vg_read_prefetch(struct cmd_context *cmd, const char *vgname, const char *vgid);
 
 /* pe_start and pe_end relate to any existing data so that new metadata
 * areas can avoid overlap */
@@ -762,6 +767,7 @@ uint32_t pv_list_extents_free(const struct dm_list *pvh);
 
 int validate_new_vg_name(struct cmd_context *cmd, const char *vg_name);
 int vg_validate(struct volume_group *vg);
+int vg_mark_lv_changed(struct logical_volume *lv);
 struct volume_group *vg_create(struct cmd_context *cmd, const char *vg_name);
 struct volume_group *vg_lock_and_create(struct cmd_context *cmd, const char *vg_name, int *exists);
 int vg_remove_mdas(struct volume_group *vg);
@@ -845,6 +851,7 @@ int historical_glv_remove(struct generic_logical_volume *historical_glv);
 
 int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 		     force_t force, int suppress_remove_message);
+int vg_commit_removed_lvs(struct volume_group *vg, force_t force);
 
 int lv_remove_with_dependencies(struct cmd_context *cmd, struct logical_volume *lv,
 				force_t force, unsigned level);
@@ -901,6 +908,12 @@ struct lv_status_thin {
 	dm_percent_t usage;
 };
 
+int thin_pool_history_record(const struct logical_volume *lv,
+			     dm_percent_t data, dm_percent_t metadata);
+/* Fill rate in percent per hour, returns 0 without enough history */
+int thin_pool_history_forecast(const struct logical_volume *lv, int metadata,
+			       dm_percent_t *rate, uint64_t *seconds_to_full);
+
 const char *get_pool_discards_name(thin_discards_t discards);
 int set_pool_discards(thin_discards_t *discards, const char *str);
 struct logical_volume *alloc_pool_metadata(struct logical_volume *pool_lv,
@@ -971,6 +984,7 @@ struct lvcreate_params {
 	unsigned needs_lockd_init : 1;
 	unsigned ignore_type : 1;
 	unsigned is_metadata : 1; /* created LV will be used as metadata LV (and can be zeroed) */
+	unsigned defer_commit : 1; /* leave VG uncommitted and LV inactive, see lv_create_batch() */
 
 	const char *vg_name; /* only-used when VG is not yet opened (in /tools) */
 	const char *lv_name; /* all */
@@ -986,6 +1000,8 @@ struct lvcreate_params {
 
 	unsigned stripes_supplied; /* striped/RAID */
 	unsigned stripe_size_supplied; /* striped/RAID */
+	unsigned stripes_auto; /* striped, chosen from the PVs */
+	unsigned stripe_size_auto; /* striped, chosen from the PVs */
 
 	uint32_t mirrors; /* mirror/RAID */
 
@@ -1029,6 +1045,26 @@ struct lvcreate_params {
 struct logical_volume *lv_create_single(struct volume_group *vg,
 					struct lvcreate_params *lp);
 
+/*
+ * One LV of a batch for lv_create_batch().
+ */
+struct lvcreate_batch_lv {
+	struct dm_list list;
+	const char *lv_name;
+	uint32_t extents;	/* virtual extents for thin LVs, unused for snapshots */
+	activation_change_t activate;
+	struct logical_volume *lv;
+};
+
+/*
+ * Create linear, striped or thin LVs described by lp with the names
+ * and sizes in the batch using a single metadata commit.
+ * With lp->origin_name the batch are thin snapshots of that origin,
+ * all taken within a single suspend of an active origin.
+ */
+int lv_create_batch(struct volume_group *vg, struct lvcreate_params *lp,
+		    struct dm_list *batch);
+
 /*
  * The activation can be skipped for selected LVs. Some LVs are skipped
  * by default (e.g. thin snapshots), others can be skipped on demand by
@@ -1089,6 +1125,7 @@ int lv_name_is_used_in_vg(const struct volume_group *vg, const char *name, int *
 
 int lv_is_on_pv(struct logical_volume *lv, struct physical_volume *pv);
 int lv_is_on_pvs(struct logical_volume *lv, struct dm_list *pvs);
+int lv_is_on_vg_pvs(struct logical_volume *lv, struct volume_group *vg);
 int get_pv_list_for_lv(struct dm_pool *mem,
 		       struct logical_volume *lv, struct dm_list *pvs);
 
@@ -1259,6 +1296,8 @@ uint32_t raid_rmeta_extents_delta(struct cmd_context *cmd,
 uint32_t raid_rimage_extents(const struct segment_type *segtype,
 			     uint32_t extents, uint32_t stripes, uint32_t data_copies);
 uint32_t raid_ensure_min_region_size(const struct logical_volume *lv, uint64_t raid_size, uint32_t region_size);
+uint32_t raid_shared_max_recovery_rate(struct dm_pool *mem, const struct lv_segment *seg,
+				       uint32_t bandwidth);
 int lv_raid_change_region_size(struct logical_volume *lv,
                                int yes, int force, uint32_t new_region_size);
 int lv_raid_in_sync(const struct logical_volume *lv);
@@ -1315,6 +1354,27 @@ int validate_lv_cache_create_origin(const struct logical_volume *origin_lv);
 struct logical_volume *lv_cache_create(struct logical_volume *pool_lv,
 				       struct logical_volume *origin_lv);
 int lv_cache_wait_for_clean(struct logical_volume *cache_lv, int *is_clean);
+int lv_cache_flush_start(struct logical_volume *cache_lv, uint64_t *dirty);
+
+/* Pacing and progress reporting of a cache or writecache flush */
+struct cache_flush_progress {
+	uint64_t last_dirty;
+	uint64_t last_usec;
+	uint64_t last_report_usec;
+	unsigned wait_ms;
+};
+void cache_flush_progress_init(struct cache_flush_progress *fp);
+unsigned cache_flush_progress(struct cache_flush_progress *fp,
+			      const struct logical_volume *lv, uint64_t dirty);
+
+/* I/O seen on an LV over a sampling interval, see lv_sample_io() */
+struct lv_io_sample {
+	uint64_t ios;
+	uint64_t sectors;
+	unsigned areas;		/* areas the LV was split into */
+	unsigned areas_used;	/* areas receiving 90% of the I/O */
+};
+uint32_t cache_chunk_size_from_sample(const struct lv_io_sample *sample);
 int lv_cache_remove(struct logical_volume *cache_lv);
 int lv_detach_writecache_cachevol(struct logical_volume *cache_lv, int noflush);
 int wipe_cache_pool(struct logical_volume *cache_pool_lv);
@@ -1338,6 +1398,7 @@ const char *get_vdo_operating_mode_name(enum dm_vdo_operating_mode mode);
 const char *get_vdo_write_policy_name(enum dm_vdo_write_policy policy);
 uint64_t get_vdo_pool_virtual_size(const struct lv_segment *vdo_pool_seg);
 int update_vdo_pool_virtual_size(struct lv_segment *vdo_pool_seg);
+void vdo_stats_cache_destroy(struct cmd_context *cmd);
 int parse_vdo_pool_status(struct dm_pool *mem, const struct logical_volume *vdo_pool_lv,
 			  const char *params, struct lv_status_vdo *status);
 struct logical_volume *convert_vdo_pool_lv(struct logical_volume *data_lv,
@@ -1434,5 +1495,6 @@ int lv_get_raid_integrity_settings(struct logical_volume *lv, struct integrity_s
 int integrity_mode_set(const char *mode, struct integrity_settings *settings);
 int lv_integrity_mismatches(struct cmd_context *cmd, const struct logical_volume *lv, uint64_t *mismatches);
 int lv_raid_integrity_total_mismatches(struct cmd_context *cmd, const struct logical_volume *lv, uint64_t *mismatches);
+int lv_integrity_init_percent(struct cmd_context *cmd, const struct logical_volume *lv, dm_percent_t *percent);
 
 #endif
@@ -34,6 +34,7 @@
 #include "lib/config/defaults.h"
 #include "lib/locking/lvmlockd.h"
 #include "lib/notify/lvmnotify.h"
+#include "lib/log/timing.h"
 
 #include <time.h>
 #include <math.h>
@@ -413,10 +414,24 @@ int add_pv_to_vg(struct volume_group *vg, const char *pv_name,
 	return 1;
 }
 
+static void _move_pvl(struct volume_group *vg_from, struct volume_group *vg_to,
+		      struct pv_list *pvl)
+{
+	struct physical_volume *pv = pvl->pv;
+
+	del_pvl_from_vgs(vg_from, pvl);
+	add_pvl_to_vgs(vg_to, pvl);
+
+	vg_from->extent_count -= pv_pe_count(pv);
+	vg_to->extent_count += pv_pe_count(pv);
+
+	vg_from->free_count -= pv_pe_count(pv) - pv_pe_alloc_count(pv);
+	vg_to->free_count += pv_pe_count(pv) - pv_pe_alloc_count(pv);
+}
+
 static int _move_pv(struct volume_group *vg_from, struct volume_group *vg_to,
 		    const char *pv_name, int enforce_pv_from_source)
 {
-	struct physical_volume *pv;
 	struct pv_list *pvl;
 
 	/* FIXME: handle tags */
@@ -439,16 +454,7 @@ static int _move_pv(struct volume_group *vg_from, struct volume_group *vg_to,
 	    vg_bad_status_bits(vg_to, RESIZEABLE_VG))
 		return 0;
 
-	del_pvl_from_vgs(vg_from, pvl);
-	add_pvl_to_vgs(vg_to, pvl);
-
-	pv = pvl->pv;
-
-	vg_from->extent_count -= pv_pe_count(pv);
-	vg_to->extent_count += pv_pe_count(pv);
-
-	vg_from->free_count -= pv_pe_count(pv) - pv_pe_alloc_count(pv);
-	vg_to->free_count += pv_pe_count(pv) - pv_pe_alloc_count(pv);
+	_move_pvl(vg_from, vg_to, pvl);
 
 	return 1;
 }
@@ -459,14 +465,60 @@ int move_pv(struct volume_group *vg_from, struct volume_group *vg_to,
 	return _move_pv(vg_from, vg_to, pv_name, 1);
 }
 
+/*
+ * Collect the PVs under lv and its sub LVs that are still in vg_from.
+ * PVs record the VG they are linked into, so each area is checked
+ * without searching either VG.  PVs already moved to vg_to are skipped.
+ */
+static int _collect_pvs_used_by_lv(struct volume_group *vg_from,
+				   struct volume_group *vg_to,
+				   struct logical_volume *lv,
+				   struct dm_hash_table *pvs)
+{
+	struct lv_segment *lvseg;
+	struct physical_volume *pv;
+	unsigned s;
+
+	if (lv->vg != vg_from) {
+		log_error("Logical volume %s not in volume group %s",
+			  lv->name, vg_from->name);
+		return 0;
+	}
+
+	dm_list_iterate_items(lvseg, &lv->segments) {
+		if (lvseg->log_lv &&
+		    !_collect_pvs_used_by_lv(vg_from, vg_to, lvseg->log_lv, pvs))
+			return_0;
+		for (s = 0; s < lvseg->area_count; s++) {
+			if (seg_type(lvseg, s) == AREA_PV) {
+				pv = seg_pv(lvseg, s);
+				if (pv->vg == vg_to)
+					continue;
+				if (pv->vg != vg_from) {
+					log_error("Physical volume %s not in volume group %s",
+						  pv_dev_name(pv), vg_from->name);
+					return 0;
+				}
+				if (!dm_hash_insert_binary(pvs, &pv, sizeof(pv), pv))
+					return_0;
+			} else if (seg_type(lvseg, s) == AREA_LV) {
+				if (!_collect_pvs_used_by_lv(vg_from, vg_to, seg_lv(lvseg, s), pvs))
+					return_0;
+			}
+		}
+	}
+
+	return 1;
+}
+
 int move_pvs_used_by_lv(struct volume_group *vg_from,
 			struct volume_group *vg_to,
 			const char *lv_name)
 {
-	struct lv_segment *lvseg;
-	unsigned s;
+	struct dm_hash_table *pvs;
+	struct pv_list *pvl, *tpvl;
 	struct lv_list *lvl;
-	struct logical_volume *lv;
+	int r = 0;
 
 	/* FIXME: handle tags */
 	if (!(lvl = find_lv_in_vg(vg_from, lv_name))) {
@@ -479,25 +531,22 @@ int move_pvs_used_by_lv(struct volume_group *vg_from,
 	    vg_bad_status_bits(vg_to, RESIZEABLE_VG))
 		return 0;
 
-	dm_list_iterate_items(lvseg, &lvl->lv->segments) {
-		if (lvseg->log_lv)
-			if (!move_pvs_used_by_lv(vg_from, vg_to,
-						     lvseg->log_lv->name))
-				return_0;
-		for (s = 0; s < lvseg->area_count; s++) {
-			if (seg_type(lvseg, s) == AREA_PV) {
-				if (!_move_pv(vg_from, vg_to,
-					      pv_dev_name(seg_pv(lvseg, s)), 0))
-					return_0;
-			} else if (seg_type(lvseg, s) == AREA_LV) {
-				lv = seg_lv(lvseg, s);
-				if (!move_pvs_used_by_lv(vg_from, vg_to,
-							     lv->name))
-				    return_0;
-			}
-		}
-	}
-	return 1;
+	if (!(pvs = dm_hash_create(64)))
+		return_0;
+
+	if (!_collect_pvs_used_by_lv(vg_from, vg_to, lvl->lv, pvs))
+		goto_out;
+
+	/* One pass over vg_from relinks every collected PV */
+	dm_list_iterate_items_safe(pvl, tpvl, &vg_from->pvs)
+		if (dm_hash_lookup_binary(pvs, &pvl->pv, sizeof(pvl->pv)))
+			_move_pvl(vg_from, vg_to, pvl);
+
+	r = 1;
+out:
+	dm_hash_destroy(pvs);
+
+	return r;
 }
 
 int validate_new_vg_name(struct cmd_context *cmd, const char *vg_name)
@@ -974,39 +1023,72 @@ static void _vg_wipe_cached_precommitted(struct volume_group *vg)
 {
 	release_vg(vg->vg_precommitted);
 	vg->vg_precommitted = NULL;
+	free(vg->vg_precommitted_text);
+	vg->vg_precommitted_text = NULL;
 }
 
-static void _vg_move_cached_precommitted_to_committed(struct volume_group *vg)
+static void _vg_wipe_cached_committed(struct volume_group *vg)
 {
 	release_vg(vg->vg_committed);
+	vg->vg_committed = NULL;
+	free(vg->vg_committed_text);
+	vg->vg_committed_text = NULL;
+}
+
+static void _vg_move_cached_precommitted_to_committed(struct volume_group *vg)
+{
+	_vg_wipe_cached_committed(vg);
 	vg->vg_committed = vg->vg_precommitted;
+	vg->vg_committed_text = vg->vg_precommitted_text;
 	vg->vg_precommitted = NULL;
+	vg->vg_precommitted_text = NULL;
 }
 
 /*
  * Update content of precommitted VG
  *
- * TODO: Optimize in the future, since lvmetad needs similar
- *       config tree processing in lvmetad_vg_update().
+ * Only the metadata text is kept here; it is parsed into a VG by
+ * vg_get_committed() once the copy is needed after vg_commit.
+ * The same text is written to the metadata areas, so it carries
+ * the description of this write.
  */
-static int _vg_update_embedded_copy(struct volume_group *vg, struct volume_group **vg_embedded)
+static size_t _vg_update_embedded_copy(struct volume_group *vg, char **vg_embedded_text)
 {
-	struct dm_config_tree *cft;
+	char desc[2048];
+	size_t size;
 
 	_vg_wipe_cached_precommitted(vg);
 
-	/* Copy the VG using an export followed by import */
-	if (!(cft = export_vg_to_config_tree(vg)))
-		return_0;
+	if (!vg->write_count++)
+		(void) dm_snprintf(desc, sizeof(desc), "Write from %s.", vg->cmd->cmd_line);
+	else
+		(void) dm_snprintf(desc, sizeof(desc), "Write[%u] from %s.", vg->write_count, vg->cmd->cmd_line);
 
-	if (!(*vg_embedded = import_vg_from_config_tree(vg->cmd, vg->fid, cft))) {
-		dm_config_destroy(cft);
-		return_0;
+	if (!(size = text_vg_export_raw(vg, desc, vg_embedded_text, NULL))) {
+		log_error("Could not format metadata for VG %s.", vg->name);
+		return 0;
 	}
 
-	dm_config_destroy(cft);
+	return size;
+}
+
+/*
+ * Return the committed copy of the VG, importing it from the saved
+ * metadata text on first use.  NULL means vg itself is the committed one.
+ */
+struct volume_group *vg_get_committed(struct volume_group *vg)
+{
+	if (!vg->vg_committed && vg->vg_committed_text) {
+		if (!(vg->vg_committed = import_vg_from_buffer(vg->cmd, vg->fid, vg->vg_committed_text))) {
+			log_error("Failed to import committed copy of VG %s.", vg->name);
+			return NULL;
+		}
 
-	return 1;
+		free(vg->vg_committed_text);
+		vg->vg_committed_text = NULL;
+	}
+
+	return vg->vg_committed;
 }
 
 int lv_has_unknown_segments(const struct logical_volume *lv)
@@ -1653,9 +1735,14 @@ struct lv_list *find_lv_in_vg(const struct volume_group *vg,
 	else
 		ptr = lv_name;
 
+	if ((lvl = lv_index_find_name((struct volume_group *) vg, ptr)))
+		return lvl;
+
 	dm_list_iterate_items(lvl, &vg->lvs)
-		if (!strcmp(lvl->lv->name, ptr))
+		if (!strcmp(lvl->lv->name, ptr)) {
+			lv_index_add((struct volume_group *) vg, lvl);
 			return lvl;
+		}
 
 	return NULL;
 }
@@ -1677,9 +1764,14 @@ struct logical_volume *find_lv_in_vg_by_lvid(struct volume_group *vg,
 {
 	struct lv_list *lvl;
 
+	if ((lvl = lv_index_find_lvid(vg, lvid)))
+		return lvl->lv;
+
 	dm_list_iterate_items(lvl, &vg->lvs)
-		if (!strncmp(lvl->lv->lvid.s, lvid->s, sizeof(*lvid)))
+		if (!strncmp(lvl->lv->lvid.s, lvid->s, sizeof(*lvid))) {
+			lv_index_add(vg, lvl);
 			return lvl->lv;
+		}
 
 	return NULL;
 }
@@ -1748,14 +1840,105 @@ struct physical_volume *find_pv(struct volume_group *vg, struct device *dev)
 	return NULL;
 }
 
-/* Find segment at a given logical extent in an LV */
+/*
+ * Sorted array of an LV's segments for find_seg_by_le(), built once
+ * an LV has more than LV_SEG_INDEX_MIN segments.  lv->segments is
+ * changed directly all over the tree so nothing invalidates the
+ * index: an entry is only used while the segment is still linked
+ * into a list and still has the le and len it was indexed with,
+ * otherwise the list is searched and the index rebuilt.
+ */
+#define LV_SEG_INDEX_MIN 32
+
+struct lv_seg_index_entry {
+	struct lv_segment *seg;
+	uint32_t le;
+	uint32_t len;
+};
+
+struct lv_seg_index {
+	unsigned count;
+	unsigned size;
+	struct lv_seg_index_entry entries[];
+};
+
+void lv_free_seg_index(struct logical_volume *lv)
+{
+	free(lv->seg_index);
+	lv->seg_index = NULL;
+}
+
+static void _seg_index_build(struct logical_volume *lv)
+{
+	struct lv_seg_index *idx = lv->seg_index;
+	struct lv_segment *seg;
+	unsigned count = dm_list_size(&lv->segments);
+	unsigned size;
+
+	if (!idx || (idx->size < count)) {
+		size = (idx && (2 * idx->size > count)) ? 2 * idx->size : count;
+		if (!(idx = realloc(idx, sizeof(*idx) + size * sizeof(idx->entries[0])))) {
+			log_debug("Failed to allocate segment index for %s.",
+				  display_lvname(lv));
+			lv_free_seg_index(lv);
+			return;
+		}
+		idx->size = size;
+		lv->seg_index = idx;
+	}
+
+	idx->count = 0;
+	dm_list_iterate_items(seg, &lv->segments) {
+		idx->entries[idx->count].seg = seg;
+		idx->entries[idx->count].le = seg->le;
+		idx->entries[idx->count].len = seg->len;
+		idx->count++;
+	}
+}
+
+static struct lv_segment *_seg_index_find(const struct logical_volume *lv, uint32_t le)
+{
+	const struct lv_seg_index *idx = lv->seg_index;
+	const struct lv_seg_index_entry *e;
+	struct lv_segment *seg;
+	unsigned lo = 0, hi = idx->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		e = &idx->entries[mid];
+
+		if (le < e->le)
+			hi = mid;
+		else if (le - e->le >= e->len)
+			lo = mid + 1;
+		else {
+			seg = e->seg;
+			if ((seg->lv != lv) || (seg->le != e->le) || (seg->len != e->len) ||
+			    (seg->list.n->p != &seg->list) || (seg->list.p->n != &seg->list))
+				return NULL;	/* Stale */
+			return seg;
+		}
+	}
+
+	return NULL;
+}
+
 struct lv_segment *find_seg_by_le(const struct logical_volume *lv, uint32_t le)
 {
 	struct lv_segment *seg;
+	unsigned count = 0;
 
-	dm_list_iterate_items(seg, &lv->segments)
-		if (le >= seg->le && le < seg->le + seg->len)
+	if (lv->seg_index && (seg = _seg_index_find(lv, le)))
+		return seg;
+
+	dm_list_iterate_items(seg, &lv->segments) {
+		if (le >= seg->le && le < seg->le + seg->len) {
+			if (lv->seg_index || (count >= LV_SEG_INDEX_MIN))
+				_seg_index_build((struct logical_volume *) lv);
 			return seg;
+		}
+		count++;
+	}
 
 	return NULL;
 }
@@ -1802,9 +1985,10 @@ int vgs_are_compatible(struct cmd_context *cmd __attribute__((unused)),
 		       struct volume_group *vg_from,
 		       struct volume_group *vg_to)
 {
-	struct lv_list *lvl1, *lvl2;
+	struct lv_list *lvl;
 	struct pv_list *pvl;
-	const char *name1, *name2;
+	struct dm_hash_table *names;
+	const char *name;
 
 	if (lvs_in_vg_activated(vg_from)) {
 		log_error("Logical volumes in \"%s\" must be inactive",
@@ -1844,22 +2028,30 @@ int vgs_are_compatible(struct cmd_context *cmd __attribute__((unused)),
 	}
 
 	/* Check no conflicts with LV names */
-	dm_list_iterate_items(lvl1, &vg_to->lvs) {
-		name1 = lvl1->lv->name;
+	if (!(names = dm_hash_create(dm_list_size(&vg_from->lvs) + 16)))
+		return_0;
 
-		dm_list_iterate_items(lvl2, &vg_from->lvs) {
-			name2 = lvl2->lv->name;
+	dm_list_iterate_items(lvl, &vg_from->lvs)
+		if (!dm_hash_insert(names, lvl->lv->name, lvl)) {
+			dm_hash_destroy(names);
+			return_0;
+		}
 
-			if (!strcmp(name1, name2)) {
-				log_error("Duplicate logical volume "
-					  "name \"%s\" "
-					  "in \"%s\" and \"%s\"",
-					  name1, vg_to->name, vg_from->name);
-				return 0;
-			}
+	dm_list_iterate_items(lvl, &vg_to->lvs) {
+		name = lvl->lv->name;
+
+		if (dm_hash_lookup(names, name)) {
+			log_error("Duplicate logical volume "
+				  "name \"%s\" "
+				  "in \"%s\" and \"%s\"",
+				  name, vg_to->name, vg_from->name);
+			dm_hash_destroy(names);
+			return 0;
 		}
 	}
 
+	dm_hash_destroy(names);
+
 	/* Check no PVs are constructed from either VG */
 	dm_list_iterate_items(pvl, &vg_to->pvs) {
 		if (pv_uses_vg(pvl->pv, vg_from)) {
@@ -2250,6 +2442,187 @@ static int _validate_lv_lock_args(struct logical_volume *lv)
 	return r;
 }
 
+/*
+ * Checks of a single LV that do not depend on the other LVs.
+ * Segments referencing other LVs are checked by check_lv_segments(lv, 1).
+ */
+static int _validate_lv(struct logical_volume *lv)
+{
+	struct volume_group *vg = lv->vg;
+	struct dm_str_list *sl;
+	char uuid[64] __attribute__((aligned(8)));
+	char uuid2[64] __attribute__((aligned(8)));
+	size_t dev_name_len;
+	int r = 1;
+
+	if (lv->status & LV_REMOVED) {
+		log_error(INTERNAL_ERROR "LV %s is marked as removed while it's "
+			  "still part of the VG %s", lv->name, vg->name);
+		r = 0;
+	}
+
+	if (lv->status & LVM_WRITE_LOCKED) {
+		log_error(INTERNAL_ERROR "LV %s has external flag LVM_WRITE_LOCKED set internally.",
+			  lv->name);
+		r = 0;
+	}
+
+	dev_name_len = strlen(lv->name) + strlen(vg->name) + 3;
+	if (dev_name_len >= NAME_LEN) {
+		log_error(INTERNAL_ERROR "LV name \"%s/%s\" length %"
+			  PRIsize_t " is not supported.",
+			  vg->name, lv->name, dev_name_len);
+		r = 0;
+	}
+
+	if (!id_equal(&lv->lvid.id[0], &vg->id)) {
+		if (!id_write_format(&lv->lvid.id[0], uuid,
+				     sizeof(uuid)))
+			stack;
+		if (!id_write_format(&vg->id, uuid2,
+				     sizeof(uuid2)))
+			stack;
+		log_error(INTERNAL_ERROR "LV %s has VG UUID %s but its VG %s has UUID %s",
+			  lv->name, uuid, vg->name, uuid2);
+		r = 0;
+	}
+
+	if (!check_lv_segments(lv, 0)) {
+		log_error(INTERNAL_ERROR "LV segments corrupted in %s.",
+			  lv->name);
+		r = 0;
+	}
+
+	if (lv->alloc == ALLOC_CLING_BY_TAGS) {
+		log_error(INTERNAL_ERROR "LV %s allocation policy set to invalid cling_by_tags.",
+			  lv->name);
+		r = 0;
+	}
+
+	if (!validate_name(lv->name)) {
+		log_error(INTERNAL_ERROR "LV name %s has invalid form.", lv->name);
+		r = 0;
+	}
+
+	dm_list_iterate_items(sl, &lv->tags)
+		if (!validate_tag(sl->str)) {
+			log_error(INTERNAL_ERROR "LV %s tag %s has invalid form.",
+				  lv->name, sl->str);
+			r = 0;
+		}
+
+	return r;
+}
+
+static int _validate_vg_header(struct volume_group *vg)
+{
+	struct dm_str_list *sl;
+	int r = 1;
+
+	if (vg->alloc == ALLOC_CLING_BY_TAGS) {
+		log_error(INTERNAL_ERROR "VG %s allocation policy set to invalid cling_by_tags.",
+			  vg->name);
+		r = 0;
+	}
+
+	if (vg->status & LVM_WRITE_LOCKED) {
+		log_error(INTERNAL_ERROR "VG %s has external flag LVM_WRITE_LOCKED set internally.",
+			  vg->name);
+		r = 0;
+	}
+
+	dm_list_iterate_items(sl, &vg->tags)
+		if (!validate_tag(sl->str)) {
+			log_error(INTERNAL_ERROR "VG %s tag %s has invalid form.",
+				  vg->name, sl->str);
+			r = 0;
+		}
+
+	return r;
+}
+
+/*
+ * Record that a command changed properties of @lv (e.g. tags or
+ * permission) but not the layout of the VG, so that vg_validate()
+ * may check just the changed LVs, see _vg_validate_changed().
+ * Changes made after marking must stay within the marked LVs.
+ */
+int vg_mark_lv_changed(struct logical_volume *lv)
+{
+	struct lv_list *lvl;
+
+	dm_list_iterate_items(lvl, &lv->vg->changed_lvs)
+		if (lvl->lv == lv)
+			return 1;
+
+	if (!(lvl = dm_pool_zalloc(lv->vg->vgmem, sizeof(*lvl)))) {
+		log_error("Failed to allocate changed LV list item.");
+		return 0;
+	}
+
+	lvl->lv = lv;
+	dm_list_add(&lv->vg->changed_lvs, &lvl->list);
+
+	return 1;
+}
+
+static int _validate_changed_lv(struct logical_volume *lv, void *data __attribute__((unused)))
+{
+	int r = 1;
+
+	if (!_validate_lv(lv))
+		r = 0;
+
+	if (!check_lv_segments(lv, 1)) {
+		log_error(INTERNAL_ERROR "LV segments corrupted in %s.",
+			  lv->name);
+		r = 0;
+	}
+
+	if (vg_is_shared(lv->vg) && lockd_lv_uses_lock(lv) && lv->lock_args &&
+	    !_validate_lv_lock_args(lv))
+		r = 0;
+
+	return r;
+}
+
+/*
+ * Validate only the LVs marked by vg_mark_lv_changed(), the LVs they
+ * use and the LVs using them.  The checks needing every LV or PV of
+ * the VG (duplicate names and ids, PV segments, LV counts) are left
+ * out as marked changes cannot affect them.
+ */
+static int _vg_validate_changed(struct volume_group *vg)
+{
+	struct lv_list *lvl;
+	struct seg_list *sl;
+	int r = 1;
+
+	if (!_validate_vg_header(vg))
+		r = 0;
+
+	dm_list_iterate_items(lvl, &vg->changed_lvs) {
+		if (find_lv_in_vg_by_lvid(vg, &lvl->lv->lvid) != lvl->lv) {
+			log_error(INTERNAL_ERROR "Changed LV %s not listed in VG %s.",
+				  lvl->lv->name, vg->name);
+			r = 0;
+			continue;
+		}
+
+		if (!_validate_changed_lv(lvl->lv, NULL))
+			r = 0;
+
+		if (!for_each_sub_lv(lvl->lv, _validate_changed_lv, NULL))
+			r = 0;
+
+		dm_list_iterate_items(sl, &lvl->lv->segs_using_this_lv)
+			if (!_validate_changed_lv(sl->seg->lv, NULL))
+				r = 0;
+	}
+
+	return r;
+}
+
 int vg_validate(struct volume_group *vg)
 {
 	struct pv_list *pvl;
@@ -2265,21 +2638,20 @@ int vg_validate(struct volume_group *vg)
 	unsigned pv_count = 0;
 	unsigned num_snapshots = 0;
 	unsigned spare_count = 0;
-	size_t vg_name_len = strlen(vg->name);
-	size_t dev_name_len;
 	struct validate_hash vhash = { NULL };
 
-	if (vg->alloc == ALLOC_CLING_BY_TAGS) {
-		log_error(INTERNAL_ERROR "VG %s allocation policy set to invalid cling_by_tags.",
-			  vg->name);
-		r = 0;
+	/* Marks are used once, a later vg_write needs new ones */
+	if (!dm_list_empty(&vg->changed_lvs)) {
+		if (find_config_tree_bool(vg->cmd, metadata_validate_changed_only_CFG, NULL)) {
+			r = _vg_validate_changed(vg);
+			dm_list_init(&vg->changed_lvs);
+			return r;
+		}
+		dm_list_init(&vg->changed_lvs);
 	}
 
-	if (vg->status & LVM_WRITE_LOCKED) {
-		log_error(INTERNAL_ERROR "VG %s has external flag LVM_WRITE_LOCKED set internally.",
-			  vg->name);
+	if (!_validate_vg_header(vg))
 		r = 0;
-	}
 
 	/* FIXME Also check there's no data/metadata overlap */
 	if (!(vhash.pvid = dm_hash_create(vg->pv_count))) {
@@ -2287,13 +2659,6 @@ int vg_validate(struct volume_group *vg)
 		return 0;
 	}
 
-	dm_list_iterate_items(sl, &vg->tags)
-		if (!validate_tag(sl->str)) {
-			log_error(INTERNAL_ERROR "VG %s tag %s has invalid form.",
-				  vg->name, sl->str);
-			r = 0;
-		}
-
 	dm_list_iterate_items(pvl, &vg->pvs) {
 		if (++pv_count > vg->pv_count) {
 			log_error(INTERNAL_ERROR "PV list corruption detected in VG %s.", vg->name);
@@ -2362,37 +2727,8 @@ int vg_validate(struct volume_group *vg)
 	dm_list_iterate_items(lvl, &vg->lvs) {
 		lv_count++;
 
-		if (lvl->lv->status & LV_REMOVED) {
-			log_error(INTERNAL_ERROR "LV %s is marked as removed while it's "
-				  "still part of the VG %s", lvl->lv->name, vg->name);
+		if (!_validate_lv(lvl->lv))
 			r = 0;
-		}
-
-		if (lvl->lv->status & LVM_WRITE_LOCKED) {
-			log_error(INTERNAL_ERROR "LV %s has external flag LVM_WRITE_LOCKED set internally.",
-				  lvl->lv->name);
-			r = 0;
-		}
-
-		dev_name_len = strlen(lvl->lv->name) + vg_name_len + 3;
-		if (dev_name_len >= NAME_LEN) {
-			log_error(INTERNAL_ERROR "LV name \"%s/%s\" length %"
-				  PRIsize_t " is not supported.",
-				  vg->name, lvl->lv->name, dev_name_len);
-			r = 0;
-		}
-
-		if (!id_equal(&lvl->lv->lvid.id[0], &lvl->lv->vg->id)) {
-			if (!id_write_format(&lvl->lv->lvid.id[0], uuid,
-					     sizeof(uuid)))
-				stack;
-			if (!id_write_format(&lvl->lv->vg->id, uuid2,
-					     sizeof(uuid2)))
-				stack;
-			log_error(INTERNAL_ERROR "LV %s has VG UUID %s but its VG %s has UUID %s",
-				  lvl->lv->name, uuid, lvl->lv->vg->name, uuid2);
-			r = 0;
-		}
 
 		if (lv_is_pool_metadata_spare(lvl->lv)) {
 			if (++spare_count > 1) {
@@ -2413,30 +2749,6 @@ int vg_validate(struct volume_group *vg)
 		if (lv_is_visible(lvl->lv))
 			lv_visible_count++;
 
-		if (!check_lv_segments(lvl->lv, 0)) {
-			log_error(INTERNAL_ERROR "LV segments corrupted in %s.",
-				  lvl->lv->name);
-			r = 0;
-		}
-
-		if (lvl->lv->alloc == ALLOC_CLING_BY_TAGS) {
-			log_error(INTERNAL_ERROR "LV %s allocation policy set to invalid cling_by_tags.",
-				  lvl->lv->name);
-			r = 0;
-		}
-
-		if (!validate_name(lvl->lv->name)) {
-			log_error(INTERNAL_ERROR "LV name %s has invalid form.", lvl->lv->name);
-			r = 0;
-		}
-
-		dm_list_iterate_items(sl, &lvl->lv->tags)
-			if (!validate_tag(sl->str)) {
-				log_error(INTERNAL_ERROR "LV %s tag %s has invalid form.",
-					  lvl->lv->name, sl->str);
-				r = 0;
-			}
-
 		if (lvl->lv->status & VISIBLE_LV)
 			continue;
 
@@ -2931,7 +3243,7 @@ static void _wipe_outdated_pvs(struct cmd_context *cmd, struct volume_group *vg)
  * After vg_write() returns success,
  * caller MUST call either vg_commit() or vg_revert()
  */
-int vg_write(struct volume_group *vg)
+static int _vg_write(struct volume_group *vg)
 {
 	struct dm_list *mdah;
 	struct pv_list *pvl, *pvl_safe, *new_pvl;
@@ -3023,13 +3335,43 @@ int vg_write(struct volume_group *vg)
 		log_warn("WARNING: updating PV header on %s for VG %s.", pv_dev_name(pvl->pv), vg->name);
 	}
 
-	dm_list_iterate_items_safe(pvl, pvl_safe, &vg->pv_write_list) {
-		if (!pv_write(vg->cmd, pvl->pv, 1))
-			return_0;
-		dm_list_del(&pvl->list);
+	/*
+	 * PV headers are written in one batch, so a VG with many new or
+	 * changed PVs (e.g. vgimportclone) does not wait for each device
+	 * in turn.  The list is kept until every write has completed.
+	 */
+	if (!dm_list_empty(&vg->pv_write_list)) {
+		dev_write_batch_begin();
+
+		dm_list_iterate_items(pvl, &vg->pv_write_list)
+			if (!pv_write(vg->cmd, pvl->pv, 1)) {
+				dev_write_batch_end();
+				return_0;
+			}
+
+		if (!dev_write_batch_end()) {
+			log_error("Failed to write PV headers for VG %s.", vg->name);
+			return 0;
+		}
+
+		dm_list_iterate_items_safe(pvl, pvl_safe, &vg->pv_write_list)
+			dm_list_del(&pvl->list);
 	}
 
-	/* Write to each copy of the metadata area */
+	/*
+	 * Export the new metadata once, before the writes, as the
+	 * precommitted copy; each metadata area writes that same text.
+	 */
+	if (!(vg->write_text_size = _vg_update_embedded_copy(vg, &vg->vg_precommitted_text)))
+		return_0;
+	vg->write_text = vg->vg_precommitted_text;
+
+	/*
+	 * Write to each copy of the metadata area.  The writes are issued
+	 * together and all complete before any mda header is changed.
+	 */
+	dev_write_batch_begin();
+
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		mda_dev = mda_get_device(mda);
 
@@ -3072,6 +3414,23 @@ int vg_write(struct volume_group *vg)
 			++ wrote;
 	}
 
+	if (!dev_write_batch_end() && !revert) {
+		dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+			if ((mda->status & MDA_FAILED) ||
+			    !dev_write_batch_failed(mda_get_device(mda)))
+				continue;
+			if (vg->cmd->handles_missing_pvs) {
+				log_warn("WARNING: Failed to write an MDA of VG %s.", vg->name);
+				mda->status |= MDA_FAILED;
+				--wrote;
+			} else
+				revert = 1;
+		}
+	}
+
+	vg->write_text = NULL;
+	vg->write_text_size = 0;
+
 	if (revert || !wrote) {
 		log_error("Failed to write VG %s.", vg->name);
 		dm_list_uniterate(mdah, &vg->fid->metadata_areas_in_use, &mda->list) {
@@ -3085,44 +3444,61 @@ int vg_write(struct volume_group *vg)
 				stack;
 			}
 		}
+		_vg_wipe_cached_precommitted(vg);
 		return 0;
 	}
 
 	/* Now pre-commit each copy of the new metadata */
+	dev_write_batch_begin();
+
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		if (mda->status & MDA_FAILED)
 			continue;
 		if (mda->ops->vg_precommit &&
 		    !mda->ops->vg_precommit(vg->fid, vg, mda)) {
 			stack;
-			/* Revert */
-			dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
-				if (mda->status & MDA_FAILED)
-					continue;
-				if (mda->ops->vg_revert &&
-				    !mda->ops->vg_revert(vg->fid, vg, mda)) {
-					stack;
-				}
-			}
-			return 0;
+			revert = 1;
+			break;
 		}
 	}
 
-	if (!_vg_update_embedded_copy(vg, &vg->vg_precommitted)) /* prepare precommited */
-		return_0;
+	if (!dev_write_batch_end())
+		revert = 1;
+
+	if (revert) {
+		dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+			if (mda->status & MDA_FAILED)
+				continue;
+			if (mda->ops->vg_revert &&
+			    !mda->ops->vg_revert(vg->fid, vg, mda)) {
+				stack;
+			}
+		}
+		_vg_wipe_cached_precommitted(vg);
+		return 0;
+	}
 
 	lockd_vg_update(vg);
 
 	return 1;
 }
 
+int vg_write(struct volume_group *vg)
+{
+	int r;
+
+	timing_start(TIMING_VG_WRITE);
+	r = _vg_write(vg);
+	timing_end(TIMING_VG_WRITE);
+
+	return r;
+}
+
 static int _vg_commit_mdas(struct volume_group *vg)
 {
 	struct metadata_area *mda, *tmda;
 	struct dm_list ignored;
-	int failed = 0;
 	int good = 0;
-	int cache_updated = 0;
 
 	/* Rearrange the metadata_areas_in_use so ignored mdas come first. */
 	dm_list_init(&ignored);
@@ -3133,31 +3509,47 @@ static int _vg_commit_mdas(struct volume_group *vg)
 	dm_list_iterate_items_safe(mda, tmda, &ignored)
 		dm_list_move(&vg->fid->metadata_areas_in_use, &mda->list);
 
-	/* Commit to each copy of the metadata area */
+	/*
+	 * Commit to each copy of the metadata area.  The mda header writes
+	 * are issued together, the metadata they point to is already on disk.
+	 */
+	dev_write_batch_begin();
+
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		if (mda->status & MDA_FAILED)
 			continue;
-		failed = 0;
 		if (mda->ops->vg_commit &&
 		    !mda->ops->vg_commit(vg->fid, vg, mda)) {
 			stack;
-			failed = 1;
-		} else
-			good++;
+			mda->status |= MDA_COMMIT_FAILED;
+		}
+	}
+
+	if (!dev_write_batch_end())
+		stack;
 
-		/* Update cache first time we succeed */
-		if (!failed && !cache_updated) {
-			lvmcache_update_vg_from_write(vg);
-			cache_updated = 1;
+	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+		if (mda->status & MDA_FAILED)
+			continue;
+		if ((mda->status & MDA_COMMIT_FAILED) ||
+		    dev_write_batch_failed(mda_get_device(mda))) {
+			mda->status &= ~MDA_COMMIT_FAILED;
+			continue;
 		}
+		good++;
 	}
+
+	/* Update cache once any copy is committed. */
+	if (good)
+		lvmcache_update_vg_from_write(vg);
+
 	if (good)
 		return 1;
 	return 0;
 }
 
 /* Commit pending changes */
-int vg_commit(struct volume_group *vg)
+static int _vg_commit(struct volume_group *vg)
 {
 	struct pv_list *pvl;
 	int ret;
@@ -3177,12 +3569,32 @@ int vg_commit(struct volume_group *vg)
 
 		/* This *is* the original now that it's commited. */
 		_vg_move_cached_precommitted_to_committed(vg);
-	}
+
+		vg_snapshot_update(vg);
+
+		/*
+		 * Freed extents are discarded only once released on disk,
+		 * and not before unlock_vg(), as LVs may still be suspended.
+		 */
+		dm_list_splice(&vg->committed_discards, &vg->pending_discards);
+	} else
+		dm_list_init(&vg->pending_discards);
 
 	/* If at least one mda commit succeeded, it was committed */
 	return ret;
 }
 
+int vg_commit(struct volume_group *vg)
+{
+	int r;
+
+	timing_start(TIMING_VG_COMMIT);
+	r = _vg_commit(vg);
+	timing_end(TIMING_VG_COMMIT);
+
+	return r;
+}
+
 /* Don't commit any pending changes */
 void vg_revert(struct volume_group *vg)
 {
@@ -3196,6 +3608,8 @@ void vg_revert(struct volume_group *vg)
 		}
 	}
 
+	dm_list_init(&vg->pending_discards);
+
 	_vg_wipe_cached_precommitted(vg); /* VG is no longer needed */
 
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
@@ -4377,10 +4791,11 @@ const struct logical_volume *lv_committed(const struct logical_volume *lv)
 	if (!lv)
 		return NULL;
 
-	if (!lv->vg->vg_committed)
+	if (!lv->vg->vg_committed && !lv->vg->vg_committed_text)
 		return lv;
 
-	vg = lv->vg->vg_committed;
+	if (!(vg = vg_get_committed(lv->vg)))
+		return_NULL;
 
 	if (!(found_lv = find_lv_in_vg_by_lvid(vg, &lv->lvid))) {
 		log_error(INTERNAL_ERROR "LV %s (UUID %s) not found in committed metadata.",
@@ -4675,11 +5090,62 @@ out:
 	return ret;
 }
 
-static struct volume_group *_vg_read(struct cmd_context *cmd,
-				     const char *vgname,
-				     const char *vgid,
-				     unsigned precommitted,
-				     int writing)
+/*
+ * Start reading the metadata text of a VG that is going to be read soon,
+ * so the reads for several VGs can be in flight together.  Only the text
+ * the label scan found is prefetched.  The mda_header is reread under the
+ * VG lock by _scan_text_mismatch(), and the text is only used if that
+ * header still points at it.
+ */
+void vg_read_prefetch(struct cmd_context *cmd, const char *vgname, const char *vgid)
+{
+	struct dm_list mda_list;
+	struct mda_list *mdal, *safe;
+	struct metadata_area *mda;
+	struct mda_context *mdac;
+	struct device *dev;
+	uint64_t size, wrap;
+
+	if (!(size = lvmcache_vg_mda_size(vgname, vgid)))
+		return;
+
+	dm_list_init(&mda_list);
+
+	lvmcache_get_mdas(cmd, vgname, vgid, &mda_list);
+
+	dm_list_iterate_items_safe(mdal, safe, &mda_list) {
+		mda = mdal->mda;
+		mdac = mda->metadata_locn;
+
+		if (mda->scan_text_offset && !mda_is_ignored(mda) &&
+		    (mda->scan_text_offset < mdac->area.size) &&
+		    (dev = mda_get_device(mda))) {
+			wrap = 0;
+			if (mda->scan_text_offset + size > mdac->area.size)
+				wrap = mda->scan_text_offset + size - mdac->area.size;
+
+			dev_prefetch_bytes(dev, mdac->area.start + mda->scan_text_offset, size - wrap);
+			if (wrap)
+				dev_prefetch_bytes(dev, mdac->area.start + MDA_HEADER_SIZE, wrap);
+		}
+
+		dm_list_del(&mdal->list);
+		free(mdal);
+	}
+}
+
+/*
+ * retry is set when the VG is read without the VG lock.  Instead of
+ * warning about an mda that cannot be read or mdas with different
+ * seqnos, which is what a concurrent writer looks like, NULL is then
+ * returned with *retry set, and the VG should be read with the lock.
+ */
+static struct volume_group *_do_vg_read(struct cmd_context *cmd,
+					const char *vgname,
+					const char *vgid,
+					unsigned precommitted,
+					int writing,
+					int *retry)
 {
 	const struct format_type *fmt = cmd->fmt;
 	struct format_instance *fid = NULL;
@@ -4748,9 +5214,14 @@ static struct volume_group *_vg_read(struct cmd_context *cmd,
 	 * in just one mda before deciding to skip rescanning.  For other commands,
 	 * we check that they are unchanged in all mdas.  This added checking is
 	 * probably unnecessary; all commands could likely just check a single mda.
+	 *
+	 * For a shared VG, the lvmlockd VG lock carries the seqno of the last
+	 * commit.  When it matches the seqno seen by the label scan, the
+	 * metadata is unchanged without rereading an mda_header.
 	 */
 
-	if (lvmcache_scan_mismatch(cmd, vgname, vgid) || _scan_text_mismatch(cmd, vgname, vgid)) {
+	if (lvmcache_scan_mismatch(cmd, vgname, vgid) ||
+	    (!lvmcache_lockd_seqno_unchanged(vgid) && _scan_text_mismatch(cmd, vgname, vgid))) {
 		log_debug_metadata("Rescanning devices for %s %s", vgname, writing ? "rw" : "");
 		if (writing)
 			lvmcache_label_rescan_vg_rw(cmd, vgname, vgid);
@@ -4849,6 +5320,9 @@ static struct volume_group *_vg_read(struct cmd_context *cmd,
 
 			vg = mda->ops->vg_read(cmd, fid, vgname, mda, &vg_fmtdata, &use_previous_vg);
 
+			if (!vg && !use_previous_vg && retry)
+				goto retry_locked;
+
 			if (!vg && !use_previous_vg) {
 				log_warn("WARNING: Reading VG %s on %s failed.", vgname, dev_name(mda_dev));
 				vg_fmtdata = NULL;
@@ -4874,6 +5348,9 @@ static struct volume_group *_vg_read(struct cmd_context *cmd,
 
 		if (vg->seqno == vg_ret->seqno) {
 			release_vg(vg);
+		} else if (retry) {
+			release_vg(vg);
+			goto retry_locked;
 		} else if (vg->seqno > vg_ret->seqno) {
 			log_warn("WARNING: ignoring metadata seqno %u on %s for seqno %u on %s for VG %s.",
 				 vg_ret->seqno, dev_name(dev_ret),
@@ -4983,6 +5460,31 @@ static struct volume_group *_vg_read(struct cmd_context *cmd,
 
 out:
 	return vg_ret;
+
+retry_locked:
+	log_debug_metadata("VG %s changed while read without lock.", vgname);
+	*retry = 1;
+	release_vg(vg_ret);
+	fid->ref_count--;
+	_destroy_fid(&fid);
+
+	return NULL;
+}
+
+static struct volume_group *_vg_read(struct cmd_context *cmd,
+				     const char *vgname,
+				     const char *vgid,
+				     unsigned precommitted,
+				     int writing,
+				     int *retry)
+{
+	struct volume_group *vg;
+
+	timing_start(TIMING_VG_READ);
+	vg = _do_vg_read(cmd, vgname, vgid, precommitted, writing, retry);
+	timing_end(TIMING_VG_READ);
+
+	return vg;
 }
 
 struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const char *vgid,
@@ -4999,6 +5501,10 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 	int original_vgid_set = vgid ? 1 : 0;
 	int writing = (vg_read_flags & READ_FOR_UPDATE);
 	int activating = (vg_read_flags & READ_FOR_ACTIVATE);
+	/* report/read_without_lock, taking the lock only when the read is not clean */
+	int unlocked = cmd->read_without_lock && !writing && !activating &&
+		       !(vg_read_flags & READ_WITHOUT_LOCK);
+	int retry = 0;
 
 	if (is_orphan_vg(vg_name)) {
 		log_very_verbose("Reading orphan VG %s.", vg_name);
@@ -5024,7 +5530,7 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 	 * of needing to write to them.
 	 */
 
-	if (!(vg_read_flags & READ_WITHOUT_LOCK) &&
+	if (!unlocked && !(vg_read_flags & READ_WITHOUT_LOCK) &&
 	    !lock_vol(cmd, vg_name, (writing || activating) ? LCK_VG_WRITE : LCK_VG_READ, NULL)) {
 		log_error("Can't get lock for %s.", vg_name);
 		failure |= FAILED_LOCKING;
@@ -5053,7 +5559,8 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 		vgid = lvmcache_vgid_from_vgname(cmd, vg_name);
 
 	if (!vgid) {
-		unlock_vg(cmd, NULL, vg_name);
+		if (!unlocked)
+			unlock_vg(cmd, NULL, vg_name);
 		/* Some callers don't care if the VG doesn't exist and don't want an error message. */
 		if (!(vg_read_flags & READ_OK_NOTFOUND))
 			log_error("Volume group \"%s\" not found", vg_name);
@@ -5068,8 +5575,19 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 	if (activating && original_vgid_set && lvmcache_has_duplicate_local_vgname(vgid, vg_name))
 		log_warn("WARNING: activating multiple VGs with the same name is dangerous and may fail.");
 
-	if (!(vg = _vg_read(cmd, vg_name, vgid, 0, writing))) {
-		unlock_vg(cmd, NULL, vg_name);
+	if (!(vg = _vg_read(cmd, vg_name, vgid, 0, writing, unlocked ? &retry : NULL)) && retry) {
+		unlocked = 0;
+		if (!lock_vol(cmd, vg_name, LCK_VG_READ, NULL)) {
+			log_error("Can't get lock for %s.", vg_name);
+			failure |= FAILED_LOCKING;
+			goto bad;
+		}
+		vg = _vg_read(cmd, vg_name, vgid, 0, writing, NULL);
+	}
+
+	if (!vg) {
+		if (!unlocked)
+			unlock_vg(cmd, NULL, vg_name);
 		/* Some callers don't care if the VG doesn't exist and don't want an error message. */
 		if (!(vg_read_flags & READ_OK_NOTFOUND))
 			log_error("Volume group \"%s\" not found.", vg_name);
@@ -5077,6 +5595,8 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 		goto_bad;
 	}
 
+	vg->read_without_lock = unlocked;
+
 	/*
 	 * Check and warn if PV ext info is not in sync with VG metadata
 	 * (vg_write fixes.)
@@ -5224,37 +5744,27 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 	 * FIXME: be specific about exactly when this works correctly.
 	 */
 	if (writing) {
-		struct dm_config_tree *cft;
-
 		if (dm_pool_locked(vg->vgmem)) {
 			/* FIXME: can this happen? */
 			log_warn("WARNING: vg_read no vg copy: pool locked.");
 			goto out;
 		}
 
-		if (vg->vg_committed) {
+		if (vg->vg_committed || vg->vg_committed_text) {
 			/* FIXME: can this happen? */
 			log_warn("WARNING: vg_read no vg copy: copy exists.");
-			release_vg(vg->vg_committed);
-			vg->vg_committed = NULL;
+			_vg_wipe_cached_committed(vg);
 		}
 
-		if (vg->vg_precommitted) {
+		if (vg->vg_precommitted || vg->vg_precommitted_text) {
 			/* FIXME: can this happen? */
 			log_warn("WARNING: vg_read no vg copy: pre copy exists.");
-			release_vg(vg->vg_precommitted);
-			vg->vg_precommitted = NULL;
+			_vg_wipe_cached_precommitted(vg);
 		}
 
-		if (!(cft = export_vg_to_config_tree(vg))) {
+		/* Imported on first use by vg_get_committed() */
+		if (!export_vg_to_buffer(vg, &vg->vg_committed_text))
 			log_warn("WARNING: vg_read no vg copy: copy export failed.");
-			goto out;
-		}
-
-		if (!(vg->vg_committed = import_vg_from_config_tree(cmd, vg->fid, cft)))
-			log_warn("WARNING: vg_read no vg copy: copy import failed.");
-
-		dm_config_destroy(cft);
 	} else {
 		if (vg->vg_precommitted)
 			log_error(INTERNAL_ERROR "vg_read vg %p vg_precommitted %p", (void *)vg, (void *)vg->vg_precommitted);
@@ -5262,6 +5772,9 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 			log_error(INTERNAL_ERROR "vg_read vg %p vg_committed %p", (void *)vg, (void *)vg->vg_committed);
 	}
 out:
+	if (!(vg_read_flags & READ_WITHOUT_LOCK))
+		vg_snapshot_update(vg);
+
 	/* We return with the VG lock held when read is successful. */
 	*error_flags = SUCCESS;
 	if (error_vg)
@@ -5301,6 +5814,11 @@ bad:
 	return_NULL;
 }
 
+int vg_read_without_lock(const struct volume_group *vg)
+{
+	return vg && vg->read_without_lock;
+}
+
 /*
  * Simply a version of vg_read() that automatically sets the READ_FOR_UPDATE
  * flag, which means the caller intends to write the VG after reading it,
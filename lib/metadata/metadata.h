@@ -166,6 +166,9 @@ struct metadata_area_ops {
 /* The primary metadata area on a device if the format supports more than one. */
 #define MDA_PRIMARY	 0x00000008
 
+/* Set while vg_commit collects the result of a batched mda header write. */
+#define MDA_COMMIT_FAILED 0x00000010
+
 #define mda_is_primary(mda) (((mda->status) & MDA_PRIMARY) ? 1 : 0)
 #define MDA_CONTENT_REASON(primary_mda) ((primary_mda) ? DEV_IO_MDA_CONTENT : DEV_IO_MDA_EXTRA_CONTENT)
 #define MDA_HEADER_REASON(primary_mda)  ((primary_mda) ? DEV_IO_MDA_HEADER : DEV_IO_MDA_EXTRA_HEADER)
@@ -407,6 +410,11 @@ struct pv_list *find_pv_in_pv_list(const struct dm_list *pl,
 
 /* Find LV segment containing given LE */
 struct lv_segment *find_seg_by_le(const struct logical_volume *lv, uint32_t le);
+void lv_free_seg_index(struct logical_volume *lv);
+
+/* Find PV segment containing given PE */
+struct pv_segment *find_peg_by_pe(const struct physical_volume *pv, uint32_t pe);
+void pv_free_seg_index(struct physical_volume *pv);
 
 /* Find pool LV segment given a thin pool data or metadata segment. */
 struct lv_segment *find_pool_seg(const struct lv_segment *seg);
@@ -482,6 +490,10 @@ struct dm_config_tree *export_vg_to_config_tree(struct volume_group *vg);
 struct volume_group *import_vg_from_config_tree(struct cmd_context *cmd,
 						struct format_instance *fid,
 						const struct dm_config_tree *cft);
+size_t export_vg_to_buffer(struct volume_group *vg, char **buf);
+struct volume_group *import_vg_from_buffer(struct cmd_context *cmd,
+					   struct format_instance *fid,
+					   const char *buf);
 struct volume_group *vg_from_config_tree(struct cmd_context *cmd, const struct dm_config_tree *cft);
 
 /*
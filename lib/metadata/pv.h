@@ -66,6 +66,7 @@ struct physical_volume {
 	uint64_t label_sector;
 
 	struct dm_list segments;	/* Ordered pv_segments covering complete PV */
+	struct pv_seg_index *seg_index;	/* Built by find_peg_by_pe() */
 	struct dm_list tags;
 };
 
@@ -19,6 +19,7 @@
 #include "lib/commands/toolcontext.h"
 #include "lib/locking/locking.h"
 #include "lib/config/defaults.h"
+#include "lib/mm/memlock.h"
 #include "lib/display/display.h"
 #include "lib/format_text/archiver.h"
 
@@ -79,16 +80,151 @@ int peg_dup(struct dm_pool *mem, struct dm_list *peg_new, struct dm_list *peg_ol
 	return 1;
 }
 
+/*
+ * Sorted array of a PV's segments for find_peg_by_pe(), built once a
+ * PV has more than PV_SEG_INDEX_MIN segments, as importing metadata
+ * splits the PV once per LV segment area.  _pv_split_segment() keeps
+ * the index current, other changes to pv->segments are caught the
+ * same way as with the LV segment index: an entry is only used while
+ * the segment is still linked into a list and still has the pe and
+ * len it was indexed with, otherwise the list is searched and the
+ * index rebuilt.
+ */
+#define PV_SEG_INDEX_MIN 32
+
+struct pv_seg_index_entry {
+	struct pv_segment *peg;
+	uint32_t pe;
+	uint32_t len;
+};
+
+struct pv_seg_index {
+	unsigned count;
+	unsigned size;
+	struct pv_seg_index_entry entries[];
+};
+
+void pv_free_seg_index(struct physical_volume *pv)
+{
+	free(pv->seg_index);
+	pv->seg_index = NULL;
+}
+
+static int _peg_index_reserve(struct physical_volume *pv, unsigned count)
+{
+	struct pv_seg_index *idx = pv->seg_index;
+	unsigned size;
+
+	if (idx && (idx->size >= count))
+		return 1;
+
+	size = (idx && (2 * idx->size > count)) ? 2 * idx->size : count;
+	if (!(idx = realloc(idx, sizeof(*idx) + size * sizeof(idx->entries[0])))) {
+		log_debug("Failed to allocate segment index for PV %s.",
+			  pv_dev_name(pv));
+		pv_free_seg_index(pv);
+		return 0;
+	}
+
+	if (!pv->seg_index)
+		idx->count = 0;
+	idx->size = size;
+	pv->seg_index = idx;
+
+	return 1;
+}
+
+static void _peg_index_build(struct physical_volume *pv)
+{
+	struct pv_seg_index_entry *e;
+	struct pv_segment *peg;
+
+	if (!_peg_index_reserve(pv, dm_list_size(&pv->segments)))
+		return;
+
+	e = pv->seg_index->entries;
+	dm_list_iterate_items(peg, &pv->segments) {
+		e->peg = peg;
+		e->pe = peg->pe;
+		e->len = peg->len;
+		e++;
+	}
+	pv->seg_index->count = e - pv->seg_index->entries;
+}
+
+/* Returns position of the entry covering pe, or -1 if missing or stale */
+static int _peg_index_find(const struct physical_volume *pv, uint32_t pe)
+{
+	const struct pv_seg_index *idx = pv->seg_index;
+	const struct pv_seg_index_entry *e;
+	const struct pv_segment *peg;
+	unsigned lo = 0, hi = idx->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		e = &idx->entries[mid];
+
+		if (pe < e->pe)
+			hi = mid;
+		else if (pe - e->pe >= e->len)
+			lo = mid + 1;
+		else {
+			peg = e->peg;
+			if ((peg->pv != pv) || (peg->pe != e->pe) || (peg->len != e->len) ||
+			    (peg->list.n->p != &peg->list) || (peg->list.p->n != &peg->list))
+				return -1;	/* Stale */
+			return (int) mid;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Record that peg_new was split off the end of the segment at index
+ * position pos, looked up before the split.
+ */
+static void _peg_index_split(struct physical_volume *pv, int pos,
+			     struct pv_segment *peg_new)
+{
+	struct pv_seg_index_entry *e;
+
+	if (!pv->seg_index)
+		return;
+
+	if ((pos < 0) || !_peg_index_reserve(pv, pv->seg_index->count + 1)) {
+		pv_free_seg_index(pv);
+		return;
+	}
+
+	e = &pv->seg_index->entries[pos];
+	e->len -= peg_new->len;
+	memmove(e + 2, e + 1, (pv->seg_index->count - pos - 1) * sizeof(*e));
+	e[1].peg = peg_new;
+	e[1].pe = peg_new->pe;
+	e[1].len = peg_new->len;
+	pv->seg_index->count++;
+}
+
 /* Find segment at a given physical extent in a PV */
-static struct pv_segment *_find_peg_by_pe(const struct physical_volume *pv,
-					  uint32_t pe)
+struct pv_segment *find_peg_by_pe(const struct physical_volume *pv, uint32_t pe)
 {
 	struct pv_segment *pvseg;
+	unsigned count = 0;
+	int pos;
+
+	if (pv->seg_index && ((pos = _peg_index_find(pv, pe)) >= 0))
+		return pv->seg_index->entries[pos].peg;
 
 	/* search backwards to optimise mostly used last segment split */
-	dm_list_iterate_back_items(pvseg, &pv->segments)
-		if (pe >= pvseg->pe && pe < pvseg->pe + pvseg->len)
+	dm_list_iterate_back_items(pvseg, &pv->segments) {
+		if (pe >= pvseg->pe && pe < pvseg->pe + pvseg->len) {
+			if (pv->seg_index || (count >= PV_SEG_INDEX_MIN))
+				_peg_index_build((struct physical_volume *) pv);
 			return pvseg;
+		}
+		count++;
+	}
 
 	return NULL;
 }
@@ -103,6 +239,7 @@ static struct pv_segment *_pv_split_segment(struct dm_pool *mem,
 					    uint32_t pe)
 {
 	struct pv_segment *peg_new;
+	int pos = pv->seg_index ? _peg_index_find(pv, pe) : -1;
 
 	if (!(peg_new = _alloc_pv_segment(mem, peg->pv, pe,
 					  peg->len + peg->pe - pe,
@@ -112,6 +249,7 @@ static struct pv_segment *_pv_split_segment(struct dm_pool *mem,
 	peg->len = peg->len - peg_new->len;
 
 	dm_list_add_h(&peg->list, &peg_new->list);
+	_peg_index_split(pv, pos, peg_new);
 
 	if (peg->lvseg) {
 		peg->pv->pe_alloc_count -= peg_new->len;
@@ -133,7 +271,7 @@ int pv_split_segment(struct dm_pool *mem,
 	if (pe == pv->pe_count)
 		goto out;
 
-	if (!(pvseg = _find_peg_by_pe(pv, pe))) {
+	if (!(pvseg = find_peg_by_pe(pv, pe))) {
 		log_error("Segment with extent %" PRIu32 " in PV %s not found",
 			  pe, pv_dev_name(pv));
 		return 0;
@@ -189,10 +327,25 @@ struct pv_segment *assign_peg_to_lvseg(struct physical_volume *pv,
 	return peg;
 }
 
+/*
+ * Extents released by discard_pv_segment() waiting for the VG commit.
+ */
+struct pv_discard {
+	struct dm_list list;
+	struct physical_volume *pv;
+	uint32_t pe;
+	uint32_t len;
+};
+
+/*
+ * Queue the released extents for discard_pending_pv_areas().
+ * Nothing is discarded before the metadata releasing the extents
+ * is committed and the LVs updated by the command are resumed.
+ */
 int discard_pv_segment(struct pv_segment *peg, uint32_t discard_area_reduction)
 {
-	uint64_t discard_offset_sectors;
-	uint64_t pe_start = peg->pv->pe_start;
+	struct volume_group *vg = peg->pv->vg;
+	struct pv_discard *pvd;
 	char uuid[64] __attribute__((aligned(8)));
 
 	if (!peg->lvseg) {
@@ -222,27 +375,120 @@ int discard_pv_segment(struct pv_segment *peg, uint32_t discard_area_reduction)
 	    !dev_discard_granularity(peg->pv->fmt->cmd->dev_types, peg->pv->dev))
 		return 1;
 
-	discard_offset_sectors = (peg->pe + peg->lvseg->area_len - discard_area_reduction) *
-				 (uint64_t) peg->pv->vg->extent_size + pe_start;
-	if (!discard_offset_sectors) {
+	if (!discard_area_reduction || (peg->pv->dev->flags & DEV_REGULAR))
+		return 1;
+
+	if (!(pvd = dm_pool_zalloc(vg->vgmem, sizeof(*pvd)))) {
+		log_error("Failed to allocate discard area.");
+		return 0;
+	}
+
+	pvd->pv = peg->pv;
+	pvd->pe = peg->pe + peg->lvseg->area_len - discard_area_reduction;
+	pvd->len = discard_area_reduction;
+	dm_list_add(&vg->pending_discards, &pvd->list);
+
+	return 1;
+}
+
+static int _add_discard_range(struct volume_group *vg, struct dm_list *ranges,
+			      struct physical_volume *pv, uint32_t pe, uint32_t len,
+			      unsigned threads)
+{
+	struct cmd_context *cmd = vg->cmd;
+	struct dev_io_range *range;
+	uint64_t offset_sectors = pe * (uint64_t) vg->extent_size + pv->pe_start;
+	uint64_t granularity;
+
+	if (!offset_sectors) {
 		/*
 		 * pe_start=0 and the PV's first extent contains the label.
 		 * Must skip past the first extent.
 		 */
-		discard_offset_sectors = peg->pv->vg->extent_size;
-		discard_area_reduction--;
+		offset_sectors = vg->extent_size;
+		if (!--len)
+			return 1;
 	}
 
 	log_debug_alloc("Discarding %" PRIu32 " extents offset %" PRIu64 " sectors on %s.",
-			discard_area_reduction, discard_offset_sectors, dev_name(peg->pv->dev));
-	if (discard_area_reduction &&
-	    !dev_discard_blocks(peg->pv->dev, discard_offset_sectors << SECTOR_SHIFT,
-				discard_area_reduction * (uint64_t) peg->pv->vg->extent_size * SECTOR_SIZE))
-		return_0;
+			len, offset_sectors, dev_name(pv->dev));
+
+	if (!(range = dm_pool_zalloc(vg->vgmem, sizeof(*range)))) {
+		log_error("Failed to allocate discard range.");
+		return 0;
+	}
+
+	range->dev = pv->dev;
+	range->offset_bytes = offset_sectors << SECTOR_SHIFT;
+	range->size_bytes = len * (uint64_t) vg->extent_size << SECTOR_SHIFT;
+
+	/*
+	 * Split big ranges so that every thread gets a piece, but do not
+	 * go below the largest discard the device takes at once.
+	 */
+	range->chunk_bytes = (range->size_bytes + threads - 1) / threads;
+	if (range->chunk_bytes < dev_discard_max_bytes(cmd->dev_types, pv->dev))
+		range->chunk_bytes = dev_discard_max_bytes(cmd->dev_types, pv->dev);
+	if ((granularity = dev_discard_granularity(cmd->dev_types, pv->dev)))
+		range->chunk_bytes = (range->chunk_bytes + granularity - 1) / granularity * granularity;
+
+	dm_list_add(ranges, &range->list);
 
 	return 1;
 }
 
+/*
+ * Discard the extents queued by discard_pv_segment() once the VG
+ * releasing them is committed, called by unlock_vg() so the VG lock
+ * still keeps other commands from allocating them.  Extents allocated
+ * again since are skipped.  Discards of all PVs are issued together
+ * by devices/discard_threads threads.
+ */
+void discard_pending_pv_areas(struct volume_group *vg)
+{
+	struct pv_discard *pvd;
+	struct pv_segment *peg;
+	struct dm_list ranges;
+	uint32_t start, end;
+	int threads;
+
+	if (dm_list_empty(&vg->committed_discards))
+		return;
+
+	/* Never with devices suspended, keep them for the next unlock. */
+	if (critical_section()) {
+		log_debug_alloc("Deferring discards of VG %s in critical section.", vg->name);
+		return;
+	}
+
+	dm_list_init(&ranges);
+
+	threads = find_config_tree_int(vg->cmd, devices_discard_threads_CFG, NULL);
+	if (threads < 1)
+		threads = 1;
+	else if (threads > DISCARD_THREADS_MAX)
+		threads = DISCARD_THREADS_MAX;
+
+	dm_list_iterate_items(pvd, &vg->committed_discards) {
+		if ((pvd->pv->vg != vg) || !pvd->pv->dev)
+			continue;
+		dm_list_iterate_items(peg, &pvd->pv->segments) {
+			if (peg->lvseg)
+				continue;
+			start = max(peg->pe, pvd->pe);
+			end = min(peg->pe + peg->len, pvd->pe + pvd->len);
+			if ((start < end) &&
+			    !_add_discard_range(vg, &ranges, pvd->pv, start, end - start, threads))
+				goto out;
+		}
+	}
+
+	if (!dev_discard_ranges(&ranges, threads))
+		stack;
+out:
+	dm_list_init(&vg->committed_discards);
+}
+
 static int _merge_free_pv_segment(struct pv_segment *peg)
 {
 	struct dm_list *l;
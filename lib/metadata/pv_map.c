@@ -18,28 +18,167 @@
 
 #include <assert.h>
 
+typedef int (*_area_cmp_fn)(const struct pv_area *a, const struct pv_area *b);
+
+#define _LINK(pva, off) ((struct pv_area_link *)((char *)(pva) + (off)))
+
+/* Larger areas first; equal sizes in insertion order. */
+static int _size_cmp(const struct pv_area *a, const struct pv_area *b)
+{
+	if (a->size_key != b->size_key)
+		return (a->size_key > b->size_key) ? -1 : 1;
+
+	return (a->seq < b->seq) ? -1 : (a->seq > b->seq);
+}
+
+static int _pe_cmp(const struct pv_area *a, const struct pv_area *b)
+{
+	if (a->start != b->start)
+		return (a->start < b->start) ? -1 : 1;
+
+	return (a->seq < b->seq) ? -1 : (a->seq > b->seq);
+}
+
+static uint32_t _area_priority(uint32_t seq)
+{
+	/* lowbias32 */
+	seq ^= seq >> 16;
+	seq *= UINT32_C(0x7feb352d);
+	seq ^= seq >> 15;
+	seq *= UINT32_C(0x846ca68b);
+	seq ^= seq >> 16;
+
+	return seq;
+}
+
+static struct pv_area *_rotate_right(struct pv_area *n, size_t off)
+{
+	struct pv_area *l = _LINK(n, off)->left;
+
+	_LINK(n, off)->left = _LINK(l, off)->right;
+	_LINK(l, off)->right = n;
+
+	return l;
+}
+
+static struct pv_area *_rotate_left(struct pv_area *n, size_t off)
+{
+	struct pv_area *r = _LINK(n, off)->right;
+
+	_LINK(n, off)->right = _LINK(r, off)->left;
+	_LINK(r, off)->left = n;
+
+	return r;
+}
+
+static struct pv_area *_index_insert(struct pv_area *root, struct pv_area *a,
+				     size_t off, _area_cmp_fn cmp)
+{
+	struct pv_area_link *l;
+
+	if (!root) {
+		_LINK(a, off)->left = _LINK(a, off)->right = NULL;
+		return a;
+	}
+
+	l = _LINK(root, off);
+
+	if (cmp(a, root) < 0) {
+		l->left = _index_insert(l->left, a, off, cmp);
+		if (l->left->priority > root->priority)
+			root = _rotate_right(root, off);
+	} else {
+		l->right = _index_insert(l->right, a, off, cmp);
+		if (l->right->priority > root->priority)
+			root = _rotate_left(root, off);
+	}
+
+	return root;
+}
+
+static struct pv_area *_index_remove(struct pv_area *root, struct pv_area *a,
+				     size_t off, _area_cmp_fn cmp)
+{
+	struct pv_area_link *l;
+
+	if (!root)
+		return NULL;	/* Not indexed - cannot happen */
+
+	l = _LINK(root, off);
+
+	if (root == a) {
+		if (!l->left)
+			return l->right;
+		if (!l->right)
+			return l->left;
+
+		if (l->left->priority > l->right->priority) {
+			root = _rotate_right(root, off);
+			_LINK(root, off)->right = _index_remove(_LINK(root, off)->right, a, off, cmp);
+		} else {
+			root = _rotate_left(root, off);
+			_LINK(root, off)->left = _index_remove(_LINK(root, off)->left, a, off, cmp);
+		}
+	} else if (cmp(a, root) < 0)
+		l->left = _index_remove(l->left, a, off, cmp);
+	else
+		l->right = _index_remove(l->right, a, off, cmp);
+
+	return root;
+}
+
+/*
+ * First area in pv_map.areas that is smaller than size.
+ */
+static struct pv_area *_first_smaller(struct pv_map *pvm, uint32_t size)
+{
+	struct pv_area *n = pvm->size_root, *found = NULL;
+
+	while (n)
+		if (n->size_key < size) {
+			found = n;
+			n = n->by_size.left;
+		} else
+			n = n->by_size.right;
+
+	return found;
+}
+
 /*
  * Areas are maintained in size order, largest first.
+ * A reduced area is sorted by its unreserved extents.
  *
  * FIXME Cope with overlap.
  */
 static void _insert_area(struct dm_list *head, struct pv_area *a, unsigned reduced)
 {
-	struct pv_area *pva;
-	uint32_t count = reduced ? a->unreserved : a->count;
-		
-	dm_list_iterate_items(pva, head)
-		if (count > pva->count)
-			break;
+	struct pv_map *pvm = a->map;
+	struct pv_area *next;
+
+	a->size_key = reduced ? a->unreserved : a->count;
+	a->seq = pvm->seq++;
+	a->priority = _area_priority(a->seq);
+
+	next = _first_smaller(pvm, a->size_key);
+	dm_list_add(next ? &next->list : head, &a->list);
 
-	dm_list_add(&pva->list, &a->list);
-	a->map->pe_count += a->count;
+	pvm->size_root = _index_insert(pvm->size_root, a,
+				       offsetof(struct pv_area, by_size), _size_cmp);
+	pvm->pe_root = _index_insert(pvm->pe_root, a,
+				     offsetof(struct pv_area, by_pe), _pe_cmp);
+	pvm->pe_count += a->count;
 }
 
 static void _remove_area(struct pv_area *a)
 {
+	struct pv_map *pvm = a->map;
+
 	dm_list_del(&a->list);
-	a->map->pe_count -= a->count;
+	pvm->size_root = _index_remove(pvm->size_root, a,
+				       offsetof(struct pv_area, by_size), _size_cmp);
+	pvm->pe_root = _index_remove(pvm->pe_root, a,
+				     offsetof(struct pv_area, by_pe), _pe_cmp);
+	pvm->pe_count -= a->count;
 }
 
 static int _create_single_area(struct dm_pool *mem, struct pv_map *pvm,
@@ -226,3 +365,16 @@ uint32_t pv_maps_size(struct dm_list *pvms)
 
 	return pe_count;
 }
+
+struct pv_area *find_pv_area_at(struct pv_map *pvm, uint32_t pe)
+{
+	struct pv_area *n = pvm->pe_root;
+
+	while (n) {
+		if (n->start == pe)
+			return n;
+		n = (pe < n->start) ? n->by_pe.left : n->by_pe.right;
+	}
+
+	return NULL;
+}
@@ -26,6 +26,16 @@
  * mapping available.
  */
 
+/*
+ * Each pv_map indexes its areas twice: by size (mirroring the order
+ * of pv_map.areas) and by start PE.  Both are treaps sharing one
+ * priority; ties are broken by insertion sequence.
+ */
+struct pv_area_link {
+	struct pv_area *left;
+	struct pv_area *right;
+};
+
 struct pv_area {
 	struct pv_map *map;
 	uint32_t start;
@@ -35,6 +45,12 @@ struct pv_area {
 	uint32_t unreserved;
 
 	struct dm_list list;		/* pv_map.areas */
+
+	uint32_t size_key;		/* Size the area was sorted by */
+	uint32_t seq;
+	uint32_t priority;
+	struct pv_area_link by_size;	/* pv_map.size_root */
+	struct pv_area_link by_pe;	/* pv_map.pe_root */
 };
 
 /*
@@ -56,6 +72,10 @@ struct pv_map {
 	struct dm_list areas;		/* struct pv_areas */
 	uint32_t pe_count;		/* Total number of PEs */
 
+	struct pv_area *size_root;
+	struct pv_area *pe_root;
+	uint32_t seq;
+
 	struct dm_list list;
 };
 
@@ -70,4 +90,9 @@ void reinsert_changed_pv_area(struct pv_area *pva);
 
 uint32_t pv_maps_size(struct dm_list *pvms);
 
+/*
+ * An area starting exactly at PE pe, or NULL.
+ */
+struct pv_area *find_pv_area_at(struct pv_map *pvm, uint32_t pe);
+
 #endif
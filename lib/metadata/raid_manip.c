@@ -98,6 +98,43 @@ uint32_t raid_ensure_min_region_size(const struct logical_volume *lv, uint64_t r
 	return region_size;
 }
 
+/*
+ * Share @bandwidth (KiB/s per device) between the raid LVs with images
+ * on any PV used by @seg, so simultaneous resyncs after a repair or
+ * --resync cannot saturate the PVs.  An explicit rate of an LV is
+ * left to the caller; the result never drops below its min rate.
+ */
+uint32_t raid_shared_max_recovery_rate(struct dm_pool *mem, const struct lv_segment *seg,
+				       uint32_t bandwidth)
+{
+	struct dm_list pvs;
+	struct lv_list *lvl;
+	uint32_t sharing = 0, rate;
+
+	dm_list_init(&pvs);
+
+	if (!get_pv_list_for_lv(mem, seg->lv, &pvs))
+		return_0;
+
+	dm_list_iterate_items(lvl, &seg->lv->vg->lvs)
+		if (lv_is_raid(lvl->lv) && !seg_is_any_raid0(first_seg(lvl->lv)) &&
+		    ((lvl->lv == seg->lv) || lv_is_on_pvs(lvl->lv, &pvs)))
+			sharing++;
+
+	rate = bandwidth / (sharing ? : 1);
+
+	if (rate < seg->min_recovery_rate)
+		rate = seg->min_recovery_rate;
+
+	if (!rate)
+		rate = 1;
+
+	log_debug_activation("Limiting recovery of %s to %u KiB/s, shared by %u raid LVs.",
+			     display_lvname(seg->lv), rate, sharing);
+
+	return rate;
+}
+
 /* check constraints on region size vs. stripe and LV size on @lv */
 static int _check_region_size_constraints(struct logical_volume *lv,
 					  const struct segment_type *segtype,
@@ -305,6 +342,18 @@ static void _clear_allocation_prohibited(struct dm_list *pvs)
 			pvl->pv->status &= ~PV_ALLOCATION_PROHIBITED;
 }
 
+/*
+ * Building the pv maps for an allocation clears PV_ALLOCATION_PROHIBITED,
+ * so PVs to avoid have to be flagged again before each allocation.
+ */
+static void _set_allocation_prohibited(struct dm_list *pvs)
+{
+	struct pv_list *pvl;
+
+	dm_list_iterate_items(pvl, pvs)
+		pvl->pv->status |= PV_ALLOCATION_PROHIBITED;
+}
+
 /*
  * Deactivate and remove the LVs on removal_lvs list from vg.
  */
@@ -3594,11 +3643,19 @@ static int _alloc_rmeta_devs_for_rimage_devs(struct logical_volume *lv,
 					     struct dm_list *allocate_pvs)
 {
 	uint32_t a = 0, raid_devs = dm_list_size(new_data_lvs);
-	struct lv_list *lvl, *lvl1, *lvl_array;
+	struct lv_list *lvl, *lvl_array;
+	struct dm_list meta_pvs;
 
 	if (!raid_devs)
 		return_0;
 
+	/*
+	 * PVs of the metadata LVs allocated so far, collected once each
+	 * instead of searching every new metadata LV for them before
+	 * every allocation.
+	 */
+	dm_list_init(&meta_pvs);
+
 	if (!(lvl_array = dm_pool_zalloc(lv->vg->vgmem, raid_devs * sizeof(*lvl_array))))
 		return_0;
 
@@ -3612,25 +3669,28 @@ static int _alloc_rmeta_devs_for_rimage_devs(struct logical_volume *lv,
 		 */
 		if (!_alloc_rmeta_for_lv(lvl->lv, &lvl_array[a].lv,
 					 allocate_pvs != &lv->vg->pvs ? allocate_pvs : NULL)) {
-			dm_list_iterate_items(lvl1, new_meta_lvs)
-				if (!_avoid_pvs_with_other_images_of_lv(lvl1->lv, allocate_pvs))
-					return_0;
+			_set_allocation_prohibited(&meta_pvs);
 
 			if (!_alloc_rmeta_for_lv(lvl->lv, &lvl_array[a].lv, allocate_pvs)) {
 				log_error("Failed to allocate metadata LV for %s.",
 					  display_lvname(lvl->lv));
+				_clear_allocation_prohibited(&meta_pvs);
 				return 0;
 			}
 		}
 
-		dm_list_add(new_meta_lvs, &lvl_array[a++].list);
+		dm_list_add(new_meta_lvs, &lvl_array[a].list);
 
-		dm_list_iterate_items(lvl1, new_meta_lvs)
-			if (!_avoid_pvs_with_other_images_of_lv(lvl1->lv, allocate_pvs))
-				return_0;
+		if (!get_pv_list_for_lv(lv->vg->cmd->mem, lvl_array[a++].lv, &meta_pvs)) {
+			_clear_allocation_prohibited(&meta_pvs);
+			return_0;
+		}
+
+		_set_allocation_prohibited(&meta_pvs);
 	}
 
 	_clear_allocation_prohibited(allocate_pvs);
+	_clear_allocation_prohibited(&meta_pvs);
 
 	return 1;
 }
@@ -17,8 +17,7 @@
 #include "lib/commands/toolcontext.h"
 #include "lib/metadata/segtype.h"
 
-struct segment_type *get_segtype_from_string(struct cmd_context *cmd,
-					     const char *str)
+static struct segment_type *_find_segtype(struct cmd_context *cmd, const char *str)
 {
 	struct segment_type *segtype;
 
@@ -26,6 +25,46 @@ struct segment_type *get_segtype_from_string(struct cmd_context *cmd,
 		if (!strcmp(segtype->name, str))
 			return segtype;
 
+	return NULL;
+}
+
+static struct segment_type *_find_segtype_flag(struct cmd_context *cmd, uint64_t flag)
+{
+	struct segment_type *segtype;
+
+	/* Iterate backwards to provide aliases; e.g. raid5 instead of raid5_ls */
+	dm_list_iterate_back_items(segtype, &cmd->segtypes)
+		if (flag & segtype->flags)
+			return segtype;
+
+	return NULL;
+}
+
+/*
+ * Segment types beyond the basic ones are registered on first use, see
+ * load_segtypes().  A name or flag not known after loading its family is
+ * looked for in all of them before giving up.
+ */
+struct segment_type *get_segtype_from_string(struct cmd_context *cmd,
+					     const char *str)
+{
+	struct segment_type *segtype;
+
+	if ((segtype = _find_segtype(cmd, str)))
+		return segtype;
+
+	if (!load_segtypes(cmd, str, 0))
+		stack;
+
+	if ((segtype = _find_segtype(cmd, str)))
+		return segtype;
+
+	if (!load_segtypes(cmd, NULL, 0))
+		stack;
+
+	if ((segtype = _find_segtype(cmd, str)))
+		return segtype;
+
 	if (!(segtype = init_unknown_segtype(cmd, str)))
 		return_NULL;
 
@@ -39,10 +78,20 @@ struct segment_type *get_segtype_from_flag(struct cmd_context *cmd, uint64_t fla
 {
 	struct segment_type *segtype;
 
-	/* Iterate backwards to provide aliases; e.g. raid5 instead of raid5_ls */
-	dm_list_iterate_back_items(segtype, &cmd->segtypes)
-		if (flag & segtype->flags)
-			return segtype;
+	if ((segtype = _find_segtype_flag(cmd, flag)))
+		return segtype;
+
+	if (!load_segtypes(cmd, NULL, flag))
+		stack;
+
+	if ((segtype = _find_segtype_flag(cmd, flag)))
+		return segtype;
+
+	if (!load_segtypes(cmd, NULL, 0))
+		stack;
+
+	if ((segtype = _find_segtype_flag(cmd, flag)))
+		return segtype;
 
 	log_error(INTERNAL_ERROR "Unrecognised segment type flag 0x%016" PRIx64, flag);
 
@@ -291,6 +291,12 @@ struct segtype_library;
 int lvm_register_segtype(struct segtype_library *seglib,
 			 struct segment_type *segtype);
 
+/*
+ * Register the segment types not set up yet that provide name or flag,
+ * or all of them if neither is given.
+ */
+int load_segtypes(struct cmd_context *cmd, const char *name, uint64_t flag);
+
 struct segment_type *init_linear_segtype(struct cmd_context *cmd);
 struct segment_type *init_striped_segtype(struct cmd_context *cmd);
 struct segment_type *init_zero_segtype(struct cmd_context *cmd);
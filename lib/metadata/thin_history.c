@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/metadata/metadata.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+/*
+ * Thin pool usage history.
+ *
+ * Whenever lvs reads the status of an active thin pool (and whenever
+ * dmeventd checks it), a sample "<time> <data%> <metadata%>" is appended
+ * to THIN_HISTORY_DIR/<lvid>, percentages stored as dm_percent_t.
+ * A sample is skipped when the file was written less than
+ * THIN_HISTORY_INTERVAL seconds ago.  Once the file grows past
+ * THIN_HISTORY_SIZE it is renamed to <lvid>.old, so each pool keeps at
+ * most two small files and a few hundred samples.
+ *
+ * dmeventd's thin plugin writes the same format, keep them in sync.
+ */
+#define THIN_HISTORY_DIR	DEFAULT_RUN_DIR "/thin_history"
+#define THIN_HISTORY_INTERVAL	60
+#define THIN_HISTORY_SIZE	8192
+/* Samples older than this are not used for the forecast */
+#define THIN_HISTORY_WINDOW	(24 * 3600)
+/* Shortest span of samples giving a usable fill rate */
+#define THIN_HISTORY_MIN_SPAN	300
+
+struct thin_history_sample {
+	uint64_t time;
+	dm_percent_t data;
+	dm_percent_t metadata;
+};
+
+static int _history_path(char *path, size_t size,
+			 const struct logical_volume *lv, const char *suffix)
+{
+	if (dm_snprintf(path, size, "%s/%.*s%s", THIN_HISTORY_DIR,
+			(int) sizeof(lv->lvid.id), lv->lvid.s, suffix) < 0) {
+		log_error("Thin pool history path for %s is too long.",
+			  display_lvname(lv));
+		return 0;
+	}
+
+	return 1;
+}
+
+int thin_pool_history_record(const struct logical_volume *lv,
+			     dm_percent_t data, dm_percent_t metadata)
+{
+	char path[PATH_MAX], old_path[PATH_MAX], line[64];
+	time_t now = time(NULL);
+	struct stat st;
+	int fd, len, r = 0;
+
+	if ((data == DM_PERCENT_INVALID) || (metadata == DM_PERCENT_INVALID))
+		return 1;
+
+	if (!_history_path(path, sizeof(path), lv, ""))
+		return_0;
+
+	if (!stat(path, &st) && (now >= st.st_mtime) &&
+	    (now - st.st_mtime < THIN_HISTORY_INTERVAL))
+		return 1;
+
+	if ((mkdir(THIN_HISTORY_DIR, 0700) < 0) && (errno != EEXIST)) {
+		log_debug("Cannot create %s: %s.", THIN_HISTORY_DIR, strerror(errno));
+		return 0;
+	}
+
+	if ((fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0600)) < 0) {
+		log_debug("Cannot open thin pool history %s: %s.", path, strerror(errno));
+		return 0;
+	}
+
+	len = dm_snprintf(line, sizeof(line), "%llu %d %d\n",
+			  (unsigned long long) now, data, metadata);
+
+	if ((len < 0) || (write(fd, line, len) != len))
+		log_debug("Failed to write thin pool history %s.", path);
+	else if (!fstat(fd, &st) && (st.st_size > THIN_HISTORY_SIZE)) {
+		/* Whoever renames first wins, the other keeps appending */
+		if (_history_path(old_path, sizeof(old_path), lv, ".old") &&
+		    rename(path, old_path))
+			log_debug("Failed to rotate thin pool history %s.", path);
+		r = 1;
+	} else
+		r = 1;
+
+	if (close(fd))
+		log_sys_debug("close", path);
+
+	return r;
+}
+
+/*
+ * Feed samples of one history file to the forecast.  'first' ends up
+ * the oldest sample inside the window with no usage drop after it, as a
+ * drop means the pool was extended or space was discarded, and the
+ * usage before it says nothing about the current rate.
+ */
+static void _read_history(const char *path, int metadata, uint64_t since,
+			  struct thin_history_sample *first,
+			  struct thin_history_sample *last)
+{
+	struct thin_history_sample s;
+	unsigned long long t;
+	FILE *fp;
+
+	if (!(fp = fopen(path, "r")))
+		return;
+
+	while (fscanf(fp, "%llu %d %d", &t, &s.data, &s.metadata) == 3) {
+		s.time = t;
+		if (!last->time ||
+		    (s.time < last->time) ||
+		    (first->time < since) ||
+		    ((metadata ? s.metadata : s.data) <
+		     (metadata ? last->metadata : last->data)))
+			*first = s;
+		*last = s;
+	}
+
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+}
+
+int thin_pool_history_forecast(const struct logical_volume *lv, int metadata,
+			       dm_percent_t *rate, uint64_t *seconds_to_full)
+{
+	struct thin_history_sample first = { 0 }, last = { 0 };
+	char path[PATH_MAX];
+	uint64_t now = (uint64_t) time(NULL), span, full_at;
+	dm_percent_t used;
+	double per_sec;
+
+	*rate = DM_PERCENT_INVALID;
+	*seconds_to_full = UINT64_MAX;
+
+	if (!_history_path(path, sizeof(path), lv, ".old"))
+		return_0;
+	_read_history(path, metadata, now - THIN_HISTORY_WINDOW, &first, &last);
+
+	if (!_history_path(path, sizeof(path), lv, ""))
+		return_0;
+	_read_history(path, metadata, now - THIN_HISTORY_WINDOW, &first, &last);
+
+	if ((span = last.time - first.time) < THIN_HISTORY_MIN_SPAN)
+		return 0;
+
+	used = metadata ? last.metadata : last.data;
+	per_sec = (double) (used - (metadata ? first.metadata : first.data)) / span;
+
+	*rate = (per_sec * 3600 > DM_PERCENT_100) ? DM_PERCENT_100 : (dm_percent_t) (per_sec * 3600);
+
+	if (per_sec > 0) {
+		full_at = last.time + (uint64_t) ((DM_PERCENT_100 - used) / per_sec);
+		*seconds_to_full = (full_at > now) ? full_at - now : 0;
+	}
+
+	return 1;
+}
@@ -123,50 +123,121 @@ int update_vdo_pool_virtual_size(struct lv_segment *vdo_pool_seg)
 	return 1;
 }
 
-static int _sysfs_get_kvdo_value(const char *dm_name, const char *vdo_param, uint64_t *value)
+/* kvdo statistics used for VDO pool status, read once per command */
+struct kvdo_stats {
+	uint64_t data_blocks_used;
+	uint64_t logical_blocks_used;
+};
+
+static int _sysfs_get_kvdo_value(int dir_fd, const char *vdo_param, uint64_t *value)
 {
-	char path[PATH_MAX];
 	char temp[64];
 	int fd, size, r = 0;
 
-	if (dm_snprintf(path, sizeof(path), "%skvdo/%s/%s",
-			dm_sysfs_dir(), dm_name, vdo_param) < 0) {
-		log_error("Failed to build kmod path.");
+	if ((fd = openat(dir_fd, vdo_param, O_RDONLY)) < 0) {
+		log_sys_error("open", vdo_param);
 		return 0;
 	}
 
-	if ((fd = open(path, O_RDONLY)) < 0) {
-		if (errno != ENOENT)
-			log_sys_error("open", path);
-		else
-			log_sys_debug("open", path);
-		goto bad;
-	}
-
 	if ((size = read(fd, temp, sizeof(temp) - 1)) < 0) {
-		log_sys_error("read", path);
+		log_sys_error("read", vdo_param);
 		goto bad;
 	}
 	temp[size] = 0;
 	errno = 0;
 	*value = strtoll(temp, NULL, 0);
 	if (errno) {
-		log_sys_error("strtool", path);
+		log_sys_error("strtool", vdo_param);
 		goto bad;
 	}
 
 	r = 1;
 bad:
-	if (fd >= 0 && close(fd))
+	if (close(fd))
+		log_sys_error("close", vdo_param);
+
+	return r;
+}
+
+/*
+ * Read the statistics of one kvdo device, resolving its sysfs
+ * directory only once.
+ */
+static int _sysfs_get_kvdo_stats(const char *dm_name, struct kvdo_stats *stats)
+{
+	char path[PATH_MAX];
+	int dir_fd, r = 0;
+
+	if (dm_snprintf(path, sizeof(path), "%skvdo/%s/statistics",
+			dm_sysfs_dir(), dm_name) < 0) {
+		log_error("Failed to build kmod path.");
+		return 0;
+	}
+
+	if ((dir_fd = open(path, O_RDONLY | O_DIRECTORY)) < 0) {
+		if (errno != ENOENT)
+			log_sys_error("open", path);
+		else
+			log_sys_debug("open", path);
+		return 0;
+	}
+
+	if (!_sysfs_get_kvdo_value(dir_fd, "data_blocks_used", &stats->data_blocks_used) ||
+	    !_sysfs_get_kvdo_value(dir_fd, "logical_blocks_used", &stats->logical_blocks_used))
+		goto_out;
+
+	r = 1;
+out:
+	if (close(dir_fd))
 		log_sys_error("close", path);
 
 	return r;
 }
 
+/*
+ * A VDO pool is queried for its own report row and again for each VDO LV
+ * using it, so keep what was read until the command finishes.
+ */
+static int _get_kvdo_stats(struct cmd_context *cmd, const char *dm_name,
+			   struct kvdo_stats *stats)
+{
+	struct kvdo_stats *cached;
+
+	if (!cmd->vdo_stats && !(cmd->vdo_stats = dm_hash_create(16)))
+		return_0;
+
+	if ((cached = dm_hash_lookup(cmd->vdo_stats, dm_name))) {
+		*stats = *cached;
+		return 1;
+	}
+
+	if (!_sysfs_get_kvdo_stats(dm_name, stats))
+		return_0;
+
+	if (!(cached = dm_pool_alloc(cmd->mem, sizeof(*cached))))
+		return_0;
+
+	*cached = *stats;
+
+	if (!dm_hash_insert(cmd->vdo_stats, dm_name, cached))
+		return_0;
+
+	return 1;
+}
+
+void vdo_stats_cache_destroy(struct cmd_context *cmd)
+{
+	if (cmd->vdo_stats) {
+		dm_hash_destroy(cmd->vdo_stats);
+		cmd->vdo_stats = NULL;
+	}
+}
+
 int parse_vdo_pool_status(struct dm_pool *mem, const struct logical_volume *vdo_pool_lv,
 			  const char *params, struct lv_status_vdo *status)
 {
 	struct dm_vdo_status_parse_result result;
+	struct kvdo_stats stats;
 	char *dm_name;
 
 	status->usage = DM_PERCENT_INVALID;
@@ -189,13 +260,11 @@ int parse_vdo_pool_status(struct dm_pool *mem, const struct logical_volume *vdo_
 	status->vdo = result.status;
 
 	if (result.status->operating_mode == DM_VDO_MODE_NORMAL) {
-		if (!_sysfs_get_kvdo_value(dm_name, "statistics/data_blocks_used",
-					   &status->data_blocks_used))
+		if (!_get_kvdo_stats(vdo_pool_lv->vg->cmd, dm_name, &stats))
 			return_0;
 
-		if (!_sysfs_get_kvdo_value(dm_name, "statistics/logical_blocks_used",
-					   &status->logical_blocks_used))
-			return_0;
+		status->data_blocks_used = stats.data_blocks_used;
+		status->logical_blocks_used = stats.logical_blocks_used;
 
 		status->usage = dm_make_percent(result.status->used_blocks,
 						result.status->total_blocks);
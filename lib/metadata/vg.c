@@ -58,16 +58,166 @@ struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
 	dm_list_init(&vg->historical_lvs);
 	dm_list_init(&vg->tags);
 	dm_list_init(&vg->removed_lvs);
+	dm_list_init(&vg->changed_lvs);
 	dm_list_init(&vg->removed_historical_lvs);
 	dm_list_init(&vg->removed_pvs);
+	dm_list_init(&vg->removed_lv_msgs);
+	dm_list_init(&vg->pending_discards);
+	dm_list_init(&vg->committed_discards);
 
 	log_debug_mem("Allocated VG %s at %p.", vg->name ? : "<no name>", (void *)vg);
 
 	return vg;
 }
 
+/*
+ * vg->lv_names and vg->lvids are built from vg->lvs on first lookup
+ * and then kept up to date by link_lv_to_vg(), unlink_lv_from_vg()
+ * and lv_index_rename().  LV names and lvids can still change behind
+ * their back (lvids are read after the LVs are linked during import,
+ * vgsplit and vgmerge move lv_lists between VGs) so an entry is only
+ * trusted after checking it against its LV, and the callers search
+ * vg->lvs when nothing was found.
+ */
+static void _lv_index_drop(struct volume_group *vg)
+{
+	if (vg->lv_names) {
+		dm_hash_destroy(vg->lv_names);
+		vg->lv_names = NULL;
+	}
+
+	if (vg->lvids) {
+		dm_hash_destroy(vg->lvids);
+		vg->lvids = NULL;
+	}
+}
+
+static int _lv_index_insert(struct volume_group *vg, struct lv_list *lvl)
+{
+	struct logical_volume *lv = lvl->lv;
+
+	if (!dm_hash_insert(vg->lv_names, lv->name, lvl))
+		return_0;
+
+	if (*lv->lvid.s &&
+	    !dm_hash_insert_binary(vg->lvids, &lv->lvid.id, sizeof(lv->lvid.id), lvl))
+		return_0;
+
+	return 1;
+}
+
+static int _lv_index_build(struct volume_group *vg)
+{
+	struct lv_list *lvl;
+	unsigned size = 2 * dm_list_size(&vg->lvs);
+
+	if (size < 64)
+		size = 64;
+
+	if (!(vg->lv_names = dm_hash_create(size)) ||
+	    !(vg->lvids = dm_hash_create(size))) {
+		log_debug("Failed to allocate LV indexes for VG %s.", vg->name);
+		_lv_index_drop(vg);
+		return 0;
+	}
+
+	vg->lv_index_size = size;
+
+	/* Backwards so the first of any duplicates in vg->lvs wins */
+	dm_list_iterate_back_items(lvl, &vg->lvs)
+		if (!_lv_index_insert(vg, lvl)) {
+			_lv_index_drop(vg);
+			return 0;
+		}
+
+	return 1;
+}
+
+static int _lv_index_usable(struct volume_group *vg, struct lv_list *lvl)
+{
+	return lvl && (lvl->lv->vg == vg) && !(lvl->lv->status & LV_REMOVED);
+}
+
+struct lv_list *lv_index_find_name(struct volume_group *vg, const char *lv_name)
+{
+	struct lv_list *lvl;
+
+	if (!vg->lv_names && !_lv_index_build(vg))
+		return NULL;
+
+	lvl = dm_hash_lookup(vg->lv_names, lv_name);
+
+	if (!_lv_index_usable(vg, lvl) || strcmp(lvl->lv->name, lv_name))
+		return NULL;
+
+	return lvl;
+}
+
+struct lv_list *lv_index_find_lvid(struct volume_group *vg, const union lvid *lvid)
+{
+	struct lv_list *lvl;
+
+	if (!vg->lvids && !_lv_index_build(vg))
+		return NULL;
+
+	lvl = dm_hash_lookup_binary(vg->lvids, &lvid->id, sizeof(lvid->id));
+
+	if (!_lv_index_usable(vg, lvl) ||
+	    memcmp(&lvl->lv->lvid.id, &lvid->id, sizeof(lvid->id)))
+		return NULL;
+
+	return lvl;
+}
+
+/*
+ * Record a newly linked LV or one the indexes missed.  An LV sharing
+ * its name or lvid with one that is already indexed does not replace
+ * it.  Indexes that have outgrown their size are dropped and rebuilt
+ * on next use.
+ */
+void lv_index_add(struct volume_group *vg, struct lv_list *lvl)
+{
+	struct logical_volume *lv = lvl->lv;
+
+	if (!vg->lv_names)
+		return;
+
+	if (dm_hash_get_num_entries(vg->lv_names) > 2 * vg->lv_index_size)
+		goto bad;
+
+	if (!lv_index_find_name(vg, lv->name) &&
+	    !dm_hash_insert(vg->lv_names, lv->name, lvl))
+		goto_bad;
+
+	if (*lv->lvid.s && !lv_index_find_lvid(vg, &lv->lvid) &&
+	    !dm_hash_insert_binary(vg->lvids, &lv->lvid.id, sizeof(lv->lvid.id), lvl))
+		goto_bad;
+
+	return;
+bad:
+	_lv_index_drop(vg);
+}
+
+void lv_index_rename(struct logical_volume *lv, const char *old_name)
+{
+	struct volume_group *vg = lv->vg;
+	struct lv_list *lvl;
+
+	if (!vg->lv_names || !old_name ||
+	    !(lvl = dm_hash_lookup(vg->lv_names, old_name)) || (lvl->lv != lv))
+		return;
+
+	dm_hash_remove(vg->lv_names, old_name);
+
+	if (!dm_hash_insert(vg->lv_names, lv->name, lvl))
+		_lv_index_drop(vg);
+}
+
 static void _free_vg(struct volume_group *vg)
 {
+	struct lv_list *lvl;
+	struct pv_list *pvl;
+
 	vg_set_fid(vg, NULL);
 
 	if (vg->cmd && vg->vgmem == vg->cmd->mem) {
@@ -78,7 +228,19 @@ static void _free_vg(struct volume_group *vg)
 
 	log_debug_mem("Freeing VG %s at %p.", vg->name ? : "<no name>", (void *)vg);
 
+	dm_list_iterate_items(lvl, &vg->lvs)
+		lv_free_seg_index(lvl->lv);
+	dm_list_iterate_items(lvl, &vg->removed_lvs)
+		lv_free_seg_index(lvl->lv);
+	dm_list_iterate_items(pvl, &vg->pvs)
+		pv_free_seg_index(pvl->pv);
+	dm_list_iterate_items(pvl, &vg->removed_pvs)
+		pv_free_seg_index(pvl->pv);
+
+	_lv_index_drop(vg);
 	dm_hash_destroy(vg->hostnames);
+	if (vg->strings)
+		dm_hash_destroy(vg->strings);
 	dm_pool_destroy(vg->vgmem);
 }
 
@@ -89,6 +251,8 @@ void release_vg(struct volume_group *vg)
 
 	release_vg(vg->vg_committed);
 	release_vg(vg->vg_precommitted);
+	free(vg->vg_committed_text);
+	free(vg->vg_precommitted_text);
 	_free_vg(vg);
 }
 
@@ -118,6 +282,7 @@ int link_lv_to_vg(struct volume_group *vg, struct logical_volume *lv)
 	lv->vg = vg;
 	dm_list_add(&vg->lvs, &lvl->list);
 	lv->status &= ~LV_REMOVED;
+	lv_index_add(vg, lvl);
 
 	return 1;
 }
@@ -132,6 +297,9 @@ int unlink_lv_from_vg(struct logical_volume *lv)
 	dm_list_move(&lv->vg->removed_lvs, &lvl->list);
 	lv->status |= LV_REMOVED;
 
+	if (lv->vg->lv_names && (dm_hash_lookup(lv->vg->lv_names, lv->name) == lvl))
+		dm_hash_remove(lv->vg->lv_names, lv->name);
+
 	return 1;
 }
 
@@ -329,6 +497,30 @@ char *vg_profile_dup(const struct volume_group *vg)
 	return dm_pool_strdup(vg->vgmem, profile_name);
 }
 
+/*
+ * Return one shared copy of str in vgmem, so the same tag on many
+ * objects of a VG is stored once.  Interned strings must not be
+ * modified.
+ */
+const char *vg_intern_str(struct volume_group *vg, const char *str)
+{
+	const char *istr;
+
+	if (!vg->strings && !(vg->strings = dm_hash_create(64)))
+		return_NULL;
+
+	if ((istr = dm_hash_lookup(vg->strings, str)))
+		return istr;
+
+	if (!(istr = dm_pool_strdup(vg->vgmem, str)))
+		return_NULL;
+
+	if (!dm_hash_insert(vg->strings, istr, (void *) istr))
+		return_NULL;
+
+	return istr;
+}
+
 static int _recalc_extents(uint32_t *extents, const char *desc1,
 			   const char *desc2, uint32_t old_extent_size,
 			   uint32_t new_extent_size)
@@ -21,6 +21,7 @@
 struct cmd_context;
 struct format_instance;
 struct logical_volume;
+struct lv_list;
 
 typedef enum {
 	ALLOC_INVALID,
@@ -42,7 +43,9 @@ struct volume_group {
 	struct lvmcache_vginfo *vginfo;
 	uint32_t seqno;		/* Metadata sequence number */
 	unsigned skip_validate_lock_args : 1;
+	unsigned read_without_lock : 1;	/* No VG lock held, see unlock_vg() */
 	uint32_t write_count; /* count the number of vg_write calls */
+	uint32_t text_size;	/* Size of the last metadata text export */
 
 	/*
 	 * The parsed committed (on-disk) copy of this VG; is NULL if this VG is committed
@@ -50,9 +53,18 @@ struct volume_group {
 	 * there is no guarantee that if this VG is the same as the committed one
 	 * this will be NULL). The pointer is maintained by calls to
 	 * _vg_update_vg_committed.
+	 *
+	 * Copies start out as exported metadata text and are only parsed
+	 * into a VG by vg_get_committed() when something actually needs
+	 * them, so most commands never pay for the import.
 	 */
 	struct volume_group *vg_committed;
 	struct volume_group *vg_precommitted;
+	char *vg_committed_text;
+	char *vg_precommitted_text;
+	/* Set during vg_write: vg_precommitted_text, written to each mda */
+	const char *write_text;
+	size_t write_text_size;
 
 	alloc_policy_t alloc;
 	struct profile *profile;
@@ -100,6 +112,14 @@ struct volume_group {
 	struct dm_list lvs;
 	struct dm_list historical_lvs;
 
+	/*
+	 * Indexes of lvs by name and by lvid, built on first lookup.
+	 * See find_lv_in_vg() and find_lv_in_vg_by_lvid().
+	 */
+	struct dm_hash_table *lv_names;	/* LV name to struct lv_list */
+	struct dm_hash_table *lvids;	/* LV lvid to struct lv_list */
+	unsigned lv_index_size;		/* Size hint the indexes were built with */
+
 	struct dm_list tags;
 
 	/*
@@ -111,6 +131,12 @@ struct volume_group {
 	 */
 	struct dm_list removed_lvs;
 
+	/*
+	 * List of LVs the only changes of which are their properties,
+	 * by vg_mark_lv_changed().  Cleared by vg_validate().
+	 */
+	struct dm_list changed_lvs;
+
 	/*
 	 * List of removed historical logical volumes by historical_glv_remove.
 	 */
@@ -121,11 +147,26 @@ struct volume_group {
 	 * They have to get cleared on vg_commit.
 	 */
 	struct dm_list removed_pvs;
+
+	/*
+	 * Set while several LVs are being removed: lv_remove_single() leaves
+	 * the metadata commit and thin pool messages to vg_commit_removed_lvs()
+	 * and queues its "successfully removed" messages here (str_list).
+	 */
+	unsigned defer_remove_commit : 1;
+	struct dm_list removed_lv_msgs;
+
+	/* Extents to discard after vg_commit() (struct pv_discard) */
+	struct dm_list pending_discards;
+	/* Committed ones, discarded by unlock_vg() (struct pv_discard) */
+	struct dm_list committed_discards;
+
 	uint32_t open_mode; /* FIXME: read or write - check lock type? */
 
 	uint32_t mda_copies; /* target number of mdas for this VG */
 
 	struct dm_hash_table *hostnames; /* map of creation hostnames */
+	struct dm_hash_table *strings;	/* interned tags, see vg_intern_str() */
 	struct logical_volume *pool_metadata_spare_lv; /* one per VG */
 	struct logical_volume *sanlock_lv; /* one per VG */
 };
@@ -138,6 +179,7 @@ struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
  * by vg_create() or vg_read_internal() to free it when no longer required.
  */
 void release_vg(struct volume_group *vg);
+struct volume_group *vg_get_committed(struct volume_group *vg);
 void free_orphan_vg(struct volume_group *vg);
 
 char *vg_fmt_dup(const struct volume_group *vg);
@@ -167,6 +209,16 @@ uint32_t vg_mda_used_count(const struct volume_group *vg);
 uint32_t vg_mda_copies(const struct volume_group *vg);
 int vg_set_mda_copies(struct volume_group *vg, uint32_t mda_copies);
 char *vg_profile_dup(const struct volume_group *vg);
+const char *vg_intern_str(struct volume_group *vg, const char *str);
+
+/*
+ * Lookups in vg->lv_names and vg->lvids.  They return NULL if nothing
+ * was found in the indexes and the caller must then search vg->lvs.
+ */
+struct lv_list *lv_index_find_name(struct volume_group *vg, const char *lv_name);
+struct lv_list *lv_index_find_lvid(struct volume_group *vg, const union lvid *lvid);
+void lv_index_add(struct volume_group *vg, struct lv_list *lvl);
+void lv_index_rename(struct logical_volume *lv, const char *old_name);
 
 /*
  * Returns visible LV count - number of LVs from user perspective
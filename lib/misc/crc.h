@@ -20,6 +20,20 @@
 
 #define INITIAL_CRC 0xf597a6cf
 
+typedef uint32_t (*crc_fn_t)(uint32_t initial, const uint8_t *buf, uint32_t size);
+
 uint32_t calc_crc(uint32_t initial, const uint8_t *buf, uint32_t size);
 
+/*
+ * calc_crc() dispatches to the fastest implementation the CPU supports.
+ * Variants are numbered best first.  crc_variant_fn() returns NULL for
+ * a variant this CPU cannot run.  crc_select_variant() makes calc_crc()
+ * use the named variant, or the best one for NULL, and fails if it is
+ * unknown or unsupported.
+ */
+unsigned crc_variant_count(void);
+const char *crc_variant_name(unsigned variant);
+crc_fn_t crc_variant_fn(unsigned variant);
+int crc_select_variant(const char *name);
+
 #endif
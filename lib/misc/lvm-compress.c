@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/misc/lvm-compress.h"
+#include "lib/mm/xlate.h"
+
+int text_is_delta(const char *buf, size_t size)
+{
+	return (size >= DELTA_TEXT_MAGIC_LEN) &&
+		!memcmp(buf, DELTA_TEXT_MAGIC, DELTA_TEXT_MAGIC_LEN - 1) &&
+		(buf[DELTA_TEXT_MAGIC_LEN - 1] == '\n');
+}
+
+#ifdef METADATA_COMPRESSION_SUPPORT
+#include <zlib.h>
+#endif
+
+/* Matches the growth of text_vg_export_raw() buffers. */
+#define COMPRESSED_BUF_ALIGN 65536
+
+int text_is_compressed(const char *buf, size_t size)
+{
+	return (size >= sizeof(struct compressed_text_header)) &&
+		!memcmp(buf, COMPRESSED_TEXT_MAGIC, COMPRESSED_TEXT_MAGIC_LEN);
+}
+
+#ifdef METADATA_COMPRESSION_SUPPORT
+
+int compressed_text_supported(void)
+{
+	return 1;
+}
+
+size_t compress_text(const char *text, size_t text_size,
+		     char **buf, uint32_t *buf_size)
+{
+	struct compressed_text_header *hdr;
+	uLongf data_size = compressBound(text_size);
+	size_t size = (sizeof(*hdr) + data_size + COMPRESSED_BUF_ALIGN - 1) &
+		~((size_t) COMPRESSED_BUF_ALIGN - 1);
+	char *cbuf;
+	int ret;
+
+	if (!(cbuf = zalloc(size))) {
+		log_error("Failed to allocate compressed metadata buffer.");
+		return 0;
+	}
+
+	if ((ret = compress2((Bytef *) cbuf + sizeof(*hdr), &data_size,
+			     (const Bytef *) text, text_size,
+			     Z_BEST_SPEED)) != Z_OK) {
+		log_error("Failed to compress metadata: %s.", zError(ret));
+		free(cbuf);
+		return 0;
+	}
+
+	if (sizeof(*hdr) + data_size >= text_size) {
+		log_debug_metadata("Compressed metadata (%zu bytes) not smaller than text (%zu bytes).",
+				   sizeof(*hdr) + (size_t) data_size, text_size);
+		free(cbuf);
+		return 0;
+	}
+
+	hdr = (struct compressed_text_header *) cbuf;
+	memcpy(hdr->magic, COMPRESSED_TEXT_MAGIC, COMPRESSED_TEXT_MAGIC_LEN);
+	hdr->text_size = xlate32((uint32_t) text_size);
+	hdr->data_size = xlate32((uint32_t) data_size);
+
+	*buf = cbuf;
+	*buf_size = (uint32_t) size;
+
+	return sizeof(*hdr) + data_size;
+}
+
+char *decompress_text(const char *buf, size_t size, size_t *text_size)
+{
+	const struct compressed_text_header *hdr = (const struct compressed_text_header *) buf;
+	uLongf tsize = xlate32(hdr->text_size);
+	uLong dsize = xlate32(hdr->data_size);
+	char *text;
+	int ret;
+
+	if (dsize > size - sizeof(*hdr)) {
+		log_error("Compressed metadata size %lu exceeds area size %zu.",
+			  (unsigned long) dsize, size - sizeof(*hdr));
+		return NULL;
+	}
+
+	if (!(text = malloc(tsize ? : 1))) {
+		log_error("Failed to allocate metadata buffer.");
+		return NULL;
+	}
+
+	if ((ret = uncompress((Bytef *) text, &tsize,
+			      (const Bytef *) buf + sizeof(*hdr), dsize)) != Z_OK) {
+		log_error("Failed to decompress metadata: %s.", zError(ret));
+		free(text);
+		return NULL;
+	}
+
+	*text_size = tsize;
+
+	return text;
+}
+
+#else
+
+int compressed_text_supported(void)
+{
+	return 0;
+}
+
+size_t compress_text(const char *text, size_t text_size,
+		     char **buf, uint32_t *buf_size)
+{
+	return 0;
+}
+
+char *decompress_text(const char *buf, size_t size, size_t *text_size)
+{
+	log_error("Compressed metadata is not supported by this build.");
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_COMPRESS_H
+#define _LVM_COMPRESS_H
+
+/*
+ * Compressed metadata text starts with this header in place of the
+ * VG name.  The magic cannot begin a valid VG name, so plain and
+ * compressed text are told apart by content alone.
+ */
+#define COMPRESSED_TEXT_MAGIC "\037LVMZ01"
+#define COMPRESSED_TEXT_MAGIC_LEN 8
+
+struct compressed_text_header {
+	char magic[COMPRESSED_TEXT_MAGIC_LEN];
+	uint32_t text_size;	/* Uncompressed bytes, little endian */
+	uint32_t data_size;	/* Compressed bytes following, little endian */
+} __attribute__ ((packed));
+
+/*
+ * Delta metadata text (see format_text/text_delta.c) starts with this
+ * line, which likewise cannot begin a VG name.  The VG name follows it.
+ */
+#define DELTA_TEXT_MAGIC "\037LVMD01"
+#define DELTA_TEXT_MAGIC_LEN 8	/* Including the newline that ends it */
+
+int compressed_text_supported(void);
+int text_is_compressed(const char *buf, size_t size);
+int text_is_delta(const char *buf, size_t size);
+
+/*
+ * Returns the number of bytes used in *buf, 0 on failure or when
+ * compression would not make the text smaller.  *buf is zeroed
+ * after the used bytes and must be freed by the caller.
+ */
+size_t compress_text(const char *text, size_t text_size,
+		     char **buf, uint32_t *buf_size);
+
+/* Returns a malloc'd copy of the text, NULL on error. */
+char *decompress_text(const char *buf, size_t size, size_t *text_size);
+
+#endif /* _LVM_COMPRESS_H */
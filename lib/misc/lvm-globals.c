@@ -25,11 +25,14 @@ static int _verbose_level = VERBOSE_BASE_LEVEL;
 static int _silent = 0;
 static int _test = 0;
 static int _use_aio = 0;
+static int _use_io_uring = 0;
+static int _io_threads = 0;
 static int _md_filtering = 0;
 static int _internal_filtering = 0;
 static int _fwraid_filtering = 0;
 static int _pvmove = 0;
 static int _obtain_device_list_from_udev = DEFAULT_OBTAIN_DEVICE_LIST_FROM_UDEV;
+static int _obtain_device_list_from_sysfs = DEFAULT_OBTAIN_DEVICE_LIST_FROM_SYSFS;
 static enum dev_ext_e _external_device_info_source = DEV_EXT_NONE;
 static int _debug_level = 0;
 static int _debug_classes_logged = 0;
@@ -49,6 +52,7 @@ static unsigned _is_static = 0;
 static int _udev_checking = 1;
 static int _udev_sleeping = 1;
 static int _retry_deactivation = DEFAULT_RETRY_DEACTIVATION;
+static int _deferred_remove = DEFAULT_DEFERRED_REMOVE;
 static int _activation_checks = 0;
 static char _sysfs_dir_path[PATH_MAX] = "";
 static uint64_t _pv_min_size = (DEFAULT_PV_MIN_SIZE_KB * 1024L >> SECTOR_SHIFT);
@@ -77,6 +81,16 @@ void init_use_aio(int useaio)
 	_use_aio = useaio;
 }
 
+void init_use_io_uring(int useiouring)
+{
+	_use_io_uring = useiouring;
+}
+
+void init_io_threads(int iothreads)
+{
+	_io_threads = iothreads;
+}
+
 void init_md_filtering(int level)
 {
 	_md_filtering = level;
@@ -102,6 +116,11 @@ void init_obtain_device_list_from_udev(int device_list_from_udev)
 	_obtain_device_list_from_udev = device_list_from_udev;
 }
 
+void init_obtain_device_list_from_sysfs(int device_list_from_sysfs)
+{
+	_obtain_device_list_from_sysfs = device_list_from_sysfs;
+}
+
 void init_external_device_info_source(enum dev_ext_e src)
 {
 	_external_device_info_source = src;
@@ -197,6 +216,11 @@ void init_retry_deactivation(int retry)
 	_retry_deactivation = retry;
 }
 
+void init_deferred_remove(int deferred)
+{
+	_deferred_remove = deferred;
+}
+
 void init_activation_checks(int checks)
 {
 	if ((_activation_checks = checks))
@@ -255,6 +279,16 @@ int use_aio(void)
 	return _use_aio;
 }
 
+int use_io_uring(void)
+{
+	return _use_io_uring;
+}
+
+int io_threads(void)
+{
+	return _io_threads;
+}
+
 int md_filtering(void)
 {
 	return _md_filtering;
@@ -280,6 +314,11 @@ int obtain_device_list_from_udev(void)
 	return _obtain_device_list_from_udev;
 }
 
+int obtain_device_list_from_sysfs(void)
+{
+	return _obtain_device_list_from_sysfs;
+}
+
 enum dev_ext_e external_device_info_source(void)
 {
 	return _external_device_info_source;
@@ -369,6 +408,11 @@ int retry_deactivation(void)
 	return _retry_deactivation;
 }
 
+int deferred_remove(void)
+{
+	return _deferred_remove;
+}
+
 int activation_checks(void)
 {
 	return _activation_checks;
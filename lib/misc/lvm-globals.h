@@ -26,12 +26,15 @@ void init_verbose(int level);
 void init_silent(int silent);
 void init_test(int level);
 void init_use_aio(int useaio);
+void init_use_io_uring(int useiouring);
+void init_io_threads(int iothreads);
 void init_md_filtering(int level);
 void init_internal_filtering(int level);
 void init_fwraid_filtering(int level);
 void init_pvmove(int level);
 void init_external_device_info_source(enum dev_ext_e src);
 void init_obtain_device_list_from_udev(int device_list_from_udev);
+void init_obtain_device_list_from_sysfs(int device_list_from_sysfs);
 void init_debug(int level);
 void init_debug_classes_logged(int classes);
 void init_cmd_name(int status);
@@ -50,6 +53,7 @@ void init_udev_sleeping(int sleeping);
 void init_pv_min_size(uint64_t sectors);
 void init_activation_checks(int checks);
 void init_retry_deactivation(int retry);
+void init_deferred_remove(int deferred);
 void init_unknown_device_name(const char *name);
 void init_io_memory_size(int val);
 
@@ -59,11 +63,14 @@ void set_sysfs_dir_path(const char *path);
 
 int test_mode(void);
 int use_aio(void);
+int use_io_uring(void);
+int io_threads(void);
 int md_filtering(void);
 int internal_filtering(void);
 int fwraid_filtering(void);
 int pvmove_mode(void);
 int obtain_device_list_from_udev(void);
+int obtain_device_list_from_sysfs(void);
 enum dev_ext_e external_device_info_source(void);
 int verbose_level(void);
 int silent_mode(void);
@@ -83,6 +90,7 @@ const char *sysfs_dir_path(void);
 uint64_t pv_min_size(void);
 int activation_checks(void);
 int retry_deactivation(void);
+int deferred_remove(void);
 const char *unknown_device_name(void);
 int io_memory_size(void);
 
@@ -18,6 +18,7 @@
 #include "lib/config/defaults.h"
 #include "lib/config/config.h"
 #include "lib/commands/toolcontext.h"
+#include "lib/log/timing.h"
 
 #include <limits.h>
 #include <fcntl.h>
@@ -145,6 +146,19 @@ static char _procselfmaps[PATH_MAX] = "";
 #define SELF_MAPS "/self/maps"
 
 static size_t _mstats; /* statistic for maps locking */
+static size_t _heap_locked; /* malloc heap size when memory was locked */
+
+/*
+ * Maps locked by _lock_mem(), so _unlock_mem() can unlock them without
+ * reading and filtering /proc/self/maps a second time.
+ */
+struct locked_map {
+	unsigned long from;
+	size_t sz;
+};
+
+static struct locked_map *_locked_maps;
+static unsigned _locked_maps_count;
 
 static void _touch_memory(void *mem, size_t size)
 {
@@ -228,6 +242,17 @@ static void _release_memory(void)
 	free(_malloc_mem);
 }
 
+static size_t _heap_size(void)
+{
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 inf = mallinfo2();
+#else
+	struct mallinfo inf = mallinfo();
+#endif
+
+	return (size_t) inf.arena + (size_t) inf.hblkhd;
+}
+
 /*
  * mlock/munlock memory areas from /proc/self/maps
  * format described in kernel/Documentation/filesystem/proc.txt
@@ -304,6 +329,8 @@ static int _maps_line(const struct dm_config_node *cn, lvmlock_t lock,
 			log_sys_error("mlock", line);
 			return 0;
 		}
+		_locked_maps[_locked_maps_count].from = from;
+		_locked_maps[_locked_maps_count++].sz = sz;
 	} else {
 		if (munlock((const void*)from, sz) < 0) {
 			log_sys_error("munlock", line);
@@ -320,6 +347,7 @@ static int _memlock_maps(struct cmd_context *cmd, lvmlock_t lock, size_t *mstats
 	char *line, *line_end;
 	size_t len;
 	ssize_t n;
+	unsigned i;
 	int ret = 1;
 
 	if (_use_mlockall) {
@@ -344,6 +372,26 @@ static int _memlock_maps(struct cmd_context *cmd, lvmlock_t lock, size_t *mstats
 	/* Reset statistic counters */
 	*mstats = 0;
 
+	if (lock == LVM_MUNLOCK && _locked_maps) {
+		for (i = 0; i < _locked_maps_count; i++) {
+			/* ENOMEM: the map went away while locked. */
+			if (munlock((const void *) _locked_maps[i].from, _locked_maps[i].sz) &&
+			    (errno != ENOMEM)) {
+				log_sys_error("munlock", "");
+				ret = 0;
+			}
+			*mstats += _locked_maps[i].sz;
+		}
+
+		log_debug_mem("Unlocked %ld bytes in %u maps.", (long)*mstats, _locked_maps_count);
+
+		free(_locked_maps);
+		_locked_maps = NULL;
+		_locked_maps_count = 0;
+
+		return ret;
+	}
+
 	/* read mapping into a single memory chunk without reallocation
 	 * in the middle of reading maps file */
 	for (len = 0;;) {
@@ -375,6 +423,19 @@ static int _memlock_maps(struct cmd_context *cmd, lvmlock_t lock, size_t *mstats
 	line = _maps_buffer;
 	cn = find_config_tree_array(cmd, activation_mlock_filter_CFG, NULL);
 
+	if (lock == LVM_MLOCK) {
+		/* One entry per line at most, allocated before anything is locked. */
+		for (i = 1, line_end = line; (line_end = strchr(line_end, '\n')); line_end++)
+			i++;
+
+		free(_locked_maps);
+		_locked_maps_count = 0;
+		if (!(_locked_maps = malloc(i * sizeof(*_locked_maps)))) {
+			log_error("Allocation of locked maps failed.");
+			return 0;
+		}
+	}
+
 	while ((line_end = strchr(line, '\n'))) {
 		*line_end = '\0'; /* remove \n */
 		if (!_maps_line(cn, lock, line, mstats))
@@ -514,6 +575,8 @@ static void _restore_priority_if_possible(struct cmd_context *cmd)
 /* Stop memory getting swapped out */
 static void _lock_mem(struct cmd_context *cmd)
 {
+	timing_start(TIMING_MEMLOCK);
+
 	_allocate_memory();
 	(void)strerror(0);		/* Force libc.mo load */
 	(void)dm_udev_get_sync_support(); /* udev is initialized */
@@ -533,12 +596,12 @@ static void _lock_mem(struct cmd_context *cmd)
 		    dm_snprintf(_procselfmaps, sizeof(_procselfmaps),
 				"%s" SELF_MAPS, cmd->proc_dir) < 0) {
 			log_error("proc_dir too long");
-			return;
+			goto out;
 		}
 
 		if (!(_maps_fd = open(_procselfmaps, O_RDONLY))) {
 			log_sys_error("open", _procselfmaps);
-			return;
+			goto out;
 		}
 
 		if (!_disable_mmap())
@@ -547,11 +610,17 @@ static void _lock_mem(struct cmd_context *cmd)
 
 	if (!_memlock_maps(cmd, LVM_MLOCK, &_mstats))
 		stack;
+
+	_heap_locked = _heap_size();
+out:
+	timing_end(TIMING_MEMLOCK);
 }
 
 static void _unlock_mem(struct cmd_context *cmd)
 {
-	size_t unlock_mstats;
+	size_t unlock_mstats, heap;
+
+	timing_start(TIMING_MEMLOCK);
 
 	log_very_verbose("Unlocking memory");
 
@@ -564,21 +633,24 @@ static void _unlock_mem(struct cmd_context *cmd)
 			log_sys_error("close", _procselfmaps);
 		free(_maps_buffer);
 		_maps_buffer = NULL;
-		if (_mstats < unlock_mstats) {
-			if ((_mstats + lvm_getpagesize()) < unlock_mstats)
+		/* Heap growth means malloc went beyond the reserved memory. */
+		if ((heap = _heap_size()) > _heap_locked) {
+			if ((_heap_locked + lvm_getpagesize()) < heap)
 				log_error(INTERNAL_ERROR
-					  "Reserved memory (%ld) not enough: used %ld. Increase activation/reserved_memory?",
-					  (long)_mstats, (long)unlock_mstats);
+					  "Reserved memory (%ld) not enough: heap grew to %ld. Increase activation/reserved_memory?",
+					  (long)_heap_locked, (long)heap);
 			else
 				/* FIXME Believed due to incorrect use of yes_no_prompt while locks held */
-				log_debug_mem("Suppressed internal error: Maps lock %ld < unlock %ld, a one-page difference.",
-					      (long)_mstats, (long)unlock_mstats);
+				log_debug_mem("Suppressed internal error: Heap lock %ld < unlock %ld, a one-page difference.",
+					      (long)_heap_locked, (long)heap);
 		}
 	}
 
 	_restore_priority_if_possible(cmd);
 
 	_release_memory();
+
+	timing_end(TIMING_MEMLOCK);
 }
 
 static void _lock_mem_if_needed(struct cmd_context *cmd)
@@ -253,8 +253,8 @@ static int _raid_target_present(struct cmd_context *cmd,
 				unsigned *attributes);
 
 static int _raid_add_target_line(struct dev_manager *dm __attribute__((unused)),
-				 struct dm_pool *mem __attribute__((unused)),
-				 struct cmd_context *cmd __attribute__((unused)),
+				 struct dm_pool *mem,
+				 struct cmd_context *cmd,
 				 void **target_state __attribute__((unused)),
 				 struct lv_segment *seg,
 				 const struct lv_activate_opts *laopts __attribute__((unused)),
@@ -268,6 +268,7 @@ static int _raid_add_target_line(struct dev_manager *dm __attribute__((unused)),
 	uint64_t writemostly[RAID_BITMAP_SIZE] = { 0 };
 	struct dm_tree_node_raid_params_v2 params = { 0 };
 	unsigned attrs;
+	int bandwidth;
 
 	if (seg_is_raid4(seg)) {
 		if (!_raid_target_present(cmd, NULL, &attrs) ||
@@ -356,6 +357,10 @@ static int _raid_add_target_line(struct dev_manager *dm __attribute__((unused)),
 		memcpy(params.rebuilds, rebuilds, sizeof(params.rebuilds));
 		params.min_recovery_rate = seg->min_recovery_rate;
 		params.max_recovery_rate = seg->max_recovery_rate;
+		if (!params.max_recovery_rate &&
+		    ((bandwidth = find_config_tree_int(cmd, activation_raid_recovery_bandwidth_CFG, NULL)) > 0) &&
+		    !(params.max_recovery_rate = raid_shared_max_recovery_rate(mem, seg, (uint32_t) bandwidth)))
+			return_0;
 		params.delta_disks = delta_disks;
 		params.data_offset = data_offset;
 	}
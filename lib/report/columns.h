@@ -87,6 +87,7 @@ FIELD(LVS, lv, NUM, "MaxSync", lvid, 0, raidmaxrecoveryrate, raid_max_recovery_r
 FIELD(LVS, lv, STR, "IntegMode", lvid, 0, raidintegritymode, raidintegritymode, "The integrity mode", 0)
 FIELD(LVS, lv, NUM, "IntegBlkSize", lvid, 0, raidintegrityblocksize, raidintegrityblocksize, "The integrity block size", 0)
 FIELD(LVS, lv, NUM, "IntegMismatches", lvid, 0, integritymismatches, integritymismatches, "The number of integrity mismatches.", 0)
+FIELD(LVS, lv, PCT, "Integ%Init", lvid, 0, integrityinitpercent, integrity_init_percent, "For integrity and raid with integrity, the percentage of data initialized if LV is active.", 0)
 FIELD(LVS, lv, STR, "Move", lvid, 0, movepv, move_pv, "For pvmove, Source PV of temporary LV created by pvmove.", 0)
 FIELD(LVS, lv, STR, "Move UUID", lvid, 38, movepvuuid, move_pv_uuid, "For pvmove, the UUID of Source PV of temporary LV created by pvmove.", 0)
 FIELD(LVS, lv, STR, "Convert", lvid, 0, convertlv, convert_lv, "For lvconvert, Name of temporary LV created by lvconvert.", 0)
@@ -132,6 +133,10 @@ FIELD(LVSINFO, lv, BIN, "DevOpen", lvid, 10, lvdeviceopen, lv_device_open, "Set
 FIELD(LVSSTATUS, lv, PCT, "Data%", lvid, 6, datapercent, data_percent, "For snapshot, cache and thin pools and volumes, the percentage full if LV is active.", 0)
 FIELD(LVSSTATUS, lv, PCT, "Snap%", lvid, 6, snpercent, snap_percent, "For snapshots, the percentage full if LV is active.", 0)
 FIELD(LVSSTATUS, lv, PCT, "Meta%", lvid, 6, metadatapercent, metadata_percent, "For cache and thin pools, the percentage of metadata full if LV is active.", 0)
+FIELD(LVSSTATUS, lv, PCT, "Data%/h", lvid, 7, datafillrate, data_fill_rate, "For thin pools, data usage growth in percent per hour from recent lvs and dmeventd samples, at most 100.", 0)
+FIELD(LVSSTATUS, lv, PCT, "Meta%/h", lvid, 7, metadatafillrate, metadata_fill_rate, "For thin pools, metadata usage growth in percent per hour from recent lvs and dmeventd samples, at most 100.", 0)
+FIELD(LVSSTATUS, lv, NUM, "DataTTF", lvid, 7, datatimetofull, data_time_to_full, "For thin pools, estimated seconds until data is full at the current fill rate.", 0)
+FIELD(LVSSTATUS, lv, NUM, "MetaTTF", lvid, 7, metadatatimetofull, metadata_time_to_full, "For thin pools, estimated seconds until metadata is full at the current fill rate.", 0)
 FIELD(LVSSTATUS, lv, PCT, "Cpy%Sync", lvid, 0, copypercent, copy_percent, "For Cache, RAID, mirrors and pvmove, current percentage in-sync.", 0)
 FIELD(LVSSTATUS, lv, PCT, "Cpy%Sync", lvid, 0, copypercent, sync_percent, "For Cache, RAID, mirrors and pvmove, current percentage in-sync.", 0)
 FIELD(LVSSTATUS, lv, NUM, "CacheTotalBlocks", lvid, 0, cache_total_blocks, cache_total_blocks, "Total cache blocks.", 0)
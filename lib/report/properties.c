@@ -130,6 +130,16 @@ static uint64_t _integritymismatches(const struct logical_volume *lv)
 	return cnt;
 }
 
+static dm_percent_t _integrity_init_percent(const struct logical_volume *lv)
+{
+	dm_percent_t percent;
+
+	if (!lv_integrity_init_percent(lv->vg->cmd, lv, &percent))
+		percent = DM_PERCENT_INVALID;
+
+	return percent;
+}
+
 static dm_percent_t _snap_percent(const struct logical_volume *lv)
 {
 	dm_percent_t percent;
@@ -343,6 +353,15 @@ GET_PV_NUM_PROPERTY_FN(pv_ba_size, SECTOR_SIZE * pv->ba_size)
 #define _writecache_error_set prop_not_implemented_set
 #define _writecache_error_get prop_not_implemented_get
 
+#define _data_fill_rate_set prop_not_implemented_set
+#define _data_fill_rate_get prop_not_implemented_get
+#define _metadata_fill_rate_set prop_not_implemented_set
+#define _metadata_fill_rate_get prop_not_implemented_get
+#define _data_time_to_full_set prop_not_implemented_set
+#define _data_time_to_full_get prop_not_implemented_get
+#define _metadata_time_to_full_set prop_not_implemented_set
+#define _metadata_time_to_full_get prop_not_implemented_get
+
 #define _vdo_operating_mode_set prop_not_implemented_set
 #define _vdo_operating_mode_get prop_not_implemented_get
 #define _vdo_compression_state_set prop_not_implemented_set
@@ -461,6 +480,8 @@ GET_LV_NUM_PROPERTY_FN(raidintegrityblocksize, _raidintegrityblocksize(lv))
 #define _raidintegrityblocksize_set prop_not_implemented_set
 GET_LV_NUM_PROPERTY_FN(integritymismatches, _integritymismatches(lv))
 #define _integritymismatches_set prop_not_implemented_set
+GET_LV_NUM_PROPERTY_FN(integrity_init_percent, _integrity_init_percent(lv))
+#define _integrity_init_percent_set prop_not_implemented_set
 GET_LV_STR_PROPERTY_FN(move_pv, lv_move_pv_dup(lv->vg->vgmem, lv))
 #define _move_pv_set prop_not_implemented_set
 GET_LV_STR_PROPERTY_FN(move_pv_uuid, lv_move_pv_uuid_dup(lv->vg->vgmem, lv))
@@ -3345,6 +3345,22 @@ static int _integritymismatches_disp(struct dm_report *rh __attribute__((unused)
 	return _field_set_value(field, "", &GET_TYPE_RESERVED_VALUE(num_undef_64));
 }
 
+static int _integrityinitpercent_disp(struct dm_report *rh,
+				     struct dm_pool *mem __attribute__((unused)),
+				     struct dm_report_field *field,
+				     const void *data,
+				     void *private __attribute__((unused)))
+{
+	const struct logical_volume *lv = (const struct logical_volume *) data;
+	dm_percent_t percent = DM_PERCENT_INVALID;
+
+	if ((lv_is_integrity(lv) || (lv_is_raid(lv) && lv_raid_has_integrity((struct logical_volume *) lv))) &&
+	    lv_is_active(lv) && !lv_integrity_init_percent(lv->vg->cmd, lv, &percent))
+		percent = DM_PERCENT_INVALID;
+
+	return dm_report_field_percent(rh, field, &percent);
+}
+
 static int _datapercent_disp(struct dm_report *rh, struct dm_pool *mem,
 			     struct dm_report_field *field,
 			     const void *data, void *private)
@@ -3376,6 +3392,62 @@ static int _metadatapercent_disp(struct dm_report *rh,
 	return dm_report_field_percent(rh, field, &percent);
 }
 
+static int _fill_rate_disp(struct dm_report *rh, struct dm_report_field *field,
+			   const void *data, int metadata)
+{
+	const struct lv_with_info_and_seg_status *lvdm = (const struct lv_with_info_and_seg_status *) data;
+	dm_percent_t rate = DM_PERCENT_INVALID;
+	uint64_t seconds;
+
+	if (lv_is_thin_pool(lvdm->lv) && (lvdm->seg_status.type == SEG_STATUS_THIN_POOL))
+		(void) thin_pool_history_forecast(lvdm->lv, metadata, &rate, &seconds);
+
+	return dm_report_field_percent(rh, field, &rate);
+}
+
+static int _time_to_full_disp(struct dm_report *rh, struct dm_report_field *field,
+			      const void *data, int metadata)
+{
+	const struct lv_with_info_and_seg_status *lvdm = (const struct lv_with_info_and_seg_status *) data;
+	dm_percent_t rate;
+	uint64_t seconds;
+
+	if (lv_is_thin_pool(lvdm->lv) && (lvdm->seg_status.type == SEG_STATUS_THIN_POOL) &&
+	    thin_pool_history_forecast(lvdm->lv, metadata, &rate, &seconds) &&
+	    (seconds != UINT64_MAX))
+		return dm_report_field_uint64(rh, field, &seconds);
+
+	return _field_set_value(field, "", &GET_TYPE_RESERVED_VALUE(num_undef_64));
+}
+
+static int _datafillrate_disp(struct dm_report *rh, struct dm_pool *mem,
+			      struct dm_report_field *field,
+			      const void *data, void *private)
+{
+	return _fill_rate_disp(rh, field, data, 0);
+}
+
+static int _metadatafillrate_disp(struct dm_report *rh, struct dm_pool *mem,
+				  struct dm_report_field *field,
+				  const void *data, void *private)
+{
+	return _fill_rate_disp(rh, field, data, 1);
+}
+
+static int _datatimetofull_disp(struct dm_report *rh, struct dm_pool *mem,
+				struct dm_report_field *field,
+				const void *data, void *private)
+{
+	return _time_to_full_disp(rh, field, data, 0);
+}
+
+static int _metadatatimetofull_disp(struct dm_report *rh, struct dm_pool *mem,
+				    struct dm_report_field *field,
+				    const void *data, void *private)
+{
+	return _time_to_full_disp(rh, field, data, 1);
+}
+
 static int _lvmetadatasize_disp(struct dm_report *rh, struct dm_pool *mem,
 				struct dm_report_field *field,
 				const void *data, void *private)
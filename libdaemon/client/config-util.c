@@ -19,10 +19,38 @@
 
 #include <math.h>  /* fabs() */
 #include <float.h> /* DBL_EPSILON */
+#include <ctype.h>
+
+/* Appends printf output straight into buf, growing it as needed. */
+__attribute__ ((format(printf, 2, 3)))
+static int _buffer_printf(struct buffer *buf, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	if (!buf->mem && !buffer_realloc(buf, 256))
+		return 0;
+
+	for (;;) {
+		va_start(ap, fmt);
+		len = vsnprintf(buf->mem + buf->used, buf->allocated - buf->used, fmt, ap);
+		va_end(ap);
+
+		if (len < 0)
+			return 0;
+
+		if (len < buf->allocated - buf->used) {
+			buf->used += len;
+			return 1;
+		}
+
+		if (!buffer_realloc(buf, len + 1))
+			return 0;
+	}
+}
 
 int buffer_append_vf(struct buffer *buf, va_list ap)
 {
-	char *append;
 	char *next;
 	int keylen;
 	int64_t value;
@@ -30,44 +58,35 @@ int buffer_append_vf(struct buffer *buf, va_list ap)
 	char *block;
 
 	while ((next = va_arg(ap, char *))) {
-		append = NULL;
 		if (!strchr(next, '=')) {
 			log_error(INTERNAL_ERROR "Bad format string at '%s'", next);
-			goto fail;
+			return 0;
 		}
 		keylen = strchr(next, '=') - next;
 		if (strstr(next, "%d")) {
                         /* Use of plain %d is prohibited, use  FMTd64 */
 			log_error(INTERNAL_ERROR "Do not use  %%d and use correct 64bit form");
-			goto fail;
+			return 0;
 		}
 		if (strstr(next, FMTd64)) {
 			value = va_arg(ap, int64_t);
-			if (dm_asprintf(&append, "%.*s= %" PRId64 "\n", keylen, next, value) < 0)
-				goto fail;
+			if (!_buffer_printf(buf, "%.*s= %" PRId64 "\n", keylen, next, value))
+				return 0;
 		} else if (strstr(next, "%s")) {
 			string = va_arg(ap, char *);
-			if (dm_asprintf(&append, "%.*s= \"%s\"\n", keylen, next, string) < 0)
-				goto fail;
+			if (!_buffer_printf(buf, "%.*s= \"%s\"\n", keylen, next, string))
+				return 0;
 		} else if (strstr(next, "%b")) {
 			if (!(block = va_arg(ap, char *)))
 				continue;
-			if (dm_asprintf(&append, "%.*s%s", keylen, next, block) < 0)
-				goto fail;
-		} else if (dm_asprintf(&append, "%s", next) < 0)
-			goto fail;
-
-		if (!append ||
-		    !buffer_append(buf, append))
-			goto fail;
-
-		free(append);
+			if (!buffer_append_n(buf, next, keylen) ||
+			    !buffer_append(buf, block))
+				return 0;
+		} else if (!buffer_append(buf, next))
+			return 0;
 	}
 
 	return 1;
-fail:
-	free(append);
-	return 0;
 }
 
 int buffer_append_f(struct buffer *buf, ...)
@@ -375,19 +394,60 @@ int buffer_realloc(struct buffer *buf, int needed)
 	return 1;
 }
 
-int buffer_append(struct buffer *buf, const char *string)
+int buffer_append_n(struct buffer *buf, const char *string, int len)
 {
-	int len = strlen(string);
-
 	if ((!buf->mem || (buf->allocated - buf->used <= len)) &&
 	    !buffer_realloc(buf, len + 1))
 		return 0;
 
-	strcpy(buf->mem + buf->used, string);
+	memcpy(buf->mem + buf->used, string, len);
 	buf->used += len;
+	buf->mem[buf->used] = '\0';
 	return 1;
 }
 
+int buffer_append(struct buffer *buf, const char *string)
+{
+	return buffer_append_n(buf, string, strlen(string));
+}
+
+/*
+ * Writers for key = value lines, for replies built without a config
+ * tree.  Strings are escaped as dm_config_write_node() does.
+ */
+int buffer_append_key_int(struct buffer *buf, const char *key, int64_t value)
+{
+	return _buffer_printf(buf, "%s = %" PRId64 "\n", key, value);
+}
+
+int buffer_append_key_str(struct buffer *buf, const char *key, const char *value)
+{
+	const char *p;
+
+	if (!_buffer_printf(buf, "%s = \"", key))
+		return 0;
+
+	while ((p = strpbrk(value, "\"\\"))) {
+		if (!buffer_append_n(buf, value, p - value) ||
+		    !buffer_append_n(buf, "\\", 1) ||
+		    !buffer_append_n(buf, p, 1))
+			return 0;
+		value = p + 1;
+	}
+
+	return buffer_append(buf, value) && buffer_append_n(buf, "\"\n", 2);
+}
+
+int buffer_append_section(struct buffer *buf, const char *key)
+{
+	return _buffer_printf(buf, "%s {\n", key);
+}
+
+int buffer_append_section_end(struct buffer *buf)
+{
+	return buffer_append_n(buf, "}\n", 2);
+}
+
 int buffer_line(const char *line, void *baton)
 {
 	struct buffer *buf = baton;
@@ -409,3 +469,131 @@ void buffer_init(struct buffer *buf)
 	buf->allocated = buf->used = 0;
 	buf->mem = 0;
 }
+
+void buffer_reset(struct buffer *buf)
+{
+	buf->used = 0;
+	if (buf->mem)
+		buf->mem[0] = '\0';
+}
+
+/*
+ * The reader below modifies the text in place, terminating each key
+ * and value where it ends and unescaping strings, so nothing is copied.
+ */
+void config_scan_init(struct config_scan *s, char *text, size_t len)
+{
+	s->pos = text;
+	s->end = text + len;
+	s->depth = 0;
+}
+
+static void _scan_skip_space(struct config_scan *s)
+{
+	while (s->pos < s->end) {
+		if (*s->pos == '#') {
+			while ((s->pos < s->end) && (*s->pos != '\n'))
+				s->pos++;
+		} else if (isspace((unsigned char) *s->pos))
+			s->pos++;
+		else
+			break;
+	}
+}
+
+/* Unescapes the quoted string at pos in place */
+static char *_scan_string(struct config_scan *s)
+{
+	char *start = ++s->pos, *out = start;
+
+	while (s->pos < s->end) {
+		if (*s->pos == '"') {
+			*out = '\0';
+			s->pos++;
+			return start;
+		}
+		if ((*s->pos == '\\') && (s->pos + 1 < s->end))
+			s->pos++;
+		*out++ = *s->pos++;
+	}
+
+	return NULL;
+}
+
+enum config_scan_item config_scan_next(struct config_scan *s,
+				       const char **key, const char **value)
+{
+	char *k, c;
+
+	*key = *value = NULL;
+
+	_scan_skip_space(s);
+
+	if ((s->pos >= s->end) || !*s->pos)
+		return CONFIG_SCAN_END;
+
+	if (*s->pos == '}') {
+		if (!s->depth)
+			return CONFIG_SCAN_ERROR;
+		s->pos++;
+		s->depth--;
+		return CONFIG_SCAN_SECTION_END;
+	}
+
+	k = s->pos;
+	while ((s->pos < s->end) && *s->pos && !isspace((unsigned char) *s->pos) &&
+	       (*s->pos != '=') && (*s->pos != '{'))
+		s->pos++;
+
+	if ((s->pos == k) || (s->pos >= s->end))
+		return CONFIG_SCAN_ERROR;
+
+	/* Terminating the key may overwrite '=' or '{' */
+	c = *s->pos;
+	*s->pos = '\0';
+	if (isspace((unsigned char) c)) {
+		s->pos++;
+		_scan_skip_space(s);
+		if (s->pos >= s->end)
+			return CONFIG_SCAN_ERROR;
+		c = *s->pos;
+	}
+	s->pos++;
+	*key = k;
+
+	if (c == '{') {
+		s->depth++;
+		return CONFIG_SCAN_SECTION;
+	}
+
+	if (c != '=')
+		return CONFIG_SCAN_ERROR;
+
+	_scan_skip_space(s);
+
+	if (s->pos >= s->end)
+		return CONFIG_SCAN_ERROR;
+
+	if (*s->pos == '"') {
+		if (!(*value = _scan_string(s)))
+			return CONFIG_SCAN_ERROR;
+		return CONFIG_SCAN_VALUE;
+	}
+
+	/* Numbers, and arrays which are returned unparsed */
+	*value = s->pos;
+	if (*s->pos == '[') {
+		while ((s->pos < s->end) && (*s->pos != ']'))
+			s->pos++;
+		if (s->pos < s->end)
+			s->pos++;
+	} else
+		while ((s->pos < s->end) && *s->pos && !isspace((unsigned char) *s->pos))
+			s->pos++;
+
+	/* At the end, the terminating NUL of the text ends it */
+	if (s->pos < s->end)
+		*s->pos++ = '\0';
+
+	return CONFIG_SCAN_VALUE;
+}
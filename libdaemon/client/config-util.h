@@ -24,10 +24,23 @@ struct buffer {
 int buffer_append_vf(struct buffer *buf, va_list ap);
 int buffer_append_f(struct buffer *buf, ...);
 int buffer_append(struct buffer *buf, const char *string);
+int buffer_append_n(struct buffer *buf, const char *string, int len);
 void buffer_init(struct buffer *buf);
 void buffer_destroy(struct buffer *buf);
 int buffer_realloc(struct buffer *buf, int needed);
 
+/* Empties buf, keeping its memory for reuse. */
+void buffer_reset(struct buffer *buf);
+
+/*
+ * Stream key = value lines and sections into buf, without building a
+ * config tree first.
+ */
+int buffer_append_key_int(struct buffer *buf, const char *key, int64_t value);
+int buffer_append_key_str(struct buffer *buf, const char *key, const char *value);
+int buffer_append_section(struct buffer *buf, const char *key);
+int buffer_append_section_end(struct buffer *buf);
+
 int buffer_line(const char *line, void *baton);
 
 int set_flag(struct dm_config_tree *cft, struct dm_config_node *parent,
@@ -68,4 +81,29 @@ struct dm_config_node *config_make_nodes(struct dm_config_tree *cft,
 
 struct dm_config_tree *config_tree_from_string_without_dup_node_check(const char *config_settings);
 
+/*
+ * Reads daemon messages in place, without building a config tree.  The
+ * text, which must be NUL terminated at text[len] as buffers are, is
+ * modified: keys and values are terminated where they end and strings
+ * are unescaped, so the returned pointers stay valid as long as the text
+ * does.  Values are returned as text, arrays unparsed.
+ */
+struct config_scan {
+	char *pos;
+	char *end;
+	int depth;	/* of the next item, sections increase it */
+};
+
+enum config_scan_item {
+	CONFIG_SCAN_END,
+	CONFIG_SCAN_ERROR,
+	CONFIG_SCAN_VALUE,		/* key = value */
+	CONFIG_SCAN_SECTION,		/* key { */
+	CONFIG_SCAN_SECTION_END		/* } */
+};
+
+void config_scan_init(struct config_scan *s, char *text, size_t len);
+enum config_scan_item config_scan_next(struct config_scan *s,
+				       const char **key, const char **value);
+
 #endif /* _LVM_DAEMON_CONFIG_UTIL_H */
@@ -48,7 +48,7 @@ daemon_handle daemon_open(daemon_info i)
 	}
 
 	log_debug("Sending daemon %s: hello", i.path);
-	r = daemon_send_simple(h, "hello", NULL);
+	r = daemon_send_simple(h, "hello", DAEMON_FRAMING_PARAM " = %s", DAEMON_FRAMING_LENGTH, NULL);
 	if (r.error || strcmp(daemon_reply_str(r, "response", "unknown"), "OK")) {
 		h.error = r.error;
 		log_error("Daemon %s returned error %d", i.path, r.error);
@@ -61,6 +61,9 @@ daemon_handle daemon_open(daemon_info i)
 		h.protocol = strdup(h.protocol); /* keep around */
 	h.protocol_version = daemon_reply_int(r, "version", 0);
 
+	/* Daemons not knowing about framing keep the terminated messages */
+	h.framed = !strcmp(daemon_reply_str(r, DAEMON_FRAMING_PARAM, ""), DAEMON_FRAMING_LENGTH);
+
 	if (i.protocol && (!h.protocol || strcmp(h.protocol, i.protocol))) {
 		log_error("Daemon %s: requested protocol %s != %s",
 			i.path, i.protocol, h.protocol ? : "");
@@ -89,7 +92,7 @@ error:
 	return h;
 }
 
-daemon_reply daemon_send(daemon_handle h, daemon_request rq)
+static daemon_reply _daemon_send(daemon_handle h, daemon_request rq, int parse)
 {
 	struct buffer buffer;
 	daemon_reply reply = { 0 };
@@ -114,12 +117,12 @@ daemon_reply daemon_send(daemon_handle h, daemon_request rq)
 		return reply;
 	}
 
-	if (!buffer_write(h.socket_fd, &buffer))
+	if (!buffer_write_framed(h.socket_fd, &buffer, h.framed))
 		reply.error = errno;
 
-	if (buffer_read(h.socket_fd, &reply.buffer)) {
-		reply.cft = config_tree_from_string_without_dup_node_check(reply.buffer.mem);
-		if (!reply.cft)
+	if (buffer_read_framed(h.socket_fd, &reply.buffer, h.framed)) {
+		if (parse &&
+		    !(reply.cft = config_tree_from_string_without_dup_node_check(reply.buffer.mem)))
 			reply.error = EPROTO;
 	} else
 		reply.error = errno;
@@ -130,6 +133,16 @@ daemon_reply daemon_send(daemon_handle h, daemon_request rq)
 	return reply;
 }
 
+daemon_reply daemon_send(daemon_handle h, daemon_request rq)
+{
+	return _daemon_send(h, rq, 1);
+}
+
+daemon_reply daemon_send_raw(daemon_handle h, daemon_request rq)
+{
+	return _daemon_send(h, rq, 0);
+}
+
 void daemon_reply_destroy(daemon_reply r)
 {
 	if (r.cft)
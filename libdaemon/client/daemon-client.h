@@ -22,6 +22,7 @@ typedef struct {
 	const char *protocol;
 	int protocol_version;  /* version of the protocol the daemon uses */
 	int error;
+	unsigned framed:1; /* daemon agreed to length framing in hello */
 } daemon_handle;
 
 typedef struct {
@@ -80,6 +81,13 @@ daemon_handle daemon_open(daemon_info i);
  */
 daemon_reply daemon_send(daemon_handle h, daemon_request rq);
 
+/*
+ * Like daemon_send, but the reply is not parsed: reply.cft stays NULL and
+ * the text in reply.buffer is left for the caller, e.g. to read large
+ * replies with config_scan_next() without building a config tree.
+ */
+daemon_reply daemon_send_raw(daemon_handle h, daemon_request rq);
+
 /*
  * A simple interface to daemon_send. This function just takes the command id
  * and possibly a list of parameters (of the form "name = %?", "value"). The
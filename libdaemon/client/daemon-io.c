@@ -29,7 +29,9 @@
 int buffer_read(int fd, struct buffer *buffer) {
 	int result;
 
-	if (!buffer_realloc(buffer, 32)) /* ensure we have some space */
+	/* ensure we have some space, a reused buffer may have plenty */
+	if ((!buffer->mem || (buffer->allocated - buffer->used < 32)) &&
+	    !buffer_realloc(buffer, 32))
 		return 0;
 
 	while (1) {
@@ -61,32 +63,108 @@ int buffer_read(int fd, struct buffer *buffer) {
 	return 1;
 }
 
+static int _write_all(int fd, const char *mem, int len)
+{
+	int written, result;
+
+	for (written = 0; written < len;) {
+		result = write(fd, mem + written, len - written);
+		if (result > 0)
+			written += result;
+		else if (result < 0 && (errno == EAGAIN ||
+					errno == EINTR || errno == EIO)) {
+			fd_set out;
+			FD_ZERO(&out);
+			FD_SET(fd, &out);
+			/* ignore the result, this is just a glorified sleep */
+			select(FD_SETSIZE, NULL, &out, NULL, NULL);
+		} else if (result < 0)
+			return 0; /* too bad */
+	}
+
+	return 1;
+}
+
 /*
  * Write a buffer to a filedescriptor. Keep trying. Blocks (even on
  * SOCK_NONBLOCK) until all of the write went through.
  */
 int buffer_write(int fd, const struct buffer *buffer) {
-	static const struct buffer _terminate = { .mem = (char *) "\n##\n", .used = 4 };
-	const struct buffer *use;
-	int done, written, result;
-
-	for (done = 0; done < 2; ++done) {
-		use = (done == 0) ? buffer : &_terminate;
-		for (written = 0; written < use->used;) {
-			result = write(fd, use->mem + written, use->used - written);
-			if (result > 0)
-				written += result;
-			else if (result < 0 && (errno == EAGAIN ||
-						errno == EINTR || errno == EIO)) {
-				fd_set out;
-				FD_ZERO(&out);
-				FD_SET(fd, &out);
-				/* ignore the result, this is just a glorified sleep */
-				select(FD_SETSIZE, NULL, &out, NULL, NULL);
-			} else if (result < 0)
-				return 0; /* too bad */
-		}
+	return _write_all(fd, buffer->mem, buffer->used) &&
+		_write_all(fd, "\n##\n", 4);
+}
+
+static int _read_all(int fd, char *mem, int len)
+{
+	int done, result;
+
+	for (done = 0; done < len;) {
+		result = read(fd, mem + done, len - done);
+		if (result > 0)
+			done += result;
+		else if (result == 0) {
+			errno = ECONNRESET;
+			return 0;
+		} else if (errno == EAGAIN || errno == EINTR || errno == EIO) {
+			fd_set in;
+			FD_ZERO(&in);
+			FD_SET(fd, &in);
+			/* ignore the result, this is just a glorified sleep */
+			select(FD_SETSIZE, &in, NULL, NULL, NULL);
+		} else
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * With length framing the message size is known up front, so the buffer
+ * is sized once and exactly the message is read.  Reused buffers keep
+ * their memory for the next message.
+ */
+int buffer_read_framed(int fd, struct buffer *buffer, int framed) {
+	unsigned char hdr[4];
+	uint32_t len;
+
+	if (!framed)
+		return buffer_read(fd, buffer);
+
+	if (!_read_all(fd, (char *) hdr, sizeof(hdr)))
+		return 0;
+
+	len = ((uint32_t) hdr[0] << 24) | ((uint32_t) hdr[1] << 16) |
+	      ((uint32_t) hdr[2] << 8) | hdr[3];
+
+	if (len > DAEMON_MAX_MESSAGE) {
+		errno = EPROTO;
+		return 0;
 	}
 
+	if ((!buffer->mem || (buffer->allocated - buffer->used <= (int) len)) &&
+	    !buffer_realloc(buffer, len + 1))
+		return 0;
+
+	if (!_read_all(fd, buffer->mem + buffer->used, len))
+		return 0;
+
+	buffer->used += len;
+	buffer->mem[buffer->used] = 0;
+
 	return 1;
 }
+
+int buffer_write_framed(int fd, const struct buffer *buffer, int framed) {
+	unsigned char hdr[4];
+
+	if (!framed)
+		return buffer_write(fd, buffer);
+
+	hdr[0] = buffer->used >> 24;
+	hdr[1] = buffer->used >> 16;
+	hdr[2] = buffer->used >> 8;
+	hdr[3] = buffer->used;
+
+	return _write_all(fd, (const char *) hdr, sizeof(hdr)) &&
+		_write_all(fd, buffer->mem, buffer->used);
+}
@@ -22,4 +22,16 @@
 int buffer_read(int fd, struct buffer *buffer);
 int buffer_write(int fd, const struct buffer *buffer);
 
+/*
+ * Framing negotiated in the hello exchange.  Once the daemon agrees to
+ * DAEMON_FRAMING_LENGTH, every further message on the connection is sent
+ * after a 4 byte big-endian length instead of ending with "\n##\n".
+ */
+#define DAEMON_FRAMING_PARAM	"framing"
+#define DAEMON_FRAMING_LENGTH	"length"
+#define DAEMON_MAX_MESSAGE	(256 * 1024 * 1024)
+
+int buffer_read_framed(int fd, struct buffer *buffer, int framed);
+int buffer_write_framed(int fd, const struct buffer *buffer, int framed);
+
 #endif /* _LVM_DAEMON_IO_H */
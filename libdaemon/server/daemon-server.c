@@ -19,6 +19,7 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <pthread.h>
+#include <sys/epoll.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -48,6 +49,30 @@ static int _pthread_create(pthread_t *t, void *(*fun)(void *), void *arg, int st
 static volatile sig_atomic_t _shutdown_requested = 0;
 static int _systemd_activation = 0;
 
+/*
+ * Connections are watched by one epoll loop in daemon_start().  A client
+ * with a request pending is queued for a bounded pool of worker threads,
+ * which is grown on demand, and handed back to the loop with its reply.
+ */
+#define DAEMON_MAX_WORKERS 64
+#define DAEMON_MAX_EVENTS 64
+
+static int _epoll_fd = -1;
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	thread_state *head, *tail;	/* clients with a request to serve */
+	unsigned queued;
+	unsigned waiting;		/* workers waiting for a client */
+	unsigned count;
+	int stop;
+	pthread_t workers[DAEMON_MAX_WORKERS];
+} _pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
 static void _exit_handler(int sig __attribute__((unused)))
 {
 	_shutdown_requested = 1;
@@ -90,6 +115,13 @@ static struct timespec *_get_timeout(daemon_state s)
 	return s.idle ? s.idle->ptimeout : NULL;
 }
 
+static int _get_timeout_ms(daemon_state s)
+{
+	struct timespec *t = _get_timeout(s);
+
+	return t ? (int) (t->tv_sec * 1000 + t->tv_nsec / 1000000) : -1;
+}
+
 static void _reset_timeout(daemon_state s)
 {
 	if (s.idle) {
@@ -432,74 +464,172 @@ end:
 	return res;
 }
 
-static response _builtin_handler(daemon_state s, client_handle h, request r)
+static response _builtin_handler(thread_state *ts, request r)
 {
 	const char *rq = daemon_request_str(r, "request", "NONE");
 	response res = { .error = EPROTO };
 
 	if (!strcmp(rq, "hello")) {
-		return daemon_reply_simple("OK", "protocol = %s", s.protocol ?: "default",
-					   "version = %" PRId64, (int64_t) s.protocol_version, NULL);
+		/* Takes effect with the next request, hello is answered as it came */
+		if (strcmp(daemon_request_str(r, DAEMON_FRAMING_PARAM, ""), DAEMON_FRAMING_LENGTH))
+			return daemon_reply_simple("OK", "protocol = %s", ts->s.protocol ?: "default",
+						   "version = %" PRId64, (int64_t) ts->s.protocol_version, NULL);
+		ts->framed = 1;
+		return daemon_reply_simple("OK", "protocol = %s", ts->s.protocol ?: "default",
+					   "version = %" PRId64, (int64_t) ts->s.protocol_version,
+					   DAEMON_FRAMING_PARAM " = %s", DAEMON_FRAMING_LENGTH, NULL);
 	}
 
 	buffer_init(&res.buffer);
 	return res;
 }
 
-static void *_client_thread(void *state)
+/* Serve one request from a client the epoll loop found readable. */
+static void _serve_request(thread_state *ts)
 {
-	thread_state *ts = state;
+	struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = ts };
 	request req;
 	response res;
+	int framed = ts->framed;
 
-	buffer_init(&req.buffer);
+	ts->req.used = 0;
+	if (!buffer_read_framed(ts->client.socket_fd, &ts->req, framed))
+		goto fail;
 
-	while (1) {
-		if (!buffer_read(ts->client.socket_fd, &req.buffer))
-			goto fail;
+	req.buffer = ts->req;
+	req.cft = config_tree_from_string_without_dup_node_check(req.buffer.mem);
 
-		req.cft = config_tree_from_string_without_dup_node_check(req.buffer.mem);
+	if (!req.cft)
+		fprintf(stderr, "error parsing request:\n %s\n", req.buffer.mem);
+	else
+		daemon_log_cft(ts->s.log, DAEMON_LOG_WIRE, "<- ", req.cft->root);
 
-		if (!req.cft)
-			fprintf(stderr, "error parsing request:\n %s\n", req.buffer.mem);
-		else
-			daemon_log_cft(ts->s.log, DAEMON_LOG_WIRE, "<- ", req.cft->root);
+	ts->client.thread_id = pthread_self();
+	res = _builtin_handler(ts, req);
 
-		res = _builtin_handler(ts->s, ts->client, req);
+	if (res.error == EPROTO) /* Not a builtin, delegate to the custom handler. */
+		res = ts->s.handler(ts->s, ts->client, req);
 
-		if (res.error == EPROTO) /* Not a builtin, delegate to the custom handler. */
-			res = ts->s.handler(ts->s, ts->client, req);
+	if (!res.buffer.mem) {
+		if (!dm_config_write_node(res.cft->root, buffer_line, &res.buffer))
+			goto fail;
+		if (!buffer_append(&res.buffer, "\n\n"))
+			goto fail;
+		dm_config_destroy(res.cft);
+	}
 
-		if (!res.buffer.mem) {
-			if (!dm_config_write_node(res.cft->root, buffer_line, &res.buffer))
-				goto fail;
-			if (!buffer_append(&res.buffer, "\n\n"))
-				goto fail;
-			dm_config_destroy(res.cft);
-		}
+	if (req.cft)
+		dm_config_destroy(req.cft);
 
-		if (req.cft)
-			dm_config_destroy(req.cft);
-		buffer_destroy(&req.buffer);
+	daemon_log_multi(ts->s.log, DAEMON_LOG_WIRE, "-> ", res.buffer.mem);
+	buffer_write_framed(ts->client.socket_fd, &res.buffer, framed);
 
-		daemon_log_multi(ts->s.log, DAEMON_LOG_WIRE, "-> ", res.buffer.mem);
-		buffer_write(ts->client.socket_fd, &res.buffer);
+	buffer_destroy(&res.buffer);
 
-		buffer_destroy(&res.buffer);
-	}
+	/* ts belongs to the epoll loop again once re-armed */
+	if (!epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, ts->client.socket_fd, &ev))
+		return;
+
+	perror("epoll_ctl");
 fail:
 	/* TODO what should we really do here? */
 	if (close(ts->client.socket_fd))
 		perror("close");
-	buffer_destroy(&req.buffer);
+	buffer_destroy(&ts->req);
 	ts->active = 0;
+}
+
+static void *_worker_thread(void *arg)
+{
+	thread_state *ts;
+
+	pthread_mutex_lock(&_pool.lock);
+
+	while (1) {
+		while (!_pool.head && !_pool.stop) {
+			_pool.waiting++;
+			pthread_cond_wait(&_pool.cond, &_pool.lock);
+			_pool.waiting--;
+		}
+
+		if (!(ts = _pool.head))
+			break;
+
+		if (!(_pool.head = ts->next_ready))
+			_pool.tail = NULL;
+		_pool.queued--;
+
+		pthread_mutex_unlock(&_pool.lock);
+		_serve_request(ts);
+		pthread_mutex_lock(&_pool.lock);
+	}
+
+	pthread_mutex_unlock(&_pool.lock);
+
 	return NULL;
 }
 
+/* Call with _pool.lock held */
+static void _start_worker(daemon_state s)
+{
+	pthread_attr_t attr;
+
+	if (pthread_attr_init(&attr)) {
+		ERROR(&s, "Failed to initialise worker thread attributes.");
+		return;
+	}
+
+	if (s.thread_stack_size &&
+	    pthread_attr_setstacksize(&attr, s.thread_stack_size + getpagesize()))
+		WARN(&s, "Failed to set worker thread stack size.");
+
+	if ((errno = pthread_create(&_pool.workers[_pool.count], &attr, _worker_thread, NULL)))
+		ERROR(&s, "Failed to create worker thread: %s.", strerror(errno));
+	else
+		_pool.count++;
+
+	if (pthread_attr_destroy(&attr))
+		WARN(&s, "Failed to destroy worker thread attributes.");
+}
+
+static void _queue_client(daemon_state s, thread_state *ts)
+{
+	pthread_mutex_lock(&_pool.lock);
+
+	ts->next_ready = NULL;
+	if (_pool.tail)
+		_pool.tail->next_ready = ts;
+	else
+		_pool.head = ts;
+	_pool.tail = ts;
+
+	/* Grow the pool only when every worker is busy */
+	if ((++_pool.queued > _pool.waiting) && (_pool.count < DAEMON_MAX_WORKERS))
+		_start_worker(s);
+
+	pthread_cond_signal(&_pool.cond);
+	pthread_mutex_unlock(&_pool.lock);
+}
+
+static void _stop_workers(void)
+{
+	unsigned i;
+
+	pthread_mutex_lock(&_pool.lock);
+	_pool.stop = 1;
+	pthread_cond_broadcast(&_pool.cond);
+	pthread_mutex_unlock(&_pool.lock);
+
+	for (i = 0; i < _pool.count; i++)
+		if ((errno = pthread_join(_pool.workers[i], NULL)))
+			perror("pthread_join");
+}
+
 static int _handle_connect(daemon_state s)
 {
 	thread_state *ts;
 	struct sockaddr_un sockaddr;
+	struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT };
 	client_handle client = { .thread_id = 0 };
 	socklen_t sl = sizeof(sockaddr);
 
@@ -527,11 +657,14 @@ static int _handle_connect(daemon_state s)
 	s.threads->next = ts;
 
 	ts->active = 1;
+	ts->framed = 0;
 	ts->s = s;
 	ts->client = client;
+	buffer_init(&ts->req);
 
-	if ((errno = pthread_create(&ts->client.thread_id, NULL, _client_thread, ts))) {
-		ERROR(&s, "Failed to create client thread: %s.", strerror(errno));
+	ev.data.ptr = ts;
+	if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, client.socket_fd, &ev)) {
+		ERROR(&s, "Failed to watch client connection: %s.", strerror(errno));
 		ts->active = 0;
 		goto bad;
 	}
@@ -544,16 +677,21 @@ bad:
 	return 0;
 }
 
+/*
+ * Free clients whose connection got closed.  With waiting set, the workers
+ * are gone already and any connection still open gets closed as well.
+ */
 static void _reap(daemon_state s, int waiting)
 {
 	thread_state *last = s.threads, *ts = last->next;
-	void *rv;
 
 	while (ts) {
 		if (waiting || !ts->active) {
-			if (ts->client.thread_id &&
-			    (errno = pthread_join(ts->client.thread_id, &rv)))
-				ERROR(&s, "pthread_join failed: %s", strerror(errno));
+			if (ts->active) {
+				if (close(ts->client.socket_fd))
+					perror("close");
+				buffer_destroy(&ts->req);
+			}
 			last->next = ts->next;
 			free(ts);
 		} else
@@ -568,9 +706,9 @@ void daemon_start(daemon_state s)
 	log_state _log = { { 0 } };
 	thread_state _threads = { .next = NULL };
 	unsigned timeout_count = 0;
-	fd_set in;
+	struct epoll_event ev = { .events = EPOLLIN }, events[DAEMON_MAX_EVENTS];
 	sigset_t new_set, old_set;
-	int ret;
+	int i, ret;
 
 	/*
 	 * Switch to C locale to avoid reading large locale-archive file used by
@@ -652,8 +790,14 @@ void daemon_start(daemon_state s)
 		if (!s.daemon_init(&s))
 			failed = 1;
 
-	if (s.socket_fd >= FD_SETSIZE)
-		failed = 1; /* FD out of available selectable set */
+	if (!failed) {
+		/* The listening socket is the only event with no client attached */
+		if ((_epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+		    epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, s.socket_fd, &ev)) {
+			ERROR(&s, "Failed to set up epoll: %s.", strerror(errno));
+			failed = 1;
+		}
+	}
 
 	sigfillset(&new_set);
 	if (sigprocmask(SIG_SETMASK, NULL, &old_set))
@@ -661,8 +805,6 @@ void daemon_start(daemon_state s)
 
 	while (!failed) {
 		_reset_timeout(s);
-		FD_ZERO(&in);
-		FD_SET(s.socket_fd, &in);
 
 		if (sigprocmask(SIG_SETMASK, &new_set, NULL))
 			perror("sigprocmask error");
@@ -672,20 +814,23 @@ void daemon_start(daemon_state s)
 			INFO(&s, "%s shutdown requested", s.name);
 			break;
 		}
-		ret = pselect(s.socket_fd + 1, &in, NULL, NULL, _get_timeout(s), &old_set);
+		ret = epoll_pwait(_epoll_fd, events, DAEMON_MAX_EVENTS, _get_timeout_ms(s), &old_set);
 		if (sigprocmask(SIG_SETMASK, &old_set, NULL))
 			perror("sigprocmask error");
 
 		if (ret < 0) {
 			if ((errno != EINTR) && (errno != EAGAIN))
-				perror("select error");
+				perror("epoll_wait error");
 			continue;
 		}
 
-		if (FD_ISSET(s.socket_fd, &in)) {
-			timeout_count = 0;
-			_handle_connect(s);
-		}
+		for (i = 0; i < ret; i++)
+			if (!events[i].data.ptr) {
+				timeout_count = 0;
+				_handle_connect(s);
+			} else
+				_queue_client(s, events[i].data.ptr);
+
 		_reap(s, 0);
 
 		/* s.idle == NULL equals no shutdown on timeout */
@@ -699,7 +844,11 @@ void daemon_start(daemon_state s)
 	}
 
 	INFO(&s, "%s waiting for client threads to finish", s.name);
+	_stop_workers();
 	_reap(s, 1);
+
+	if ((_epoll_fd >= 0) && close(_epoll_fd))
+		perror("epoll close");
 out:
 	/* If activated by systemd, do not unlink the socket - systemd takes care of that! */
 	if (!_systemd_activation && s.socket_fd >= 0)
@@ -126,6 +126,9 @@ typedef struct thread_state {
 	client_handle client;
 	struct thread_state *next;
 	volatile int active;
+	struct buffer req; /* request buffer kept for the connection */
+	unsigned framed:1; /* length framing agreed in hello */
+	struct thread_state *next_ready; /* queued for the worker pool */
 } thread_state;
 
 /*
@@ -20,42 +20,73 @@ struct dm_hash_node {
 	void *data;
 	unsigned data_len;
 	unsigned keylen;
+	unsigned hash;		/* Full hash, kept for resizing */
 	char key[];
 };
 
+/*
+ * Tables start from the size hint and double whenever the average
+ * chain would exceed this many nodes.
+ */
+#define HASH_MAX_LOAD		2
+#define HASH_MAX_SLOTS		(1U << 30)
+
 struct dm_hash_table {
 	unsigned num_nodes;
 	unsigned num_slots;
 	struct dm_hash_node **slots;
 };
 
-/* Permutation of the Integers 0 through 255 */
-static unsigned char _nums[] = {
-	1, 14, 110, 25, 97, 174, 132, 119, 138, 170, 125, 118, 27, 233, 140, 51,
-	87, 197, 177, 107, 234, 169, 56, 68, 30, 7, 173, 73, 188, 40, 36, 65,
-	49, 213, 104, 190, 57, 211, 148, 223, 48, 115, 15, 2, 67, 186, 210, 28,
-	12, 181, 103, 70, 22, 58, 75, 78, 183, 167, 238, 157, 124, 147, 172,
-	144,
-	176, 161, 141, 86, 60, 66, 128, 83, 156, 241, 79, 46, 168, 198, 41, 254,
-	178, 85, 253, 237, 250, 154, 133, 88, 35, 206, 95, 116, 252, 192, 54,
-	221,
-	102, 218, 255, 240, 82, 106, 158, 201, 61, 3, 89, 9, 42, 155, 159, 93,
-	166, 80, 50, 34, 175, 195, 100, 99, 26, 150, 16, 145, 4, 33, 8, 189,
-	121, 64, 77, 72, 208, 245, 130, 122, 143, 55, 105, 134, 29, 164, 185,
-	194,
-	193, 239, 101, 242, 5, 171, 126, 11, 74, 59, 137, 228, 108, 191, 232,
-	139,
-	6, 24, 81, 20, 127, 17, 91, 92, 251, 151, 225, 207, 21, 98, 113, 112,
-	84, 226, 18, 214, 199, 187, 13, 32, 94, 220, 224, 212, 247, 204, 196,
-	43,
-	249, 236, 45, 244, 111, 182, 153, 136, 129, 90, 217, 202, 19, 165, 231,
-	71,
-	230, 142, 96, 227, 62, 179, 246, 114, 162, 53, 160, 215, 205, 180, 47,
-	109,
-	44, 38, 31, 149, 135, 0, 216, 52, 63, 23, 37, 69, 39, 117, 146, 184,
-	163, 200, 222, 235, 248, 243, 219, 10, 152, 131, 123, 229, 203, 76, 120,
-	209
-};
+/*
+ * Keys are mostly 32 byte UUIDs and PVIDs and device paths, so they are
+ * hashed 8 bytes at a time with xxh64-style multiply and rotate rounds
+ * and a final avalanche, which spreads them over all slots of any size.
+ */
+#define HASH_PRIME1	0x9E3779B185EBCA87ULL
+#define HASH_PRIME2	0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME3	0x165667B19E3779F9ULL
+#define HASH_PRIME4	0x85EBCA77C2B2AE63ULL
+
+static inline uint64_t _rotl64(uint64_t x, unsigned r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t _round(uint64_t h, uint64_t k)
+{
+	k *= HASH_PRIME2;
+	k = _rotl64(k, 31);
+	k *= HASH_PRIME1;
+	h ^= k;
+
+	return _rotl64(h, 27) * HASH_PRIME1 + HASH_PRIME4;
+}
+
+static unsigned _hash(const void *key, unsigned len)
+{
+	const unsigned char *str = key;
+	uint64_t h = HASH_PRIME3 + len;
+	uint64_t k;
+
+	for (; len >= 8; len -= 8, str += 8) {
+		memcpy(&k, str, 8);
+		h = _round(h, k);
+	}
+
+	if (len) {
+		k = 0;
+		memcpy(&k, str, len);
+		h = _round(h, k);
+	}
+
+	h ^= h >> 33;
+	h *= HASH_PRIME2;
+	h ^= h >> 29;
+	h *= HASH_PRIME3;
+	h ^= h >> 32;
+
+	return (unsigned) h;
+}
 
 static struct dm_hash_node *_create_node(const void *key, unsigned len)
 {
@@ -64,28 +95,56 @@ static struct dm_hash_node *_create_node(const void *key, unsigned len)
 	if (n) {
 		memcpy(n->key, key, len);
 		n->keylen = len;
+		n->hash = _hash(key, len);
 	}
 
 	return n;
 }
 
-static unsigned long _hash(const void *key, unsigned len)
+/*
+ * Move all nodes into twice as many slots.  Nodes are appended in the
+ * order they are found, so entries sharing a key keep their order.
+ * Failing to grow only leaves longer chains behind.
+ */
+static void _grow(struct dm_hash_table *t)
 {
-	const unsigned char *str = key;
-	unsigned long h = 0, g;
-	unsigned i;
+	unsigned new_slots = t->num_slots << 1;
+	struct dm_hash_node **slots, **tails, *c, *n;
+	unsigned i, h;
 
-	for (i = 0; i < len; i++) {
-		h <<= 4;
-		h += _nums[*str++];
-		g = h & ((unsigned long) 0xf << 16u);
-		if (g) {
-			h ^= g >> 16u;
-			h ^= g >> 5u;
-		}
+	if (t->num_slots >= HASH_MAX_SLOTS)
+		return;
+
+	if (!(slots = dm_zalloc(sizeof(*slots) * new_slots)))
+		return;
+
+	if (!(tails = dm_zalloc(sizeof(*tails) * new_slots))) {
+		dm_free(slots);
+		return;
 	}
 
-	return h;
+	for (i = 0; i < t->num_slots; i++)
+		for (c = t->slots[i]; c; c = n) {
+			n = c->next;
+			c->next = NULL;
+			h = c->hash & (new_slots - 1);
+			if (tails[h])
+				tails[h]->next = c;
+			else
+				slots[h] = c;
+			tails[h] = c;
+		}
+
+	dm_free(tails);
+	dm_free(t->slots);
+	t->slots = slots;
+	t->num_slots = new_slots;
+}
+
+static void _node_added(struct dm_hash_table *t)
+{
+	if (++t->num_nodes > t->num_slots * HASH_MAX_LOAD)
+		_grow(t);
 }
 
 struct dm_hash_table *dm_hash_create(unsigned size_hint)
@@ -174,7 +233,7 @@ int dm_hash_insert_binary(struct dm_hash_table *t, const void *key,
 		n->data = data;
 		n->next = 0;
 		*c = n;
-		t->num_nodes++;
+		_node_added(t);
 	}
 
 	return 1;
@@ -256,7 +315,7 @@ int dm_hash_insert_allow_multiple(struct dm_hash_table *t, const char *key,
 		n->next = 0;
 	t->slots[h] = n;
 
-	t->num_nodes++;
+	_node_added(t);
 	return 1;
 }
 
@@ -387,7 +446,7 @@ struct dm_hash_node *dm_hash_get_first(struct dm_hash_table *t)
 
 struct dm_hash_node *dm_hash_get_next(struct dm_hash_table *t, struct dm_hash_node *n)
 {
-	unsigned h = _hash(n->key, n->keylen) & (t->num_slots - 1);
+	unsigned h = n->hash & (t->num_slots - 1);
 
 	return n->next ? n->next : _next_slot(t, h + 1);
 }
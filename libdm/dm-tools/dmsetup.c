@@ -37,6 +37,9 @@
 #  include <sys/types.h>
 #  include <sys/ipc.h>
 #  include <sys/sem.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <linux/futex.h>
 #  include <libudev.h>
 #endif
 
@@ -856,7 +859,12 @@ out:
 	return r;
 }
 
-static int _display_info_cols(struct dm_task *dmt, struct dm_info *info)
+/*
+ * has_deps is set when dmt is a DM_DEVICE_DEPS task, which is then
+ * used for the deps fields instead of issuing another ioctl.
+ */
+static int _display_info_cols(struct dm_task *dmt, struct dm_info *info,
+			      int has_deps)
 {
 	struct dmsetup_report_obj obj;
 	uint64_t walk_flags = _statstype;
@@ -876,7 +884,9 @@ static int _display_info_cols(struct dm_task *dmt, struct dm_info *info)
 			goto out;
 		}
 
-	if (_report_type & DR_DEPS)
+	if ((_report_type & DR_DEPS) && has_deps)
+		obj.deps_task = dmt;
+	else if (_report_type & DR_DEPS)
 		if (!(obj.deps_task = _get_deps_task(info->major, info->minor))) {
 			log_error("Cannot get deps for %d:%d.", info->major, info->minor);
 			goto out;
@@ -959,7 +969,7 @@ static int _display_info_cols(struct dm_task *dmt, struct dm_info *info)
 	r = 1;
 
 out:
-	if (obj.deps_task)
+	if (obj.deps_task && (obj.deps_task != dmt))
 		dm_task_destroy(obj.deps_task);
 	if (obj.split_name)
 		_destroy_split_name(obj.split_name);
@@ -1007,7 +1017,7 @@ static void _display_info_long(struct dm_task *dmt, struct dm_info *info)
 	putchar('\n');
 }
 
-static int _display_info(struct dm_task *dmt)
+static int _display_info_task(struct dm_task *dmt, int has_deps)
 {
 	struct dm_info info;
 	int r = 1;
@@ -1023,11 +1033,16 @@ static int _display_info(struct dm_task *dmt)
 	if (!_switches[COLS_ARG])
 		_display_info_long(dmt, &info);
 	else
-		r = _display_info_cols(dmt, &info);
+		r = _display_info_cols(dmt, &info, has_deps);
 
 	return r;
 }
 
+static int _display_info(struct dm_task *dmt)
+{
+	return _display_info_task(dmt, 0);
+}
+
 static int _set_task_device(struct dm_task *dmt, const char *name, int optional)
 {
 	if (name) {
@@ -1862,6 +1877,71 @@ static char _yes_no_prompt(const char *prompt, ...)
 	return ret;
 }
 
+/*
+ * Cookies backed by a counter in a /dev/shm file (see libdm-common.c)
+ * are completed by zeroing the counter and waking any waiter.
+ */
+static int _udevcomplete_all_files(unsigned age, int *skipped)
+{
+	static const char _prefix[] = "dm_cookie_";
+	char path[PATH_MAX];
+	struct dirent *dirent;
+	struct stat st;
+	void *counter;
+	DIR *d;
+	int fd, count = 0;
+
+	if (!(d = opendir("/dev/shm")))
+		return 0;
+
+	while ((dirent = readdir(d))) {
+		if (strncmp(dirent->d_name, _prefix, sizeof(_prefix) - 1))
+			continue;
+
+		if (dm_snprintf(path, sizeof(path), "/dev/shm/%s", dirent->d_name) < 0)
+			continue;
+
+		if ((fd = open(path, O_RDWR)) < 0)
+			continue;
+
+		if (fstat(fd, &st) || (st.st_mtime + age * 60 > time(NULL))) {
+			(*skipped)++;
+			if (close(fd))
+				log_sys_debug("close", path);
+			continue;
+		}
+
+		counter = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+		if (close(fd))
+			log_sys_debug("close", path);
+
+		if (counter == MAP_FAILED) {
+			log_sys_error("mmap", path);
+			continue;
+		}
+
+		__atomic_store_n((int *) counter, 0, __ATOMIC_SEQ_CST);
+		if (syscall(SYS_futex, counter, FUTEX_WAKE, INT_MAX, NULL, NULL, 0) < 0)
+			log_sys_debug("futex", path);
+
+		if (munmap(counter, sizeof(int)))
+			log_sys_debug("munmap", path);
+
+		if (unlink(path) && (errno != ENOENT)) {
+			log_sys_error("unlink", path);
+			continue;
+		}
+
+		count++;
+	}
+
+	if (closedir(d))
+		log_sys_debug("closedir", "/dev/shm");
+
+	return count;
+}
+
 static int _udevcomplete_all(CMD_ARGS)
 {
 	int max_id, id, sid;
@@ -1920,6 +2000,8 @@ static int _udevcomplete_all(CMD_ARGS)
 		}
 	}
 
+	counter += _udevcomplete_all_files(age, &skipped);
+
 	log_print("%d semaphores with keys prefixed by "
 		  FMTu16 " (0x" FMTx16 ") destroyed. %d skipped.",
 		  counter, DM_COOKIE_MAGIC, DM_COOKIE_MAGIC, skipped);
@@ -2621,6 +2703,7 @@ out:
 static int _info(CMD_ARGS)
 {
 	int r = 0;
+	int has_deps = _switches[COLS_ARG] && (_report_type & DR_DEPS);
 
 	struct dm_task *dmt;
 	char *name = NULL;
@@ -2633,7 +2716,8 @@ static int _info(CMD_ARGS)
 		name = argv[0];
 	}
 
-	if (!(dmt = dm_task_create(DM_DEVICE_INFO)))
+	/* DEPS returns the same info, so fetch deps columns with it */
+	if (!(dmt = dm_task_create(has_deps ? DM_DEVICE_DEPS : DM_DEVICE_INFO)))
 		return_0;
 
 	if (!_set_task_device(dmt, name, 0))
@@ -2651,7 +2735,7 @@ static int _info(CMD_ARGS)
 	if (!_task_run(dmt))
 		goto_out;
 
-	r = _display_info(dmt);
+	r = _display_info_task(dmt, has_deps);
 
 out:
 	dm_task_destroy(dmt);
@@ -2708,7 +2792,7 @@ static int _deps(CMD_ARGS)
 	}
 
 	if (_switches[VERBOSE_ARG])
-		_display_info(dmt);
+		_display_info_task(dmt, 1);
 
 	if (multiple_devices && !_switches[VERBOSE_ARG])
 		printf("%s: ", name);
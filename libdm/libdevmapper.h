@@ -139,6 +139,13 @@ struct dm_timestamp;
 struct dm_task *dm_task_create(int type);
 void dm_task_destroy(struct dm_task *dmt);
 
+/*
+ * Clears dmt for reuse as a new task of the given type, as if it had
+ * just been created.  Saves the allocations when the same ioctl is run
+ * repeatedly, e.g. to poll status.
+ */
+int dm_task_reset(struct dm_task *dmt, int type);
+
 int dm_task_set_name(struct dm_task *dmt, const char *name);
 int dm_task_set_uuid(struct dm_task *dmt, const char *uuid);
 
@@ -604,6 +611,33 @@ int dm_stats_list(struct dm_stats *dms, const char *program_id);
 int dm_stats_populate(struct dm_stats *dms, const char *program_id,
 		      uint64_t region_id);
 
+/*
+ * Take a new sample of the counters of every region already populated
+ * in dms without re-listing the regions: the region table, groups and
+ * histogram data are left as they are and only the counter values of
+ * each area are replaced.  Like dm_stats_populate() the kernel counters
+ * are cleared, so each sample holds the deltas since the last one.
+ *
+ * Intended for continuous monitoring: call dm_stats_populate() once,
+ * then dm_stats_sample() at each interval.  Returns 0 if a region was
+ * removed or resized, in which case the handle should be populated
+ * again.
+ */
+int dm_stats_sample(struct dm_stats *dms);
+
+/*
+ * Keep the last nr_samples samples taken by dm_stats_sample() for each
+ * region in a fixed size ring.  Setting a new depth discards any
+ * history already kept.  A depth of zero (the default) keeps none.
+ */
+int dm_stats_set_sample_history(struct dm_stats *dms, unsigned nr_samples);
+
+/*
+ * Number of samples currently held in the history of region_id.
+ */
+unsigned dm_stats_get_nr_samples(const struct dm_stats *dms,
+				 uint64_t region_id);
+
 /*
  * Create a new statistics region on the device bound to dms.
  *
@@ -2241,6 +2275,9 @@ int dm_bit_get_first(dm_bitset_t bs);
 int dm_bit_get_next(dm_bitset_t bs, int last_bit);
 int dm_bit_get_last(dm_bitset_t bs);
 int dm_bit_get_prev(dm_bitset_t bs, int last_bit);
+int dm_bit_get_next_zero(dm_bitset_t bs, int last_bit);
+/* Returns number of set bits below the size of the set */
+unsigned dm_bit_count(dm_bitset_t bs);
 
 #define DM_BITS_PER_INT ((unsigned)sizeof(int) * CHAR_BIT)
 
@@ -2577,6 +2614,28 @@ struct dm_list *dm_list_next(const struct dm_list *head, const struct dm_list *e
  */
 unsigned int dm_list_size(const struct dm_list *head);
 
+/*
+ * Device of a DM_DEVICE_LIST task as returned by dm_task_get_device_list().
+ */
+struct dm_active_device {
+	struct dm_list list;
+	uint64_t dev;
+	const char *name;
+	uint32_t event_nr;	/* valid with DM_DEVICE_LIST_HAS_EVENT_NR */
+	const char *uuid;	/* valid with DM_DEVICE_LIST_HAS_UUID, NULL if none */
+};
+
+#define DM_DEVICE_LIST_HAS_EVENT_NR	0x00000001
+#define DM_DEVICE_LIST_HAS_UUID		0x00000002
+
+/*
+ * Copy devices of a DM_DEVICE_LIST task into the devs list allocated
+ * from mem.  devs_features tells which optional fields the kernel
+ * provided, so a single ioctl can replace per-device queries.
+ */
+int dm_task_get_device_list(struct dm_task *dmt, struct dm_pool *mem,
+			    struct dm_list *devs, unsigned *devs_features);
+
 /*********
  * selinux
  *********/
@@ -3229,6 +3288,17 @@ uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 			      dm_stats_counter_t counter,
 			      uint64_t region_id, uint64_t area_id);
 
+/*
+ * Read a counter from the sample history kept by dm_stats_sample().
+ * An age of 0 is the latest sample.  Passing DM_STATS_WALK_REGION as
+ * area_id sums all areas of the region.  Group aggregation is not
+ * supported.  Returns 0 if no sample of that age is held.
+ */
+uint64_t dm_stats_get_sample_counter(const struct dm_stats *dms,
+				     dm_stats_counter_t counter,
+				     uint64_t region_id, uint64_t area_id,
+				     unsigned age);
+
 uint64_t dm_stats_get_reads(const struct dm_stats *dms,
 			    uint64_t region_id, uint64_t area_id);
 
@@ -29,6 +29,9 @@
 #  include <sys/types.h>
 #  include <sys/ipc.h>
 #  include <sys/sem.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <linux/futex.h>
 #  include <libudev.h>
 #endif
 
@@ -79,6 +82,7 @@ static int _udev_disabled = 0;
 
 #ifdef UDEV_SYNC_SUPPORT
 static int _semaphore_supported = -1;
+static int _futex_cookies = -1;
 static int _udev_running = -1;
 static int _sync_with_udev = 1;
 static int _udev_checking = 1;
@@ -305,21 +309,9 @@ dm_string_mangling_t dm_get_name_mangling_mode(void)
 	return _name_mangling_mode;
 }
 
-struct dm_task *dm_task_create(int type)
+/* Sets the defaults of a zeroed task */
+void init_dm_task(struct dm_task *dmt, int type)
 {
-	struct dm_task *dmt = dm_zalloc(sizeof(*dmt));
-
-	if (!dmt) {
-		log_error("dm_task_create: malloc(%" PRIsize_t ") failed",
-			  sizeof(*dmt));
-		return NULL;
-	}
-
-	if (!dm_check_version()) {
-		dm_free(dmt);
-		return_NULL;
-	}
-
 	dmt->type = type;
 	dmt->minor = -1;
 	dmt->major = -1;
@@ -336,6 +328,24 @@ struct dm_task *dm_task_create(int type)
 	dmt->new_uuid = 0;
 	dmt->secure_data = 0;
 	dmt->record_timestamp = 0;
+}
+
+struct dm_task *dm_task_create(int type)
+{
+	struct dm_task *dmt = dm_zalloc(sizeof(*dmt));
+
+	if (!dmt) {
+		log_error("dm_task_create: malloc(%" PRIsize_t ") failed",
+			  sizeof(*dmt));
+		return NULL;
+	}
+
+	if (!dm_check_version()) {
+		dm_free(dmt);
+		return_NULL;
+	}
+
+	init_dm_task(dmt, type);
 
 	return dmt;
 }
@@ -2346,8 +2356,11 @@ bad:
 
 static void _check_udev_sync_requirements_once(void)
 {
+	if (_futex_cookies < 0)
+		_futex_cookies = strcmp(getenv("DM_UDEV_SYNC_FUTEX") ? : "0", "0") ? 1 : 0;
+
 	if (_semaphore_supported < 0)
-		_semaphore_supported = _check_semaphore_is_supported();
+		_semaphore_supported = _futex_cookies ? 1 : _check_semaphore_is_supported();
 
 	if (_udev_running < 0) {
 		_udev_running = _check_udev_is_running();
@@ -2385,6 +2398,255 @@ int dm_udev_get_checking(void)
 	return _udev_checking;
 }
 
+/*
+ * A cookie can also be backed by a counter in a file in /dev/shm, waited
+ * for with a futex.  These are not limited by SEMMNI, and incrementing
+ * one needs no system call once the file is mapped.  They are created
+ * when DM_UDEV_SYNC_FUTEX=1 is set or when no more semaphores can be
+ * created.  Both kinds share the key space, and the backend of a cookie
+ * is found from its file, so dmsetup udevcomplete from the udev rules
+ * works with either.
+ */
+#define COOKIE_FILE_PREFIX "/dev/shm/dm_cookie_"
+
+/* The file cookie last used, kept mapped for the next task on it */
+static uint32_t _mapped_cookie = 0;
+static int *_mapped_counter = NULL;
+
+static void _cookie_file_path(uint32_t cookie, char *path, size_t size)
+{
+	if (dm_snprintf(path, size, COOKIE_FILE_PREFIX "%" PRIx32, cookie) < 0)
+		path[0] = '\0';
+}
+
+static int _cookie_is_file(uint32_t cookie)
+{
+	char path[PATH_MAX];
+
+	if (_mapped_counter && (cookie == _mapped_cookie))
+		return 1;
+
+	_cookie_file_path(cookie, path, sizeof(path));
+
+	return !access(path, F_OK);
+}
+
+static void _cookie_file_unmap(void)
+{
+	if (_mapped_counter && munmap(_mapped_counter, sizeof(int)))
+		log_sys_debug("munmap", "cookie counter");
+
+	_mapped_counter = NULL;
+	_mapped_cookie = 0;
+}
+
+static int *_cookie_file_counter(uint32_t cookie)
+{
+	char path[PATH_MAX];
+	void *counter;
+	int fd;
+
+	if (_mapped_counter && (cookie == _mapped_cookie))
+		return _mapped_counter;
+
+	_cookie_file_unmap();
+	_cookie_file_path(cookie, path, sizeof(path));
+
+	if ((fd = open(path, O_RDWR)) < 0) {
+		log_error("Could not find notification file %s "
+			  "for cookie value %" PRIu32 " (0x%x): %s",
+			  path, cookie, cookie, strerror(errno));
+		return NULL;
+	}
+
+	counter = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	if (close(fd))
+		log_sys_debug("close", path);
+
+	if (counter == MAP_FAILED) {
+		log_sys_error("mmap", path);
+		return NULL;
+	}
+
+	_mapped_cookie = cookie;
+	_mapped_counter = counter;
+
+	return _mapped_counter;
+}
+
+static int _udev_notify_file_create(uint32_t *cookie)
+{
+	char path[PATH_MAX];
+	uint16_t base_cookie;
+	uint32_t gen_cookie;
+	int val = 1;
+	int rfd, fd;
+
+	if ((rfd = open("/dev/urandom", O_RDONLY)) < 0) {
+		log_error("Failed to open /dev/urandom "
+			  "to create random cookie value");
+		*cookie = 0;
+		return 0;
+	}
+
+	do {
+		if (read(rfd, &base_cookie, sizeof(base_cookie)) != sizeof(base_cookie)) {
+			log_error("Failed to initialize notification cookie");
+			goto bad;
+		}
+
+		if (!base_cookie)
+			continue;
+
+		gen_cookie = DM_COOKIE_MAGIC << 16 | base_cookie;
+		_cookie_file_path(gen_cookie, path, sizeof(path));
+
+		if ((fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0) {
+			if (errno == EEXIST) {
+				base_cookie = 0;
+				continue;
+			}
+			log_sys_error("open", path);
+			goto bad;
+		}
+
+		/*
+		 * A semaphore creator checks for the file after creating
+		 * its semaphore, so checking for the semaphore after creating
+		 * the file leaves no window where both could use the key.
+		 */
+		if ((semget((key_t) gen_cookie, 1, 0) >= 0) ||
+		    (pwrite(fd, &val, sizeof(val), 0) != sizeof(val))) {
+			if (unlink(path))
+				log_sys_debug("unlink", path);
+			base_cookie = 0;
+		}
+
+		if (close(fd))
+			log_sys_debug("close", path);
+	} while (!base_cookie);
+
+	log_debug_activation("Udev cookie 0x%" PRIx32 " (file) created and incremented to %d",
+			     gen_cookie, val);
+
+	if (close(rfd))
+		stack;
+
+	*cookie = gen_cookie;
+
+	return 1;
+
+bad:
+	if (close(rfd))
+		stack;
+
+	*cookie = 0;
+
+	return 0;
+}
+
+static int _udev_notify_file_inc(uint32_t cookie)
+{
+	int *counter;
+	int val;
+
+	if (!(counter = _cookie_file_counter(cookie)))
+		return_0;
+
+	val = __atomic_add_fetch(counter, 1, __ATOMIC_SEQ_CST);
+
+	log_debug_activation("Udev cookie 0x%" PRIx32 " (file) incremented to %d",
+			     cookie, val);
+
+	return 1;
+}
+
+static int _udev_notify_file_dec(uint32_t cookie)
+{
+	int *counter;
+	int val;
+
+	if (!(counter = _cookie_file_counter(cookie)))
+		return_0;
+
+	if ((val = __atomic_sub_fetch(counter, 1, __ATOMIC_SEQ_CST)) < 0) {
+		(void) __atomic_add_fetch(counter, 1, __ATOMIC_SEQ_CST);
+		log_error("Cookie 0x%" PRIx32 ": incorrect notification "
+			  "file state", cookie);
+		return 0;
+	}
+
+	if (!val && (syscall(SYS_futex, counter, FUTEX_WAKE, INT_MAX, NULL, NULL, 0) < 0))
+		log_sys_debug("futex", "wake");
+
+	log_debug_activation("Udev cookie 0x%" PRIx32 " (file) decremented to %d",
+			     cookie, val);
+
+	return 1;
+}
+
+static int _udev_notify_file_destroy(uint32_t cookie)
+{
+	char path[PATH_MAX];
+
+	if (cookie == _mapped_cookie)
+		_cookie_file_unmap();
+
+	_cookie_file_path(cookie, path, sizeof(path));
+
+	if (unlink(path) && (errno != ENOENT)) {
+		log_error("Could not cleanup notification file %s "
+			  "for cookie value %" PRIu32 " (0x%x): %s",
+			  path, cookie, cookie, strerror(errno));
+		return 0;
+	}
+
+	log_debug_activation("Udev cookie 0x%" PRIx32 " (file) destroyed", cookie);
+
+	return 1;
+}
+
+static int _udev_file_wait(uint32_t cookie, int *nowait)
+{
+	int *counter;
+	int val;
+
+	if (!(counter = _cookie_file_counter(cookie)))
+		return_0;
+
+	if (*nowait) {
+		if (__atomic_load_n(counter, __ATOMIC_SEQ_CST) > 1)
+			return 1;
+
+		*nowait = 0;
+	}
+
+	if (!_udev_notify_file_dec(cookie)) {
+		log_error("Failed to set a proper state for notification "
+			  "file for cookie value %" PRIu32 " (0x%x) "
+			  "to initialize waiting for incoming notifications.",
+			  cookie, cookie);
+		(void) _udev_notify_file_destroy(cookie);
+		return 0;
+	}
+
+	log_debug_activation("Udev cookie 0x%" PRIx32 " (file) waiting for zero",
+			     cookie);
+
+	while ((val = __atomic_load_n(counter, __ATOMIC_SEQ_CST)) > 0)
+		if ((syscall(SYS_futex, counter, FUTEX_WAIT, val, NULL, NULL, 0) < 0) &&
+		    (errno != EAGAIN) && (errno != EINTR)) {
+			log_error("Could not wait for notification file for cookie "
+				  "value %" PRIu32 " (0x%x): %s",
+				  cookie, cookie, strerror(errno));
+			(void) _udev_notify_file_destroy(cookie);
+			return 0;
+		}
+
+	return _udev_notify_file_destroy(cookie);
+}
+
 static int _get_cookie_sem(uint32_t cookie, int *semid)
 {
 	if (cookie >> 16 != DM_COOKIE_MAGIC) {
@@ -2535,17 +2797,24 @@ static int _udev_notify_sem_create(uint32_t *cookie, int *semid)
 						  "notification semaphore");
 					goto bad;
 				case ENOSPC:
-					log_error("Limit for the maximum number "
-						  "of semaphores reached. You can "
-						  "check and set the limits in "
-						  "/proc/sys/kernel/sem.");
-					goto bad;
+					log_debug_activation("Limit for the maximum number "
+							     "of semaphores reached, using a file "
+							     "for the cookie.");
+					if (close(fd))
+						stack;
+					*semid = -1;
+					return _udev_notify_file_create(cookie);
 				default:
 					log_error("Failed to create notification "
 						  "semaphore: %s", strerror(errno));
 					goto bad;
 			}
 		}
+		/* See _udev_notify_file_create() */
+		if (base_cookie && _cookie_is_file(gen_cookie)) {
+			(void) _udev_notify_sem_destroy(gen_cookie, gen_semid);
+			base_cookie = 0;
+		}
 	} while (!base_cookie);
 
 	log_debug_activation("Udev cookie 0x%" PRIx32 " (semid %d) created",
@@ -2597,6 +2866,9 @@ int dm_udev_create_cookie(uint32_t *cookie)
 		return 1;
 	}
 
+	if (_futex_cookies)
+		return _udev_notify_file_create(cookie);
+
 	return _udev_notify_sem_create(cookie, &semid);
 }
 
@@ -2658,12 +2930,19 @@ int dm_task_set_cookie(struct dm_task *dmt, uint32_t *cookie, uint16_t flags)
 	}
 
 	if (*cookie) {
-		if (!_get_cookie_sem(*cookie, &semid))
+		if (_cookie_is_file(*cookie))
+			semid = -1;
+		else if (!_get_cookie_sem(*cookie, &semid))
+			goto_bad;
+	} else if (_futex_cookies) {
+		if (!_udev_notify_file_create(cookie))
 			goto_bad;
+		semid = -1;
 	} else if (!_udev_notify_sem_create(cookie, &semid))
 		goto_bad;
 
-	if (!_udev_notify_sem_inc(*cookie, semid)) {
+	if ((semid < 0) ? !_udev_notify_file_inc(*cookie) :
+	    !_udev_notify_sem_inc(*cookie, semid)) {
 		log_error("Could not set notification semaphore "
 			  "identified by cookie value %" PRIu32 " (0x%x)",
 			  *cookie, *cookie);
@@ -2707,6 +2986,12 @@ int dm_udev_complete(uint32_t cookie)
 	if (!cookie || !dm_udev_get_sync_support())
 		return 1;
 
+	if (_cookie_is_file(cookie)) {
+		if (!_udev_notify_file_dec(cookie))
+			return_0;
+		return 1;
+	}
+
 	if (!_get_cookie_sem(cookie, &semid))
 		return_0;
 
@@ -2734,6 +3019,9 @@ static int _udev_wait(uint32_t cookie, int *nowait)
 	if (!cookie || !dm_udev_get_sync_support())
 		return 1;
 
+	if (_cookie_is_file(cookie))
+		return _udev_file_wait(cookie, nowait);
+
 	if (!_get_cookie_sem(cookie, &semid))
 		return_0;
 
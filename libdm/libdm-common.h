@@ -46,6 +46,7 @@ int get_dev_node_read_ahead(const char *dev_name, uint32_t major, uint32_t minor
 int set_dev_node_read_ahead(const char *dev_name, uint32_t major, uint32_t minor,
 			    uint32_t read_ahead, uint32_t read_ahead_flags);
 void update_devs(void);
+void init_dm_task(struct dm_task *dmt, int type);
 void selinux_release(void);
 
 void inc_suspended(void);
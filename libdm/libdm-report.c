@@ -77,6 +77,16 @@ struct dm_report {
 	struct dm_hash_table *value_cache;
 
 	struct report_group_item *group_item;
+
+	/*
+	 * JSON rows are built in json_row. The previous row is kept in
+	 * json_held_row until we know whether a separator follows it.
+	 */
+	struct json_buf {
+		char *mem;
+		size_t len;
+		size_t size;
+	} json_row, json_held_row;
 };
 
 struct dm_report_group {
@@ -109,6 +119,7 @@ struct report_group_item {
 #define FLD_DESCENDING	0x00008000
 #define FLD_COMPACTED	0x00010000
 #define FLD_COMPACT_ONE 0x00020000
+#define FLD_SELECTION	0x00040000
 
 struct field_properties {
 	struct dm_list list;
@@ -119,6 +130,7 @@ struct field_properties {
 	const struct dm_report_object_type *type;
 	uint32_t flags;
 	int implicit;
+	struct dm_report_field *sel_field; /* This field in the row under selection */
 };
 
 /*
@@ -1348,6 +1360,8 @@ void dm_report_free(struct dm_report *rh)
 		dm_pool_destroy(rh->selection->mem);
 	if (rh->value_cache)
 		dm_hash_destroy(rh->value_cache);
+	dm_free(rh->json_row.mem);
+	dm_free(rh->json_held_row.mem);
 	dm_pool_destroy(rh->mem);
 	dm_free(rh);
 }
@@ -1880,13 +1894,8 @@ static int _check_selection(struct dm_report *rh, struct selection_node *sn,
 
 	switch (sn->type & SEL_MASK) {
 		case SEL_ITEM:
-			r = 1;
-			dm_list_iterate_items(f, fields) {
-				if (sn->selection.item->fp != f->props)
-					continue;
-				if (!_compare_selection_field(rh, f, sn->selection.item))
-					r = 0;
-			}
+			f = sn->selection.item->fp->sel_field;
+			r = _compare_selection_field(rh, f, sn->selection.item);
 			break;
 		case SEL_OR:
 			r = 0;
@@ -1910,19 +1919,53 @@ static int _check_selection(struct dm_report *rh, struct selection_node *sn,
 
 static int _check_report_selection(struct dm_report *rh, struct dm_list *fields)
 {
+	struct dm_report_field *f;
+
 	if (!rh->selection || !rh->selection->selection_root)
 		return 1;
 
+	/* Let each selection item find its field without searching the row. */
+	dm_list_iterate_items(f, fields)
+		f->props->sel_field = f;
+
 	return _check_selection(rh, rh->selection->selection_root, fields);
 }
 
+static int _report_field(struct dm_report *rh, struct row *row, void *object,
+			 struct dm_report_field *field)
+{
+	struct field_properties *fp = field->props;
+	const struct dm_report_field_type *fields = fp->implicit ? _implicit_report_fields
+								 : rh->fields;
+	void *data;
+
+	data = fp->implicit ? _report_get_implicit_field_data(rh, fp, row)
+			    : _report_get_field_data(rh, fp, object);
+	if (!data) {
+		log_error("_do_report_object: "
+			  "no data assigned to field %s",
+			  fields[fp->field_num].id);
+		return 0;
+	}
+
+	if (!fields[fp->field_num].report_fn(rh, rh->mem,
+						 field, data,
+						 rh->private)) {
+		log_error("_do_report_object: "
+			  "report function failed for field %s",
+			  fields[fp->field_num].id);
+		return 0;
+	}
+
+	return 1;
+}
+
 static int _do_report_object(struct dm_report *rh, void *object, int do_output, int *selected)
 {
-	const struct dm_report_field_type *fields;
 	struct field_properties *fp;
 	struct row *row = NULL;
 	struct dm_report_field *field;
-	void *data = NULL;
+	int early_selection;
 	int r = 0;
 
 	if (!rh) {
@@ -1961,7 +2004,7 @@ static int _do_report_object(struct dm_report *rh, void *object, int do_output,
 	dm_list_init(&row->fields);
 	row->selected = 1;
 
-	/* For each field to be displayed, call its report_fn */
+	/* Allocate a field for each one to be displayed */
 	dm_list_iterate_items(fp, &rh->field_props) {
 		if (!(field = dm_pool_zalloc(rh->mem, sizeof(*field)))) {
 			log_error("_do_report_object: "
@@ -1969,39 +2012,45 @@ static int _do_report_object(struct dm_report *rh, void *object, int do_output,
 			goto out;
 		}
 
-		if (fp->implicit) {
-			fields = _implicit_report_fields;
-			if (!strcmp(fields[fp->field_num].id, SPECIAL_FIELD_SELECTED_ID))
-				row->field_sel_status = field;
-		} else
-			fields = rh->fields;
+		if (fp->implicit &&
+		    !strcmp(_implicit_report_fields[fp->field_num].id, SPECIAL_FIELD_SELECTED_ID))
+			row->field_sel_status = field;
 
 		field->props = fp;
+		dm_list_add(&row->fields, &field->list);
+	}
 
-		data = fp->implicit ? _report_get_implicit_field_data(rh, fp, row)
-				    : _report_get_field_data(rh, fp, object);
-		if (!data) {
-			log_error("_do_report_object: "
-				  "no data assigned to field %s",
-				  fields[fp->field_num].id);
-			goto out;
-		}
+	/*
+	 * Unless a row that is not selected is still kept for output,
+	 * call report_fn only for fields the selection refers to first.
+	 * The rest is reported only for selected rows that are output.
+	 */
+	early_selection = !row->field_sel_status &&
+			  !(rh->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES);
 
-		if (!fields[fp->field_num].report_fn(rh, rh->mem,
-							 field, data,
-							 rh->private)) {
-			log_error("_do_report_object: "
-				  "report function failed for field %s",
-				  fields[fp->field_num].id);
+	if (early_selection) {
+		dm_list_iterate_items(field, &row->fields)
+			if ((field->props->flags & FLD_SELECTION) &&
+			    !_report_field(rh, row, object, field))
+				goto out;
+
+		r = 1;
+		if (!(row->selected = _check_report_selection(rh, &row->fields)) ||
+		    !do_output)
 			goto out;
-		}
+		r = 0;
+	}
 
-		dm_list_add(&row->fields, &field->list);
+	dm_list_iterate_items(field, &row->fields) {
+		if (early_selection && (field->props->flags & FLD_SELECTION))
+			continue;
+		if (!_report_field(rh, row, object, field))
+			goto out;
 	}
 
 	r = 1;
 
-	if (!_check_report_selection(rh, &row->fields)) {
+	if (!early_selection && !_check_report_selection(rh, &row->fields)) {
 		row->selected = 0;
 
 		/*
@@ -3505,6 +3554,7 @@ static struct field_selection *_create_field_selection(struct dm_report *rh,
 
 	fs->fp = found;
 	fs->flags = flags;
+	found->flags |= FLD_SELECTION;
 
 	if (!_get_reserved_value(rh, field_num, rvw)) {
 		log_error("dm_report: could not get reserved value "
@@ -4274,74 +4324,124 @@ int dm_report_column_headings(struct dm_report *rh)
 
 /*
  * Sort rows of data
+ *
+ * All sort fields of a row are encoded once into a single byte key
+ * that compares with memcmp() in the requested order:
+ *   - numbers, sizes, percents and times as 8 big-endian bytes,
+ *   - strings and string lists with their terminating NUL,
+ * with every byte inverted for descending keys.  Each encoded field is
+ * prefix-free, so the first differing byte decides like _row_compare
+ * used to do field by field.
  */
-static int _row_compare(const void *a, const void *b)
+struct sort_item {
+	uint64_t prefix;		/* First 8 key bytes as a big-endian number */
+	const unsigned char *key;
+	size_t len;
+	struct row *row;
+};
+
+static int _is_numeric_sort_field(const struct dm_report_field *field)
+{
+	return (field->props->flags & (DM_REPORT_FIELD_TYPE_NUMBER |
+				       DM_REPORT_FIELD_TYPE_SIZE |
+				       DM_REPORT_FIELD_TYPE_PERCENT |
+				       DM_REPORT_FIELD_TYPE_TIME)) ? 1 : 0;
+}
+
+static const char *_sort_string(const struct dm_report_field *field)
 {
-	const struct row *rowa = *(const struct row * const *) a;
-	const struct row *rowb = *(const struct row * const *) b;
-	const struct dm_report_field *sfa, *sfb;
+	if (field->props->flags & DM_REPORT_FIELD_TYPE_STRING_LIST)
+		return ((const struct str_list_sort_value *) field->sort_value)->value;
+
+	return (const char *) field->sort_value;
+}
+
+static int _encode_sort_key(struct dm_report *rh, struct sort_item *item)
+{
+	const struct dm_report_field *sf;
+	unsigned char *key, *p;
+	unsigned char mask;
+	size_t len = 0, i, n;
+	uint64_t num;
 	uint32_t cnt;
 
-	for (cnt = 0; cnt < rowa->rh->keys_count; cnt++) {
-		sfa = (*rowa->sort_fields)[cnt];
-		sfb = (*rowb->sort_fields)[cnt];
-		if ((sfa->props->flags & DM_REPORT_FIELD_TYPE_NUMBER) ||
-		    (sfa->props->flags & DM_REPORT_FIELD_TYPE_SIZE) ||
-		    (sfa->props->flags & DM_REPORT_FIELD_TYPE_TIME)) {
-			const uint64_t numa =
-			    *(const uint64_t *) sfa->sort_value;
-			const uint64_t numb =
-			    *(const uint64_t *) sfb->sort_value;
-
-			if (numa == numb)
-				continue;
+	for (cnt = 0; cnt < rh->keys_count; cnt++) {
+		sf = (*item->row->sort_fields)[cnt];
+		len += _is_numeric_sort_field(sf) ? sizeof(num) :
+			strlen(_sort_string(sf)) + 1;
+	}
 
-			if (sfa->props->flags & FLD_ASCENDING) {
-				return (numa > numb) ? 1 : -1;
-			} else {	/* FLD_DESCENDING */
-				return (numa < numb) ? 1 : -1;
-			}
-		} else {
-			/* DM_REPORT_FIELD_TYPE_STRING
-			 * DM_REPORT_FIELD_TYPE_STRING_LIST */
-			const char *stra = (const char *) sfa->sort_value;
-			const char *strb = (const char *) sfb->sort_value;
-			int cmp = strcmp(stra, strb);
+	if (!(key = dm_pool_alloc(rh->mem, len))) {
+		log_error("dm_report: sort key allocation failed");
+		return 0;
+	}
 
-			if (!cmp)
-				continue;
+	for (p = key, cnt = 0; cnt < rh->keys_count; cnt++) {
+		sf = (*item->row->sort_fields)[cnt];
+		mask = (sf->props->flags & FLD_DESCENDING) ? 0xff : 0;
 
-			if (sfa->props->flags & FLD_ASCENDING) {
-				return (cmp > 0) ? 1 : -1;
-			} else {	/* FLD_DESCENDING */
-				return (cmp < 0) ? 1 : -1;
-			}
+		if (_is_numeric_sort_field(sf)) {
+			num = *(const uint64_t *) sf->sort_value;
+			for (i = 0; i < sizeof(num); i++)
+				*p++ = (unsigned char) (num >> (56 - 8 * i)) ^ mask;
+		} else {
+			n = strlen(_sort_string(sf)) + 1;
+			memcpy(p, _sort_string(sf), n);
+			for (i = 0; i < n; i++)
+				*p++ ^= mask;
 		}
 	}
 
-	return 0;		/* Identical */
+	item->key = key;
+	item->len = len;
+	for (item->prefix = 0, i = 0; i < sizeof(item->prefix); i++)
+		item->prefix = (item->prefix << 8) | (i < len ? key[i] : 0);
+
+	return 1;
+}
+
+static int _row_compare(const void *a, const void *b)
+{
+	const struct sort_item *ia = a;
+	const struct sort_item *ib = b;
+	size_t len;
+	int cmp;
+
+	if (ia->prefix != ib->prefix)
+		return (ia->prefix > ib->prefix) ? 1 : -1;
+
+	len = (ia->len < ib->len) ? ia->len : ib->len;
+	if (len > sizeof(ia->prefix) &&
+	    (cmp = memcmp(ia->key + sizeof(ia->prefix), ib->key + sizeof(ib->prefix),
+			  len - sizeof(ia->prefix))))
+		return cmp;
+
+	return (ia->len > ib->len) - (ia->len < ib->len);
 }
 
 static int _sort_rows(struct dm_report *rh)
 {
-	struct row *(*rows)[];
+	struct sort_item *items;
 	uint32_t count = 0;
 	struct row *row;
 
-	if (!(rows = dm_pool_alloc(rh->mem, sizeof(**rows) *
-				dm_list_size(&rh->rows)))) {
+	if (!(items = dm_pool_alloc(rh->mem, sizeof(*items) *
+				    dm_list_size(&rh->rows)))) {
 		log_error("dm_report: sort array allocation failed");
 		return 0;
 	}
 
-	dm_list_iterate_items(row, &rh->rows)
-		(*rows)[count++] = row;
+	dm_list_iterate_items(row, &rh->rows) {
+		items[count].row = row;
+		if (!_encode_sort_key(rh, &items[count++]))
+			return_0;
+	}
 
-	qsort(rows, count, sizeof(**rows), _row_compare);
+	qsort(items, count, sizeof(*items), _row_compare);
 
 	dm_list_init(&rh->rows);
 	while (count--)
-		dm_list_add_h(&rh->rows, &(*rows)[count]->list);
+		dm_list_add_h(&rh->rows, &items[count].row->list);
 
 	return 1;
 }
@@ -4385,20 +4485,10 @@ static int _output_field(struct dm_report *rh, struct dm_report_field *field)
 	int32_t width;
 	uint32_t align;
 	const char *repstr;
-	const char *p1_repstr, *p2_repstr;
 	char *buf = NULL;
 	size_t buf_size = 0;
 
-	if (_is_json_report(rh)) {
-		if (!dm_pool_grow_object(rh->mem, JSON_QUOTE, 1) ||
-		    !dm_pool_grow_object(rh->mem, fields[field->props->field_num].id, 0) ||
-		    !dm_pool_grow_object(rh->mem, JSON_QUOTE, 1) ||
-		    !dm_pool_grow_object(rh->mem, JSON_PAIR, 1) ||
-		    !dm_pool_grow_object(rh->mem, JSON_QUOTE, 1)) {
-			log_error("dm_report: Unable to extend output line");
-			return 0;
-		}
-	} else if (rh->flags & DM_REPORT_OUTPUT_FIELD_NAME_PREFIX) {
+	if (rh->flags & DM_REPORT_OUTPUT_FIELD_NAME_PREFIX) {
 		if (!(field_id = dm_strdup(fields[field->props->field_num].id))) {
 			log_error("dm_report: Failed to copy field name");
 			return 0;
@@ -4433,33 +4523,9 @@ static int _output_field(struct dm_report *rh, struct dm_report_field *field)
 	repstr = field->report_string;
 	width = field->props->width;
 	if (!(rh->flags & DM_REPORT_OUTPUT_ALIGNED)) {
-		if (_is_json_report(rh)) {
-			/* Escape any JSON_QUOTE that may appear in reported string. */
-			p1_repstr = repstr;
-			while ((p2_repstr = strstr(p1_repstr, JSON_QUOTE))) {
-				if (p2_repstr > p1_repstr) {
-					if (!dm_pool_grow_object(rh->mem, p1_repstr, p2_repstr - p1_repstr)) {
-						log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-						return 0;
-					}
-				}
-				if (!dm_pool_grow_object(rh->mem, JSON_ESCAPE_CHAR, 1) ||
-				    !dm_pool_grow_object(rh->mem, JSON_QUOTE, 1)) {
-					log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-					return 0;
-				}
-				p1_repstr = p2_repstr + 1;
-			}
-
-			if (!dm_pool_grow_object(rh->mem, p1_repstr, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				return 0;
-			}
-		} else {
-			if (!dm_pool_grow_object(rh->mem, repstr, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				return 0;
-			}
+		if (!dm_pool_grow_object(rh->mem, repstr, 0)) {
+			log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
+			return 0;
 		}
 	} else {
 		if (!(align = field->props->flags & DM_REPORT_FIELD_ALIGN_MASK))
@@ -4504,11 +4570,6 @@ static int _output_field(struct dm_report *rh, struct dm_report_field *field)
 				goto bad;
 			}
 		}
-	} else if (_is_json_report(rh)) {
-		if (!dm_pool_grow_object(rh->mem, JSON_QUOTE, 1)) {
-			log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-			goto bad;
-		}
 	}
 
 	dm_free(buf);
@@ -4599,12 +4660,115 @@ static int _output_as_rows(struct dm_report *rh)
 	return 0;
 }
 
+static int _json_append(struct json_buf *jb, const char *str, size_t len)
+{
+	size_t size = jb->size ? : 512;
+	char *mem;
+
+	while (jb->len + len + 1 > size)
+		size *= 2;
+
+	if (size > jb->size) {
+		if (!(mem = dm_realloc(jb->mem, size))) {
+			log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
+			return 0;
+		}
+		jb->mem = mem;
+		jb->size = size;
+	}
+
+	memcpy(jb->mem + jb->len, str, len);
+	jb->len += len;
+	jb->mem[jb->len] = '\0';
+
+	return 1;
+}
+
+#define _json_append_const(jb, str) _json_append((jb), (str), sizeof(str) - 1)
+
+/*
+ * Builds the whole JSON row in rh->json_row with plain memory copies.
+ * Report strings are only scanned for JSON_QUOTE that needs escaping.
+ */
+static int _json_build_row(struct dm_report *rh, struct row *row)
+{
+	struct json_buf *jb = &rh->json_row;
+	const struct dm_report_field_type *fields;
+	struct dm_report_field *field;
+	const char *p, *q;
+	int do_field_delim = 0;
+
+	jb->len = 0;
+	if (!_json_append_const(jb, JSON_OBJECT_START))
+		return_0;
+
+	dm_list_iterate_items(field, &row->fields) {
+		if (field->props->flags & FLD_HIDDEN)
+			continue;
+
+		if (do_field_delim &&
+		    !_json_append_const(jb, JSON_SEPARATOR JSON_SPACE))
+			return_0;
+		do_field_delim = 1;
+
+		fields = field->props->implicit ? _implicit_report_fields : rh->fields;
+		p = fields[field->props->field_num].id;
+		if (!_json_append_const(jb, JSON_QUOTE) ||
+		    !_json_append(jb, p, strlen(p)) ||
+		    !_json_append_const(jb, JSON_QUOTE JSON_PAIR JSON_QUOTE))
+			return_0;
+
+		/* Escape any JSON_QUOTE that may appear in reported string. */
+		for (p = field->report_string; (q = strchr(p, JSON_QUOTE[0])); p = q + 1)
+			if (!_json_append(jb, p, q - p) ||
+			    !_json_append_const(jb, JSON_ESCAPE_CHAR JSON_QUOTE))
+				return_0;
+
+		if (!_json_append(jb, p, strlen(p)) ||
+		    !_json_append_const(jb, JSON_QUOTE))
+			return_0;
+	}
+
+	return _json_append_const(jb, JSON_OBJECT_END);
+}
+
+static void _json_print_held_row(struct dm_report *rh, const char *separator)
+{
+	struct json_buf *jb = &rh->json_held_row;
+
+	log_print("%*s%s", rh->group_item->group->indent + (int) jb->len, jb->mem, separator);
+	jb->len = 0;
+}
+
+static int _json_output_row(struct dm_report *rh, struct row *row)
+{
+	struct json_buf tmp;
+
+	if (!_json_build_row(rh, row))
+		return_0;
+
+	/* Another row follows so the held one needs the separator. */
+	if (rh->json_held_row.len)
+		_json_print_held_row(rh, JSON_SEPARATOR);
+
+	tmp = rh->json_held_row;
+	rh->json_held_row = rh->json_row;
+	rh->json_row = tmp;
+
+	return 1;
+}
+
+static void _json_flush_held_row(struct dm_report *rh)
+{
+	if (rh->json_held_row.len)
+		_json_print_held_row(rh, "");
+}
+
 static int _output_as_columns(struct dm_report *rh)
 {
 	struct dm_list *fh, *rowh, *ftmp, *rtmp;
 	struct row *row = NULL;
 	struct dm_report_field *field;
-	struct dm_list *last_row;
 	int do_field_delim;
 	char *line;
 
@@ -4613,25 +4777,25 @@ static int _output_as_columns(struct dm_report *rh)
 		_report_headings(rh);
 
 	/* Print and clear buffer */
-	last_row = dm_list_last(&rh->rows);
 	dm_list_iterate_safe(rowh, rtmp, &rh->rows) {
 		row = dm_list_item(rowh, struct row);
 
 		if (!_should_display_row(row))
 			continue;
 
+		if (_is_json_report(rh)) {
+			if (!_json_output_row(rh, row))
+				return_0;
+			if (!(rh->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES))
+				dm_list_del(&row->list);
+			continue;
+		}
+
 		if (!dm_pool_begin_object(rh->mem, 512)) {
 			log_error("dm_report: Unable to allocate output line");
 			return 0;
 		}
 
-		if (_is_json_report(rh)) {
-			if (!dm_pool_grow_object(rh->mem, JSON_OBJECT_START, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				goto bad;
-			}
-		}
-
 		do_field_delim = 0;
 
 		dm_list_iterate_safe(fh, ftmp, &row->fields) {
@@ -4640,17 +4804,9 @@ static int _output_as_columns(struct dm_report *rh)
 				continue;
 
 			if (do_field_delim) {
-				if (_is_json_report(rh)) {
-					if (!dm_pool_grow_object(rh->mem, JSON_SEPARATOR, 0) ||
-					    !dm_pool_grow_object(rh->mem, JSON_SPACE, 0)) {
-						log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-						goto bad;
-					}
-				} else {
-					if (!dm_pool_grow_object(rh->mem, rh->separator, 0)) {
-						log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-						goto bad;
-					}
+				if (!dm_pool_grow_object(rh->mem, rh->separator, 0)) {
+					log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
+					goto bad;
 				}
 			} else
 				do_field_delim = 1;
@@ -4662,18 +4818,6 @@ static int _output_as_columns(struct dm_report *rh)
 				dm_list_del(&field->list);
 		}
 
-		if (_is_json_report(rh)) {
-			if (!dm_pool_grow_object(rh->mem, JSON_OBJECT_END, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				goto bad;
-			}
-			if (rowh != last_row &&
-			    !dm_pool_grow_object(rh->mem, JSON_SEPARATOR, 0)) {
-				log_error(UNABLE_TO_EXTEND_OUTPUT_LINE_MSG);
-				goto bad;
-			}
-		}
-
 		if (!dm_pool_grow_object(rh->mem, "\0", 1)) {
 			log_error("dm_report: Unable to terminate output line");
 			goto bad;
@@ -4685,6 +4829,10 @@ static int _output_as_columns(struct dm_report *rh)
 			dm_list_del(&row->list);
 	}
 
+	/* Unbuffered rows keep streaming until the report group is popped. */
+	if (_is_json_report(rh) && (rh->flags & DM_REPORT_OUTPUT_BUFFERED))
+		_json_flush_held_row(rh);
+
 	if (!(rh->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES))
 		_destroy_rows(rh);
 
@@ -4774,6 +4922,10 @@ static int _prepare_json_report_output(struct dm_report *rh)
 		return 0;
 	}
 
+	/* Unbuffered report keeps its array open while rows stream in. */
+	if (rh->group_item->needs_closing && !(rh->flags & DM_REPORT_OUTPUT_BUFFERED))
+		return 1;
+
 	if (rh->group_item->needs_closing) {
 		log_error("dm_report: dm_report_output: unfinished JSON output detected");
 		return 0;
@@ -4825,7 +4977,10 @@ int dm_report_output(struct dm_report *rh)
 	if ((rh->flags & RH_SORT_REQUIRED))
 		_sort_rows(rh);
 
-	if (_is_basic_report(rh) && !_print_basic_report_header(rh))
+	/* Unbuffered report prints its header only with the first row. */
+	if (_is_basic_report(rh) &&
+	    ((rh->flags & DM_REPORT_OUTPUT_BUFFERED) || !rh->group_item->output_done) &&
+	    !_print_basic_report_header(rh))
 		goto_out;
 
 	if ((rh->flags & DM_REPORT_OUTPUT_COLUMNS_AS_ROWS))
@@ -4919,7 +5074,13 @@ static int _report_group_push_json(struct report_group_item *item, const char *n
 		item->report->flags &= ~(DM_REPORT_OUTPUT_ALIGNED |
 					 DM_REPORT_OUTPUT_HEADINGS |
 					 DM_REPORT_OUTPUT_COLUMNS_AS_ROWS);
-		item->report->flags |= DM_REPORT_OUTPUT_BUFFERED;
+		/*
+		 * Reports output multiple times (like the log report) must stay
+		 * buffered so they never interleave with reports pushed later.
+		 * Others may stream their rows if they were created unbuffered.
+		 */
+		if (item->report->flags & DM_REPORT_OUTPUT_MULTIPLE_TIMES)
+			item->report->flags |= DM_REPORT_OUTPUT_BUFFERED;
 	} else {
 		_json_output_start(item->group);
 		if (name) {
@@ -5008,6 +5169,9 @@ static int _report_group_pop_basic(struct report_group_item *item)
 
 static int _report_group_pop_json(struct report_group_item *item)
 {
+	if (item->report)
+		_json_flush_held_row(item->report);
+
 	if (item->output_done && item->needs_closing) {
 		if (item->data) {
 			item->group->indent -= JSON_INDENT_UNIT;
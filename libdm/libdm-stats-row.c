@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of the device-mapper userspace tools.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+// This file contains the @stats_print row parser.  It is included by
+// libdm-stats.c and by the unit tests, and is not built on its own.
+
+#include <stdint.h>
+
+/* start, len and the 13 counters of one area */
+#define DM_STATS_ROW_FIELDS 15
+
+/*
+ * Parse one unsigned decimal value.  Returns a pointer to the first
+ * character after the digits, or NULL if there are no digits or the
+ * value does not fit in 64 bits.
+ */
+static const char *_stats_parse_u64(const char *c, uint64_t *val)
+{
+	uint64_t v = 0;
+	unsigned d;
+
+	if ((unsigned)(*c - '0') > 9)
+		return NULL;
+
+	while ((d = (unsigned)(*c - '0')) <= 9) {
+		if (v > (UINT64_MAX - d) / 10)
+			return NULL;
+		v = v * 10 + d;
+		c++;
+	}
+
+	*val = v;
+
+	return c;
+}
+
+/*
+ * Parse the leading "<start>+<len> <counter> ... <counter>" part of a
+ * @stats_print row into vals[DM_STATS_ROW_FIELDS] without copying the
+ * row.  Returns a pointer to the character following the last counter
+ * (a space before histogram data, a newline or the terminating NUL),
+ * or NULL if the row is malformed.
+ */
+static const char *_stats_parse_row(const char *c, uint64_t *vals)
+{
+	unsigned i;
+
+	for (i = 0; i < DM_STATS_ROW_FIELDS; i++) {
+		if (!(c = _stats_parse_u64(c, vals + i)))
+			return NULL;
+
+		if (i == DM_STATS_ROW_FIELDS - 1)
+			break;
+
+		if (*c != (i ? ' ' : '+'))
+			return NULL;
+		c++;
+	}
+
+	if (*c && (*c != ' ') && (*c != '\n'))
+		return NULL;
+
+	return c;
+}
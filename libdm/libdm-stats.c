@@ -19,6 +19,7 @@
 #include "libdm/misc/kdev_t.h"
 
 #include "math.h" /* log10() */
+#include "libdm-stats-row.c"
 
 #include <sys/sysmacros.h>
 #include <sys/ioctl.h>
@@ -101,6 +102,11 @@ struct dm_stats_region {
 	struct dm_histogram *bounds; /* histogram configuration */
 	struct dm_histogram *histogram; /* aggregate cache */
 	struct dm_stats_counters *counters;
+	struct dm_stats_counters *samples; /* sample history ring */
+	unsigned nr_samples; /* valid samples in ring */
+	unsigned sample_next; /* next ring slot to fill */
+	struct dm_stats_counters sum; /* aggregate area counter cache */
+	unsigned sum_gen; /* dms->aggr_gen when sum was computed */
 };
 
 struct dm_stats_group {
@@ -108,6 +114,8 @@ struct dm_stats_group {
 	const char *alias;
 	dm_bitset_t regions;
 	struct dm_histogram *histogram;
+	struct dm_stats_counters sum; /* aggregate counter cache */
+	unsigned sum_gen; /* dms->aggr_gen when sum was computed */
 };
 
 struct dm_stats {
@@ -126,6 +134,8 @@ struct dm_stats {
 	uint64_t interval_ns;  /* sampling interval in nanoseconds */
 	uint64_t timescale; /* default sample value multiplier */
 	int precise; /* use precise_timestamps when creating regions */
+	unsigned sample_history; /* samples kept by dm_stats_sample() */
+	unsigned aggr_gen; /* bumped when counters or groups change */
 	struct dm_stats_region *regions;
 	struct dm_stats_group *groups;
 	/* statistics cursor */
@@ -226,6 +236,9 @@ struct dm_stats *dm_stats_create(const char *program_id)
 	/* maintain compatibility with earlier walk version */
 	dms->walk_flags = dms->cur_flags = DM_STATS_WALK_DEFAULT;
 
+	/* zeroed aggregate caches are never valid */
+	dms->aggr_gen = 1;
+
 	return dms;
 
 bad:
@@ -330,6 +343,10 @@ static void _stats_region_destroy(struct dm_stats_region *region)
 	region->counters = NULL;
 	region->bounds = NULL;
 
+	dm_free(region->samples);
+	region->samples = NULL;
+	region->nr_samples = region->sample_next = 0;
+
 	dm_free(region->program_id);
 	region->program_id = NULL;
 	dm_free(region->aux_data);
@@ -361,6 +378,7 @@ static void _stats_group_destroy(struct dm_stats_group *group)
 		return;
 
 	group->histogram = NULL;
+	group->sum_gen = 0;
 
 	if (group->alias) {
 		dm_free((char *) group->alias);
@@ -978,6 +996,9 @@ static int _stats_parse_list_region(struct dm_stats *dms,
 	}
 
 	region->counters = NULL;
+	region->samples = NULL;
+	region->nr_samples = region->sample_next = 0;
+	region->sum_gen = 0;
 	return 1;
 }
 
@@ -1023,9 +1044,8 @@ static int _stats_parse_list(struct dm_stats *dms, const char *resp)
 
 	while(fgets(line, sizeof(line), list_rows)) {
 
+		memset(&cur_group, 0, sizeof(cur_group));
 		cur_group.group_id = DM_STATS_GROUP_NOT_PRESENT;
-		cur_group.regions = NULL;
-		cur_group.alias = NULL;
 
 		if (!_stats_parse_list_region(dms, &cur, line))
 			goto_bad;
@@ -1076,6 +1096,7 @@ static int _stats_parse_list(struct dm_stats *dms, const char *resp)
 		_check_group_regions_present(dms, &dms->groups[dms->cur_group]);
 
 	_stats_update_groups(dms);
+	dms->aggr_gen++;
 
 	if (fclose(list_rows))
 		stack;
@@ -1136,7 +1157,7 @@ bad:
 /*
  * Parse histogram data returned from a @stats_print operation.
  */
-static int _stats_parse_histogram(struct dm_pool *mem, char *hist_str,
+static int _stats_parse_histogram(struct dm_pool *mem, const char *hist_str,
 				  struct dm_histogram **histogram,
 				  struct dm_stats_region *region)
 {
@@ -1215,6 +1236,28 @@ bad:
 	return 0;
 }
 
+/*
+ * Fill an area's counters from the values of a parsed @stats_print row,
+ * scaling time values up if needed.
+ */
+static void _stats_set_counters(struct dm_stats_counters *cur,
+				const uint64_t *vals, uint64_t timescale)
+{
+	cur->reads = vals[2];
+	cur->reads_merged = vals[3];
+	cur->read_sectors = vals[4];
+	cur->read_nsecs = vals[5] * timescale;
+	cur->writes = vals[6];
+	cur->writes_merged = vals[7];
+	cur->write_sectors = vals[8];
+	cur->write_nsecs = vals[9] * timescale;
+	cur->io_in_progress = vals[10];
+	cur->io_nsecs = vals[11] * timescale;
+	cur->weighted_io_nsecs = vals[12] * timescale;
+	cur->total_read_nsecs = vals[13] * timescale;
+	cur->total_write_nsecs = vals[14] * timescale;
+}
+
 static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 			       struct dm_stats_region *region,
 			       uint64_t timescale)
@@ -1222,10 +1265,9 @@ static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 	struct dm_histogram *hist = NULL;
 	struct dm_pool *mem = dms->mem;
 	struct dm_stats_counters cur;
-	FILE *stats_rows = NULL;
+	uint64_t vals[DM_STATS_ROW_FIELDS];
 	uint64_t start = 0, len = 0;
-	char row[STATS_ROW_BUF_LEN];
-	int r;
+	const char *row, *c;
 
 	if (!resp) {
 		log_error("Could not parse empty @stats_print response.");
@@ -1237,15 +1279,6 @@ static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 	if (!dm_pool_begin_object(mem, 512))
 		goto_bad;
 
-	/*
-	 * dm_task_get_message_response() returns a 'const char *' but
-	 * since fmemopen also permits "w" it expects a 'char *'.
-	 */
-	/* coverity[alloc_strlen] intentional */
-	stats_rows = fmemopen((char *)resp, strlen(resp), "r");
-	if (!stats_rows)
-		goto_bad;
-
 	/*
 	 * Output format for each step-sized area of a region:
 	 *
@@ -1272,55 +1305,31 @@ static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 	 * 12. the total time spent reading in milliseconds
 	 * 13. the total time spent writing in milliseconds
 	 *
+	 * Rows are parsed in place: a region may have many thousands of
+	 * areas and this runs for every region on each stats update.
 	*/
-	while (fgets(row, sizeof(row), stats_rows)) {
-		r = sscanf(row, FMTu64 "+" FMTu64 /* start+len */
-			   /* reads */
-			   FMTu64 " " FMTu64 " " FMTu64 " " FMTu64 " "
-			   /* writes */
-			   FMTu64 " " FMTu64 " " FMTu64 " " FMTu64 " "
-			   /* in flight & io nsecs */
-			   FMTu64 " " FMTu64 " " FMTu64 " "
-			   /* tot read/write nsecs */
-			   FMTu64 " " FMTu64, &start, &len,
-			   &cur.reads, &cur.reads_merged, &cur.read_sectors,
-			   &cur.read_nsecs,
-			   &cur.writes, &cur.writes_merged, &cur.write_sectors,
-			   &cur.write_nsecs,
-			   &cur.io_in_progress,
-			   &cur.io_nsecs, &cur.weighted_io_nsecs,
-			   &cur.total_read_nsecs, &cur.total_write_nsecs);
-		if (r != 15) {
+	for (row = resp; *row; row = c) {
+		if (!(c = _stats_parse_row(row, vals))) {
 			log_error("Could not parse @stats_print row.");
 			goto bad;
 		}
 
-		/* scale time values up if needed */
-		if (timescale != 1) {
-			cur.read_nsecs *= timescale;
-			cur.write_nsecs *= timescale;
-			cur.io_nsecs *= timescale;
-			cur.weighted_io_nsecs *= timescale;
-			cur.total_read_nsecs *= timescale;
-			cur.total_write_nsecs *= timescale;
-		}
+		start = vals[0];
+		len = vals[1];
+		_stats_set_counters(&cur, vals, timescale);
 
 		if (region->bounds) {
-			/* Find first histogram separator. */
-			char *hist_str = strchr(row, ':');
-			if (!hist_str) {
+			/* Histogram data follows the last counter. */
+			if (*c != ' ') {
 				log_error("Could not parse histogram value.");
 				goto bad;
 			}
-			/* Find space preceding histogram. */
-			while (hist_str && *(hist_str - 1) != ' ')
-				hist_str--;
 
 			/* Use a separate pool for histogram objects since we
 			 * are growing the area table and each area's histogram
 			 * table simultaneously.
 			 */
-			if (!_stats_parse_histogram(dms->hist_mem, hist_str,
+			if (!_stats_parse_histogram(dms->hist_mem, c + 1,
 						    &hist, region))
 				goto_bad;
 			hist->dms = dms;
@@ -1336,6 +1345,10 @@ static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 			region->start = start;
 			region->step = len; /* area size is always uniform. */
 		}
+
+		/* Skip anything else up to the next row. */
+		while (*c && (*c++ != '\n'))
+			;
 	}
 
 	if (region->start == UINT64_MAX)
@@ -1345,16 +1358,11 @@ static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 	region->len = (start + len) - region->start;
 	region->timescale = timescale;
 	region->counters = dm_pool_end_object(mem);
-
-	if (fclose(stats_rows))
-		stack;
+	dms->aggr_gen++;
 
 	return 1;
 
 bad:
-	if (stats_rows)
-		if (fclose(stats_rows))
-			stack;
 	dm_pool_abandon_object(mem);
 
 	return 0;
@@ -1888,6 +1896,9 @@ static int _stats_set_aux(struct dm_stats *dms,
 	struct dm_task *dmt = NULL;
 	char msg[STATS_MSG_BUF_LEN];
 
+	/* group membership may have changed */
+	dms->aggr_gen++;
+
 	/* group data required? */
 	if (_stats_group_id_present(dms, region_id)) {
 		group_tag = _build_group_tag(dms, region_id);
@@ -2387,6 +2398,124 @@ bad:
 	return 0;
 }
 
+int dm_stats_set_sample_history(struct dm_stats *dms, unsigned nr_samples)
+{
+	uint64_t i;
+
+	/* Drop any history kept with the previous depth. */
+	if (dms->regions)
+		for (i = 0; i <= dms->max_region; i++) {
+			dm_free(dms->regions[i].samples);
+			dms->regions[i].samples = NULL;
+			dms->regions[i].nr_samples = 0;
+			dms->regions[i].sample_next = 0;
+		}
+
+	dms->sample_history = nr_samples;
+
+	return 1;
+}
+
+/*
+ * Overwrite the counters of an already populated region in place with
+ * a new @stats_print_clear response and append them to the region's
+ * sample ring.  Histogram data is not updated.
+ */
+static int _stats_sample_region(struct dm_stats *dms,
+				struct dm_stats_region *region,
+				const char *resp)
+{
+	uint64_t nr_areas = _nr_areas_region(region), area = 0;
+	uint64_t vals[DM_STATS_ROW_FIELDS];
+	const char *row, *c;
+
+	for (row = resp; *row; row = c) {
+		if (!(c = _stats_parse_row(row, vals))) {
+			log_error("Could not parse @stats_print row.");
+			return 0;
+		}
+
+		if (area == nr_areas)
+			break;
+
+		_stats_set_counters(&region->counters[area++], vals,
+				    region->timescale);
+
+		while (*c && (*c++ != '\n'))
+			;
+	}
+
+	if (area != nr_areas) {
+		log_error("Region " FMTu64 " changed size since it was populated.",
+			  region->region_id);
+		return 0;
+	}
+
+	dms->aggr_gen++;
+
+	if (!dms->sample_history)
+		return 1;
+
+	if (!region->samples &&
+	    !(region->samples = dm_malloc(dms->sample_history * nr_areas *
+					  sizeof(*region->samples)))) {
+		log_error("Could not allocate sample history.");
+		return 0;
+	}
+
+	memcpy(region->samples + region->sample_next * nr_areas,
+	       region->counters, nr_areas * sizeof(*region->samples));
+
+	region->sample_next = (region->sample_next + 1) % dms->sample_history;
+	if (region->nr_samples < dms->sample_history)
+		region->nr_samples++;
+
+	return 1;
+}
+
+int dm_stats_sample(struct dm_stats *dms)
+{
+	struct dm_stats_region *region;
+	struct dm_task *dmt;
+	const char *resp;
+	uint64_t i;
+	int r;
+
+	if (!_stats_bound(dms))
+		return_0;
+
+	if (!dms->regions) {
+		log_error("Cannot sample empty handle before dm_stats_populate().");
+		return 0;
+	}
+
+	for (i = 0; i <= dms->max_region; i++) {
+		region = &dms->regions[i];
+		if (!_stats_region_present(region))
+			continue;
+
+		if (!region->counters) {
+			log_error("Cannot sample region " FMTu64 " before "
+				  "dm_stats_populate().", region->region_id);
+			return 0;
+		}
+
+		if (!(dmt = _stats_print_region(dms, region->region_id, 0, 0, 1)))
+			return_0;
+
+		if (!(resp = dm_task_get_message_response(dmt)))
+			resp = "";
+
+		r = _stats_sample_region(dms, region, resp);
+		dm_task_destroy(dmt);
+
+		if (!r)
+			return_0;
+	}
+
+	return 1;
+}
+
 /**
  * destroy a dm_stats object and all associated regions and counter sets.
  */
@@ -2470,11 +2599,72 @@ static uint64_t _stats_get_counter(const struct dm_stats *dms,
 	return 0;
 }
 
+/*
+ * Add the counters of one area to an aggregate.  Kept as a flat run of
+ * independent additions so that the compiler can vectorise it.
+ */
+static void _stats_counters_add(struct dm_stats_counters *sum,
+				const struct dm_stats_counters *area)
+{
+	sum->reads += area->reads;
+	sum->reads_merged += area->reads_merged;
+	sum->read_sectors += area->read_sectors;
+	sum->read_nsecs += area->read_nsecs;
+	sum->writes += area->writes;
+	sum->writes_merged += area->writes_merged;
+	sum->write_sectors += area->write_sectors;
+	sum->write_nsecs += area->write_nsecs;
+	sum->io_in_progress += area->io_in_progress;
+	sum->io_nsecs += area->io_nsecs;
+	sum->weighted_io_nsecs += area->weighted_io_nsecs;
+	sum->total_read_nsecs += area->total_read_nsecs;
+	sum->total_write_nsecs += area->total_write_nsecs;
+}
+
+/*
+ * Return the sum of all areas of a region.  Every metric and counter
+ * read for an aggregate needs the same sums, so they are computed once
+ * and cached until the counters or groups of the handle next change.
+ */
+static const struct dm_stats_counters *_stats_region_sum(const struct dm_stats *dms,
+							 uint64_t region_id)
+{
+	struct dm_stats_region *region = &dms->regions[region_id];
+	uint64_t j;
+
+	if (region->sum_gen == dms->aggr_gen)
+		return &region->sum;
+
+	memset(&region->sum, 0, sizeof(region->sum));
+	_foreach_region_area(dms, region_id, j)
+		_stats_counters_add(&region->sum, &region->counters[j]);
+	region->sum_gen = dms->aggr_gen;
+
+	return &region->sum;
+}
+
+static const struct dm_stats_counters *_stats_group_sum(const struct dm_stats *dms,
+							uint64_t group_id)
+{
+	struct dm_stats_group *group = &dms->groups[group_id];
+	uint64_t i;
+
+	if (group->sum_gen == dms->aggr_gen)
+		return &group->sum;
+
+	memset(&group->sum, 0, sizeof(group->sum));
+	_foreach_group_region(dms, group_id, i)
+		_stats_counters_add(&group->sum, _stats_region_sum(dms, i));
+	group->sum_gen = dms->aggr_gen;
+
+	return &group->sum;
+}
+
 uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 			      dm_stats_counter_t counter,
 			      uint64_t region_id, uint64_t area_id)
 {
-	uint64_t i, j, sum = 0; /* aggregation */
+	uint64_t i, sum = 0; /* aggregation */
 	int sum_regions = 0;
 	struct dm_stats_region *region;
 	struct dm_stats_counters *area;
@@ -2503,10 +2693,8 @@ uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 	if (_stats_region_is_grouped(dms, region_id) && (sum_regions)) {
 		/* group */
 		if (area_id & DM_STATS_WALK_GROUP)
-			_foreach_group_area(dms, region->group_id, i, j) {
-				area = &dms->regions[i].counters[j];
-				sum += _stats_get_counter(dms, area, counter);
-			}
+			sum = _stats_get_counter(dms, _stats_group_sum(dms, region->group_id),
+						 counter);
 		else
 			_foreach_group_region(dms, region->group_id, i) {
 				area = &dms->regions[i].counters[area_id];
@@ -2514,10 +2702,7 @@ uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 			}
 	} else if (area_id == DM_STATS_WALK_REGION) {
 		/* aggregate region */
-		_foreach_region_area(dms, region_id, j) {
-			area = &dms->regions[region_id].counters[j];
-			sum += _stats_get_counter(dms, area, counter);
-		}
+		sum = _stats_get_counter(dms, _stats_region_sum(dms, region_id), counter);
 	} else {
 		/* plain region / area */
 		area = &region->counters[area_id];
@@ -2527,6 +2712,56 @@ uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 	return sum;
 }
 
+unsigned dm_stats_get_nr_samples(const struct dm_stats *dms,
+				 uint64_t region_id)
+{
+	region_id = (region_id == DM_STATS_REGION_CURRENT)
+		     ? dms->cur_region : region_id ;
+
+	if (!dm_stats_region_present(dms, region_id))
+		return 0;
+
+	return dms->regions[region_id].nr_samples;
+}
+
+uint64_t dm_stats_get_sample_counter(const struct dm_stats *dms,
+				     dm_stats_counter_t counter,
+				     uint64_t region_id, uint64_t area_id,
+				     unsigned age)
+{
+	const struct dm_stats_region *region;
+	const struct dm_stats_counters *sample;
+	uint64_t j, nr_areas, sum = 0;
+	unsigned slot;
+
+	region_id = (region_id == DM_STATS_REGION_CURRENT)
+		     ? dms->cur_region : region_id ;
+	area_id = (area_id == DM_STATS_REGION_CURRENT)
+		   ? dms->cur_area : area_id ;
+
+	if (age >= dm_stats_get_nr_samples(dms, region_id))
+		return 0;
+
+	region = &dms->regions[region_id];
+	nr_areas = _nr_areas(region->len, region->step);
+
+	/* age 0 is the slot most recently filled */
+	slot = (region->sample_next + dms->sample_history - 1 - age)
+		% dms->sample_history;
+	sample = region->samples + slot * nr_areas;
+
+	if (area_id == DM_STATS_WALK_REGION) {
+		for (j = 0; j < nr_areas; j++)
+			sum += _stats_get_counter(dms, &sample[j], counter);
+		return sum;
+	}
+
+	if (area_id >= nr_areas)
+		return 0;
+
+	return _stats_get_counter(dms, &sample[area_id], counter);
+}
+
 /*
  * Methods for accessing named counter fields. All methods share the
  * following naming scheme and prototype:
@@ -4476,17 +4711,34 @@ bad:
 	return NULL;
 }
 
-#define MATCH_EXTENT(e, s, l) \
-(((e).start == (s)) && ((e).len == (l)))
+/* Order extents by start, then by length. */
+static int _extent_compare(const void *p1, const void *p2)
+{
+	const struct _extent *r1 = (const struct _extent *) p1;
+	const struct _extent *r2 = (const struct _extent *) p2;
 
+	if (r1->start != r2->start)
+		return (r1->start < r2->start) ? -1 : 1;
+	if (r1->len != r2->len)
+		return (r1->len < r2->len) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Look up an extent in a table sorted with _extent_compare(). Large,
+ * fragmented files may have many thousands of extents so a linear scan
+ * for every old and new extent would make updates quadratic.
+ */
 static struct _extent *_find_extent(uint64_t nr_extents, struct _extent *extents,
 				    uint64_t start, uint64_t len)
 {
-	size_t i;
-	for (i = 0; i < nr_extents; i++)
-		if (MATCH_EXTENT(extents[i], start, len))
-			return extents + i;
-	return NULL;
+	struct _extent key = { .start = start, .len = len };
+
+	if (!nr_extents)
+		return NULL;
+
+	return bsearch(&key, extents, nr_extents, sizeof(*extents),
+		       _extent_compare);
 }
 
 /*
@@ -4516,6 +4768,7 @@ static int _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
 {
 	struct dm_stats_region *region = NULL;
 	struct dm_stats_group *group = NULL;
+	struct _extent *sorted = NULL;
 	uint64_t nr_kept, nr_old;
 	struct _extent ext;
 	int64_t i;
@@ -4525,6 +4778,16 @@ static int _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
 	log_very_verbose("Checking for changed file extents in group ID "
 			 FMTu64, group_id);
 
+	/* Sorted copy of the new extents; the original keeps file order. */
+	if (extents && *count) {
+		if (!(sorted = dm_pool_alloc(mem, *count * sizeof(*sorted)))) {
+			log_error("Could not allocate extent table.");
+			return -1;
+		}
+		memcpy(sorted, extents, *count * sizeof(*sorted));
+		qsort(sorted, *count, sizeof(*sorted), _extent_compare);
+	}
+
 	if (!dm_pool_begin_object(mem, sizeof(**old_extents))) {
 		log_error("Could not allocate extent table.");
 		return 0;
@@ -4541,8 +4804,8 @@ static int _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
 		region = &dms->regions[i];
 		nr_old++;
 
-		if (extents && _find_extent(*count, extents,
-				  region->start, region->len)) {
+		if (sorted && _find_extent(*count, sorted,
+					   region->start, region->len)) {
 			ext.start = region->start;
 			ext.len = region->len;
 			ext.id = i;
@@ -4572,6 +4835,9 @@ static int _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
 		log_error("Could not finalize region extent table.");
 		goto out;
 	}
+
+	/* Searched for each new extent by _stats_map_file_regions(). */
+	qsort(*old_extents, nr_kept, sizeof(**old_extents), _extent_compare);
 	log_very_verbose("Kept " FMTd64 " of " FMTd64 " old extents",
 			 nr_kept, nr_old);
 	log_very_verbose("Found " FMTu64 " new extents",
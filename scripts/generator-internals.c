@@ -219,3 +219,106 @@ static bool _get_config(struct config *cfg, const char *lvmconfig_path)
 
 	return r;
 }
+
+//----------------------------------------------------------------
+// VGs named on the kernel command line
+//
+// rd.lvm.vg=<vg> and rd.lvm.lv=<vg>/<lv> name the VGs the boot needs.
+// When any are given, the early unit activates only those VGs, which
+// lets vgchange limit its scan to their devices, and everything else
+// is left to the later units.
+
+#define BOOT_VGS_MAX		32
+#define BOOT_VG_NAME_LEN	128
+
+struct boot_vgs {
+	unsigned count;
+	char names[BOOT_VGS_MAX][BOOT_VG_NAME_LEN];
+};
+
+static bool _valid_vg_name(const char *name, size_t len)
+{
+	size_t i;
+
+	if (!len || len >= BOOT_VG_NAME_LEN || *name == '-')
+		return false;
+
+	for (i = 0; i < len; i++)
+		if (!isalnum((unsigned char) name[i]) &&
+		    name[i] != '+' && name[i] != '_' && name[i] != '.' && name[i] != '-')
+			return false;
+
+	return true;
+}
+
+static void _add_boot_vg(struct boot_vgs *vgs, const char *name, size_t len)
+{
+	unsigned i;
+
+	if (!_valid_vg_name(name, len)) {
+		_error("ignoring invalid VG name '%.*s' on kernel command line\n", (int) len, name);
+		return;
+	}
+
+	for (i = 0; i < vgs->count; i++)
+		if (!strncmp(vgs->names[i], name, len) && !vgs->names[i][len])
+			return;
+
+	if (vgs->count == BOOT_VGS_MAX) {
+		_error("too many VGs on kernel command line, ignoring '%.*s'\n", (int) len, name);
+		return;
+	}
+
+	memcpy(vgs->names[vgs->count], name, len);
+	vgs->names[vgs->count++][len] = '\0';
+}
+
+static void _parse_boot_vgs(const char *cmdline, struct boot_vgs *vgs)
+{
+	const char *b = cmdline, *e, *val;
+	size_t len;
+
+	vgs->count = 0;
+
+	while (*b) {
+		while (*b && isspace(*b))
+			b++;
+
+		e = b;
+		while (*e && !isspace(*e))
+			e++;
+
+		if (_begins_with(b, "rd.lvm.vg=", &val) && (val <= e))
+			_add_boot_vg(vgs, val, e - val);
+
+		else if (_begins_with(b, "rd.lvm.lv=", &val) && (val <= e)) {
+			// Only the VG part of <vg>/<lv> matters
+			for (len = 0; (val + len < e) && (val[len] != '/'); len++)
+				;
+			_add_boot_vg(vgs, val, len);
+		}
+
+		b = e;
+	}
+}
+
+static bool _get_boot_vgs(struct boot_vgs *vgs, const char *cmdline_path)
+{
+	char buffer[4096];
+	FILE *fp;
+	bool r = true;
+
+	vgs->count = 0;
+
+	if (!(fp = fopen(cmdline_path, "r")))
+		return false;
+
+	if (fgets(buffer, sizeof(buffer), fp))
+		_parse_boot_vgs(buffer, vgs);
+	else
+		r = false;
+
+	(void) fclose(fp);
+
+	return r;
+}
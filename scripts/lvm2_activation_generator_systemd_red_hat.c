@@ -58,9 +58,12 @@ static void _error(const char *format, ...)
 #define UNIT_TARGET_LOCAL_FS  "local-fs-pre.target"
 #define UNIT_TARGET_REMOTE_FS "remote-fs-pre.target"
 
+#define PROC_CMDLINE_PATH "/proc/cmdline"
+
 struct generator {
 	const char *dir;
 	struct config cfg;
+	struct boot_vgs boot_vgs;
 
 	int kmsg_fd;
 	char unit_path[PATH_MAX];
@@ -119,6 +122,7 @@ static int generate_unit(struct generator *gen, int unit)
 	const char *unit_name = _unit_names[unit];
 	const char *target_name =
 	    unit == UNIT_NET ? UNIT_TARGET_REMOTE_FS : UNIT_TARGET_LOCAL_FS;
+	unsigned i;
 
 	if (dm_snprintf(gen->unit_path, PATH_MAX, "%s/%s", gen->dir, unit_name)
 	    < 0)
@@ -157,9 +161,17 @@ static int generate_unit(struct generator *gen, int unit)
 		      "Wants=systemd-udev-settle.service\n\n" "[Service]\n", f);
 	}
 
-	fputs("ExecStart=" LVM_PATH " vgchange -aay", f);
+	// Early boot only waits for the VGs it was told it needs.  Those
+	// may not exist in the real root, which must not fail the unit.
+	if ((unit == UNIT_EARLY) && gen->boot_vgs.count)
+		fputs("ExecStart=-" LVM_PATH " vgchange -aay", f);
+	else
+		fputs("ExecStart=" LVM_PATH " vgchange -aay", f);
 	if (gen->cfg.sysinit_needed)
 		fputs(" --sysinit", f);
+	if (unit == UNIT_EARLY)
+		for (i = 0; i < gen->boot_vgs.count; i++)
+			fprintf(f, " %s", gen->boot_vgs.names[i]);
 	fputs("\nType=oneshot\n", f);
 
 	if (fclose(f) < 0) {
@@ -208,6 +220,9 @@ static bool _run(int argc, const char **argv)
 	 *    - _get_config failed, then this is a failsafe fallback
 	 */
 
+	if (!_get_boot_vgs(&gen.boot_vgs, PROC_CMDLINE_PATH))
+		gen.boot_vgs.count = 0;
+
 	/* mark lvm2-activation.*.service as world-accessible */
 	old_mask = umask(0022);
 
@@ -0,0 +1,66 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Time metadata handling and activation of a VG with many LVs
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+test -n "$LVM_TEST_BENCH" || skip "Benchmarks run with make bench"
+
+# Use LVM_TEST_BENCH_LVS=50000 for the large variant
+BENCH_LVS=${LVM_TEST_BENCH_LVS:-10000}
+BENCH_PVS=${LVM_TEST_BENCH_PVS:-4}
+
+# One 128K extent per LV, with metadata areas large enough for two copies
+aux prepare_devs "$BENCH_PVS" $(( BENCH_LVS / (8 * BENCH_PVS) + BENCH_LVS / 512 + 16 ))
+get_devs
+
+vgcreate -q $SHARED -s 128K --metadatasize $(( BENCH_LVS + 1024 ))k "$vg" "${DEVICES[@]}"
+
+vgcfgbackup -f data $vg
+
+# Generate LVs of one extent each, spread over the PVs
+awk -v LVS="$BENCH_LVS" -v PVS="$BENCH_PVS" '/^\t\}/ {
+    printf("\t}\n\tlogical_volumes {\n");
+    for (i = 0; i < LVS; i++) {
+	printf("\t\tlvol%06d  {\n", i);
+	printf("\t\t\tid = \"%06d-1111-2222-3333-2222-1111-%06d\"\n", i, i);
+	print "\t\t\tstatus = [\"READ\", \"WRITE\", \"VISIBLE\"]";
+	print "\t\t\tsegment_count = 1";
+	print "\t\t\tsegment1 {";
+	print "\t\t\t\tstart_extent = 0";
+	print "\t\t\t\textent_count = 1";
+	print "\t\t\t\ttype = \"striped\"";
+	print "\t\t\t\tstripe_count = 1";
+	print "\t\t\t\tstripes = [";
+	printf("\t\t\t\t\t\"pv%d\", %d\n", i % PVS, int(i / PVS));
+	printf("\t\t\t\t]\n\t\t\t}\n\t\t}\n");
+      }
+  }
+  {print}
+' data >data_new
+
+aux bench vgcfgrestore vgcfgrestore -f data_new $vg
+
+aux bench vgs vgs --timing $vg
+aux bench lvs lvs --timing $vg
+aux bench lvs_fields lvs -o+seg_pe_ranges,devices $vg
+aux bench lvcreate lvcreate -an -l1 -n $lv1 $vg
+aux bench lvremove lvremove -f $vg/$lv1
+aux bench vgchange_ay vgchange --timing -ay $vg
+aux bench lvs_active lvs $vg
+aux bench vgchange_an vgchange --timing -an $vg
+
+vgremove -ff $vg
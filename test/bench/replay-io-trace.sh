@@ -0,0 +1,88 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Replay the device population and latencies of an io trace recorded
+# with LVM_IO_TRACE on another host:
+#
+#   LVM_IO_TRACE=/tmp/trace pvs	(on the slow host)
+#   LVM_TEST_IO_TRACE_REPLAY=/tmp/trace make bench
+#
+# A device is created for each traced device, and a PV where the trace
+# found a label.  The traced reporting commands are rerun without their
+# arguments, as the names they used do not exist here, with the mean
+# latency of each device simulated by LVM_TEST_IO_DELAY.  The replay
+# is traced again into replay.trace for comparison.
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+test -n "$LVM_TEST_BENCH" || skip "Benchmarks run with make bench"
+test -f "$LVM_TEST_IO_TRACE_REPLAY" || skip "Set LVM_TEST_IO_TRACE_REPLAY to a trace"
+
+TRACE=$LVM_TEST_IO_TRACE_REPLAY
+
+# "<dev> <mean latency us> <label>" in order of first use
+awk '!/^#/ {
+	if (!($2 in n)) order[nr++] = $2
+	n[$2]++; lat[$2] += $6
+	if ($9 == "L") label[$2] = 1
+} END {
+	for (i = 0; i < nr; i++)
+		print order[i], int(lat[order[i]] / n[order[i]]), label[order[i]] + 0
+}' "$TRACE" > trace_devs
+
+BENCH_PVS=$(awk '$3' trace_devs | wc -l)
+BENCH_LVS=0
+test "$BENCH_PVS" -gt 0 || skip "No labels in trace"
+
+aux prepare_devs "$(wc -l < trace_devs)" 4
+get_devs
+
+# Map traced devices onto ours, in order, keeping the slowest rules
+i=0
+pvs=()
+rules=()
+while read -r dev lat label; do
+	test "$label" = 0 || pvs+=( "${DEVICES[$i]}" )
+	read -r maj min < <(stat -L -c '%t %T' "${DEVICES[$i]}")
+	rules+=( "$lat dev=$(( 0x$maj )):$(( 0x$min ))/$lat" )
+	i=$(( i + 1 ))
+done < trace_devs
+
+vgcreate -q $SHARED "$vg" "${pvs[@]}"
+
+mean=$(awk '{ s += $2 } END { print int(s / NR) }' trace_devs)
+spec="latency=$mean,dist=exp,seed=1"
+for r in $(printf "%s\n" "${rules[@]}" | sort -rn | head -64 | cut -d' ' -f2); do
+	spec="$spec,$r"
+done
+
+export LVM_TEST_IO_DELAY=$spec
+export LVM_IO_TRACE=$PWD/replay.trace
+
+step=0
+awk '/^# pid [0-9]+ cmd / { print $5, $6 }' "$TRACE" | while read -r cmd sub; do
+	cmd=${cmd##*/}
+	test "$cmd" = lvm && cmd=$sub
+	case "$cmd" in
+	pvs|vgs|lvs|pvscan|vgscan|lvscan|pvdisplay|vgdisplay|lvdisplay)
+		step=$(( step + 1 ))
+		aux bench "replay_${step}_$cmd" "$cmd" ;;
+	*)
+		echo "## skipping traced command $cmd" ;;
+	esac
+done
+
+unset LVM_TEST_IO_DELAY LVM_IO_TRACE
+vgremove -ff $vg
@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Time scanning and metadata commits with simulated SAN latency, so
+# results depend on how well io is pipelined rather than on the host.
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+test -n "$LVM_TEST_BENCH" || skip "Benchmarks run with make bench"
+
+BENCH_PVS=${LVM_TEST_BENCH_PVS:-200}
+BENCH_LVS=0
+
+aux prepare_devs "$BENCH_PVS" 4
+get_devs
+
+vgcreate -q $SHARED "$vg" "${DEVICES[@]}"
+
+# 2ms per io, exponentially distributed, with a fixed seed
+export LVM_TEST_IO_DELAY="latency=2000,dist=exp,seed=1"
+aux bench delayed_scan pvs -o pv_name
+aux bench delayed_commit lvcreate -an -l1 -n $lv1 $vg
+
+# Same with a shallow queue and limited bandwidth
+export LVM_TEST_IO_DELAY="latency=2000,dist=exp,seed=1,max_io=4,bw=65536"
+aux bench delayed_scan_qd4 pvs -o pv_name
+aux bench delayed_commit_qd4 lvremove -f $vg/$lv1
+
+unset LVM_TEST_IO_DELAY
+vgremove -ff $vg
@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Time device scanning and pvscan autoactivation with many PVs
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+test -n "$LVM_TEST_BENCH" || skip "Benchmarks run with make bench"
+
+# Number of PVs, plus as many non-PV devices to be filtered and scanned
+BENCH_PVS=${LVM_TEST_BENCH_PVS:-1000}
+BENCH_LVS=0
+
+aux prepare_devs $(( BENCH_PVS * 2 )) 4
+get_devs
+
+pvcreate -q "${DEVICES[@]:0:$BENCH_PVS}"
+vgcreate -q $SHARED "$vg" "${DEVICES[@]:0:$BENCH_PVS}"
+lvcreate -an -l1 -n $lv1 $vg
+
+aux bench label_scan pvs --timing -o pv_name
+aux bench vgs vgs --timing
+aux bench pvs_all pvs -a
+aux bench vgck vgck $vg
+
+# Autoactivation path as run from udev for each PV
+aux lvmconf "global/event_activation = 1"
+aux bench pvscan_cache pvscan --cache
+aux bench pvscan_aay pvscan --cache -aay "${DEVICES[0]}"
+check active $vg $lv1
+
+vgchange -an $vg
+vgremove -ff $vg
@@ -234,6 +234,29 @@ prepare_lvmpolld() {
 	echo ok
 }
 
+prepare_lvmcached() {
+	lvmconf "global/use_lvmcached = 1"
+
+	kill_sleep_kill_ LOCAL_LVMCACHED 0
+
+	export LVM_LVMCACHED_SOCKET="$TESTDIR/lvmcached.socket"
+
+	echo -n "## preparing lvmcached..."
+	lvmcached -f "$@" -s "$LVM_LVMCACHED_SOCKET" -p "$TESTDIR/lvmcached.pid" &
+	echo $! > LOCAL_LVMCACHED
+	for i in {200..0} ; do
+		test "$i" -eq 0 && die "Startup of lvmcached is too slow."
+		test -e "$LVM_LVMCACHED_SOCKET" && break
+		echo -n .;
+		sleep .1;
+	done # wait for the socket
+	echo ok
+}
+
+lvmcached_dump() {
+	lvmcached -s "$TESTDIR/lvmcached.socket" --dump | tee -a lvmcached-dump.txt
+}
+
 lvmpolld_talk() {
 	local use=nc
 	if type -p socat >& /dev/null; then
@@ -557,6 +580,10 @@ teardown() {
 
 	echo -n .
 
+	kill_sleep_kill_ LOCAL_LVMCACHED 0
+
+	echo -n .
+
 	kill_sleep_kill_ LOCAL_CLVMD "${LVM_VALGRIND_CLVMD:-0}"
 
 	echo -n .
@@ -1780,6 +1807,25 @@ kernel_at_least() {
 	version_at_least "$(uname -r)" "$@"
 }
 
+# Run a benchmarked step and append its wall time as one json line
+# to LVM_TEST_BENCH_RESULTS (bench.json in the directory make runs in).
+bench() {
+	local step=$1
+	local start
+	local end
+	local out=${LVM_TEST_BENCH_RESULTS:-$TESTOLDPWD/bench.json}
+	shift
+
+	start=$(date +%s%N)
+	"$@"
+	end=$(date +%s%N)
+
+	printf '{"test":"%s","step":"%s","pvs":%d,"lvs":%d,"seconds":%d.%09d}\n' \
+		"${TESTNAME%.sh}" "$step" "${BENCH_PVS:-0}" "${BENCH_LVS:-0}" \
+		$(( (end - start) / 1000000000 )) $(( (end - start) % 1000000000 )) >> "$out"
+	echo "## bench $step: $(( (end - start) / 1000000 )) ms"
+}
+
 test "${LVM_TEST_AUX_TRACE-0}" = "0" || set -x
 
 test -f DEVICES && devs=$(< DEVICES)
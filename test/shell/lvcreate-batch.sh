@@ -0,0 +1,84 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# test creation of several LVs with lvcreate --batchfile
+
+SKIP_WITH_LVMLOCKD=1
+SKIP_WITH_LVMPOLLD=1
+
+export LVM_TEST_THIN_REPAIR_CMD=${LVM_TEST_THIN_REPAIR_CMD-/bin/false}
+
+. lib/inittest
+
+aux prepare_vg 2 64
+
+cat > batch <<EOF
+# linear
+lvol1 1M
+
+  lvol2	2M
+$vg/lvol3 512K
+EOF
+
+lvcreate --batchfile batch $vg
+check lv_field $vg/lvol1 size "1.00m"
+check lv_field $vg/lvol2 size "2.00m"
+check lv_field $vg/lvol3 size "512.00k"
+check active $vg lvol1
+check active $vg lvol3
+
+# Name already used - nothing is created
+printf "lvol4 1M\nlvol1 1M\n" > batch
+not lvcreate --batchfile batch $vg
+check vg_field $vg lv_count 3
+
+# Malformed lines
+echo "lvol5" > batch
+invalid lvcreate --batchfile batch $vg
+echo "lvol5 1M 2M" > batch
+invalid lvcreate --batchfile batch $vg
+echo "lvol5 -1M" > batch
+invalid lvcreate --batchfile batch $vg
+echo "lvol5 1M" > batch
+invalid lvcreate --batchfile batch --name lvol6 $vg
+
+echo "lvol5 1M" | lvcreate -an --batchfile - -i2 $vg
+check lv_field $vg/lvol5 stripes "2"
+check inactive $vg lvol5
+
+lvremove -ff $vg
+
+aux have_thin 1 0 0 || skip
+
+lvcreate -L4M -T $vg/pool
+
+for i in $(seq 1 20); do echo "thin$i ${i}M"; done > batch
+lvcreate --batchfile batch --thinpool pool $vg
+check vg_field $vg lv_count 21
+check lv_field $vg/thin20 size "20.00m"
+check active $vg thin1
+check active $vg thin20
+
+# Thin snapshots of one origin
+for i in $(seq 1 10); do echo "snap$i"; done > batch
+lvcreate -s --batchfile batch $vg/thin1
+check vg_field $vg lv_count 31
+check lv_field $vg/snap10 origin "thin1"
+check lv_field $vg/snap10 size "1.00m"
+check inactive $vg snap1
+lvchange -ay -K $vg/snap5
+
+# Snapshot lines carry no size
+echo "snap11 1M" > batch
+invalid lvcreate -s --batchfile batch $vg/thin1
+
+vgremove -ff $vg
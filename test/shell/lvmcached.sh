@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Metadata put into lvmcached comes back unchanged on the next read
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+test -x "$TESTDIR/lib/lvmcached" || skip
+
+aux prepare_devs 2
+aux prepare_lvmcached
+
+vgcreate $vg "$dev1" "$dev2"
+lvcreate -l1 -n $lv1 $vg
+
+# A read that misses puts the text read from disk
+vgs $vg
+aux lvmcached_dump > dump
+grep "entries=[1-9]" dump
+
+# Next read is served from lvmcached, checksum and size verified
+lvs -vvvv $vg 2> err
+grep "Using metadata from lvmcached" err
+check lv_exists $vg $lv1
+aux lvmcached_dump > dump
+grep "hits=[1-9]" dump
+
+# A metadata change is a new checksum, never a stale hit
+lvcreate -l1 -n $lv2 $vg
+check lv_exists $vg $lv1 $lv2
+
+vgremove -ff $vg
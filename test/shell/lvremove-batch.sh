@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# test lvremove of several LVs commits VG metadata once
+
+SKIP_WITH_LVMLOCKD=1
+SKIP_WITH_LVMPOLLD=1
+
+export LVM_TEST_THIN_REPAIR_CMD=${LVM_TEST_THIN_REPAIR_CMD-/bin/false}
+
+. lib/inittest
+
+aux prepare_vg 2 64
+
+for i in 1 2 3 4; do lvcreate -L1M -n lvol$i $vg; done
+lvchange -an $vg/lvol4
+
+SEQNO=$(get vg_field $vg seqno)
+lvremove -f $vg/lvol1 $vg/lvol2 $vg/lvol4 2>&1 | tee out
+test "$(grep -c "successfully removed" out)" -eq 3
+check vg_field $vg lv_count 1
+check vg_field $vg seqno $(( SEQNO + 1 ))
+
+# Nothing to remove, nothing to commit
+SEQNO=$(get vg_field $vg seqno)
+not lvremove -f $vg/lvol1
+check vg_field $vg seqno "$SEQNO"
+
+lvremove -f $vg
+
+aux have_thin 1 0 0 || skip
+
+lvcreate -L4M -T $vg/pool
+for i in $(seq 1 10); do lvcreate -V2M -n thin$i $vg/pool; done
+lvcreate -s -n snap $vg/thin1
+
+SEQNO=$(get vg_field $vg seqno)
+lvremove -f -S 'name=~thin'
+check vg_field $vg lv_count 2
+check vg_field $vg seqno $(( SEQNO + 1 ))
+
+# Pool and its remaining thin volume go together
+lvremove -f $vg/pool
+check vg_field $vg lv_count 0
+
+vgremove -ff $vg
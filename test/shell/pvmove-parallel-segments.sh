@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Check pvmove copies several segments at once with
+# activation/pvmove_max_running_segments
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_vg 3 20
+
+aux lvmconf "activation/pvmove_max_running_segments = 3"
+
+for i in 1 2 3 4; do
+	lvcreate -an -Zn -l4 -n $lv$i $vg "$dev1"
+done
+
+# Slowdown writes
+aux delay_dev "$dev2" 0 200 "$(get first_extent_sector "$dev2"):"
+test -e HAVE_DM_DELAY || skip
+
+pvmove -b -i1 "$dev1" "$dev2"
+aux wait_pvmove_lv_ready "$vg-pvmove0"
+
+# Three mirror targets are running, the last segment stays linear
+test "$(dmsetup table "$vg-pvmove0" | grep -c " mirror ")" -eq 3
+test "$(dmsetup table "$vg-pvmove0" | grep -c " linear ")" -eq 1
+
+aux enable_dev "$dev2"
+
+for i in $(seq 1 100); do
+	test -z "$(get lv_field $vg name -a | grep pvmove)" && break
+	sleep .1
+done
+
+check lv_on $vg $lv1 "$dev2"
+check lv_on $vg $lv4 "$dev2"
+
+vgremove -ff $vg
@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# test vgchange -ay activating plain LVs together with stacked ones
+
+SKIP_WITH_LVMLOCKD=1
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux have_raid 1 3 0 || skip
+
+aux prepare_vg 3 64
+
+for i in $(seq 1 10); do lvcreate -an -Zn -l1 -n lin$i $vg; done
+lvcreate -an -Zn -l2 -i2 -n striped $vg
+lvcreate -l1 -n origin $vg
+lvcreate -s -l1 -n snap $vg/origin
+lvcreate -l1 -m1 -n mirr --type raid1 $vg
+vgchange -an $vg
+
+vgchange -ay $vg
+for i in $(seq 1 10); do check active $vg lin$i; done
+check active $vg striped
+check active $vg origin
+check active $vg snap
+check active $vg mirr
+
+# Already active LVs are left alone
+vgchange -ay $vg
+
+vgchange -an $vg
+for i in $(seq 1 10); do check inactive $vg lin$i; done
+
+# Activation filter still applies to batched LVs
+aux lvmconf "activation/volume_list = [ \"$vg/lin1\", \"$vg/lin2\" ]"
+vgchange -ay $vg
+check active $vg lin1
+check active $vg lin2
+check inactive $vg lin3
+check inactive $vg striped
+
+vgremove -ff $vg
@@ -237,6 +237,64 @@ static void _test_get_config(void *fixture)
 	}
 }
 
+struct bv_test {
+	const char *cmdline;
+	const char *vgs[4];
+};
+
+static void _test_parse_boot_vgs(void *fixture)
+{
+	static struct bv_test _tests[] = {
+		{"", {NULL}},
+		{"ro quiet root=/dev/vg0/root", {NULL}},
+		{"rd.lvm.vg=vg0", {"vg0", NULL}},
+		{"ro rd.lvm.lv=vg0/root rd.lvm.lv=vg0/swap\n", {"vg0", NULL}},
+		{"rd.lvm.vg=vg0 rd.lvm.lv=vg1/usr quiet", {"vg0", "vg1", NULL}},
+		{"rd.lvm.vg= rd.lvm.vg=bad;name rd.lvm.vg=-x rd.lvm.vg=ok", {"ok", NULL}},
+		{"rd.lvm.vgx=vg0 xrd.lvm.vg=vg1", {NULL}},
+	};
+
+	struct boot_vgs vgs;
+	unsigned i, j;
+
+	for (i = 0; i < DM_ARRAY_SIZE(_tests); i++) {
+		struct bv_test *t = _tests + i;
+
+		_parse_boot_vgs(t->cmdline, &vgs);
+
+		for (j = 0; t->vgs[j]; j++)
+			if (j >= vgs.count || strcmp(vgs.names[j], t->vgs[j]))
+				test_fail("_parse_boot_vgs('%s') missing '%s'", t->cmdline, t->vgs[j]);
+
+		if (vgs.count != j)
+			test_fail("_parse_boot_vgs('%s') -> %u VGs, expected %u",
+				  t->cmdline, vgs.count, j);
+	}
+}
+
+static void _test_get_boot_vgs(void *fixture)
+{
+	const char *path = "./fake-cmdline";
+	struct boot_vgs vgs;
+	FILE *fp;
+
+	if (_get_boot_vgs(&vgs, "/proc/no-such-file"))
+		test_fail("_get_boot_vgs() succeeded despite a bad cmdline path");
+
+	if (!(fp = fopen(path, "w")))
+		test_fail("couldn't create fake cmdline");
+
+	fprintf(fp, "ro rd.lvm.vg=vg0 rd.lvm.lv=vg1/root quiet\n");
+	fclose(fp);
+
+	if (!_get_boot_vgs(&vgs, path))
+		test_fail("_get_boot_vgs() failed");
+	else if ((vgs.count != 2) || strcmp(vgs.names[0], "vg0") || strcmp(vgs.names[1], "vg1"))
+		test_fail("_get_boot_vgs() -> %u VGs, expected vg0 and vg1", vgs.count);
+
+	unlink(path);
+}
+
 //----------------------------------------------------------------
 
 #define T(path, desc, fn) register_test(ts, "/activation-generator/" path, desc, fn)
@@ -255,6 +313,8 @@ static struct test_suite *_tests(void)
 	T("get-config-bad-path", "_get_config() needs a valid lvmconfig path", _test_get_config_bad_path);
 	T("get-config-bad-exit", "lvmconfig bad exit code gets propagated", _test_get_config_bad_exit);
 	T("get-config", "Test cases for _get_config()", _test_get_config);
+	T("parse-boot-vgs", "Test cases for _parse_boot_vgs()", _test_parse_boot_vgs);
+	T("get-boot-vgs", "_get_boot_vgs() reads the kernel command line", _test_get_boot_vgs);
 
 	return ts;
 }
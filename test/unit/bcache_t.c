@@ -18,6 +18,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #define SHOW_MOCK_CALLS 0
@@ -48,6 +49,7 @@ struct mock_call {
 	enum dir d;
 	int di;
 	block_address b;
+	sector_t nr_sectors;	/* for a read of the head of a block */
 	bool issue_r;
 	bool wait_r;
 };
@@ -94,6 +96,22 @@ static void _expect_read(struct mock_engine *e, int di, block_address b)
 	mc->d = DIR_READ;
 	mc->di = di;
 	mc->b = b;
+	mc->nr_sectors = 0;
+	mc->issue_r = true;
+	mc->wait_r = true;
+	dm_list_add(&e->expected_calls, &mc->list);
+}
+
+static void _expect_read_head(struct mock_engine *e, int di, block_address b,
+			      sector_t nr_sectors)
+{
+	struct mock_call *mc = malloc(sizeof(*mc));
+	mc->m = E_ISSUE;
+	mc->match_args = true;
+	mc->d = DIR_READ;
+	mc->di = di;
+	mc->b = b;
+	mc->nr_sectors = nr_sectors;
 	mc->issue_r = true;
 	mc->wait_r = true;
 	dm_list_add(&e->expected_calls, &mc->list);
@@ -117,6 +135,7 @@ static void _expect_write(struct mock_engine *e, int di, block_address b)
 	mc->d = DIR_WRITE;
 	mc->di = di;
 	mc->b = b;
+	mc->nr_sectors = 0;
 	mc->issue_r = true;
 	mc->wait_r = true;
 	dm_list_add(&e->expected_calls, &mc->list);
@@ -130,6 +149,7 @@ static void _expect_read_bad_issue(struct mock_engine *e, int di, block_address
 	mc->d = DIR_READ;
 	mc->di = di;
 	mc->b = b;
+	mc->nr_sectors = 0;
 	mc->issue_r = false;
 	mc->wait_r = true;
 	dm_list_add(&e->expected_calls, &mc->list);
@@ -143,6 +163,7 @@ static void _expect_write_bad_issue(struct mock_engine *e, int di, block_address
 	mc->d = DIR_WRITE;
 	mc->di = di;
 	mc->b = b;
+	mc->nr_sectors = 0;
 	mc->issue_r = false;
 	mc->wait_r = true;
 	dm_list_add(&e->expected_calls, &mc->list);
@@ -156,6 +177,7 @@ static void _expect_read_bad_wait(struct mock_engine *e, int di, block_address b
 	mc->d = DIR_READ;
 	mc->di = di;
 	mc->b = b;
+	mc->nr_sectors = 0;
 	mc->issue_r = true;
 	mc->wait_r = false;
 	dm_list_add(&e->expected_calls, &mc->list);
@@ -169,6 +191,7 @@ static void _expect_write_bad_wait(struct mock_engine *e, int di, block_address
 	mc->d = DIR_WRITE;
 	mc->di = di;
 	mc->b = b;
+	mc->nr_sectors = 0;
 	mc->issue_r = true;
 	mc->wait_r = false;
 	dm_list_add(&e->expected_calls, &mc->list);
@@ -240,7 +263,10 @@ static bool _mock_issue(struct io_engine *e, enum dir d, int di,
 		T_ASSERT(d == mc->d);
 		T_ASSERT(di == mc->di);
 		T_ASSERT(sb == mc->b * me->block_size);
-		T_ASSERT(se == (mc->b + 1) * me->block_size);
+		if (mc->nr_sectors)
+			T_ASSERT(se == mc->b * me->block_size + mc->nr_sectors);
+		else
+			T_ASSERT(se == (mc->b + 1) * me->block_size);
 	}
 	r = mc->issue_r;
 	wait_r = mc->wait_r;
@@ -296,6 +322,8 @@ static struct mock_engine *_mock_create(unsigned max_io, sector_t block_size)
 	m->e.issue = _mock_issue;
 	m->e.wait = _mock_wait;
 	m->e.max_io = _mock_max_io;
+	m->e.register_buffer = NULL;
+	m->e.issue_vec = NULL;
 
 	m->max_io = max_io;
 	m->block_size = block_size;
@@ -313,7 +341,8 @@ struct fixture {
 	struct bcache *cache;
 };
 
-static struct fixture *_fixture_init(sector_t block_size, unsigned nr_cache_blocks)
+static struct fixture *_fixture_init(sector_t block_size, unsigned nr_cache_blocks,
+				     enum bcache_policy policy)
 {
 	struct fixture *f = malloc(sizeof(*f));
 
@@ -321,7 +350,7 @@ static struct fixture *_fixture_init(sector_t block_size, unsigned nr_cache_bloc
 	T_ASSERT(f->me);
 
 	_expect(f->me, E_MAX_IO);
-	f->cache = bcache_create(block_size, nr_cache_blocks, &f->me->e);
+	f->cache = bcache_create(block_size, nr_cache_blocks, &f->me->e, policy);
 	T_ASSERT(f->cache);
 
 	return f;
@@ -337,7 +366,12 @@ static void _fixture_exit(struct fixture *f)
 
 static void *_small_fixture_init(void)
 {
-	return _fixture_init(128, 16);
+	return _fixture_init(128, 16, BCACHE_POLICY_LRU);
+}
+
+static void *_small_2q_fixture_init(void)
+{
+	return _fixture_init(128, 16, BCACHE_POLICY_2Q);
 }
 
 static void _small_fixture_exit(void *context)
@@ -347,7 +381,7 @@ static void _small_fixture_exit(void *context)
 
 static void *_large_fixture_init(void)
 {
-	return _fixture_init(128, 1024);
+	return _fixture_init(128, 1024, BCACHE_POLICY_LRU);
 }
 
 static void _large_fixture_exit(void *context)
@@ -367,7 +401,7 @@ static void good_create(sector_t block_size, unsigned nr_cache_blocks)
 	struct mock_engine *me = _mock_create(16, 128);
 
 	_expect(me, E_MAX_IO);
-	cache = bcache_create(block_size, nr_cache_blocks, &me->e);
+	cache = bcache_create(block_size, nr_cache_blocks, &me->e, BCACHE_POLICY_LRU);
 	T_ASSERT(cache);
 
 	_expect(me, E_DESTROY);
@@ -380,7 +414,7 @@ static void bad_create(sector_t block_size, unsigned nr_cache_blocks)
 	struct mock_engine *me = _mock_create(16, 128);
 
 	_expect(me, E_MAX_IO);
-	cache = bcache_create(block_size, nr_cache_blocks, &me->e);
+	cache = bcache_create(block_size, nr_cache_blocks, &me->e, BCACHE_POLICY_LRU);
 	T_ASSERT(!cache);
 
 	_expect(me, E_DESTROY);
@@ -415,6 +449,96 @@ static void test_block_size_must_be_multiple_of_page_size(void *fixture)
 		good_create(i * 8, 16);
 }
 
+static double _now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void test_delay_engine_holds_completion(void *fixture)
+{
+	struct mock_engine *me = _mock_create(16, 128);
+	struct io_engine *e;
+	struct bcache *cache;
+	struct block *b;
+	double start;
+
+	T_ASSERT(e = create_delay_io_engine(&me->e, "latency=20000,max_io=4"));
+
+	_expect(me, E_MAX_IO);
+	T_ASSERT(cache = bcache_create(128, 16, e, BCACHE_POLICY_LRU));
+	T_ASSERT_EQUAL(bcache_max_prefetches(cache), 4);
+
+	start = _now();
+	_expect_read(me, 17, 0);
+	_expect(me, E_WAIT);
+	T_ASSERT(bcache_get(cache, 17, 0, 0, &b));
+	T_ASSERT(_now() - start >= 0.02);
+	bcache_put(b);
+
+	_expect(me, E_DESTROY);
+	bcache_destroy(cache);
+}
+
+static void test_delay_engine_bad_spec(void *fixture)
+{
+	struct mock_engine *me = _mock_create(16, 128);
+
+	T_ASSERT(!create_delay_io_engine(&me->e, "latency"));
+	T_ASSERT(!create_delay_io_engine(&me->e, "dist=normal"));
+	T_ASSERT(!create_delay_io_engine(&me->e, "fail=8:0"));
+
+	_expect(me, E_DESTROY);
+	me->e.destroy(&me->e);
+}
+
+static void test_trace_engine_records_io(void *fixture)
+{
+	struct mock_engine *me = _mock_create(16, 128);
+	char path[] = "/tmp/bcache_trace_XXXXXX";
+	char line[256], dir;
+	unsigned long long t, offset, len, lat;
+	unsigned major, minor;
+	struct io_engine *e;
+	struct bcache *cache;
+	struct block *b;
+	FILE *fp;
+	int fd, err;
+
+	T_ASSERT((fd = mkstemp(path)) >= 0);
+	close(fd);
+
+	T_ASSERT(e = create_trace_io_engine(&me->e, path));
+
+	_expect(me, E_MAX_IO);
+	T_ASSERT(cache = bcache_create(128, 16, e, BCACHE_POLICY_LRU));
+
+	_expect_read(me, 17, 1);
+	_expect(me, E_WAIT);
+	T_ASSERT(bcache_get(cache, 17, 1, 0, &b));
+	bcache_put(b);
+
+	_expect(me, E_DESTROY);
+	bcache_destroy(cache);
+
+	T_ASSERT(fp = fopen(path, "r"));
+	T_ASSERT(fgets(line, sizeof(line), fp));
+	T_ASSERT(!strncmp(line, "# pid ", 6));
+	T_ASSERT(fgets(line, sizeof(line), fp));
+	T_ASSERT_EQUAL(sscanf(line, "%llu %u:%u %c %llu %llu %llu %d",
+			      &t, &major, &minor, &dir, &offset, &len, &lat, &err), 8);
+	T_ASSERT_EQUAL(dir, 'r');
+	T_ASSERT_EQUAL(offset, 128 << 9);
+	T_ASSERT_EQUAL(len, 128 << 9);
+	T_ASSERT_EQUAL(err, 0);
+	T_ASSERT(!fgets(line, sizeof(line), fp));
+	fclose(fp);
+	unlink(path);
+}
+
 static void test_get_triggers_read(void *context)
 {
 	struct fixture *f = context;
@@ -487,6 +611,255 @@ static void test_block_gets_evicted_with_many_reads(void *context)
 	}
 }
 
+static void test_grow_keeps_blocks(void *context)
+{
+	struct fixture *f = context;
+	const unsigned nr_cache_blocks = 16;
+
+	int di = 17;   // arbitrary key
+	unsigned i;
+	struct block *b;
+
+	for (i = 0; i < nr_cache_blocks; i++) {
+		_expect_read(f->me, di, i);
+		_expect(f->me, E_WAIT);
+		T_ASSERT(bcache_get(f->cache, di, i, 0, &b));
+		bcache_put(b);
+	}
+
+	_expect(f->me, E_MAX_IO);
+	T_ASSERT(bcache_grow(f->cache, 2 * nr_cache_blocks));
+	T_ASSERT_EQUAL(bcache_nr_cache_blocks(f->cache), 2 * nr_cache_blocks);
+
+	// Shrinking is a no-op
+	T_ASSERT(bcache_grow(f->cache, nr_cache_blocks));
+
+	for (i = nr_cache_blocks; i < 2 * nr_cache_blocks; i++) {
+		_expect_read(f->me, di, i);
+		_expect(f->me, E_WAIT);
+		T_ASSERT(bcache_get(f->cache, di, i, 0, &b));
+		bcache_put(b);
+	}
+
+	// Nothing was evicted, so no more io
+	for (i = 0; i < 2 * nr_cache_blocks; i++) {
+		T_ASSERT(bcache_get(f->cache, di, i, 0, &b));
+		bcache_put(b);
+	}
+}
+
+/* Read each block once, as label scanning does. */
+static void _read_once(struct fixture *f, int di, unsigned count)
+{
+	unsigned i;
+	struct block *b;
+
+	for (i = 0; i < count; i++) {
+		_expect_read(f->me, di, i);
+		_expect(f->me, E_WAIT);
+		T_ASSERT(bcache_get(f->cache, di, i, 0, &b));
+		bcache_put(b);
+	}
+}
+
+/* Reads block 0 of di twice, so it counts as re-referenced. */
+static void _read_twice(struct fixture *f, int di)
+{
+	struct block *b;
+
+	_expect_read(f->me, di, 0);
+	_expect(f->me, E_WAIT);
+	T_ASSERT(bcache_get(f->cache, di, 0, 0, &b));
+	bcache_put(b);
+
+	T_ASSERT(bcache_get(f->cache, di, 0, 0, &b));
+	bcache_put(b);
+}
+
+/*
+ * Prefetch a batch and then get it, as label scanning does.  Getting
+ * the last block first completes the whole batch, so the others are
+ * got after their prefetch finished.
+ */
+static void _prefetch_scan(struct fixture *f, int di, unsigned count)
+{
+	const unsigned batch = 4;
+	unsigned i, j;
+	struct block *b;
+
+	for (i = 0; i < count; i += batch) {
+		for (j = i; j < i + batch; j++) {
+			_expect_read(f->me, di, j);
+			bcache_prefetch(f->cache, di, j);
+		}
+
+		for (j = 0; j < batch; j++)
+			_expect(f->me, E_WAIT);
+
+		for (j = i + batch; j > i; j--) {
+			T_ASSERT(bcache_get(f->cache, di, j - 1, 0, &b));
+			bcache_put(b);
+		}
+	}
+}
+
+static void test_lru_scan_evicts_hot_block(void *context)
+{
+	struct fixture *f = context;
+	struct block *b;
+
+	_read_twice(f, 1);
+	_read_once(f, 2, 64);
+
+	_expect_read(f->me, 1, 0);
+	_expect(f->me, E_WAIT);
+	T_ASSERT(bcache_get(f->cache, 1, 0, 0, &b));
+	bcache_put(b);
+	_no_outstanding_expectations(f->me);
+}
+
+static void test_2q_hot_block_survives_scan(void *context)
+{
+	struct fixture *f = context;
+	struct block *b;
+
+	_read_twice(f, 1);
+	_read_once(f, 2, 64);
+
+	// no io expected
+	T_ASSERT(bcache_get(f->cache, 1, 0, 0, &b));
+	bcache_put(b);
+	_no_outstanding_expectations(f->me);
+}
+
+static void test_2q_prefetched_scan_stays_cold(void *context)
+{
+	struct fixture *f = context;
+	struct block *b;
+
+	_read_twice(f, 1);
+	_prefetch_scan(f, 2, 64);
+
+	// no io expected, the scanned blocks were evicted first
+	T_ASSERT(bcache_get(f->cache, 1, 0, 0, &b));
+	bcache_put(b);
+
+	_expect_read(f->me, 2, 0);
+	_expect(f->me, E_WAIT);
+	T_ASSERT(bcache_get(f->cache, 2, 0, 0, &b));
+	bcache_put(b);
+	_no_outstanding_expectations(f->me);
+}
+
+static void test_2q_peek_is_not_a_reference(void *context)
+{
+	struct fixture *f = context;
+	struct block *b;
+	unsigned i;
+
+	_read_twice(f, 1);
+
+	// Each block is peeked at and then got, as label scanning does.
+	for (i = 0; i < 64; i++) {
+		_expect_read(f->me, 2, i);
+		_expect(f->me, E_WAIT);
+		T_ASSERT(bcache_get(f->cache, 2, i, GF_PEEK, &b));
+		bcache_put(b);
+
+		T_ASSERT(bcache_get(f->cache, 2, i, 0, &b));
+		bcache_put(b);
+	}
+
+	// no io expected
+	T_ASSERT(bcache_get(f->cache, 1, 0, 0, &b));
+	bcache_put(b);
+	_no_outstanding_expectations(f->me);
+}
+
+static void test_2q_hot_blocks_still_evicted(void *context)
+{
+	struct fixture *f = context;
+	const unsigned nr_cache_blocks = 16;
+	unsigned i;
+
+	// Every block becomes hot, a new block must still be admitted.
+	for (i = 0; i < nr_cache_blocks + 1; i++)
+		_read_twice(f, 100 + i);
+	_no_outstanding_expectations(f->me);
+}
+
+static void test_stats_count_io(void *context)
+{
+	struct fixture *f = context;
+	struct bcache_stats st;
+	struct bcache_di_stats dst;
+	const unsigned nr_cache_blocks = 16;
+	struct block *b;
+	int di = bcache_set_fd(-1);
+
+	_read_twice(f, di);
+
+	_expect_read(f->me, di, 1);
+	bcache_prefetch(f->cache, di, 1);
+	_expect(f->me, E_WAIT);
+	T_ASSERT(bcache_get(f->cache, di, 1, 0, &b));
+	bcache_put(b);
+
+	_read_once(f, di + 1, nr_cache_blocks);
+
+	bcache_get_stats(f->cache, &st);
+	T_ASSERT_EQUAL(st.reads_issued, nr_cache_blocks + 2);
+	T_ASSERT_EQUAL(st.bytes_read, (nr_cache_blocks + 2) * (128 << SECTOR_SHIFT));
+	T_ASSERT_EQUAL(st.read_hits, 1);
+	T_ASSERT_EQUAL(st.read_misses, nr_cache_blocks + 2);
+	T_ASSERT_EQUAL(st.prefetches, 1);
+	T_ASSERT_EQUAL(st.prefetch_hits, 1);
+	T_ASSERT_EQUAL(st.evictions, 2);
+	T_ASSERT_EQUAL(st.writes_issued, 0);
+
+	T_ASSERT(bcache_get_di_stats(f->cache, di, &dst));
+	T_ASSERT_EQUAL(dst.reads_issued, 2);
+	T_ASSERT_EQUAL(dst.hits, 1);
+	T_ASSERT_EQUAL(dst.misses, 2);
+
+	bcache_clear_fd(di);
+}
+
+static void test_head_prefetch_reads_head(void *context)
+{
+	struct fixture *f = context;
+	struct mock_engine *me = f->me;
+	struct bcache_stats st;
+	struct block *b;
+	int di = bcache_set_fd(-1);
+
+	_expect_read_head(me, di, 0, 8);
+	bcache_prefetch_head(f->cache, di, 0, 8);
+	_expect(me, E_WAIT);
+	T_ASSERT(bcache_get_head(f->cache, di, 0, 8, 0, &b));
+	bcache_put(b);
+
+	// the head is cached
+	T_ASSERT(bcache_get_head(f->cache, di, 0, 4, 0, &b));
+	bcache_put(b);
+
+	// but the rest of the block still has to be read
+	_expect_read(me, di, 0);
+	_expect(me, E_WAIT);
+	T_ASSERT(bcache_get(f->cache, di, 0, 0, &b));
+	bcache_put(b);
+
+	T_ASSERT(bcache_get(f->cache, di, 0, 0, &b));
+	bcache_put(b);
+
+	bcache_get_stats(f->cache, &st);
+	T_ASSERT_EQUAL(st.head_prefetches, 1);
+	T_ASSERT_EQUAL(st.head_rereads, 1);
+	T_ASSERT_EQUAL(st.bytes_read, (8 + 128) << SECTOR_SHIFT);
+
+	bcache_clear_fd(di);
+}
+
 static void test_prefetch_issues_a_read(void *context)
 {
 	struct fixture *f = context;
@@ -725,6 +1098,38 @@ static void test_write_bad_io_stops_flush(void *context)
 	T_ASSERT(bcache_flush(cache));
 }
 
+static void test_issue_writes_across_files(void *context)
+{
+	struct fixture *f = context;
+	struct mock_engine *me = f->me;
+	struct bcache *cache = f->cache;
+	struct block *b;
+
+	// Writes to two files are both issued before anything is waited for.
+	T_ASSERT(bcache_get(cache, 1, 0, GF_ZERO, &b));
+	bcache_put(b);
+	_expect_write(me, 1, 0);
+	bcache_issue_writes(cache);
+
+	T_ASSERT(bcache_get(cache, 2, 0, GF_ZERO, &b));
+	bcache_put(b);
+	_expect_write_bad_wait(me, 2, 0);
+	bcache_issue_writes(cache);
+
+	_expect(me, E_WAIT);
+	_expect(me, E_WAIT);
+	T_ASSERT(!bcache_wait_writes(cache));
+	_no_outstanding_expectations(me);
+
+	T_ASSERT(!bcache_has_write_errors(cache, 1));
+	T_ASSERT(bcache_has_write_errors(cache, 2));
+
+	_expect_write(me, 2, 0);
+	_expect(me, E_WAIT);
+	T_ASSERT(bcache_flush(cache));
+	T_ASSERT(!bcache_has_write_errors(cache, 2));
+}
+
 static void test_invalidate_not_present(void *context)
 {
 	struct fixture *f = context;
@@ -949,6 +1354,9 @@ static struct test_suite *_tiny_tests(void)
 	T("cache-blocks-positive", "nr cache blocks must be positive", test_nr_cache_blocks_must_be_positive);
 	T("block-size-positive", "block size must be positive", test_block_size_must_be_positive);
 	T("block-size-multiple-page", "block size must be a multiple of page size", test_block_size_must_be_multiple_of_page_size);
+	T("delay-engine", "delay engine holds back completions", test_delay_engine_holds_completion);
+	T("delay-engine-bad-spec", "delay engine rejects an invalid spec", test_delay_engine_bad_spec);
+	T("trace-engine", "trace engine records completed io", test_trace_engine_records_io);
 
 	return ts;
 }
@@ -964,6 +1372,7 @@ static struct test_suite *_small_tests(void)
 	T("get-reads", "bcache_get() triggers read", test_get_triggers_read);
 	T("reads-cached", "repeated reads are cached", test_repeated_reads_are_cached);
 	T("blocks-get-evicted", "block get evicted with many reads", test_block_gets_evicted_with_many_reads);
+	T("grow-keeps-blocks", "growing adds blocks without evicting any", test_grow_keeps_blocks);
 	T("prefetch-reads", "prefetch issues a read", test_prefetch_issues_a_read);
 	T("prefetch-never-waits", "too many prefetches does not trigger a wait", test_too_many_prefetches_does_not_trigger_a_wait);
 	T("writeback-occurs", "dirty data gets written back", test_dirty_data_gets_written_back);
@@ -975,6 +1384,7 @@ static struct test_suite *_small_tests(void)
 	T("read-bad-io-intermittent", "failed io, followed by success", test_read_bad_wait_intermittent);
 	T("write-bad-issue-stops-flush", "flush fails temporarily if any block fails to write", test_write_bad_issue_stops_flush);
 	T("write-bad-io-stops-flush", "flush fails temporarily if any block fails to write", test_write_bad_io_stops_flush);
+	T("issue-writes-across-files", "writes issued to several files complete together", test_issue_writes_across_files);
 	T("invalidate-not-present", "invalidate a block that isn't in the cache", test_invalidate_not_present);
 	T("invalidate-present", "invalidate a block that is in the cache", test_invalidate_present);
 	T("invalidate-read-error", "invalidate a block that errored", test_invalidate_after_read_error);
@@ -988,6 +1398,28 @@ static struct test_suite *_small_tests(void)
 
 	T("concurrent-reads-after-invalidate", "prefetch should still issue concurrent reads after invalidate",
           test_concurrent_reads_after_invalidate);
+	T("lru-scan-evicts-hot", "lru policy lets a scan evict a re-referenced block", test_lru_scan_evicts_hot_block);
+	T("stats", "statistics count hits, misses and io", test_stats_count_io);
+	T("head-prefetch", "head prefetch reads only the head of the block", test_head_prefetch_reads_head);
+
+	return ts;
+}
+
+static struct test_suite *_small_2q_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_small_2q_fixture_init, _small_fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("2q-get-reads", "bcache_get() triggers read", test_get_triggers_read);
+	T("2q-reads-cached", "repeated reads are cached", test_repeated_reads_are_cached);
+	T("2q-blocks-get-evicted", "block get evicted with many reads", test_block_gets_evicted_with_many_reads);
+	T("2q-hot-survives-scan", "re-referenced block survives a scan", test_2q_hot_block_survives_scan);
+	T("2q-prefetched-scan-cold", "prefetched and then scanned blocks stay cold", test_2q_prefetched_scan_stays_cold);
+	T("2q-peek-not-a-reference", "a peek and a get of a block do not make it hot", test_2q_peek_is_not_a_reference);
+	T("2q-hot-still-evicted", "hot blocks are evicted when nothing else is left", test_2q_hot_blocks_still_evicted);
 
 	return ts;
 }
@@ -1009,5 +1441,6 @@ void bcache_tests(struct dm_list *all_tests)
 {
         dm_list_add(all_tests, &_tiny_tests()->list);
 	dm_list_add(all_tests, &_small_tests()->list);
+	dm_list_add(all_tests, &_small_2q_tests()->list);
 	dm_list_add(all_tests, &_large_tests()->list);
 }
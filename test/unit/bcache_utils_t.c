@@ -82,7 +82,7 @@ static void *_fix_init(struct io_engine *engine)
 		T_ASSERT(f->fd >= 0);
 	}
 
-	f->cache = bcache_create(T_BLOCK_SIZE / 512, NR_BLOCKS, engine);
+	f->cache = bcache_create(T_BLOCK_SIZE / 512, NR_BLOCKS, engine, BCACHE_POLICY_LRU);
 	T_ASSERT(f->cache);
 
 	f->di = bcache_set_fd(f->fd);
@@ -104,6 +104,31 @@ static void *_sync_init(void)
 	return _fix_init(e);
 }
 
+static void *_uring_init(void)
+{
+	struct io_engine *e = create_uring_io_engine();
+	T_ASSERT(e);
+	return _fix_init(e);
+}
+
+static void *_thread_init(void)
+{
+	struct io_engine *e = create_thread_io_engine(4);
+	T_ASSERT(e);
+	return _fix_init(e);
+}
+
+static bool _uring_supported(void)
+{
+	struct io_engine *e = create_uring_io_engine();
+
+	if (!e)
+		return false;
+
+	e->destroy(e);
+	return true;
+}
+
 static void _fix_exit(void *fixture)
 {
         struct fixture *f = fixture;
@@ -131,6 +156,24 @@ static uint64_t _min(uint64_t lhs, uint64_t rhs)
 	return rhs < lhs ? rhs : lhs;
 }
 
+struct walk_context {
+	uint64_t pos;
+	uint8_t pat;
+};
+
+static bool _verify_walk(void *context, const void *data, size_t len)
+{
+	struct walk_context *wc = context;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		T_ASSERT_EQUAL(((const uint8_t *) data)[i], _pattern_at(wc->pat, wc->pos + i));
+
+	wc->pos += len;
+
+	return true;
+}
+
 static void _verify(struct fixture *f, uint64_t byte_b, uint64_t byte_e, uint8_t pat)
 {
 	struct block *b;
@@ -150,6 +193,27 @@ static void _verify(struct fixture *f, uint64_t byte_b, uint64_t byte_e, uint8_t
         	free(buffer);
 	}
 
+	// Verify via bcache_walk_bytes
+	{
+		struct walk_context wc = { .pos = byte_b, .pat = pat };
+		T_ASSERT(bcache_walk_bytes(f->cache, f->di, byte_b, len, _verify_walk, &wc));
+		T_ASSERT_EQUAL(wc.pos, byte_e);
+	}
+
+	// Verify via bcache_get_bytes, which only maps within one block
+	if (len) {
+		const uint8_t *data;
+		unsigned i;
+
+		if (offset + len <= T_BLOCK_SIZE) {
+			T_ASSERT(bcache_get_bytes(f->cache, f->di, byte_b, len, &b, (const void **) &data));
+			for (i = 0; i < len; i++)
+				T_ASSERT_EQUAL(data[i], _pattern_at(pat, byte_b + i));
+			bcache_put(b);
+		} else
+			T_ASSERT(!bcache_get_bytes(f->cache, f->di, byte_b, len, &b, (const void **) &data));
+	}
+
 	// Verify again, driving bcache directly
 	for (; bb != be; bb++) {
         	T_ASSERT(bcache_get(f->cache, f->di, bb, 0, &b));
@@ -224,7 +288,7 @@ static void _reopen(struct fixture *f)
 	engine = create_async_io_engine();
 	T_ASSERT(engine);
 
-	f->cache = bcache_create(T_BLOCK_SIZE / 512, NR_BLOCKS, engine);
+	f->cache = bcache_create(T_BLOCK_SIZE / 512, NR_BLOCKS, engine, BCACHE_POLICY_LRU);
 	T_ASSERT(f->cache);
 
 	f->di = bcache_set_fd(f->fd);
@@ -286,6 +350,19 @@ static void _test_rw_many_boundaries(void *fixture)
         _rwv_cycle(fixture, byte(13, 13), byte(23, 13));
 }
 
+static void _test_flush_coalesces_adjacent(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct bcache_stats st;
+
+	_do_write(f, byte(5, 0), byte(10, 0), _random_pattern());
+	T_ASSERT(bcache_flush(f->cache));
+
+	bcache_get_stats(f->cache, &st);
+	T_ASSERT_EQUAL(st.writes_issued, 5);
+	T_ASSERT_EQUAL(st.vec_writes, 1);
+}
+
 //----------------------------------------------------------------
 
 static void _zero_cycle(struct fixture *f, uint64_t b, uint64_t e)
@@ -376,6 +453,20 @@ static void _test_set_many_boundaries(void *fixture)
 
 //----------------------------------------------------------------
 
+// Every block is cached after the warmup call, so this is the cost of
+// the lookup and reference counting.
+static void _bench_get_put(void *fixture, unsigned nr_ops)
+{
+	struct fixture *f = fixture;
+	struct block *b;
+	unsigned i;
+
+	for (i = 0; i < nr_ops; i++) {
+		T_ASSERT(bcache_get(f->cache, f->di, i % NR_BLOCKS, 0, &b));
+		bcache_put(b);
+	}
+}
+
 #define T(path, desc, fn) register_test(ts, "/base/device/bcache/utils/async/" path, desc, fn)
 
 static struct test_suite *_async_tests(void)
@@ -393,6 +484,7 @@ static struct test_suite *_async_tests(void)
         T("rw-within-single-block", "read/write/verify within single block", _test_rw_within_single_block);
         T("rw-cross-one-boundary", "read/write/verify across one boundary", _test_rw_cross_one_boundary);
         T("rw-many-boundaries", "read/write/verify many boundaries", _test_rw_many_boundaries);
+        T("flush-coalesces", "adjacent dirty blocks are written together", _test_flush_coalesces_adjacent);
 
         T("zero-first-block", "zero the first block", _test_zero_first_block);
         T("zero-last-block", "zero the last block", _test_zero_last_block);
@@ -428,6 +520,80 @@ static struct test_suite *_sync_tests(void)
         T("rw-within-single-block", "read/write/verify within single block", _test_rw_within_single_block);
         T("rw-cross-one-boundary", "read/write/verify across one boundary", _test_rw_cross_one_boundary);
         T("rw-many-boundaries", "read/write/verify many boundaries", _test_rw_many_boundaries);
+        T("flush-coalesces", "adjacent dirty blocks are written together", _test_flush_coalesces_adjacent);
+
+        T("zero-first-block", "zero the first block", _test_zero_first_block);
+        T("zero-last-block", "zero the last block", _test_zero_last_block);
+        T("zero-several-blocks", "zero several whole blocks", _test_zero_several_whole_blocks);
+        T("zero-within-single-block", "zero within single block", _test_zero_within_single_block);
+        T("zero-cross-one-boundary", "zero across one boundary", _test_zero_cross_one_boundary);
+        T("zero-many-boundaries", "zero many boundaries", _test_zero_many_boundaries);
+
+        T("set-first-block", "set the first block", _test_set_first_block);
+        T("set-last-block", "set the last block", _test_set_last_block);
+        T("set-several-blocks", "set several whole blocks", _test_set_several_whole_blocks);
+        T("set-within-single-block", "set within single block", _test_set_within_single_block);
+        T("set-cross-one-boundary", "set across one boundary", _test_set_cross_one_boundary);
+        T("set-many-boundaries", "set many boundaries", _test_set_many_boundaries);
+
+        register_bench(ts, "/base/device/bcache/utils/sync/bench/get-put",
+                       "get and put of cached blocks", _bench_get_put, 1000000, 0);
+#undef T
+
+        return ts;
+}
+
+static struct test_suite *_uring_tests(void)
+{
+        struct test_suite *ts = test_suite_create(_uring_init, _fix_exit);
+        if (!ts) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+        }
+
+#define T(path, desc, fn) register_test(ts, "/base/device/bcache/utils/uring/" path, desc, fn)
+        T("rw-first-block", "read/write/verify the first block", _test_rw_first_block);
+        T("rw-last-block", "read/write/verify the last block", _test_rw_last_block);
+        T("rw-several-blocks", "read/write/verify several whole blocks", _test_rw_several_whole_blocks);
+        T("rw-within-single-block", "read/write/verify within single block", _test_rw_within_single_block);
+        T("rw-cross-one-boundary", "read/write/verify across one boundary", _test_rw_cross_one_boundary);
+        T("rw-many-boundaries", "read/write/verify many boundaries", _test_rw_many_boundaries);
+        T("flush-coalesces", "adjacent dirty blocks are written together", _test_flush_coalesces_adjacent);
+
+        T("zero-first-block", "zero the first block", _test_zero_first_block);
+        T("zero-last-block", "zero the last block", _test_zero_last_block);
+        T("zero-several-blocks", "zero several whole blocks", _test_zero_several_whole_blocks);
+        T("zero-within-single-block", "zero within single block", _test_zero_within_single_block);
+        T("zero-cross-one-boundary", "zero across one boundary", _test_zero_cross_one_boundary);
+        T("zero-many-boundaries", "zero many boundaries", _test_zero_many_boundaries);
+
+        T("set-first-block", "set the first block", _test_set_first_block);
+        T("set-last-block", "set the last block", _test_set_last_block);
+        T("set-several-blocks", "set several whole blocks", _test_set_several_whole_blocks);
+        T("set-within-single-block", "set within single block", _test_set_within_single_block);
+        T("set-cross-one-boundary", "set across one boundary", _test_set_cross_one_boundary);
+        T("set-many-boundaries", "set many boundaries", _test_set_many_boundaries);
+#undef T
+
+        return ts;
+}
+
+static struct test_suite *_thread_tests(void)
+{
+        struct test_suite *ts = test_suite_create(_thread_init, _fix_exit);
+        if (!ts) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+        }
+
+#define T(path, desc, fn) register_test(ts, "/base/device/bcache/utils/thread/" path, desc, fn)
+        T("rw-first-block", "read/write/verify the first block", _test_rw_first_block);
+        T("rw-last-block", "read/write/verify the last block", _test_rw_last_block);
+        T("rw-several-blocks", "read/write/verify several whole blocks", _test_rw_several_whole_blocks);
+        T("rw-within-single-block", "read/write/verify within single block", _test_rw_within_single_block);
+        T("rw-cross-one-boundary", "read/write/verify across one boundary", _test_rw_cross_one_boundary);
+        T("rw-many-boundaries", "read/write/verify many boundaries", _test_rw_many_boundaries);
+        T("flush-coalesces", "adjacent dirty blocks are written together", _test_flush_coalesces_adjacent);
 
         T("zero-first-block", "zero the first block", _test_zero_first_block);
         T("zero-last-block", "zero the last block", _test_zero_last_block);
@@ -451,5 +617,10 @@ void bcache_utils_tests(struct dm_list *all_tests)
 {
 	dm_list_add(all_tests, &_async_tests()->list);
 	dm_list_add(all_tests, &_sync_tests()->list);
+	dm_list_add(all_tests, &_thread_tests()->list);
+
+	// io_uring may be missing or disabled on the test host
+	if (_uring_supported())
+		dm_list_add(all_tests, &_uring_tests()->list);
 }
 
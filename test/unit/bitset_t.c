@@ -129,6 +129,51 @@ static void test_and(void *fixture)
                 T_ASSERT(!dm_bit(bs3, i));
 }
 
+static void test_next_zero(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+
+        int i, last = -1;
+        dm_bitset_t bs = dm_bitset_create(mem, NR_BITS);
+
+        /* Unused bits in the last word are set too */
+        dm_bit_set_all(bs);
+        T_ASSERT(dm_bit_get_next_zero(bs, -1) == -1);
+
+        for (i = 0; i < NR_BITS; i += 5)
+                dm_bit_clear(bs, i);
+
+        for (i = 0; i < NR_BITS; i += 5) {
+                last = dm_bit_get_next_zero(bs, last);
+                T_ASSERT(last == i);
+        }
+
+        T_ASSERT(dm_bit_get_next_zero(bs, last) == -1);
+
+        /* Unused bits are clear, but never returned */
+        dm_bit_clear_all(bs);
+        T_ASSERT(dm_bit_get_next_zero(bs, NR_BITS - 2) == NR_BITS - 1);
+        T_ASSERT(dm_bit_get_next_zero(bs, NR_BITS - 1) == -1);
+}
+
+static void test_count(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+
+        int i, count = 0;
+        dm_bitset_t bs = dm_bitset_create(mem, NR_BITS);
+
+        T_ASSERT(!dm_bit_count(bs));
+
+        for (i = 0; i < NR_BITS; i += 3, count++)
+                dm_bit_set(bs, i);
+
+        T_ASSERT(dm_bit_count(bs) == count);
+
+        dm_bit_set_all(bs);
+        T_ASSERT(dm_bit_count(bs) == NR_BITS);
+}
+
 #define T(path, desc, fn) register_test(ts, "/base/data-struct/bitset/" path, desc, fn)
 
 void bitset_tests(struct dm_list *all_tests)
@@ -142,6 +187,8 @@ void bitset_tests(struct dm_list *all_tests)
 	T("get_next", "get next set bit", test_get_next);
 	T("equal", "equality", test_equal);
 	T("and", "and all bits", test_and);
+	T("next_zero", "get next clear bit", test_next_zero);
+	T("count", "count set bits", test_count);
 
 	dm_list_add(all_tests, &ts->list);
 }
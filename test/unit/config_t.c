@@ -149,6 +149,95 @@ static void test_cascade(void *fixture)
 	dm_config_destroy(t2);
 }
 
+static const char *dups =
+	"physical_volumes {\n"
+	"    pv0 {\n"
+	"        id = \"abcd-efgh\"\n"
+	"    }\n"
+	"}\n"
+	"physical_volumes/pv0/dev_size = 8\n"
+	"physical_volumes {\n"
+	"    pv0 {\n"
+	"        pe_start = 2048\n"
+	"    }\n"
+	"    pv1 {\n"
+	"        id = \"bbcd-efgh\"\n"
+	"    }\n"
+	"}\n";
+
+static void test_parse_merge(void *fixture)
+{
+	struct dm_config_tree *tree = dm_config_from_string(dups);
+	const struct dm_config_node *pv0, *pv1;
+
+	T_ASSERT((long) tree);
+
+	/* Repeated sections merge into one node. */
+	T_ASSERT(!tree->root->sib);
+	T_ASSERT((pv0 = dm_config_find_node(tree->root, "physical_volumes/pv0")));
+	T_ASSERT(dm_config_has_node(tree->root, "physical_volumes/pv0/id"));
+	T_ASSERT(dm_config_has_node(tree->root, "physical_volumes/pv0/dev_size"));
+	T_ASSERT(dm_config_has_node(tree->root, "physical_volumes/pv0/pe_start"));
+	T_ASSERT(pv0->sib && !pv0->sib->sib);
+
+	/* Keys are stored once per tree. */
+	T_ASSERT((pv1 = dm_config_find_node(tree->root, "physical_volumes/pv1")));
+	T_ASSERT(pv0->child->key == pv1->child->key);
+
+	dm_config_destroy(tree);
+}
+
+//----------------------------------------------------------------
+
+#define VG_TEXT_SIZE (1024 * 1024)
+
+// VG metadata text of many linear LVs padded to exactly 1MiB.
+static void *_vg_text_init(void)
+{
+	char *text = malloc(VG_TEXT_SIZE + 1);
+	size_t len;
+	unsigned i;
+
+	T_ASSERT(text);
+
+	len = snprintf(text, VG_TEXT_SIZE, "vg {\nid = \"abcd-efgh\"\nseqno = 1\n"
+		       "status = [\"READ\", \"WRITE\"]\nextent_size = 8192\n"
+		       "physical_volumes {\npv0 {\nid = \"abcd-efgh\"\n"
+		       "device = \"/dev/sda\"\npe_start = 2048\npe_count = 1000000\n}\n}\n"
+		       "logical_volumes {\n");
+
+	for (i = 0; len < VG_TEXT_SIZE - 512; i++)
+		len += snprintf(text + len, VG_TEXT_SIZE - len,
+				"lvol%06u {\nid = \"%06u-1111-2222-3333-2222-1111-%06u\"\n"
+				"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+				"creation_time = 1580000000\nsegment_count = 1\n"
+				"segment1 {\nstart_extent = 0\nextent_count = 1\n"
+				"type = \"striped\"\nstripe_count = 1\n"
+				"stripes = [\"pv0\", %u]\n}\n}\n", i, i, i, i);
+
+	len += snprintf(text + len, VG_TEXT_SIZE - len, "}\n}\n");
+	memset(text + len, '\n', VG_TEXT_SIZE - len);
+	text[VG_TEXT_SIZE] = 0;
+
+	return text;
+}
+
+static void _vg_text_exit(void *fixture)
+{
+	free(fixture);
+}
+
+static void _bench_parse_vg(void *fixture, unsigned nr_ops)
+{
+	struct dm_config_tree *tree;
+	unsigned i;
+
+	for (i = 0; i < nr_ops; i++) {
+		T_ASSERT(tree = dm_config_from_string(fixture));
+		dm_config_destroy(tree);
+	}
+}
+
 #define T(path, desc, fn) register_test(ts, "/metadata/config/" path, desc, fn)
 
 void config_tests(struct dm_list *all_tests)
@@ -160,8 +249,19 @@ void config_tests(struct dm_list *all_tests)
 	}
 
 	T("parse", "parsing various", test_parse);
+	T("parse-merge", "merging repeated sections while parsing", test_parse_merge);
 	T("clone", "duplicating a config tree", test_clone);
 	T("cascade", "cascade", test_cascade);
 
 	dm_list_add(all_tests, &ts->list);
+
+	if (!(ts = test_suite_create(_vg_text_init, _vg_text_exit))) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	register_bench(ts, "/metadata/config/bench/parse-vg", "parse 1MiB of VG metadata",
+		       _bench_parse_vg, 4, VG_TEXT_SIZE);
+
+	dm_list_add(all_tests, &ts->list);
 };
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/crc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------
+
+#define BUF_SIZE (1024 * 1024)
+
+static void *_fixture_init(void)
+{
+	uint8_t *buf = malloc(BUF_SIZE);
+	unsigned i;
+
+	T_ASSERT(buf);
+
+	srand(0x1234);
+	for (i = 0; i < BUF_SIZE; i++)
+		buf[i] = (uint8_t) rand();
+
+	return buf;
+}
+
+static void _fixture_exit(void *fixture)
+{
+	free(fixture);
+}
+
+// Bit at a time, straight from the polynomial.
+static uint32_t _crc_reference(uint32_t crc, const uint8_t *buf, uint32_t size)
+{
+	unsigned j;
+
+	while (size--) {
+		crc ^= *buf++;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+	}
+
+	return crc;
+}
+
+static void test_known_value(void *fixture)
+{
+	static const uint8_t check[] = "123456789";
+
+	// The standard CRC-32 check value, with the usual inversions.
+	T_ASSERT_EQUAL(~calc_crc(~0U, check, 9), 0xcbf43926);
+}
+
+static void test_variants(void *fixture)
+{
+	static const uint32_t sizes[] = { 0, 1, 3, 7, 8, 15, 16, 17, 63, 64, 65, 127, 128,
+					  129, 255, 512, 1000, 4096, 65535, BUF_SIZE - 64 };
+	const uint8_t *buf = fixture;
+	uint32_t expected, initial;
+	unsigned v, s, offset;
+	crc_fn_t fn;
+
+	for (v = 0; v < crc_variant_count(); v++) {
+		if (!(fn = crc_variant_fn(v)))
+			continue;
+
+		for (s = 0; s < DM_ARRAY_SIZE(sizes); s++)
+			for (offset = 0; offset < 8; offset += 3) {
+				initial = INITIAL_CRC ^ (sizes[s] * 0x9e3779b9);
+				expected = _crc_reference(initial, buf + offset, sizes[s]);
+				if (fn(initial, buf + offset, sizes[s]) != expected)
+					test_fail("crc variant %s wrong for size %u offset %u",
+						  crc_variant_name(v), sizes[s], offset);
+			}
+	}
+}
+
+static void test_select(void *fixture)
+{
+	const uint8_t *buf = fixture;
+	uint32_t expected = _crc_reference(INITIAL_CRC, buf, 4096);
+	unsigned v;
+
+	for (v = 0; v < crc_variant_count(); v++) {
+		T_ASSERT_EQUAL(crc_select_variant(crc_variant_name(v)), crc_variant_fn(v) ? 1 : 0);
+		T_ASSERT_EQUAL(calc_crc(INITIAL_CRC, buf, 4096), expected);
+	}
+
+	T_ASSERT(!crc_select_variant("no-such-crc"));
+	T_ASSERT(crc_select_variant(NULL));
+	T_ASSERT_EQUAL(calc_crc(INITIAL_CRC, buf, 4096), expected);
+}
+
+// Each op checksums the buffer once with every variant.
+static void _bench_variants(void *fixture, unsigned nr_ops)
+{
+	const uint8_t *buf = fixture;
+	uint32_t expected = _crc_reference(INITIAL_CRC, buf, BUF_SIZE);
+	unsigned v, i;
+	crc_fn_t fn;
+
+	for (v = 0; v < crc_variant_count(); v++) {
+		if (!(fn = crc_variant_fn(v)))
+			continue;
+
+		for (i = 0; i < nr_ops; i++)
+			T_ASSERT_EQUAL(fn(INITIAL_CRC, buf, BUF_SIZE), expected);
+	}
+}
+
+static void _bench_calc_crc(void *fixture, unsigned nr_ops)
+{
+	const uint8_t *buf = fixture;
+	uint32_t crc = INITIAL_CRC;
+	unsigned i;
+
+	for (i = 0; i < nr_ops; i++)
+		crc = calc_crc(crc, buf, BUF_SIZE);
+
+	T_ASSERT(crc != INITIAL_CRC);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/metadata/crc/" path, desc, fn)
+#define B(path, desc, fn, nr, bytes) register_bench(ts, "/metadata/crc/bench/" path, desc, fn, nr, bytes)
+
+void crc_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fixture_init, _fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("known-value", "standard CRC-32 check value", test_known_value);
+	T("variants", "every variant matches the polynomial", test_variants);
+	T("select", "calc_crc uses the selected variant", test_select);
+
+	B("calc-crc", "calc_crc of a 1MiB buffer", _bench_calc_crc, 16, BUF_SIZE);
+	B("variants", "every CRC variant over a 1MiB buffer", _bench_variants, 16, 0);
+
+	dm_list_add(all_tests, &ts->list);
+}
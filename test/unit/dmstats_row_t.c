@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "libdm/libdm-stats-row.c"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------
+
+#define NR_ROWS 1024
+#define ROW_LEN 256
+
+static const char _row[] =
+	"0+2048 1 2 3 4 5 6 7 8 9 10 11 18446744073709551615 13\n";
+
+// The format libdm-stats used before the hand written parser.
+static int _sscanf_row(const char *row, uint64_t *v)
+{
+	return sscanf(row, "%" PRIu64 "+%" PRIu64
+		      " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+		      " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+		      " %" PRIu64 " %" PRIu64 " %" PRIu64
+		      " %" PRIu64 " %" PRIu64,
+		      v, v + 1, v + 2, v + 3, v + 4, v + 5, v + 6, v + 7,
+		      v + 8, v + 9, v + 10, v + 11, v + 12, v + 13, v + 14);
+}
+
+static void test_row(void *fixture)
+{
+	uint64_t vals[DM_STATS_ROW_FIELDS], ref[DM_STATS_ROW_FIELDS];
+	const char *c;
+
+	T_ASSERT(c = _stats_parse_row(_row, vals));
+	T_ASSERT_EQUAL(*c, '\n');
+	T_ASSERT_EQUAL(_sscanf_row(_row, ref), DM_STATS_ROW_FIELDS);
+	T_ASSERT(!memcmp(vals, ref, sizeof(vals)));
+
+	/* Histogram data starts after the space following the last counter */
+	T_ASSERT(c = _stats_parse_row("8+8 0 0 0 0 0 0 0 0 0 0 0 0 0 1:2:3\n", vals));
+	T_ASSERT(!strcmp(c, " 1:2:3\n"));
+
+	/* Last row may lack its newline */
+	T_ASSERT(c = _stats_parse_row("8+8 0 0 0 0 0 0 0 0 0 0 0 0 7", vals));
+	T_ASSERT_EQUAL(*c, '\0');
+	T_ASSERT_EQUAL(vals[14], 7);
+}
+
+static void test_bad_rows(void *fixture)
+{
+	uint64_t vals[DM_STATS_ROW_FIELDS];
+
+	T_ASSERT(!_stats_parse_row("", vals));
+	T_ASSERT(!_stats_parse_row("0 2048 1 2 3 4 5 6 7 8 9 10 11 12 13\n", vals));
+	T_ASSERT(!_stats_parse_row("0+2048 1 2 3 4 5 6 7 8 9 10 11 12\n", vals));
+	T_ASSERT(!_stats_parse_row("0+2048 1 2 3 4 5 6 7 8 9 10 11 12 x\n", vals));
+	T_ASSERT(!_stats_parse_row("0+2048 1  2 3 4 5 6 7 8 9 10 11 12 13\n", vals));
+	T_ASSERT(!_stats_parse_row("0+2048 1 2 3 4 5 6 7 8 9 10 11 12 13x\n", vals));
+	T_ASSERT(!_stats_parse_row("0+2048 1 2 3 4 5 6 7 8 9 10 11 12 18446744073709551616\n", vals));
+}
+
+//----------------------------------------------------------------
+
+static void *_bench_init(void)
+{
+	char (*rows)[ROW_LEN] = malloc(NR_ROWS * sizeof(*rows));
+	unsigned i;
+
+	T_ASSERT(rows);
+
+	for (i = 0; i < NR_ROWS; i++)
+		snprintf(rows[i], ROW_LEN, "%u+2048 %u 0 %u 97 %u 3 %u 2212 0 1840 2309 %u %u\n",
+			 i * 2048, i * 31, i * 248, i * 17, i * 136, i * 977, i * 1213);
+
+	return rows;
+}
+
+static void _bench_exit(void *fixture)
+{
+	free(fixture);
+}
+
+static void _bench_sscanf(void *fixture, unsigned nr_ops)
+{
+	char (*rows)[ROW_LEN] = fixture;
+	uint64_t vals[DM_STATS_ROW_FIELDS];
+	unsigned i;
+
+	for (i = 0; i < nr_ops; i++)
+		T_ASSERT_EQUAL(_sscanf_row(rows[i % NR_ROWS], vals), DM_STATS_ROW_FIELDS);
+}
+
+static void _bench_parse(void *fixture, unsigned nr_ops)
+{
+	char (*rows)[ROW_LEN] = fixture;
+	uint64_t vals[DM_STATS_ROW_FIELDS];
+	unsigned i;
+
+	for (i = 0; i < nr_ops; i++)
+		T_ASSERT(_stats_parse_row(rows[i % NR_ROWS], vals));
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/libdm/stats/row/" path, desc, fn)
+#define B(path, desc, fn, nr) register_bench(ts, "/libdm/stats/row/bench/" path, desc, fn, nr, 0)
+
+void dm_stats_row_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(NULL, NULL);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("parse", "@stats_print rows parse like sscanf", test_row);
+	T("bad", "malformed @stats_print rows are rejected", test_bad_rows);
+
+	dm_list_add(all_tests, &ts->list);
+
+	if (!(ts = test_suite_create(_bench_init, _bench_exit))) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	B("sscanf", "sscanf of 10^6 @stats_print rows", _bench_sscanf, 1000000);
+	B("parse", "in place parse of 10^6 @stats_print rows", _bench_parse, 1000000);
+
+	dm_list_add(all_tests, &ts->list);
+}
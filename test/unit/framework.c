@@ -58,6 +58,31 @@ bool register_test(struct test_suite *ts,
 	t->path = path;
 	t->desc = desc;
 	t->fn = fn;
+	t->bench_fn = NULL;
+	t->nr_ops = 0;
+	t->bytes_per_op = 0;
+	dm_list_add(&ts->tests, &t->list);
+
+	return true;
+}
+
+bool register_bench(struct test_suite *ts,
+		    const char *path, const char *desc,
+		    void (*fn)(void *, unsigned), unsigned nr_ops, uint64_t bytes_per_op)
+{
+	struct test_details *t = malloc(sizeof(*t));
+	if (!t) {
+		fprintf(stderr, "out of memory\n");
+		return false;
+	}
+
+	t->parent = ts;
+	t->path = path;
+	t->desc = desc;
+	t->fn = NULL;
+	t->bench_fn = fn;
+	t->nr_ops = nr_ops ? : 1;
+	t->bytes_per_op = bytes_per_op;
 	dm_list_add(&ts->tests, &t->list);
 
 	return true;
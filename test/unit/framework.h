@@ -25,6 +25,11 @@ struct test_details {
 	const char *path;
 	const char *desc;
 	void (*fn)(void *);
+
+	// Benchmarks have bench_fn set instead of fn.
+	void (*bench_fn)(void *, unsigned);
+	unsigned nr_ops;
+	uint64_t bytes_per_op;
 };
 
 struct test_suite *test_suite_create(void *(*fixture_init)(void),
@@ -34,6 +39,13 @@ void test_suite_destroy(struct test_suite *ts);
 bool register_test(struct test_suite *ts,
 		   const char *path, const char *desc, void (*fn)(void *));
 
+// A benchmark runs nr_ops operations, each processing bytes_per_op bytes
+// (0 when that means nothing), every time fn is called.  Benchmarks are
+// left out of 'run' and timed by 'bench'.
+bool register_bench(struct test_suite *ts,
+		    const char *path, const char *desc,
+		    void (*fn)(void *, unsigned), unsigned nr_ops, uint64_t bytes_per_op);
+
 void test_fail(const char *fmt, ...)
 	__attribute__((noreturn, format (printf, 1, 2)));
 
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "base/data-struct/hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------
+
+#define NR_KEYS 20000
+#define KEY_LEN 32
+
+static void *_fixture_init(void)
+{
+	struct dm_hash_table *t = dm_hash_create(1);
+
+	T_ASSERT(t);
+
+	return t;
+}
+
+static void _fixture_exit(void *fixture)
+{
+	dm_hash_destroy(fixture);
+}
+
+static void _key(char *buf, unsigned i)
+{
+	snprintf(buf, KEY_LEN, "LVM-%08x-%u", i * 2654435761U, i);
+}
+
+//----------------------------------------------------------------
+
+static void test_grow(void *fixture)
+{
+	struct dm_hash_table *t = fixture;
+	struct dm_hash_node *n;
+	char key[KEY_LEN];
+	uintptr_t i;
+	unsigned nr = 0;
+
+	for (i = 0; i < NR_KEYS; i++) {
+		_key(key, i);
+		T_ASSERT(dm_hash_insert(t, key, (void *) (i + 1)));
+	}
+
+	T_ASSERT_EQUAL(dm_hash_get_num_entries(t), NR_KEYS);
+
+	for (i = 0; i < NR_KEYS; i++) {
+		_key(key, i);
+		T_ASSERT(dm_hash_lookup(t, key) == (void *) (i + 1));
+	}
+
+	/* Iteration sees every node once */
+	for (n = dm_hash_get_first(t); n; n = dm_hash_get_next(t, n)) {
+		i = (uintptr_t) dm_hash_get_data(t, n) - 1;
+		_key(key, i);
+		T_ASSERT(!strcmp(dm_hash_get_key(t, n), key));
+		nr++;
+	}
+	T_ASSERT_EQUAL(nr, NR_KEYS);
+
+	for (i = 0; i < NR_KEYS; i += 2) {
+		_key(key, i);
+		dm_hash_remove(t, key);
+	}
+
+	T_ASSERT_EQUAL(dm_hash_get_num_entries(t), NR_KEYS / 2);
+
+	for (i = 0; i < NR_KEYS; i++) {
+		_key(key, i);
+		T_ASSERT(dm_hash_lookup(t, key) == ((i & 1) ? (void *) (i + 1) : NULL));
+	}
+}
+
+static void test_multiple(void *fixture)
+{
+	static const char vals[] = "0123456789";
+	struct dm_hash_table *t = fixture;
+	char key[KEY_LEN];
+	unsigned i, v;
+	int count;
+
+	/* Same key spread between growths */
+	for (i = 0; i < NR_KEYS; i++) {
+		if (!(i % (NR_KEYS / 10))) {
+			v = i / (NR_KEYS / 10);
+			T_ASSERT(dm_hash_insert_allow_multiple(t, "dup", vals + v, 1));
+		}
+		_key(key, i);
+		T_ASSERT(dm_hash_insert_allow_multiple(t, key, vals, 1));
+	}
+
+	/* Last inserted entry is still found first */
+	T_ASSERT(dm_hash_lookup_with_count(t, "dup", &count) == vals + 9);
+	T_ASSERT_EQUAL(count, 10);
+
+	for (v = 0; v < 10; v++)
+		T_ASSERT(dm_hash_lookup_with_val(t, "dup", vals + v, 1) == vals + v);
+
+	dm_hash_remove_with_val(t, "dup", vals + 9, 1);
+	T_ASSERT(dm_hash_lookup_with_count(t, "dup", &count) == vals + 8);
+	T_ASSERT_EQUAL(count, 9);
+}
+
+static void test_flat(void *fixture)
+{
+	struct dm_hash_table *ref = fixture;
+	struct dm_flat_hash *t;
+	struct dm_flat_hash_entry *e;
+	char key[KEY_LEN];
+	uintptr_t i, r = 1;
+	unsigned nr = 0;
+
+	T_ASSERT(t = dm_flat_hash_create(0));
+
+	/* Random inserts and removals checked against dm_hash */
+	for (i = 0; i < 8 * NR_KEYS; i++) {
+		r = r * 1103515245 + 12345;
+		_key(key, (r >> 8) % NR_KEYS);
+		if ((r >> 4) & 3) {
+			T_ASSERT(dm_flat_hash_insert(t, key, (void *) (i + 1)));
+			T_ASSERT(dm_hash_insert(ref, key, (void *) (i + 1)));
+		} else {
+			dm_flat_hash_remove(t, key);
+			dm_hash_remove(ref, key);
+		}
+	}
+
+	T_ASSERT_EQUAL(dm_flat_hash_get_num_entries(t), dm_hash_get_num_entries(ref));
+
+	for (i = 0; i < NR_KEYS; i++) {
+		_key(key, i);
+		T_ASSERT(dm_flat_hash_lookup(t, key) == dm_hash_lookup(ref, key));
+	}
+
+	dm_flat_hash_iterate(e, t) {
+		T_ASSERT(dm_hash_lookup(ref, dm_flat_hash_get_key(t, e)) == dm_flat_hash_get_data(t, e));
+		nr++;
+	}
+	T_ASSERT_EQUAL(nr, dm_hash_get_num_entries(ref));
+
+	dm_flat_hash_wipe(t);
+	T_ASSERT_EQUAL(dm_flat_hash_get_num_entries(t), 0);
+	T_ASSERT(!dm_flat_hash_get_first(t));
+
+	dm_flat_hash_destroy(t);
+}
+
+#define NR_BENCH_KEYS 100000
+
+struct hash_bench {
+	char (*keys)[KEY_LEN];
+	struct dm_hash_table *t;
+	struct dm_flat_hash *ft;
+};
+
+static void *_bench_init(void)
+{
+	struct hash_bench *hb = malloc(sizeof(*hb));
+	unsigned i;
+
+	T_ASSERT(hb);
+	T_ASSERT(hb->keys = malloc(NR_BENCH_KEYS * sizeof(*hb->keys)));
+	T_ASSERT(hb->t = dm_hash_create(16));
+	T_ASSERT(hb->ft = dm_flat_hash_create(16));
+
+	for (i = 0; i < NR_BENCH_KEYS; i++) {
+		_key(hb->keys[i], i);
+		T_ASSERT(dm_hash_insert(hb->t, hb->keys[i], hb->keys[i]));
+		T_ASSERT(dm_flat_hash_insert(hb->ft, hb->keys[i], hb->keys[i]));
+	}
+
+	return hb;
+}
+
+static void _bench_exit(void *fixture)
+{
+	struct hash_bench *hb = fixture;
+
+	dm_flat_hash_destroy(hb->ft);
+	dm_hash_destroy(hb->t);
+	free(hb->keys);
+	free(hb);
+}
+
+// Inserts into a fresh table, so this includes growing and destroying it.
+static void _bench_insert(void *fixture, unsigned nr_ops)
+{
+	struct hash_bench *hb = fixture;
+	struct dm_hash_table *t;
+	unsigned i;
+
+	T_ASSERT(t = dm_hash_create(16));
+	for (i = 0; i < nr_ops; i++)
+		T_ASSERT(dm_hash_insert(t, hb->keys[i % NR_BENCH_KEYS], hb->keys[i % NR_BENCH_KEYS]));
+	dm_hash_destroy(t);
+}
+
+static void _bench_flat_insert(void *fixture, unsigned nr_ops)
+{
+	struct hash_bench *hb = fixture;
+	struct dm_flat_hash *ft;
+	unsigned i;
+
+	T_ASSERT(ft = dm_flat_hash_create(16));
+	for (i = 0; i < nr_ops; i++)
+		T_ASSERT(dm_flat_hash_insert(ft, hb->keys[i % NR_BENCH_KEYS], hb->keys[i % NR_BENCH_KEYS]));
+	dm_flat_hash_destroy(ft);
+}
+
+static void _bench_lookup(void *fixture, unsigned nr_ops)
+{
+	struct hash_bench *hb = fixture;
+	unsigned i, r = 1;
+
+	for (i = 0; i < nr_ops; i++) {
+		r = r * 1103515245 + 12345;
+		T_ASSERT(dm_hash_lookup(hb->t, hb->keys[(r >> 8) % NR_BENCH_KEYS]));
+	}
+}
+
+static void _bench_flat_lookup(void *fixture, unsigned nr_ops)
+{
+	struct hash_bench *hb = fixture;
+	unsigned i, r = 1;
+
+	for (i = 0; i < nr_ops; i++) {
+		r = r * 1103515245 + 12345;
+		T_ASSERT(dm_flat_hash_lookup(hb->ft, hb->keys[(r >> 8) % NR_BENCH_KEYS]));
+	}
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/base/data-struct/hash/" path, desc, fn)
+#define B(path, desc, fn, nr) register_bench(ts, "/base/data-struct/hash/bench/" path, desc, fn, nr, 0)
+
+void hash_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fixture_init, _fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("grow", "entries survive growing from a tiny table", test_grow);
+	T("multiple", "duplicate keys keep their order across growth", test_multiple);
+	T("flat", "open addressing table matches dm_hash", test_flat);
+
+	dm_list_add(all_tests, &ts->list);
+
+	if (!(ts = test_suite_create(_bench_init, _bench_exit))) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	B("insert", "dm_hash insert of 10^5 keys", _bench_insert, NR_BENCH_KEYS);
+	B("lookup", "dm_hash lookup among 10^5 keys", _bench_lookup, 1000000);
+	B("flat-insert", "dm_flat_hash insert of 10^5 keys", _bench_flat_insert, NR_BENCH_KEYS);
+	B("flat-lookup", "dm_flat_hash lookup among 10^5 keys", _bench_flat_lookup, 1000000);
+
+	dm_list_add(all_tests, &ts->list);
+}
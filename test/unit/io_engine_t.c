@@ -138,7 +138,7 @@ static void _test_read(void *fixture)
 {
 	struct fixture *f = fixture;
 	struct io io;
-	struct bcache *cache = bcache_create(8, BLOCK_SIZE_SECTORS, f->e);
+	struct bcache *cache = bcache_create(8, BLOCK_SIZE_SECTORS, f->e, BCACHE_POLICY_LRU);
 	T_ASSERT(cache);
 
 	f->di = bcache_set_fd(f->fd);
@@ -156,7 +156,7 @@ static void _test_write(void *fixture)
 {
 	struct fixture *f = fixture;
 	struct io io;
-	struct bcache *cache = bcache_create(8, BLOCK_SIZE_SECTORS, f->e);
+	struct bcache *cache = bcache_create(8, BLOCK_SIZE_SECTORS, f->e, BCACHE_POLICY_LRU);
 	T_ASSERT(cache);
 
 	f->di = bcache_set_fd(f->fd);
@@ -175,7 +175,7 @@ static void _test_write_bytes(void *fixture)
 	unsigned offset = 345;
 	char buf_out[32];
 	char buf_in[32];
-	struct bcache *cache = bcache_create(8, BLOCK_SIZE_SECTORS, f->e);
+	struct bcache *cache = bcache_create(8, BLOCK_SIZE_SECTORS, f->e, BCACHE_POLICY_LRU);
 	T_ASSERT(cache);
 
 	f->di = bcache_set_fd(f->fd);
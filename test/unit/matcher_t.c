@@ -111,6 +111,61 @@ static void test_kabi_query(void *fixture)
 
 }
 
+static void test_prefilter(void *fixture)
+{
+	static const char *_patterns[] = {
+		"^/dev/sd[a-z]+$", "mapper/vg0-(lv|pool)[0-9]+", "(nvme|xvd)+x"
+	};
+
+	static struct {
+		const char *input;
+		int r;
+	} _cases[] = {
+		{"/dev/sda", 0},
+		{"/dev/sda1", -1},
+		{"x/dev/sda", -1},
+		{"/dev/mapper/vg0-lv12", 1},
+		{"/dev/mapper/vg0-pool1", 1},
+		{"/dev/mapper/vg0-thin1", -1},
+		{"/dev/mapper/vg1-lv1", -1},
+		{"/dev/xvdnvmex", 2},
+		{"/dev/nvmex", 2},
+		{"/dev/nvme0n1", -1},
+		{"", -1},
+	};
+
+	struct dm_pool *mem = fixture;
+	struct dm_regex *scanner;
+	unsigned i;
+
+	scanner = dm_regex_create(mem, _patterns, DM_ARRAY_SIZE(_patterns));
+	T_ASSERT(scanner != NULL);
+
+	for (i = 0; i < DM_ARRAY_SIZE(_cases); i++)
+		if (dm_regex_match(scanner, _cases[i].input) != _cases[i].r)
+			test_fail("'%s' expected to match %d", _cases[i].input, _cases[i].r);
+}
+
+// Device names against the kind of patterns used by device filters
+static void _bench_match(void *fixture, unsigned nr_ops)
+{
+	static const char *_patterns[] = {
+		"^/dev/disk/by-id/", "^/dev/mapper/", "^/dev/sd[a-z]+[0-9]*$",
+		"^/dev/nvme[0-9]+n[0-9]+(p[0-9]+)?$", "^/dev/md[0-9]+$", "loop", NULL
+	};
+	static const char *_names[] = {
+		"/dev/sda", "/dev/sdz12", "/dev/nvme0n1p3", "/dev/mapper/vg-lv",
+		"/dev/disk/by-id/wwn-0x5000c500a1b2c3d4", "/dev/loop7", "/dev/dm-12", "/dev/vdb"
+	};
+	struct dm_regex *scanner = make_scanner(fixture, _patterns);
+	unsigned i, matched = 0;
+
+	for (i = 0; i < nr_ops; i++)
+		matched += (dm_regex_match(scanner, _names[i % DM_ARRAY_SIZE(_names)]) >= 0);
+
+	T_ASSERT(matched);
+}
+
 #define T(path, desc, fn) register_test(ts, "/base/regex/" path, desc, fn)
 
 void regex_tests(struct dm_list *all_tests)
@@ -124,6 +179,10 @@ void regex_tests(struct dm_list *all_tests)
 	T("fingerprints", "not sure", test_fingerprints);
 	T("matching", "test the matcher with a variety of regexes", test_matching);
 	T("kabi-query", "test the matcher with some specific patterns", test_kabi_query);
+	T("prefilter", "strings without a required literal never match", test_prefilter);
+
+	register_bench(ts, "/base/regex/bench/match", "match device names against filter patterns",
+		       _bench_match, 1000000, 0);
 
 	dm_list_add(all_tests, &ts->list);
 }
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/metadata/pv_map.h"
+
+//----------------------------------------------------------------
+
+#define NR_SEGS 2000
+
+struct fixture {
+	struct dm_pool *mem;
+	struct device dev;
+	struct physical_volume pv;
+	struct volume_group vg;
+	struct dm_list pvs;
+	struct pv_list pvl;
+	struct pv_map *pvm;
+};
+
+static void *_fixture_init(void)
+{
+	struct fixture *f = zalloc(sizeof(*f));
+	struct lv_segment *used = (struct lv_segment *) f;	/* Any non-NULL */
+	struct pv_segment *peg;
+	struct dm_list *pvms;
+	uint32_t pe = 0, len, i, r = 1;
+
+	T_ASSERT(f);
+	T_ASSERT(f->mem = dm_pool_create("pv_map test", 64 * 1024));
+
+	dm_list_init(&f->dev.aliases);
+	f->pv.dev = &f->dev;
+	f->pv.status = ALLOCATABLE_PV;
+	dm_list_init(&f->pv.segments);
+
+	/* Alternate allocated and free segments of assorted lengths */
+	for (i = 0; i < NR_SEGS; i++) {
+		r = r * 1103515245 + 12345;
+		len = 1 + (r >> 16) % 37;
+		T_ASSERT(peg = dm_pool_zalloc(f->mem, sizeof(*peg)));
+		peg->pv = &f->pv;
+		peg->pe = pe;
+		peg->len = len;
+		peg->lvseg = (i & 1) ? used : NULL;
+		dm_list_add(&f->pv.segments, &peg->list);
+		pe += len;
+	}
+	f->pv.pe_count = pe;
+
+	f->vg.name = "vg_test";
+	dm_list_init(&f->pvs);
+	f->pvl.pv = &f->pv;
+	dm_list_add(&f->pvs, &f->pvl.list);
+
+	T_ASSERT(pvms = create_pv_maps(f->mem, &f->vg, &f->pvs));
+	T_ASSERT(!dm_list_empty(pvms));
+	f->pvm = dm_list_item(dm_list_first(pvms), struct pv_map);
+
+	return f;
+}
+
+static void _fixture_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	dm_pool_destroy(f->mem);
+	free(f);
+}
+
+//----------------------------------------------------------------
+
+/* Largest first, equal sizes in the order inserted */
+static void _check_order(struct pv_map *pvm)
+{
+	struct pv_area *pva, *prev = NULL;
+	uint32_t pe_count = 0;
+
+	dm_list_iterate_items(pva, &pvm->areas) {
+		if (prev) {
+			T_ASSERT(prev->size_key >= pva->size_key);
+			if (prev->size_key == pva->size_key)
+				T_ASSERT(prev->seq < pva->seq);
+		}
+		T_ASSERT(find_pv_area_at(pvm, pva->start));
+		pe_count += pva->count;
+		prev = pva;
+	}
+
+	T_ASSERT_EQUAL(pe_count, pvm->pe_count);
+}
+
+static void test_create(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct pv_segment *peg;
+	struct pv_area *pva;
+	unsigned nr = 0;
+
+	_check_order(f->pvm);
+
+	dm_list_iterate_items(pva, &f->pvm->areas)
+		nr++;
+	T_ASSERT_EQUAL(nr, NR_SEGS / 2);
+
+	dm_list_iterate_items(peg, &f->pv.segments) {
+		pva = find_pv_area_at(f->pvm, peg->pe);
+		if (peg->lvseg)
+			T_ASSERT(!pva);
+		else {
+			T_ASSERT(pva);
+			T_ASSERT_EQUAL(pva->start, peg->pe);
+			T_ASSERT_EQUAL(pva->count, peg->len);
+		}
+	}
+}
+
+static void test_consume(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct pv_area *pva;
+	uint32_t start, count, pe_count = f->pvm->pe_count;
+	unsigned i;
+
+	for (i = 0; i < NR_SEGS; i++) {
+		if (dm_list_empty(&f->pvm->areas))
+			break;
+		pva = dm_list_item(dm_list_first(&f->pvm->areas), struct pv_area);
+		start = pva->start;
+		count = pva->count;
+		consume_pv_area(pva, 1);
+		pe_count--;
+
+		T_ASSERT(!find_pv_area_at(f->pvm, start));
+		T_ASSERT_EQUAL(f->pvm->pe_count, pe_count);
+		if (count > 1)
+			T_ASSERT(find_pv_area_at(f->pvm, start + 1) == pva);
+	}
+
+	_check_order(f->pvm);
+}
+
+static void test_reinsert(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct pv_area *pva, *changed[NR_SEGS / 2];
+	unsigned i, nr = 0;
+
+	/* Reinsertion moves areas along the list so pick them up first */
+	dm_list_iterate_items(pva, &f->pvm->areas)
+		if (pva->count > 1 && (pva->start & 1))
+			changed[nr++] = pva;
+
+	for (i = 0; i < nr; i++) {
+		changed[i]->unreserved = changed[i]->count / 2;
+		reinsert_changed_pv_area(changed[i]);
+	}
+
+	_check_order(f->pvm);
+
+	for (i = 0; i < nr; i++) {
+		changed[i]->unreserved = changed[i]->count;
+		reinsert_changed_pv_area(changed[i]);
+	}
+
+	_check_order(f->pvm);
+
+	dm_list_iterate_items(pva, &f->pvm->areas)
+		T_ASSERT_EQUAL(pva->size_key, pva->count);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/metadata/pv_map/" path, desc, fn)
+
+void pv_map_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fixture_init, _fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("create", "areas are indexed by size and start PE", test_create);
+	T("consume", "consumed areas move within both indexes", test_consume);
+	T("reinsert", "reduced areas are sorted by unreserved extents", test_reinsert);
+
+	dm_list_add(all_tests, &ts->list);
+}
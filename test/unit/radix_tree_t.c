@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 //----------------------------------------------------------------
 
@@ -808,8 +809,177 @@ static void test_bcache_scenario3(void *fixture)
 	#include "test/unit/rt_case1.c"
 }
 
+#define NR_BENCH_BLOCKS 100000
+
+// A fresh tree for each call, so this includes destroying it.
+static void _bench_insert(void *fixture, unsigned nr_ops)
+{
+	struct radix_tree *rt;
+	unsigned i;
+
+	T_ASSERT(rt = radix_tree_create(NULL, NULL));
+	for (i = 0; i < nr_ops; i++)
+		__insert(rt, i % 8, (i / 8) * 3, i);
+	radix_tree_destroy(rt);
+}
+
+// The warmup call fills the fixture with bcache style keys.
+static void _bench_lookup(void *fixture, unsigned nr_ops)
+{
+	struct radix_tree *rt = fixture;
+	union key k;
+	union radix_value v;
+	unsigned i, r = 1;
+
+	if (!radix_tree_size(rt))
+		for (i = 0; i < NR_BENCH_BLOCKS; i++)
+			__insert(rt, i % 8, (i / 8) * 3, i);
+
+	for (i = 0; i < nr_ops; i++) {
+		r = r * 1103515245 + 12345;
+		k.parts.fd = (r >> 8) % 8;
+		k.parts.b = ((r >> 11) % (NR_BENCH_BLOCKS / 8)) * 3;
+		T_ASSERT(radix_tree_lookup(rt, k.bytes, k.bytes + sizeof(k.bytes), &v));
+	}
+}
+
+static int _entry_cmp(const void *lhs, const void *rhs)
+{
+	const struct radix_tree_entry *l = lhs, *r = rhs;
+
+	return memcmp(l->kb, r->kb, sizeof(union key));
+}
+
+static void test_bulk_load(void *fixture)
+{
+	struct radix_tree *rt = fixture, *rt2;
+	const unsigned nr_blocks = 100000;
+	struct radix_tree_entry *es;
+	struct radix_tree_stats s1, s2;
+	union key *keys;
+	union radix_value v;
+	unsigned i;
+
+	T_ASSERT(keys = malloc(nr_blocks * sizeof(*keys)));
+	T_ASSERT(es = malloc(nr_blocks * sizeof(*es)));
+
+	for (i = 0; i < nr_blocks; i++) {
+		keys[i].parts.fd = i % 8;
+		keys[i].parts.b = (i / 8) * 3;
+		es[i].kb = keys[i].bytes;
+		es[i].ke = keys[i].bytes + sizeof(keys[i].bytes);
+		es[i].v.n = i;
+	}
+
+	for (i = 0; i < nr_blocks; i++)
+		T_ASSERT(radix_tree_insert(rt, es[i].kb, es[i].ke, es[i].v));
+
+	qsort(es, nr_blocks, sizeof(*es), _entry_cmp);
+	T_ASSERT(rt2 = radix_tree_create(NULL, NULL));
+
+	T_ASSERT(radix_tree_bulk_load(rt2, es, nr_blocks));
+
+	T_ASSERT(radix_tree_is_well_formed(rt2));
+	T_ASSERT_EQUAL(radix_tree_size(rt2), nr_blocks);
+
+	for (i = 0; i < nr_blocks; i++) {
+		T_ASSERT(radix_tree_lookup(rt2, keys[i].bytes, keys[i].bytes + sizeof(keys[i].bytes), &v));
+		T_ASSERT_EQUAL(v.n, i);
+	}
+
+	radix_tree_stats(rt, &s1);
+	radix_tree_stats(rt2, &s2);
+	T_ASSERT_EQUAL(s1.nr_entries, nr_blocks);
+	T_ASSERT_EQUAL(s2.nr_entries, nr_blocks);
+	T_ASSERT(s2.bytes <= s1.bytes);
+
+	// Already loaded
+	T_ASSERT(!radix_tree_bulk_load(rt2, es, nr_blocks));
+
+	radix_tree_destroy(rt2);
+	free(es);
+	free(keys);
+}
+
+static void test_bulk_load_prefix_keys(void *fixture)
+{
+	struct radix_tree *rt = fixture;
+	struct radix_tree_entry es[32];
+	union radix_value v;
+	uint8_t k[32];
+	unsigned i;
+
+	_gen_key(k, k + sizeof(k));
+	for (i = 0; i < 32; i++) {
+		es[i].kb = k;
+		es[i].ke = k + i + 1;
+		es[i].v.n = i;
+	}
+
+	T_ASSERT(radix_tree_bulk_load(rt, es, 32));
+	T_ASSERT(radix_tree_is_well_formed(rt));
+	T_ASSERT_EQUAL(radix_tree_size(rt), 32);
+
+	for (i = 0; i < 32; i++) {
+		T_ASSERT(radix_tree_lookup(rt, k, k + i + 1, &v));
+		T_ASSERT_EQUAL(v.n, i);
+	}
+}
+
+static void test_bulk_load_unsorted(void *fixture)
+{
+	struct radix_tree *rt = fixture;
+	struct radix_tree_entry es[3];
+	uint8_t k[3] = {1, 2, 3};
+	unsigned i;
+
+	for (i = 0; i < 3; i++) {
+		es[i].kb = k + i;
+		es[i].ke = k + i + 1;
+		es[i].v.n = i;
+	}
+
+	// {1}, {2}, {1}
+	es[2].kb = k;
+	es[2].ke = k + 1;
+	T_ASSERT(!radix_tree_bulk_load(rt, es, 3));
+
+	// {1}, {2}, {2}
+	es[2].kb = k + 1;
+	es[2].ke = k + 2;
+	T_ASSERT(!radix_tree_bulk_load(rt, es, 3));
+	T_ASSERT_EQUAL(radix_tree_size(rt), 0);
+
+	T_ASSERT(radix_tree_bulk_load(rt, es, 2));
+	T_ASSERT_EQUAL(radix_tree_size(rt), 2);
+}
+
+static void test_stats(void *fixture)
+{
+	struct radix_tree *rt = fixture;
+	struct radix_tree_stats s;
+	union radix_value v;
+	uint8_t k;
+
+	radix_tree_stats(rt, &s);
+	T_ASSERT_EQUAL(s.nr_entries, 0);
+	T_ASSERT_EQUAL(s.nr_nodes, 0);
+
+	for (k = 0; k < 20; k++) {
+		v.n = k;
+		T_ASSERT(radix_tree_insert(rt, &k, &k + 1, v));
+	}
+
+	radix_tree_stats(rt, &s);
+	T_ASSERT_EQUAL(s.nr_entries, 20);
+	T_ASSERT_EQUAL(s.nr_node48, 1);
+	T_ASSERT_EQUAL(s.nr_nodes, 1);
+	T_ASSERT(s.bytes > 0);
+}
+
 //----------------------------------------------------------------
 #define T(path, desc, fn) register_test(ts, "/base/data-struct/radix-tree/" path, desc, fn)
+#define B(path, desc, fn, nr) register_bench(ts, "/base/data-struct/radix-tree/bench/" path, desc, fn, nr, 0)
 
 void radix_tree_tests(struct dm_list *all_tests)
 {
@@ -844,6 +1014,13 @@ void radix_tree_tests(struct dm_list *all_tests)
 	T("bcache-scenario", "A specific series of keys from a bcache scenario", test_bcache_scenario);
 	T("bcache-scenario-2", "A second series of keys from a bcache scenario", test_bcache_scenario2);
 	T("bcache-scenario-3", "A third series of keys from a bcache scenario", test_bcache_scenario3);
+	T("bulk-load", "bulk load 100k bcache blocks", test_bulk_load);
+	T("bulk-load-prefix-keys", "bulk load keys that are prefixes of each other", test_bulk_load_prefix_keys);
+	T("bulk-load-unsorted", "bulk load rejects unsorted and duplicate keys", test_bulk_load_unsorted);
+	T("stats", "node counts by type", test_stats);
+
+	B("insert", "insert 10^5 bcache style keys", _bench_insert, NR_BENCH_BLOCKS);
+	B("lookup", "lookup among 10^5 bcache style keys", _bench_lookup, 1000000);
 
 	dm_list_add(all_tests, &ts->list);
 }
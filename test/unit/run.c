@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <setjmp.h>
+#include <time.h>
 #include <unistd.h>
 
 //-----------------------------------------------------------------
@@ -214,9 +215,102 @@ static bool _run_tests(struct test_details **tests, unsigned nr)
 	return passed == total;
 }
 
+//-----------------------------------------------------------------
+
+#define BENCH_WARMUP 1
+#define BENCH_REPETITIONS 5
+
+static uint64_t _now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int _cmp_u64(const void *lhs, const void *rhs)
+{
+	uint64_t l = *((const uint64_t *) lhs), r = *((const uint64_t *) rhs);
+
+	return (l > r) - (l < r);
+}
+
+// Reports the median and the best of the timed repetitions.
+static void _run_bench(struct test_details *t, bool use_colour, bool json,
+		       unsigned *passed, unsigned *total)
+{
+	uint64_t times[BENCH_REPETITIONS], start;
+	struct test_suite *ts = t->parent;
+	double ns, min_ns, mbs;
+	void *fixture;
+	unsigned i;
+
+	fprintf(stderr, "[BENCH  ] %s\n", t->path);
+
+	(*total)++;
+	if (setjmp(test_k)) {
+		fprintf(stderr, "%s[   FAIL]%s %s\n", red(use_colour), normal(use_colour), t->path);
+		return;
+	}
+
+	fixture = ts->fixture_init ? ts->fixture_init() : NULL;
+
+	for (i = 0; i < BENCH_WARMUP; i++)
+		t->bench_fn(fixture, t->nr_ops);
+
+	for (i = 0; i < BENCH_REPETITIONS; i++) {
+		start = _now_ns();
+		t->bench_fn(fixture, t->nr_ops);
+		times[i] = _now_ns() - start;
+	}
+
+	if (ts->fixture_exit)
+		ts->fixture_exit(fixture);
+
+	qsort(times, BENCH_REPETITIONS, sizeof(*times), _cmp_u64);
+	ns = (double) times[BENCH_REPETITIONS / 2] / t->nr_ops;
+	min_ns = (double) times[0] / t->nr_ops;
+	mbs = ns > 0 ? t->bytes_per_op * 1e3 / ns : 0.0;
+
+	if (json)
+		printf("%s\n  {\"path\": \"%s\", \"ops\": %u, \"repetitions\": %u, "
+		       "\"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, "
+		       "\"bytes_per_op\": %llu, \"mb_per_s\": %.1f}",
+		       *passed ? "," : "", t->path, t->nr_ops, BENCH_REPETITIONS,
+		       ns, min_ns, (unsigned long long) t->bytes_per_op, mbs);
+
+	(*passed)++;
+	if (t->bytes_per_op)
+		fprintf(stderr, "%s[     OK]%s %.1f ns/op, %.1f MB/s\n",
+			green(use_colour), normal(use_colour), ns, mbs);
+	else
+		fprintf(stderr, "%s[     OK]%s %.1f ns/op\n",
+			green(use_colour), normal(use_colour), ns);
+}
+
+static bool _run_benches(struct test_details **tests, unsigned nr, bool json)
+{
+	bool use_colour = isatty(fileno(stderr));
+	unsigned i, passed = 0, total = 0;
+
+	if (json)
+		printf("[");
+
+	for (i = 0; i < nr; i++)
+		_run_bench(tests[i], use_colour, json, &passed, &total);
+
+	if (json)
+		printf("\n]\n");
+
+	fprintf(stderr, "\n%u/%u benchmarks completed\n", passed, total);
+
+	return passed == total;
+}
+
 static void _usage(void)
 {
-	fprintf(stderr, "Usage: unit-test <list|run> [pattern]\n");
+	fprintf(stderr, "Usage: unit-test <list|run|bench [--json]> [pattern]\n");
 }
 
 static int _cmp_paths(const void *lhs, const void *rhs)
@@ -227,6 +321,17 @@ static int _cmp_paths(const void *lhs, const void *rhs)
 	return strcmp(l->path, r->path);
 }
 
+static unsigned _only_benches(bool benches, struct test_details **tests, unsigned nr)
+{
+	unsigned i, found = 0;
+
+	for (i = 0; i < nr; i++)
+		if (!tests[i]->bench_fn == !benches)
+			tests[found++] = tests[i];
+
+	return found;
+}
+
 static unsigned _filter(const char *pattern, struct test_details **tests, unsigned nr)
 {
 	unsigned i, found = 0;
@@ -248,7 +353,9 @@ static unsigned _filter(const char *pattern, struct test_details **tests, unsign
 
 int main(int argc, char **argv)
 {
-	int r;
+	int r, arg = 2;
+	bool json = false;
+	const char *cmd = (argc > 1) ? argv[1] : "run";
 	unsigned i, nr_tests;
 	struct test_suite *ts;
 	struct test_details *t, **t_array;
@@ -275,29 +382,38 @@ int main(int argc, char **argv)
 		dm_list_iterate_items (t, &ts->tests)
 			t_array[i++] = t;
 
+	if (!strcmp(cmd, "bench") && (argc > arg) && !strcmp(argv[arg], "--json")) {
+		json = true;
+		arg++;
+	}
+
 	// filter
-	if (argc == 3)
-		nr_tests = _filter(argv[2], t_array, nr_tests);
+	if (argc == arg + 1)
+		nr_tests = _filter(argv[arg], t_array, nr_tests);
 
 	// sort
 	qsort(t_array, nr_tests, sizeof(*t_array), _cmp_paths);
 
 	// run or list them
-	if (argc == 1)
+	if (argc > arg + 1) {
+		_usage();
+		r = 1;
+
+	} else if (!strcmp(cmd, "run")) {
+		nr_tests = _only_benches(false, t_array, nr_tests);
 		r = !_run_tests(t_array, nr_tests);
-	else {
-		const char *cmd = argv[1];
-		if (!strcmp(cmd, "run"))
-			r = !_run_tests(t_array, nr_tests);
-
-		else if (!strcmp(cmd, "list")) {
-			_list_tests(t_array, nr_tests);
-			r = 0;
-
-		} else {
-			_usage();
-			r = 1;
-		}
+
+	} else if (!strcmp(cmd, "bench")) {
+		nr_tests = _only_benches(true, t_array, nr_tests);
+		r = !_run_benches(t_array, nr_tests, json);
+
+	} else if (!strcmp(cmd, "list")) {
+		_list_tests(t_array, nr_tests);
+		r = 0;
+
+	} else {
+		_usage();
+		r = 1;
 	}
 
 	free(t_array);
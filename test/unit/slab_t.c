@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "device_mapper/all.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------
+
+#define NR_LIVE 1000
+
+struct obj {
+	uint64_t a;
+	char name[20];
+};
+
+static void *_fixture_init(void)
+{
+	struct dm_pool *mem = dm_pool_create("slab test", 1024);
+
+	T_ASSERT(mem);
+
+	return mem;
+}
+
+static void _fixture_exit(void *fixture)
+{
+	dm_pool_destroy(fixture);
+}
+
+//----------------------------------------------------------------
+
+static void test_alloc(void *fixture)
+{
+	struct dm_slab *s;
+	struct obj *o[NR_LIVE];
+	unsigned i;
+
+	T_ASSERT(s = dm_slab_create(fixture, sizeof(struct obj), 16));
+
+	for (i = 0; i < NR_LIVE; i++) {
+		T_ASSERT(o[i] = dm_slab_zalloc(s));
+		T_ASSERT(!o[i]->a && !o[i]->name[0]);
+		T_ASSERT(!((uintptr_t) o[i] % __alignof__(uint64_t)));
+		o[i]->a = i;
+		snprintf(o[i]->name, sizeof(o[i]->name), "obj%u", i);
+	}
+
+	for (i = 0; i < NR_LIVE; i++) {
+		T_ASSERT_EQUAL(o[i]->a, i);
+		T_ASSERT(!strncmp(o[i]->name, "obj", 3));
+	}
+}
+
+static void test_reuse(void *fixture)
+{
+	struct dm_slab *s;
+	void *o[NR_LIVE], *p;
+	unsigned i, j, r = 1;
+
+	T_ASSERT(s = dm_slab_create(fixture, sizeof(struct obj), 0));
+
+	for (i = 0; i < NR_LIVE; i++)
+		T_ASSERT(o[i] = dm_slab_alloc(s));
+
+	/* Freed objects come straight back */
+	dm_slab_free(s, o[7]);
+	T_ASSERT(dm_slab_alloc(s) == o[7]);
+
+	/* Churn never hands out anything beyond the objects seen so far */
+	for (i = 0; i < 100 * NR_LIVE; i++) {
+		r = r * 1103515245 + 12345;
+		j = (r >> 16) % NR_LIVE;
+		dm_slab_free(s, o[j]);
+		T_ASSERT(p = dm_slab_alloc(s));
+		T_ASSERT(p == o[j]);
+	}
+}
+
+static void test_tiny_objects(void *fixture)
+{
+	struct dm_slab *s;
+	char *a, *b;
+
+	T_ASSERT(!dm_slab_create(fixture, 0, 0));
+
+	/* Objects smaller than the free list link still work */
+	T_ASSERT(s = dm_slab_create(fixture, 1, 2));
+	T_ASSERT(a = dm_slab_alloc(s));
+	T_ASSERT(b = dm_slab_alloc(s));
+	T_ASSERT(a != b);
+
+	dm_slab_free(s, a);
+	dm_slab_free(s, b);
+	dm_slab_free(s, NULL);
+	T_ASSERT(dm_slab_alloc(s) == b);
+	T_ASSERT(dm_slab_alloc(s) == a);
+	T_ASSERT(dm_slab_alloc(s));
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/device-mapper/mm/slab/" path, desc, fn)
+
+void slab_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fixture_init, _fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("alloc", "objects are distinct, aligned and zeroed", test_alloc);
+	T("reuse", "freed objects are handed out again", test_reuse);
+	T("tiny-objects", "objects smaller than a pointer", test_tiny_objects);
+
+	dm_list_add(all_tests, &ts->list);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/datastruct/str_list.h"
+
+//----------------------------------------------------------------
+
+#define NR_TAGS 64
+
+struct fixture {
+	struct dm_pool *mem;
+	char tags[NR_TAGS][16];
+};
+
+static void *_fixture_init(void)
+{
+	struct fixture *f = zalloc(sizeof(*f));
+	unsigned i;
+
+	T_ASSERT(f);
+	T_ASSERT(f->mem = dm_pool_create("str_set test", 16 * 1024));
+
+	for (i = 0; i < NR_TAGS; i++)
+		snprintf(f->tags[i], sizeof(f->tags[i]), "tag%u", i);
+
+	return f;
+}
+
+static void _fixture_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	dm_pool_destroy(f->mem);
+	str_set_intern_destroy();
+	free(f);
+}
+
+/* List of the tags whose bit is set in mask, highest first */
+static struct dm_list *_list(struct fixture *f, uint64_t mask)
+{
+	struct dm_list *sll;
+	unsigned i;
+
+	T_ASSERT(sll = str_list_create(f->mem));
+
+	for (i = NR_TAGS; i--; )
+		if (mask & (UINT64_C(1) << i))
+			T_ASSERT(str_list_add(f->mem, sll, f->tags[i]));
+
+	return sll;
+}
+
+//----------------------------------------------------------------
+
+static void test_match(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct dm_list *sll, *sll2;
+	struct str_set *set, *set2;
+	const char *matched, *set_matched;
+	uint64_t m1, m2, r = 1;
+	unsigned i, j;
+
+	/* Same answers as the list functions on random subsets */
+	for (i = 0; i < 1000; i++) {
+		r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+		m1 = r & (r >> 7);
+		r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+		m2 = r & (r >> 11);
+
+		sll = _list(f, m1);
+		sll2 = _list(f, m2);
+		T_ASSERT(set = str_set_create(f->mem, sll, NULL));
+		T_ASSERT(set2 = str_set_create(f->mem, sll2, NULL));
+
+		T_ASSERT_EQUAL(str_set_match_set(set, set2), !!(m1 & m2));
+		T_ASSERT_EQUAL(str_set_match_list(set, sll2, &set_matched),
+			       str_list_match_list(sll2, sll, &matched));
+		if (m1 & m2)
+			T_ASSERT(set_matched == matched);
+
+		for (j = 0; j < NR_TAGS; j++)
+			T_ASSERT_EQUAL(str_set_match_item(set, f->tags[j]),
+				       !!(m1 & (UINT64_C(1) << j)));
+
+		dm_pool_empty(f->mem);
+	}
+}
+
+static void test_union(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct str_set *set;
+
+	/* Overlapping lists collapse to one entry per item */
+	T_ASSERT(set = str_set_create(f->mem, _list(f, 0xff), _list(f, 0xff0)));
+	T_ASSERT_EQUAL(set->count, 12);
+	T_ASSERT(str_set_match_item(set, "tag0"));
+	T_ASSERT(str_set_match_item(set, "tag11"));
+	T_ASSERT(!str_set_match_item(set, "tag12"));
+	T_ASSERT(!str_set_match_item(set, "never_interned"));
+
+	T_ASSERT(set = str_set_create(f->mem, _list(f, 0), NULL));
+	T_ASSERT_EQUAL(set->count, 0);
+	T_ASSERT(!str_set_match_list(set, _list(f, 1), NULL));
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/datastruct/str_set/" path, desc, fn)
+
+void str_set_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fixture_init, _fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("match", "set matching agrees with str_list matching", test_match);
+	T("union", "sets built from two lists hold each item once", test_union);
+
+	dm_list_add(all_tests, &ts->list);
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/format_text/import-export.h"
+#include "lib/misc/lvm-compress.h"
+
+//----------------------------------------------------------------
+
+static const char *_base_text =
+	"vg0 {\n"
+	"    id = \"vg-id\"\n"
+	"    seqno = 1\n"
+	"    physical_volumes {\n"
+	"        pv0 {\n"
+	"            id = \"pv-id\"\n"
+	"        }\n"
+	"    }\n"
+	"    logical_volumes {\n"
+	"        lv1 {\n"
+	"            id = \"lv1-id\"\n"
+	"            tags = [\"a\"]\n"
+	"        }\n"
+	"        lv2 {\n"
+	"            id = \"lv2-id\"\n"
+	"            segment1 {\n"
+	"                start_extent = 0\n"
+	"            }\n"
+	"        }\n"
+	"        lv3 {\n"
+	"            id = \"lv3-id\"\n"
+	"        }\n"
+	"    }\n"
+	"}\n"
+	"contents = \"Text Format Volume Group\"\n"
+	"version = 1\n";
+
+/* lv2 changed, lv3 removed and lv4 created. */
+static const char *_new_text =
+	"vg0 {\n"
+	"    id = \"vg-id\"\n"
+	"    seqno = 2\n"
+	"    physical_volumes {\n"
+	"        pv0 {\n"
+	"            id = \"pv-id\"\n"
+	"        }\n"
+	"    }\n"
+	"    logical_volumes {\n"
+	"        lv1 {\n"
+	"            id = \"lv1-id\"\n"
+	"            tags = [\"a\"]\n"
+	"        }\n"
+	"        lv2 {\n"
+	"            id = \"lv2-id\"\n"
+	"            segment1 {\n"
+	"                start_extent = 8\n"
+	"            }\n"
+	"        }\n"
+	"        lv4 {\n"
+	"            id = \"lv4-id\"\n"
+	"        }\n"
+	"    }\n"
+	"}\n"
+	"contents = \"Text Format Volume Group\"\n"
+	"version = 1\n";
+
+struct text_buf {
+	char text[4096];
+	size_t used;
+};
+
+static int _putline(const char *line, void *baton)
+{
+	struct text_buf *tb = baton;
+	size_t len = strlen(line);
+
+	if (tb->used + len + 2 > sizeof(tb->text))
+		return 0;
+
+	memcpy(tb->text + tb->used, line, len);
+	tb->used += len;
+	tb->text[tb->used++] = '\n';
+	tb->text[tb->used] = '\0';
+
+	return 1;
+}
+
+static void _assert_same_tree(struct dm_config_tree *a, struct dm_config_tree *b)
+{
+	struct text_buf *ta = zalloc(sizeof(*ta)), *tb = zalloc(sizeof(*tb));
+
+	T_ASSERT(ta && tb);
+	T_ASSERT(dm_config_write_node(a->root, _putline, ta));
+	T_ASSERT(dm_config_write_node(b->root, _putline, tb));
+	T_ASSERT(!strcmp(ta->text, tb->text));
+
+	free(ta);
+	free(tb);
+}
+
+static void test_round_trip(void *fixture)
+{
+	struct text_delta_base base = { .offset = 4608, .size = 512, .checksum = 0xdeadbeef };
+	struct text_delta_base base2;
+	struct dm_config_tree *cft_base, *cft_new, *cft_delta;
+	char *buf;
+	uint32_t buf_size;
+	size_t size;
+
+	T_ASSERT((cft_base = dm_config_from_string(_base_text)));
+	T_ASSERT((cft_new = dm_config_from_string(_new_text)));
+
+	base.count = 1;
+	size = text_delta_export(_new_text, strlen(_new_text) + 1, cft_base, &base, &buf, &buf_size);
+	T_ASSERT(size);
+	T_ASSERT(size <= buf_size);
+	T_ASSERT(!(buf_size % 65536));
+	T_ASSERT(text_is_delta(buf, size));
+
+	/* The unchanged LV is left out and the removed one named. */
+	T_ASSERT(!strstr(buf, "lv1"));
+	T_ASSERT(strstr(buf, "lv2"));
+	T_ASSERT(strstr(buf, "lv4"));
+	T_ASSERT(strstr(buf, "\"lv3\""));
+
+	T_ASSERT((cft_delta = dm_config_from_string(buf + DELTA_TEXT_MAGIC_LEN)));
+	T_ASSERT_EQUAL(text_delta_get_base(cft_delta, &base2), 1);
+	T_ASSERT_EQUAL(base2.offset, base.offset);
+	T_ASSERT_EQUAL(base2.size, base.size);
+	T_ASSERT_EQUAL(base2.checksum, base.checksum);
+	T_ASSERT_EQUAL(base2.count, 1);
+
+	T_ASSERT(text_delta_merge(cft_delta, cft_base));
+	T_ASSERT_EQUAL(text_delta_get_base(cft_delta, &base2), 0);
+	_assert_same_tree(cft_delta, cft_new);
+
+	free(buf);
+	dm_config_destroy(cft_delta);
+	dm_config_destroy(cft_new);
+	dm_config_destroy(cft_base);
+}
+
+static void test_other_vg(void *fixture)
+{
+	struct text_delta_base base = { .offset = 4608, .size = 512 };
+	struct dm_config_tree *cft_base;
+	char *buf;
+	uint32_t buf_size;
+	const char *other = "vg1 {\n    id = \"other\"\n}\n";
+
+	T_ASSERT((cft_base = dm_config_from_string(_base_text)));
+	T_ASSERT(!text_delta_export(other, strlen(other) + 1, cft_base, &base, &buf, &buf_size));
+
+	dm_config_destroy(cft_base);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/metadata/text_delta/" path, desc, fn)
+
+void text_delta_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(NULL, NULL);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("round-trip", "a merged delta matches the full metadata", test_round_trip);
+	T("other-vg", "no delta against another VG", test_other_vg);
+
+	dm_list_add(all_tests, &ts->list);
+}
@@ -25,13 +25,20 @@ void bcache_tests(struct dm_list *suites);
 void bcache_utils_tests(struct dm_list *suites);
 void bitset_tests(struct dm_list *suites);
 void config_tests(struct dm_list *suites);
+void crc_tests(struct dm_list *suites);
 void dm_list_tests(struct dm_list *suites);
 void dm_status_tests(struct dm_list *suites);
+void dm_stats_row_tests(struct dm_list *suites);
+void hash_tests(struct dm_list *suites);
 void io_engine_tests(struct dm_list *suites);
 void percent_tests(struct dm_list *suites);
+void pv_map_tests(struct dm_list *suites);
 void radix_tree_tests(struct dm_list *suites);
 void regex_tests(struct dm_list *suites);
+void slab_tests(struct dm_list *suites);
+void str_set_tests(struct dm_list *suites);
 void string_tests(struct dm_list *suites);
+void text_delta_tests(struct dm_list *suites);
 void vdo_tests(struct dm_list *suites);
 
 // ... and call it in here.
@@ -42,13 +49,20 @@ static inline void register_all_tests(struct dm_list *suites)
 	bcache_utils_tests(suites);
 	bitset_tests(suites);
 	config_tests(suites);
+	crc_tests(suites);
 	dm_list_tests(suites);
 	dm_status_tests(suites);
+	dm_stats_row_tests(suites);
+	hash_tests(suites);
 	io_engine_tests(suites);
 	percent_tests(suites);
+	pv_map_tests(suites);
 	radix_tree_tests(suites);
 	regex_tests(suites);
+	slab_tests(suites);
+	str_set_tests(suites);
 	string_tests(suites);
+	text_delta_tests(suites);
 	vdo_tests(suites);
 }
 
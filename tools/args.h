@@ -78,6 +78,13 @@ arg(atversion_ARG, '\0', "atversion", string_VAL, 0, 0,
     "which does not contain any newer settings for which LVM would\n"
     "issue a warning message when checking the configuration.\n")
 
+arg(batchfile_ARG, '\0', "batchfile", string_VAL, 0, 0,
+    "Create one LV for each line of the named file (- for stdin)\n"
+    "in a single metadata update. Each line holds an LV name and\n"
+    "its size, e.g. \"lvol1 10G\". The size uses the units of\n"
+    "\\fB--size\\fP, or of \\fB--virtualsize\\fP for thin LVs. Empty lines and\n"
+    "lines starting with # are ignored.\n")
+
 arg(binary_ARG, '\0', "binary", 0, 0, 0,
     "Use binary values \"0\" or \"1\" instead of descriptive literal values\n"
     "for columns that have exactly two valid values to report (not counting\n"
@@ -132,6 +139,14 @@ arg(cachedevice_ARG, '\0', "cachedevice", pv_VAL, ARG_GROUPABLE, 0,
 arg(cachesize_ARG, '\0', "cachesize", sizemb_VAL, 0, 0,
     "The size of cache to use.\n")
 
+arg(cached_ARG, '\0', "cached", number_VAL, 0, 0,
+    "Report from the copies of VG metadata kept in /run/lvm/vgs_cached\n"
+    "by the commands that last read or changed each VG, without scanning\n"
+    "devices or taking VG locks. The output may not be current.\n"
+    "The number is the age in seconds beyond which a VG's copy is\n"
+    "considered stale, a warning is printed for each stale VG.\n"
+    "VGs that no command has read since boot are not reported.\n")
+
 arg(commandprofile_ARG, '\0', "commandprofile", string_VAL, 0, 0,
     "The command profile to use for command configuration.\n"
     "See \\fBlvm.conf\\fP(5) for more information about profiles.\n")
@@ -595,7 +610,9 @@ arg(reportformat_ARG, '\0', "reportformat", reportformat_VAL, 0, 0,
     "\\fBbasic\\fP is the original format with columns and rows.\n"
     "If there is more than one report per command, each report is prefixed\n"
     "with the report name for identification. \\fBjson\\fP produces report\n"
-    "output in JSON format. See \\fBlvmreport\\fP(7) for more information.\n")
+    "output in JSON format. \\fBbinary\\fP writes typed values by column\n"
+    "for programs, the layout is described with DM_REPORT_GROUP_BINARY\n"
+    "in libdevmapper. See \\fBlvmreport\\fP(7) for more information.\n")
 
 arg(restorefile_ARG, '\0', "restorefile", string_VAL, 0, 0,
     "In conjunction with --uuid, this reads the file (produced by\n"
@@ -742,6 +759,13 @@ arg(systemid_ARG, '\0', "systemid", string_VAL, 0, 0,
 arg(thinpool_ARG, '\0', "thinpool", lv_VAL, 0, 0,
     "The name of a thin pool LV.\n")
 
+arg(timing_ARG, '\0', "timing", 0, 0, 0,
+    "Report the time spent in phases of the command such as device\n"
+    "scanning, filtering, locking, metadata reading and writing,\n"
+    "activation and waiting for udev. With report/command_log enabled\n"
+    "the times are reported as log report rows of type timing, so they\n"
+    "are included in --reportformat json output.\n")
+
 arg(trackchanges_ARG, '\0', "trackchanges", 0, 0, 0,
     "Can be used with --splitmirrors on a raid1 LV. This causes\n"
     "changes to the original raid1 LV to be tracked while the split images\n"
@@ -1083,7 +1107,7 @@ arg(interval_ARG, 'i', "interval", number_VAL, 0, 0,
 /* Not used */
 arg(iop_version_ARG, 'i', "iop_version", 0, 0, 0, NULL)
 
-arg(stripes_ARG, 'i', "stripes", number_VAL, 0, 0,
+arg(stripes_ARG, 'i', "stripes", stripes_VAL, 0, 0,
     "Specifies the number of stripes in a striped LV. This is the number of\n"
     "PVs (devices) that a striped LV is spread across. Data that\n"
     "appears sequential in the LV is spread across multiple devices in units of\n"
@@ -1095,11 +1119,17 @@ arg(stripes_ARG, 'i', "stripes", number_VAL, 0, 0,
     "when unspecified, the default depends on the RAID type\n"
     "(raid0: 2, raid10: 2, raid4/5: 3, raid6: 5.)\n"
     "To stripe a new raid LV across all PVs by default,\n"
-    "see lvm.conf allocation/raid_stripe_all_devices.\n")
+    "see lvm.conf allocation/raid_stripe_all_devices.\n"
+    "When lvcreate creates a striped LV, \\fBauto\\fP uses one stripe for\n"
+    "each disk with free extents among the PVs, counting the partitions\n"
+    "of a disk once.\n")
 
-arg(stripesize_ARG, 'I', "stripesize", sizekb_VAL, 0, 0,
+arg(stripesize_ARG, 'I', "stripesize", stripesize_VAL, 0, 0,
     "The amount of data that is written to one device before\n"
-    "moving to the next in a striped LV.\n")
+    "moving to the next in a striped LV.\n"
+    "When lvcreate creates a striped LV, \\fBauto\\fP uses the optimal\n"
+    "I/O size the PVs report, e.g. the full stripe of a RAID array, or\n"
+    "its largest power of 2 factor, limited to the extent size.\n")
 
 arg(logicalvolume_ARG, 'l', "logicalvolume", uint32_VAL, 0, 0,
     "Sets the maximum number of LVs allowed in a VG.\n")
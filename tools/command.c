@@ -112,6 +112,8 @@ static inline int segtype_arg(struct cmd_context *cmd, struct arg_values *av) {
 static inline int alloc_arg(struct cmd_context *cmd, struct arg_values *av) { return 0; }
 static inline int locktype_arg(struct cmd_context *cmd, struct arg_values *av) { return 0; }
 static inline int readahead_arg(struct cmd_context *cmd, struct arg_values *av) { return 0; }
+static inline int stripes_arg(struct cmd_context *cmd, struct arg_values *av) { return 0; }
+static inline int stripesize_arg(struct cmd_context *cmd, struct arg_values *av) { return 0; }
 static inline int regionsize_mb_arg(struct cmd_context *cmd, struct arg_values *av) { return 0; }
 static inline int vgmetadatacopies_arg(struct cmd_context *cmd __attribute__((unused)), struct arg_values *av) { return 0; }
 static inline int pvmetadatacopies_arg(struct cmd_context *cmd __attribute__((unused)), struct arg_values *av) { return 0; }
@@ -1373,8 +1375,6 @@ static int _copy_line(char *line, int max_line, int *position)
 	int p = *position;
 	int i = 0;
 
-	memset(line, 0, max_line);
-
 	while (1) {
 		line[i] = _command_input[p];
 		i++;
@@ -1388,6 +1388,7 @@ static int _copy_line(char *line, int max_line, int *position)
 		if (i == (max_line - 1))
 			break;
 	}
+	line[i] = '\0';
 	*position = p;
 	return 1;
 }
@@ -1423,10 +1424,19 @@ int define_commands(struct cmd_context *cmdtool, const char *run_name)
 		if (!strcmp(line, "---") || !strcmp(line, "--"))
 			continue;
 
+		/*
+		 * Lines of a definition being skipped need no parsing.  Only
+		 * a new command name, the ID, or an OO_FOO definition shared
+		 * by all commands can matter.
+		 */
+		if (skip && !prev_was_oo_def && !islower(line[0]) &&
+		    strncmp(line, "ID:", 3) && strncmp(line, "OO_", 3))
+			continue;
+
 		if ((n = strchr(line, '\n')))
 			*n = '\0';
 
-		memcpy(line_orig, line, sizeof(line));
+		memcpy(line_orig, line, strlen(line) + 1);
 		_split_line(line, &line_argc, line_argv, ' ');
 
 		if (!line_argc)
@@ -42,6 +42,8 @@ struct command_name {
 	int valid_args[ARG_COUNT]; /* used for getopt */
 	int num_args;
 
+	int first_command; /* first def in commands[] with this name, or -1 */
+
 	/* the following are for generating help and man page output */
 	int common_options[ARG_COUNT]; /* options common to all defs */
 	int all_options[ARG_COUNT];    /* union of options from all defs */
@@ -185,6 +187,7 @@ struct command {
 	const char *command_id; /* ID string in command-lines.in */
 	int command_enum; /* <command_id>_CMD */
 	int command_index; /* position in commands[] */
+	int next_same_name; /* next def in commands[] with this name, or -1 */
 
 	const struct command_function *functions; /* new style */
 	command_fn fn;                      /* old style */
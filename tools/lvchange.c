@@ -1075,6 +1075,10 @@ static int _lvchange_deduplication(struct logical_volume *lv, uint32_t *mr)
 /* Update and reload or commit and/or backup metadata for @lv as requested by @mr */
 static int _commit_reload(struct logical_volume *lv, uint32_t mr)
 {
+	/* Property changes leave the rest of the VG untouched */
+	if ((mr & (MR_RELOAD | MR_COMMIT)) && !vg_mark_lv_changed(lv))
+		return_0;
+
 	if (mr & MR_RELOAD) {
 		if (!lv_update_and_reload(lv))
 			return_0;
@@ -92,6 +92,9 @@ struct convert_poll_id_list {
 	struct poll_operation_id *id;
 	unsigned is_merging_origin:1;
 	unsigned is_merging_origin_thin:1;
+	unsigned active_begin:1;	/* writecache detach: LV was active */
+	unsigned remove_cache:1;	/* writecache detach: remove cachevol */
+	struct cache_flush_progress flush;
 };
 
 /* FIXME Temporary function until the enum replaces the separate variables */
@@ -3508,6 +3511,8 @@ static int _cache_vol_attach(struct cmd_context *cmd,
 	char *lockd_fast_args = NULL;
 	char *lockd_fast_name = NULL;
 	struct id lockd_fast_id;
+	struct lv_io_sample sample;
+	int sample_time;
 	int r = 0;
 
 	if (!validate_lv_cache_create_pool(lv_fast))
@@ -3516,6 +3521,20 @@ static int _cache_vol_attach(struct cmd_context *cmd,
 	if (!get_cache_params(cmd, &chunk_size, &cache_metadata_format, &cache_mode, &policy_name, &policy_settings))
 		goto_out;
 
+	/* Without a given chunk size, size chunks for the I/O the LV is seeing */
+	if (!chunk_size &&
+	    ((sample_time = find_config_tree_int(cmd, allocation_cache_chunk_size_sample_time_CFG, lv->profile)) > 0) &&
+	    lv_is_active(lv)) {
+		if (!lv_sample_io(lv, (unsigned) sample_time, &sample))
+			log_warn("WARNING: Failed to sample I/O of %s, using default chunk size.",
+				 display_lvname(lv));
+		else if ((chunk_size = cache_chunk_size_from_sample(&sample)))
+			log_print_unless_silent("Using cache chunk size %s for " FMTu64 " I/Os of %s average in %u of %u areas.",
+						display_size(cmd, chunk_size), sample.ios,
+						display_size(cmd, sample.sectors / sample.ios),
+						sample.areas_used, sample.areas);
+	}
+
 	if (!archive(vg))
 		goto_out;
 
@@ -3661,9 +3680,8 @@ static struct convert_poll_id_list* _convert_poll_id_list_create(struct cmd_cont
 struct lvconvert_result {
 	unsigned need_polling:1;
 	unsigned wait_cleaner_writecache:1;
-	unsigned active_begin:1;
-	unsigned remove_cache:1;
 	struct dm_list poll_idls;
+	int lv_argc;	/* leading position args naming LVs to repair */
 };
 
 
@@ -3791,13 +3809,15 @@ static int _lvconvert_repair_pvs_raid(struct cmd_context *cmd, struct logical_vo
 static int _lvconvert_repair_pvs(struct cmd_context *cmd, struct logical_volume *lv,
 			struct processing_handle *handle)
 {
+	struct lvconvert_result *lr = (struct lvconvert_result *) handle->custom_handle;
 	struct dm_list *failed_pvs;
 	struct dm_list *use_pvh;
 	int ret;
 
-	if (cmd->position_argc > 1) {
-		/* First pos arg is required LV, remaining are optional PVs. */
-		if (!(use_pvh = create_pv_list(cmd->mem, lv->vg, cmd->position_argc - 1, cmd->position_argv + 1, 0)))
+	if (cmd->position_argc > lr->lv_argc) {
+		/* Leading pos args are LVs, remaining are optional PVs. */
+		if (!(use_pvh = create_pv_list(cmd->mem, lv->vg, cmd->position_argc - lr->lv_argc,
+					       cmd->position_argv + lr->lv_argc, 0)))
 			return_ECMD_FAILED;
 	} else
 		use_pvh = &lv->vg->pvs;
@@ -3820,6 +3840,7 @@ static int _lvconvert_repair_pvs(struct cmd_context *cmd, struct logical_volume
 static int _lvconvert_repair_cachepool_thinpool(struct cmd_context *cmd, struct logical_volume *lv,
 			struct processing_handle *handle)
 {
+	struct lvconvert_result *lr = (struct lvconvert_result *) handle->custom_handle;
 	int poolmetadataspare = arg_int_value(cmd, poolmetadataspare_ARG, DEFAULT_POOL_METADATA_SPARE);
 	struct dm_list *use_pvh;
 
@@ -3827,9 +3848,10 @@ static int _lvconvert_repair_cachepool_thinpool(struct cmd_context *cmd, struct
 	if (!lockd_lv(cmd, lv, "ex", 0))
 		return_0;
 
-	if (cmd->position_argc > 1) {
-		/* First pos arg is required LV, remaining are optional PVs. */
-		if (!(use_pvh = create_pv_list(cmd->mem, lv->vg, cmd->position_argc - 1, cmd->position_argv + 1, 0)))
+	if (cmd->position_argc > lr->lv_argc) {
+		/* Leading pos args are LVs, remaining are optional PVs. */
+		if (!(use_pvh = create_pv_list(cmd->mem, lv->vg, cmd->position_argc - lr->lv_argc,
+					       cmd->position_argv + lr->lv_argc, 0)))
 			return_ECMD_FAILED;
 	} else
 		use_pvh = &lv->vg->pvs;
@@ -3873,11 +3895,29 @@ int lvconvert_repair_cmd(struct cmd_context *cmd, int argc, char **argv)
 	struct processing_handle *handle;
 	struct lvconvert_result lr = { 0 };
 	struct convert_poll_id_list *idl;
+	const char *vg_name;
 	int saved_ignore_suspended_devices;
 	int ret, poll_ret;
 
 	dm_list_init(&lr.poll_idls);
 
+	/*
+	 * With --usepolicies more LVs of the same VG may precede the PVs,
+	 * so dmeventd can repair all LVs hit by one failed device with one
+	 * scan and VG lock.  PVs are given as device paths, so they never
+	 * look like VG/LV.
+	 */
+	lr.lv_argc = 1;
+	if (arg_is_set(cmd, usepolicies_ARG) && (cmd->position_argv[0][0] != '/') &&
+	    strchr(cmd->position_argv[0], '/')) {
+		if (!(vg_name = dm_pool_strndup(cmd->mem, cmd->position_argv[0],
+						strchr(cmd->position_argv[0], '/') - cmd->position_argv[0])))
+			return_ECMD_FAILED;
+		while ((lr.lv_argc < cmd->position_argc) &&
+		       is_vg_lv_arg(cmd->position_argv[lr.lv_argc], vg_name))
+			lr.lv_argc++;
+	}
+
 	if (!(handle = init_processing_handle(cmd, NULL))) {
 		log_error("Failed to initialize processing handle.");
 		return ECMD_FAILED;
@@ -3890,7 +3930,7 @@ int lvconvert_repair_cmd(struct cmd_context *cmd, int argc, char **argv)
 
 	cmd->handles_missing_pvs = 1;
 
-	ret = process_each_lv(cmd, 1, cmd->position_argv, NULL, NULL, READ_FOR_UPDATE,
+	ret = process_each_lv(cmd, lr.lv_argc, cmd->position_argv, NULL, NULL, READ_FOR_UPDATE,
 			      handle, NULL, &_lvconvert_repair_single);
 
 	init_ignore_suspended_devices(saved_ignore_suspended_devices);
@@ -4963,19 +5003,22 @@ static int _lvconvert_split_cache_single(struct cmd_context *cmd,
 		return ECMD_FAILED;
 
 	if (lv_is_writecache(lv_main)) {
+		struct lvconvert_result *lr = (struct lvconvert_result *) handle->custom_handle;
+		unsigned waiting = dm_list_size(&lr->poll_idls);
+
 		if (!_lvconvert_detach_writecache(cmd, handle, lv_main, lv_fast))
 			return ECMD_FAILED;
 
 		if (cmd->command->command_enum == lvconvert_split_and_remove_cache_CMD) {
-			struct lvconvert_result *lr = (struct lvconvert_result *) handle->custom_handle;
 			/*
-			 * If detach is ongoing, then the remove needs to wait
-			 * until _lvconvert_detach_writecache_when_clean(),
-			 * after the detach has finished. When lr->remove_cache
-			 * has been set, when_clean() knows it should remove
-			 * lv_fast at the end.
+			 * If detach is ongoing (this LV was queued), then the
+			 * remove needs to wait until
+			 * _lvconvert_detach_writecache_when_clean(), after the
+			 * detach has finished. When idl->remove_cache has been
+			 * set, when_clean() knows it should remove lv_fast at
+			 * the end.
 			 */
-			if (!lr->wait_cleaner_writecache) {
+			if (dm_list_size(&lr->poll_idls) == waiting) {
 				if (lvremove_single(cmd, lv_fast, NULL) != ECMD_PROCESSED)
 					return ECMD_FAILED;
 			}
@@ -5021,6 +5064,114 @@ static int _lvconvert_split_cache_single(struct cmd_context *cmd,
 	return ECMD_PROCESSED;
 }
 
+/*
+ * State of the up front flush of a multi LV --splitcache.
+ */
+struct lvconvert_flush {
+	unsigned start:1;		/* first round: switch to cleaner */
+	unsigned pending;		/* caches still dirty this round */
+	unsigned wait_ms;		/* time before the next round */
+	struct dm_hash_table *progress;	/* lvid -> cache_flush_progress */
+};
+
+static int _lvconvert_flush_cache_single(struct cmd_context *cmd, struct logical_volume *lv,
+					 struct processing_handle *handle)
+{
+	struct lvconvert_flush *lf = (struct lvconvert_flush *) handle->custom_handle;
+	struct cache_flush_progress *fp;
+	uint64_t dirty;
+	unsigned ms;
+
+	/*
+	 * Only dm-cache LVs named directly are flushed up front, anything
+	 * else is left to the split itself.  Writecache LVs are already
+	 * cleaned together at the end of the split.
+	 */
+	if (!lv_is_cache(lv))
+		return ECMD_PROCESSED;
+
+	if (lf->start && !lockd_lv(cmd, lv, "ex", 0))
+		return ECMD_FAILED;
+
+	if (!lv_cache_flush_start(lv, &dirty))
+		return ECMD_FAILED;
+
+	if (!dirty)
+		return ECMD_PROCESSED;
+
+	if (!(fp = dm_hash_lookup(lf->progress, lv->lvid.s))) {
+		if (!(fp = dm_pool_alloc(cmd->mem, sizeof(*fp))) ||
+		    !dm_hash_insert(lf->progress, lv->lvid.s, fp)) {
+			log_error("Failed to track flushing of %s.", display_lvname(lv));
+			return ECMD_FAILED;
+		}
+		cache_flush_progress_init(fp);
+	}
+
+	ms = cache_flush_progress(fp, lv, dirty);
+	if (ms < lf->wait_ms)
+		lf->wait_ms = ms;
+	lf->pending++;
+
+	return ECMD_PROCESSED;
+}
+
+/*
+ * With several LVs, switch all of their caches to the cleaner first and
+ * wait for them together, so the caches are flushed concurrently rather
+ * than one after the other by the split of each LV.
+ */
+static int _lvconvert_split_cache_flush(struct cmd_context *cmd)
+{
+	struct processing_handle *handle;
+	struct lvconvert_flush lf = { .start = 1, .wait_ms = UINT_MAX };
+	int ret;
+
+	if (!(lf.progress = dm_hash_create(32))) {
+		log_error("Failed to allocate flush table.");
+		return 0;
+	}
+
+	if (!(handle = init_processing_handle(cmd, NULL))) {
+		log_error("Failed to initialize processing handle.");
+		dm_hash_destroy(lf.progress);
+		return 0;
+	}
+
+	handle->custom_handle = &lf;
+
+	activation_event_arm();
+	ret = process_each_lv(cmd, cmd->position_argc, cmd->position_argv, NULL, NULL,
+			      READ_FOR_UPDATE, handle, NULL, &_lvconvert_flush_cache_single);
+	lf.start = 0;
+
+	while ((ret != ECMD_FAILED) && lf.pending) {
+		sigint_allow();
+		activation_event_wait(lf.wait_ms);
+		sigint_restore();
+
+		if (sigint_caught()) {
+			sigint_clear();
+			log_error("Flushing of caches interrupted, rerun the command to complete.");
+			ret = ECMD_FAILED;
+			break;
+		}
+
+		lf.pending = 0;
+		lf.wait_ms = UINT_MAX;
+
+		/* Arm before reading status so no event is missed */
+		activation_event_arm();
+		ret = process_each_lv(cmd, cmd->position_argc, cmd->position_argv, NULL, NULL,
+				      0, handle, NULL, &_lvconvert_flush_cache_single);
+	}
+
+	destroy_processing_handle(cmd, handle);
+	dm_hash_destroy(lf.progress);
+
+	return ret != ECMD_FAILED;
+}
+
 int lvconvert_split_cache_cmd(struct cmd_context *cmd, int argc, char **argv)
 {
 	struct processing_handle *handle;
@@ -5036,8 +5187,14 @@ int lvconvert_split_cache_cmd(struct cmd_context *cmd, int argc, char **argv)
 	}
 
 	handle->custom_handle = &lr;
+	dm_list_init(&lr.poll_idls);
 
-	ret = process_each_lv(cmd, 1, cmd->position_argv, NULL, NULL, READ_FOR_UPDATE,
+	if ((cmd->position_argc > 1) && !_lvconvert_split_cache_flush(cmd)) {
+		destroy_processing_handle(cmd, handle);
+		return ECMD_FAILED;
+	}
+
+	ret = process_each_lv(cmd, cmd->position_argc, cmd->position_argv, NULL, NULL, READ_FOR_UPDATE,
 			       handle, NULL, &_lvconvert_split_cache_single);
 
 	destroy_processing_handle(cmd, handle);
@@ -5537,8 +5694,6 @@ static int _lvconvert_detach_writecache(struct cmd_context *cmd,
 	int is_clean = 0;
 	int noflush = 0;
 
-	dm_list_init(&lr->poll_idls);
-
 	memset(&settings, 0, sizeof(settings));
 
 	if (!get_writecache_settings(cmd, &settings, &block_size_sectors)) {
@@ -5646,11 +5801,11 @@ static int _lvconvert_detach_writecache(struct cmd_context *cmd,
 		 * held since the writeback can take some time.
 		 */
 		lr->wait_cleaner_writecache = 1;
-		lr->active_begin = active_begin;
+		idl->active_begin = active_begin;
+		cache_flush_progress_init(&idl->flush);
 
 		/* The command wants to remove the cache after detaching. */
-		if (cmd->command->command_enum == lvconvert_split_and_remove_cache_CMD)
-			lr->remove_cache = 1;
+		idl->remove_cache = (cmd->command->command_enum == lvconvert_split_and_remove_cache_CMD);
 
 		dm_list_add(&lr->poll_idls, &idl->list);
 		return 1;
@@ -5679,29 +5834,24 @@ static int _lvconvert_detach_writecache(struct cmd_context *cmd,
 }
 
 /*
- * _lvconvert_detach_writecache() set the cleaner option for the LV
- * so writecache will begin writing back data from cache to origin.
- * It then saved the LV name/id (lvconvert_result/poll_id), and
- * exited process_each_lv (releasing the VG and VG lock).  Then
- * this is called to monitor the progress of the cache writeback.
- * When the cache is clean, this does the detach (writecache is removed
- * in metadata and LV in kernel is updated.)
+ * Check one LV queued by _lvconvert_detach_writecache() and, when its
+ * writecache is clean, do the detach.  *done is set once the LV needs
+ * no further checks; while cleaning goes on *wait_ms is lowered to the
+ * time suggested before the next check of this LV.
  */
-static int _lvconvert_detach_writecache_when_clean(struct cmd_context *cmd,
-						   struct lvconvert_result *lr)
+static int _lvconvert_detach_writecache_if_clean(struct cmd_context *cmd,
+						 struct convert_poll_id_list *idl,
+						 int *done, unsigned *wait_ms)
 {
-	struct convert_poll_id_list *idl;
-	struct poll_operation_id *id;
+	struct poll_operation_id *id = idl->id;
 	struct volume_group *vg;
 	struct logical_volume *lv;
 	struct logical_volume *lv_fast;
-	uint32_t lockd_state, error_flags;
+	uint32_t lockd_state = 0, error_flags = 0;
 	uint64_t dirty;
+	unsigned ms;
 	int ret;
 
-	idl = dm_list_item(dm_list_first(&lr->poll_idls), struct convert_poll_id_list);
-	id = idl->id;
-
 	/*
 	 * TODO: we should be able to save info about the dm device for this LV
 	 * and monitor the dm device status without doing vg lock/read around
@@ -5711,9 +5861,7 @@ static int _lvconvert_detach_writecache_when_clean(struct cmd_context *cmd,
 	 * than the LV going away here.
 	 */
 
- retry:
-	lockd_state = 0;
-	error_flags = 0;
+	*done = 1;
 
 	if (!lockd_vg(cmd, id->vg_name, "ex", 0, &lockd_state)) {
 		log_error("Detaching writecache interrupted - locking VG failed.");
@@ -5752,18 +5900,20 @@ static int _lvconvert_detach_writecache_when_clean(struct cmd_context *cmd,
 	}
 
 	if (!lv_writecache_is_clean(cmd, lv, &dirty)) {
+		ms = cache_flush_progress(&idl->flush, lv, dirty);
+		if (ms < *wait_ms)
+			*wait_ms = ms;
+
 		unlock_and_release_vg(cmd, vg, vg->name);
 
 		if (!lockd_vg(cmd, id->vg_name, "un", 0, &lockd_state))
 			stack;
 
-		log_print_unless_silent("Detaching writecache cleaning %llu blocks", (unsigned long long)dirty);
-		log_print_unless_silent("This command can be cancelled and rerun to complete writecache detach.");
-		sleep(5);
-		goto retry;
+		*done = 0;
+		return 1;
 	}
 
-	if (!lr->active_begin) {
+	if (!idl->active_begin) {
 		/*
 		 * The LV was not active to begin so we should leave it inactive at the end.
 		 * It will remain inactive during detach since it's clean and doesn't need
@@ -5792,7 +5942,7 @@ static int _lvconvert_detach_writecache_when_clean(struct cmd_context *cmd,
 	 * The detach was started by an uncache command that wants to remove
 	 * the cachevol after detaching.
 	 */
-	if (lr->remove_cache) {
+	if (idl->remove_cache) {
 		if (lvremove_single(cmd, lv_fast, NULL) != ECMD_PROCESSED) {
 			log_error("Removing the writecache cachevol failed.");
 			ret = 0;
@@ -5815,6 +5965,49 @@ out_lockd:
 	return ret;
 }
 
+/*
+ * _lvconvert_detach_writecache() set the cleaner option for each LV
+ * so writecache will begin writing back data from cache to origin.
+ * It then saved the LV name/id (lvconvert_result/poll_id), and
+ * exited process_each_lv (releasing the VG and VG lock).  Then
+ * this is called to monitor the progress of the cache writeback of
+ * all of them at once.  When a cache is clean, this does its detach
+ * (writecache is removed in metadata and LV in kernel is updated.)
+ *
+ * Between rounds of checks this waits for a dm event or for the time
+ * suggested by the observed cleaning rate of the fastest cache.
+ */
+static int _lvconvert_detach_writecache_when_clean(struct cmd_context *cmd,
+						   struct lvconvert_result *lr)
+{
+	struct convert_poll_id_list *idl, *tmp;
+	unsigned wait_ms;
+	int done, ret = 1;
+
+	log_print_unless_silent("This command can be cancelled and rerun to complete writecache detach.");
+
+	for (;;) {
+		wait_ms = UINT_MAX;
+
+		/* Arm before reading status so no event is missed */
+		activation_event_arm();
+
+		dm_list_iterate_items_safe(idl, tmp, &lr->poll_idls) {
+			if (!_lvconvert_detach_writecache_if_clean(cmd, idl, &done, &wait_ms))
+				ret = 0;
+			if (done)
+				dm_list_del(&idl->list);
+		}
+
+		if (dm_list_empty(&lr->poll_idls))
+			break;
+
+		activation_event_wait(wait_ms);
+	}
+
+	return ret;
+}
+
 static int _writecache_zero(struct cmd_context *cmd, struct logical_volume *lv)
 {
 	struct wipe_params wp = {
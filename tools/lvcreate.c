@@ -28,6 +28,13 @@ struct lvcreate_cmdline_params {
 struct processing_params {
 	struct lvcreate_params *lp;
 	struct lvcreate_cmdline_params *lcp;
+	struct dm_list *batch;	/* struct lvcreate_batch_entry */
+};
+
+struct lvcreate_batch_entry {
+	struct dm_list list;
+	const char *lv_name;
+	uint64_t size;
 };
 
 static int _set_vg_name(struct lvcreate_params *lp, const char *vg_name)
@@ -243,6 +250,63 @@ static int _lvcreate_name_params(struct cmd_context *cmd,
  * NOTE: We must do this here because of the dm_percent_t typedef and because we
  * need the vg.
  */
+/*
+ * --stripes auto uses one stripe for each disk with free extents among
+ * the PVs, PVs on partitions of the same disk count once.
+ * --stripesize auto uses the optimal I/O size the PVs report, so each
+ * stripe covers whole full stripes of an underlying RAID array.  Stripe
+ * sizes must be powers of 2, so for a full stripe that is not one, its
+ * largest power of 2 factor is used, normally the array's chunk size.
+ */
+static int _choose_stripe_geometry(struct volume_group *vg, struct lvcreate_params *lp)
+{
+	struct cmd_context *cmd = vg->cmd;
+	struct physical_volume *pv;
+	struct pv_list *pvl;
+	dev_t disks[MAX_STRIPES], primary;
+	unsigned long hint = 0, io_size;
+	uint32_t nr_disks = 0, stripe_size, i;
+
+	dm_list_iterate_items(pvl, lp->pvh) {
+		pv = pvl->pv;
+		if (!pv->dev || !(pv->status & ALLOCATABLE_PV) ||
+		    (pv->pe_alloc_count >= pv->pe_count))
+			continue;
+
+		if (dev_get_primary_dev(cmd->dev_types, pv->dev, &primary) != 2)
+			primary = pv->dev->dev;
+
+		for (i = 0; i < nr_disks; i++)
+			if (disks[i] == primary)
+				break;
+		if ((i == nr_disks) && (nr_disks < MAX_STRIPES))
+			disks[nr_disks++] = primary;
+
+		if ((io_size = dev_optimal_io_size(cmd->dev_types, pv->dev)))
+			hint = hint ? lcm(hint, io_size) : io_size;
+	}
+
+	if (lp->stripes_auto)
+		lp->stripes = nr_disks ? : 1;
+
+	if (lp->stripe_size_auto && (lp->stripes > 1)) {
+		stripe_size = find_config_tree_int(cmd, metadata_stripesize_CFG, NULL) * 2;
+
+		if (hint && ((hint & -hint) > stripe_size))
+			stripe_size = (hint & -hint) > vg->extent_size ? vg->extent_size : (uint32_t) (hint & -hint);
+
+		lp->stripe_size = stripe_size;
+	}
+
+	if (lp->stripes > 1)
+		log_print_unless_silent("Using %u stripes with stripesize %s.",
+					lp->stripes, display_size(cmd, (uint64_t) lp->stripe_size));
+	else if (lp->stripes_auto)
+		log_print_unless_silent("Using a single stripe, the PVs have free space on one disk.");
+
+	return validate_stripe_params(cmd, lp->segtype, &lp->stripes, &lp->stripe_size);
+}
+
 static int _update_extents_params(struct volume_group *vg,
 				  struct lvcreate_params *lp,
 				  struct lvcreate_cmdline_params *lcp)
@@ -275,6 +339,10 @@ static int _update_extents_params(struct volume_group *vg,
 	} else
 		lp->pvh = &vg->pvs;
 
+	if ((lp->stripes_auto || lp->stripe_size_auto) &&
+	    !_choose_stripe_geometry(vg, lp))
+		return_0;
+
 	switch (lcp->percent) {
 		case PERCENT_VG:
 			extents = percent_of_extents(lp->extents, base_calc_extents = vg->extent_count, 0);
@@ -467,7 +535,8 @@ static int _read_size_params(struct cmd_context *cmd,
 	} else if (arg_is_set(cmd, size_ARG)) {
 		lcp->size = arg_uint64_value(cmd, size_ARG, UINT64_C(0));
 		lcp->percent = PERCENT_NONE;
-	} else if (!lp->snapshot && !seg_is_thin_volume(lp)) {
+	} else if (!lp->snapshot && !seg_is_thin_volume(lp) &&
+		   !arg_is_set(cmd, batchfile_ARG)) {
 		log_error("Please specify either size or extents.");
 		return 0;
 	}
@@ -817,6 +886,7 @@ static int _lvcreate_params(struct cmd_context *cmd,
 	alloc_ARG,\
 	autobackup_ARG,\
 	available_ARG,\
+	batchfile_ARG,\
 	contiguous_ARG,\
 	ignoreactivationskip_ARG,\
 	ignoremonitoring_ARG,\
@@ -1027,7 +1097,7 @@ static int _lvcreate_params(struct cmd_context *cmd,
 						-1))
 			return_0;
 
-		if (!arg_is_set(cmd, virtualsize_ARG)) {
+		if (!arg_is_set(cmd, virtualsize_ARG) && !arg_is_set(cmd, batchfile_ARG)) {
 			/* Without virtual size could be creation of thin-pool or snapshot */
 			if (lp->create_pool) {
 				if (lp->type) {
@@ -1180,6 +1250,9 @@ static int _lvcreate_params(struct cmd_context *cmd,
 			lp->wipe_signatures = 0;
 	}
 
+	lp->stripes_auto = stripe_arg_is_auto(cmd, stripes_ARG);
+	lp->stripe_size_auto = stripe_arg_is_auto(cmd, stripesize_ARG);
+
 	if (!_lvcreate_name_params(cmd, &argc, &argv, lp) ||
 	    !_read_size_params(cmd, lp, lcp) ||
 	    !get_stripe_params(cmd, lp->segtype, &lp->stripes, &lp->stripe_size, &lp->stripes_supplied, &lp->stripe_size_supplied) ||
@@ -1802,6 +1875,228 @@ int lvcreate(struct cmd_context *cmd, int argc, char **argv)
 	return ret;
 }
 
+/*
+ * Read "name size" lines for --batchfile.
+ * Snapshots take their size from the origin so only "name" is listed.
+ */
+static struct dm_list *_read_batch_file(struct cmd_context *cmd,
+					struct lvcreate_params *lp)
+{
+	const char *path = arg_str_value(cmd, batchfile_ARG, NULL);
+	struct dm_list *batch;
+	struct lvcreate_batch_entry *entry;
+	struct arg_values av = { 0 };
+	char buf[NAME_LEN + 64];
+	char *name, *size, *end;
+	const char *vg_name;
+	unsigned line = 0;
+	FILE *fp;
+
+	if (!(batch = dm_pool_zalloc(cmd->mem, sizeof(*batch)))) {
+		log_error("Failed to allocate batch list.");
+		return NULL;
+	}
+
+	dm_list_init(batch);
+
+	if (!strcmp(path, "-"))
+		fp = stdin;
+	else if (!(fp = fopen(path, "r"))) {
+		log_sys_error("fopen", path);
+		return NULL;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		line++;
+
+		if (!strchr(buf, '\n') && !feof(fp)) {
+			log_error("Line %u of %s is too long.", line, path);
+			goto bad;
+		}
+
+		name = buf + strspn(buf, " \t\n");
+		if (!*name || (*name == '#'))
+			continue;
+
+		end = name + strcspn(name, " \t\n");
+		if (*end)
+			*end++ = '\0';
+		size = end + strspn(end, " \t\n");
+		end = size + strcspn(size, " \t\n");
+		if (*end)
+			*end++ = '\0';
+
+		if (lp->snapshot) {
+			if (*size) {
+				log_error("Line %u of %s is not \"name\".", line, path);
+				goto bad;
+			}
+		} else if (!*size || end[strspn(end, " \t\n")]) {
+			log_error("Line %u of %s is not \"name size\".", line, path);
+			goto bad;
+		}
+
+		if (!(entry = dm_pool_zalloc(cmd->mem, sizeof(*entry))) ||
+		    !(entry->lv_name = dm_pool_strdup(cmd->mem, name))) {
+			log_error("Failed to allocate batch entry.");
+			goto bad;
+		}
+
+		vg_name = lp->vg_name;
+		if (!validate_restricted_lvname_param(cmd, &vg_name, &entry->lv_name))
+			goto_bad;
+
+		if (vg_name && lp->vg_name && strcmp(vg_name, lp->vg_name)) {
+			log_error("Logical volume %s on line %u of %s is not in volume group %s.",
+				  name, line, path, lp->vg_name);
+			goto bad;
+		}
+
+		if (*size) {
+			av.value = size;
+			if (!size_mb_arg(cmd, &av) || (av.sign != SIGN_NONE) || !av.ui64_value) {
+				log_error("Invalid size %s on line %u of %s.", size, line, path);
+				goto bad;
+			}
+			entry->size = av.ui64_value;
+		}
+
+		dm_list_add(batch, &entry->list);
+	}
+
+	if (ferror(fp)) {
+		log_sys_error("fgets", path);
+		goto bad;
+	}
+
+	if (fp != stdin && fclose(fp))
+		log_sys_error("fclose", path);
+
+	if (dm_list_empty(batch)) {
+		log_error("No logical volumes listed in %s.", path);
+		return NULL;
+	}
+
+	return batch;
+bad:
+	if (fp != stdin && fclose(fp))
+		log_sys_error("fclose", path);
+
+	return NULL;
+}
+
+static int _lvcreate_batch_single(struct cmd_context *cmd, const char *vg_name,
+				  struct volume_group *vg, struct processing_handle *handle)
+{
+	struct processing_params *pp = (struct processing_params *) handle->custom_handle;
+	struct lvcreate_params *lp = pp->lp;
+	struct lvcreate_cmdline_params *lcp = pp->lcp;
+	struct lvcreate_batch_entry *entry;
+	struct lvcreate_batch_lv *blv;
+	struct dm_list batch;
+
+	if (vg_is_shared(vg)) {
+		log_error("Batch creation of LVs is not supported in shared VG %s.", vg->name);
+		return ECMD_FAILED;
+	}
+
+	if (!_read_activation_params(cmd, vg, lp))
+		return_ECMD_FAILED;
+
+	/* Without size only thin snapshots are possible */
+	if (lp->snapshot && !_determine_snapshot_type(vg, lp, lcp))
+		return_ECMD_FAILED;
+
+	if (seg_is_thin(lp) && !_check_thin_parameters(vg, lp, lcp))
+		return_ECMD_FAILED;
+
+	if (!_check_pool_parameters(cmd, vg, lp, lcp))
+		return_ECMD_FAILED;
+
+	if (!_check_zero_parameters(cmd, lp))
+		return_ECMD_FAILED;
+
+	if (!_update_extents_params(vg, lp, lcp))
+		return_ECMD_FAILED;
+
+	if (vg->lock_type && !strcmp(vg->lock_type, "sanlock") &&
+	    !handle_sanlock_lv(cmd, vg)) {
+		log_error("No space for sanlock lock, extend the internal lvmlock LV.");
+		return ECMD_FAILED;
+	}
+
+	dm_list_init(&batch);
+
+	dm_list_iterate_items(entry, pp->batch) {
+		if (!(blv = dm_pool_zalloc(cmd->mem, sizeof(*blv)))) {
+			log_error("Failed to allocate batch entry.");
+			return ECMD_FAILED;
+		}
+
+		blv->lv_name = entry->lv_name;
+		if (entry->size &&
+		    !(blv->extents = extents_from_size(cmd, entry->size, vg->extent_size)))
+			return_ECMD_FAILED;
+
+		dm_list_add(&batch, &blv->list);
+	}
+
+	if (!lv_create_batch(vg, lp, &batch))
+		return_ECMD_FAILED;
+
+	return ECMD_PROCESSED;
+}
+
+int lvcreate_batch_cmd(struct cmd_context *cmd, int argc, char **argv)
+{
+	struct processing_handle *handle = NULL;
+	struct processing_params pp;
+	struct lvcreate_params lp = {
+		.major = -1,
+		.minor = -1,
+	};
+	struct lvcreate_cmdline_params lcp = { 0 };
+	int ret;
+
+	if (arg_from_list_is_set(cmd, "is unsupported with --batchfile",
+				 name_ARG, major_ARG, minor_ARG, persistent_ARG,
+				 -1))
+		return EINVALID_CMD_LINE;
+
+	if (!_lvcreate_params(cmd, argc, argv, &lp, &lcp)) {
+		stack;
+		return EINVALID_CMD_LINE;
+	}
+
+	if (lp.create_pool || (lp.snapshot && (lp.extents || lcp.size)) ||
+	    !(seg_is_striped(&lp) || seg_is_thin_volume(&lp) || lp.snapshot)) {
+		log_error("Only linear, striped, thin LVs and thin snapshots can be created with --batchfile.");
+		return EINVALID_CMD_LINE;
+	}
+
+	pp.lp = &lp;
+	pp.lcp = &lcp;
+
+	if (!(pp.batch = _read_batch_file(cmd, &lp))) {
+		stack;
+		return EINVALID_CMD_LINE;
+	}
+
+	if (!(handle = init_processing_handle(cmd, NULL))) {
+		log_error("Failed to initialize processing handle.");
+		return ECMD_FAILED;
+	}
+
+	handle->custom_handle = &pp;
+
+	ret = process_each_vg(cmd, 0, NULL, lp.vg_name, NULL, READ_FOR_UPDATE, 0, handle,
+			      &_lvcreate_batch_single);
+
+	_destroy_lvcreate_params(&lp);
+	destroy_processing_handle(cmd, handle);
+	return ret;
+}
+
 static int _lvcreate_and_attach_writecache_single(struct cmd_context *cmd,
 		const char *vg_name, struct volume_group *vg, struct processing_handle *handle)
 {
@@ -225,6 +225,8 @@ int lvm_shell(struct cmd_context *cmd, struct cmdline_context *cmdline)
 	_cmdline = cmdline;
 
 	cmd->is_interactive = 1;
+	cmd->reuse_parsed_metadata = 1;
+	cmd->keep_scan_state = 1;
 
 	if (!report_format_init(cmd))
 		return_ECMD_FAILED;
@@ -336,6 +338,8 @@ int lvm_shell(struct cmd_context *cmd, struct cmdline_context *cmdline)
 
 	log_restore_report_state(saved_log_report_state);
 	cmd->is_interactive = 0;
+	cmd->reuse_parsed_metadata = 0;
+	cmd->keep_scan_state = 0;
 
 	free(input);
 
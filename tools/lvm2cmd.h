@@ -42,6 +42,7 @@ typedef void (*lvm2_log_fn_t) (int level, const char *file, int line,
 #define LVM2_INVALID_PARAMETERS	3	/* EINVALID_CMD_LINE */
 #define LVM2_INIT_FAILED	4	/* EINIT_FAILED */
 #define LVM2_PROCESSING_FAILED	5	/* ECMD_FAILED */
+#define LVM2_POLL_IN_PROGRESS	6	/* lvpoll single check found work left */
 
 /*
  * Define external function to replace the built-in logging function.
@@ -70,6 +71,13 @@ void *lvm2_init_threaded(void);
  */
 void lvm2_disable_dmeventd_monitoring(void *handle);
 
+/*
+ * Make lvpoll check the polled LV once and return instead of sleeping
+ * between checks.  lvm2_run then returns LVM2_POLL_IN_PROGRESS while
+ * the operation still has work left.  Used by lvmpolld.
+ */
+void lvm2_poll_single_check(void *handle);
+
 /*
  * Set log level (as above) if using built-in logging function. 
  * Default is LVM2_LOG_PRINT.  Use LVM2_LOG_SUPPRESS to suppress output.
@@ -80,6 +88,11 @@ void lvm2_log_level(void *handle, int level);
  * Run an LVM2 command. 
  * Use NULL handle if the call is a one-off and you don't want to bother 
  * calling lvm2_init/lvm2_exit.
+ *
+ * lvm2_init, lvm2_run and lvm2_exit may be called from several threads,
+ * with one handle or several.  Commands still run one at a time in the
+ * process, as the device and metadata caches are shared by all handles;
+ * use separate processes to run commands in parallel.
  */
 int lvm2_run(void *handle, const char *cmdline);
 
@@ -24,21 +24,54 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <sys/resource.h>
+#include <pthread.h>
+
+/*
+ * The device cache, bcache, lvmcache, locking and logging state behind
+ * every handle is process wide, so handles are initialised, used and
+ * released one at a time.  Scan state kept between commands belongs to
+ * the handle that last ran one and is dropped when another handle runs.
+ */
+static pthread_mutex_t _cmdlib_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct cmd_context *_scan_state_owner;
 
 void *cmdlib_lvm2_init(unsigned static_compile, unsigned threaded)
 {
 	struct cmd_context *cmd;
 
+	pthread_mutex_lock(&_cmdlib_mutex);
+
 	init_is_static(static_compile);
 	if (!(cmd = init_lvm(1, 1, threaded)))
-		return NULL;
+		goto out;
+
+	if (!lvm_register_commands(cmd, NULL)) {
+		cmd = NULL;
+		goto out;
+	}
+
+	/* Handle is reused by lvm2_run() so parsed metadata and scan state can be too. */
+	cmd->reuse_parsed_metadata = 1;
+	cmd->keep_scan_state = 1;
 
-	if (!lvm_register_commands(cmd, NULL))
-		return NULL;
+	/* Initialisation reset the device cache the previous owner kept */
+	_scan_state_owner = NULL;
+out:
+	pthread_mutex_unlock(&_cmdlib_mutex);
 
 	return (void *) cmd;
 }
 
+static void _take_scan_state(struct cmd_context *cmd)
+{
+	if (_scan_state_owner && (_scan_state_owner != cmd)) {
+		log_debug("Dropping scan state kept by another handle.");
+		label_scan_destroy(cmd);
+	}
+
+	_scan_state_owner = cmd;
+}
+
 int lvm2_run(void *handle, const char *cmdline)
 {
 	int argc, ret, oneoff = 0;
@@ -57,6 +90,10 @@ int lvm2_run(void *handle, const char *cmdline)
 
 	cmd = (struct cmd_context *) handle;
 
+	pthread_mutex_lock(&_cmdlib_mutex);
+
+	_take_scan_state(cmd);
+
 	cmd->argv = argv;
 
 	if (!(cmdcopy = strdup(cmdline))) {
@@ -83,16 +120,26 @@ int lvm2_run(void *handle, const char *cmdline)
 		memlock_inc_daemon(cmd);
 	} else if (!strcmp(cmdline, "_memlock_dec"))
 		memlock_dec_daemon(cmd);
-	else if (!strcmp(cmdline, "_dmeventd_thin_command")) {
+	else if (!strcmp(cmdline, "_dev_cache_scan")) {
+		/* Warm the kept list of system devices ahead of the first command */
+		dev_cache_scan_if_changed();
+		_scan_state_owner = cmd;
+	} else if (!strcmp(cmdline, "_dmeventd_thin_command")) {
 		if (setenv(cmdline, find_config_tree_str(cmd, dmeventd_thin_command_CFG, NULL), 1))
 			ret = ECMD_FAILED;
 	} else if (!strcmp(cmdline, "_dmeventd_vdo_command")) {
 		if (setenv(cmdline, find_config_tree_str(cmd, dmeventd_vdo_command_CFG, NULL), 1))
 			ret = ECMD_FAILED;
-	} else
+	} else {
+		cmd->poll_in_progress = 0;
 		ret = lvm_run_command(cmd, argc, argv);
+		if ((ret == ECMD_PROCESSED) && cmd->poll_in_progress)
+			ret = LVM2_POLL_IN_PROGRESS;
+	}
 
       out:
+	pthread_mutex_unlock(&_cmdlib_mutex);
+
 	free(cmdcopy);
 
 	if (oneoff)
@@ -106,6 +153,11 @@ void lvm2_disable_dmeventd_monitoring(void *handle)
 	init_run_by_dmeventd((struct cmd_context *) handle);
 }
 
+void lvm2_poll_single_check(void *handle)
+{
+	((struct cmd_context *) handle)->poll_single_check = 1;
+}
+
 void lvm2_log_level(void *handle, int level)
 {
 	struct cmd_context *cmd = (struct cmd_context *) handle;
@@ -122,5 +174,12 @@ void lvm2_exit(void *handle)
 {
 	struct cmd_context *cmd = (struct cmd_context *) handle;
 
+	pthread_mutex_lock(&_cmdlib_mutex);
+
+	if (_scan_state_owner == cmd)
+		_scan_state_owner = NULL;
+
 	lvm_fin(cmd);
+
+	pthread_mutex_unlock(&_cmdlib_mutex);
 }
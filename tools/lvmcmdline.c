@@ -158,6 +158,9 @@ static const struct command_function _command_functions[CMD_COUNT] = {
 	{ lvcreate_and_attach_cachedevice_for_cache_CMD,	lvcreate_and_attach_cache_cmd },
 	{ lvcreate_and_attach_cachevol_for_writecache_CMD,	lvcreate_and_attach_writecache_cmd },
 	{ lvcreate_and_attach_cachedevice_for_writecache_CMD,	lvcreate_and_attach_writecache_cmd },
+	{ lvcreate_batch_CMD,					lvcreate_batch_cmd },
+	{ lvcreate_thin_vol_batch_CMD,				lvcreate_batch_cmd },
+	{ lvcreate_thin_snapshot_batch_CMD,			lvcreate_batch_cmd },
 
 	{ pvscan_display_CMD, pvscan_display_cmd },
 	{ pvscan_cache_CMD, pvscan_cache_cmd },
@@ -946,6 +949,28 @@ int readahead_arg(struct cmd_context *cmd __attribute__((unused)), struct arg_va
 	return 1;
 }
 
+/* "auto" is left for lvcreate to choose from the PVs, see stripe_arg_is_auto() */
+int stripes_arg(struct cmd_context *cmd, struct arg_values *av)
+{
+	if (!strcmp(av->value, "auto")) {
+		av->ui_value = 0;
+		return 1;
+	}
+
+	return int_arg(cmd, av);
+}
+
+int stripesize_arg(struct cmd_context *cmd, struct arg_values *av)
+{
+	if (!strcmp(av->value, "auto")) {
+		av->ui_value = 0;
+		av->ui64_value = 0;
+		return 1;
+	}
+
+	return size_kb_arg(cmd, av);
+}
+
 int regionsize_mb_arg(struct cmd_context *cmd, struct arg_values *av)
 {
 	int pagesize = lvm_getpagesize();
@@ -1054,7 +1079,8 @@ int syncaction_arg(struct cmd_context *cmd, struct arg_values *av)
 int reportformat_arg(struct cmd_context *cmd, struct arg_values *av)
 {
 	if (!strcmp(av->value, "basic") ||
-	    !strcmp(av->value, "json"))
+	    !strcmp(av->value, "json") ||
+	    !strcmp(av->value, "binary"))
 		return 1;
 	return 0;
 }
@@ -1358,9 +1384,21 @@ int lvm_register_commands(struct cmd_context *cmd, const char *run_name)
 	for (i = 0; i < MAX_COMMAND_NAMES; i++) {
 		if (!command_names[i].name)
 			break;
+		command_names[i].first_command = -1;
 		_cmdline.num_command_names++;
 	}
 
+	/* Chain the defs of each command name so matching only visits those */
+	for (i = COMMAND_COUNT - 1; i >= 0; i--) {
+		struct command_name *cname = _find_command_name(commands[i].name);
+
+		commands[i].next_same_name = -1;
+		if (cname) {
+			commands[i].next_same_name = cname->first_command;
+			cname->first_command = i;
+		}
+	}
+
 	for (i = 0; i < _cmdline.num_command_names; i++)
 		_set_valid_args_for_command_name(i);
 
@@ -1656,23 +1694,24 @@ static struct command *_find_command(struct cmd_context *cmd, const char *path,
 	int opt_enum, opt_i;
 	int accepted, count;
 	int variants = 0;
+	int first;
+	struct command_name *cname;
 
 	name = last_path_component(path);
 
+	if (!(cname = _find_command_name(name)))
+		first = -1;
+	else
+		first = cname->first_command;
+
 	/* factor_common_options() is only for usage, so cname->variants is not set. */
-	for (i = 0; i < COMMAND_COUNT; i++) {
-		if (strcmp(name, commands[i].name))
-			continue;
+	for (i = first; i >= 0; i = commands[i].next_same_name)
 		variants++;
-	}
 
 	if (arg_is_set(cmd, type_ARG))
 		type_arg = arg_str_value(cmd, type_ARG, "");
 
-	for (i = 0; i < COMMAND_COUNT; i++) {
-		if (strcmp(name, commands[i].name))
-			continue;
-
+	for (i = first; i >= 0; i = commands[i].next_same_name) {
 		if (variants == 1)
 			only_i = i;
 
@@ -2419,6 +2458,9 @@ static int _get_current_settings(struct cmd_context *cmd)
 	if (cmd->cname->flags & CAN_USE_ONE_SCAN)
 		cmd->can_use_one_scan = 1;
 
+	cmd->read_without_lock = (cmd->cname->flags & CAN_USE_ONE_SCAN) ?
+		find_config_tree_bool(cmd, report_read_without_lock_CFG, NULL) : 0;
+
 	cmd->include_exported_vgs = (cmd->cname->flags & ALLOW_EXPORTED) ? 1 : 0;
 
 	cmd->scan_lvs = find_config_tree_bool(cmd, devices_scan_lvs_CFG, NULL);
@@ -2988,6 +3030,8 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 		return EINVALID_CMD_LINE;
 	}
 
+	timing_init(arg_is_set(cmd, timing_ARG));
+
 	/*
 	 * Now we have the command line args, set up any known output logging
 	 * options immediately.
@@ -3134,6 +3178,19 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 		/* The old style command-name function is used */
 		ret = cmd->command->fn(cmd, argc, argv);
 
+	if (cmd->udev_sync_deferred) {
+		cmd->udev_sync_deferred = 0;
+		if (!sync_local_dev_names(cmd))
+			stack;
+	}
+
+	/* Pools released by the command logged their peak when destroyed. */
+	dm_pools_dump_stats();
+
+	/* Backups of VGs whose lock was not released by name */
+	if (!backup_flush(cmd, NULL))
+		stack;
+
 	lvmlockd_disconnect();
 	fin_locking(cmd);
 
@@ -3142,9 +3199,14 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 
       out:
 
+	timing_report(cmd->cmd_report.log_rh);
+
 	hints_exit(cmd);
 	lvmcache_destroy(cmd, 1, 1);
-	label_scan_destroy(cmd);
+	if (cmd->keep_scan_state)
+		label_scan_release(cmd);
+	else
+		label_scan_destroy(cmd);
 
 	if ((config_string_cft = remove_config_tree_by_source(cmd, CONFIG_STRING)))
 		dm_config_destroy(config_string_cft);
@@ -3152,6 +3214,7 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 	config_profile_command_cft = remove_config_tree_by_source(cmd, CONFIG_PROFILE_COMMAND);
 	config_profile_metadata_cft = remove_config_tree_by_source(cmd, CONFIG_PROFILE_METADATA);
 	cmd->profile_params->global_metadata_profile = NULL;
+	config_values_reset(cmd);
 
 	if (config_string_cft) {
 		/* Move this? */
@@ -3179,8 +3242,11 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 	 * free off any memory the command used.
 	 */
 	dm_list_init(&cmd->arg_value_groups);
+	vdo_stats_cache_destroy(cmd);
 	dm_pool_empty(cmd->mem);
 
+	log_flush_buffer();
+
 	reset_lvm_errno(1);
 	reset_log_duplicated();
 
@@ -27,27 +27,37 @@ int pv_disks_found;
 int pv_parts_found;
 int max_len;
 
-static int _get_max_dev_name_len(struct cmd_context *cmd, struct dev_filter *filter)
+/*
+ * The filters are applied once, their verdicts are those cached by
+ * label_scan, and the list gives both the column width and the output.
+ */
+static int _get_devices(struct cmd_context *cmd, struct dm_list *devs)
 {
-	int len = 0;
-	int maxlen = 0;
 	struct dev_iter *iter;
 	struct device *dev;
+	struct device_list *devl;
+	int len;
 
-	if (!(iter = dev_iter_create(filter, 1))) {
+	if (!(iter = dev_iter_create(cmd->filter, 0))) {
 		log_error("dev_iter_create failed");
 		return 0;
 	}
 
-	/* Do scan */
 	for (dev = dev_iter_get(cmd, iter); dev; dev = dev_iter_get(cmd, iter)) {
-		len = strlen(dev_name(dev));
-		if (len > maxlen)
-			maxlen = len;
+		if (!(devl = dm_pool_alloc(cmd->mem, sizeof(*devl)))) {
+			log_error("device_list alloc failed.");
+			dev_iter_destroy(iter);
+			return 0;
+		}
+		devl->dev = dev;
+		dm_list_add(devs, &devl->list);
+
+		if ((len = strlen(dev_name(dev))) > max_len)
+			max_len = len;
 	}
 	dev_iter_destroy(iter);
 
-	return maxlen;
+	return 1;
 }
 
 static void _count(struct device *dev, int *disks, int *parts)
@@ -85,7 +95,8 @@ int lvmdiskscan(struct cmd_context *cmd, int argc __attribute__((unused)),
 		char **argv __attribute__((unused)))
 {
 	uint64_t size;
-	struct dev_iter *iter;
+	struct dm_list devs;
+	struct device_list *devl;
 	struct device *dev;
 
 	/* initialise these here to avoid problems with the lvm shell */
@@ -93,6 +104,8 @@ int lvmdiskscan(struct cmd_context *cmd, int argc __attribute__((unused)),
 	parts_found = 0;
 	pv_disks_found = 0;
 	pv_parts_found = 0;
+	max_len = 0;
+	dm_list_init(&devs);
 
 	if (arg_is_set(cmd, lvmpartition_ARG))
 		log_warn("WARNING: only considering LVM devices");
@@ -100,14 +113,12 @@ int lvmdiskscan(struct cmd_context *cmd, int argc __attribute__((unused)),
 	/* Call before using dev_iter which uses filters which want bcache data. */
 	label_scan(cmd);
 
-	max_len = _get_max_dev_name_len(cmd, cmd->filter);
-
-	if (!(iter = dev_iter_create(cmd->filter, 0))) {
-		log_error("dev_iter_create failed");
+	if (!_get_devices(cmd, &devs))
 		return ECMD_FAILED;
-	}
 
-	for (dev = dev_iter_get(cmd, iter); dev; dev = dev_iter_get(cmd, iter)) {
+	dm_list_iterate_items(devl, &devs) {
+		dev = devl->dev;
+
 		if (lvmcache_has_dev_info(dev)) {
 			if (!dev_get_size(dev, &size)) {
 				log_error("Couldn't get size of \"%s\"",
@@ -126,7 +137,6 @@ int lvmdiskscan(struct cmd_context *cmd, int argc __attribute__((unused)),
 		if (!_check_device(cmd, dev))
 			continue;
 	}
-	dev_iter_destroy(iter);
 
 	/* Display totals */
 	if (!arg_is_set(cmd, lvmpartition_ARG)) {
@@ -48,6 +48,7 @@ static int _set_daemon_parms(struct cmd_context *cmd, struct daemon_parms *parms
 	parms->aborting = arg_is_set(cmd, abort_ARG);
 	parms->progress_display = 1;
 	parms->wait_before_testing = (arg_sign_value(cmd, interval_ARG, SIGN_NONE) == SIGN_PLUS);
+	parms->single_check = cmd->poll_single_check;
 
 	if (!strcmp(poll_oper, PVMOVE_POLL)) {
 		parms->progress_title = "Moved";
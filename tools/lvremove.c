@@ -15,8 +15,41 @@
 
 #include "tools.h"
 
+static force_t _lvremove_force(struct cmd_context *cmd)
+{
+	return (force_t) arg_count(cmd, force_ARG)
+		? : (arg_is_set(cmd, yes_ARG) ? DONT_PROMPT : PROMPT);
+}
+
+/*
+ * All LVs selected in a VG are removed with a single metadata commit
+ * and their thin pool delete messages are sent together once the
+ * last one is gone.  Shared VGs keep committing per LV so each LV
+ * lock is released only after its removal is on disk.
+ */
+static int _lvremove_single(struct cmd_context *cmd, struct logical_volume *lv,
+			    struct processing_handle *handle)
+{
+	if (!vg_is_shared(lv->vg))
+		lv->vg->defer_remove_commit = 1;
+
+	return lvremove_single(cmd, lv, handle);
+}
+
+static int _lvremove_lvs_done(struct cmd_context *cmd, struct volume_group *vg,
+			      struct processing_handle *handle __attribute__((unused)))
+{
+	if (!vg_commit_removed_lvs(vg, _lvremove_force(cmd)))
+		return_ECMD_FAILED;
+
+	return ECMD_PROCESSED;
+}
+
 int lvremove(struct cmd_context *cmd, int argc, char **argv)
 {
+	struct processing_handle *handle;
+	int ret;
+
 	if (!argc && !arg_is_set(cmd, select_ARG)) {
 		log_error("Please enter one or more logical volume paths "
 			  "or use --select for selection.");
@@ -26,6 +59,17 @@ int lvremove(struct cmd_context *cmd, int argc, char **argv)
 	cmd->handles_missing_pvs = 1;
 	cmd->include_historical_lvs = 1;
 
-	return process_each_lv(cmd, argc, argv, NULL, NULL, READ_FOR_UPDATE, NULL,
-			       NULL, &lvremove_single);
+	if (!(handle = init_processing_handle(cmd, NULL))) {
+		log_error("Failed to initialize processing handle.");
+		return ECMD_FAILED;
+	}
+
+	handle->process_lvs_done = _lvremove_lvs_done;
+
+	ret = process_each_lv(cmd, argc, argv, NULL, NULL, READ_FOR_UPDATE, handle,
+			      NULL, &_lvremove_single);
+
+	destroy_processing_handle(cmd, handle);
+
+	return ret;
 }
@@ -131,6 +131,11 @@ static int _lvresize_params(struct cmd_context *cmd, int argc, char **argv,
 			lp->mirrors++;
 	}
 
+	if (stripe_arg_is_auto(cmd, stripes_ARG) || stripe_arg_is_auto(cmd, stripesize_ARG)) {
+		log_error("Only lvcreate can choose stripes or stripesize automatically.");
+		return 0;
+	}
+
 	if ((lp->stripes = arg_uint_value(cmd, stripes_ARG, 0)) &&
 	    (arg_sign_value(cmd, stripes_ARG, SIGN_NONE) == SIGN_MINUS)) {
 		log_error("Stripes argument may not be negative.");
@@ -146,6 +151,16 @@ static int _lvresize_params(struct cmd_context *cmd, int argc, char **argv,
 	lp->argc = --argc;
 	lp->argv = ++argv;
 
+	/*
+	 * With --use-policies more LVs of the same VG may precede the PVs,
+	 * so dmeventd can extend several pools with one scan and VG lock.
+	 * PVs are given as device paths, so they never look like VG/LV.
+	 */
+	if (lp->use_policies)
+		while ((lp->lv_argc < lp->argc) &&
+		       is_vg_lv_arg(lp->argv[lp->lv_argc], lp->vg_name))
+			lp->lv_argc++;
+
 	lp->alloc = (alloc_policy_t) arg_uint_value(cmd, alloc_ARG, 0);
 	lp->yes = arg_is_set(cmd, yes_ARG);
 	lp->force = arg_is_set(cmd, force_ARG);
@@ -160,54 +175,79 @@ static int _lvresize_params(struct cmd_context *cmd, int argc, char **argv,
 static int _lvresize_single(struct cmd_context *cmd, const char *vg_name,
 			    struct volume_group *vg, struct processing_handle *handle)
 {
-	struct lvresize_params *lp = (struct lvresize_params *) handle->custom_handle;
+	/* Parameters of each LV given with --use-policies follow the first */
+	struct lvresize_params *lps = (struct lvresize_params *) handle->custom_handle;
+	struct lvresize_params *lp;
 	struct dm_list *pvh;
 	struct logical_volume *lv;
-	int ret = ECMD_FAILED;
+	int pv_argc = lps->argc - lps->lv_argc;
+	int i, ret = ECMD_PROCESSED;
 
-	/* Does LV exist? */
-	if (!(lv = find_lv(vg, lp->lv_name))) {
-		log_error("Logical volume %s not found in volume group %s.",
-			  lp->lv_name, vg->name);
-		goto out;
-	}
+	if (!(pvh = pv_argc ? create_pv_list(cmd->mem, vg, pv_argc, lps->argv + lps->lv_argc, 1) : &vg->pvs))
+		return_ECMD_FAILED;
 
-	if (!(pvh = lp->argc ? create_pv_list(cmd->mem, vg, lp->argc, lp->argv, 1) : &vg->pvs))
-		goto_out;
+	for (i = 0; i <= lps->lv_argc; i++) {
+		lp = lps + i;
 
-	if (!lv_resize(lv, lp, pvh))
-		goto_out;
+		/* Does LV exist? */
+		if (!(lv = find_lv(vg, lp->lv_name))) {
+			log_error("Logical volume %s not found in volume group %s.",
+				  lp->lv_name, vg->name);
+			ret = ECMD_FAILED;
+			continue;
+		}
+
+		if (!lv_resize(lv, lp, pvh)) {
+			stack;
+			ret = ECMD_FAILED;
+		}
+	}
 
-	ret = ECMD_PROCESSED;
-out:
 	return ret;
 }
 
 int lvresize(struct cmd_context *cmd, int argc, char **argv)
 {
 	struct processing_handle *handle;
-	struct lvresize_params lp = { 0 };
-	int ret;
+	struct lvresize_params lp = { 0 }, *lps;
+	int i, ret;
 
 	if (!_lvresize_params(cmd, argc, argv, &lp)) {
 		stack;
 		return EINVALID_CMD_LINE;
 	}
 
+	if (!(lps = dm_pool_alloc(cmd->mem, (lp.lv_argc + 1) * sizeof(*lps)))) {
+		log_error("Failed to allocate resize parameters.");
+		return ECMD_FAILED;
+	}
+
+	for (i = 0; i <= lp.lv_argc; i++) {
+		lps[i] = lp;
+		if (i)
+			lps[i].lv_name = lp.argv[i - 1] + strlen(lp.vg_name) + 1;
+	}
+
 	if (!(handle = init_processing_handle(cmd, NULL))) {
 		log_error("Failed to initialize processing handle.");
 		return ECMD_FAILED;
 	}
 
-	handle->custom_handle = &lp;
+	handle->custom_handle = lps;
 
 	ret = process_each_vg(cmd, 0, NULL, lp.vg_name, NULL, READ_FOR_UPDATE, 0, handle,
 			      &_lvresize_single);
 
 	destroy_processing_handle(cmd, handle);
 
-	if (lp.lockd_lv_refresh_path && !lockd_lv_refresh(cmd, &lp))
-		ret = ECMD_FAILED;
+	for (i = 0; i <= lp.lv_argc; i++)
+		if (lps[i].lockd_lv_refresh_path && !lockd_lv_refresh(cmd, lps + i))
+			ret = ECMD_FAILED;
+
+	/* Filesystems are grown after process_each_vg released the VG lock */
+	for (i = 0; i <= lp.lv_argc; i++)
+		if (lps[i].resizefs_path && !lv_resize_fs(cmd, lps + i))
+			ret = ECMD_FAILED;
 
 	return ret;
 }
@@ -22,6 +22,7 @@
 #include <time.h>
 
 #define WAIT_AT_LEAST_NANOSECS 100000
+#define EVENT_MIN_INTERVAL 1	/* seconds between checks woken by dm events */
 
 progress_t poll_mirror_progress(struct cmd_context *cmd,
 				struct logical_volume *lv, const char *name,
@@ -31,8 +32,8 @@ progress_t poll_mirror_progress(struct cmd_context *cmd,
 	uint32_t event_nr = 0;
 
 	if (!lv_is_mirrored(lv) ||
-	    !lv_mirror_percent(cmd, lv, !parms->interval, &segment_percent,
-			       &event_nr) ||
+	    !lv_mirror_percent(cmd, lv, !parms->interval && !parms->single_check,
+			       &segment_percent, &event_nr) ||
 	    (segment_percent == DM_PERCENT_INVALID)) {
 		log_error("ABORTING: Mirror percentage check failed.");
 		return PROGRESS_CHECK_FAILED;
@@ -125,19 +126,42 @@ static void _nanosleep(unsigned secs, unsigned allow_zero_time)
 	while (!nanosleep(&wtime, &wtime) && errno == EINTR) {}
 }
 
-static void _sleep_and_rescan_devices(struct cmd_context *cmd, struct daemon_parms *parms)
+/*
+ * Sleep for up to secs, ending early on a dm event armed with
+ * activation_event_arm() before the last status check.  Mirror, raid
+ * and snapshot-merge targets raise an event when copying or merging
+ * completes, so that is noticed without waiting a whole interval.
+ * Events of unrelated devices end the wait too, so checks stay at
+ * least EVENT_MIN_INTERVAL apart.
+ */
+static void _event_sleep(unsigned secs)
+{
+	if (secs <= EVENT_MIN_INTERVAL) {
+		_nanosleep(secs, 1);
+		return;
+	}
+
+	_nanosleep(EVENT_MIN_INTERVAL, 1);
+	activation_event_wait((secs - EVENT_MIN_INTERVAL) * 1000);
+}
+
+static void _sleep_and_rescan_devices(struct cmd_context *cmd, struct daemon_parms *parms,
+				      int rescan)
 {
 	if (parms->interval && !parms->aborting) {
 		/*
-		 * FIXME: do we really need to drop everything and then rescan
-		 * everything between each iteration?  What change exactly does
-		 * each iteration check for, and does seeing that require
-		 * rescanning everything?
+		 * Labels stay cached between checks, vg_read() rereads the
+		 * metadata only when the mda headers show it changed.  After
+		 * the VG seqno changed, everything is rescanned in case the
+		 * VG gained PVs the cached scan does not know.
 		 */
-		lvmcache_destroy(cmd, 1, 0);
-		label_scan_destroy(cmd);
-		_nanosleep(parms->interval, 1);
-		lvmcache_label_scan(cmd);
+		if (rescan) {
+			lvmcache_destroy(cmd, 1, 0);
+			label_scan_destroy(cmd);
+		}
+		_event_sleep(parms->interval);
+		if (rescan)
+			lvmcache_label_scan(cmd);
 	}
 }
 
@@ -149,6 +173,8 @@ int wait_for_single_lv(struct cmd_context *cmd, struct poll_operation_id *id,
 	int finished = 0;
 	uint32_t lockd_state = 0;
 	uint32_t error_flags = 0;
+	uint32_t seqno = 0;
+	int rescan = 1;
 	int ret;
 
 	if (!parms->wait_before_testing)
@@ -156,8 +182,8 @@ int wait_for_single_lv(struct cmd_context *cmd, struct poll_operation_id *id,
 
 	/* Poll for completion */
 	while (!finished) {
-		if (parms->wait_before_testing)
-			_sleep_and_rescan_devices(cmd, parms);
+		if (parms->wait_before_testing && !parms->single_check)
+			_sleep_and_rescan_devices(cmd, parms, rescan);
 
 		/*
 		 * An ex VG lock is needed because the check can call finish_copy
@@ -205,16 +231,30 @@ int wait_for_single_lv(struct cmd_context *cmd, struct poll_operation_id *id,
 			goto out;
 		}
 
+		/* Armed before reading the status so no event is missed */
+		if (parms->interval && !parms->single_check)
+			activation_event_arm();
+
 		if (!_check_lv_status(cmd, vg, lv, id->display_name, parms, &finished)) {
 			ret = 0;
 			goto_out;
 		}
 
+		/* finish_copy and update_metadata commit, changing seqno too */
+		rescan = (seqno != vg->seqno);
+		seqno = vg->seqno;
+
 		unlock_and_release_vg(cmd, vg, vg->name);
 
 		if (!lockd_vg(cmd, id->vg_name, "un", 0, &lockd_state))
 			stack;
 
+		/* The caller (lvmpolld) schedules the next check itself. */
+		if (parms->single_check) {
+			cmd->poll_in_progress = !finished;
+			break;
+		}
+
 		/*
 		 * FIXME Sleeping after testing, while preferred, also works around
 		 * unreliable "finished" state checking in _percent_run.  If the
@@ -228,7 +268,7 @@ int wait_for_single_lv(struct cmd_context *cmd, struct poll_operation_id *id,
 		 * continue polling an LV that doesn't have a "status".
 		 */
 		if (!parms->wait_before_testing && !finished)
-			_sleep_and_rescan_devices(cmd, parms);
+			_sleep_and_rescan_devices(cmd, parms, rescan);
 	}
 
 	return 1;
@@ -374,11 +414,13 @@ static void _poll_for_all_vgs(struct cmd_context *cmd,
 
 	while (1) {
 		parms->outstanding_count = 0;
+		if (parms->interval)
+			activation_event_arm();
 		process_each_vg(cmd, 0, NULL, NULL, NULL, READ_FOR_UPDATE, 0, handle, _poll_vg);
 		lock_global(cmd, "un");
 		if (!parms->outstanding_count)
 			break;
-		_nanosleep(parms->interval, 1);
+		_event_sleep(parms->interval);
 	}
 }
 
@@ -457,6 +499,23 @@ out_ret:
 	return ret;
 }
 
+/* Print the progress lvmpolld pushed, read the VG only without it */
+static int _report_lvmpolld_progress(struct cmd_context *cmd, struct poll_operation_id *id,
+				     struct daemon_parms *parms, struct lvmpolld_update *update)
+{
+	if (!*update->progress)
+		return _report_progress(cmd, id, parms);
+
+	if (parms->progress_display)
+		log_print_unless_silent("%s: %s: %s%%", id->display_name,
+					parms->progress_title, update->progress);
+	else
+		log_verbose("%s: %s: %s%%", id->display_name,
+			    parms->progress_title, update->progress);
+
+	return 1;
+}
+
 static int _lvmpolld_init_poll_vg(struct cmd_context *cmd, const char *vgname,
 			          struct volume_group *vg, struct processing_handle *handle)
 {
@@ -522,7 +581,7 @@ static void _lvmpolld_poll_for_all_vgs(struct cmd_context *cmd,
 	while (!dm_list_empty(&lpdp.idls)) {
 		dm_list_iterate_items_safe(idl, tlv, &lpdp.idls) {
 			r = lvmpolld_request_info(idl->id, lpdp.parms,
-						  &finished);
+						  &finished, NULL);
 			if (!r || finished)
 				dm_list_del(&idl->list);
 			else if (!parms->aborting)
@@ -541,6 +600,7 @@ static int _lvmpoll_daemon(struct cmd_context *cmd, struct poll_operation_id *id
 {
 	int r;
 	struct processing_handle *handle = NULL;
+	struct lvmpolld_update update = { 0 };
 	unsigned finished = 0;
 
 	if (parms->aborting)
@@ -550,12 +610,14 @@ static int _lvmpoll_daemon(struct cmd_context *cmd, struct poll_operation_id *id
 		r = lvmpolld_poll_init(cmd, id, parms);
 		if (r && !parms->background) {
 			while (1) {
-				if (!(r = lvmpolld_request_info(id, parms, &finished)) ||
+				if (!(r = lvmpolld_request_info(id, parms, &finished, &update)) ||
 				    finished ||
-				    (!parms->aborting && !(r = _report_progress(cmd, id, parms))))
+				    (!parms->aborting && !(r = _report_lvmpolld_progress(cmd, id, parms, &update))))
 					break;
 
-				_nanosleep(parms->interval, 0);
+				/* lvmpolld already waited for the update otherwise */
+				if (!update.nr)
+					_nanosleep(parms->interval, 0);
 			}
 		}
 
@@ -393,6 +393,42 @@ static bool _read_bytes(struct device *dev, struct devicefile *def, uint64_t sta
 	return true;
 }
 
+/*
+ * Return the first 512 byte chunk of the metadata area, starting from chunk
+ * 'count', whose first line is followed by an "id = " line, or the number of
+ * chunks when there is none.  A single memmem() pass over the text skips the
+ * chunks that cannot hold the start of metadata much faster than copying and
+ * checking a line at each of them.
+ */
+static int _next_id_chunk(const char *buf, uint64_t mda_size, int count)
+{
+	static const char _id_line[] = "\nid = ";
+	int chunks = (mda_size - 512) / 512;
+	uint64_t chunk_off, hit_off;
+	const char *hit;
+
+	while (count < chunks) {
+		chunk_off = 512 + ((uint64_t)count * 512);
+
+		if (!(hit = memmem(buf + chunk_off, mda_size - chunk_off,
+				   _id_line, sizeof(_id_line) - 1)))
+			return chunks;
+
+		hit_off = hit - buf;
+		count = (hit_off - 512) / 512;
+		chunk_off = 512 + ((uint64_t)count * 512);
+
+		/* The id line must directly follow the first line of the chunk. */
+		if ((hit_off - chunk_off < MAX_LINE_CHECK - 1) &&
+		    !memchr(buf + chunk_off, '\n', hit_off - chunk_off))
+			return count;
+
+		count++;
+	}
+
+	return chunks;
+}
+
 /* all sizes and offsets in bytes */
 
 static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const char *tofile,
@@ -468,6 +504,9 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 		if (one_found)
 			break;
 
+		if ((count = _next_id_chunk(buf, mda_size, count)) >= (meta_size / 512))
+			break;
+
 		/*
 		 * Check for a new metadata copy at each 512 offset
 		 * (after skipping 512 bytes for mda_header at the
@@ -136,11 +136,15 @@ int pvcreate(struct cmd_context *cmd, int argc, char **argv)
 	pp.pv_count = argc;
 	pp.pv_names = argv;
 
-	/* Needed to change the set of orphan PVs. */
-	if (!lock_global(cmd, "ex"))
+	/*
+	 * Needed to change the set of orphan PVs.  Locally the devices
+	 * are locked individually by pvcreate_each_device, other hosts
+	 * are only excluded by the lvmlockd global lock ex.
+	 */
+	if (!lock_global(cmd, lvmlockd_use() ? "ex" : "sh"))
 		return_ECMD_FAILED;
 
-	clear_hint_file(cmd);
+	journal_hint_file_begin(cmd);
 
 	lvmcache_label_scan(cmd);
 
@@ -154,6 +158,8 @@ int pvcreate(struct cmd_context *cmd, int argc, char **argv)
 	else
 		ret = ECMD_PROCESSED;
 
+	journal_hint_file_end(cmd, ret == ECMD_PROCESSED);
+
 	destroy_processing_handle(cmd, handle);
 	return ret;
 }
@@ -34,8 +34,12 @@ int pvremove(struct cmd_context *cmd, int argc, char **argv)
 	pp.pv_count = argc;
 	pp.pv_names = argv;
 
-	/* Needed to change the set of orphan PVs. */
-	if (!lock_global(cmd, "ex")) {
+	/*
+	 * Needed to change the set of orphan PVs.  Locally the devices
+	 * are locked individually by pvcreate_each_device, other hosts
+	 * are only excluded by the lvmlockd global lock ex.
+	 */
+	if (!lock_global(cmd, lvmlockd_use() ? "ex" : "sh")) {
 		/* Let pvremove -ff skip locks */
 		if (pp.force == DONT_PROMPT_OVERRIDE)
 			log_warn("WARNING: skipping global lock for force.");
@@ -43,7 +47,7 @@ int pvremove(struct cmd_context *cmd, int argc, char **argv)
 			return_ECMD_FAILED;
 	}
 
-	clear_hint_file(cmd);
+	journal_hint_file_begin(cmd);
 
 	lvmcache_label_scan(cmd);
 
@@ -67,6 +71,8 @@ int pvremove(struct cmd_context *cmd, int argc, char **argv)
 	else
 		ret = ECMD_PROCESSED;
 
+	journal_hint_file_end(cmd, ret == ECMD_PROCESSED);
+
 	destroy_processing_handle(cmd, handle);
 	return ret;
 }
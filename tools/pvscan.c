@@ -20,6 +20,7 @@
 #include "lib/label/hints.h"
 
 #include <dirent.h>
+#include <sys/file.h>
 
 struct pvscan_params {
 	int new_pvs_found;
@@ -41,10 +42,13 @@ struct pvscan_aa_params {
  * when one vg is being activated.
  */
 static struct volume_group *saved_vg;
+static int _saved_vg_from_snapshot;
 
 static const char *_pvs_online_dir = DEFAULT_RUN_DIR "/pvs_online";
 static const char *_vgs_online_dir = DEFAULT_RUN_DIR "/vgs_online";
 static const char *_pvs_lookup_dir = DEFAULT_RUN_DIR "/pvs_lookup";
+static const char *_pvscan_leader_file = DEFAULT_RUN_DIR "/pvscan_leader";
+static const char *_pvscan_queue_file = DEFAULT_RUN_DIR "/pvscan_queue";
 
 static int _pvscan_display_pv(struct cmd_context *cmd,
 				  struct physical_volume *pv,
@@ -253,6 +257,12 @@ static void _lookup_file_remove(char *vgname)
 
 	if (unlink(path))
 		log_sys_debug("unlink", path);
+
+	if (dm_snprintf(path, sizeof(path), "%s/.%s.vg", _pvs_lookup_dir, vgname) < 0)
+		return;
+
+	if (unlink(path) && (errno != ENOENT))
+		log_sys_debug("unlink", path);
 }
 
 /*
@@ -276,6 +286,97 @@ static void _online_vg_file_remove(const char *vgname)
 		log_sys_debug("unlink", path);
 }
 
+/*
+ * Each PVID file has a companion file named .<major>:<minor> containing
+ * the PVID, so a device going offline finds its PVID file directly
+ * instead of reading every PVID file.  The PVID files remain the record
+ * of what is online: a devno file that does not lead back to a PVID file
+ * with the same major:minor is just removed and ignored.
+ */
+
+static int _online_devno_file_path(char *path, size_t size, int major, int minor)
+{
+	if (dm_snprintf(path, size, "%s/.%d:%d", _pvs_online_dir, major, minor) < 0) {
+		log_error("Path %s/.%d:%d is too long.", _pvs_online_dir, major, minor);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _online_devno_file_create(const char *pvid, int major, int minor)
+{
+	char path[PATH_MAX];
+	int fd;
+
+	if (!_online_devno_file_path(path, sizeof(path), major, minor))
+		return;
+
+	fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		/* Removal falls back to reading the PVID files. */
+		log_debug("Did not create %s: %d", path, errno);
+		return;
+	}
+
+	if (write(fd, pvid, ID_LEN) != ID_LEN)
+		log_sys_debug("write", path);
+
+	if (close(fd))
+		log_sys_debug("close", path);
+}
+
+static int _online_pvid_file_exists(const char *pvid);
+
+/*
+ * Returns 1 if the PVID file for major:minor was found from its devno
+ * file and removed.
+ */
+static int _online_pvid_file_remove_devno_file(int major, int minor)
+{
+	char path[PATH_MAX];
+	char pvid[ID_LEN + 1] = { 0 };
+	char file_vgname[NAME_LEN] = { 0 };
+	int file_major = 0, file_minor = 0;
+	int fd, rv;
+
+	if (!_online_devno_file_path(path, sizeof(path), major, minor))
+		return 0;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 0;
+
+	rv = read(fd, pvid, ID_LEN);
+	if (close(fd))
+		log_sys_debug("close", path);
+
+	log_debug("Unlink pv online devno: %s", path);
+
+	if (unlink(path))
+		log_sys_debug("unlink", path);
+
+	if ((rv != ID_LEN) || !_online_pvid_file_exists(pvid))
+		return 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/%s", _pvs_online_dir, pvid) < 0)
+		return 0;
+
+	if (!_online_pvid_file_read(path, &file_major, &file_minor, file_vgname) ||
+	    (file_major != major) || (file_minor != minor))
+		return 0;
+
+	log_debug("Unlink pv online %s", path);
+	if (unlink(path))
+		log_sys_debug("unlink", path);
+
+	if (file_vgname[0]) {
+		_online_vg_file_remove(file_vgname);
+		_lookup_file_remove(file_vgname);
+	}
+
+	return 1;
+}
+
 /*
  * When a device goes offline we only know its major:minor, not its PVID.
  * Since the dev isn't around, we can't read it to get its PVID, so we have to
@@ -294,6 +395,9 @@ static void _online_pvid_file_remove_devno(int major, int minor)
 
 	log_debug("Remove pv online devno %d:%d", major, minor);
 
+	if (_online_pvid_file_remove_devno_file(major, minor))
+		return;
+
 	if (!(dir = opendir(_pvs_online_dir)))
 		return;
 
@@ -335,7 +439,8 @@ static void _online_files_remove(const char *dirpath)
 		return;
 
 	while ((de = readdir(dir))) {
-		if (de->d_name[0] == '.')
+		/* Also removes the devno files in pvs_online */
+		if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
 			continue;
 
 		memset(path, 0, sizeof(path));
@@ -413,6 +518,8 @@ static int _online_pvid_file_create(struct device *dev, const char *vgname)
 	if (close(fd))
 		log_sys_debug("close", path);
 
+	_online_devno_file_create(dev->pvid, major, minor);
+
 	return 1;
 
 check_duplicate:
@@ -470,6 +577,53 @@ static int _online_pvid_file_exists(const char *pvid)
 	return 0;
 }
 
+/*
+ * Read the names in pvs_online once, so checking all the PVs of a VG
+ * takes a directory read instead of a stat of each PVID file.
+ */
+static struct dm_hash_table *_online_pvids_read(void)
+{
+	struct dm_hash_table *pvids;
+	struct dirent *de;
+	DIR *dir;
+
+	if (!(pvids = dm_hash_create(128))) {
+		log_error("Failed to create online PVID hash.");
+		return NULL;
+	}
+
+	if (!(dir = opendir(_pvs_online_dir)))
+		return pvids;
+
+	while ((de = readdir(dir))) {
+		if ((de->d_name[0] == '.') || (strlen(de->d_name) != ID_LEN))
+			continue;
+
+		if (!dm_hash_insert_binary(pvids, de->d_name, ID_LEN, (void *) 1)) {
+			log_error("Failed to add online PVID to hash.");
+			dm_hash_destroy(pvids);
+			pvids = NULL;
+			break;
+		}
+	}
+
+	if (closedir(dir))
+		log_sys_debug("closedir", _pvs_online_dir);
+
+	log_debug("Found %u pv online files.", pvids ? dm_hash_get_num_entries(pvids) : 0);
+
+	return pvids;
+}
+
+static int _online_pvid_is_listed(struct dm_hash_table *pvids, const char *pvid)
+{
+	/* Fall back to a stat when the directory could not be read. */
+	if (!pvids)
+		return _online_pvid_file_exists(pvid);
+
+	return dm_hash_lookup_binary(pvids, pvid, ID_LEN) ? 1 : 0;
+}
+
 static int _write_lookup_file(struct cmd_context *cmd, struct volume_group *vg)
 {
 	char path[PATH_MAX];
@@ -506,6 +660,44 @@ static int _write_lookup_file(struct cmd_context *cmd, struct volume_group *vg)
 	return 1;
 }
 
+/*
+ * A snapshot of the VG metadata is saved next to the lookup file.  When
+ * the PV completing the VG has no metadata of its own, the snapshot
+ * gives the quick activation its list of devices, where it would
+ * otherwise fall back to a full label scan.  The metadata in the
+ * snapshot was checksum validated when read from the PV, and it is
+ * only used when its seqno matches the mda headers of the VG's devices.
+ */
+static int _write_vg_snapshot(struct volume_group *vg)
+{
+	char path[PATH_MAX];
+
+	if (dm_snprintf(path, sizeof(path), "%s/.%s.vg", _pvs_lookup_dir, vg->name) < 0) {
+		log_error("Path %s/.%s.vg is too long.", _pvs_lookup_dir, vg->name);
+		return 0;
+	}
+
+	return backup_to_file(path, "pvscan", vg);
+}
+
+static struct volume_group *_read_vg_snapshot(struct cmd_context *cmd, const char *vgname)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	if (dm_snprintf(path, sizeof(path), "%s/.%s.vg", _pvs_lookup_dir, vgname) < 0) {
+		log_error("Path %s/.%s.vg is too long.", _pvs_lookup_dir, vgname);
+		return NULL;
+	}
+
+	if (stat(path, &st))
+		return NULL;
+
+	log_debug("Reading VG %s snapshot %s", vgname, path);
+
+	return backup_read_vg(cmd, vgname, path);
+}
+
 static int _lookup_file_contains_pvid(FILE *fp, char *pvid)
 {
 	char line[64];
@@ -519,6 +711,7 @@ static int _lookup_file_contains_pvid(FILE *fp, char *pvid)
 
 static void _lookup_file_count_pvid_files(FILE *fp, const char *vgname, int *pvs_online, int *pvs_offline)
 {
+	struct dm_hash_table *pvids = _online_pvids_read();
 	char line[64];
 	char pvid[ID_LEN+1];
 
@@ -535,11 +728,14 @@ static void _lookup_file_count_pvid_files(FILE *fp, const char *vgname, int *pvs
 			continue;
 		}
 
-		if (_online_pvid_file_exists((const char *)pvid))
+		if (_online_pvid_is_listed(pvids, (const char *)pvid))
 			(*pvs_online)++;
 		else
 			(*pvs_offline)++;
 	}
+
+	if (pvids)
+		dm_hash_destroy(pvids);
 }
 
 /*
@@ -704,17 +900,21 @@ do_lookup:
 
 static void _count_pvid_files(struct volume_group *vg, int *pvs_online, int *pvs_offline)
 {
+	struct dm_hash_table *pvids = _online_pvids_read();
 	struct pv_list *pvl;
 
 	*pvs_online = 0;
 	*pvs_offline = 0;
 
 	dm_list_iterate_items(pvl, &vg->pvs) {
-		if (_online_pvid_file_exists((const char *)&pvl->pv->id.uuid))
+		if (_online_pvid_is_listed(pvids, (const char *)&pvl->pv->id.uuid))
 			(*pvs_online)++;
 		else
 			(*pvs_offline)++;
 	}
+
+	if (pvids)
+		dm_hash_destroy(pvids);
 }
 
 static int _pvscan_aa_single(struct cmd_context *cmd, const char *vg_name,
@@ -871,6 +1071,7 @@ bad:
 	if (saved_vg) {
 		release_vg(saved_vg);
 		saved_vg = NULL;
+		_saved_vg_from_snapshot = 0;
 	}
 	return 0;
 }
@@ -958,6 +1159,19 @@ static int _pvscan_aa_quick(struct cmd_context *cmd, struct pvscan_aa_params *pp
 		return ECMD_FAILED;
 	}
 
+	/*
+	 * A snapshot may be older than the metadata on the devices, in which
+	 * case the devices it lists may not be the VG's.
+	 */
+	if (_saved_vg_from_snapshot &&
+	    (lvmcache_scan_mismatch(cmd, vgname, vgid) ||
+	     (lvmcache_seqno(cmd, vgid) != saved_vg->seqno))) {
+		log_print("pvscan[%d] VG %s snapshot is outdated, not using quick activation.", getpid(), vgname);
+		unlock_vg(cmd, NULL, vgname);
+		*no_quick = 1;
+		return ECMD_FAILED;
+	}
+
 	/*
 	 * can_use_one_scan and READ_WITHOUT_LOCK are both important key
 	 * changes made to vg_read that are possible because the VG is locked
@@ -1081,6 +1295,7 @@ out:
 	if (saved_vg) {
 		release_vg(saved_vg);
 		saved_vg = NULL;
+		_saved_vg_from_snapshot = 0;
 	}
 	return ret;
 }
@@ -1325,6 +1540,8 @@ static int _online_devs(struct cmd_context *cmd, int do_all, struct dm_list *pvs
 			_count_pvid_files(vg, &pvs_online, &pvs_offline);
 
 			if (pvs_offline && _write_lookup_file(cmd, vg)) {
+				if (!_write_vg_snapshot(vg))
+					log_debug("Failed to save VG %s snapshot.", vg->name);
 				log_debug("rechecking all pvid files from vg %s", vg->name);
 				_count_pvid_files(vg, &pvs_online, &pvs_offline);
 				if (!pvs_offline)
@@ -1364,6 +1581,10 @@ static int _online_devs(struct cmd_context *cmd, int do_all, struct dm_list *pvs
 			saved_vg = vg;
 		else
 			release_vg(vg);
+
+		if (!saved_vg && !vg && vg_complete && !do_all && (dm_list_size(pvscan_devs) == 1) &&
+		    (saved_vg = _read_vg_snapshot(cmd, vgname)))
+			_saved_vg_from_snapshot = 1;
 	}
 
 	return ret;
@@ -1564,12 +1785,212 @@ static int _pvscan_cache_args(struct cmd_context *cmd, int argc, char **argv,
 	return ret;
 }
 
+/*
+ * Coalescing of pvscan --cache -aay (global/event_activation_coalesce_ms).
+ *
+ * Every pvscan appends its device args to the queue file, and then tries
+ * to take the leader lock.  A pvscan that fails to get the lock exits,
+ * since the leader will process its args.  The leader waits for the
+ * window to collect more args, then drains the queue and runs one scan
+ * and one activation for everything queued.  After releasing the lock,
+ * the leader checks the queue again to pick up args that were added
+ * after the drain by pvscans that saw the lock still held.
+ *
+ * The queue is appended and drained under a lock on the queue file,
+ * so no arg is lost between a read and the truncate.
+ */
+
+static int _coalesce_queue_open(int lock_type)
+{
+	int fd;
+
+	if ((fd = open(_pvscan_queue_file, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0) {
+		log_sys_debug("open", _pvscan_queue_file);
+		return -1;
+	}
+
+	if (flock(fd, lock_type)) {
+		log_sys_debug("flock", _pvscan_queue_file);
+		if (close(fd))
+			stack;
+		return -1;
+	}
+
+	return fd;
+}
+
+static int _coalesce_queue_add(struct cmd_context *cmd, int argc, char **argv)
+{
+	struct dm_list pvscan_args;
+	struct pvscan_arg *arg;
+	char line[PATH_MAX + 2];
+	int len, fd, ret = 1;
+
+	dm_list_init(&pvscan_args);
+
+	if (!_get_args(cmd, argc, argv, &pvscan_args))
+		return_0;
+
+	if ((fd = _coalesce_queue_open(LOCK_EX)) < 0)
+		return 0;
+
+	dm_list_iterate_items(arg, &pvscan_args) {
+		if (arg->devname)
+			len = dm_snprintf(line, sizeof(line), "%s\n", arg->devname);
+		else
+			len = dm_snprintf(line, sizeof(line), "%u:%u\n",
+					  (unsigned) MAJOR(arg->devno), (unsigned) MINOR(arg->devno));
+
+		if ((len < 0) || (write(fd, line, len) != len)) {
+			log_sys_debug("write", _pvscan_queue_file);
+			ret = 0;
+			break;
+		}
+	}
+
+	if (close(fd))
+		stack;
+
+	return ret;
+}
+
+/* Returns the queued args in cmd->mem and empties the queue. */
+static int _coalesce_queue_drain(struct cmd_context *cmd, int *argc, char ***argv)
+{
+	struct stat st;
+	char *buf, *p, *nl;
+	int fd, count = 0, ret = 0;
+
+	*argc = 0;
+	*argv = NULL;
+
+	if ((fd = _coalesce_queue_open(LOCK_EX)) < 0)
+		return 0;
+
+	if (fstat(fd, &st)) {
+		log_sys_debug("fstat", _pvscan_queue_file);
+		goto out;
+	}
+
+	if (!st.st_size) {
+		ret = 1;
+		goto out;
+	}
+
+	if (!(buf = dm_pool_zalloc(cmd->mem, st.st_size + 1)) ||
+	    !(*argv = dm_pool_zalloc(cmd->mem, (st.st_size / 2 + 1) * sizeof(char *))))
+		goto_out;
+
+	if (pread(fd, buf, st.st_size, 0) != st.st_size) {
+		log_sys_debug("read", _pvscan_queue_file);
+		goto out;
+	}
+
+	if (ftruncate(fd, 0)) {
+		log_sys_debug("ftruncate", _pvscan_queue_file);
+		goto out;
+	}
+
+	for (p = buf; *p; p = nl + 1) {
+		if (!(nl = strchr(p, '\n')))
+			break;
+		*nl = '\0';
+		if (*p)
+			(*argv)[count++] = p;
+	}
+
+	*argc = count;
+	ret = 1;
+out:
+	if (close(fd))
+		stack;
+
+	return ret;
+}
+
+static int _coalesce_queue_empty(void)
+{
+	struct stat st;
+
+	return stat(_pvscan_queue_file, &st) || !st.st_size;
+}
+
+static int _pvscan_cache_coalesce(struct cmd_context *cmd, int argc, char **argv,
+				  struct pvscan_aa_params *pp, int window_ms)
+{
+	struct dm_list complete_vgnames;
+	char **queue_argv;
+	int queue_argc;
+	int rounds = 0;
+	int fd, ret = ECMD_PROCESSED;
+
+	if (!_coalesce_queue_add(cmd, argc, argv)) {
+		log_debug("Failed to queue pvscan args, not coalescing.");
+		return 0;
+	}
+
+	while (1) {
+		if ((fd = open(_pvscan_leader_file, O_RDWR | O_CREAT, 0644)) < 0) {
+			log_sys_debug("open", _pvscan_leader_file);
+			return 0;
+		}
+
+		if (flock(fd, LOCK_EX | LOCK_NB)) {
+			/* A leader holds the lock and will drain the queue after it. */
+			if (!rounds)
+				log_print("pvscan[%d] queued for activation by coalescing pvscan.", getpid());
+			if (close(fd))
+				stack;
+			break;
+		}
+
+		rounds++;
+
+		log_debug("Coalescing pvscan args for %d ms.", window_ms);
+		usleep(window_ms * 1000);
+
+		dm_list_init(&complete_vgnames);
+
+		if (!_coalesce_queue_drain(cmd, &queue_argc, &queue_argv))
+			ret = ECMD_FAILED;
+
+		else if (queue_argc) {
+			log_debug("Coalesced %d pvscan args.", queue_argc);
+
+			if (!_pvscan_cache_args(cmd, queue_argc, queue_argv, &complete_vgnames))
+				ret = ECMD_FAILED;
+
+			else if (!dm_list_empty(&complete_vgnames) &&
+				 (_pvscan_aa(cmd, pp, 0, &complete_vgnames) != ECMD_PROCESSED))
+				ret = ECMD_FAILED;
+		}
+
+		if (close(fd))
+			stack;
+
+		if (_coalesce_queue_empty())
+			break;
+	}
+
+	if (!rounds)
+		return ret;
+
+	if (pp->activate_errors)
+		ret = ECMD_FAILED;
+
+	if (!sync_local_dev_names(cmd))
+		stack;
+
+	return ret;
+}
+
 int pvscan_cache_cmd(struct cmd_context *cmd, int argc, char **argv)
 {
 	struct pvscan_aa_params pp = { 0 };
 	struct dm_list complete_vgnames;
 	int do_activate = arg_is_set(cmd, activate_ARG);
 	int devno_args = 0;
+	int coalesce_ms;
 	int do_all;
 	int ret;
 
@@ -1587,6 +2008,15 @@ int pvscan_cache_cmd(struct cmd_context *cmd, int argc, char **argv)
 
 	_online_dir_setup();
 
+	coalesce_ms = find_config_tree_int(cmd, global_event_activation_coalesce_ms_CFG, NULL);
+
+	if (do_activate)
+		cmd->udev_sync_deferred = find_config_tree_bool(cmd, activation_udev_sync_deferred_CFG, NULL);
+
+	if (!do_all && do_activate && (coalesce_ms > 0) &&
+	    (ret = _pvscan_cache_coalesce(cmd, argc, argv, &pp, coalesce_ms)))
+		return ret;
+
 	if (do_all) {
 		if (!_pvscan_cache_all(cmd, argc, argv, &complete_vgnames))
 			return ECMD_FAILED;
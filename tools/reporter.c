@@ -17,6 +17,8 @@
 
 #include "lib/report/report.h"
 
+#include <time.h>
+
 typedef enum {
 	REPORT_IDX_NULL = -1,
 	REPORT_IDX_SINGLE,
@@ -72,7 +74,7 @@ static int _process_each_devtype(struct cmd_context *cmd, int argc,
 	return ECMD_PROCESSED;
 }
 
-static int _vgs_single(struct cmd_context *cmd __attribute__((unused)),
+static int _vgs_single(struct cmd_context *cmd,
 		       const char *vg_name, struct volume_group *vg,
 		       struct processing_handle *handle)
 {
@@ -82,12 +84,14 @@ static int _vgs_single(struct cmd_context *cmd __attribute__((unused)),
 			   vg, NULL, NULL, NULL, NULL, NULL, NULL))
 		return_ECMD_FAILED;
 
-	check_current_backup(vg);
+	/* A --cached report has vg from its snapshot, not from disk */
+	if (!arg_is_set(cmd, cached_ARG))
+		check_current_backup(vg);
 
 	return ECMD_PROCESSED;
 }
 
-static int _do_info_and_status(struct cmd_context *cmd,
+static int _get_info_and_status(struct cmd_context *cmd,
 				const struct lv_segment *lv_seg,
 				struct lv_with_info_and_seg_status *status,
 				int do_info, int do_status)
@@ -106,6 +110,17 @@ static int _do_info_and_status(struct cmd_context *cmd,
 			status->info_ok = lv_info_with_seg_status(cmd, lv_seg, status, 1, 1);
 		else
 			status->info_ok = lv_info_with_seg_status(cmd, lv_seg, status, 0, 0);
+
+		/* Keep usage history for the fill rate forecast */
+		if (status->info_ok && lv_is_thin_pool(status->lv) &&
+		    (status->seg_status.type == SEG_STATUS_THIN_POOL) &&
+		    !status->seg_status.thin_pool->fail &&
+		    !thin_pool_history_record(status->lv,
+					      dm_make_percent(status->seg_status.thin_pool->used_data_blocks,
+							      status->seg_status.thin_pool->total_data_blocks),
+					      dm_make_percent(status->seg_status.thin_pool->used_metadata_blocks,
+							      status->seg_status.thin_pool->total_metadata_blocks)))
+			stack;
 	} else if (do_info)
 		/* info only */
 		status->info_ok = lv_info(cmd, status->lv, 0, &status->info, 1, 1);
@@ -113,6 +128,95 @@ static int _do_info_and_status(struct cmd_context *cmd,
 	return 1;
 }
 
+/*
+ * fullreport reports each LV of a VG in its lvs, segs and pvsegs
+ * sub-reports.  While a VG is reported, the info and status queried
+ * for a segment are kept and handed to the later sub-reports instead
+ * of asking the kernel again.  The memo owns the status pools.
+ */
+struct status_memo_key {
+	const struct lv_segment *seg;
+	int do_info;
+	int do_status;
+};
+
+struct status_memo {
+	struct status_memo_key key;
+	struct lv_with_info_and_seg_status status;
+};
+
+static struct dm_hash_table *_status_memo;
+
+static int _status_memo_begin(void)
+{
+	if (!(_status_memo = dm_hash_create(128))) {
+		log_error("Failed to create status memo hash table.");
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _status_memo_end(void)
+{
+	struct dm_hash_node *n;
+	struct status_memo *m;
+
+	if (!_status_memo)
+		return;
+
+	dm_hash_iterate(n, _status_memo) {
+		m = dm_hash_get_data(_status_memo, n);
+		if (m->status.seg_status.mem)
+			dm_pool_destroy(m->status.seg_status.mem);
+		free(m);
+	}
+
+	dm_hash_destroy(_status_memo);
+	_status_memo = NULL;
+}
+
+static int _do_info_and_status(struct cmd_context *cmd,
+				const struct lv_segment *lv_seg,
+				struct lv_with_info_and_seg_status *status,
+				int do_info, int do_status)
+{
+	struct status_memo_key key = { 0 };
+	struct status_memo *m;
+
+	if (!_status_memo || lv_is_historical(lv_seg->lv) || (!do_info && !do_status))
+		return _get_info_and_status(cmd, lv_seg, status, do_info, do_status);
+
+	key.seg = lv_seg;
+	key.do_info = do_info;
+	key.do_status = do_status;
+
+	if ((m = dm_hash_lookup_binary(_status_memo, &key, sizeof(key)))) {
+		*status = m->status;
+		status->seg_status.mem = NULL;
+		return 1;
+	}
+
+	if (!_get_info_and_status(cmd, lv_seg, status, do_info, do_status))
+		return_0;
+
+	if (!(m = zalloc(sizeof(*m))))
+		return 1;
+
+	m->key = key;
+	m->status = *status;
+
+	if (!dm_hash_insert_binary(_status_memo, &m->key, sizeof(m->key), m)) {
+		free(m);
+		return 1;
+	}
+
+	/* Pool now belongs to the memo */
+	status->seg_status.mem = NULL;
+
+	return 1;
+}
+
 /* Check if this is really merging origin.
  * In such case, origin is gone, and user should see
  * only data from merged snapshot. Important for thin. */
@@ -535,8 +639,8 @@ static int _get_final_report_type(struct report_args *args,
 }
 
 static int _report_all_in_vg(struct cmd_context *cmd, struct processing_handle *handle,
-			     struct volume_group *vg, report_type_t type,
-			     int do_lv_info, int do_lv_seg_status)
+			     struct volume_group *vg, struct dm_list *arg_lvnames,
+			     report_type_t type, int do_lv_info, int do_lv_seg_status)
 {
 	int r = 0;
 
@@ -545,14 +649,14 @@ static int _report_all_in_vg(struct cmd_context *cmd, struct processing_handle *
 			r = _vgs_single(cmd, vg->name, vg, handle);
 			break;
 		case LVS:
-			r = process_each_lv_in_vg(cmd, vg, NULL, NULL, 0, handle, NULL,
+			r = process_each_lv_in_vg(cmd, vg, arg_lvnames, NULL, 0, handle, NULL,
 						  do_lv_info && !do_lv_seg_status ? &_lvs_with_info_single :
 						  !do_lv_info && do_lv_seg_status ? &_lvs_with_status_single :
 						  do_lv_info && do_lv_seg_status ? &_lvs_with_info_and_status_single :
 										   &_lvs_single);
 			break;
 		case SEGS:
-			r = process_each_lv_in_vg(cmd, vg, NULL, NULL, 0, handle, NULL,
+			r = process_each_lv_in_vg(cmd, vg, arg_lvnames, NULL, 0, handle, NULL,
 						  do_lv_info && !do_lv_seg_status ? &_lvsegs_with_info_single :
 						  !do_lv_info && do_lv_seg_status ? &_lvsegs_with_status_single :
 						  do_lv_info && do_lv_seg_status ? &_lvsegs_with_info_and_status_single :
@@ -685,7 +789,7 @@ int report_for_selection(struct cmd_context *cmd,
 			r = _report_all_in_lv(cmd, handle, lv, sh->report_type, do_lv_info, do_lv_seg_status);
 			break;
 		case VGS:
-			r = _report_all_in_vg(cmd, handle, vg, sh->report_type, do_lv_info, do_lv_seg_status);
+			r = _report_all_in_vg(cmd, handle, vg, NULL, sh->report_type, do_lv_info, do_lv_seg_status);
 			break;
 		case PVS:
 			r = _report_all_in_pv(cmd, handle, pv, sh->report_type, do_lv_info, do_lv_seg_status);
@@ -1057,6 +1161,136 @@ static int _set_report_prefix_and_name(struct report_args *args,
 	return 1;
 }
 
+/*
+ * Returns whether the command's VG, VG/LV and @tag arguments select vg.
+ * When only some of its LVs are named, they are added to arg_lvnames.
+ */
+static int _cached_vg_selected(struct cmd_context *cmd, struct report_args *args,
+			       struct volume_group *vg, struct dm_list *arg_lvnames)
+{
+	const char *arg, *slash, *lv_name;
+	int selected = !args->argc, all_lvs = !args->argc;
+	int i;
+
+	for (i = 0; i < args->argc; i++) {
+		arg = args->argv[i];
+
+		if (*arg == '@') {
+			if (str_list_match_item(&vg->tags, arg + 1))
+				selected = all_lvs = 1;
+			continue;
+		}
+
+		arg = skip_dev_dir(cmd, arg, NULL);
+
+		if (!(slash = strchr(arg, '/'))) {
+			if (!strcmp(arg, vg->name))
+				selected = all_lvs = 1;
+			continue;
+		}
+
+		if (strncmp(arg, vg->name, slash - arg) || vg->name[slash - arg])
+			continue;
+
+		selected = 1;
+		if (!(lv_name = dm_pool_strdup(cmd->mem, slash + 1)) ||
+		    !str_list_add(cmd->mem, arg_lvnames, lv_name))
+			all_lvs = 1;
+	}
+
+	if (all_lvs)
+		dm_list_init(arg_lvnames);
+
+	return selected;
+}
+
+/* Nothing is scanned, PVs get the devices the hints last listed for them */
+static void _set_cached_pv_devices(struct cmd_context *cmd, struct volume_group *vg,
+				   struct dm_list *hints)
+{
+	struct pv_list *pvl;
+	struct hint *hint;
+	struct device *dev;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		dm_list_iterate_items(hint, hints)
+			if (!strncmp(hint->pvid, (const char *) &pvl->pv->id, ID_LEN)) {
+				if ((dev = dev_cache_get(cmd, hint->name, NULL)) &&
+				    (dev->dev == hint->devt))
+					pvl->pv->dev = dev;
+				break;
+			}
+}
+
+/*
+ * Report VGs from the snapshots of their metadata kept by the commands
+ * that read or committed them, without scanning devices or taking VG
+ * locks.  A snapshot last confirmed more than --cached seconds ago is
+ * still reported, with a warning that its VG may have changed since.
+ */
+static int _report_cached(struct cmd_context *cmd, struct processing_handle *handle,
+			  struct report_args *args, report_type_t report_type,
+			  int lv_info_needed, int lv_segment_status_needed)
+{
+	uint64_t max_age = arg_uint64_value(cmd, cached_ARG, 0);
+	time_t now = time(NULL);
+	struct dm_list snapshots, hints, arg_lvnames;
+	struct vg_snapshot *snap;
+	struct volume_group *vg;
+	int r = ECMD_PROCESSED;
+
+	switch (report_type) {
+		case LVSINFO:
+			/* fall through */
+		case LVSSTATUS:
+			/* fall through */
+		case LVSINFOSTATUS:
+			report_type = LVS;
+			/* fall through */
+		case LVS:
+		case VGS:
+		case SEGS:
+		case PVS:
+		case PVSEGS:
+			break;
+		default:
+			log_error("Fields requested need device scanning, not available with --cached.");
+			return ECMD_FAILED;
+	}
+
+	if (!vg_snapshot_list(cmd, &snapshots))
+		return_ECMD_FAILED;
+
+	get_hints_unchecked(cmd, &hints);
+
+	dm_list_iterate_items(snap, &snapshots) {
+		if (!(vg = vg_snapshot_read(cmd, snap))) {
+			log_warn("WARNING: Skipping VG %s, failed to read its snapshot.", snap->vgname);
+			continue;
+		}
+
+		dm_list_init(&arg_lvnames);
+
+		if (_cached_vg_selected(cmd, args, vg, &arg_lvnames)) {
+			if ((now < snap->mtime) || ((uint64_t) (now - snap->mtime) > max_age))
+				log_warn("WARNING: VG %s metadata is %llu seconds old and may be stale.",
+					 vg->name, (unsigned long long) (now - snap->mtime));
+
+			_set_cached_pv_devices(cmd, vg, &hints);
+
+			if (_report_all_in_vg(cmd, handle, vg, dm_list_empty(&arg_lvnames) ? NULL : &arg_lvnames,
+					      report_type, lv_info_needed, lv_segment_status_needed) != ECMD_PROCESSED)
+				r = ECMD_FAILED;
+		}
+
+		release_vg(vg);
+	}
+
+	free_hints(&hints);
+
+	return r;
+}
+
 static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 		      struct report_args *args, struct single_report_args *single_args)
 {
@@ -1086,6 +1320,11 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 		report_in_group = 1;
 	}
 
+	if (arg_is_set(cmd, cached_ARG) && !args->full_report_vg && (report_type != CMDLOG)) {
+		r = _report_cached(cmd, handle, args, report_type, lv_info_needed, lv_segment_status_needed);
+		goto output;
+	}
+
 	switch (report_type) {
 		case DEVTYPES:
 			r = _process_each_devtype(cmd, args->argc, handle);
@@ -1098,7 +1337,7 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 			/* fall through */
 		case LVS:
 			if (args->full_report_vg)
-				r = _report_all_in_vg(cmd, handle, args->full_report_vg, LVS, lv_info_needed, lv_segment_status_needed);
+				r = _report_all_in_vg(cmd, handle, args->full_report_vg, NULL, LVS, lv_info_needed, lv_segment_status_needed);
 			else
 				r = process_each_lv(cmd, args->argc, args->argv, NULL, NULL, 0, handle, NULL,
 						    lv_info_needed && !lv_segment_status_needed ? &_lvs_with_info_single :
@@ -1108,7 +1347,7 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 			break;
 		case VGS:
 			if (args->full_report_vg)
-				r = _report_all_in_vg(cmd, handle, args->full_report_vg, VGS, lv_info_needed, lv_segment_status_needed);
+				r = _report_all_in_vg(cmd, handle, args->full_report_vg, NULL, VGS, lv_info_needed, lv_segment_status_needed);
 			else
 				r = process_each_vg(cmd, args->argc, args->argv, NULL, NULL,
 						    0, 0, handle, &_vgs_single);
@@ -1119,7 +1358,7 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 			break;
 		case PVS:
 			if (args->full_report_vg)
-				r = _report_all_in_vg(cmd, handle, args->full_report_vg, PVS, lv_info_needed, lv_segment_status_needed);
+				r = _report_all_in_vg(cmd, handle, args->full_report_vg, NULL, PVS, lv_info_needed, lv_segment_status_needed);
 			else {
 				if (single_args->args_are_pvs)
 					r = process_each_pv(cmd, args->argc, args->argv, NULL,
@@ -1132,7 +1371,7 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 			break;
 		case SEGS:
 			if (args->full_report_vg)
-				r = _report_all_in_vg(cmd, handle, args->full_report_vg, SEGS, lv_info_needed, lv_segment_status_needed);
+				r = _report_all_in_vg(cmd, handle, args->full_report_vg, NULL, SEGS, lv_info_needed, lv_segment_status_needed);
 			else
 				r = process_each_lv(cmd, args->argc, args->argv, NULL, NULL, 0, handle, NULL,
 						    lv_info_needed && !lv_segment_status_needed ? &_lvsegs_with_info_single :
@@ -1142,7 +1381,7 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 			break;
 		case PVSEGS:
 			if (args->full_report_vg)
-				r = _report_all_in_vg(cmd, handle, args->full_report_vg, PVSEGS, lv_info_needed, lv_segment_status_needed);
+				r = _report_all_in_vg(cmd, handle, args->full_report_vg, NULL, PVSEGS, lv_info_needed, lv_segment_status_needed);
 			else {
 				if (single_args->args_are_pvs)
 					r = process_each_pv(cmd, args->argc, args->argv, NULL,
@@ -1172,6 +1411,7 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 			return 0;
 	}
 
+output:
 	if (find_config_tree_bool(cmd, report_compact_output_CFG, NULL)) {
 		if (!dm_report_compact_fields(report_handle))
 			log_error("Failed to compact report output.");
@@ -1208,6 +1448,9 @@ static int _full_report_single(struct cmd_context *cmd,
 
 	args->full_report_vg = vg;
 
+	if (!orphan && !_status_memo_begin())
+		goto_out;
+
 	if (!args->log_only && !dm_report_group_push(cmd->cmd_report.report_group, NULL, NULL))
 		goto out;
 
@@ -1227,6 +1470,7 @@ static int _full_report_single(struct cmd_context *cmd,
 	if (!args->log_only && !dm_report_group_pop(cmd->cmd_report.report_group))
 		goto_out;
 out:
+	_status_memo_end();
 	args->full_report_vg = NULL;
 	return r;
 }
@@ -1392,12 +1636,18 @@ static int _report(struct cmd_context *cmd, int argc, char **argv, report_type_t
 		return ECMD_FAILED;
 	}
 
+	/* Answer queries of inactive LVs without per-LV ioctls */
+	if (!activation_cache_devs(cmd))
+		stack;
+
 	if (single_args->report_type == FULL) {
 		handle->custom_handle = &args;
 		r = process_each_vg(cmd, argc, argv, NULL, NULL, 0, 1, handle, &_full_report_single);
 	} else
 		r = _do_report(cmd, handle, &args, single_args);
 
+	activation_uncache_devs();
+
 	if (!args.log_only && !dm_report_group_pop(cmd->cmd_report.report_group)) {
 		log_error("Failed to finalize main report section in report group.");
 		r = ECMD_FAILED;
@@ -1455,6 +1705,7 @@ int devtypes(struct cmd_context *cmd, int argc, char **argv)
 
 #define REPORT_FORMAT_NAME_BASIC "basic"
 #define REPORT_FORMAT_NAME_JSON "json"
+#define REPORT_FORMAT_NAME_BINARY "binary"
 
 int report_format_init(struct cmd_context *cmd)
 {
@@ -1475,11 +1726,14 @@ int report_format_init(struct cmd_context *cmd)
 										: DM_REPORT_GROUP_SINGLE;
 	} else if (!strcmp(format_str, REPORT_FORMAT_NAME_JSON)) {
 		args.report_group_type = DM_REPORT_GROUP_JSON;
+	} else if (!strcmp(format_str, REPORT_FORMAT_NAME_BINARY)) {
+		args.report_group_type = DM_REPORT_GROUP_BINARY;
 	} else {
 		log_error("%s: unknown report format.", format_str);
-		log_error("Supported report formats: %s, %s.",
+		log_error("Supported report formats: %s, %s, %s.",
 			  REPORT_FORMAT_NAME_BASIC,
-			  REPORT_FORMAT_NAME_JSON);
+			  REPORT_FORMAT_NAME_JSON,
+			  REPORT_FORMAT_NAME_BINARY);
 		return 0;
 	}
 
@@ -57,6 +57,9 @@ int become_daemon(struct cmd_context *cmd, int skip_lvm)
 	if (sigaction(SIGCHLD, &act, NULL))
 		log_warn("WARNING: Failed to set SIGCHLD action.");
 
+	/* The child must not inherit the cookie */
+	cmd->udev_sync_deferred = 0;
+
 	if (!skip_lvm)
 		if (!sync_local_dev_names(cmd)) { /* Flush ops and reset dm cookie */
 			log_error("Failed to sync local devices before forking.");
@@ -104,6 +107,8 @@ int become_daemon(struct cmd_context *cmd, int skip_lvm)
 
 	if (!skip_lvm) {
 		reset_locking();
+		/* The io engine's state belongs to the parent, start afresh. */
+		label_scan_destroy(cmd);
 		lvmcache_destroy(cmd, 1, 1);
 		if (!lvmcache_init(cmd))
 			/* FIXME Clean up properly here */
@@ -826,7 +831,10 @@ int lv_refresh(struct cmd_context *cmd, struct logical_volume *lv)
 						display_lvname(lv), display_lvname(snapshot_lv));
 	}
 
-	if (!lv_refresh_suspend_resume(lv))
+	if (!lv_refresh_changes_tables(cmd, lv))
+		log_verbose("Skipping suspend and resume of %s with unchanged tables.",
+			    display_lvname(lv));
+	else if (!lv_refresh_suspend_resume(lv))
 		return_0;
 
 	/*
@@ -990,8 +998,8 @@ int get_pool_params(struct cmd_context *cmd,
 /*
  * Generic stripe parameter checks.
  */
-static int _validate_stripe_params(struct cmd_context *cmd, const struct segment_type *segtype,
-				   uint32_t *stripes, uint32_t *stripe_size)
+int validate_stripe_params(struct cmd_context *cmd, const struct segment_type *segtype,
+			   uint32_t *stripes, uint32_t *stripe_size)
 {
 	if (*stripes < 1 || *stripes > MAX_STRIPES) {
 		log_error("Number of stripes (%d) must be between %d and %d.",
@@ -1037,17 +1045,32 @@ static int _validate_stripe_params(struct cmd_context *cmd, const struct segment
  * power of 2, we must divide UINT_MAX by four and add 1 (to round it
  * up to the power of 2)
  */
+int stripe_arg_is_auto(struct cmd_context *cmd, int a)
+{
+	return arg_is_set(cmd, a) && !strcmp(arg_str_value(cmd, a, ""), "auto");
+}
+
 int get_stripe_params(struct cmd_context *cmd, const struct segment_type *segtype,
 		      uint32_t *stripes, uint32_t *stripe_size,
 		      unsigned *stripes_supplied, unsigned *stripe_size_supplied)
 {
+	int stripes_auto = stripe_arg_is_auto(cmd, stripes_ARG);
+	int stripe_size_auto = stripe_arg_is_auto(cmd, stripesize_ARG);
+
+	if ((stripes_auto || stripe_size_auto) &&
+	    (strcmp(cmd->name, "lvcreate") || !segtype_is_striped(segtype) ||
+	     segtype_is_raid(segtype))) {
+		log_error("Only lvcreate of a striped LV can choose stripes or stripesize automatically.");
+		return 0;
+	}
+
 	/* stripes_long_ARG takes precedence (for lvconvert) */
 	/* FIXME Cope with relative +/- changes for lvconvert. */
 	if (arg_is_set(cmd, stripes_long_ARG)) {
 		*stripes = arg_uint_value(cmd, stripes_long_ARG, 0);
 		*stripes_supplied = 1;
 	} else if (arg_is_set(cmd, stripes_ARG)) {
-		*stripes = arg_uint_value(cmd, stripes_ARG, 0);
+		*stripes = stripes_auto ? 1 : arg_uint_value(cmd, stripes_ARG, 0);
 		*stripes_supplied = 1;
 	} else {
 		/*
@@ -1071,7 +1094,11 @@ int get_stripe_params(struct cmd_context *cmd, const struct segment_type *segtyp
 	}
 	*stripe_size_supplied = arg_is_set(cmd, stripesize_ARG);
 
-	return _validate_stripe_params(cmd, segtype, stripes, stripe_size);
+	/* lvcreate checks them once it has chosen from the PVs */
+	if (stripes_auto || stripe_size_auto)
+		return 1;
+
+	return validate_stripe_params(cmd, segtype, stripes, stripe_size);
 }
 
 static int _validate_cachepool_params(const char *policy_name, cache_mode_t cache_mode)
@@ -1576,6 +1603,15 @@ int get_and_validate_major_minor(const struct cmd_context *cmd,
 	return 1;
 }
 
+/* Is arg a plain VG/LV name within vg_name? */
+int is_vg_lv_arg(const char *arg, const char *vg_name)
+{
+	size_t len = strlen(vg_name);
+
+	return (arg[0] != '/') && !strncmp(arg, vg_name, len) &&
+		(arg[len] == '/') && arg[len + 1] && !strchr(arg + len + 1, '/');
+}
+
 /*
  * Validate lvname parameter
  *
@@ -1768,6 +1804,10 @@ void destroy_processing_handle(struct cmd_context *cmd, struct processing_handle
 		log_restore_report_state(cmd->cmd_report.saved_log_report_state);
 
 		if (!cmd->is_interactive) {
+			/* Add times to the log report before it is output */
+			if (cmd->cmd_report.log_rh)
+				timing_report(cmd->cmd_report.log_rh);
+
 			if (!dm_report_group_destroy(cmd->cmd_report.report_group))
 				stack;
 			cmd->cmd_report.report_group = NULL;
@@ -1842,6 +1882,36 @@ static int _select_matches(struct processing_handle *handle)
 	return handle->selection_handle->selected;
 }
 
+/*
+ * Number of VGs ahead of the one being processed whose metadata is
+ * being read in the background.
+ */
+#define VG_PREFETCH_AHEAD 16
+
+/*
+ * Commands that only read VGs start reading the metadata of the next
+ * few VGs before each one is processed, so those reads overlap instead
+ * of each vg_read() waiting for its own.  VGs are still read, locked
+ * and processed one at a time, in order.
+ */
+static struct dm_list *_prefetch_vgnameids(struct cmd_context *cmd,
+					   struct dm_list *vgnameids,
+					   struct dm_list *next, unsigned *ahead)
+{
+	struct vgnameid_list *vgnl;
+
+	if (*ahead)
+		(*ahead)--;
+
+	for (; (next != vgnameids) && (*ahead < VG_PREFETCH_AHEAD); next = next->n, (*ahead)++) {
+		vgnl = dm_list_item(next, struct vgnameid_list);
+		if (vgnl->vgid && !is_orphan_vg(vgnl->vg_name))
+			vg_read_prefetch(cmd, vgnl->vg_name, vgnl->vgid);
+	}
+
+	return next;
+}
+
 static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 				  struct dm_list *vgnameids_to_process,
 				  struct dm_list *arg_vgnames,
@@ -1854,10 +1924,12 @@ static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 	struct volume_group *vg;
 	struct volume_group *error_vg = NULL;
 	struct vgnameid_list *vgnl;
+	struct dm_list *prefetch_next = NULL;
 	const char *vg_name;
 	const char *vg_uuid;
 	uint32_t lockd_state = 0;
 	uint32_t error_flags = 0;
+	unsigned prefetch_ahead = 0;
 	int whole_selected = 0;
 	int ret_max = ECMD_PROCESSED;
 	int ret;
@@ -1874,6 +1946,9 @@ static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 	if (dm_list_empty(arg_vgnames) && dm_list_empty(arg_tags))
 		process_all = 1;
 
+	if (!(read_flags & READ_FOR_UPDATE) && (dm_list_size(vgnameids_to_process) > 1))
+		prefetch_next = vgnameids_to_process->n;
+
 	/*
 	 * FIXME If one_vgname, only proceed if exactly one VG matches tags or selection.
 	 */
@@ -1883,6 +1958,10 @@ static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 		skip = 0;
 		notfound = 0;
 
+		if (prefetch_next)
+			prefetch_next = _prefetch_vgnameids(cmd, vgnameids_to_process,
+							    prefetch_next, &prefetch_ahead);
+
 		uuid[0] = '\0';
 		if (is_orphan_vg(vg_name)) {
 			log_set_report_object_type(LOG_REPORT_OBJECT_TYPE_ORPHAN);
@@ -2943,6 +3022,7 @@ int process_each_lv_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 	unsigned process_all = 0;
 	unsigned tags_supplied = 0;
 	unsigned lvargs_supplied = 0;
+	struct str_set *tags_set = NULL;
 	int lv_is_named_arg;
 	int lv_arg_pos;
 	struct lv_list *lvl;
@@ -2985,6 +3065,13 @@ int process_each_lv_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 	    (tags_supplied && str_list_match_list(tags_in, &vg->tags, NULL)))
 		process_all = 1;
 
+	/* Matched against every LV */
+	if (tags_supplied && !process_all &&
+	    !(tags_set = str_set_create(cmd->mem, tags_in, NULL))) {
+		ret_max = ECMD_FAILED;
+		goto_out;
+	}
+
 	log_set_report_object_group_and_group_id(vg->name, vg_uuid);
 
 	dm_list_iterate_items(lvl, &vg->lvs) {
@@ -3058,7 +3145,7 @@ int process_each_lv_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 			process_lv = 1;
 		}
 
-		if (!process_lv && tags_supplied && str_list_match_list(tags_in, &lvl->lv->tags, NULL))
+		if (!process_lv && tags_set && str_set_match_list(tags_set, &lvl->lv->tags, NULL))
 			process_lv = 1;
 
 		process_lv = process_lv && select_match_lv(cmd, handle, vg, lvl->lv) && _select_matches(handle);
@@ -3621,6 +3708,14 @@ static int _process_lv_vgnameid_list(struct cmd_context *cmd, uint32_t read_flag
 		if (ret > ret_max)
 			ret_max = ret;
 
+		if (handle->process_lvs_done) {
+			ret = handle->process_lvs_done(cmd, vg, handle);
+			if (ret != ECMD_PROCESSED)
+				stack;
+			if (ret > ret_max)
+				ret_max = ret;
+		}
+
 		unlock_vg(cmd, vg, vg_name);
 endvg:
 		release_vg(vg);
@@ -4100,6 +4195,7 @@ static int _process_pvs_in_vg(struct cmd_context *cmd,
 	struct device_list *devl;
 	struct dm_list outdated_devs;
 	const char *pv_name;
+	struct str_set *tags_set = NULL;
 	int process_pv;
 	int do_report_ret_code = 1;
 	int ret_max = ECMD_PROCESSED;
@@ -4127,6 +4223,13 @@ static int _process_pvs_in_vg(struct cmd_context *cmd,
 	if (!is_orphan_vg(vg->name))
 		log_set_report_object_group_and_group_id(vg->name, vg_uuid);
 
+	/* Matched against every PV */
+	if (!process_all_pvs && arg_tags && !dm_list_empty(arg_tags) &&
+	    !(tags_set = str_set_create(cmd->mem, arg_tags, NULL))) {
+		ret_max = ECMD_FAILED;
+		goto_out;
+	}
+
 	dm_list_iterate_items(pvl, &vg->pvs) {
 		pv = pvl->pv;
 		pv_name = pv_dev_name(pv);
@@ -4154,8 +4257,8 @@ static int _process_pvs_in_vg(struct cmd_context *cmd,
 		if (!process_pv && dil)
 			process_pv = 1;
 
-		if (!process_pv && !dm_list_empty(arg_tags) &&
-		    str_list_match_list(arg_tags, &pv->tags, NULL))
+		if (!process_pv && tags_set &&
+		    str_set_match_list(tags_set, &pv->tags, NULL))
 			process_pv = 1;
 
 		process_pv = process_pv && select_match_pv(cmd, handle, vg, pv) && _select_matches(handle);
@@ -4711,6 +4814,7 @@ struct pvcreate_device {
 	struct device *dev;
 	char pvid[ID_LEN + 1];
 	const char *vg_name;
+	struct physical_volume *pv; /* new PV written on the device */
 	int wiped;
 	unsigned is_not_pv : 1;     /* device is not a PV */
 	unsigned is_orphan_pv : 1;  /* device is an orphan PV */
@@ -5226,6 +5330,7 @@ int pvcreate_each_device(struct cmd_context *cmd,
 	unsigned int prev_pbs = 0, prev_lbs = 0;
 	int must_use_all = (cmd->cname->flags & MUST_USE_ALL_ARGS);
 	int unlocked_for_prompts = 0;
+	int global_ex = 1;
 	int found;
 	unsigned i;
 
@@ -5296,6 +5401,30 @@ int pvcreate_each_device(struct cmd_context *cmd,
 	if (dm_list_empty(&pp->arg_devices))
 		goto_bad;
 
+	/*
+	 * pvcreate and pvremove hold the global lock sh and exclude other
+	 * commands using the same devices with per-device locks.  Take them
+	 * before the args are rescanned below so the checks see current
+	 * labels.  With the global lock ex they are not needed.
+	 */
+	if (!cmd->lockf_global_ex) {
+		struct device **devs;
+		unsigned count = 0;
+
+		if (!(devs = dm_pool_alloc(cmd->mem, dm_list_size(&pp->arg_devices) * sizeof(*devs))))
+			goto_bad;
+
+		dm_list_iterate_items(pd, &pp->arg_devices)
+			devs[count++] = pd->dev;
+
+		if (!lockf_devices(cmd, devs, count)) {
+			/* Let pvremove -ff skip locks */
+			if (!pp->is_remove || (pp->force != DONT_PROMPT_OVERRIDE))
+				goto_bad;
+			log_warn("WARNING: skipping device locks for force.");
+		}
+	}
+
 	/*
 	 * Clear the filtering results from lvmcache_label_scan because we are
 	 * going to rerun the filters and don't want to get the results saved
@@ -5466,6 +5595,8 @@ int pvcreate_each_device(struct cmd_context *cmd,
 	 * during the wait, then do the create steps.
 	 */
 
+	global_ex = cmd->lockf_global_ex;
+
 	lockf_global(cmd, "un");
 
 	unlocked_for_prompts = 1;
@@ -5508,7 +5639,7 @@ int pvcreate_each_device(struct cmd_context *cmd,
 	 * potential deadlock since this is not the normal locking sequence.
 	 */
 
-	if (!lockf_global_nonblock(cmd, "ex")) {
+	if (!lockf_global_nonblock(cmd, global_ex ? "ex" : "sh")) {
 		log_error("Failed to reacquire global lock after prompt.");
 		goto_out;
 	}
@@ -5648,7 +5779,13 @@ do_command:
 	 * Create PVs on devices.  Either create a new PV on top of an existing
 	 * one (e.g. for pvcreate), or create a new PV on a device that is not
 	 * a PV.
+	 *
+	 * The label and metadata writes for all the devices are issued
+	 * as one batch through the io engine and waited for together, so
+	 * the devices are written concurrently rather than one by one.
 	 */
+	dev_write_batch_begin();
+
 	dm_list_iterate_items_safe(pd, pd2, &pp->arg_create) {
 		/* Using existing orphan PVs is covered above. */
 		if (pp->preserve_existing && pd->is_orphan_pv)
@@ -5657,12 +5794,6 @@ do_command:
 		if (!dm_list_empty(&pp->arg_fail) && must_use_all)
 			break;
 
-		if (!(pvl = dm_pool_alloc(cmd->mem, sizeof(*pvl)))) {
-			log_error("alloc pvl failed.");
-			dm_list_move(&pp->arg_fail, &pd->list);
-			continue;
-		}
-
 		pv_name = pd->name;
 
 		log_debug("Creating a new PV on %s.", pv_name);
@@ -5700,11 +5831,7 @@ do_command:
 			continue;
 		}
 
-		log_print_unless_silent("Physical volume \"%s\" successfully created.",
-					pv_name);
-
-		pvl->pv = pv;
-		dm_list_add(&pp->pvs, &pvl->list);
+		pd->pv = pv;
 	}
 
 	/*
@@ -5716,9 +5843,6 @@ do_command:
 			dm_list_move(&pp->arg_fail, &pd->list);
 			continue;
 		}
-
-		log_print_unless_silent("Labels on physical volume \"%s\" successfully wiped.",
-					pd->name);
 	}
 
 	/*
@@ -5730,11 +5854,62 @@ do_command:
 			dm_list_move(&pp->arg_fail, &pd->list);
 			continue;
 		}
+	}
+
+	/* Devices are only reported once their writes have completed. */
+	dev_write_batch_end();
+
+	dm_list_iterate_items_safe(pd, pd2, &pp->arg_create) {
+		if (!pd->pv)
+			continue;
+
+		if (dev_write_batch_failed(pd->dev)) {
+			log_error("Failed to write physical volume \"%s\".", pd->name);
+			dm_list_move(&pp->arg_fail, &pd->list);
+			continue;
+		}
+
+		if (!(pvl = dm_pool_alloc(cmd->mem, sizeof(*pvl)))) {
+			log_error("alloc pvl failed.");
+			dm_list_move(&pp->arg_fail, &pd->list);
+			continue;
+		}
+
+		log_print_unless_silent("Physical volume \"%s\" successfully created.",
+					pd->name);
+
+		journal_hint_add(cmd, pd->dev, (const char *) &pd->pv->id);
+
+		pvl->pv = pd->pv;
+		dm_list_add(&pp->pvs, &pvl->list);
+	}
+
+	dm_list_iterate_items_safe(pd, pd2, &pp->arg_remove) {
+		if (dev_write_batch_failed(pd->dev)) {
+			log_error("Failed to wipe existing label(s) on %s.", pd->name);
+			dm_list_move(&pp->arg_fail, &pd->list);
+			continue;
+		}
+
+		log_print_unless_silent("Labels on physical volume \"%s\" successfully wiped.",
+					pd->name);
+
+		journal_hint_remove(cmd, pd->dev);
+	}
+
+	dm_list_iterate_items_safe(pd, pd2, &remove_duplicates) {
+		if (dev_write_batch_failed(pd->dev)) {
+			log_error("Failed to wipe existing label(s) on %s.", pd->name);
+			dm_list_move(&pp->arg_fail, &pd->list);
+			continue;
+		}
 
 		lvmcache_del_dev_from_duplicates(pd->dev);
 
 		log_print_unless_silent("Labels on physical volume \"%s\" successfully wiped.",
 					pd->name);
+
+		journal_hint_remove(cmd, pd->dev);
 	}
 
 	/*
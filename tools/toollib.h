@@ -74,6 +74,10 @@ struct processing_handle {
 	int include_historical_lvs;
 	struct selection_handle *selection_handle;
 	void *custom_handle;
+	/* Optional: run by process_each_lv() after the LVs of each VG */
+	int (*process_lvs_done) (struct cmd_context *cmd,
+				 struct volume_group *vg,
+				 struct processing_handle *handle);
 };
 
 typedef int (*process_single_vg_fn_t) (struct cmd_context * cmd,
@@ -206,6 +210,9 @@ int get_pool_params(struct cmd_context *cmd,
 		    thin_discards_t *discards,
 		    thin_zero_t *zero_new_blocks);
 
+int stripe_arg_is_auto(struct cmd_context *cmd, int a);
+int validate_stripe_params(struct cmd_context *cmd, const struct segment_type *segtype,
+			   uint32_t *stripes, uint32_t *stripe_size);
 int get_stripe_params(struct cmd_context *cmd, const struct segment_type *segtype,
 		      uint32_t *stripes, uint32_t *stripe_size,
 		      unsigned *stripes_supplied, unsigned *stripe_size_supplied);
@@ -227,6 +234,7 @@ int get_and_validate_major_minor(const struct cmd_context *cmd,
 				 const struct format_type *fmt,
 				 int32_t *major, int32_t *minor);
 
+int is_vg_lv_arg(const char *arg, const char *vg_name);
 int validate_lvname_param(struct cmd_context *cmd, const char **vg_name,
 			  const char **lv_name);
 int validate_restricted_lvname_param(struct cmd_context *cmd, const char **vg_name,
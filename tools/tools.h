@@ -19,6 +19,7 @@
 #include "tools/tool.h"
 
 #include "lib/log/lvm-logging.h"
+#include "lib/log/timing.h"
 
 #include "lib/activate/activate.h"
 #include "lib/format_text/archiver.h"
@@ -174,6 +175,8 @@ int segtype_arg(struct cmd_context *cmd, struct arg_values *av);
 int alloc_arg(struct cmd_context *cmd, struct arg_values *av);
 int locktype_arg(struct cmd_context *cmd, struct arg_values *av);
 int readahead_arg(struct cmd_context *cmd, struct arg_values *av);
+int stripes_arg(struct cmd_context *cmd, struct arg_values *av);
+int stripesize_arg(struct cmd_context *cmd, struct arg_values *av);
 int regionsize_mb_arg(struct cmd_context *cmd, struct arg_values *av);
 int vgmetadatacopies_arg(struct cmd_context *cmd __attribute__((unused)), struct arg_values *av);
 int pvmetadatacopies_arg(struct cmd_context *cmd __attribute__((unused)), struct arg_values *av);
@@ -278,6 +281,7 @@ int lvconvert_integrity_cmd(struct cmd_context *cmd, int argc, char **argv);
 
 int lvcreate_and_attach_writecache_cmd(struct cmd_context *cmd, int argc, char **argv);
 int lvcreate_and_attach_cache_cmd(struct cmd_context *cmd, int argc, char **argv);
+int lvcreate_batch_cmd(struct cmd_context *cmd, int argc, char **argv);
 
 int pvscan_display_cmd(struct cmd_context *cmd, int argc, char **argv);
 int pvscan_cache_cmd(struct cmd_context *cmd, int argc, char **argv);
@@ -132,13 +132,15 @@ val(segtype_VAL, segtype_arg, "SegType", "linear|striped|snapshot|mirror|raid|th
 val(alloc_VAL, alloc_arg, "Alloc", "contiguous|cling|cling_by_tags|normal|anywhere|inherit")
 val(locktype_VAL, locktype_arg, "LockType", "sanlock|dlm|none")
 val(readahead_VAL, readahead_arg, "Readahead", "auto|none|Number")
+val(stripes_VAL, stripes_arg, "Stripes", "auto|Number")
+val(stripesize_VAL, stripesize_arg, "StripeSize", "auto|Size[k|UNIT]")
 val(vgmetadatacopies_VAL, vgmetadatacopies_arg, "MetadataCopiesVG", "all|unmanaged|Number")
 val(pvmetadatacopies_VAL, pvmetadatacopies_arg, "MetadataCopiesPV", "0|1|2")
 val(metadatacopies_VAL, metadatacopies_arg, "unused", "unused")
 val(polloperation_VAL, polloperation_arg, "PollOp", "pvmove|convert|merge|merge_thin")
 val(writemostly_VAL, writemostly_arg, "WriteMostlyPV", "PV[:t|n|y]")
 val(syncaction_VAL, syncaction_arg, "SyncAction", "check|repair")
-val(reportformat_VAL, reportformat_arg, "ReportFmt", "basic|json")
+val(reportformat_VAL, reportformat_arg, "ReportFmt", "basic|json|binary")
 val(configreport_VAL, configreport_arg, "ConfigReport", "log|vg|lv|pv|pvseg|seg")
 val(configtype_VAL, configtype_arg, "ConfigType", "current|default|diff|full|list|missing|new|profilable|profilable-command|profilable-metadata")
 val(repairtype_VAL, repairtype_arg, "RepairType", "pv_header|metadata|label_header")
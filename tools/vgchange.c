@@ -81,15 +81,14 @@ static int _poll_lvs_in_vg(struct cmd_context *cmd,
 static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 			       activation_change_t activate)
 {
-	struct lv_list *lvl;
+	struct lv_list *lvl, *alvl;
 	struct logical_volume *lv;
+	struct dm_list lvs;
 	int count = 0, expected_count = 0, r = 1;
 
-	sigint_allow();
-	dm_list_iterate_items(lvl, &vg->lvs) {
-		if (sigint_caught())
-			return_0;
+	dm_list_init(&lvs);
 
+	dm_list_iterate_items(lvl, &vg->lvs) {
 		lv = lvl->lv;
 
 		if (!lv_is_visible(lv) && (!cmd->process_component_lvs || !lv_is_component(lv)))
@@ -117,9 +116,39 @@ static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 		    !lv_passes_auto_activation_filter(cmd, lv))
 			continue;
 
+		if (!(alvl = dm_pool_alloc(cmd->mem, sizeof(*alvl)))) {
+			log_error("Failed to allocate LV list.");
+			return 0;
+		}
+		alvl->lv = lv;
+		dm_list_add(&lvs, &alvl->list);
+	}
+
+	/*
+	 * Bring up all plain LVs in one device tree first, the loop below
+	 * then finds them active and handles whatever remains.
+	 */
+	if (is_change_activating(activate) && !vg_is_shared(vg) &&
+	    !(lvmcache_has_duplicate_devs() && vg_has_duplicate_pvs(vg)) &&
+	    !activate_lvs_batch(cmd, &lvs))
+		log_debug_activation("Batched activation failed in VG %s, activating LVs one by one.",
+				     vg->name);
+
+	/* Take the LV locks of a shared VG in one lvmlockd request */
+	if (is_change_activating(activate) && vg_is_shared(vg) &&
+	    !lockd_lv_batch(cmd, &lvs, (activate == CHANGE_ASY) ? "sh" :
+			    (activate == CHANGE_AEY) ? "ex" : NULL, LDLV_PERSISTENT))
+		log_debug("Batched LV locking failed in VG %s, locking LVs one by one.",
+			  vg->name);
+
+	sigint_allow();
+	dm_list_iterate_items(lvl, &lvs) {
+		if (sigint_caught())
+			return_0;
+
 		expected_count++;
 
-		if (!lv_change_activate(cmd, lv, activate)) {
+		if (!lv_change_activate(cmd, lvl->lv, activate)) {
 			stack;
 			r = 0;
 			continue;
@@ -787,6 +816,10 @@ int vgchange(struct cmd_context *cmd, int argc, char **argv)
 			cmd->lockd_vg_enforce_sh = 1;
 	}
 
+	if ((cmd->command->command_enum == vgchange_activate_CMD) &&
+	    is_change_activating((activation_change_t)arg_uint_value(cmd, activate_ARG, CHANGE_AY)))
+		cmd->udev_sync_deferred = find_config_tree_bool(cmd, activation_udev_sync_deferred_CFG, NULL);
+
 	if (update)
 		flags |= READ_FOR_UPDATE;
 	else if (arg_is_set(cmd, activate_ARG))
@@ -58,11 +58,24 @@ static int _vgremove_single(struct cmd_context *cmd, const char *vg_name,
 			}
 		}
 
+		/*
+		 * As with lvremove, commit all LV removals at once so each
+		 * thin pool that survives gets a single delete transaction.
+		 */
+		if (!vg_is_shared(vg))
+			vg->defer_remove_commit = 1;
+
 		if ((ret = process_each_lv_in_vg(cmd, vg, NULL, NULL, 1, &void_handle,
 						 NULL, (process_single_lv_fn_t)lvremove_single)) != ECMD_PROCESSED) {
 			stack;
+			/* Still commit the LVs that were removed. */
+			if (!vg_commit_removed_lvs(vg, force))
+				stack;
 			return ret;
 		}
+
+		if (!vg_commit_removed_lvs(vg, force))
+			return_ECMD_FAILED;
 	}
 
 	if (!lockd_free_vg_before(cmd, vg, 0))
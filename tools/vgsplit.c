@@ -25,11 +25,17 @@ static int _lv_is_in_vg(struct volume_group *vg, struct logical_volume *lv)
 
 static struct dm_list *_lvh_in_vg(struct logical_volume *lv, struct volume_group *vg)
 {
-	struct dm_list *lvh;
+	struct lv_list *lvl;
 
-	dm_list_iterate(lvh, &vg->lvs)
-		if (lv == dm_list_item(lvh, struct lv_list)->lv)
-			return lvh;
+	if (!_lv_is_in_vg(vg, lv))
+		return NULL;
+
+	if ((lvl = lv_index_find_name(vg, lv->name)) && (lvl->lv == lv))
+		return &lvl->list;
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (lv == lvl->lv)
+			return &lvl->list;
 
 	return NULL;
 }
@@ -58,7 +64,7 @@ static int _lv_tree_move(struct dm_list *lvh,
 				if ((lvh1 = _lvh_in_vg(seg_lv(seg, s), vg_from))) {
 					if (!_lv_tree_move(lvh1, lvht, vg_from, vg_to))
 						return 0;
-				} else if (!_lvh_in_vg(seg_lv(seg, s), vg_to))
+				} else if (!_lv_is_in_vg(vg_to, seg_lv(seg, s)))
 					return 0;
 			}
 
@@ -82,7 +88,7 @@ static int _move_one_lv(struct volume_group *vg_from,
 	}
 
 	/* Bail out, if any allocations of @lv are still on PVs of @vg_from */
-	if (lv_is_on_pvs(lv, &vg_from->pvs)) {
+	if (lv_is_on_vg_pvs(lv, vg_from)) {
 		log_error("Can't split LV %s between "
 			  "two Volume Groups", lv->name);
 		return 0;
@@ -144,7 +150,7 @@ static int _move_lvs(struct volume_group *vg_from, struct volume_group *vg_to)
 
 				pv = seg_pv(seg, s);
 				if (vg_with) {
-					if (!pv_is_in_vg(vg_with, pv)) {
+					if (pv->vg != vg_with) {
 						log_error("Can't split Logical "
 							  "Volume %s between "
 							  "two Volume Groups",
@@ -154,11 +160,11 @@ static int _move_lvs(struct volume_group *vg_from, struct volume_group *vg_to)
 					continue;
 				}
 
-				if (pv_is_in_vg(vg_from, pv)) {
+				if (pv->vg == vg_from) {
 					vg_with = vg_from;
 					continue;
 				}
-				if (pv_is_in_vg(vg_to, pv)) {
+				if (pv->vg == vg_to) {
 					vg_with = vg_to;
 					continue;
 				}
@@ -247,7 +253,7 @@ static int _move_mirrors(struct volume_group *vg_from,
 			continue;
 
 		/* Ignore, if no allocations on PVs of @vg_to */
-		if (!lv_is_on_pvs(lv, &vg_to->pvs))
+		if (!lv_is_on_vg_pvs(lv, vg_to))
 			continue;
 
 		seg = first_seg(lv);
@@ -309,7 +315,7 @@ static int _move_raids(struct volume_group *vg_from,
 			continue;
 
 		/* Ignore, if no allocations on PVs of @vg_to */
-		if (!lv_is_on_pvs(lv, &vg_to->pvs))
+		if (!lv_is_on_vg_pvs(lv, vg_to))
 			continue;
  
 		/* If allocations are on PVs of @vg_to -> move RAID LV stack across */
@@ -335,8 +341,8 @@ static int _move_thins(struct volume_group *vg_from,
 			data_lv = seg_lv(first_seg(seg->pool_lv), 0);
 
 			/* Ignore, if no allocations on PVs of @vg_to */
-			if (!lv_is_on_pvs(data_lv, &vg_to->pvs) &&
-			    (seg->external_lv && !lv_is_on_pvs(seg->external_lv, &vg_to->pvs)))
+			if (!lv_is_on_vg_pvs(data_lv, vg_to) &&
+			    (seg->external_lv && !lv_is_on_vg_pvs(seg->external_lv, vg_to)))
 				continue;
 
 			if ((_lv_is_in_vg(vg_to, data_lv) ||
@@ -357,7 +363,7 @@ static int _move_thins(struct volume_group *vg_from,
 			data_lv = seg_lv(seg, 0);
 
 			/* Ignore, if no allocations on PVs of @vg_to */
-			if (!lv_is_on_pvs(data_lv, &vg_to->pvs))
+			if (!lv_is_on_vg_pvs(data_lv, vg_to))
 				continue;
 
 			if (_lv_is_in_vg(vg_to, data_lv) ||
@@ -393,7 +399,7 @@ static int _move_vdos(struct volume_group *vg_from,
 			vdo_data_lv = seg_lv(first_seg(seg_lv(seg, 0)), 0);
 
 			/* Ignore, if no allocations on PVs of @vg_to */
-			if (!lv_is_on_pvs(vdo_data_lv, &vg_to->pvs))
+			if (!lv_is_on_vg_pvs(vdo_data_lv, vg_to))
 				continue;
 
 			if (!_move_one_lv(vg_from, vg_to, lvh, &lvht))
@@ -403,7 +409,7 @@ static int _move_vdos(struct volume_group *vg_from,
 			vdo_data_lv = seg_lv(seg, 0);
 
 			/* Ignore, if no allocations on PVs of @vg_to */
-			if (!lv_is_on_pvs(vdo_data_lv, &vg_to->pvs))
+			if (!lv_is_on_vg_pvs(vdo_data_lv, vg_to))
 				continue;
 
 			if (!_move_one_lv(vg_from, vg_to, lvh, &lvht))
@@ -454,14 +460,14 @@ static int _move_cache(struct volume_group *vg_from,
 		}
 
 		if (data && meta) {
-			if ((orig && !lv_is_on_pvs(orig, &vg_to->pvs)) &&
-			    !lv_is_on_pvs(data, &vg_to->pvs) &&
-			    !lv_is_on_pvs(meta, &vg_to->pvs))
+			if ((orig && !lv_is_on_vg_pvs(orig, vg_to)) &&
+			    !lv_is_on_vg_pvs(data, vg_to) &&
+			    !lv_is_on_vg_pvs(meta, vg_to))
 				continue;
 		}
 		
 		if (fast && orig &&
-		    !lv_is_on_pvs(orig, &vg_to->pvs) && !lv_is_on_pvs(fast, &vg_to->pvs))
+		    !lv_is_on_vg_pvs(orig, vg_to) && !lv_is_on_vg_pvs(fast, vg_to))
 			continue;
 
 		/* Ensure all components are coming along */